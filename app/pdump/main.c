@@ -0,0 +1,421 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <getopt.h>
+#include <sys/time.h>
+
+#include <pcap.h>
+
+#include <rte_eal.h>
+#include <rte_common.h>
+#include <rte_debug.h>
+#include <rte_lcore.h>
+#include <rte_log.h>
+#include <rte_ethdev.h>
+#include <rte_mbuf.h>
+#include <rte_mempool.h>
+#include <rte_ring.h>
+#include <rte_pdump.h>
+
+/* Maximum long option length for option parsing. */
+#define MAX_LONG_OPT_SZ 64
+#define RTE_LOGTYPE_PDUMP_APP RTE_LOGTYPE_USER1
+
+#define PDUMP_RING_SIZE 16384
+#define PDUMP_NB_MBUFS 65535
+#define PDUMP_MBUF_CACHE_SIZE 250
+#define PDUMP_BURST_SIZE 32
+#define PDUMP_MAX_SNAPLEN 65535
+
+/*
+ * The rings and the mempool cannot be freed, so they are created with fixed
+ * names and reused by the next captures.
+ */
+#define PDUMP_MP_NAME "pdump_pool"
+#define PDUMP_RX_RING_NAME "pdump_rx_ring"
+#define PDUMP_TX_RING_NAME "pdump_tx_ring"
+
+/**< captured port */
+static int port_id = -1;
+/**< captured queue */
+static uint16_t queue_id = RTE_PDUMP_ALL_QUEUES;
+/**< output files of the received and transmitted packets */
+static const char *rx_file;
+static const char *tx_file;
+/**< maximum number of bytes captured per packet */
+static uint32_t snaplen = PDUMP_MAX_SNAPLEN;
+/**< libpcap filter expression */
+static const char *filter_expr;
+/**< reference the packets instead of copying them */
+static uint32_t pdump_flags;
+
+static volatile int quit_signal;
+
+struct pdump_output {
+	const char *name;
+	uint32_t flag;
+	struct rte_ring *ring;
+	pcap_dumper_t *dumper;
+	uint64_t nb_pkts;
+};
+
+/* linear copy of a multi-segment packet */
+static uint8_t pkt_buf[PDUMP_MAX_SNAPLEN];
+
+/**< display usage */
+static void
+pdump_usage(const char *prgname)
+{
+	printf("%s [EAL options] -- --port PORT [--queue QUEUE] "
+			"[--rx-file FILE] [--tx-file FILE]\n"
+		"  --port PORT: port to capture\n"
+		"  --queue QUEUE: queue to capture, all by default\n"
+		"  --rx-file FILE: pcap file of the received packets\n"
+		"  --tx-file FILE: pcap file of the transmitted packets\n"
+		"  --snaplen LEN: maximum number of bytes captured per packet\n"
+		"  --filter EXPR: capture only the packets matching the "
+			"pcap-filter expression\n"
+		"  --ref: reference the packets instead of copying them\n",
+		prgname);
+}
+
+static int
+parse_uint(const char *arg, unsigned long max, unsigned long *val)
+{
+	char *end = NULL;
+
+	errno = 0;
+	*val = strtoul(arg, &end, 10);
+	if (arg[0] == '\0' || end == NULL || *end != '\0' || errno != 0 ||
+			*val > max)
+		return -1;
+	return 0;
+}
+
+/* Parse the argument given in the command line of the application */
+static int
+pdump_parse_args(int argc, char **argv)
+{
+	int opt;
+	int option_index;
+	unsigned long val;
+	char *prgname = argv[0];
+	static struct option long_option[] = {
+		{"port", 1, NULL, 0},
+		{"queue", 1, NULL, 0},
+		{"rx-file", 1, NULL, 0},
+		{"tx-file", 1, NULL, 0},
+		{"snaplen", 1, NULL, 0},
+		{"filter", 1, NULL, 0},
+		{"ref", 0, NULL, 0},
+		{NULL, 0, 0, 0}
+	};
+
+	while ((opt = getopt_long(argc, argv, "",
+			long_option, &option_index)) != EOF) {
+		if (opt != 0) {
+			pdump_usage(prgname);
+			return -1;
+		}
+		if (!strncmp(long_option[option_index].name, "port",
+				MAX_LONG_OPT_SZ)) {
+			if (parse_uint(optarg, RTE_MAX_ETHPORTS - 1, &val) < 0) {
+				printf("invalid port\n");
+				return -1;
+			}
+			port_id = val;
+		} else if (!strncmp(long_option[option_index].name, "queue",
+				MAX_LONG_OPT_SZ)) {
+			if (parse_uint(optarg, RTE_MAX_QUEUES_PER_PORT - 1,
+					&val) < 0) {
+				printf("invalid queue\n");
+				return -1;
+			}
+			queue_id = val;
+		} else if (!strncmp(long_option[option_index].name, "rx-file",
+				MAX_LONG_OPT_SZ))
+			rx_file = optarg;
+		else if (!strncmp(long_option[option_index].name, "tx-file",
+				MAX_LONG_OPT_SZ))
+			tx_file = optarg;
+		else if (!strncmp(long_option[option_index].name, "snaplen",
+				MAX_LONG_OPT_SZ)) {
+			if (parse_uint(optarg, PDUMP_MAX_SNAPLEN, &val) < 0 ||
+					val == 0) {
+				printf("invalid snaplen\n");
+				return -1;
+			}
+			snaplen = val;
+		} else if (!strncmp(long_option[option_index].name, "filter",
+				MAX_LONG_OPT_SZ))
+			filter_expr = optarg;
+		else if (!strncmp(long_option[option_index].name, "ref",
+				MAX_LONG_OPT_SZ))
+			pdump_flags |= RTE_PDUMP_FLAG_REF;
+	}
+
+	if (port_id < 0 || (rx_file == NULL && tx_file == NULL)) {
+		pdump_usage(prgname);
+		return -1;
+	}
+	return 0;
+}
+
+static void
+signal_handler(int sig_num)
+{
+	if (sig_num == SIGINT || sig_num == SIGTERM)
+		quit_signal = 1;
+}
+
+/* compile the filter expression into a BPF program run by the primary */
+static int
+pdump_compile_filter(pcap_t *pcap, struct rte_pdump_filter *filter)
+{
+	struct bpf_program prog;
+	unsigned i;
+
+	memset(filter, 0, sizeof(*filter));
+	filter->snaplen = snaplen;
+	if (filter_expr == NULL)
+		return 0;
+
+	if (pcap_compile(pcap, &prog, filter_expr, 1,
+			PCAP_NETMASK_UNKNOWN) < 0) {
+		RTE_LOG(ERR, PDUMP_APP, "Invalid filter: %s\n",
+			pcap_geterr(pcap));
+		return -1;
+	}
+	if (prog.bf_len > RTE_PDUMP_FILTER_MAX) {
+		RTE_LOG(ERR, PDUMP_APP, "Filter too long: %u instructions\n",
+			prog.bf_len);
+		pcap_freecode(&prog);
+		return -1;
+	}
+
+	for (i = 0; i < prog.bf_len; i++) {
+		filter->insns[i].code = prog.bf_insns[i].code;
+		filter->insns[i].jt = prog.bf_insns[i].jt;
+		filter->insns[i].jf = prog.bf_insns[i].jf;
+		filter->insns[i].k = prog.bf_insns[i].k;
+	}
+	filter->nb_insns = prog.bf_len;
+	pcap_freecode(&prog);
+	return 0;
+}
+
+static struct rte_ring *
+pdump_ring_get(const char *name)
+{
+	struct rte_ring *r;
+
+	r = rte_ring_lookup(name);
+	if (r == NULL)
+		r = rte_ring_create(name, PDUMP_RING_SIZE, rte_socket_id(),
+				RING_F_SC_DEQ);
+	return r;
+}
+
+/* copy the first len bytes of a multi-segment packet into pkt_buf */
+static const u_char *
+pdump_pktmbuf_linearize(const struct rte_mbuf *m, uint32_t len)
+{
+	uint32_t seg_len, off = 0;
+
+	for (; m != NULL && off < len; m = m->next) {
+		seg_len = RTE_MIN((uint32_t)m->data_len, len - off);
+		memcpy(pkt_buf + off, rte_pktmbuf_mtod(m, const void *),
+			seg_len);
+		off += seg_len;
+	}
+	return pkt_buf;
+}
+
+/* write the packets dequeued from the ring of an output to its file */
+static unsigned
+pdump_drain(struct pdump_output *out)
+{
+	struct rte_mbuf *pkts[PDUMP_BURST_SIZE];
+	struct pcap_pkthdr hdr;
+	const u_char *data;
+	unsigned nb_pkts, i;
+
+	nb_pkts = rte_ring_dequeue_burst(out->ring, (void **)pkts,
+			PDUMP_BURST_SIZE);
+	if (nb_pkts == 0)
+		return 0;
+
+	gettimeofday(&hdr.ts, NULL);
+	for (i = 0; i < nb_pkts; i++) {
+		struct rte_mbuf *m = pkts[i];
+
+		hdr.caplen = RTE_MIN(m->pkt_len, (uint32_t)PDUMP_MAX_SNAPLEN);
+		hdr.len = m->pkt_len;
+		if (m->nb_segs == 1)
+			data = rte_pktmbuf_mtod(m, const u_char *);
+		else
+			data = pdump_pktmbuf_linearize(m, hdr.caplen);
+		pcap_dump((u_char *)out->dumper, &hdr, data);
+		rte_pktmbuf_free(m);
+	}
+	out->nb_pkts += nb_pkts;
+	return nb_pkts;
+}
+
+int
+main(int argc, char **argv)
+{
+	int ret;
+	int i;
+	char c_flag[] = "-c1";
+	char n_flag[] = "-n4";
+	char mp_flag[] = "--proc-type=secondary";
+	char *argp[argc + 3];
+	struct pdump_output outputs[2] = {
+		{ .name = PDUMP_RX_RING_NAME, .flag = RTE_PDUMP_FLAG_RX },
+		{ .name = PDUMP_TX_RING_NAME, .flag = RTE_PDUMP_FLAG_TX },
+	};
+	struct rte_pdump_filter filter;
+	struct rte_mempool *mp;
+	struct rte_mbuf *m;
+	pcap_t *pcap;
+	unsigned nb_pkts;
+
+	argp[0] = argv[0];
+	argp[1] = c_flag;
+	argp[2] = n_flag;
+	argp[3] = mp_flag;
+
+	for (i = 1; i < argc; i++)
+		argp[i + 3] = argv[i];
+
+	argc += 3;
+
+	ret = rte_eal_init(argc, argp);
+	if (ret < 0)
+		rte_panic("Cannot init EAL\n");
+
+	argc -= ret;
+	argv += (ret - 3);
+
+	/* parse app arguments */
+	ret = pdump_parse_args(argc, argv);
+	if (ret < 0)
+		rte_exit(EXIT_FAILURE, "Invalid argument\n");
+
+	pcap = pcap_open_dead(DLT_EN10MB, snaplen);
+	if (pcap == NULL)
+		rte_exit(EXIT_FAILURE, "Cannot open pcap handle\n");
+	if (pdump_compile_filter(pcap, &filter) < 0)
+		rte_exit(EXIT_FAILURE, "Invalid filter\n");
+
+	mp = rte_mempool_lookup(PDUMP_MP_NAME);
+	if (mp == NULL)
+		mp = rte_pktmbuf_pool_create(PDUMP_MP_NAME, PDUMP_NB_MBUFS,
+				PDUMP_MBUF_CACHE_SIZE, 0,
+				RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+	if (mp == NULL)
+		rte_exit(EXIT_FAILURE, "Cannot create mbuf pool\n");
+
+	outputs[0].dumper = rx_file != NULL ?
+		pcap_dump_open(pcap, rx_file) : NULL;
+	outputs[1].dumper = tx_file != NULL ?
+		pcap_dump_open(pcap, tx_file) : NULL;
+	if ((rx_file != NULL && outputs[0].dumper == NULL) ||
+			(tx_file != NULL && outputs[1].dumper == NULL))
+		rte_exit(EXIT_FAILURE, "Cannot open pcap file: %s\n",
+			pcap_geterr(pcap));
+
+	signal(SIGINT, signal_handler);
+	signal(SIGTERM, signal_handler);
+
+	for (i = 0; i < 2; i++) {
+		struct pdump_output *out = &outputs[i];
+
+		if (out->dumper == NULL)
+			continue;
+		out->ring = pdump_ring_get(out->name);
+		if (out->ring == NULL)
+			rte_exit(EXIT_FAILURE, "Cannot create ring %s\n",
+				out->name);
+		/* drop the packets left by a previous capture */
+		while (rte_ring_dequeue(out->ring, (void **)&m) == 0)
+			rte_pktmbuf_free(m);
+		ret = rte_pdump_enable(port_id, queue_id,
+				out->flag | pdump_flags, out->ring, mp,
+				&filter);
+		if (ret < 0)
+			rte_exit(EXIT_FAILURE,
+				"Cannot enable capture on port %d: %s\n",
+				port_id, strerror(-ret));
+	}
+
+	printf("Capturing port %d, press Ctrl-C to stop\n", port_id);
+
+	while (!quit_signal) {
+		nb_pkts = 0;
+		for (i = 0; i < 2; i++)
+			if (outputs[i].dumper != NULL)
+				nb_pkts += pdump_drain(&outputs[i]);
+		if (nb_pkts == 0)
+			usleep(1000);
+	}
+
+	for (i = 0; i < 2; i++) {
+		struct pdump_output *out = &outputs[i];
+
+		if (out->dumper == NULL)
+			continue;
+		ret = rte_pdump_disable(port_id, queue_id, out->flag);
+		if (ret < 0)
+			RTE_LOG(ERR, PDUMP_APP,
+				"Cannot disable capture on port %d: %s\n",
+				port_id, strerror(-ret));
+		while (pdump_drain(out) != 0)
+			;
+		pcap_dump_close(out->dumper);
+		printf("%"PRIu64" %s packets captured\n", out->nb_pkts,
+			out->flag == RTE_PDUMP_FLAG_RX ? "RX" : "TX");
+	}
+	pcap_close(pcap);
+
+	return 0;
+}
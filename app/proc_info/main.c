@@ -47,6 +47,7 @@
 #include <rte_debug.h>
 #include <rte_ethdev.h>
 #include <rte_malloc.h>
+#include <rte_mempool.h>
 #include <rte_memory.h>
 #include <rte_memzone.h>
 #include <rte_launch.h>
@@ -58,6 +59,9 @@
 #include <rte_atomic.h>
 #include <rte_branch_prediction.h>
 #include <rte_string_fns.h>
+#ifdef RTE_LIBRTE_METRICS
+#include <rte_metrics.h>
+#endif
 
 /* Maximum long option length for option parsing. */
 #define MAX_LONG_OPT_SZ 64
@@ -75,6 +79,12 @@ static uint32_t reset_stats;
 static uint32_t reset_xstats;
 /**< Enable memory info. */
 static uint32_t mem_info;
+/**< Enable heap info. */
+static uint32_t heap_info;
+/**< Enable mempool info. */
+static uint32_t mempool_info;
+/**< Enable metrics. */
+static uint32_t metrics_info;
 
 /**< display usage */
 static void
@@ -87,7 +97,11 @@ proc_info_usage(const char *prgname)
 		"  --xstats: to display extended port statistics, disabled by "
 			"default\n"
 		"  --stats-reset: to reset port statistics\n"
-		"  --xstats-reset: to reset port extended statistics\n",
+		"  --xstats-reset: to reset port extended statistics\n"
+		"  --heap: to display heap fragmentation and allocations by "
+			"type\n"
+		"  --mempool: to display mempool per-lcore cache fill levels\n"
+		"  --metrics: to display the metrics\n",
 		prgname);
 }
 
@@ -129,6 +143,9 @@ proc_info_parse_args(int argc, char **argv)
 		{"stats-reset", 0, NULL, 0},
 		{"xstats", 0, NULL, 0},
 		{"xstats-reset", 0, NULL, 0},
+		{"heap", 0, NULL, 0},
+		{"mempool", 0, NULL, 0},
+		{"metrics", 0, NULL, 0},
 		{NULL, 0, 0, 0}
 	};
 
@@ -168,6 +185,18 @@ proc_info_parse_args(int argc, char **argv)
 			else if (!strncmp(long_option[option_index].name, "xstats-reset",
 					MAX_LONG_OPT_SZ))
 				reset_xstats = 1;
+			/* Print heap info */
+			else if (!strncmp(long_option[option_index].name, "heap",
+					MAX_LONG_OPT_SZ))
+				heap_info = 1;
+			/* Print mempool info */
+			else if (!strncmp(long_option[option_index].name, "mempool",
+					MAX_LONG_OPT_SZ))
+				mempool_info = 1;
+			/* Print metrics */
+			else if (!strncmp(long_option[option_index].name, "metrics",
+					MAX_LONG_OPT_SZ))
+				metrics_info = 1;
 			break;
 
 		default:
@@ -194,6 +223,127 @@ meminfo_display(void)
 	printf("---------- END_TAIL_QUEUES ------------\n");
 }
 
+static void
+heapinfo_display(void)
+{
+	struct rte_malloc_socket_stats sock_stats;
+	struct rte_malloc_socket_frag_stats frag_stats;
+	struct rte_malloc_type_stats type_stats[RTE_MALLOC_MAX_TYPES];
+	unsigned socket, i;
+	int n;
+
+	printf("---------------- HEAPS ----------------\n");
+	for (socket = 0; socket < RTE_MAX_NUMA_NODES; socket++) {
+		if (rte_malloc_get_socket_stats(socket, &sock_stats) < 0 ||
+				rte_malloc_get_socket_frag_stats(socket,
+					&frag_stats) < 0)
+			continue;
+		if (sock_stats.heap_totalsz_bytes == 0)
+			continue;
+
+		printf("Socket %u: total %zu, free %zu, allocated %zu, "
+			"largest free block %zu, free blocks %u, "
+			"fragmentation %.1f%%\n", socket,
+			sock_stats.heap_totalsz_bytes,
+			frag_stats.heap_freesz_bytes,
+			sock_stats.heap_allocsz_bytes,
+			frag_stats.greatest_free_size,
+			frag_stats.free_count,
+			frag_stats.heap_freesz_bytes == 0 ? 0.0 :
+			100.0 - 100.0 * frag_stats.greatest_free_size /
+				frag_stats.heap_freesz_bytes);
+		for (i = 0; i < RTE_MALLOC_FREE_HIST_SIZE; i++) {
+			if (frag_stats.free_hist[i] == 0)
+				continue;
+			printf("  free blocks >= %"PRIu64": %u (%zu bytes)\n",
+				(uint64_t)RTE_CACHE_LINE_SIZE << i,
+				frag_stats.free_hist[i],
+				frag_stats.free_hist_bytes[i]);
+		}
+	}
+	printf("-------------- END_HEAPS --------------\n");
+
+	printf("------------ MALLOC_TYPES -------------\n");
+	n = rte_malloc_get_type_stats(type_stats, RTE_DIM(type_stats));
+	printf("%-32s %12s %12s %16s\n", "type", "allocs", "frees", "bytes");
+	for (i = 0; i < (unsigned)n && i < RTE_DIM(type_stats); i++)
+		printf("%-32s %12"PRIu64" %12"PRIu64" %16"PRIu64"\n",
+			type_stats[i].name[0] != '\0' ?
+				type_stats[i].name : "(none)",
+			type_stats[i].alloc_count, type_stats[i].free_count,
+			type_stats[i].alloc_bytes);
+	printf("---------- END_MALLOC_TYPES -----------\n");
+}
+
+static void
+mempool_cache_display(const struct rte_mempool *mp, void *arg __rte_unused)
+{
+	unsigned lcore_id, count;
+
+	printf("%s: size %u, in use %u, available %u, cache size %u\n",
+		mp->name, mp->size, rte_mempool_free_count(mp),
+		rte_mempool_count(mp), mp->cache_size);
+	if (mp->cache_size == 0)
+		return;
+	for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+		count = rte_mempool_cache_count(mp, lcore_id);
+		if (count != 0)
+			printf("  lcore %u: cache %u/%u\n", lcore_id, count,
+				mp->cache_size);
+	}
+}
+
+static void
+mempoolinfo_display(void)
+{
+	printf("-------------- MEMPOOLS ---------------\n");
+	rte_mempool_walk(mempool_cache_display, NULL);
+	printf("------------ END_MEMPOOLS -------------\n");
+}
+
+static void
+metrics_display(void)
+{
+#ifdef RTE_LIBRTE_METRICS
+	struct rte_metric_name *names;
+	struct rte_metric_value *values;
+	int i, nb;
+
+	if (rte_metrics_init(rte_socket_id()) < 0) {
+		printf("No metrics in the primary process\n");
+		return;
+	}
+retry:
+	nb = rte_metrics_get_names(NULL, 0);
+	if (nb <= 0)
+		return;
+	names = malloc(nb * sizeof(*names));
+	values = malloc(nb * sizeof(*values));
+	if (names == NULL || values == NULL) {
+		free(names);
+		free(values);
+		return;
+	}
+	/* retry if metrics were registered meanwhile */
+	if (rte_metrics_get_names(names, nb) != nb ||
+			rte_metrics_get_values(values, nb) != nb) {
+		free(names);
+		free(values);
+		goto retry;
+	}
+
+	printf("--------------- METRICS ---------------\n");
+	for (i = 0; i < nb; i++)
+		printf("%s: %"PRIu64"\n", names[i].name, values[i].value);
+	printf("------------- END_METRICS -------------\n");
+
+	free(names);
+	free(values);
+#else
+	printf("Metrics library not compiled\n");
+#endif
+}
+
 static void
 nic_stats_display(uint8_t port_id)
 {
@@ -319,8 +469,15 @@ main(int argc, char **argv)
 	if (ret < 0)
 		rte_exit(EXIT_FAILURE, "Invalid argument\n");
 
-	if (mem_info) {
-		meminfo_display();
+	if (mem_info || heap_info || mempool_info || metrics_info) {
+		if (mem_info)
+			meminfo_display();
+		if (heap_info)
+			heapinfo_display();
+		if (mempool_info)
+			mempoolinfo_display();
+		if (metrics_info)
+			metrics_display();
 		return 0;
 	}
 
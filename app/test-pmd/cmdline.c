@@ -185,6 +185,12 @@ static void cmd_help_long_parsed(void *parsed_result,
 			"show port (info|stats|xstats|fdir|stat_qmap|dcb_tc) (port_id|all)\n"
 			"    Display information for port_id, or all.\n\n"
 
+#ifdef RTE_LIBRTE_LATENCY_STATS
+			"show latencystats (port_id|all)\n"
+			"    Display the latency and bit rates of port_id,"
+			" or all.\n\n"
+#endif
+
 			"show port X rss reta (size) (mask0,mask1,...)\n"
 			"    Display the rss redirection table entry indicated"
 			" by masks on port X. size is used to indicate the"
@@ -373,6 +379,12 @@ static void cmd_help_long_parsed(void *parsed_result,
 			"set allmulti (port_id|all) (on|off)\n"
 			"    Set the allmulti mode on port_id, or all.\n\n"
 
+#ifdef RTE_LIBRTE_LATENCY_STATS
+			"set latencystats (port_id|all) (on|off)\n"
+			"    Measure the latency and bit rates of port_id,"
+			" or all. The ports must be started.\n\n"
+#endif
+
 			"set flow_ctrl rx (on|off) tx (on|off) (high_water)"
 			" (low_water) (pause_time) (send_xon) mac_ctrl_frame_fwd"
 			" (on|off) autoneg (on|off) (port_id)\n"
@@ -4711,6 +4723,136 @@ cmdline_parse_inst_t cmd_set_allmulti_mode_one = {
 	},
 };
 
+#ifdef RTE_LIBRTE_LATENCY_STATS
+/* *** SET LATENCY STATISTICS *** */
+struct cmd_set_latencystats_result {
+	cmdline_fixed_string_t set;
+	cmdline_fixed_string_t latencystats;
+	cmdline_fixed_string_t port_all; /* valid if "allports" argument == 1 */
+	uint8_t port_num;                /* valid if "allports" argument == 0 */
+	cmdline_fixed_string_t mode;
+};
+
+static void cmd_set_latencystats_parsed(void *parsed_result,
+					__attribute__((unused)) struct cmdline *cl,
+					void *allports)
+{
+	struct cmd_set_latencystats_result *res = parsed_result;
+	int enable = !strcmp(res->mode, "on");
+	portid_t i;
+
+	if (allports) {
+		FOREACH_PORT(i, ports)
+			latencystats_set(i, enable);
+	} else
+		latencystats_set(res->port_num, enable);
+}
+
+cmdline_parse_token_string_t cmd_setlatencystats_set =
+	TOKEN_STRING_INITIALIZER(struct cmd_set_latencystats_result, set, "set");
+cmdline_parse_token_string_t cmd_setlatencystats_latencystats =
+	TOKEN_STRING_INITIALIZER(struct cmd_set_latencystats_result,
+				 latencystats, "latencystats");
+cmdline_parse_token_string_t cmd_setlatencystats_portall =
+	TOKEN_STRING_INITIALIZER(struct cmd_set_latencystats_result, port_all,
+				 "all");
+cmdline_parse_token_num_t cmd_setlatencystats_portnum =
+	TOKEN_NUM_INITIALIZER(struct cmd_set_latencystats_result, port_num,
+			      UINT8);
+cmdline_parse_token_string_t cmd_setlatencystats_mode =
+	TOKEN_STRING_INITIALIZER(struct cmd_set_latencystats_result, mode,
+				 "on#off");
+
+cmdline_parse_inst_t cmd_set_latencystats_all = {
+	.f = cmd_set_latencystats_parsed,
+	.data = (void *)1,
+	.help_str = "set latencystats all on|off: measure the latency and "
+		"bit rates of all ports",
+	.tokens = {
+		(void *)&cmd_setlatencystats_set,
+		(void *)&cmd_setlatencystats_latencystats,
+		(void *)&cmd_setlatencystats_portall,
+		(void *)&cmd_setlatencystats_mode,
+		NULL,
+	},
+};
+
+cmdline_parse_inst_t cmd_set_latencystats_one = {
+	.f = cmd_set_latencystats_parsed,
+	.data = (void *)0,
+	.help_str = "set latencystats X on|off: measure the latency and "
+		"bit rates of port X",
+	.tokens = {
+		(void *)&cmd_setlatencystats_set,
+		(void *)&cmd_setlatencystats_latencystats,
+		(void *)&cmd_setlatencystats_portnum,
+		(void *)&cmd_setlatencystats_mode,
+		NULL,
+	},
+};
+
+/* *** SHOW LATENCY STATISTICS *** */
+struct cmd_show_latencystats_result {
+	cmdline_fixed_string_t show;
+	cmdline_fixed_string_t latencystats;
+	cmdline_fixed_string_t port_all; /* valid if "allports" argument == 1 */
+	uint8_t port_num;                /* valid if "allports" argument == 0 */
+};
+
+static void cmd_show_latencystats_parsed(void *parsed_result,
+					 __attribute__((unused)) struct cmdline *cl,
+					 void *allports)
+{
+	struct cmd_show_latencystats_result *res = parsed_result;
+	portid_t i;
+
+	if (allports) {
+		FOREACH_PORT(i, ports)
+			latencystats_display(i);
+	} else
+		latencystats_display(res->port_num);
+}
+
+cmdline_parse_token_string_t cmd_showlatencystats_show =
+	TOKEN_STRING_INITIALIZER(struct cmd_show_latencystats_result, show,
+				 "show");
+cmdline_parse_token_string_t cmd_showlatencystats_latencystats =
+	TOKEN_STRING_INITIALIZER(struct cmd_show_latencystats_result,
+				 latencystats, "latencystats");
+cmdline_parse_token_string_t cmd_showlatencystats_portall =
+	TOKEN_STRING_INITIALIZER(struct cmd_show_latencystats_result, port_all,
+				 "all");
+cmdline_parse_token_num_t cmd_showlatencystats_portnum =
+	TOKEN_NUM_INITIALIZER(struct cmd_show_latencystats_result, port_num,
+			      UINT8);
+
+cmdline_parse_inst_t cmd_show_latencystats_all = {
+	.f = cmd_show_latencystats_parsed,
+	.data = (void *)1,
+	.help_str = "show latencystats all: display the latency and bit "
+		"rates of all ports",
+	.tokens = {
+		(void *)&cmd_showlatencystats_show,
+		(void *)&cmd_showlatencystats_latencystats,
+		(void *)&cmd_showlatencystats_portall,
+		NULL,
+	},
+};
+
+cmdline_parse_inst_t cmd_show_latencystats_one = {
+	.f = cmd_show_latencystats_parsed,
+	.data = (void *)0,
+	.help_str = "show latencystats X: display the latency and bit rates "
+		"of port X",
+	.tokens = {
+		(void *)&cmd_showlatencystats_show,
+		(void *)&cmd_showlatencystats_latencystats,
+		(void *)&cmd_showlatencystats_portnum,
+		NULL,
+	},
+};
+#endif
+
 /* *** SETUP ETHERNET LINK FLOW CONTROL *** */
 struct cmd_link_flow_ctrl_set_result {
 	cmdline_fixed_string_t set;
@@ -9657,6 +9799,12 @@ cmdline_parse_ctx_t main_ctx[] = {
 	(cmdline_parse_inst_t *)&cmd_set_promisc_mode_all,
 	(cmdline_parse_inst_t *)&cmd_set_allmulti_mode_one,
 	(cmdline_parse_inst_t *)&cmd_set_allmulti_mode_all,
+#ifdef RTE_LIBRTE_LATENCY_STATS
+	(cmdline_parse_inst_t *)&cmd_set_latencystats_one,
+	(cmdline_parse_inst_t *)&cmd_set_latencystats_all,
+	(cmdline_parse_inst_t *)&cmd_show_latencystats_one,
+	(cmdline_parse_inst_t *)&cmd_show_latencystats_all,
+#endif
 	(cmdline_parse_inst_t *)&cmd_set_flush_rx,
 	(cmdline_parse_inst_t *)&cmd_set_link_check,
 #ifdef RTE_NIC_BYPASS
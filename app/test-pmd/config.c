@@ -92,6 +92,9 @@
 #include <rte_ether.h>
 #include <rte_ethdev.h>
 #include <rte_string_fns.h>
+#ifdef RTE_LIBRTE_LATENCY_STATS
+#include <rte_latencystats.h>
+#endif
 
 #include "testpmd.h"
 
@@ -229,6 +232,57 @@ nic_stats_clear(portid_t port_id)
 	printf("\n  NIC statistics for port %d cleared\n", port_id);
 }
 
+#ifdef RTE_LIBRTE_LATENCY_STATS
+void
+latencystats_set(portid_t port_id, int on)
+{
+	int ret;
+
+	if (port_id_is_invalid(port_id, ENABLED_WARN))
+		return;
+	if (on)
+		ret = rte_latencystats_enable(port_id, NULL);
+	else
+		ret = rte_latencystats_disable(port_id);
+	if (ret < 0)
+		printf("Cannot %s latency statistics on port %d: %s\n",
+		       on ? "enable" : "disable", port_id, strerror(-ret));
+}
+
+void
+latencystats_display(portid_t port_id)
+{
+	struct rte_latencystats stats;
+	int ret;
+
+	static const char *latency_stats_border = "######################";
+
+	if (port_id_is_invalid(port_id, ENABLED_WARN))
+		return;
+	ret = rte_latencystats_get(port_id, &stats);
+	if (ret < 0) {
+		printf("Latency statistics of port %d not available: %s\n",
+		       port_id, strerror(-ret));
+		return;
+	}
+	printf("\n  %s Latency statistics for port %-2d %s\n",
+	       latency_stats_border, port_id, latency_stats_border);
+	printf("  Samples: %-"PRIu64"\n", stats.samples);
+	printf("  Latency (ns): min %-10"PRIu64" avg %-10"PRIu64
+	       " max %-"PRIu64"\n",
+	       stats.min_ns, stats.avg_ns, stats.max_ns);
+	printf("  Percentiles (ns): 50%% %-10"PRIu64" 90%% %-10"PRIu64
+	       " 99%% %-10"PRIu64" 99.9%% %-"PRIu64"\n",
+	       stats.p50_ns, stats.p90_ns, stats.p99_ns, stats.p999_ns);
+	printf("  RX-bps: %-14"PRIu64" RX-peak-bps: %-"PRIu64"\n",
+	       stats.rx_bps, stats.rx_peak_bps);
+	printf("  TX-bps: %-14"PRIu64" TX-peak-bps: %-"PRIu64"\n",
+	       stats.tx_bps, stats.tx_peak_bps);
+	printf("  %s############################%s\n",
+	       latency_stats_border, latency_stats_border);
+}
+#endif
+
 void
 nic_xstats_display(portid_t port_id)
 {
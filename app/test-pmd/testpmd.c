@@ -75,6 +75,12 @@
 #ifdef RTE_LIBRTE_PMD_XENVIRT
 #include <rte_eth_xenvirt.h>
 #endif
+#ifdef RTE_LIBRTE_PDUMP
+#include <rte_pdump.h>
+#endif
+#ifdef RTE_LIBRTE_LATENCY_STATS
+#include <rte_latencystats.h>
+#endif
 
 #include "testpmd.h"
 #include "mempool_osdep.h"
@@ -878,11 +884,27 @@ run_pkt_fwd_on_lcore(struct fwd_lcore *fc, packet_fwd_t pkt_fwd)
 	streamid_t nb_fs;
 	streamid_t sm_id;
 
+#ifdef RTE_LIBRTE_LATENCY_STATS
+	uint64_t bitrate_period = rte_get_tsc_hz();
+	uint64_t bitrate_tsc = rte_rdtsc();
+	uint64_t now;
+#endif
+
 	fsm = &fwd_streams[fc->stream_idx];
 	nb_fs = fc->stream_nb;
 	do {
 		for (sm_id = 0; sm_id < nb_fs; sm_id++)
 			(*pkt_fwd)(fsm[sm_id]);
+#ifdef RTE_LIBRTE_LATENCY_STATS
+		/* the first forwarding lcore updates the bit rates */
+		if (fc == fwd_lcores[0]) {
+			now = rte_rdtsc();
+			if (now - bitrate_tsc >= bitrate_period) {
+				rte_latencystats_bitrate_calc();
+				bitrate_tsc = now;
+			}
+		}
+#endif
 	} while (! fc->stopped);
 }
 
@@ -1429,6 +1451,11 @@ stop_port(portid_t pid)
 						RTE_PORT_HANDLING) == 0)
 			continue;
 
+#ifdef RTE_LIBRTE_LATENCY_STATS
+		/* its queues may be reconfigured */
+		if (rte_latencystats_disable(pi) == 0)
+			printf("Latency statistics of port %d disabled\n", pi);
+#endif
 		rte_eth_dev_stop(pi);
 
 		if (rte_atomic16_cmpset(&(port->port_status),
@@ -1570,6 +1597,11 @@ pmd_test_exit(void)
 	if (test_done == 0)
 		stop_packet_forwarding();
 
+#ifdef RTE_LIBRTE_PDUMP
+	/* uninitialize packet capture framework */
+	rte_pdump_uninit();
+#endif
+
 	FOREACH_PORT(pt_id, ports) {
 		printf("Stopping port %d...", pt_id);
 		fflush(stdout);
@@ -1994,6 +2026,12 @@ main(int argc, char** argv)
 	if (diag < 0)
 		rte_panic("Cannot init EAL\n");
 
+#ifdef RTE_LIBRTE_PDUMP
+	/* initialize packet capture framework */
+	if (rte_pdump_init(NULL) < 0)
+		RTE_LOG(WARNING, EAL, "Cannot start packet capture server\n");
+#endif
+
 	nb_ports = (portid_t) rte_eth_dev_count();
 	if (nb_ports == 0)
 		RTE_LOG(WARNING, EAL, "No probed ethernet devices\n");
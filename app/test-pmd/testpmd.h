@@ -465,6 +465,10 @@ void prompt(void);
 void nic_stats_display(portid_t port_id);
 void nic_stats_clear(portid_t port_id);
 void nic_xstats_display(portid_t port_id);
+#ifdef RTE_LIBRTE_LATENCY_STATS
+void latencystats_set(portid_t port_id, int on);
+void latencystats_display(portid_t port_id);
+#endif
 void nic_xstats_clear(portid_t port_id);
 void nic_stats_mapping_display(portid_t port_id);
 void port_infos_display(portid_t port_id);
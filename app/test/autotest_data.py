@@ -240,6 +240,30 @@ parallel_test_group_list = [
 		 "Func" :	default_autotest,
 		 "Report" :	None,
 		},
+		{
+		 "Name" :	"Service cores autotest",
+		 "Command" : 	"service_cores_autotest",
+		 "Func" :	default_autotest,
+		 "Report" :	None,
+		},
+		{
+		 "Name" :	"Metrics autotest",
+		 "Command" : 	"metrics_autotest",
+		 "Func" :	default_autotest,
+		 "Report" :	None,
+		},
+		{
+		 "Name" :	"Pdump autotest",
+		 "Command" : 	"pdump_autotest",
+		 "Func" :	default_autotest,
+		 "Report" :	None,
+		},
+		{
+		 "Name" :	"Latency stats autotest",
+		 "Command" : 	"latencystats_autotest",
+		 "Func" :	default_autotest,
+		 "Report" :	None,
+		},
 		{
 		 "Name" :	"Ring autotest",
 		 "Command" : 	"ring_autotest",
@@ -95,6 +95,12 @@ do_recursive_call(void)
 			{ "test_memory_flags", no_action },
 			{ "test_file_prefix", no_action },
 			{ "test_no_huge_flag", no_action },
+			{ "test_eal_startup_perf", no_action },
+#ifdef RTE_EXEC_ENV_LINUXAPP
+			{ "test_mem_hotplug", test_mem_hotplug_primary },
+			{ "test_mem_hotplug_secondary",
+				test_mem_hotplug_secondary },
+#endif
 #ifdef RTE_LIBRTE_IVSHMEM
 			{ "test_ivshmem", test_ivshmem },
 #endif
@@ -172,6 +172,8 @@ int test_pci(void);
 int test_pci_run;
 
 int test_mp_secondary(void);
+int test_mem_hotplug_primary(void);
+int test_mem_hotplug_secondary(void);
 
 int test_ivshmem(void);
 int test_set_rxtx_conf(cmdline_fixed_string_t mode);
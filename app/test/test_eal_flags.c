@@ -41,12 +41,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <stdint.h>
+#include <inttypes.h>
 #include <unistd.h>
 #include <dirent.h>
 #include <sys/wait.h>
 #include <sys/file.h>
+#include <sys/time.h>
 #include <limits.h>
 
+#include <rte_common.h>
 #include <rte_debug.h>
 #include <rte_string_fns.h>
 
@@ -1446,3 +1450,116 @@ static struct test_command eal_flags_cmd = {
 	.callback = test_eal_flags,
 };
 REGISTER_TEST_COMMAND(eal_flags_cmd);
+
+#ifndef RTE_EXEC_ENV_BSDAPP
+/*
+ * Get the amount of free hugepage memory (in MB) of the default hugepage
+ * size, as reported by /proc/meminfo.
+ */
+static uint64_t
+get_free_hugepage_mem(void)
+{
+	char buf[BUFSIZ];
+	uint64_t n_free = 0, page_sz_kb = 0;
+	FILE *f;
+
+	f = fopen("/proc/meminfo", "r");
+	if (f == NULL)
+		return 0;
+
+	while (fgets(buf, sizeof(buf), f) != NULL) {
+		if (strncmp(buf, "HugePages_Free:", 15) == 0)
+			n_free = strtoull(&buf[15], NULL, 10);
+		else if (strncmp(buf, "Hugepagesize:", 13) == 0)
+			page_sz_kb = strtoull(&buf[13], NULL, 10);
+	}
+	fclose(f);
+
+	return (n_free * page_sz_kb) >> 10;
+}
+#endif
+
+/*
+ * Measure the time taken by a child instance of the test application to
+ * start up, i.e. to initialize the EAL, with -m sizes from 1 GB to 64 GB.
+ * Each size is run with a single lcore and with all the online CPUs, so the
+ * benefit of the parallel hugepage initialization can be observed. Sizes
+ * bigger than the free hugepage memory are skipped.
+ */
+static int
+test_eal_startup_perf(void)
+{
+#ifdef RTE_EXEC_ENV_BSDAPP
+	printf("EAL startup benchmark not supported on BSD\n");
+	return 0;
+#else
+	static const unsigned mem_mb[] = {
+		1024, 2048, 4096, 8192, 16384, 32768, 65536
+	};
+	char mem[16], lcores[32];
+	uint64_t free_mb;
+	unsigned i, j;
+	long n_cpus;
+
+	const char *argv[] = {prgname, "-l", lcores, "-n", "2",
+			"--file-prefix=" memtest, "-m", mem};
+
+	n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n_cpus <= 0)
+		n_cpus = 1;
+	n_cpus = RTE_MIN(n_cpus, RTE_MAX_LCORE);
+
+	free_mb = get_free_hugepage_mem();
+	printf("Free hugepage memory: %" PRIu64 " MB\n", free_mb);
+
+	for (i = 0; i < RTE_DIM(mem_mb); i++) {
+		if (mem_mb[i] > free_mb) {
+			printf("-m %u: skipped, not enough hugepage memory\n",
+				mem_mb[i]);
+			continue;
+		}
+
+		snprintf(mem, sizeof(mem), "%u", mem_mb[i]);
+
+		for (j = 0; j < 2; j++) {
+			struct timeval start, end;
+			uint64_t us;
+
+			if (j == 0)
+				snprintf(lcores, sizeof(lcores), "0");
+			else if (n_cpus > 1)
+				snprintf(lcores, sizeof(lcores), "0-%ld",
+					n_cpus - 1);
+			else
+				break;
+
+			gettimeofday(&start, NULL);
+			if (launch_proc(argv) != 0) {
+				printf("Error - process did not run ok with "
+					"-m %s -l %s\n", mem, lcores);
+				return -1;
+			}
+			gettimeofday(&end, NULL);
+
+			us = (end.tv_sec - start.tv_sec) * 1000000ULL +
+				end.tv_usec - start.tv_usec;
+			printf("-m %5u -l %-8s: startup time %" PRIu64
+				".%03" PRIu64 " s\n", mem_mb[i], lcores,
+				us / 1000000, (us % 1000000) / 1000);
+		}
+	}
+
+	if (process_hugefiles(memtest, HUGEPAGE_DELETE) < 0) {
+		printf("Error - unable to delete hugepage files!\n");
+		return -1;
+	}
+
+	return 0;
+#endif
+}
+
+static struct test_command eal_startup_perf_cmd = {
+	.command = "eal_startup_perf_autotest",
+	.callback = test_eal_startup_perf,
+};
+REGISTER_TEST_COMMAND(eal_startup_perf_cmd);
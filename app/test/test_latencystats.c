@@ -0,0 +1,225 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include <rte_common.h>
+#include <rte_cycles.h>
+#include <rte_ethdev.h>
+#include <rte_eth_ring.h>
+#include <rte_mbuf.h>
+#include <rte_mempool.h>
+#include <rte_ring.h>
+#include <rte_latencystats.h>
+
+#include "test.h"
+
+/*
+ * Latency statistics
+ * ==================
+ *
+ * - Check the enable, disable, get and reset errors.
+ *
+ * - Receive packets from a ring port, send them back after a delay, and
+ *   check the number of samples, the measured latencies and the bit rates.
+ *
+ * - Check that enabling the measurement again starts from scratch.
+ */
+
+#define LATENCY_RING_SIZE 256
+#define LATENCY_NB_MBUF 511
+#define LATENCY_NB_PKTS 32
+#define LATENCY_PKT_LEN 64
+#define LATENCY_SAMP_INTVL 4
+#define LATENCY_DELAY_US 100
+
+static int latency_port = -1;
+static struct rte_mempool *latency_mp;
+
+static int
+latency_port_setup(void)
+{
+	static const struct rte_eth_conf null_conf;
+	struct rte_ring *r;
+
+	if (latency_port >= 0)
+		return 0;
+
+	latency_mp = rte_pktmbuf_pool_create("test_latency_pool",
+			LATENCY_NB_MBUF, 32, 0, RTE_MBUF_DEFAULT_BUF_SIZE,
+			rte_socket_id());
+	r = rte_ring_create("test_latency_port", LATENCY_RING_SIZE,
+			rte_socket_id(), 0);
+	if (latency_mp == NULL || r == NULL)
+		return -1;
+
+	latency_port = rte_eth_from_ring(r);
+	if (latency_port < 0 ||
+			rte_eth_dev_configure(latency_port, 1, 1,
+				&null_conf) < 0 ||
+			rte_eth_tx_queue_setup(latency_port, 0,
+				LATENCY_RING_SIZE, rte_socket_id(), NULL) < 0 ||
+			rte_eth_rx_queue_setup(latency_port, 0,
+				LATENCY_RING_SIZE, rte_socket_id(), NULL,
+				latency_mp) < 0 ||
+			rte_eth_dev_start(latency_port) < 0) {
+		latency_port = -1;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Loop packets through the port: the packets received are sent again after
+ * a delay, which is their latency, then received and freed.
+ */
+static int
+latency_loop(void)
+{
+	struct rte_mbuf *pkts[LATENCY_NB_PKTS];
+	unsigned i;
+
+	for (i = 0; i < LATENCY_NB_PKTS; i++) {
+		pkts[i] = rte_pktmbuf_alloc(latency_mp);
+		if (pkts[i] == NULL ||
+				rte_pktmbuf_append(pkts[i],
+					LATENCY_PKT_LEN) == NULL)
+			return -1;
+	}
+	if (rte_eth_tx_burst(latency_port, 0, pkts, LATENCY_NB_PKTS) !=
+			LATENCY_NB_PKTS ||
+			rte_eth_rx_burst(latency_port, 0, pkts,
+				LATENCY_NB_PKTS) != LATENCY_NB_PKTS)
+		return -1;
+	rte_delay_us(LATENCY_DELAY_US);
+	if (rte_eth_tx_burst(latency_port, 0, pkts, LATENCY_NB_PKTS) !=
+			LATENCY_NB_PKTS ||
+			rte_eth_rx_burst(latency_port, 0, pkts,
+				LATENCY_NB_PKTS) != LATENCY_NB_PKTS)
+		return -1;
+	for (i = 0; i < LATENCY_NB_PKTS; i++)
+		rte_pktmbuf_free(pkts[i]);
+	return 0;
+}
+
+static int
+test_latencystats(void)
+{
+	struct rte_latencystats_conf conf = {
+		.samp_intvl = LATENCY_SAMP_INTVL,
+		.ewma_weight = 100,
+	};
+	struct rte_latencystats stats;
+	unsigned expected;
+
+	TEST_ASSERT_SUCCESS(latency_port_setup(), "Cannot create ring port");
+
+	/* invalid requests */
+	conf.samp_intvl = 0;
+	TEST_ASSERT_EQUAL(rte_latencystats_enable(latency_port, &conf),
+			-EINVAL, "Invalid sampling interval accepted");
+	conf.samp_intvl = LATENCY_SAMP_INTVL;
+	TEST_ASSERT_EQUAL(rte_latencystats_get(latency_port, &stats),
+			-ENOENT, "Statistics of a port not measured");
+	TEST_ASSERT_EQUAL(rte_latencystats_disable(latency_port), -ENOENT,
+			"Measurement disabled before being enabled");
+
+	TEST_ASSERT_SUCCESS(rte_latencystats_enable(latency_port, &conf),
+			"Cannot enable measurement");
+	TEST_ASSERT_EQUAL(rte_latencystats_enable(latency_port, &conf),
+			-EEXIST, "Measurement enabled twice");
+
+	/* the first loop stamps the packets received twice */
+	TEST_ASSERT_SUCCESS(latency_loop(), "Cannot loop packets");
+	rte_latencystats_bitrate_calc();
+	TEST_ASSERT_SUCCESS(rte_latencystats_get(latency_port, &stats),
+			"Cannot get statistics");
+	expected = LATENCY_NB_PKTS / LATENCY_SAMP_INTVL;
+	TEST_ASSERT_EQUAL(stats.samples, expected,
+			"Wrong number of samples %"PRIu64", expected %u",
+			stats.samples, expected);
+	TEST_ASSERT(stats.min_ns >= LATENCY_DELAY_US * 1000,
+			"Latency %"PRIu64" ns below the delay", stats.min_ns);
+	TEST_ASSERT(stats.min_ns <= stats.avg_ns &&
+			stats.avg_ns <= stats.max_ns &&
+			stats.min_ns <= stats.p50_ns &&
+			stats.p50_ns <= stats.p90_ns &&
+			stats.p90_ns <= stats.p99_ns &&
+			stats.p99_ns <= stats.p999_ns &&
+			stats.p999_ns <= stats.max_ns,
+			"Inconsistent latencies");
+	TEST_ASSERT(stats.rx_bps != 0 && stats.tx_bps != 0 &&
+			stats.rx_peak_bps >= stats.rx_bps &&
+			stats.tx_peak_bps >= stats.tx_bps,
+			"Wrong bit rates");
+
+	TEST_ASSERT_SUCCESS(rte_latencystats_reset(latency_port),
+			"Cannot reset statistics");
+	TEST_ASSERT_SUCCESS(rte_latencystats_get(latency_port, &stats),
+			"Cannot get statistics");
+	TEST_ASSERT(stats.samples == 0 && stats.max_ns == 0 &&
+			stats.rx_peak_bps == 0,
+			"Statistics not reset");
+
+	TEST_ASSERT_SUCCESS(rte_latencystats_disable(latency_port),
+			"Cannot disable measurement");
+	TEST_ASSERT_EQUAL(rte_latencystats_get(latency_port, &stats),
+			-ENOENT, "Statistics of a port no longer measured");
+
+	/* the state of the port is reused, measuring from scratch */
+	TEST_ASSERT_SUCCESS(latency_loop(), "Cannot loop packets");
+	TEST_ASSERT_SUCCESS(rte_latencystats_enable(latency_port, &conf),
+			"Cannot enable measurement again");
+	TEST_ASSERT_SUCCESS(rte_latencystats_get(latency_port, &stats),
+			"Cannot get statistics");
+	TEST_ASSERT(stats.samples == 0 && stats.rx_bps == 0 &&
+			stats.tx_bps == 0,
+			"Statistics kept from the previous measurement");
+	TEST_ASSERT_SUCCESS(latency_loop(), "Cannot loop packets");
+	TEST_ASSERT_SUCCESS(rte_latencystats_get(latency_port, &stats),
+			"Cannot get statistics");
+	TEST_ASSERT(stats.samples != 0, "No samples after enabling again");
+	TEST_ASSERT_SUCCESS(rte_latencystats_disable(latency_port),
+			"Cannot disable measurement");
+
+	return 0;
+}
+
+static struct test_command latencystats_cmd = {
+	.command = "latencystats_autotest",
+	.callback = test_latencystats,
+};
+REGISTER_TEST_COMMAND(latencystats_cmd);
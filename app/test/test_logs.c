@@ -58,6 +58,64 @@
  * - Send logs with different types and levels, some should not be displayed.
  */
 
+/*
+ * Asynchronous logs and rate limiting
+ * ===================================
+ *
+ * - Send a log through the log thread, and check it is queued.
+ * - Limit the rate of a log type, and check the messages above the limit
+ *   are dropped.
+ */
+
+static int
+test_logs_async(void)
+{
+	struct rte_log_stats pre, post;
+	int i;
+
+	rte_log_get_stats(&pre);
+	if (rte_log_set_async(1) < 0) {
+		printf("Cannot enable asynchronous logs\n");
+		return -1;
+	}
+	RTE_LOG(INFO, TESTAPP1, "this is an asynchronous message\n");
+	if (rte_log_set_async(0) < 0) {
+		printf("Cannot disable asynchronous logs\n");
+		return -1;
+	}
+	rte_log_get_stats(&post);
+	if (post.queued != pre.queued + 1) {
+		printf("Asynchronous message not queued\n");
+		return -1;
+	}
+
+	if (rte_log_set_rate_limit(RTE_LOGTYPE_TESTAPP1, 0, 1, 1) == 0 ||
+			rte_log_set_rate_limit(RTE_LOGTYPE_TESTAPP1,
+				RTE_LOG_INFO, 1, 0) == 0) {
+		printf("Invalid rate limit accepted\n");
+		return -1;
+	}
+	/* 2 messages per minute */
+	if (rte_log_set_rate_limit(RTE_LOGTYPE_TESTAPP1, RTE_LOG_INFO,
+			2, 60000) < 0) {
+		printf("Cannot set rate limit\n");
+		return -1;
+	}
+	pre = post;
+	for (i = 0; i < 5; i++)
+		RTE_LOG(INFO, TESTAPP1, "rate limited message %d\n", i);
+	/* other levels are not limited */
+	RTE_LOG(WARNING, TESTAPP1, "this is a warning level message\n");
+	rte_log_set_rate_limit(RTE_LOGTYPE_TESTAPP1, RTE_LOG_INFO, 0, 0);
+	rte_log_get_stats(&post);
+	if (post.rate_limited != pre.rate_limited + 3) {
+		printf("Rate limited messages not dropped\n");
+		return -1;
+	}
+
+	return 0;
+}
+
 static int
 test_logs(void)
 {
@@ -87,7 +145,7 @@ test_logs(void)
 
 	rte_log_dump_history(stdout);
 
-	return 0;
+	return test_logs_async();
 }
 
 static struct test_command logs_cmd = {
@@ -33,6 +33,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
@@ -51,6 +52,7 @@
 #include <rte_cycles.h>
 #include <rte_random.h>
 #include <rte_string_fns.h>
+#include <rte_atomic.h>
 
 #include "test.h"
 
@@ -321,7 +323,12 @@ test_multi_alloc_statistics(void)
 		return -1;
 	}
 	/* Check two consecutive allocations */
+#ifdef RTE_MALLOC_LCORE_CACHE
+	/* bypass the lcore cache, which allocates from the heap in bulk */
+	size = RTE_MALLOC_LCORE_CACHE_MAX_OBJ_SIZE * 2;
+#else
 	size = 1024;
+#endif
 	align = 0;
 	rte_malloc_get_socket_stats(socket,&pre_stats);
 	void *p2 = rte_malloc_socket("add", size ,align, socket);
@@ -384,6 +391,96 @@ test_multi_alloc_statistics(void)
 	return 0;
 }
 
+static int
+test_type_statistics(void)
+{
+#ifdef RTE_MALLOC_TYPE_STATS
+	const char *typename = "type_stats_test";
+	struct rte_malloc_type_stats type_stats[RTE_MALLOC_MAX_TYPES];
+	struct rte_malloc_type_stats *pre = NULL, *post = NULL;
+	size_t size = 3 * RTE_CACHE_LINE_SIZE, bytes = size;
+	uint64_t pre_count, pre_bytes;
+	unsigned i;
+	int n;
+	void *p;
+
+#ifdef RTE_MALLOC_LCORE_CACHE
+	/* the lcore cache serves whole blocks of a power of 2 size class */
+	if (size <= RTE_MALLOC_LCORE_CACHE_MAX_OBJ_SIZE)
+		bytes = rte_align32pow2(size);
+#endif
+
+	/* register the type with a first allocation */
+	p = rte_malloc(typename, size, 0);
+	if (p == NULL)
+		return -1;
+	rte_free(p);
+
+	n = rte_malloc_get_type_stats(type_stats, RTE_DIM(type_stats));
+	for (i = 0; i < (unsigned)n && i < RTE_DIM(type_stats); i++)
+		if (strcmp(type_stats[i].name, typename) == 0)
+			pre = &type_stats[i];
+	if (pre == NULL) {
+		printf("Type %s not found in type statistics\n", typename);
+		return -1;
+	}
+	if (pre->alloc_count != pre->free_count || pre->alloc_bytes != 0) {
+		printf("Incorrect type statistics after free\n");
+		return -1;
+	}
+	pre_count = pre->alloc_count;
+	pre_bytes = pre->alloc_bytes;
+
+	p = rte_malloc(typename, size, 0);
+	if (p == NULL)
+		return -1;
+	n = rte_malloc_get_type_stats(type_stats, RTE_DIM(type_stats));
+	for (i = 0; i < (unsigned)n && i < RTE_DIM(type_stats); i++)
+		if (strcmp(type_stats[i].name, typename) == 0)
+			post = &type_stats[i];
+	rte_free(p);
+	if (post == NULL || post->alloc_count != pre_count + 1 ||
+			post->alloc_bytes != pre_bytes + bytes) {
+		printf("Incorrect type statistics after alloc\n");
+		return -1;
+	}
+#endif
+
+	return 0;
+}
+
+static int
+test_frag_statistics(void)
+{
+	struct rte_malloc_socket_stats sock_stats;
+	struct rte_malloc_socket_frag_stats frag_stats;
+	size_t hist_bytes = 0;
+	unsigned i, hist_count = 0;
+
+	/* the histogram must account for every free block */
+	if (rte_malloc_get_socket_stats(0, &sock_stats) < 0 ||
+			rte_malloc_get_socket_frag_stats(0, &frag_stats) < 0)
+		return -1;
+	for (i = 0; i < RTE_MALLOC_FREE_HIST_SIZE; i++) {
+		hist_count += frag_stats.free_hist[i];
+		hist_bytes += frag_stats.free_hist_bytes[i];
+	}
+	if (hist_count != frag_stats.free_count ||
+			hist_bytes != frag_stats.heap_freesz_bytes ||
+			frag_stats.greatest_free_size !=
+				sock_stats.greatest_free_size) {
+		printf("Incorrect heap fragmentation statistics\n");
+		return -1;
+	}
+	if (rte_malloc_get_socket_frag_stats(RTE_MAX_NUMA_NODES,
+			&frag_stats) == 0) {
+		printf("Fragmentation statistics of invalid socket\n");
+		return -1;
+	}
+
+	return 0;
+}
+
 static int
 test_rte_malloc_type_limits(void)
 {
@@ -956,6 +1053,22 @@ test_malloc(void)
 	else
 		printf("test_multi_alloc_statistics() passed\n");
 
+	ret = test_type_statistics();
+	if (ret < 0) {
+		printf("test_type_statistics() failed\n");
+		return ret;
+	}
+	else
+		printf("test_type_statistics() passed\n");
+
+	ret = test_frag_statistics();
+	if (ret < 0) {
+		printf("test_frag_statistics() failed\n");
+		return ret;
+	}
+	else
+		printf("test_frag_statistics() passed\n");
+
 	return 0;
 }
 
@@ -964,3 +1077,109 @@ static struct test_command malloc_cmd = {
 	.callback = test_malloc,
 };
 REGISTER_TEST_COMMAND(malloc_cmd);
+
+/*
+ * Malloc performance
+ * ==================
+ *
+ * All the lcores allocate bursts of MALLOC_PERF_BURST blocks of the same
+ * size and free them, at the same time, so that they contend on the heap
+ * of their socket. The result shows the cost of the lcore cache when
+ * CONFIG_RTE_MALLOC_LCORE_CACHE is enabled.
+ */
+
+#define MALLOC_PERF_BURST 32
+#define MALLOC_PERF_ITER 10000
+
+static rte_atomic32_t malloc_perf_synchro;
+static uint64_t malloc_perf_cycles[RTE_MAX_LCORE];
+static size_t malloc_perf_size;
+
+static int
+malloc_perf_per_lcore(__attribute__((unused)) void *arg)
+{
+	void *objs[MALLOC_PERF_BURST];
+	unsigned lcore_id = rte_lcore_id();
+	uint64_t start;
+	unsigned i, j;
+
+	/* wait for the master lcore to start all at once */
+	while (rte_atomic32_read(&malloc_perf_synchro) == 0)
+		rte_pause();
+
+	start = rte_rdtsc();
+	for (i = 0; i < MALLOC_PERF_ITER; i++) {
+		for (j = 0; j < MALLOC_PERF_BURST; j++) {
+			objs[j] = rte_malloc(NULL, malloc_perf_size, 0);
+			if (objs[j] == NULL) {
+				while (j-- > 0)
+					rte_free(objs[j]);
+				return -1;
+			}
+		}
+		for (j = 0; j < MALLOC_PERF_BURST; j++)
+			rte_free(objs[j]);
+	}
+	malloc_perf_cycles[lcore_id] = rte_rdtsc() - start;
+
+	rte_malloc_lcore_cache_flush();
+	return 0;
+}
+
+static int
+test_malloc_perf(void)
+{
+	static const size_t sizes[] = { 64, 256, 1024, 4096 };
+	const uint64_t hz = rte_get_timer_hz();
+	uint64_t total, max;
+	unsigned lcore_id, i, n_ops;
+	int ret = 0;
+
+#ifdef RTE_MALLOC_LCORE_CACHE
+	printf("lcore cache enabled\n");
+#else
+	printf("lcore cache disabled\n");
+#endif
+	n_ops = rte_lcore_count() * MALLOC_PERF_ITER * MALLOC_PERF_BURST;
+
+	for (i = 0; i < RTE_DIM(sizes); i++) {
+		malloc_perf_size = sizes[i];
+		memset(malloc_perf_cycles, 0, sizeof(malloc_perf_cycles));
+		rte_atomic32_set(&malloc_perf_synchro, 0);
+
+		rte_eal_mp_remote_launch(malloc_perf_per_lcore, NULL,
+				SKIP_MASTER);
+		rte_atomic32_set(&malloc_perf_synchro, 1);
+		if (malloc_perf_per_lcore(NULL) < 0)
+			ret = -1;
+		RTE_LCORE_FOREACH_SLAVE(lcore_id) {
+			if (rte_eal_wait_lcore(lcore_id) < 0)
+				ret = -1;
+		}
+		if (ret < 0) {
+			printf("Cannot allocate %zu bytes blocks\n",
+					malloc_perf_size);
+			return -1;
+		}
+
+		total = 0;
+		max = 0;
+		RTE_LCORE_FOREACH(lcore_id) {
+			total += malloc_perf_cycles[lcore_id];
+			if (malloc_perf_cycles[lcore_id] > max)
+				max = malloc_perf_cycles[lcore_id];
+		}
+		printf("size %4zu, %u lcores: %"PRIu64" cycles per "
+				"alloc/free, %.2f Mops/s\n", malloc_perf_size,
+				rte_lcore_count(), total / n_ops,
+				(double)n_ops * hz / max / 1000000);
+	}
+
+	return 0;
+}
+
+static struct test_command malloc_perf_cmd = {
+	.command = "malloc_perf_autotest",
+	.callback = test_malloc_perf,
+};
+REGISTER_TEST_COMMAND(malloc_perf_cmd);
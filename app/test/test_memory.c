@@ -33,11 +33,21 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include <rte_memory.h>
+#include <rte_memzone.h>
+#include <rte_malloc.h>
 #include <rte_common.h>
+#include <rte_cycles.h>
+#include <rte_debug.h>
 
 #include "test.h"
+#include "process.h"
 
 /*
  * Memory
@@ -49,7 +59,306 @@
  * - Check that memory size is different than 0.
  *
  * - Try to read all memory; it should not segfault.
+ *
+ * - Check the registration of memory event callbacks.
+ *
+ * - Start a primary process with --mem-hotplug and a secondary process.
+ *   The primary grows its heap by reserving a memzone which does not fit
+ *   in it, then shrinks it back by freeing the memzone. The secondary
+ *   checks that it maps and unmaps the new memory, with a single memory
+ *   event each time.
+ */
+
+static void
+test_mem_event_cb(enum rte_mem_event event __rte_unused,
+		const struct rte_memseg *ms __rte_unused, void *arg __rte_unused)
+{
+}
+
+static int
+test_mem_event_callbacks(void)
+{
+	int arg;
+
+	if (rte_mem_event_callback_register(NULL, NULL) != -EINVAL) {
+		printf("NULL memory event callback registered\n");
+		return -1;
+	}
+	if (rte_mem_event_callback_register(test_mem_event_cb, NULL) != 0 ||
+			rte_mem_event_callback_register(test_mem_event_cb,
+				&arg) != 0) {
+		printf("Cannot register memory event callbacks\n");
+		return -1;
+	}
+	if (rte_mem_event_callback_register(test_mem_event_cb, &arg) !=
+			-EEXIST) {
+		printf("Memory event callback registered twice\n");
+		return -1;
+	}
+	if (rte_mem_event_callback_unregister(test_mem_event_cb, NULL) != 0 ||
+			rte_mem_event_callback_unregister(test_mem_event_cb,
+				&arg) != 0) {
+		printf("Cannot unregister memory event callbacks\n");
+		return -1;
+	}
+	if (rte_mem_event_callback_unregister(test_mem_event_cb, &arg) !=
+			-ENOENT) {
+		printf("Memory event callback unregistered twice\n");
+		return -1;
+	}
+
+	/* nothing to catch up with without memory hotplug */
+	if (rte_mem_sync() != 0) {
+		printf("rte_mem_sync() failed\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+#ifdef RTE_EXEC_ENV_LINUXAPP
+
+#define MEM_HOTPLUG_PREFIX "--file-prefix=mem_hotplug"
+#define MEM_HOTPLUG_CTL "mem_hotplug_ctl"
+#define MEM_HOTPLUG_MZ "mem_hotplug"
+/* within a hugepage, as the pages of a memseg must be contiguous */
+#define MEM_HOTPLUG_MZ_LEN (1 << 20)
+#define MEM_HOTPLUG_MAX_FILL 16
+#define MEM_HOTPLUG_BYTE 0xa5
+#define MEM_HOTPLUG_TIMEOUT_MS 10000
+
+/* steps of the test, in the control memzone */
+enum {
+	MEM_HOTPLUG_START,
+	MEM_HOTPLUG_SECONDARY_READY,
+	MEM_HOTPLUG_GROWN,
+	MEM_HOTPLUG_GROWN_SEEN,
+	MEM_HOTPLUG_SHRUNK,
+	MEM_HOTPLUG_SHRUNK_SEEN,
+	MEM_HOTPLUG_REGROWN,
+	MEM_HOTPLUG_FREED,
+};
+
+static unsigned mem_hotplug_nb_add, mem_hotplug_nb_del;
+
+static void
+test_mem_hotplug_cb(enum rte_mem_event event,
+		const struct rte_memseg *ms __rte_unused, void *arg __rte_unused)
+{
+	if (event == RTE_MEM_EVENT_ADD)
+		mem_hotplug_nb_add++;
+	else
+		mem_hotplug_nb_del++;
+}
+
+/* wait for the other process to reach a step */
+static int
+test_mem_hotplug_wait(const struct rte_memzone *ctl, uint32_t step)
+{
+	unsigned ms;
+
+	for (ms = 0; ms < MEM_HOTPLUG_TIMEOUT_MS; ms++) {
+		if (*(volatile uint32_t *)ctl->addr == step)
+			return 0;
+		rte_delay_ms(1);
+	}
+	printf("Timeout waiting for step %u of memory hotplug\n", step);
+	return -1;
+}
+
+static void
+test_mem_hotplug_step(const struct rte_memzone *ctl, uint32_t step)
+{
+	rte_wmb();
+	*(volatile uint32_t *)ctl->addr = step;
+}
+
+/* the secondary process, following the changes of the primary */
+int
+test_mem_hotplug_secondary(void)
+{
+	const struct rte_memzone *ctl, *mz;
+	const uint8_t *addr;
+
+	ctl = rte_memzone_lookup(MEM_HOTPLUG_CTL);
+	if (ctl == NULL) {
+		printf("Cannot find the control memzone\n");
+		return -1;
+	}
+	if (rte_mem_event_callback_register(test_mem_hotplug_cb, NULL) != 0)
+		return -1;
+	test_mem_hotplug_step(ctl, MEM_HOTPLUG_SECONDARY_READY);
+
+	if (test_mem_hotplug_wait(ctl, MEM_HOTPLUG_GROWN) < 0)
+		return -1;
+	mz = rte_memzone_lookup(MEM_HOTPLUG_MZ);
+	if (mz == NULL) {
+		printf("Cannot find the memzone of the grown heap\n");
+		return -1;
+	}
+	addr = mz->addr;
+	if (addr[0] != MEM_HOTPLUG_BYTE ||
+			addr[mz->len - 1] != MEM_HOTPLUG_BYTE) {
+		printf("Bad content of the grown heap\n");
+		return -1;
+	}
+	if (rte_mem_sync() != 0 || mem_hotplug_nb_add != 1 ||
+			mem_hotplug_nb_del != 0) {
+		printf("%u add and %u del events instead of 1 and 0\n",
+			mem_hotplug_nb_add, mem_hotplug_nb_del);
+		return -1;
+	}
+	test_mem_hotplug_step(ctl, MEM_HOTPLUG_GROWN_SEEN);
+
+	if (test_mem_hotplug_wait(ctl, MEM_HOTPLUG_SHRUNK) < 0)
+		return -1;
+	if (rte_mem_sync() != 0 || rte_mem_sync() != 0 ||
+			mem_hotplug_nb_add != 1 || mem_hotplug_nb_del != 1) {
+		printf("%u add and %u del events instead of 1 and 1\n",
+			mem_hotplug_nb_add, mem_hotplug_nb_del);
+		return -1;
+	}
+	if (rte_memzone_lookup(MEM_HOTPLUG_MZ) != NULL) {
+		printf("Memzone of the shrunk heap still found\n");
+		return -1;
+	}
+	test_mem_hotplug_step(ctl, MEM_HOTPLUG_SHRUNK_SEEN);
+
+	/* memory hot-plugged by the primary, released by this process */
+	if (test_mem_hotplug_wait(ctl, MEM_HOTPLUG_REGROWN) < 0)
+		return -1;
+	mz = rte_memzone_lookup(MEM_HOTPLUG_MZ);
+	if (mz == NULL || rte_memzone_free(mz) != 0) {
+		printf("Cannot free the memzone of the grown heap\n");
+		return -1;
+	}
+	if (mem_hotplug_nb_add != 2 || mem_hotplug_nb_del != 2) {
+		printf("%u add and %u del events instead of 2 and 2\n",
+			mem_hotplug_nb_add, mem_hotplug_nb_del);
+		return -1;
+	}
+	test_mem_hotplug_step(ctl, MEM_HOTPLUG_FREED);
+
+	return 0;
+}
+
+/*
+ * The primary process, started with --mem-hotplug. The secondary process
+ * is started from a child process, so that both run at the same time.
  */
+int
+test_mem_hotplug_primary(void)
+{
+	const char *argv[] = { prgname, "-c", "1", "-n", "2",
+		"--proc-type=secondary", MEM_HOTPLUG_PREFIX };
+	const struct rte_memzone *ctl, *mz, *fill[MEM_HOTPLUG_MAX_FILL];
+	struct rte_malloc_socket_stats stats;
+	char name[RTE_MEMZONE_NAMESIZE];
+	unsigned nb_fill = 0, nb_del;
+	uint64_t size;
+	pid_t pid;
+	int status, ret = -1;
+
+	ctl = rte_memzone_reserve(MEM_HOTPLUG_CTL, sizeof(uint32_t),
+		SOCKET_ID_ANY, 0);
+	if (ctl == NULL) {
+		printf("Cannot reserve the control memzone\n");
+		return -1;
+	}
+	test_mem_hotplug_step(ctl, MEM_HOTPLUG_START);
+	if (rte_mem_event_callback_register(test_mem_hotplug_cb, NULL) != 0)
+		return -1;
+
+	/* fill the heap, so that the memzone does not fit in it */
+	while (rte_malloc_get_socket_stats(rte_socket_id(), &stats) == 0 &&
+			stats.greatest_free_size >= MEM_HOTPLUG_MZ_LEN / 2 &&
+			nb_fill < MEM_HOTPLUG_MAX_FILL) {
+		snprintf(name, sizeof(name), "mem_hotplug_fill%u", nb_fill);
+		fill[nb_fill] = rte_memzone_reserve(name, 0, rte_socket_id(),
+			0);
+		if (fill[nb_fill] == NULL)
+			break;
+		nb_fill++;
+	}
+	size = rte_eal_get_physmem_size();
+
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (pid == 0)
+		_exit(process_dup(argv, RTE_DIM(argv),
+			"test_mem_hotplug_secondary") != 0);
+
+	if (test_mem_hotplug_wait(ctl, MEM_HOTPLUG_SECONDARY_READY) < 0)
+		goto out;
+	mz = rte_memzone_reserve(MEM_HOTPLUG_MZ, MEM_HOTPLUG_MZ_LEN,
+		rte_socket_id(), 0);
+	if (mz == NULL || rte_eal_get_physmem_size() <= size) {
+		printf("Heap not grown\n");
+		goto out;
+	}
+	memset(mz->addr, MEM_HOTPLUG_BYTE, mz->len);
+	test_mem_hotplug_step(ctl, MEM_HOTPLUG_GROWN);
+
+	if (test_mem_hotplug_wait(ctl, MEM_HOTPLUG_GROWN_SEEN) < 0)
+		goto out;
+	if (rte_memzone_free(mz) != 0 || rte_eal_get_physmem_size() != size) {
+		printf("Heap not shrunk\n");
+		goto out;
+	}
+	test_mem_hotplug_step(ctl, MEM_HOTPLUG_SHRUNK);
+
+	if (test_mem_hotplug_wait(ctl, MEM_HOTPLUG_SHRUNK_SEEN) < 0)
+		goto out;
+	mz = rte_memzone_reserve(MEM_HOTPLUG_MZ, MEM_HOTPLUG_MZ_LEN,
+		rte_socket_id(), 0);
+	if (mz == NULL) {
+		printf("Heap not grown again\n");
+		goto out;
+	}
+	test_mem_hotplug_step(ctl, MEM_HOTPLUG_REGROWN);
+
+	if (test_mem_hotplug_wait(ctl, MEM_HOTPLUG_FREED) < 0)
+		goto out;
+	if (rte_eal_get_physmem_size() != size) {
+		printf("Heap not shrunk by the secondary process\n");
+		goto out;
+	}
+	/* the memseg is unmapped here when catching up */
+	nb_del = mem_hotplug_nb_del;
+	if (rte_mem_sync() != 0 || mem_hotplug_nb_del != nb_del + 1) {
+		printf("Memseg released by the secondary process not "
+			"seen\n");
+		goto out;
+	}
+	ret = 0;
+
+out:
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+			WEXITSTATUS(status) != 0) {
+		printf("Secondary process failed\n");
+		ret = -1;
+	}
+	while (nb_fill != 0)
+		rte_memzone_free(fill[--nb_fill]);
+	rte_mem_event_callback_unregister(test_mem_hotplug_cb, NULL);
+	return ret;
+}
+
+static int
+test_mem_hotplug(void)
+{
+	const char *argv[] = { prgname, "-c", "1", "-n", "2", "-m", "32",
+		"--mem-hotplug", MEM_HOTPLUG_PREFIX };
+
+	if (process_dup(argv, RTE_DIM(argv), "test_mem_hotplug") != 0) {
+		printf("Memory hotplug test failed\n");
+		return -1;
+	}
+	return 0;
+}
+
+#endif /* RTE_EXEC_ENV_LINUXAPP */
 
 static int
 test_memory(void)
@@ -83,6 +392,14 @@ test_memory(void)
 		}
 	}
 
+	if (test_mem_event_callbacks() < 0)
+		return -1;
+
+#ifdef RTE_EXEC_ENV_LINUXAPP
+	if (test_mem_hotplug() < 0)
+		return -1;
+#endif
+
 	return 0;
 }
 
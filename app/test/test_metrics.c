@@ -0,0 +1,226 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <rte_common.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_memory.h>
+#include <rte_metrics.h>
+
+#include "test.h"
+
+/*
+ * Metrics
+ * =======
+ *
+ * - Register metrics, check invalid and duplicate names.
+ *
+ * - Add to a counter from all lcores, check the sum of the per-lcore
+ *   copies.
+ *
+ * - Get a JSON and a binary snapshot from the metrics server socket.
+ */
+
+#define METRICS_ADDS 10000
+#define METRICS_SNAPSHOT_MAX 65536
+
+static int counter_key;
+
+static int
+metrics_add_loop(__attribute__((unused)) void *arg)
+{
+	unsigned i;
+
+	for (i = 0; i < METRICS_ADDS; i++)
+		rte_metrics_add(counter_key, 1);
+	return 0;
+}
+
+static uint64_t
+metrics_value(int key)
+{
+	struct rte_metric_value values[RTE_METRICS_MAX_METRICS];
+	int nb;
+
+	nb = rte_metrics_get_values(values, RTE_METRICS_MAX_METRICS);
+	if (nb <= key)
+		return UINT64_MAX;
+	return values[key].value;
+}
+
+/* get a snapshot from the server, return its size */
+static int
+metrics_request(const char *path, const char *req, char *buf, size_t size)
+{
+	struct sockaddr_un addr;
+	size_t len = 0;
+	ssize_t n;
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+			write(fd, req, strlen(req)) < 0) {
+		close(fd);
+		return -1;
+	}
+	while (len < size - 1) {
+		n = read(fd, buf + len, size - 1 - len);
+		if (n <= 0)
+			break;
+		len += n;
+	}
+	buf[len] = '\0';
+	close(fd);
+	return len;
+}
+
+static int
+test_metrics_server(const char *counter_name, uint64_t counter,
+		const char *gauge_json)
+{
+	static char buf[METRICS_SNAPSHOT_MAX];
+	const struct rte_metrics_snapshot_hdr *hdr = (const void *)buf;
+	const struct rte_metric_name *names;
+	const uint64_t *values;
+	char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+	char expected[RTE_METRICS_NAME_SIZE + 32];
+	int len, i;
+
+	snprintf(path, sizeof(path), "/tmp/dpdk_test_metrics.%d", getpid());
+	TEST_ASSERT_SUCCESS(rte_metrics_server_start(path),
+			"Cannot start metrics server");
+	TEST_ASSERT_EQUAL(rte_metrics_server_start(path), -EALREADY,
+			"Metrics server started twice");
+
+	len = metrics_request(path, "json\n", buf, sizeof(buf));
+	TEST_ASSERT(len > 0, "No JSON snapshot");
+	snprintf(expected, sizeof(expected), "\"%s\":%"PRIu64, counter_name,
+			counter);
+	TEST_ASSERT(strncmp(buf, "{\"metrics\":{", 12) == 0 &&
+			strstr(buf, expected) != NULL,
+			"Wrong JSON snapshot: %s", buf);
+	TEST_ASSERT(strstr(buf, gauge_json) != NULL,
+			"Metric name not escaped in JSON snapshot: %s", buf);
+
+	len = metrics_request(path, "binary\n", buf, sizeof(buf));
+	TEST_ASSERT(len >= (int)sizeof(*hdr), "No binary snapshot");
+	TEST_ASSERT(hdr->magic == RTE_METRICS_SNAPSHOT_MAGIC &&
+			hdr->version == RTE_METRICS_SNAPSHOT_VERSION,
+			"Wrong binary snapshot header");
+	TEST_ASSERT_EQUAL(len, (int)(sizeof(*hdr) + hdr->nb_metrics *
+			(sizeof(*names) + sizeof(*values))),
+			"Wrong binary snapshot size");
+	names = (const void *)&hdr[1];
+	values = (const void *)&names[hdr->nb_metrics];
+	for (i = 0; i < hdr->nb_metrics; i++)
+		if (strcmp(names[i].name, counter_name) == 0)
+			break;
+	TEST_ASSERT(i < hdr->nb_metrics && values[i] == counter,
+			"Counter not in binary snapshot");
+
+	rte_metrics_server_stop();
+	TEST_ASSERT(access(path, F_OK) != 0, "Socket not removed");
+
+	return 0;
+}
+
+static int
+test_metrics(void)
+{
+	static unsigned run;
+	char counter_name[RTE_METRICS_NAME_SIZE];
+	char gauge_name[RTE_METRICS_NAME_SIZE];
+	char gauge_json[RTE_METRICS_NAME_SIZE * 2];
+	const char *names[2] = { counter_name, gauge_name };
+	char long_name[RTE_METRICS_NAME_SIZE + 1];
+	uint64_t expected;
+	int gauge_key;
+
+	TEST_ASSERT_SUCCESS(rte_metrics_init(rte_socket_id()),
+			"Cannot init metrics");
+
+	/* metrics cannot be unregistered, use new names on each run */
+	snprintf(counter_name, sizeof(counter_name), "test_counter_%u", run);
+	/* '"' and '\\' are escaped in the JSON snapshot */
+	snprintf(gauge_name, sizeof(gauge_name), "test_\"gauge\\%u", run);
+	snprintf(gauge_json, sizeof(gauge_json), "\"test_\\\"gauge\\\\%u\":7",
+			run);
+	run++;
+
+	counter_key = rte_metrics_reg_names(names, 2);
+	TEST_ASSERT(counter_key >= 0, "Cannot register metrics");
+	gauge_key = counter_key + 1;
+	TEST_ASSERT_EQUAL(rte_metrics_reg_name(counter_name), -EEXIST,
+			"Duplicate metric registered");
+	TEST_ASSERT_EQUAL(rte_metrics_reg_name("bad\tname"), -EINVAL,
+			"Invalid metric name registered");
+	memset(long_name, 'a', sizeof(long_name) - 1);
+	long_name[sizeof(long_name) - 1] = '\0';
+	TEST_ASSERT_EQUAL(rte_metrics_reg_name(long_name), -EINVAL,
+			"Too long metric name registered");
+	TEST_ASSERT_EQUAL(metrics_value(counter_key), 0,
+			"Metric not initialized to 0");
+
+	/* per-lcore counters */
+	rte_eal_mp_remote_launch(metrics_add_loop, NULL, CALL_MASTER);
+	rte_eal_mp_wait_lcore();
+	expected = (uint64_t)METRICS_ADDS * rte_lcore_count();
+	TEST_ASSERT_EQUAL(metrics_value(counter_key), expected,
+			"Wrong counter value %"PRIu64", expected %"PRIu64,
+			metrics_value(counter_key), expected);
+
+	rte_metrics_set(gauge_key, 42);
+	rte_metrics_set(gauge_key, 7);
+	TEST_ASSERT_EQUAL(metrics_value(gauge_key), 7, "Wrong gauge value");
+
+	return test_metrics_server(counter_name, expected, gauge_json);
+}
+
+static struct test_command metrics_cmd = {
+	.command = "metrics_autotest",
+	.callback = test_metrics,
+};
+REGISTER_TEST_COMMAND(metrics_cmd);
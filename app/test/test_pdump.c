@@ -0,0 +1,324 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <rte_common.h>
+#include <rte_byteorder.h>
+#include <rte_ethdev.h>
+#include <rte_eth_ring.h>
+#include <rte_ether.h>
+#include <rte_mbuf.h>
+#include <rte_mempool.h>
+#include <rte_ring.h>
+#include <rte_pdump.h>
+
+#include "test.h"
+
+/*
+ * Packet capture
+ * ==============
+ *
+ * - Validate BPF programs, check that invalid ones are rejected.
+ *
+ * - Run the BPF program of the "ip" pcap-filter expression on IPv4 and ARP
+ *   packets, and on a packet too short for its loads.
+ *
+ * - Capture the packets received by a ring port: check the filter, the
+ *   snap length, the reference mode and the enable and disable errors.
+ */
+
+#define PDUMP_RING_SIZE 256
+#define PDUMP_NB_MBUF 511
+#define PDUMP_PKT_LEN 100
+#define PDUMP_SNAPLEN 64
+#define PDUMP_NB_PKTS 4
+
+/* tcpdump -d ip */
+static const struct rte_pdump_bpf_insn bpf_ip[] = {
+	{ 0x28, 0, 0, 12 },        /* ldh [12] */
+	{ 0x15, 0, 1, 0x0800 },    /* jeq #0x800, L2, L3 */
+	{ 0x06, 0, 0, 262144 },    /* L2: ret #262144 */
+	{ 0x06, 0, 0, 0 },         /* L3: ret #0 */
+};
+
+static int pdump_port = -1;
+static struct rte_mempool *pdump_mp;
+
+static int
+test_pdump_bpf(void)
+{
+	/* no final return */
+	static const struct rte_pdump_bpf_insn no_ret[] = {
+		{ 0x28, 0, 0, 12 },        /* ldh [12] */
+	};
+	/* jump beyond the end */
+	static const struct rte_pdump_bpf_insn bad_jump[] = {
+		{ 0x15, 0, 5, 0x0800 },    /* jeq #0x800, L1, L6 */
+		{ 0x06, 0, 0, 0 },         /* L1: ret #0 */
+	};
+	/* division by 0 */
+	static const struct rte_pdump_bpf_insn div_zero[] = {
+		{ 0x34, 0, 0, 0 },         /* div #0 */
+		{ 0x06, 0, 0, 0 },         /* ret #0 */
+	};
+	/* scratch memory out of bounds */
+	static const struct rte_pdump_bpf_insn bad_mem[] = {
+		{ 0x02, 0, 0, 16 },        /* st M[16] */
+		{ 0x06, 0, 0, 0 },         /* ret #0 */
+	};
+	/* unknown opcode */
+	static const struct rte_pdump_bpf_insn bad_code[] = {
+		{ 0xff, 0, 0, 0 },
+		{ 0x06, 0, 0, 0 },         /* ret #0 */
+	};
+	uint8_t pkt[PDUMP_PKT_LEN];
+	struct ether_hdr *eth = (struct ether_hdr *)pkt;
+
+	TEST_ASSERT_SUCCESS(rte_pdump_bpf_validate(bpf_ip,
+			RTE_DIM(bpf_ip)), "Valid program rejected");
+	TEST_ASSERT_EQUAL(rte_pdump_bpf_validate(bpf_ip, 0), -EINVAL,
+			"Empty program accepted");
+	TEST_ASSERT_EQUAL(rte_pdump_bpf_validate(no_ret, RTE_DIM(no_ret)),
+			-EINVAL, "Program without return accepted");
+	TEST_ASSERT_EQUAL(rte_pdump_bpf_validate(bad_jump,
+			RTE_DIM(bad_jump)), -EINVAL,
+			"Program jumping beyond its end accepted");
+	TEST_ASSERT_EQUAL(rte_pdump_bpf_validate(div_zero,
+			RTE_DIM(div_zero)), -EINVAL,
+			"Program dividing by 0 accepted");
+	TEST_ASSERT_EQUAL(rte_pdump_bpf_validate(bad_mem, RTE_DIM(bad_mem)),
+			-EINVAL, "Program storing out of bounds accepted");
+	TEST_ASSERT_EQUAL(rte_pdump_bpf_validate(bad_code,
+			RTE_DIM(bad_code)), -EINVAL,
+			"Program with unknown opcode accepted");
+
+	memset(pkt, 0, sizeof(pkt));
+	eth->ether_type = rte_cpu_to_be_16(ETHER_TYPE_IPv4);
+	TEST_ASSERT_EQUAL(rte_pdump_bpf_filter(bpf_ip, pkt, sizeof(pkt),
+			sizeof(pkt)), 262144, "IPv4 packet not matched");
+	TEST_ASSERT_EQUAL(rte_pdump_bpf_filter(bpf_ip, pkt, sizeof(pkt), 13),
+			0, "Load beyond the packet data not rejected");
+	eth->ether_type = rte_cpu_to_be_16(ETHER_TYPE_ARP);
+	TEST_ASSERT_EQUAL(rte_pdump_bpf_filter(bpf_ip, pkt, sizeof(pkt),
+			sizeof(pkt)), 0, "ARP packet matched");
+
+	return 0;
+}
+
+static int
+pdump_port_setup(void)
+{
+	static const struct rte_eth_conf null_conf;
+	struct rte_ring *r;
+
+	if (pdump_port >= 0)
+		return 0;
+
+	pdump_mp = rte_pktmbuf_pool_create("test_pdump_pool", PDUMP_NB_MBUF,
+			32, 0, RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+	r = rte_ring_create("test_pdump_port", PDUMP_RING_SIZE,
+			rte_socket_id(), 0);
+	if (pdump_mp == NULL || r == NULL)
+		return -1;
+
+	pdump_port = rte_eth_from_ring(r);
+	if (pdump_port < 0 ||
+			rte_eth_dev_configure(pdump_port, 1, 1, &null_conf) < 0 ||
+			rte_eth_tx_queue_setup(pdump_port, 0, PDUMP_RING_SIZE,
+				rte_socket_id(), NULL) < 0 ||
+			rte_eth_rx_queue_setup(pdump_port, 0, PDUMP_RING_SIZE,
+				rte_socket_id(), NULL, pdump_mp) < 0 ||
+			rte_eth_dev_start(pdump_port) < 0) {
+		pdump_port = -1;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Send PDUMP_NB_PKTS packets through the port, alternately IPv4 and ARP,
+ * and receive them back.
+ */
+static int
+pdump_send_receive(void)
+{
+	struct rte_mbuf *pkts[PDUMP_NB_PKTS];
+	struct ether_hdr *eth;
+	unsigned i;
+	uint16_t nb;
+
+	for (i = 0; i < PDUMP_NB_PKTS; i++) {
+		pkts[i] = rte_pktmbuf_alloc(pdump_mp);
+		if (pkts[i] == NULL)
+			return -1;
+		eth = (struct ether_hdr *)rte_pktmbuf_append(pkts[i],
+				PDUMP_PKT_LEN);
+		memset(eth, i, PDUMP_PKT_LEN);
+		eth->ether_type = rte_cpu_to_be_16(i & 1 ?
+				ETHER_TYPE_ARP : ETHER_TYPE_IPv4);
+	}
+
+	nb = rte_eth_tx_burst(pdump_port, 0, pkts, PDUMP_NB_PKTS);
+	if (nb != PDUMP_NB_PKTS)
+		return -1;
+	nb = rte_eth_rx_burst(pdump_port, 0, pkts, PDUMP_NB_PKTS);
+	if (nb != PDUMP_NB_PKTS)
+		return -1;
+	for (i = 0; i < nb; i++)
+		rte_pktmbuf_free(pkts[i]);
+	return 0;
+}
+
+static int
+test_pdump_capture(void)
+{
+	struct rte_pdump_filter filter;
+	struct rte_ring *ring, *sp_ring;
+	struct rte_mbuf *m;
+	const uint8_t *data;
+	unsigned i;
+
+	TEST_ASSERT_SUCCESS(pdump_port_setup(), "Cannot create ring port");
+
+	ring = rte_ring_lookup("test_pdump_ring");
+	if (ring == NULL)
+		ring = rte_ring_create("test_pdump_ring", PDUMP_RING_SIZE,
+				rte_socket_id(), RING_F_SC_DEQ);
+	sp_ring = rte_ring_lookup("test_pdump_sp_ring");
+	if (sp_ring == NULL)
+		sp_ring = rte_ring_create("test_pdump_sp_ring",
+				PDUMP_RING_SIZE, rte_socket_id(),
+				RING_F_SP_ENQ | RING_F_SC_DEQ);
+	TEST_ASSERT(ring != NULL && sp_ring != NULL, "Cannot create rings");
+
+	memset(&filter, 0, sizeof(filter));
+	filter.snaplen = PDUMP_SNAPLEN;
+	filter.nb_insns = RTE_DIM(bpf_ip);
+	memcpy(filter.insns, bpf_ip, sizeof(bpf_ip));
+
+	/* invalid requests */
+	TEST_ASSERT_EQUAL(rte_pdump_enable(pdump_port, 0, RTE_PDUMP_FLAG_RX,
+			sp_ring, pdump_mp, &filter), -EINVAL,
+			"Single producer ring accepted");
+	TEST_ASSERT_EQUAL(rte_pdump_enable(pdump_port, 1, RTE_PDUMP_FLAG_RX,
+			ring, pdump_mp, &filter), -EINVAL,
+			"Invalid queue accepted");
+	TEST_ASSERT_EQUAL(rte_pdump_enable(pdump_port, 0, 0,
+			ring, pdump_mp, &filter), -EINVAL,
+			"Request without direction accepted");
+	TEST_ASSERT_EQUAL(rte_pdump_disable(pdump_port, RTE_PDUMP_ALL_QUEUES,
+			RTE_PDUMP_FLAG_RX), -ENOENT,
+			"Capture disabled before being enabled");
+
+	/* filtered and truncated copies */
+	TEST_ASSERT_SUCCESS(rte_pdump_enable(pdump_port, RTE_PDUMP_ALL_QUEUES,
+			RTE_PDUMP_FLAG_RX, ring, pdump_mp, &filter),
+			"Cannot enable capture");
+	TEST_ASSERT_EQUAL(rte_pdump_enable(pdump_port, 0, RTE_PDUMP_FLAG_RX,
+			ring, pdump_mp, &filter), -EEXIST,
+			"Capture enabled twice");
+	TEST_ASSERT_SUCCESS(pdump_send_receive(), "Cannot send packets");
+	TEST_ASSERT_EQUAL(rte_ring_count(ring), PDUMP_NB_PKTS / 2,
+			"Wrong number of captured packets: %u",
+			rte_ring_count(ring));
+	for (i = 0; i < PDUMP_NB_PKTS; i += 2) {
+		TEST_ASSERT_SUCCESS(rte_ring_dequeue(ring, (void **)&m),
+				"Cannot dequeue captured packet");
+		data = rte_pktmbuf_mtod(m, const uint8_t *);
+		TEST_ASSERT(m->pkt_len == PDUMP_SNAPLEN &&
+				m->data_len == PDUMP_SNAPLEN,
+				"Wrong captured length %u", m->pkt_len);
+		TEST_ASSERT(data[0] == i && data[PDUMP_SNAPLEN - 1] == i &&
+				!RTE_MBUF_INDIRECT(m),
+				"Wrong captured packet %u", i);
+		rte_pktmbuf_free(m);
+	}
+
+	/* the RX capture does not see the transmitted packets */
+	TEST_ASSERT_EQUAL(rte_pdump_disable(pdump_port, 0, RTE_PDUMP_FLAG_TX),
+			-ENOENT, "TX capture disabled before being enabled");
+	TEST_ASSERT_SUCCESS(rte_pdump_disable(pdump_port, 0,
+			RTE_PDUMP_FLAG_RX), "Cannot disable capture");
+	TEST_ASSERT_SUCCESS(pdump_send_receive(), "Cannot send packets");
+	TEST_ASSERT_EQUAL(rte_ring_count(ring), 0,
+			"Packets captured after disabling the capture");
+
+	/* references to the whole packets, received and transmitted */
+	TEST_ASSERT_SUCCESS(rte_pdump_enable(pdump_port, 0,
+			RTE_PDUMP_FLAG_RXTX | RTE_PDUMP_FLAG_REF, ring,
+			pdump_mp, NULL), "Cannot enable capture");
+	TEST_ASSERT_SUCCESS(pdump_send_receive(), "Cannot send packets");
+	TEST_ASSERT_EQUAL(rte_ring_count(ring), 2 * PDUMP_NB_PKTS,
+			"Wrong number of captured packets: %u",
+			rte_ring_count(ring));
+	while (rte_ring_dequeue(ring, (void **)&m) == 0) {
+		TEST_ASSERT(m->pkt_len == PDUMP_PKT_LEN &&
+				RTE_MBUF_INDIRECT(m),
+				"Wrong captured packet reference");
+		rte_pktmbuf_free(m);
+	}
+	TEST_ASSERT_SUCCESS(rte_pdump_disable(pdump_port,
+			RTE_PDUMP_ALL_QUEUES, RTE_PDUMP_FLAG_RXTX),
+			"Cannot disable capture");
+
+	return 0;
+}
+
+static int
+test_pdump(void)
+{
+	int ret;
+
+	if (test_pdump_bpf() < 0)
+		return -1;
+
+	ret = rte_pdump_init(NULL);
+	TEST_ASSERT_SUCCESS(ret, "Cannot start capture server: %d", ret);
+	TEST_ASSERT_EQUAL(rte_pdump_init(NULL), -EALREADY,
+			"Capture server started twice");
+	ret = test_pdump_capture();
+	TEST_ASSERT_SUCCESS(rte_pdump_uninit(), "Cannot stop capture server");
+	TEST_ASSERT_EQUAL(rte_pdump_uninit(), -EALREADY,
+			"Capture server stopped twice");
+
+	return ret;
+}
+
+static struct test_command pdump_cmd = {
+	.command = "pdump_autotest",
+	.callback = test_pdump,
+};
+REGISTER_TEST_COMMAND(pdump_cmd);
@@ -34,11 +34,18 @@
 
 #include <stdio.h>
 #include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 #include <rte_ring.h>
 #include <rte_cycles.h>
 #include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_mbuf.h>
 #include <rte_ethdev.h>
 #include <rte_eth_ring.h>
+#include <rte_eth_rx_idle.h>
 
 #include "test.h"
 
@@ -181,6 +188,165 @@ test_ring_pmd_perf(void)
 	return 0;
 }
 
+#ifdef RUSAGE_THREAD
+/*
+ * Wake-up latency and CPU usage of an lcore receiving sparse traffic from
+ * a ring port, busy polling or using adaptive polling with RX interrupts.
+ */
+#define RX_IDLE_RING_NAME "RING_RX_IDLE"
+#define RX_IDLE_SAMPLES 200
+#define RX_IDLE_PERIOD_US 1000
+
+static uint8_t rx_idle_port;
+static volatile uint64_t rx_idle_send_tsc;
+
+struct rx_idle_result {
+	uint64_t latency;  /* total cycles from send to receive */
+	uint64_t cpu_us;   /* CPU time of the receiving lcore */
+	uint64_t wall_us;  /* elapsed time */
+	uint64_t nb_sleeps;
+};
+
+static struct rx_idle_result rx_idle_results[2];
+
+static uint64_t
+rusage_us(const struct rusage *ru)
+{
+	return (ru->ru_utime.tv_sec + ru->ru_stime.tv_sec) * 1000000ULL +
+		ru->ru_utime.tv_usec + ru->ru_stime.tv_usec;
+}
+
+static int
+rx_idle_lcore(void *arg)
+{
+	const int adaptive = (uintptr_t)arg;
+	struct rx_idle_result *res = &rx_idle_results[adaptive];
+	struct rte_mbuf *pkts[MAX_BURST];
+	struct rte_eth_rx_idle idle;
+	struct rusage ru_start, ru_end;
+	uint64_t tsc_start;
+	unsigned received = 0;
+	uint16_t nb_rx;
+
+	memset(res, 0, sizeof(*res));
+	if (adaptive) {
+		rte_eth_rx_idle_init(&idle, 100, 100);
+		if (rte_eth_rx_idle_add_queue(&idle, rx_idle_port, 0) < 0)
+			return -1;
+	}
+
+	getrusage(RUSAGE_THREAD, &ru_start);
+	tsc_start = rte_rdtsc();
+	while (received < RX_IDLE_SAMPLES) {
+		nb_rx = rte_eth_rx_burst(rx_idle_port, 0, pkts, MAX_BURST);
+		if (nb_rx != 0) {
+			res->latency += rte_rdtsc() - rx_idle_send_tsc;
+			received += nb_rx;
+		}
+		if (adaptive)
+			rte_eth_rx_idle(&idle, nb_rx);
+	}
+	res->wall_us = (rte_rdtsc() - tsc_start) * 1000000 / rte_get_tsc_hz();
+	getrusage(RUSAGE_THREAD, &ru_end);
+	res->cpu_us = rusage_us(&ru_end) - rusage_us(&ru_start);
+
+	if (adaptive) {
+		res->nb_sleeps = idle.nb_sleeps;
+		rte_eth_rx_idle_release(&idle);
+	}
+	return 0;
+}
+
+static int
+test_rx_idle_mode(unsigned lcore_id, int adaptive)
+{
+	/* the ring PMD only carries pointers, no need for real mbufs */
+	struct rte_mbuf *pkt = (struct rte_mbuf *)(uintptr_t)&rx_idle_send_tsc;
+	const struct rx_idle_result *res = &rx_idle_results[adaptive];
+	unsigned i;
+
+	rte_eal_remote_launch(rx_idle_lcore, (void *)(uintptr_t)adaptive,
+			lcore_id);
+	for (i = 0; i < RX_IDLE_SAMPLES; i++) {
+		usleep(RX_IDLE_PERIOD_US);
+		rx_idle_send_tsc = rte_rdtsc();
+		while (rte_eth_tx_burst(rx_idle_port, 0, &pkt, 1) == 0)
+			rte_pause();
+	}
+	if (rte_eal_wait_lcore(lcore_id) < 0) {
+		printf("Cannot use the RX interrupt of the ring port\n");
+		return -1;
+	}
+
+	printf("%-9s: latency %.1F us, CPU usage %.1F%%, %"PRIu64" sleeps\n",
+			adaptive ? "adaptive" : "busy poll",
+			(double)res->latency * 1000000 / rte_get_tsc_hz() /
+			RX_IDLE_SAMPLES,
+			res->wall_us ? 100.0 * res->cpu_us / res->wall_us : 0,
+			res->nb_sleeps);
+	return 0;
+}
+
+static int
+test_ring_pmd_rx_idle_perf(void)
+{
+	struct rte_eth_conf port_conf;
+	struct rte_mempool *mp;
+	struct rte_ring *rng;
+	unsigned lcore_id;
+	int ret;
+
+	lcore_id = rte_get_next_lcore(-1, 1, 0);
+	if (lcore_id >= RTE_MAX_LCORE) {
+		printf("At least 2 lcores are needed, skipping\n");
+		return 0;
+	}
+
+	rng = rte_ring_create(RX_IDLE_RING_NAME, RING_SIZE, rte_socket_id(),
+			RING_F_SP_ENQ|RING_F_SC_DEQ);
+	if (rng == NULL && (rng = rte_ring_lookup(RX_IDLE_RING_NAME)) == NULL)
+		return -1;
+	/* only used to set the RX queue up */
+	mp = rte_pktmbuf_pool_create("RX_IDLE_POOL", 63, 0, 0,
+			RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+	if (mp == NULL && (mp = rte_mempool_lookup("RX_IDLE_POOL")) == NULL)
+		return -1;
+
+	ret = rte_eth_from_ring(rng);
+	if (ret < 0)
+		return -1;
+	rx_idle_port = ret;
+
+	memset(&port_conf, 0, sizeof(port_conf));
+	port_conf.intr_conf.rxq = 1;
+	if (rte_eth_dev_configure(rx_idle_port, 1, 1, &port_conf) < 0 ||
+			rte_eth_rx_queue_setup(rx_idle_port, 0, RING_SIZE,
+				rte_socket_id(), NULL, mp) < 0 ||
+			rte_eth_tx_queue_setup(rx_idle_port, 0, RING_SIZE,
+				rte_socket_id(), NULL) < 0 ||
+			rte_eth_dev_start(rx_idle_port) < 0) {
+		printf("Cannot start the ring port\n");
+		return -1;
+	}
+
+	printf("\n### Receiving a packet every %u us ###\n", RX_IDLE_PERIOD_US);
+	ret = test_rx_idle_mode(lcore_id, 0);
+	if (ret == 0)
+		ret = test_rx_idle_mode(lcore_id, 1);
+
+	rte_eth_dev_stop(rx_idle_port);
+	/* closes the eventfd of the ring */
+	rte_eth_dev_close(rx_idle_port);
+	return ret;
+}
+
+static struct test_command ring_pmd_rx_idle_perf_cmd = {
+	.command = "ring_pmd_rx_idle_perf_autotest",
+	.callback = test_ring_pmd_rx_idle_perf,
+};
+REGISTER_TEST_COMMAND(ring_pmd_rx_idle_perf_cmd);
+#endif /* RUSAGE_THREAD */
+
 static struct test_command ring_pmd_perf_cmd = {
 	.command = "ring_pmd_perf_autotest",
 	.callback = test_ring_pmd_perf,
@@ -0,0 +1,214 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include <rte_common.h>
+#include <rte_cycles.h>
+#include <rte_memory.h>
+#include <rte_lcore.h>
+#include <rte_service.h>
+
+#include "test.h"
+
+/*
+ * Service cores
+ * =============
+ *
+ * - Register services, check name lookup and duplicate or invalid
+ *   registrations.
+ *
+ * - Map two services to a service lcore, start it and check that both
+ *   services are called, and only while started.
+ *
+ * - Check that a non MT safe service is not run concurrently by the
+ *   service lcore and the master lcore.
+ *
+ * - Check the lcore and service state transitions, then unregister.
+ */
+
+#define SERVICE_RUN_MS 50
+
+static volatile uint32_t service_counts[2];
+static volatile uint32_t service_in_callback;
+static volatile uint32_t service_concurrent;
+
+static int32_t
+service_count(void *arg)
+{
+	service_counts[(uintptr_t)arg]++;
+	return 0;
+}
+
+static int32_t
+service_exclusive(__attribute__((unused)) void *arg)
+{
+	if (service_in_callback)
+		service_concurrent = 1;
+	service_in_callback = 1;
+	rte_delay_us(10);
+	service_in_callback = 0;
+	return 0;
+}
+
+static int
+service_register(const char *name, rte_service_func cb, uintptr_t arg,
+		uint32_t *id)
+{
+	struct rte_service_spec spec;
+
+	memset(&spec, 0, sizeof(spec));
+	snprintf(spec.name, sizeof(spec.name), "%s", name);
+	spec.callback = cb;
+	spec.callback_userdata = (void *)arg;
+	spec.socket_id = SOCKET_ID_ANY;
+	return rte_service_register(&spec, id);
+}
+
+static int
+test_service_cores(void)
+{
+	struct rte_service_stats stats;
+	uint32_t id0, id1, id2, id;
+	unsigned lcore_id;
+	uint32_t count;
+	int i;
+
+	lcore_id = rte_get_next_lcore(-1, 1, 0);
+	if (lcore_id >= RTE_MAX_LCORE) {
+		printf("At least 2 lcores are needed, skipping\n");
+		return 0;
+	}
+
+	/* registration */
+	TEST_ASSERT_SUCCESS(service_register("count0", service_count, 0, &id0),
+			"Cannot register service");
+	TEST_ASSERT_SUCCESS(service_register("count1", service_count, 1, &id1),
+			"Cannot register service");
+	TEST_ASSERT_SUCCESS(service_register("exclusive", service_exclusive,
+			0, &id2), "Cannot register service");
+	TEST_ASSERT_EQUAL(service_register("count0", service_count, 0, NULL),
+			-EEXIST, "Duplicate service registered");
+	TEST_ASSERT_EQUAL(service_register("", service_count, 0, NULL),
+			-EINVAL, "Service without name registered");
+	TEST_ASSERT_EQUAL(service_register("nocb", NULL, 0, NULL),
+			-EINVAL, "Service without callback registered");
+	TEST_ASSERT_SUCCESS(rte_service_get_by_name("count1", &id),
+			"Cannot find service");
+	TEST_ASSERT_EQUAL(id, id1, "Wrong service found");
+	TEST_ASSERT_EQUAL(strcmp(rte_service_get_name(id1), "count1"), 0,
+			"Wrong service name");
+
+	/* service lcore */
+	TEST_ASSERT_EQUAL(rte_service_map_lcore_set(id0, lcore_id, 1),
+			-EINVAL, "Service mapped to a normal lcore");
+	TEST_ASSERT_EQUAL(rte_service_lcore_add(rte_get_master_lcore()),
+			-EINVAL, "Master lcore made a service lcore");
+	TEST_ASSERT_SUCCESS(rte_service_lcore_add(lcore_id),
+			"Cannot add service lcore");
+	TEST_ASSERT_EQUAL(rte_service_lcore_add(lcore_id), -EALREADY,
+			"Service lcore added twice");
+	TEST_ASSERT_SUCCESS(rte_service_map_lcore_set(id0, lcore_id, 1),
+			"Cannot map service");
+	TEST_ASSERT_SUCCESS(rte_service_map_lcore_set(id1, lcore_id, 1),
+			"Cannot map service");
+	TEST_ASSERT_SUCCESS(rte_service_map_lcore_set(id2, lcore_id, 1),
+			"Cannot map service");
+	TEST_ASSERT_SUCCESS(rte_service_runstate_set(id0, 1),
+			"Cannot start service");
+	TEST_ASSERT_SUCCESS(rte_service_runstate_set(id2, 1),
+			"Cannot start service");
+
+	TEST_ASSERT_SUCCESS(rte_service_lcore_start(lcore_id),
+			"Cannot start service lcore");
+	TEST_ASSERT_EQUAL(rte_service_lcore_start(lcore_id), -EBUSY,
+			"Service lcore started twice");
+	TEST_ASSERT_EQUAL(rte_service_lcore_del(lcore_id), -EBUSY,
+			"Running service lcore deleted");
+	TEST_ASSERT_EQUAL(rte_service_unregister(id0), -EBUSY,
+			"Started service unregistered");
+
+	/* the master lcore also runs the non MT safe service */
+	for (i = 0; i < SERVICE_RUN_MS * 10; i++) {
+		rte_service_run_iter_on_app_lcore(id2);
+		rte_delay_us(100);
+	}
+	TEST_ASSERT_SUCCESS(rte_service_lcore_stop(lcore_id),
+			"Cannot stop service lcore");
+	TEST_ASSERT_EQUAL(rte_service_lcore_stop(lcore_id), -EALREADY,
+			"Service lcore stopped twice");
+
+	TEST_ASSERT(service_counts[0] > 0, "Started service not called");
+	TEST_ASSERT_EQUAL(service_counts[1], 0, "Stopped service called");
+	TEST_ASSERT_EQUAL(service_concurrent, 0,
+			"Non MT safe service run concurrently");
+	TEST_ASSERT_SUCCESS(rte_service_get_stats(id0, &stats),
+			"Cannot get service stats");
+	TEST_ASSERT_EQUAL(stats.calls, service_counts[0],
+			"Wrong number of calls: %"PRIu64, stats.calls);
+	TEST_ASSERT(stats.cycles > 0, "No cycles counted");
+	rte_service_dump(stdout);
+
+	/* a stopped service lcore runs nothing */
+	count = service_counts[0];
+	rte_delay_ms(SERVICE_RUN_MS);
+	TEST_ASSERT_EQUAL(service_counts[0], count,
+			"Service called by a stopped lcore");
+
+	/* cleanup */
+	TEST_ASSERT_SUCCESS(rte_service_runstate_set(id0, 0),
+			"Cannot stop service");
+	TEST_ASSERT_SUCCESS(rte_service_runstate_set(id2, 0),
+			"Cannot stop service");
+	TEST_ASSERT_SUCCESS(rte_service_lcore_del(lcore_id),
+			"Cannot delete service lcore");
+	TEST_ASSERT_SUCCESS(rte_service_unregister(id0),
+			"Cannot unregister service");
+	TEST_ASSERT_SUCCESS(rte_service_unregister(id1),
+			"Cannot unregister service");
+	TEST_ASSERT_SUCCESS(rte_service_unregister(id2),
+			"Cannot unregister service");
+	TEST_ASSERT_EQUAL(rte_service_get_by_name("count0", &id), -ENOENT,
+			"Unregistered service found");
+
+	return 0;
+}
+
+static struct test_command service_cores_cmd = {
+	.command = "service_cores_autotest",
+	.callback = test_service_cores,
+};
+REGISTER_TEST_COMMAND(service_cores_cmd);
@@ -36,6 +36,7 @@
 #include <rte_table_lpm_ipv6.h>
 #include <rte_table_hash.h>
 #include <rte_table_array.h>
+#include <rte_table_emc.h>
 #include <rte_pipeline.h>
 
 #ifdef RTE_LIBRTE_ACL
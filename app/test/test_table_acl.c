@@ -431,7 +431,7 @@ setup_acl_pipeline(void)
 
 	/* Table configuration  */
 	for (i = 0; i < N_PORTS; i++) {
-		struct rte_pipeline_table_params table_params;
+		struct rte_pipeline_table_params table_params = {0};
 
 		/* Set up defaults for stub */
 		table_params.ops = &rte_table_stub_ops;
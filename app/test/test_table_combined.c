@@ -32,9 +32,13 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
+#include <math.h>
 #include "test_table_combined.h"
 #include "test_table.h"
 #include <rte_table_lpm_ipv6.h>
+#include <rte_cycles.h>
+#include <rte_random.h>
 
 #define MAX_TEST_KEYS 128
 #define N_PACKETS 50
@@ -69,6 +73,9 @@ combined_table_test table_tests_combined[] = {
 	test_table_hash16ext,
 	test_table_hash32lru,
 	test_table_hash32ext,
+	test_table_hash16ext_emc,
+	test_table_emc_zipf,
+	test_table_emc_invalidate,
 };
 
 unsigned n_table_tests_combined = RTE_DIM(table_tests_combined);
@@ -784,3 +791,460 @@ test_table_hash32ext(void)
 
 	return 0;
 }
+
+int
+test_table_hash16ext_emc(void)
+{
+	int status, i;
+
+	/* Traffic flow */
+	struct rte_table_hash_key16_ext_params key16ext_params = {
+		.n_entries = 1<<16,
+		.n_entries_ext = 1<<15,
+		.f_hash = pipeline_test_hash,
+		.seed = 0,
+		.signature_offset = APP_METADATA_OFFSET(0),
+		.key_offset = APP_METADATA_OFFSET(32),
+		.key_mask = NULL,
+	};
+
+	struct rte_table_emc_params emc_params = {
+		.ops = &rte_table_hash_key16_ext_ops,
+		.arg_create = &key16ext_params,
+		.key_size = 16,
+		.key_offset = APP_METADATA_OFFSET(32),
+		.key_mask = NULL,
+		.signature_offset = APP_METADATA_OFFSET(0),
+		.f_hash = NULL,
+		.seed = 0,
+		.n_entries = 1<<10,
+		.n_ways = 2,
+		.insert_inv_prob = 1,
+	};
+
+	uint8_t key16ext[16];
+	uint32_t *k16ext = (uint32_t *) key16ext;
+
+	memset(key16ext, 0, sizeof(key16ext));
+	k16ext[0] = 0xadadadad;
+
+	struct table_packets table_packets;
+
+	printf("--------------\n");
+	printf("RUNNING TEST - %s\n", __func__);
+	printf("--------------\n");
+	for (i = 0; i < 50; i++)
+		table_packets.hit_packet[i] = 0xadadadad;
+
+	for (i = 0; i < 50; i++)
+		table_packets.miss_packet[i] = 0xbdadadad;
+
+	table_packets.n_hit_packets = 50;
+	table_packets.n_miss_packets = 50;
+
+	status = test_table_type(&rte_table_emc_ops,
+		(void *)&emc_params, (void *)key16ext, &table_packets,
+		NULL, 0);
+	VERIFY(status, CHECK_TABLE_OK);
+
+	/* EMC entries of a key found through the hash function */
+	emc_params.f_hash = pipeline_test_hash;
+	emc_params.n_ways = 1;
+
+	status = test_table_type(&rte_table_emc_ops,
+		(void *)&emc_params, (void *)key16ext, &table_packets,
+		NULL, 0);
+	VERIFY(status, CHECK_TABLE_OK);
+
+	/* Invalid parameters */
+	emc_params.n_entries = 0;
+
+	status = test_table_type(&rte_table_emc_ops,
+		(void *)&emc_params, (void *)key16ext, &table_packets,
+		NULL, 0);
+	VERIFY(status, CHECK_TABLE_TABLE_CONFIG);
+
+	emc_params.n_entries = 1<<10;
+	emc_params.n_ways = 4;
+
+	status = test_table_type(&rte_table_emc_ops,
+		(void *)&emc_params, (void *)key16ext, &table_packets,
+		NULL, 0);
+	VERIFY(status, CHECK_TABLE_TABLE_CONFIG);
+
+	emc_params.n_ways = 2;
+	emc_params.insert_inv_prob = 3;
+
+	status = test_table_type(&rte_table_emc_ops,
+		(void *)&emc_params, (void *)key16ext, &table_packets,
+		NULL, 0);
+	VERIFY(status, CHECK_TABLE_TABLE_CONFIG);
+
+	emc_params.insert_inv_prob = 1;
+	emc_params.key_size = 12;
+
+	status = test_table_type(&rte_table_emc_ops,
+		(void *)&emc_params, (void *)key16ext, &table_packets,
+		NULL, 0);
+	VERIFY(status, CHECK_TABLE_TABLE_CONFIG);
+
+	emc_params.key_size = 16;
+	key16ext_params.n_entries = 0;
+
+	status = test_table_type(&rte_table_emc_ops,
+		(void *)&emc_params, (void *)key16ext, &table_packets,
+		NULL, 0);
+	VERIFY(status, CHECK_TABLE_TABLE_CONFIG);
+
+	return 0;
+}
+
+/*
+ * EMC benchmark: flows picked with a Zipf distribution are looked up in a
+ * 16-byte key hash table, first directly and then through an EMC.
+ */
+#define ZIPF_N_FLOWS        (1 << 14)
+#define ZIPF_N_BURSTS       2048
+#define ZIPF_EMC_ENTRIES    (1 << 10)
+
+static const double zipf_exponent[] = {0.0, 0.9, 1.1};
+
+static void
+zipf_cdf_init(double *cdf, uint32_t n, double s)
+{
+	double sum = 0;
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		sum += 1.0 / pow((double) (i + 1), s);
+		cdf[i] = sum;
+	}
+
+	for (i = 0; i < n; i++)
+		cdf[i] /= sum;
+}
+
+static uint32_t
+zipf_sample(double *cdf, uint32_t n)
+{
+	double u = (double) (rte_rand() >> 11) / (double) (1LLU << 53);
+	uint32_t lo = 0, hi = n - 1;
+
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+
+		if (cdf[mid] < u)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static void
+zipf_key_set(struct rte_mbuf *m, uint32_t flow_id)
+{
+	uint32_t *signature = RTE_MBUF_METADATA_UINT32_PTR(m,
+		APP_METADATA_OFFSET(0));
+	uint32_t *k32 = RTE_MBUF_METADATA_UINT32_PTR(m,
+		APP_METADATA_OFFSET(32));
+
+	memset(k32, 0, 16);
+	k32[0] = rte_cpu_to_be_32(flow_id);
+	*signature = pipeline_test_hash(k32, 0, 0);
+}
+
+static int
+zipf_run(struct rte_table_ops *ops, void *table, double *cdf,
+	struct rte_mbuf **pkts, uint64_t *n_cycles)
+{
+	void *entries[RTE_PORT_IN_BURST_SIZE_MAX];
+	uint32_t flow_ids[RTE_PORT_IN_BURST_SIZE_MAX];
+	uint32_t i, j;
+
+	*n_cycles = 0;
+
+	for (i = 0; i < ZIPF_N_BURSTS; i++) {
+		uint64_t lookup_hit_mask, start;
+
+		for (j = 0; j < RTE_PORT_IN_BURST_SIZE_MAX; j++) {
+			flow_ids[j] = zipf_sample(cdf, ZIPF_N_FLOWS);
+			zipf_key_set(pkts[j], flow_ids[j]);
+		}
+
+		start = rte_rdtsc();
+		ops->f_lookup(table, pkts, UINT64_MAX, &lookup_hit_mask,
+			entries);
+		*n_cycles += rte_rdtsc() - start;
+
+		if (lookup_hit_mask != UINT64_MAX)
+			return -1;
+
+		for (j = 0; j < RTE_PORT_IN_BURST_SIZE_MAX; j++)
+			if (*((uint32_t *) entries[j]) != flow_ids[j])
+				return -1;
+	}
+
+	return 0;
+}
+
+int
+test_table_emc_zipf(void)
+{
+	struct rte_table_hash_key16_ext_params key16ext_params = {
+		.n_entries = ZIPF_N_FLOWS,
+		.n_entries_ext = ZIPF_N_FLOWS,
+		.f_hash = pipeline_test_hash,
+		.seed = 0,
+		.signature_offset = APP_METADATA_OFFSET(0),
+		.key_offset = APP_METADATA_OFFSET(32),
+		.key_mask = NULL,
+	};
+
+	struct rte_table_emc_params emc_params = {
+		.ops = &rte_table_hash_key16_ext_ops,
+		.arg_create = &key16ext_params,
+		.key_size = 16,
+		.key_offset = APP_METADATA_OFFSET(32),
+		.key_mask = NULL,
+		.signature_offset = APP_METADATA_OFFSET(0),
+		.f_hash = NULL,
+		.seed = 0,
+		.n_entries = ZIPF_EMC_ENTRIES,
+		.n_ways = 2,
+		.insert_inv_prob = 4,
+	};
+
+	struct rte_table_ops *ops[] = {
+		&rte_table_hash_key16_ext_ops,
+		&rte_table_emc_ops,
+	};
+	void *params[] = {&key16ext_params, &emc_params};
+	const char *name[] = {"hash", "hash + EMC"};
+
+	struct rte_mbuf *pkts[RTE_PORT_IN_BURST_SIZE_MAX];
+	double *cdf;
+	uint32_t i, j, k;
+	int status = 0;
+
+	printf("--------------\n");
+	printf("RUNNING TEST - %s\n", __func__);
+	printf("--------------\n");
+
+	cdf = malloc(ZIPF_N_FLOWS * sizeof(double));
+	if (cdf == NULL)
+		return -CHECK_TABLE_TABLE_CONFIG;
+
+	for (i = 0; i < RTE_PORT_IN_BURST_SIZE_MAX; i++) {
+		pkts[i] = rte_pktmbuf_alloc(pool);
+		if (pkts[i] == NULL) {
+			for (j = 0; j < i; j++)
+				rte_pktmbuf_free(pkts[j]);
+			free(cdf);
+			return -CHECK_TABLE_TABLE_CONFIG;
+		}
+	}
+
+	for (i = 0; (i < RTE_DIM(ops)) && (status == 0); i++) {
+		void *table;
+
+		table = ops[i]->f_create(params[i], 0, sizeof(uint32_t));
+		if (table == NULL) {
+			status = -CHECK_TABLE_TABLE_CONFIG;
+			break;
+		}
+
+		for (j = 0; j < ZIPF_N_FLOWS; j++) {
+			uint32_t key[4] = {rte_cpu_to_be_32(j), 0, 0, 0};
+			void *entry_ptr;
+			int key_found;
+
+			if (ops[i]->f_add(table, key, &j, &key_found,
+				&entry_ptr) != 0) {
+				status = -CHECK_TABLE_ENTRY_ADD;
+				break;
+			}
+		}
+
+		for (k = 0; (k < RTE_DIM(zipf_exponent)) && (status == 0);
+			k++) {
+			struct rte_table_stats stats;
+			uint64_t n_cycles;
+
+			zipf_cdf_init(cdf, ZIPF_N_FLOWS, zipf_exponent[k]);
+			ops[i]->f_stats(table, NULL, 1);
+
+			if (zipf_run(ops[i], table, cdf, pkts, &n_cycles) != 0) {
+				status = -CHECK_TABLE_CONSISTENCY;
+				break;
+			}
+
+			ops[i]->f_stats(table, &stats, 1);
+			printf("%-10s: Zipf s = %.1f: %.1f cycles/pkt\n",
+				name[i], zipf_exponent[k],
+				(double) n_cycles / (ZIPF_N_BURSTS *
+				RTE_PORT_IN_BURST_SIZE_MAX));
+#ifdef RTE_TABLE_STATS_COLLECT
+			printf("%-10s: cache hit rate %.1f%% (%" PRIu64
+				" out of %" PRIu64 " packets)\n",
+				name[i], (100.0 * stats.n_pkts_cache_hit) /
+				stats.n_pkts_in,
+				stats.n_pkts_cache_hit, stats.n_pkts_in);
+#endif
+		}
+
+		ops[i]->f_free(table);
+	}
+
+	for (i = 0; i < RTE_PORT_IN_BURST_SIZE_MAX; i++)
+		rte_pktmbuf_free(pkts[i]);
+	free(cdf);
+
+	return status;
+}
+
+/*
+ * An entry delete or add only invalidates the EMC entries of its key: the
+ * other keys keep hitting the EMC, with or without EMC hash function.
+ */
+#define EMC_INV_N_KEYS RTE_PORT_IN_BURST_SIZE_MAX
+
+static int
+emc_invalidate_check(void *table, struct rte_mbuf **pkts, uint32_t *data,
+	uint64_t hit_mask, uint64_t n_cache_hits)
+{
+	void *entries[RTE_PORT_IN_BURST_SIZE_MAX];
+	struct rte_table_stats stats;
+	uint64_t lookup_hit_mask;
+	uint32_t i;
+
+	rte_table_emc_ops.f_stats(table, NULL, 1);
+	rte_table_emc_ops.f_lookup(table, pkts, UINT64_MAX, &lookup_hit_mask,
+		entries);
+	rte_table_emc_ops.f_stats(table, &stats, 1);
+
+	if (lookup_hit_mask != hit_mask)
+		return -1;
+
+	for (i = 0; i < EMC_INV_N_KEYS; i++)
+		if ((hit_mask & (1LLU << i)) &&
+			(*((uint32_t *) entries[i]) != data[i]))
+			return -1;
+
+#ifdef RTE_TABLE_STATS_COLLECT
+	if (stats.n_pkts_cache_hit != n_cache_hits)
+		return -1;
+#else
+	RTE_SET_USED(stats);
+	RTE_SET_USED(n_cache_hits);
+#endif
+
+	return 0;
+}
+
+int
+test_table_emc_invalidate(void)
+{
+	struct rte_table_hash_key16_ext_params key16ext_params = {
+		.n_entries = 1 << 10,
+		.n_entries_ext = 1 << 10,
+		.f_hash = pipeline_test_hash,
+		.seed = 0,
+		.signature_offset = APP_METADATA_OFFSET(0),
+		.key_offset = APP_METADATA_OFFSET(32),
+		.key_mask = NULL,
+	};
+
+	struct rte_table_emc_params emc_params = {
+		.ops = &rte_table_hash_key16_ext_ops,
+		.arg_create = &key16ext_params,
+		.key_size = 16,
+		.key_offset = APP_METADATA_OFFSET(32),
+		.key_mask = NULL,
+		.signature_offset = APP_METADATA_OFFSET(0),
+		.seed = 0,
+		.n_entries = 1 << 10,
+		.n_ways = 2,
+		.insert_inv_prob = 1,
+	};
+
+	rte_table_hash_op_hash f_hash[] = {NULL, pipeline_test_hash};
+	struct rte_mbuf *pkts[RTE_PORT_IN_BURST_SIZE_MAX];
+	uint32_t data[EMC_INV_N_KEYS];
+	uint32_t i, j;
+	int status = 0;
+
+	printf("--------------\n");
+	printf("RUNNING TEST - %s\n", __func__);
+	printf("--------------\n");
+
+	for (i = 0; i < RTE_PORT_IN_BURST_SIZE_MAX; i++) {
+		pkts[i] = rte_pktmbuf_alloc(pool);
+		if (pkts[i] == NULL) {
+			for (j = 0; j < i; j++)
+				rte_pktmbuf_free(pkts[j]);
+			return -CHECK_TABLE_TABLE_CONFIG;
+		}
+		zipf_key_set(pkts[i], i);
+		data[i] = i;
+	}
+
+	for (i = 0; (i < RTE_DIM(f_hash)) && (status == 0); i++) {
+		uint32_t key[4] = {0, 0, 0, 0};
+		void *table, *entry_ptr;
+		int key_found;
+
+		emc_params.f_hash = f_hash[i];
+		table = rte_table_emc_ops.f_create(&emc_params, 0,
+			sizeof(uint32_t));
+		if (table == NULL) {
+			status = -CHECK_TABLE_TABLE_CONFIG;
+			break;
+		}
+
+		for (j = 0; j < EMC_INV_N_KEYS; j++) {
+			key[0] = rte_cpu_to_be_32(j);
+			if (rte_table_emc_ops.f_add(table, key, &data[j],
+				&key_found, &entry_ptr) != 0) {
+				status = -CHECK_TABLE_ENTRY_ADD;
+				break;
+			}
+		}
+
+		/* Fill the EMC, then every key hits it */
+		if ((status == 0) &&
+			((emc_invalidate_check(table, pkts, data, UINT64_MAX,
+				0) != 0) ||
+			(emc_invalidate_check(table, pkts, data, UINT64_MAX,
+				EMC_INV_N_KEYS) != 0)))
+			status = -CHECK_TABLE_CONSISTENCY;
+
+		/* Delete key 0: it misses, the other keys still hit the EMC */
+		key[0] = rte_cpu_to_be_32(0);
+		if ((status == 0) &&
+			((rte_table_emc_ops.f_delete(table, key, &key_found,
+				NULL) != 0) ||
+			(key_found == 0) ||
+			(emc_invalidate_check(table, pkts, data, UINT64_MAX << 1,
+				EMC_INV_N_KEYS - 1) != 0)))
+			status = -CHECK_TABLE_CONSISTENCY;
+
+		/* Add key 0 back with new data */
+		data[0] = EMC_INV_N_KEYS;
+		if ((status == 0) &&
+			((rte_table_emc_ops.f_add(table, key, &data[0],
+				&key_found, &entry_ptr) != 0) ||
+			(emc_invalidate_check(table, pkts, data, UINT64_MAX,
+				EMC_INV_N_KEYS - 1) != 0)))
+			status = -CHECK_TABLE_ENTRY_ADD;
+		data[0] = 0;
+
+		rte_table_emc_ops.f_free(table);
+	}
+
+	for (i = 0; i < RTE_PORT_IN_BURST_SIZE_MAX; i++)
+		rte_pktmbuf_free(pkts[i]);
+
+	return status;
+}
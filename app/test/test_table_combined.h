@@ -47,6 +47,9 @@ int test_table_hash16ext(void);
 int test_table_hash32unoptimized(void);
 int test_table_hash32lru(void);
 int test_table_hash32ext(void);
+int test_table_hash16ext_emc(void);
+int test_table_emc_zipf(void);
+int test_table_emc_invalidate(void);
 
 /* Extern variables */
 typedef int (*combined_table_test)(void);
@@ -36,6 +36,10 @@
 #include <rte_log.h>
 #include <inttypes.h>
 #include <rte_hexdump.h>
+#include <rte_cycles.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_ip.h>
 #include "test_table.h"
 #include "test_table_pipeline.h"
 
@@ -519,6 +523,226 @@ fail:
 
 }
 
+/*
+ * Lock-free table update: the pipeline runs on a slave lcore with a source
+ * port generating traffic, while the master lcore adds and deletes LPM routes
+ * through the shadow copy of the table. Reports the update rate under load.
+ */
+#define SHADOW_N_ROUTES 1024
+#define SHADOW_N_ITER 4
+
+static volatile int shadow_run;
+static uint64_t shadow_n_runs;
+
+static int
+pipeline_shadow_worker(void *arg)
+{
+	struct rte_pipeline *pipeline = arg;
+	uint64_t n_runs = 0;
+
+	while (shadow_run) {
+		rte_pipeline_run(pipeline);
+		if ((++n_runs & 0xF) == 0)
+			rte_pipeline_flush(pipeline);
+	}
+
+	shadow_n_runs = n_runs;
+	rte_pipeline_flush(pipeline);
+
+	return 0;
+}
+
+static struct rte_table_lpm_key shadow_bulk_keys[SHADOW_N_ROUTES + 1];
+static void *shadow_bulk_keys_ptr[SHADOW_N_ROUTES + 1];
+static struct rte_pipeline_table_entry
+	*shadow_bulk_entries[SHADOW_N_ROUTES + 1];
+static struct rte_pipeline_table_entry
+	*shadow_bulk_entries_ptr[SHADOW_N_ROUTES + 1];
+static int shadow_bulk_key_found[SHADOW_N_ROUTES + 1];
+
+/*
+ * A bulk add overflowing the table fails on its last key, the others being
+ * added to both copies: each single delete is applied first to a different
+ * copy, which must have the key.
+ */
+static int
+test_pipeline_shadow_bulk(struct rte_pipeline *pipeline, uint32_t t_id,
+	struct rte_pipeline_table_entry *entry)
+{
+	uint32_t i;
+	int key_found;
+
+	for (i = 0; i < SHADOW_N_ROUTES + 1; i++) {
+		shadow_bulk_keys[i].ip = IPv4(10, i >> 8, i & 0xFF, 0);
+		shadow_bulk_keys[i].depth = 24;
+		shadow_bulk_keys_ptr[i] = &shadow_bulk_keys[i];
+		shadow_bulk_entries[i] = entry;
+		shadow_bulk_entries_ptr[i] = NULL;
+	}
+
+	if (rte_pipeline_table_entry_add_bulk(pipeline, t_id,
+		shadow_bulk_keys_ptr, shadow_bulk_entries, SHADOW_N_ROUTES + 1,
+		shadow_bulk_key_found, shadow_bulk_entries_ptr) == 0) {
+		printf("Lock-free table update test: bulk add overflow "
+			"accepted\n");
+		return -1;
+	}
+
+	for (i = 0; i < SHADOW_N_ROUTES; i++)
+		if (rte_pipeline_table_entry_delete(pipeline, t_id,
+			&shadow_bulk_keys[i], &key_found, NULL) ||
+			(key_found == 0)) {
+			printf("Lock-free table update test: key %u of the "
+				"failed bulk add not in both copies\n", i);
+			return -1;
+		}
+
+	return 0;
+}
+
+static int
+test_pipeline_shadow_update(void)
+{
+	struct rte_pipeline_params pipeline_params = {
+		.name = "PIPELINE_SHADOW",
+		.socket_id = 0,
+	};
+	struct rte_port_source_params source_params = {
+		.mempool = pool,
+	};
+	struct rte_pipeline_port_in_params port_in_params = {
+		.ops = &rte_port_source_ops,
+		.arg_create = &source_params,
+		.burst_size = BURST_SIZE,
+	};
+	struct rte_pipeline_port_out_params port_out_params = {
+		.ops = &rte_port_sink_ops,
+	};
+	struct rte_table_lpm_params lpm_params = {
+		.name = "LPM_SHADOW_0",
+		.n_rules = SHADOW_N_ROUTES,
+		.entry_unique_size = sizeof(struct rte_pipeline_table_entry),
+		.offset = APP_METADATA_OFFSET(32),
+	};
+	struct rte_table_lpm_params lpm_params_shadow = {
+		.name = "LPM_SHADOW_1",
+		.n_rules = SHADOW_N_ROUTES,
+		.entry_unique_size = sizeof(struct rte_pipeline_table_entry),
+		.offset = APP_METADATA_OFFSET(32),
+	};
+	struct rte_pipeline_table_params table_params = {
+		.ops = &rte_table_lpm_ops,
+		.arg_create = &lpm_params,
+		.arg_create_shadow = &lpm_params_shadow,
+	};
+	struct rte_pipeline_table_params lru_table_params;
+	struct rte_pipeline_table_entry entry, *entry_ptr;
+	struct rte_pipeline *pipeline;
+	uint32_t in_id, out_id, t_id, i, iter;
+	unsigned lcore_id;
+	uint64_t start, cycles;
+	int key_found, status = -1;
+
+	lcore_id = rte_get_next_lcore(rte_lcore_id(), 1, 0);
+	if (lcore_id >= RTE_MAX_LCORE) {
+		printf("Lock-free table update test needs 2 lcores, skipped\n");
+		return 0;
+	}
+
+	pipeline = rte_pipeline_create(&pipeline_params);
+	if (pipeline == NULL)
+		return -1;
+
+	/* The copies of an LRU table would evict different keys */
+	lru_table_params = table_params;
+	lru_table_params.ops = &rte_table_hash_key8_lru_ops;
+	if (rte_pipeline_table_create(pipeline, &lru_table_params,
+		&t_id) == 0) {
+		printf("Lock-free table update test: LRU table accepted\n");
+		goto exit;
+	}
+
+	lru_table_params.ops = &rte_table_emc_lru_ops;
+	if (rte_pipeline_table_create(pipeline, &lru_table_params,
+		&t_id) == 0) {
+		printf("Lock-free table update test: EMC over LRU table "
+			"accepted\n");
+		goto exit;
+	}
+
+	if (rte_pipeline_port_in_create(pipeline, &port_in_params, &in_id) ||
+		rte_pipeline_port_out_create(pipeline, &port_out_params,
+			&out_id) ||
+		rte_pipeline_table_create(pipeline, &table_params, &t_id) ||
+		rte_pipeline_port_in_connect_to_table(pipeline, in_id, t_id) ||
+		rte_pipeline_port_in_enable(pipeline, in_id) ||
+		rte_pipeline_check(pipeline)) {
+		printf("Lock-free table update test: pipeline setup failed\n");
+		goto exit;
+	}
+
+	entry.action = RTE_PIPELINE_ACTION_PORT;
+	entry.port_id = out_id;
+	if (rte_pipeline_table_default_entry_add(pipeline, t_id, &entry,
+		&entry_ptr)) {
+		printf("Lock-free table update test: default entry failed\n");
+		goto exit;
+	}
+
+	shadow_run = 1;
+	rte_eal_remote_launch(pipeline_shadow_worker, pipeline, lcore_id);
+
+	start = rte_rdtsc();
+	for (iter = 0; iter < SHADOW_N_ITER; iter++) {
+		for (i = 0; i < SHADOW_N_ROUTES; i++) {
+			struct rte_table_lpm_key key = {
+				.ip = IPv4(10, i >> 8, i & 0xFF, 0),
+				.depth = 24,
+			};
+
+			if (rte_pipeline_table_entry_add(pipeline, t_id, &key,
+				&entry, &key_found, &entry_ptr) ||
+				key_found)
+				goto stop;
+		}
+
+		for (i = 0; i < SHADOW_N_ROUTES; i++) {
+			struct rte_table_lpm_key key = {
+				.ip = IPv4(10, i >> 8, i & 0xFF, 0),
+				.depth = 24,
+			};
+
+			if (rte_pipeline_table_entry_delete(pipeline, t_id,
+				&key, &key_found, NULL) ||
+				(key_found == 0))
+				goto stop;
+		}
+	}
+	cycles = rte_rdtsc() - start;
+	status = 0;
+
+stop:
+	shadow_run = 0;
+	rte_eal_wait_lcore(lcore_id);
+
+	if (status != 0) {
+		printf("Lock-free table update test: update %u failed\n", i);
+		goto exit;
+	}
+
+	printf("Lock-free table update: %u updates in %"PRIu64" cycles "
+		"(%"PRIu64" cycles/update, %"PRIu64" concurrent runs)\n",
+		2 * SHADOW_N_ITER * SHADOW_N_ROUTES, cycles,
+		cycles / (2 * SHADOW_N_ITER * SHADOW_N_ROUTES),
+		shadow_n_runs);
+
+	status = test_pipeline_shadow_bulk(pipeline, t_id, &entry);
+
+exit:
+	rte_pipeline_free(pipeline);
+	return status;
+}
+
 int
 test_table_pipeline(void)
 {
@@ -588,5 +812,11 @@ test_table_pipeline(void)
 		return -1;
 	}
 
+	if (test_pipeline_shadow_update() < 0) {
+		RTE_LOG(INFO, PIPELINE, "%s: Lock-free table update test "
+			"failed.\n", __func__);
+		return -1;
+	}
+
 	return 0;
 }
@@ -464,6 +464,71 @@ test_table_lpm(void)
 	if (result_mask != expected_mask)
 		return -23;
 
+	/* Bulk add/delete */
+	{
+		struct rte_table_lpm_key bulk_keys[4];
+		char bulk_entries[4] = {'B', 'B', 'C', 'B'};
+		void *bulk_keys_ptr[4], *bulk_entries_ptr[4], *bulk_ptr[4];
+		int bulk_key_found[4];
+
+		for (i = 0; i < 4; i++) {
+			bulk_keys[i].ip = 0x0a000000 | (i << 8);
+			bulk_keys[i].depth = 24;
+			bulk_keys_ptr[i] = &bulk_keys[i];
+			bulk_entries_ptr[i] = &bulk_entries[i];
+		}
+
+		status = rte_table_lpm_ops.f_add_bulk(table, bulk_keys_ptr,
+			bulk_entries_ptr, 0, bulk_key_found, bulk_ptr);
+		if (status == 0)
+			return -24;
+
+		/* The keys before the invalid one are added */
+		bulk_keys[3].depth = 33;
+		status = rte_table_lpm_ops.f_add_bulk(table, bulk_keys_ptr,
+			bulk_entries_ptr, 4, bulk_key_found, bulk_ptr);
+		if (status == 0)
+			return -25;
+
+		for (i = 0; i < 3; i++)
+			if (bulk_key_found[i] != 0)
+				return -25;
+
+		bulk_keys[3].depth = 24;
+		status = rte_table_lpm_ops.f_add_bulk(table, bulk_keys_ptr,
+			bulk_entries_ptr, 4, bulk_key_found, bulk_ptr);
+		if (status != 0)
+			return -26;
+
+		for (i = 0; i < 4; i++)
+			if (bulk_key_found[i] != (i < 3) ||
+				*(char *) bulk_ptr[i] != bulk_entries[i])
+				return -27;
+
+		if ((bulk_ptr[0] != bulk_ptr[1]) ||
+			(bulk_ptr[0] != bulk_ptr[3]) ||
+			(bulk_ptr[0] == bulk_ptr[2]))
+			return -28;
+
+		status = rte_table_lpm_ops.f_delete_bulk(table, bulk_keys_ptr,
+			4, bulk_key_found, NULL);
+		if (status != 0)
+			return -29;
+
+		for (i = 0; i < 4; i++)
+			if (bulk_key_found[i] != 1)
+				return -30;
+
+		status = rte_table_lpm_ops.f_delete_bulk(table, bulk_keys_ptr,
+			4, bulk_key_found, NULL);
+		if (status != 0)
+			return -31;
+
+		for (i = 0; i < 4; i++)
+			if (bulk_key_found[i] != 0)
+				return -32;
+	}
+
 	/* Free resources */
 	for (i = 0; i < RTE_PORT_IN_BURST_SIZE_MAX; i++)
 		rte_pktmbuf_free(mbufs[i]);
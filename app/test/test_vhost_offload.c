@@ -0,0 +1,462 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <rte_byteorder.h>
+#include <rte_ether.h>
+#include <rte_ethdev.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+#include <rte_udp.h>
+#include <rte_mbuf.h>
+#include <rte_virtio_net.h>
+
+#include "test.h"
+
+/*
+ * Check rte_vhost_offload_fallback() on the packets a guest hands over with
+ * checksum and TSO requests, as set up by rte_vhost_dequeue_burst(), for a
+ * port without offloads and for a port with the checksum offloads only:
+ * - a TSO packet, spread over several mbufs, is segmented into MSS sized
+ *   packets, with consecutive IP IDs and sequence numbers, the FIN and PSH
+ *   flags on the last segment, the CWR flag on the first one, and their
+ *   checksums computed or left to the port;
+ * - the checksums of a non TSO packet are completed in place;
+ * - a packet which does not fit in the output array is left untouched.
+ */
+
+#define OFFLOAD_NB_MBUF 64
+#define OFFLOAD_SEG_LEN 1200
+#define OFFLOAD_MSS 1000
+#define OFFLOAD_IP_ID 0xfffe
+#define OFFLOAD_SEQ 0xfffffc00
+#define OFFLOAD_TCP_FLAGS 0x99 /* CWR, ACK, PSH, FIN */
+#define OFFLOAD_TCP_FIN_PSH 0x09
+#define OFFLOAD_TCP_CWR 0x80
+
+#define OFFLOAD_FLAGS (PKT_TX_IP_CKSUM | PKT_TX_L4_MASK | PKT_TX_TCP_SEG)
+
+static uint8_t pkt_buf[8192];
+
+static inline uint8_t
+offload_payload_byte(uint32_t off)
+{
+	return (uint8_t)(off * 7 + 1);
+}
+
+/*
+ * Build a TCP or UDP packet over IPv4 or IPv6 with payload_len bytes of
+ * payload, in mbufs of at most OFFLOAD_SEG_LEN bytes, with the offload
+ * flags and the pseudo header checksum vhost sets for a guest request.
+ */
+static struct rte_mbuf *
+offload_build_pkt(struct rte_mempool *mp, int ipv6, uint8_t proto,
+	uint32_t payload_len, uint64_t ol_flags)
+{
+	uint32_t l3_len = ipv6 ? sizeof(struct ipv6_hdr) :
+		sizeof(struct ipv4_hdr);
+	uint32_t l4_len = (proto == IPPROTO_TCP) ? sizeof(struct tcp_hdr) :
+		sizeof(struct udp_hdr);
+	uint32_t hdr_len = sizeof(struct ether_hdr) + l3_len + l4_len;
+	uint32_t pkt_len = hdr_len + payload_len;
+	struct rte_mbuf *head, *m, *prev;
+	struct ether_hdr *eth;
+	void *l3_hdr, *l4_hdr;
+	uint32_t off, len, i;
+	char *data;
+
+	if (pkt_len > sizeof(pkt_buf))
+		return NULL;
+
+	memset(pkt_buf, 0, hdr_len);
+	eth = (struct ether_hdr *)pkt_buf;
+	eth->ether_type = rte_cpu_to_be_16(ipv6 ? ETHER_TYPE_IPv6 :
+		ETHER_TYPE_IPv4);
+	l3_hdr = eth + 1;
+	l4_hdr = (char *)l3_hdr + l3_len;
+	if (ipv6) {
+		struct ipv6_hdr *ip = l3_hdr;
+
+		ip->vtc_flow = rte_cpu_to_be_32(6 << 28);
+		ip->payload_len = rte_cpu_to_be_16(l4_len + payload_len);
+		ip->proto = proto;
+		ip->hop_limits = 64;
+		for (i = 0; i < sizeof(ip->src_addr); i++) {
+			ip->src_addr[i] = i;
+			ip->dst_addr[i] = 0xff - i;
+		}
+	} else {
+		struct ipv4_hdr *ip = l3_hdr;
+
+		ip->version_ihl = 0x45;
+		ip->total_length = rte_cpu_to_be_16(l3_len + l4_len +
+			payload_len);
+		ip->packet_id = rte_cpu_to_be_16(OFFLOAD_IP_ID);
+		ip->time_to_live = 64;
+		ip->next_proto_id = proto;
+		ip->src_addr = rte_cpu_to_be_32(IPv4(192, 168, 0, 1));
+		ip->dst_addr = rte_cpu_to_be_32(IPv4(192, 168, 0, 2));
+	}
+	if (proto == IPPROTO_TCP) {
+		struct tcp_hdr *tcp = l4_hdr;
+
+		tcp->src_port = rte_cpu_to_be_16(1024);
+		tcp->dst_port = rte_cpu_to_be_16(80);
+		tcp->sent_seq = rte_cpu_to_be_32(OFFLOAD_SEQ);
+		tcp->data_off = (sizeof(*tcp) / 4) << 4;
+		tcp->tcp_flags = OFFLOAD_TCP_FLAGS;
+		tcp->rx_win = rte_cpu_to_be_16(0xffff);
+		tcp->cksum = ipv6 ? rte_ipv6_phdr_cksum(l3_hdr, ol_flags) :
+			rte_ipv4_phdr_cksum(l3_hdr, ol_flags);
+	} else {
+		struct udp_hdr *udp = l4_hdr;
+
+		udp->src_port = rte_cpu_to_be_16(1024);
+		udp->dst_port = rte_cpu_to_be_16(53);
+		udp->dgram_len = rte_cpu_to_be_16(l4_len + payload_len);
+		udp->dgram_cksum = ipv6 ? rte_ipv6_phdr_cksum(l3_hdr, 0) :
+			rte_ipv4_phdr_cksum(l3_hdr, 0);
+	}
+	for (off = 0; off < payload_len; off++)
+		pkt_buf[hdr_len + off] = offload_payload_byte(off);
+
+	head = NULL;
+	prev = NULL;
+	for (off = 0; off < pkt_len; off += len) {
+		m = rte_pktmbuf_alloc(mp);
+		if (m == NULL) {
+			rte_pktmbuf_free(head);
+			return NULL;
+		}
+		len = RTE_MIN(pkt_len - off, (uint32_t)OFFLOAD_SEG_LEN);
+		data = rte_pktmbuf_append(m, len);
+		memcpy(data, pkt_buf + off, len);
+		if (head == NULL) {
+			head = m;
+		} else {
+			prev->next = m;
+			head->nb_segs++;
+			head->pkt_len += len;
+		}
+		prev = m;
+	}
+
+	head->l2_len = sizeof(struct ether_hdr);
+	head->l3_len = l3_len;
+	head->l4_len = l4_len;
+	head->ol_flags = ol_flags | (ipv6 ? PKT_TX_IPV6 : PKT_TX_IPV4);
+	if (ol_flags & PKT_TX_TCP_SEG)
+		head->tso_segsz = OFFLOAD_MSS;
+
+	return head;
+}
+
+/* Copy a packet into pkt_buf. */
+static int
+offload_read_pkt(struct rte_mbuf *m)
+{
+	uint32_t off = 0;
+
+	if (rte_pktmbuf_pkt_len(m) > sizeof(pkt_buf))
+		return -1;
+	for (; m != NULL; m = m->next) {
+		memcpy(pkt_buf + off, rte_pktmbuf_mtod(m, void *),
+			rte_pktmbuf_data_len(m));
+		off += rte_pktmbuf_data_len(m);
+	}
+	return 0;
+}
+
+static uint16_t
+offload_cksum_add(uint16_t a, uint16_t b)
+{
+	uint32_t sum = (uint32_t)a + b;
+
+	return (uint16_t)((sum >> 16) + (sum & 0xffff));
+}
+
+/*
+ * Check the checksums of the packet copied in pkt_buf: a valid checksum
+ * sums up to 0xffff with the data it covers. The checksums left to the
+ * port must instead be 0 for IPv4 and the pseudo header one for L4.
+ */
+static int
+offload_check_cksums(int ipv6, uint8_t proto, uint64_t hw_flags)
+{
+	void *l3_hdr = pkt_buf + sizeof(struct ether_hdr);
+	uint32_t l3_len, l4_len;
+	uint16_t phdr, l4_cksum;
+	void *l4_hdr;
+
+	if (ipv6) {
+		struct ipv6_hdr *ip = l3_hdr;
+
+		l3_len = sizeof(*ip);
+		l4_len = rte_be_to_cpu_16(ip->payload_len);
+		phdr = rte_ipv6_phdr_cksum(ip, 0);
+	} else {
+		struct ipv4_hdr *ip = l3_hdr;
+
+		l3_len = sizeof(*ip);
+		l4_len = rte_be_to_cpu_16(ip->total_length) - l3_len;
+		phdr = rte_ipv4_phdr_cksum(ip, 0);
+		if (hw_flags & PKT_TX_IP_CKSUM)
+			TEST_ASSERT_EQUAL(ip->hdr_checksum, 0,
+				"IPv4 checksum set for the port");
+		else
+			TEST_ASSERT_EQUAL(rte_raw_cksum(ip, l3_len), 0xffff,
+				"Wrong IPv4 checksum");
+	}
+
+	l4_hdr = (char *)l3_hdr + l3_len;
+	l4_cksum = (proto == IPPROTO_TCP) ?
+		((struct tcp_hdr *)l4_hdr)->cksum :
+		((struct udp_hdr *)l4_hdr)->dgram_cksum;
+	if (hw_flags & PKT_TX_L4_MASK)
+		TEST_ASSERT_EQUAL(l4_cksum, phdr,
+			"No pseudo header checksum for the port");
+	else
+		TEST_ASSERT_EQUAL(offload_cksum_add(rte_raw_cksum(l4_hdr,
+			l4_len), phdr), 0xffff, "Wrong L4 checksum");
+
+	return 0;
+}
+
+static int
+offload_check_tso(struct rte_mempool *mp, int ipv6, uint32_t payload_len,
+	uint32_t tx_offload_capa)
+{
+	uint32_t l3_len = ipv6 ? sizeof(struct ipv6_hdr) :
+		sizeof(struct ipv4_hdr);
+	uint32_t hdr_len = sizeof(struct ether_hdr) + l3_len +
+		sizeof(struct tcp_hdr);
+	uint32_t nb_segs = (payload_len + OFFLOAD_MSS - 1) / OFFLOAD_MSS;
+	uint64_t hw_flags = 0;
+	struct rte_mbuf *pkt, *segs[16];
+	struct tcp_hdr *tcp;
+	uint32_t i, off, len;
+	int ret, n;
+
+	pkt = offload_build_pkt(mp, ipv6, IPPROTO_TCP, payload_len,
+		PKT_TX_TCP_SEG | (ipv6 ? 0 : PKT_TX_IP_CKSUM));
+	TEST_ASSERT_NOT_NULL(pkt, "Cannot build TSO packet");
+
+	if (!ipv6 && (tx_offload_capa & DEV_TX_OFFLOAD_IPV4_CKSUM))
+		hw_flags |= PKT_TX_IP_CKSUM;
+	if (tx_offload_capa & DEV_TX_OFFLOAD_TCP_CKSUM)
+		hw_flags |= PKT_TX_TCP_CKSUM;
+
+	n = rte_vhost_offload_fallback(pkt, tx_offload_capa, mp, segs,
+		RTE_DIM(segs));
+	TEST_ASSERT_EQUAL(n, (int)nb_segs, "Wrong number of segments %d", n);
+
+	ret = 0;
+	for (i = 0; i < nb_segs && ret == 0; i++) {
+		off = i * OFFLOAD_MSS;
+		len = RTE_MIN(payload_len - off, (uint32_t)OFFLOAD_MSS);
+		if (segs[i]->nb_segs != 1 ||
+				rte_pktmbuf_pkt_len(segs[i]) != hdr_len + len ||
+				(segs[i]->ol_flags & OFFLOAD_FLAGS) != hw_flags ||
+				offload_read_pkt(segs[i]) < 0) {
+			printf("Wrong segment %u\n", i);
+			ret = -1;
+			break;
+		}
+
+		if (ipv6) {
+			struct ipv6_hdr *ip = (struct ipv6_hdr *)
+				(pkt_buf + sizeof(struct ether_hdr));
+
+			if (rte_be_to_cpu_16(ip->payload_len) !=
+					sizeof(struct tcp_hdr) + len)
+				ret = -1;
+		} else {
+			struct ipv4_hdr *ip = (struct ipv4_hdr *)
+				(pkt_buf + sizeof(struct ether_hdr));
+
+			if (rte_be_to_cpu_16(ip->total_length) !=
+					l3_len + sizeof(struct tcp_hdr) + len ||
+					rte_be_to_cpu_16(ip->packet_id) !=
+					(uint16_t)(OFFLOAD_IP_ID + i))
+				ret = -1;
+		}
+		if (ret < 0) {
+			printf("Wrong IP header in segment %u\n", i);
+			break;
+		}
+
+		tcp = (struct tcp_hdr *)(pkt_buf + hdr_len -
+			sizeof(struct tcp_hdr));
+		if (rte_be_to_cpu_32(tcp->sent_seq) !=
+				(uint32_t)(OFFLOAD_SEQ + off) ||
+				(tcp->tcp_flags & OFFLOAD_TCP_FIN_PSH) !=
+				(i == nb_segs - 1 ? OFFLOAD_TCP_FIN_PSH : 0) ||
+				(tcp->tcp_flags & OFFLOAD_TCP_CWR) !=
+				(i == 0 ? OFFLOAD_TCP_CWR : 0) ||
+				(tcp->tcp_flags | OFFLOAD_TCP_FIN_PSH |
+				OFFLOAD_TCP_CWR) != OFFLOAD_TCP_FLAGS) {
+			printf("Wrong TCP header in segment %u\n", i);
+			ret = -1;
+			break;
+		}
+
+		for (; off < i * OFFLOAD_MSS + len; off++)
+			if (pkt_buf[hdr_len + off - i * OFFLOAD_MSS] !=
+					offload_payload_byte(off))
+				break;
+		if (off != i * OFFLOAD_MSS + len) {
+			printf("Wrong payload in segment %u\n", i);
+			ret = -1;
+			break;
+		}
+
+		ret = offload_check_cksums(ipv6, IPPROTO_TCP, hw_flags);
+	}
+
+	for (i = 0; i < nb_segs; i++)
+		rte_pktmbuf_free(segs[i]);
+
+	return ret;
+}
+
+static int
+offload_check_cksum(struct rte_mempool *mp, int ipv6, uint8_t proto,
+	uint32_t tx_offload_capa)
+{
+	uint64_t l4_flag = (proto == IPPROTO_TCP) ? PKT_TX_TCP_CKSUM :
+		PKT_TX_UDP_CKSUM;
+	uint64_t l4_capa = (proto == IPPROTO_TCP) ? DEV_TX_OFFLOAD_TCP_CKSUM :
+		DEV_TX_OFFLOAD_UDP_CKSUM;
+	uint64_t hw_flags = 0;
+	struct rte_mbuf *pkt, *out;
+	int n, ret;
+
+	pkt = offload_build_pkt(mp, ipv6, proto, 3000,
+		l4_flag | (ipv6 ? 0 : PKT_TX_IP_CKSUM));
+	TEST_ASSERT_NOT_NULL(pkt, "Cannot build packet");
+
+	if (!ipv6 && (tx_offload_capa & DEV_TX_OFFLOAD_IPV4_CKSUM))
+		hw_flags |= PKT_TX_IP_CKSUM;
+	if (tx_offload_capa & l4_capa)
+		hw_flags |= l4_flag;
+
+	n = rte_vhost_offload_fallback(pkt, tx_offload_capa, mp, &out, 1);
+	if (n != 1 || out != pkt || pkt->nb_segs != 3 ||
+			(pkt->ol_flags & OFFLOAD_FLAGS) != hw_flags ||
+			offload_read_pkt(pkt) < 0) {
+		printf("Wrong checksum fallback\n");
+		ret = -1;
+	} else {
+		ret = offload_check_cksums(ipv6, proto, hw_flags);
+	}
+	rte_pktmbuf_free(pkt);
+
+	return ret;
+}
+
+/* A TSO packet which does not fit in the output array is kept. */
+static int
+offload_check_nospace(struct rte_mempool *mp)
+{
+	struct rte_mbuf *pkt, *segs[2];
+	int n;
+
+	pkt = offload_build_pkt(mp, 0, IPPROTO_TCP, 3 * OFFLOAD_MSS,
+		PKT_TX_TCP_SEG | PKT_TX_IP_CKSUM);
+	TEST_ASSERT_NOT_NULL(pkt, "Cannot build TSO packet");
+
+	n = rte_vhost_offload_fallback(pkt, 0, mp, segs, RTE_DIM(segs));
+	if (n != -ENOSPC || rte_mempool_count(mp) !=
+			OFFLOAD_NB_MBUF - (unsigned)pkt->nb_segs) {
+		printf("Wrong handling of a short output array\n");
+		rte_pktmbuf_free(pkt);
+		return -1;
+	}
+	rte_pktmbuf_free(pkt);
+
+	return 0;
+}
+
+static int
+test_vhost_offload(void)
+{
+	const uint32_t capas[] = {
+		0,
+		DEV_TX_OFFLOAD_IPV4_CKSUM | DEV_TX_OFFLOAD_TCP_CKSUM |
+			DEV_TX_OFFLOAD_UDP_CKSUM,
+	};
+	struct rte_mempool *mp;
+	unsigned i;
+	int ipv6;
+
+	mp = rte_mempool_lookup("vhost_offload_pool");
+	if (mp == NULL)
+		mp = rte_pktmbuf_pool_create("vhost_offload_pool",
+			OFFLOAD_NB_MBUF, 0, 0, RTE_MBUF_DEFAULT_BUF_SIZE,
+			SOCKET_ID_ANY);
+	TEST_ASSERT_NOT_NULL(mp, "Cannot create mbuf pool");
+
+	for (i = 0; i < RTE_DIM(capas); i++) {
+		for (ipv6 = 0; ipv6 <= 1; ipv6++) {
+			/* several segments, the last one short, or just one */
+			TEST_ASSERT_SUCCESS(offload_check_tso(mp, ipv6,
+				4 * OFFLOAD_MSS + 500, capas[i]),
+				"TSO fallback failed");
+			TEST_ASSERT_SUCCESS(offload_check_tso(mp, ipv6,
+				OFFLOAD_MSS, capas[i]),
+				"TSO fallback of one segment failed");
+			TEST_ASSERT_SUCCESS(offload_check_cksum(mp, ipv6,
+				IPPROTO_TCP, capas[i]),
+				"TCP checksum fallback failed");
+			TEST_ASSERT_SUCCESS(offload_check_cksum(mp, ipv6,
+				IPPROTO_UDP, capas[i]),
+				"UDP checksum fallback failed");
+		}
+	}
+	TEST_ASSERT_SUCCESS(offload_check_nospace(mp),
+		"TSO fallback without room failed");
+
+	TEST_ASSERT_EQUAL(rte_mempool_count(mp), OFFLOAD_NB_MBUF,
+		"Leaked mbufs");
+
+	return 0;
+}
+
+static struct test_command vhost_offload_cmd = {
+	.command = "vhost_offload_autotest",
+	.callback = test_vhost_offload,
+};
+REGISTER_TEST_COMMAND(vhost_offload_cmd);
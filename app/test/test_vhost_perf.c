@@ -0,0 +1,838 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <linux/vhost.h>
+
+#include <rte_cycles.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_memzone.h>
+#include <rte_virtio_net.h>
+#include <rte_vhost_async.h>
+
+#include "test.h"
+
+/*
+ * Measure the cost of rte_vhost_dequeue_burst() with and without zero copy,
+ * for packet sizes from 64 bytes to 9 KB. The guest is emulated in a
+ * memzone: each packet is a header descriptor chained to a data
+ * descriptor, and the used descriptors are made available again after
+ * each burst. The dequeued mbufs are freed at once, as a NIC would do
+ * after their transmission.
+ *
+ * The cost of rte_vhost_enqueue_burst() is measured the same way, with and
+ * without mergeable RX buffers.
+ *
+ * Both are then measured with the guest using a packed virtqueue, the
+ * descriptors of a burst being given back with a single used descriptor
+ * when the guest negotiates in-order completion.
+ *
+ * Last, the enqueue is measured with the dirty page logging of a live
+ * migration, and the pages of all the buffers and of the used ring are
+ * checked to be in the log.
+ *
+ * Finally, when a second lcore runs the software copy engine, the cycles
+ * spent by the vhost core in the asynchronous enqueue are compared with
+ * the synchronous one, and the last packets given to the guest are checked,
+ * as well as the dirty page log when the copies complete during a live
+ * migration.
+ */
+
+#define VHOST_PERF_RING_SIZE 256
+#define VHOST_PERF_NB_PKTS (VHOST_PERF_RING_SIZE / 2)
+#define VHOST_PERF_MAX_PKT_LEN 9216
+#define VHOST_PERF_BURST 32
+#define VHOST_PERF_ITERATIONS 100000
+#define VHOST_PERF_NB_MBUF 2048
+#define VHOST_PERF_MRG_BUF_LEN 1536
+#define VHOST_PERF_LOG_PAGE 4096
+#define VHOST_PERF_PKT_BYTE 0x5a
+
+static const unsigned pkt_sizes[] = { 64, 256, 1024, 1518, 4096, 9000 };
+
+struct vhost_perf_guest {
+	struct virtio_net *dev;
+	struct vhost_virtqueue *vq;
+	const struct rte_memzone *mz;
+	uint16_t last_used_idx;
+	/* packed virtqueue */
+	struct vring_packed_desc *desc_init;	/* descriptors to make available */
+	uint16_t used_wrap_counter;
+	uint16_t chain_len;
+	/* dirty page log of the memzone pages, from 64-bit word log_first */
+	uint64_t *log;
+	uint64_t log_first;
+	struct vhost_log dev_log;
+};
+
+/* Turn the split vring set up by vhost_perf_guest_init() into a packed one. */
+static int
+vhost_perf_guest_init_packed(struct vhost_perf_guest *guest)
+{
+	struct vhost_virtqueue *vq = guest->vq;
+	struct vring_packed_desc *desc;
+	unsigned i;
+
+	guest->desc_init = malloc(vq->size * sizeof(*desc));
+	if (guest->desc_init == NULL)
+		return -1;
+
+	/* Available descriptors of the first lap, the buffer id of a chain
+	 * being the ring position of its head.
+	 */
+	guest->chain_len = (vq->desc[0].flags & VRING_DESC_F_NEXT) ? 2 : 1;
+	for (i = 0; i < vq->size; i++) {
+		desc = &guest->desc_init[i];
+		desc->addr = vq->desc[i].addr;
+		desc->len = vq->desc[i].len;
+		desc->id = i - i % guest->chain_len;
+		desc->flags = vq->desc[i].flags & VRING_DESC_F_NEXT;
+	}
+
+	vq->desc_packed = (struct vring_packed_desc *)vq->desc;
+	for (i = 0; i < vq->size; i++) {
+		vq->desc_packed[i] = guest->desc_init[i];
+		vq->desc_packed[i].flags |= VRING_DESC_F_AVAIL;
+	}
+	vq->driver_event = (struct vring_packed_desc_event *)
+		&vq->desc_packed[vq->size];
+	vq->device_event = vq->driver_event + 1;
+	vq->driver_event->flags = VRING_EVENT_F_DISABLE;
+	vq->log_guest_addr = (uint64_t)(uintptr_t)vq->device_event;
+	vq->log_desc_addr = (uint64_t)(uintptr_t)vq->desc_packed;
+	vq->used_wrap_counter = 1;
+	guest->used_wrap_counter = 1;
+
+	return 0;
+}
+
+/*
+ * Emulate the guest side of queue_id. The buffers are buf_len bytes long,
+ * and prefixed with a header buffer unless they are mergeable RX buffers.
+ * The negotiated features select the mergeable RX buffers, the packed
+ * virtqueue layout and the dirty page logging.
+ */
+static int
+vhost_perf_guest_init(struct vhost_perf_guest *guest, uint16_t queue_id,
+	unsigned buf_len, int zero_copy, uint64_t features)
+{
+	struct vhost_virtqueue *vq;
+	struct virtio_net *dev;
+	struct vring_desc *desc;
+	size_t ring_len, len;
+	uint64_t gpa, buf;
+	unsigned i;
+
+	/* the descriptors, the available and the used rings, the buffers */
+	ring_len = RTE_ALIGN(vring_size(VHOST_PERF_RING_SIZE, 4096), 4096);
+	len = ring_len + VHOST_PERF_NB_PKTS * (VHOST_PERF_MAX_PKT_LEN +
+		RTE_CACHE_LINE_SIZE);
+	guest->mz = rte_memzone_lookup("vhost_perf");
+	if (guest->mz == NULL)
+		guest->mz = rte_memzone_reserve_aligned("vhost_perf", len,
+			rte_socket_id(), 0, 4096);
+	if (guest->mz == NULL)
+		return -1;
+	memset(guest->mz->addr, 0, ring_len);
+	guest->log = NULL;
+
+	dev = rte_zmalloc(NULL, sizeof(*dev), 0);
+	vq = rte_zmalloc(NULL, sizeof(*vq), 0);
+	if (dev == NULL || vq == NULL)
+		goto fail;
+	dev->mem = calloc(1, sizeof(*dev->mem) +
+		sizeof(struct virtio_memory_regions));
+	if (dev->mem == NULL)
+		goto fail;
+
+	/* the guest physical addresses are the virtual addresses */
+	gpa = (uint64_t)(uintptr_t)guest->mz->addr;
+	dev->mem->nregions = 1;
+	dev->mem->regions[0].guest_phys_address = gpa;
+	dev->mem->regions[0].guest_phys_address_end = gpa + len;
+	dev->mem->regions[0].memory_size = len;
+	dev->mem->regions[0].address_offset = 0;
+	dev->virt_qp_nb = 1;
+	dev->virtqueue[queue_id] = vq;
+
+	if (zero_copy) {
+		dev->dequeue_zero_copy = 1;
+		dev->guest_pages = calloc(1, sizeof(*dev->guest_pages));
+		vq->zmbufs = rte_zmalloc(NULL,
+			VHOST_PERF_RING_SIZE * sizeof(*vq->zmbufs), 0);
+		if (dev->guest_pages == NULL || vq->zmbufs == NULL)
+			goto fail;
+		dev->nr_guest_pages = 1;
+		dev->guest_pages[0].guest_phys_addr = gpa;
+		dev->guest_pages[0].host_phys_addr = guest->mz->phys_addr;
+		dev->guest_pages[0].size = len;
+	}
+
+	vq->size = VHOST_PERF_RING_SIZE;
+	vq->desc = guest->mz->addr;
+	vq->avail = (struct vring_avail *)&vq->desc[VHOST_PERF_RING_SIZE];
+	vq->used = (struct vring_used *)RTE_PTR_ALIGN_CEIL(
+		&vq->avail->ring[VHOST_PERF_RING_SIZE], 4096);
+	vq->vhost_hlen = sizeof(struct virtio_net_hdr);
+	vq->callfd = -1;
+	vq->kickfd = -1;
+	vq->enabled = 1;
+	vq->avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+	vq->log_guest_addr = (uint64_t)(uintptr_t)vq->used;
+
+	if (features & (1ULL << VHOST_F_LOG_ALL)) {
+		/* Only the part of the log covering the memzone is allocated. */
+		uint64_t last = (gpa + len - 1) / VHOST_PERF_LOG_PAGE / 64;
+
+		guest->log_first = gpa / VHOST_PERF_LOG_PAGE / 64;
+		guest->log = calloc(last - guest->log_first + 1,
+			sizeof(uint64_t));
+		if (guest->log == NULL)
+			goto fail;
+		memset(&guest->dev_log, 0, sizeof(guest->dev_log));
+		guest->dev_log.base = (uint64_t)(uintptr_t)guest->log -
+			guest->log_first * sizeof(uint64_t);
+		guest->dev_log.size = (last + 1) * sizeof(uint64_t);
+		dev->log = &guest->dev_log;
+	}
+
+	buf = gpa + ring_len;
+	dev->features = features;
+	if (features & (1ULL << VIRTIO_NET_F_MRG_RXBUF)) {
+		vq->vhost_hlen = sizeof(struct virtio_net_hdr_mrg_rxbuf);
+		for (i = 0; i < VHOST_PERF_RING_SIZE; i++) {
+			vq->desc[i].addr = buf;
+			vq->desc[i].len = VHOST_PERF_MRG_BUF_LEN;
+			vq->desc[i].flags = 0;
+			buf += VHOST_PERF_MRG_BUF_LEN;
+			vq->avail->ring[i] = i;
+		}
+		vq->avail->idx = VHOST_PERF_RING_SIZE;
+		goto done;
+	}
+
+	for (i = 0; i < VHOST_PERF_NB_PKTS; i++) {
+		desc = &vq->desc[2 * i];
+		desc->addr = buf;
+		desc->len = vq->vhost_hlen;
+		desc->flags = VRING_DESC_F_NEXT;
+		desc->next = 2 * i + 1;
+		desc = &vq->desc[2 * i + 1];
+		desc->addr = buf + RTE_CACHE_LINE_SIZE;
+		desc->len = buf_len;
+		desc->flags = 0;
+		memset((void *)(uintptr_t)desc->addr, i, buf_len);
+		buf += VHOST_PERF_MAX_PKT_LEN + RTE_CACHE_LINE_SIZE;
+
+		vq->avail->ring[i] = 2 * i;
+	}
+	vq->avail->idx = VHOST_PERF_NB_PKTS;
+
+done:
+	guest->dev = dev;
+	guest->vq = vq;
+	guest->last_used_idx = 0;
+	guest->desc_init = NULL;
+	if ((features & (1ULL << VIRTIO_F_RING_PACKED)) &&
+			vhost_perf_guest_init_packed(guest) < 0)
+		goto fail;
+	return 0;
+
+fail:
+	free(guest->log);
+	if (dev != NULL) {
+		free(dev->guest_pages);
+		free(dev->mem);
+	}
+	if (vq != NULL)
+		rte_free(vq->zmbufs);
+	rte_free(vq);
+	rte_free(dev);
+	return -1;
+}
+
+static void
+vhost_perf_guest_free(struct vhost_perf_guest *guest)
+{
+	free(guest->desc_init);
+	free(guest->log);
+	free(guest->dev->guest_pages);
+	free(guest->dev->mem);
+	rte_free(guest->vq->zmbufs);
+	rte_free(guest->vq);
+	rte_free(guest->dev);
+}
+
+/*
+ * Make the used descriptors of a packed virtqueue available again. The
+ * buffers cover the whole ring, so a chain is made available again at the
+ * position it was used from. A used descriptor may stand for all the
+ * chains up to the one of its buffer id.
+ */
+static void
+vhost_perf_guest_refill_packed(struct vhost_perf_guest *guest)
+{
+	struct vhost_virtqueue *vq = guest->vq;
+	struct vring_packed_desc *desc;
+	uint16_t idx = guest->last_used_idx, wrap = guest->used_wrap_counter;
+	uint16_t flags, id, head, avail_flags, i;
+
+	for (;;) {
+		flags = *(volatile uint16_t *)&vq->desc_packed[idx].flags;
+		if (!!(flags & VRING_DESC_F_AVAIL) != wrap ||
+				!!(flags & VRING_DESC_F_USED) != wrap)
+			break;
+		rte_smp_rmb();
+		id = vq->desc_packed[idx].id;
+
+		/* the next lap is available with the other wrap counter */
+		avail_flags = wrap ? VRING_DESC_F_USED : VRING_DESC_F_AVAIL;
+		do {
+			head = idx;
+			for (i = 1; i < guest->chain_len; i++) {
+				desc = &vq->desc_packed[idx + i];
+				*desc = guest->desc_init[idx + i];
+				desc->flags |= avail_flags;
+			}
+			desc = &vq->desc_packed[idx];
+			desc->id = guest->desc_init[idx].id;
+			desc->len = guest->desc_init[idx].len;
+			rte_smp_wmb();
+			desc->flags = guest->desc_init[idx].flags | avail_flags;
+
+			idx += guest->chain_len;
+			if (idx == vq->size) {
+				idx = 0;
+				wrap ^= 1;
+				avail_flags = wrap ? VRING_DESC_F_USED :
+					VRING_DESC_F_AVAIL;
+			}
+		} while (head != id);
+	}
+
+	guest->last_used_idx = idx;
+	guest->used_wrap_counter = wrap;
+}
+
+/* Make the descriptors put in the used ring available again. */
+static void
+vhost_perf_guest_refill(struct vhost_perf_guest *guest)
+{
+	struct vhost_virtqueue *vq = guest->vq;
+	uint16_t used_idx, avail_idx;
+
+	if (guest->desc_init != NULL) {
+		vhost_perf_guest_refill_packed(guest);
+		return;
+	}
+
+	used_idx = *(volatile uint16_t *)&vq->used->idx;
+	avail_idx = vq->avail->idx;
+
+	while (guest->last_used_idx != used_idx) {
+		vq->avail->ring[avail_idx++ & (vq->size - 1)] =
+			vq->used->ring[guest->last_used_idx++ &
+				(vq->size - 1)].id;
+	}
+	rte_compiler_barrier();
+	vq->avail->idx = avail_idx;
+}
+
+static int
+vhost_perf_dequeue(struct rte_mempool *mp, unsigned pkt_len, int zero_copy,
+	uint64_t features, uint64_t *cycles_per_pkt)
+{
+	struct vhost_perf_guest guest;
+	struct rte_mbuf *pkts[VHOST_PERF_BURST];
+	uint64_t start, cycles = 0, nb_pkts = 0;
+	uint16_t nb_rx, i;
+	unsigned iter;
+
+	if (vhost_perf_guest_init(&guest, VIRTIO_TXQ, pkt_len, zero_copy,
+			features) < 0) {
+		printf("Cannot emulate the guest\n");
+		return -1;
+	}
+
+	for (iter = 0; iter < VHOST_PERF_ITERATIONS; iter++) {
+		start = rte_rdtsc();
+		nb_rx = rte_vhost_dequeue_burst(guest.dev, VIRTIO_TXQ, mp,
+			pkts, VHOST_PERF_BURST);
+		for (i = 0; i < nb_rx; i++)
+			rte_pktmbuf_free(pkts[i]);
+		cycles += rte_rdtsc() - start;
+		nb_pkts += nb_rx;
+
+		vhost_perf_guest_refill(&guest);
+	}
+
+	/* give the last buffers back */
+	rte_vhost_dequeue_burst(guest.dev, VIRTIO_TXQ, mp, pkts, 0);
+	vhost_perf_guest_free(&guest);
+
+	if (nb_pkts == 0) {
+		printf("No packet dequeued\n");
+		return -1;
+	}
+	*cycles_per_pkt = cycles / nb_pkts;
+	return 0;
+}
+
+static int
+vhost_perf_logged(struct vhost_perf_guest *guest, uint64_t gpa)
+{
+	uint64_t page = gpa / VHOST_PERF_LOG_PAGE;
+
+	return !!(guest->log[page / 64 - guest->log_first] &
+		(1ULL << (page % 64)));
+}
+
+/* Check that the pages of the used ring and of all the buffers are logged. */
+static int
+vhost_perf_check_log(struct vhost_perf_guest *guest)
+{
+	struct vhost_virtqueue *vq = guest->vq;
+	uint64_t addr;
+	unsigned i;
+
+	addr = guest->desc_init != NULL ? vq->log_desc_addr :
+		vq->log_guest_addr;
+	if (!vhost_perf_logged(guest, addr)) {
+		printf("Used ring page not logged\n");
+		return -1;
+	}
+
+	for (i = 0; i < vq->size; i++) {
+		addr = guest->desc_init != NULL ? guest->desc_init[i].addr :
+			vq->desc[i].addr;
+		if (!vhost_perf_logged(guest, addr)) {
+			printf("Page of buffer %u not logged\n", i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Check the packets put in the used ring of a split virtqueue from used_idx:
+ * a virtio header followed by pkt_len bytes of VHOST_PERF_PKT_BYTE.
+ */
+static int
+vhost_perf_check_rx(struct vhost_perf_guest *guest, uint16_t used_idx,
+	unsigned pkt_len)
+{
+	struct vhost_virtqueue *vq = guest->vq;
+	struct virtio_net_hdr_mrg_rxbuf *hdr;
+	struct vring_used_elem *elem;
+	struct vring_desc *desc;
+	const uint8_t *buf;
+	uint32_t len, n, skip, i, total = 0;
+	uint16_t nr_bufs = 0;
+
+	for (; used_idx != vq->used->idx; used_idx++) {
+		elem = &vq->used->ring[used_idx & (vq->size - 1)];
+		desc = &vq->desc[elem->id];
+		len = elem->len;
+		skip = 0;
+		if (nr_bufs == 0) {
+			/* first buffer of a packet */
+			hdr = (struct virtio_net_hdr_mrg_rxbuf *)(uintptr_t)
+				desc->addr;
+			nr_bufs = vq->vhost_hlen == sizeof(*hdr) ?
+				hdr->num_buffers : 1;
+			skip = vq->vhost_hlen;
+			total = 0;
+			if (nr_bufs == 0) {
+				printf("No buffer in used entry %u\n",
+					used_idx);
+				return -1;
+			}
+		}
+		nr_bufs--;
+
+		for (;;) {
+			n = RTE_MIN(len, desc->len);
+			buf = (const uint8_t *)(uintptr_t)desc->addr;
+			for (i = skip; i < n; i++) {
+				if (buf[i] != VHOST_PERF_PKT_BYTE) {
+					printf("Bad data in used entry %u\n",
+						used_idx);
+					return -1;
+				}
+			}
+			total += n - RTE_MIN(skip, n);
+			skip -= RTE_MIN(skip, n);
+			len -= n;
+			if (len == 0 || !(desc->flags & VRING_DESC_F_NEXT))
+				break;
+			desc = &vq->desc[desc->next];
+		}
+
+		if (nr_bufs == 0 && total != pkt_len) {
+			printf("Packet of %u bytes instead of %u\n", total,
+				pkt_len);
+			return -1;
+		}
+	}
+
+	if (nr_bufs != 0) {
+		printf("Incomplete packet in the used ring\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Allocate a packet of pkt_len bytes, chained if it doesn't fit in an mbuf. */
+static struct rte_mbuf *
+vhost_perf_alloc_pkt(struct rte_mempool *mp, unsigned pkt_len)
+{
+	struct rte_mbuf *m, *seg;
+	unsigned len;
+
+	m = rte_pktmbuf_alloc(mp);
+	if (m == NULL)
+		return NULL;
+
+	for (seg = m; ; ) {
+		len = RTE_MIN(pkt_len - m->pkt_len,
+			(unsigned)rte_pktmbuf_tailroom(seg));
+		memset(rte_pktmbuf_mtod(seg, void *), VHOST_PERF_PKT_BYTE, len);
+		seg->data_len = len;
+		m->pkt_len += len;
+		if (m->pkt_len == pkt_len)
+			break;
+
+		seg->next = rte_pktmbuf_alloc(mp);
+		if (seg->next == NULL) {
+			rte_pktmbuf_free(m);
+			return NULL;
+		}
+		seg = seg->next;
+		m->nb_segs++;
+	}
+
+	return m;
+}
+
+/*
+ * Wait for the copy engine to complete the nb_pkts packets in flight.
+ * Returns the number of packets left.
+ */
+static uint64_t
+vhost_perf_async_drain(struct vhost_perf_guest *guest, uint64_t nb_pkts)
+{
+	struct rte_mbuf *pkts[VHOST_PERF_BURST];
+	uint64_t deadline = rte_get_timer_cycles() + rte_get_timer_hz();
+
+	while (nb_pkts != 0 && rte_get_timer_cycles() < deadline)
+		nb_pkts -= rte_vhost_poll_enqueue_completed(guest->dev,
+			VIRTIO_RXQ, pkts, VHOST_PERF_BURST);
+
+	return nb_pkts;
+}
+
+/*
+ * Give a last burst to the guest, with cleared buffers, and check the
+ * packets written by the copy engine.
+ */
+static int
+vhost_perf_async_check(struct vhost_perf_guest *guest, struct rte_mbuf **pkts,
+	unsigned pkt_len)
+{
+	struct vhost_virtqueue *vq = guest->vq;
+	uint16_t used_idx = vq->used->idx;
+	uint16_t nb_pkts;
+	unsigned i;
+
+	vhost_perf_guest_refill(guest);
+	for (i = 0; i < vq->size; i++)
+		memset((void *)(uintptr_t)vq->desc[i].addr, 0,
+			vq->desc[i].len);
+
+	nb_pkts = rte_vhost_submit_enqueue_burst(guest->dev, VIRTIO_RXQ, pkts,
+		VHOST_PERF_BURST);
+	if (nb_pkts == 0) {
+		printf("No packet submitted\n");
+		return -1;
+	}
+	if (vhost_perf_async_drain(guest, nb_pkts) != 0) {
+		printf("Asynchronous copies not completed\n");
+		return -1;
+	}
+
+	return vhost_perf_check_rx(guest, used_idx, pkt_len);
+}
+
+/*
+ * The enqueue is asynchronous if sw is not NULL, the copies being done by
+ * the lcore running sw. The same mbufs are submitted again while in flight,
+ * which is fine as they are only read.
+ */
+static int
+vhost_perf_enqueue(struct rte_mempool *mp, unsigned pkt_len, uint64_t features,
+	struct rte_vhost_async_sw *sw, uint64_t *cycles_per_pkt)
+{
+	struct rte_mbuf *done[VHOST_PERF_BURST];
+	uint64_t nb_in_flight = 0;
+	struct vhost_perf_guest guest;
+	struct rte_mbuf *pkts[VHOST_PERF_BURST];
+	uint64_t start, cycles = 0, nb_pkts = 0;
+	uint16_t nb_tx, i;
+	unsigned iter;
+	int ret = -1;
+
+	if (vhost_perf_guest_init(&guest, VIRTIO_RXQ, VHOST_PERF_MAX_PKT_LEN,
+			0, features) < 0) {
+		printf("Cannot emulate the guest\n");
+		return -1;
+	}
+
+	if (sw != NULL && rte_vhost_async_register(guest.dev, VIRTIO_RXQ,
+			&rte_vhost_async_sw_ops,
+			rte_vhost_async_sw_channel(sw, 0)) < 0) {
+		printf("Cannot register the copy engine\n");
+		vhost_perf_guest_free(&guest);
+		return -1;
+	}
+
+	for (i = 0; i < VHOST_PERF_BURST; i++) {
+		pkts[i] = vhost_perf_alloc_pkt(mp, pkt_len);
+		if (pkts[i] == NULL) {
+			printf("Cannot allocate the packets\n");
+			goto out;
+		}
+	}
+
+	for (iter = 0; iter < VHOST_PERF_ITERATIONS; iter++) {
+		start = rte_rdtsc();
+		if (sw == NULL) {
+			nb_tx = rte_vhost_enqueue_burst(guest.dev, VIRTIO_RXQ,
+				pkts, VHOST_PERF_BURST);
+		} else {
+			nb_in_flight += rte_vhost_submit_enqueue_burst(
+				guest.dev, VIRTIO_RXQ, pkts, VHOST_PERF_BURST);
+			nb_tx = rte_vhost_poll_enqueue_completed(guest.dev,
+				VIRTIO_RXQ, done, VHOST_PERF_BURST);
+			nb_in_flight -= nb_tx;
+		}
+		cycles += rte_rdtsc() - start;
+		nb_pkts += nb_tx;
+
+		vhost_perf_guest_refill(&guest);
+	}
+
+	if (nb_pkts == 0) {
+		printf("No packet enqueued\n");
+		goto out;
+	}
+	if (sw != NULL) {
+		nb_in_flight = vhost_perf_async_drain(&guest, nb_in_flight);
+		if (nb_in_flight != 0) {
+			printf("Asynchronous copies not completed\n");
+			goto out;
+		}
+	}
+	/* the asynchronous copies are logged at their completion */
+	if (guest.log != NULL && vhost_perf_check_log(&guest) < 0)
+		goto out;
+	if (sw != NULL && vhost_perf_async_check(&guest, pkts, pkt_len) < 0)
+		goto out;
+	*cycles_per_pkt = cycles / nb_pkts;
+	ret = 0;
+
+out:
+	/* The guest memory is freed after the copies in flight. */
+	if (sw != NULL && (vhost_perf_async_drain(&guest, nb_in_flight) != 0 ||
+			rte_vhost_async_unregister(guest.dev, VIRTIO_RXQ) < 0))
+		return -1;
+	while (i != 0)
+		rte_pktmbuf_free(pkts[--i]);
+	vhost_perf_guest_free(&guest);
+	return ret;
+}
+
+static int
+test_vhost_perf(void)
+{
+	struct rte_mempool *mp;
+	const uint64_t packed = 1ULL << VIRTIO_F_RING_PACKED;
+	const uint64_t in_order = 1ULL << VIRTIO_F_IN_ORDER;
+	const uint64_t mrg = 1ULL << VIRTIO_NET_F_MRG_RXBUF;
+	const uint64_t log = 1ULL << VHOST_F_LOG_ALL;
+	uint64_t copy_cycles, zcopy_cycles;
+	uint64_t rx_cycles, mrg_rx_cycles;
+	uint64_t packed_tx_cycles, in_order_tx_cycles, packed_rx_cycles;
+	uint64_t log_rx_cycles, log_mrg_rx_cycles, log_packed_rx_cycles;
+	uint64_t async_rx_cycles, async_mrg_rx_cycles, async_log_rx_cycles;
+	struct rte_vhost_async_sw *sw;
+	unsigned i, lcore;
+	int ret = 0;
+
+	mp = rte_mempool_lookup("vhost_perf_pool");
+	if (mp == NULL)
+		mp = rte_pktmbuf_pool_create("vhost_perf_pool",
+			VHOST_PERF_NB_MBUF, 32, 0,
+			RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+	if (mp == NULL) {
+		printf("Cannot create the mbuf pool\n");
+		return -1;
+	}
+
+	printf("\n### rte_vhost_dequeue_burst() cycles per packet ###\n");
+	printf("%8s %10s %10s\n", "size", "copy", "zero copy");
+	for (i = 0; i < RTE_DIM(pkt_sizes); i++) {
+		if (vhost_perf_dequeue(mp, pkt_sizes[i], 0, 0,
+					&copy_cycles) < 0 ||
+				vhost_perf_dequeue(mp, pkt_sizes[i], 1, 0,
+					&zcopy_cycles) < 0)
+			return -1;
+		printf("%8u %10"PRIu64" %10"PRIu64"\n", pkt_sizes[i],
+			copy_cycles, zcopy_cycles);
+	}
+
+	printf("\n### rte_vhost_enqueue_burst() cycles per packet ###\n");
+	printf("%8s %10s %10s\n", "size", "default", "mergeable");
+	for (i = 0; i < RTE_DIM(pkt_sizes); i++) {
+		if (vhost_perf_enqueue(mp, pkt_sizes[i], 0, NULL,
+					&rx_cycles) < 0 ||
+				vhost_perf_enqueue(mp, pkt_sizes[i], mrg,
+					NULL, &mrg_rx_cycles) < 0)
+			return -1;
+		printf("%8u %10"PRIu64" %10"PRIu64"\n", pkt_sizes[i],
+			rx_cycles, mrg_rx_cycles);
+	}
+
+	printf("\n### split vs packed virtqueue cycles per packet ###\n");
+	printf("%8s %10s %10s %10s %10s %10s\n", "size", "deq split",
+		"deq packed", "in order", "enq split", "enq packed");
+	for (i = 0; i < RTE_DIM(pkt_sizes); i++) {
+		if (vhost_perf_dequeue(mp, pkt_sizes[i], 0, 0,
+					&copy_cycles) < 0 ||
+				vhost_perf_dequeue(mp, pkt_sizes[i], 0, packed,
+					&packed_tx_cycles) < 0 ||
+				vhost_perf_dequeue(mp, pkt_sizes[i], 0,
+					packed | in_order,
+					&in_order_tx_cycles) < 0 ||
+				vhost_perf_enqueue(mp, pkt_sizes[i], mrg,
+					NULL, &rx_cycles) < 0 ||
+				vhost_perf_enqueue(mp, pkt_sizes[i],
+					packed | mrg, NULL,
+					&packed_rx_cycles) < 0)
+			return -1;
+		printf("%8u %10"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64
+			" %10"PRIu64"\n", pkt_sizes[i], copy_cycles,
+			packed_tx_cycles, in_order_tx_cycles, rx_cycles,
+			packed_rx_cycles);
+	}
+
+	printf("\n### rte_vhost_enqueue_burst() dirty log cycles per packet ###\n");
+	printf("%8s %10s %10s %10s %10s %10s %10s\n", "size", "default",
+		"logged", "mergeable", "logged", "packed", "logged");
+	for (i = 0; i < RTE_DIM(pkt_sizes); i++) {
+		if (vhost_perf_enqueue(mp, pkt_sizes[i], 0, NULL,
+					&rx_cycles) < 0 ||
+				vhost_perf_enqueue(mp, pkt_sizes[i], log,
+					NULL, &log_rx_cycles) < 0 ||
+				vhost_perf_enqueue(mp, pkt_sizes[i], mrg,
+					NULL, &mrg_rx_cycles) < 0 ||
+				vhost_perf_enqueue(mp, pkt_sizes[i], mrg | log,
+					NULL, &log_mrg_rx_cycles) < 0 ||
+				vhost_perf_enqueue(mp, pkt_sizes[i],
+					packed | mrg, NULL,
+					&packed_rx_cycles) < 0 ||
+				vhost_perf_enqueue(mp, pkt_sizes[i],
+					packed | mrg | log,
+					NULL, &log_packed_rx_cycles) < 0)
+			return -1;
+		printf("%8u %10"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64
+			" %10"PRIu64" %10"PRIu64"\n", pkt_sizes[i], rx_cycles,
+			log_rx_cycles, mrg_rx_cycles, log_mrg_rx_cycles,
+			packed_rx_cycles, log_packed_rx_cycles);
+	}
+
+	lcore = rte_get_next_lcore(rte_lcore_id(), 1, 0);
+	if (lcore >= RTE_MAX_LCORE) {
+		printf("\nNo lcore for the copy engine, asynchronous enqueue "
+			"not measured\n");
+		return 0;
+	}
+	sw = rte_vhost_async_sw_create("vhost_perf_sw", 1, rte_socket_id());
+	if (sw == NULL) {
+		printf("Cannot create the copy engine\n");
+		return -1;
+	}
+	rte_eal_remote_launch(rte_vhost_async_sw_run, sw, lcore);
+
+	printf("\n### asynchronous enqueue, vhost core cycles per packet ###\n");
+	printf("%8s %10s %10s %10s %10s %10s\n", "size", "default", "async",
+		"mergeable", "async", "logged");
+	for (i = 0; i < RTE_DIM(pkt_sizes); i++) {
+		if (vhost_perf_enqueue(mp, pkt_sizes[i], 0, NULL,
+					&rx_cycles) < 0 ||
+				vhost_perf_enqueue(mp, pkt_sizes[i], 0, sw,
+					&async_rx_cycles) < 0 ||
+				vhost_perf_enqueue(mp, pkt_sizes[i], mrg,
+					NULL, &mrg_rx_cycles) < 0 ||
+				vhost_perf_enqueue(mp, pkt_sizes[i], mrg,
+					sw, &async_mrg_rx_cycles) < 0 ||
+				vhost_perf_enqueue(mp, pkt_sizes[i], mrg | log,
+					sw, &async_log_rx_cycles) < 0) {
+			ret = -1;
+			break;
+		}
+		printf("%8u %10"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64
+			" %10"PRIu64"\n", pkt_sizes[i], rx_cycles,
+			async_rx_cycles, mrg_rx_cycles, async_mrg_rx_cycles,
+			async_log_rx_cycles);
+	}
+
+	rte_vhost_async_sw_stop(sw);
+	rte_eal_wait_lcore(lcore);
+	rte_vhost_async_sw_free(sw);
+
+	return ret;
+}
+
+static struct test_command vhost_perf_cmd = {
+	.command = "vhost_perf_autotest",
+	.callback = test_vhost_perf,
+};
+REGISTER_TEST_COMMAND(vhost_perf_cmd);
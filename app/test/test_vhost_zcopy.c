@@ -0,0 +1,353 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_cycles.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_memzone.h>
+#include <rte_virtio_net.h>
+
+#include "test.h"
+#include "../../lib/librte_vhost/vhost-net.h"
+
+/*
+ * Check the dequeue zero copy of vhost on a guest emulated in a memzone,
+ * each packet being a header descriptor chained to a data descriptor:
+ * - the mbufs point to the guest buffers, which are put in the used ring
+ *   once the mbufs are freed, in the order of their dequeue;
+ * - the short packets are copied, and their buffers given back at once;
+ * - the drain of a stopped device waits for the mbufs still in use, freed
+ *   by a second lcore after a delay if there is one, and gives all their
+ *   buffers back to the guest.
+ */
+
+#define ZCOPY_RING_SIZE 64
+#define ZCOPY_NB_PKTS 16
+#define ZCOPY_BUF_LEN 2048
+#define ZCOPY_PKT_LEN 1500
+#define ZCOPY_SHORT_PKT_LEN 64
+#define ZCOPY_NB_MBUF 128
+#define ZCOPY_FREE_DELAY_MS 100
+
+struct zcopy_guest {
+	struct virtio_net *dev;
+	struct vhost_virtqueue *vq;
+	const struct rte_memzone *mz;
+	uint64_t buf_base;
+};
+
+static int
+zcopy_guest_init(struct zcopy_guest *guest)
+{
+	struct vhost_virtqueue *vq;
+	struct virtio_net *dev;
+	size_t ring_len, len;
+	uint64_t gpa;
+
+	ring_len = RTE_ALIGN(vring_size(ZCOPY_RING_SIZE, 4096), 4096);
+	len = ring_len + ZCOPY_NB_PKTS * ZCOPY_BUF_LEN;
+	guest->mz = rte_memzone_lookup("vhost_zcopy");
+	if (guest->mz == NULL)
+		guest->mz = rte_memzone_reserve_aligned("vhost_zcopy", len,
+			rte_socket_id(), 0, 4096);
+	if (guest->mz == NULL)
+		return -1;
+	memset(guest->mz->addr, 0, len);
+
+	dev = rte_zmalloc(NULL, sizeof(*dev), 0);
+	vq = rte_zmalloc(NULL, sizeof(*vq), 0);
+	if (dev == NULL || vq == NULL)
+		goto fail;
+	dev->mem = calloc(1, sizeof(*dev->mem) +
+		sizeof(struct virtio_memory_regions));
+	dev->guest_pages = calloc(1, sizeof(*dev->guest_pages));
+	vq->zmbufs = rte_zmalloc(NULL,
+		ZCOPY_RING_SIZE * sizeof(*vq->zmbufs), 0);
+	if (dev->mem == NULL || dev->guest_pages == NULL ||
+			vq->zmbufs == NULL)
+		goto fail;
+
+	/* the guest physical addresses are the virtual addresses */
+	gpa = (uint64_t)(uintptr_t)guest->mz->addr;
+	dev->mem->nregions = 1;
+	dev->mem->regions[0].guest_phys_address = gpa;
+	dev->mem->regions[0].guest_phys_address_end = gpa + len;
+	dev->mem->regions[0].memory_size = len;
+	dev->mem->regions[0].address_offset = 0;
+	dev->nr_guest_pages = 1;
+	dev->guest_pages[0].guest_phys_addr = gpa;
+	dev->guest_pages[0].host_phys_addr = guest->mz->phys_addr;
+	dev->guest_pages[0].size = len;
+	dev->dequeue_zero_copy = 1;
+	dev->virt_qp_nb = 1;
+	dev->virtqueue[VIRTIO_TXQ] = vq;
+
+	vq->size = ZCOPY_RING_SIZE;
+	vq->desc = guest->mz->addr;
+	vq->avail = (struct vring_avail *)&vq->desc[ZCOPY_RING_SIZE];
+	vq->used = (struct vring_used *)RTE_PTR_ALIGN_CEIL(
+		&vq->avail->ring[ZCOPY_RING_SIZE], 4096);
+	vq->vhost_hlen = sizeof(struct virtio_net_hdr);
+	vq->callfd = -1;
+	vq->kickfd = -1;
+	vq->enabled = 1;
+	vq->avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+
+	guest->dev = dev;
+	guest->vq = vq;
+	guest->buf_base = gpa + ring_len;
+	return 0;
+
+fail:
+	if (dev != NULL) {
+		free(dev->guest_pages);
+		free(dev->mem);
+	}
+	if (vq != NULL)
+		rte_free(vq->zmbufs);
+	rte_free(vq);
+	rte_free(dev);
+	return -1;
+}
+
+static void
+zcopy_guest_free(struct zcopy_guest *guest)
+{
+	free(guest->dev->guest_pages);
+	free(guest->dev->mem);
+	rte_free(guest->vq->zmbufs);
+	rte_free(guest->vq);
+	rte_free(guest->dev);
+}
+
+/* Data buffer of packet i, in the guest memory. */
+static inline void *
+zcopy_buf(struct zcopy_guest *guest, unsigned i)
+{
+	return (void *)(uintptr_t)(guest->buf_base + i * ZCOPY_BUF_LEN +
+		RTE_CACHE_LINE_SIZE);
+}
+
+/* Make packet i available, with len bytes of data. */
+static void
+zcopy_guest_send(struct zcopy_guest *guest, unsigned i, uint32_t len)
+{
+	struct vhost_virtqueue *vq = guest->vq;
+	struct vring_desc *desc;
+
+	desc = &vq->desc[2 * i];
+	desc->addr = guest->buf_base + i * ZCOPY_BUF_LEN;
+	desc->len = vq->vhost_hlen;
+	desc->flags = VRING_DESC_F_NEXT;
+	desc->next = 2 * i + 1;
+	desc = &vq->desc[2 * i + 1];
+	desc->addr = (uint64_t)(uintptr_t)zcopy_buf(guest, i);
+	desc->len = len;
+	desc->flags = 0;
+	memset(zcopy_buf(guest, i), i + 1, len);
+
+	vq->avail->ring[vq->avail->idx & (vq->size - 1)] = 2 * i;
+	rte_compiler_barrier();
+	vq->avail->idx++;
+}
+
+/* Check that the used ring holds the packets of ids from entry used_idx. */
+static int
+zcopy_check_used(struct zcopy_guest *guest, uint16_t used_idx,
+	const unsigned *ids, unsigned nb_ids)
+{
+	struct vhost_virtqueue *vq = guest->vq;
+	unsigned i;
+
+	if ((uint16_t)(vq->used->idx - used_idx) != nb_ids) {
+		printf("%u buffers given back instead of %u\n",
+			(uint16_t)(vq->used->idx - used_idx), nb_ids);
+		return -1;
+	}
+	for (i = 0; i < nb_ids; i++) {
+		if (vq->used->ring[(used_idx + i) & (vq->size - 1)].id !=
+				2 * ids[i]) {
+			printf("Wrong buffer in used entry %u\n",
+				used_idx + i);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Give back the buffers of the mbufs freed since the last burst. */
+static void
+zcopy_reclaim(struct zcopy_guest *guest, struct rte_mempool *mp)
+{
+	struct rte_mbuf *pkt;
+
+	rte_vhost_dequeue_burst(guest->dev, VIRTIO_TXQ, mp, &pkt, 0);
+}
+
+static int
+zcopy_check_reclaim(struct zcopy_guest *guest, struct rte_mempool *mp,
+	struct rte_mbuf **pkts)
+{
+	static const unsigned first_two[] = { 0, 1 };
+	struct rte_mbuf *pkt;
+	uint16_t nb_rx;
+	unsigned i;
+
+	for (i = 0; i < ZCOPY_NB_PKTS; i++)
+		zcopy_guest_send(guest, i, ZCOPY_PKT_LEN);
+
+	nb_rx = rte_vhost_dequeue_burst(guest->dev, VIRTIO_TXQ, mp, pkts,
+		ZCOPY_NB_PKTS);
+	TEST_ASSERT_EQUAL(nb_rx, ZCOPY_NB_PKTS, "%u packets dequeued", nb_rx);
+	for (i = 0; i < ZCOPY_NB_PKTS; i++)
+		TEST_ASSERT(rte_pktmbuf_mtod(pkts[i], void *) ==
+			zcopy_buf(guest, i) &&
+			rte_pktmbuf_pkt_len(pkts[i]) == ZCOPY_PKT_LEN,
+			"Packet %u not pointing to the guest buffer", i);
+	TEST_ASSERT_SUCCESS(zcopy_check_used(guest, 0, NULL, 0),
+		"Buffers in use given back");
+
+	/* the oldest mbuf still in use holds the next ones back */
+	rte_pktmbuf_free(pkts[1]);
+	zcopy_reclaim(guest, mp);
+	TEST_ASSERT_SUCCESS(zcopy_check_used(guest, 0, NULL, 0),
+		"Buffer given back before an older one");
+	rte_pktmbuf_free(pkts[0]);
+	zcopy_reclaim(guest, mp);
+	TEST_ASSERT_SUCCESS(zcopy_check_used(guest, 0, first_two, 2),
+		"Freed buffers not given back");
+	TEST_ASSERT_EQUAL(guest->vq->nr_zmbufs, ZCOPY_NB_PKTS - 2,
+		"%u mbufs in use", guest->vq->nr_zmbufs);
+
+	/* a short packet is copied and its buffer given back at once */
+	zcopy_guest_send(guest, 0, ZCOPY_SHORT_PKT_LEN);
+	nb_rx = rte_vhost_dequeue_burst(guest->dev, VIRTIO_TXQ, mp, &pkt, 1);
+	TEST_ASSERT_EQUAL(nb_rx, 1, "Short packet not dequeued");
+	TEST_ASSERT(rte_pktmbuf_mtod(pkt, void *) != zcopy_buf(guest, 0) &&
+		rte_pktmbuf_pkt_len(pkt) == ZCOPY_SHORT_PKT_LEN &&
+		*rte_pktmbuf_mtod(pkt, uint8_t *) == 1,
+		"Short packet not copied");
+	rte_pktmbuf_free(pkt);
+	TEST_ASSERT_SUCCESS(zcopy_check_used(guest, 2, first_two, 1),
+		"Short packet buffer not given back");
+
+	return 0;
+}
+
+static int
+zcopy_free_later(void *arg)
+{
+	struct rte_mbuf **pkts = arg;
+	unsigned i;
+
+	rte_delay_ms(ZCOPY_FREE_DELAY_MS);
+	for (i = 2; i < ZCOPY_NB_PKTS; i++)
+		rte_pktmbuf_free(pkts[i]);
+	return 0;
+}
+
+/* The mbufs still in use, 2 to ZCOPY_NB_PKTS - 1, are drained. */
+static int
+zcopy_check_drain(struct zcopy_guest *guest, struct rte_mbuf **pkts)
+{
+	unsigned ids[ZCOPY_NB_PKTS - 2];
+	unsigned i, lcore;
+
+	for (i = 2; i < ZCOPY_NB_PKTS; i++)
+		ids[i - 2] = i;
+
+	lcore = rte_get_next_lcore(-1, 1, 0);
+	if (lcore < RTE_MAX_LCORE) {
+		if (rte_eal_remote_launch(zcopy_free_later, pkts, lcore) < 0)
+			return -1;
+	} else {
+		printf("No lcore to free the mbufs during the drain\n");
+		zcopy_free_later(pkts);
+	}
+	vhost_zcopy_drain(guest->dev);
+	if (lcore < RTE_MAX_LCORE)
+		rte_eal_wait_lcore(lcore);
+
+	TEST_ASSERT_EQUAL(guest->vq->nr_zmbufs, 0, "%u mbufs not drained",
+		guest->vq->nr_zmbufs);
+	TEST_ASSERT_SUCCESS(zcopy_check_used(guest, 3, ids, RTE_DIM(ids)),
+		"Drained buffers not given back");
+
+	return 0;
+}
+
+static int
+test_vhost_zcopy(void)
+{
+	struct rte_mbuf *pkts[ZCOPY_NB_PKTS];
+	struct zcopy_guest guest;
+	struct rte_mempool *mp;
+	int ret;
+
+	mp = rte_mempool_lookup("vhost_zcopy_pool");
+	if (mp == NULL)
+		mp = rte_pktmbuf_pool_create("vhost_zcopy_pool",
+			ZCOPY_NB_MBUF, 0, 0, RTE_MBUF_DEFAULT_BUF_SIZE,
+			rte_socket_id());
+	TEST_ASSERT_NOT_NULL(mp, "Cannot create mbuf pool");
+
+	TEST_ASSERT_SUCCESS(zcopy_guest_init(&guest),
+		"Cannot emulate the guest");
+
+	ret = zcopy_check_reclaim(&guest, mp, pkts);
+	if (ret == 0)
+		ret = zcopy_check_drain(&guest, pkts);
+	else
+		vhost_zcopy_drain(guest.dev);
+	zcopy_guest_free(&guest);
+	if (ret != 0)
+		return ret;
+
+	TEST_ASSERT_EQUAL(rte_mempool_count(mp), ZCOPY_NB_MBUF,
+		"Leaked mbufs");
+
+	return 0;
+}
+
+static struct test_command vhost_zcopy_cmd = {
+	.command = "vhost_zcopy_autotest",
+	.callback = test_vhost_zcopy,
+};
+REGISTER_TEST_COMMAND(vhost_zcopy_cmd);
@@ -102,6 +102,10 @@ struct pmd_internals {
 
 	struct pkt_rx_queue rx_queue[RTE_PMD_AF_PACKET_MAX_RINGS];
 	struct pkt_tx_queue tx_queue[RTE_PMD_AF_PACKET_MAX_RINGS];
+
+	/* RX interrupts, on the readiness of the queue sockets */
+	struct rte_intr_handle intr_handle;
+	int intr_vec[RTE_PMD_AF_PACKET_MAX_RINGS];
 };
 
 static const char *valid_arguments[] = {
@@ -231,9 +235,37 @@ eth_af_packet_tx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 	return num_tx;
 }
 
+/*
+ * Set up the RX interrupts: the socket of a queue is readable when the
+ * kernel has filled a frame of its ring, and epoll is edge-triggered, so
+ * the events need no clearing.
+ */
+static void
+eth_dev_rx_intr_setup(struct rte_eth_dev *dev)
+{
+	struct pmd_internals *internals = dev->data->dev_private;
+	struct rte_intr_handle *intr_handle = &internals->intr_handle;
+	unsigned i;
+
+	if (!dev->data->dev_conf.intr_conf.rxq)
+		return;
+
+	intr_handle->type = RTE_INTR_HANDLE_EXT;
+	intr_handle->fd = -1;
+	for (i = 0; i < internals->nb_queues; i++) {
+		intr_handle->efds[i] = internals->rx_queue[i].sockfd;
+		internals->intr_vec[i] = RTE_INTR_VEC_RXTX_OFFSET + i;
+	}
+	intr_handle->nb_efd = internals->nb_queues;
+	intr_handle->max_intr = internals->nb_queues + 1;
+	intr_handle->intr_vec = internals->intr_vec;
+	dev->intr_handle = intr_handle;
+}
+
 static int
 eth_dev_start(struct rte_eth_dev *dev)
 {
+	eth_dev_rx_intr_setup(dev);
 	dev->data->dev_link.link_status = 1;
 	return 0;
 }
@@ -386,6 +418,14 @@ eth_tx_queue_setup(struct rte_eth_dev *dev,
 	return 0;
 }
 
+static int
+eth_rx_queue_intr_nop(struct rte_eth_dev *dev __rte_unused,
+		uint16_t queue_id __rte_unused)
+{
+	/* the sockets are always registered, nothing to arm or disarm */
+	return 0;
+}
+
 static const struct eth_dev_ops ops = {
 	.dev_start = eth_dev_start,
 	.dev_stop = eth_dev_stop,
@@ -399,6 +439,8 @@ static const struct eth_dev_ops ops = {
 	.link_update = eth_link_update,
 	.stats_get = eth_stats_get,
 	.stats_reset = eth_stats_reset,
+	.rx_queue_intr_enable = eth_rx_queue_intr_nop,
+	.rx_queue_intr_disable = eth_rx_queue_intr_nop,
 };
 
 /*
@@ -33,6 +33,7 @@
  */
 
 #include <time.h>
+#include <errno.h>
 #include <rte_mbuf.h>
 #include <rte_ethdev.h>
 #include <rte_malloc.h>
@@ -107,6 +108,11 @@ struct pmd_internals {
 	unsigned nb_tx_queues;
 	int if_index;
 	int single_iface;
+#ifdef RTE_EXEC_ENV_LINUXAPP
+	/* RX interrupts, on the readiness of the live interfaces */
+	struct rte_intr_handle intr_handle;
+	int intr_vec[RTE_PMD_RING_MAX_RX_RINGS];
+#endif
 };
 
 const char *valid_arguments[] = {
@@ -374,6 +380,59 @@ eth_pcap_tx(void *queue,
 	return num_tx;
 }
 
+#ifdef RTE_EXEC_ENV_LINUXAPP
+/*
+ * Set up the RX interrupts on the selectable fd of the live interfaces.
+ * epoll is edge-triggered, so the events need no clearing.
+ */
+static int
+eth_dev_rx_intr_setup(struct rte_eth_dev *dev)
+{
+	struct pmd_internals *internals = dev->data->dev_private;
+	struct rte_intr_handle *intr_handle = &internals->intr_handle;
+	unsigned i;
+	int fd;
+
+	if (!dev->data->dev_conf.intr_conf.rxq)
+		return 0;
+
+	for (i = 0; i < internals->nb_rx_queues; i++) {
+		fd = pcap_get_selectable_fd(internals->rx_queue[i].pcap);
+		/* pcap files cannot be waited for */
+		if (fd < 0 || strcmp(internals->rx_queue[i].type,
+				ETH_PCAP_RX_PCAP_ARG) == 0) {
+			RTE_LOG(ERR, PMD, "RX interrupts need a live "
+				"interface on RX queue %u\n", i);
+			return -ENOTSUP;
+		}
+		intr_handle->efds[i] = fd;
+		internals->intr_vec[i] = RTE_INTR_VEC_RXTX_OFFSET + i;
+	}
+	intr_handle->type = RTE_INTR_HANDLE_EXT;
+	intr_handle->fd = -1;
+	intr_handle->nb_efd = internals->nb_rx_queues;
+	intr_handle->max_intr = internals->nb_rx_queues + 1;
+	intr_handle->intr_vec = internals->intr_vec;
+	dev->intr_handle = intr_handle;
+
+	return 0;
+}
+
+static int
+eth_rx_queue_intr_nop(struct rte_eth_dev *dev __rte_unused,
+		uint16_t queue_id __rte_unused)
+{
+	/* the fds are always registered, nothing to arm or disarm */
+	return 0;
+}
+#else
+static int
+eth_dev_rx_intr_setup(struct rte_eth_dev *dev)
+{
+	return dev->data->dev_conf.intr_conf.rxq ? -ENOTSUP : 0;
+}
+#endif
+
 static int
 eth_dev_start(struct rte_eth_dev *dev)
 {
@@ -429,6 +488,8 @@ eth_dev_start(struct rte_eth_dev *dev)
 	}
 
 status_up:
+	if (eth_dev_rx_intr_setup(dev) < 0)
+		return -1;
 
 	dev->data->dev_link.link_status = 1;
 	return 0;
@@ -615,6 +676,10 @@ static const struct eth_dev_ops ops = {
 	.link_update = eth_link_update,
 	.stats_get = eth_stats_get,
 	.stats_reset = eth_stats_reset,
+#ifdef RTE_EXEC_ENV_LINUXAPP
+	.rx_queue_intr_enable = eth_rx_queue_intr_nop,
+	.rx_queue_intr_disable = eth_rx_queue_intr_nop,
+#endif
 };
 
 /*
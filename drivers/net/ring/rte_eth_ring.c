@@ -41,9 +41,16 @@
 #include <rte_kvargs.h>
 #include <rte_errno.h>
 #include <rte_cycles.h>
+#include <rte_spinlock.h>
+#include <rte_atomic.h>
+
+#include <errno.h>
 
 /* Following code probably only works with Linux */
 #include <unistd.h>
+#ifdef RTE_EXEC_ENV_LINUXAPP
+#include <sys/eventfd.h>
+#endif
 
 #define ETH_RING_NUMA_NODE_ACTION_ARG	"nodeaction"
 #define ETH_RING_ACTION_CREATE		"CREATE"
@@ -66,6 +73,241 @@ static struct rte_eth_link pmd_link = {
 		.link_status = 0
 };
 
+#ifdef RTE_EXEC_ENV_LINUXAPP
+/*
+ * RX interrupts
+ *
+ * The RX interrupt of a ring is an eventfd, written by the lcores
+ * enqueueing into the ring when its reader has armed the interrupt. The
+ * port internals may be shared with other processes, so this state is
+ * kept in process-local tables: the interrupts only work when the reader
+ * and the writers of a ring are in the same process.
+ *
+ * The eventfd is closed when the last port reading the ring is closed. Its
+ * entry stays in the table, disarmed, as the writers look it up without
+ * lock, and gets a new eventfd if a port reads the ring again.
+ */
+#define RING_INTR_TABLE_SIZE 256 /* power of 2 */
+
+struct ring_intr {
+	const struct rte_ring *rng;
+	int efd;
+	unsigned refcnt; /* number of ports reading the ring */
+	rte_atomic32_t armed;
+};
+
+/* open addressing hash table of the rings with an RX interrupt */
+static struct ring_intr ring_intrs[RING_INTR_TABLE_SIZE];
+static volatile unsigned ring_intr_count;
+static rte_spinlock_t ring_intr_lock = RTE_SPINLOCK_INITIALIZER;
+
+struct ring_port_intr {
+	struct rte_intr_handle intr_handle;
+	int intr_vec[RTE_PMD_RING_MAX_RX_RINGS];
+	struct ring_intr *rx_intr[RTE_PMD_RING_MAX_RX_RINGS];
+};
+
+static struct ring_port_intr ring_port_intrs[RTE_MAX_ETHPORTS];
+
+static inline unsigned
+ring_intr_hash(const struct rte_ring *r)
+{
+	return ((uintptr_t)r / RTE_CACHE_LINE_SIZE) &
+		(RING_INTR_TABLE_SIZE - 1);
+}
+
+static struct ring_intr *
+ring_intr_lookup(const struct rte_ring *r)
+{
+	struct ring_intr *e;
+	unsigned i, h = ring_intr_hash(r);
+
+	for (i = 0; i < RING_INTR_TABLE_SIZE; i++) {
+		e = &ring_intrs[(h + i) & (RING_INTR_TABLE_SIZE - 1)];
+		if (e->rng == r)
+			return e;
+		if (e->rng == NULL)
+			break;
+	}
+	return NULL;
+}
+
+/* get the RX interrupt of a ring, creating it if needed */
+static struct ring_intr *
+ring_intr_get(const struct rte_ring *r)
+{
+	struct ring_intr *e;
+	unsigned i, h = ring_intr_hash(r);
+
+	rte_spinlock_lock(&ring_intr_lock);
+	for (i = 0; i < RING_INTR_TABLE_SIZE; i++) {
+		e = &ring_intrs[(h + i) & (RING_INTR_TABLE_SIZE - 1)];
+		if (e->rng == r || e->rng == NULL)
+			break;
+	}
+	if (i == RING_INTR_TABLE_SIZE) {
+		e = NULL;
+		goto out;
+	}
+	if (e->refcnt != 0)
+		goto ref;
+
+	e->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (e->efd < 0) {
+		RTE_LOG(ERR, PMD, "Cannot create eventfd of ring %s\n",
+			r->name);
+		e = NULL;
+		goto out;
+	}
+	if (e->rng == NULL) {
+		rte_atomic32_init(&e->armed);
+		/* entries are looked up without lock */
+		rte_wmb();
+		e->rng = r;
+		ring_intr_count++;
+	}
+ref:
+	e->refcnt++;
+out:
+	rte_spinlock_unlock(&ring_intr_lock);
+	return e;
+}
+
+/* release the RX interrupt of a ring, closing it with its last reader */
+static void
+ring_intr_put(struct ring_intr *e)
+{
+	rte_spinlock_lock(&ring_intr_lock);
+	if (--e->refcnt == 0) {
+		/* the writers only use the eventfd when it is armed */
+		rte_atomic32_set(&e->armed, 0);
+		rte_mb();
+		close(e->efd);
+		e->efd = -1;
+	}
+	rte_spinlock_unlock(&ring_intr_lock);
+}
+
+/* wake the reader up, once per arming */
+static inline void
+ring_intr_notify(struct ring_intr *e)
+{
+	static const uint64_t one = 1;
+
+	if (rte_atomic32_cmpset((volatile uint32_t *)&e->armed.cnt, 1, 0) &&
+			write(e->efd, &one, sizeof(one)) < 0)
+		RTE_LOG(ERR, PMD, "Cannot notify ring %s\n", e->rng->name);
+}
+
+/* called after an enqueue into a ring, which may have an armed reader */
+static void
+ring_intr_tx(const struct rte_ring *r)
+{
+	struct ring_intr *e;
+
+	/* order the enqueue before reading the armed flag */
+	rte_mb();
+	e = ring_intr_lookup(r);
+	if (e != NULL && rte_atomic32_read(&e->armed))
+		ring_intr_notify(e);
+}
+
+static int
+eth_dev_rx_intr_setup(struct rte_eth_dev *dev)
+{
+	struct pmd_internals *internals = dev->data->dev_private;
+	struct ring_port_intr *pi = &ring_port_intrs[dev->data->port_id];
+	struct rte_intr_handle *intr_handle = &pi->intr_handle;
+	unsigned i;
+
+	if (!dev->data->dev_conf.intr_conf.rxq)
+		return 0;
+
+	for (i = 0; i < internals->nb_rx_queues; i++) {
+		/* kept from a previous start, until the port is closed */
+		if (pi->rx_intr[i] == NULL)
+			pi->rx_intr[i] = ring_intr_get(
+				internals->rx_ring_queues[i].rng);
+		if (pi->rx_intr[i] == NULL)
+			return -ENOSPC;
+		intr_handle->efds[i] = pi->rx_intr[i]->efd;
+		pi->intr_vec[i] = RTE_INTR_VEC_RXTX_OFFSET + i;
+	}
+	intr_handle->type = RTE_INTR_HANDLE_EXT;
+	intr_handle->fd = -1;
+	intr_handle->nb_efd = internals->nb_rx_queues;
+	intr_handle->max_intr = internals->nb_rx_queues + 1;
+	intr_handle->intr_vec = pi->intr_vec;
+	dev->intr_handle = intr_handle;
+
+	return 0;
+}
+
+static void
+eth_dev_rx_intr_release(struct rte_eth_dev *dev)
+{
+	struct ring_port_intr *pi = &ring_port_intrs[dev->data->port_id];
+	unsigned i;
+
+	dev->intr_handle = NULL;
+	pi->intr_handle.nb_efd = 0;
+	for (i = 0; i < RTE_DIM(pi->rx_intr); i++) {
+		if (pi->rx_intr[i] != NULL) {
+			ring_intr_put(pi->rx_intr[i]);
+			pi->rx_intr[i] = NULL;
+		}
+	}
+}
+
+static int
+eth_rx_queue_intr_enable(struct rte_eth_dev *dev, uint16_t queue_id)
+{
+	struct pmd_internals *internals = dev->data->dev_private;
+	struct rx_ring_queue *rx_q = &internals->rx_ring_queues[queue_id];
+	struct ring_intr *e = ring_port_intrs[dev->data->port_id].rx_intr[queue_id];
+
+	/* a bypass device is read instead of the ring */
+	if (e == NULL || rx_q->state != NORMAL_RX)
+		return -ENOTSUP;
+
+	rte_atomic32_set(&e->armed, 1);
+	/* order the arming before checking the ring, see ring_intr_tx() */
+	rte_mb();
+	if (!rte_ring_empty(rx_q->rng))
+		ring_intr_notify(e);
+
+	return 0;
+}
+
+static int
+eth_rx_queue_intr_disable(struct rte_eth_dev *dev, uint16_t queue_id)
+{
+	struct ring_intr *e = ring_port_intrs[dev->data->port_id].rx_intr[queue_id];
+	uint64_t count;
+
+	if (e == NULL)
+		return -ENOTSUP;
+
+	rte_atomic32_set(&e->armed, 0);
+	/* clear the pending notification, if any */
+	if (read(e->efd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+		return -errno;
+
+	return 0;
+}
+#else
+static int
+eth_dev_rx_intr_setup(struct rte_eth_dev *dev)
+{
+	return dev->data->dev_conf.intr_conf.rxq ? -ENOTSUP : 0;
+}
+
+static void
+eth_dev_rx_intr_release(struct rte_eth_dev *dev __rte_unused)
+{
+}
+#endif /* RTE_EXEC_ENV_LINUXAPP */
+
 static int
 buf_is_cap(struct rte_mbuf * buf)
 {
@@ -217,6 +459,11 @@ eth_ring_normal_tx(void *q, struct rte_mbuf **bufs, uint16_t nb_bufs)
 	const uint16_t nb_tx = (uint16_t)rte_ring_enqueue_burst(r->rng,
 			ptrs, nb_bufs);
 
+#ifdef RTE_EXEC_ENV_LINUXAPP
+	if (unlikely(ring_intr_count != 0) && nb_tx != 0)
+		ring_intr_tx(r->rng);
+#endif
+
 	r->tx_pkts += nb_tx;
 	r->err_pkts += nb_bufs - nb_tx;
 
@@ -475,6 +722,12 @@ eth_dev_start(struct rte_eth_dev *dev)
 		}
 	}
 
+	ret = eth_dev_rx_intr_setup(dev);
+	if (ret < 0) {
+		RTE_LOG(ERR, PMD, "Cannot set up RX interrupts\n");
+		return ret;
+	}
+
 	dev->data->dev_link.link_status = 1;
 	return 0;
 }
@@ -485,6 +738,12 @@ eth_dev_stop(struct rte_eth_dev *dev)
 	dev->data->dev_link.link_status = 0;
 }
 
+static void
+eth_dev_close(struct rte_eth_dev *dev)
+{
+	eth_dev_rx_intr_release(dev);
+}
+
 static int
 eth_dev_set_link_down(struct rte_eth_dev *dev)
 {
@@ -615,6 +874,7 @@ eth_link_update(struct rte_eth_dev *dev __rte_unused,
 static const struct eth_dev_ops ops = {
 	.dev_start = eth_dev_start,
 	.dev_stop = eth_dev_stop,
+	.dev_close = eth_dev_close,
 	.dev_set_link_up = eth_dev_set_link_up,
 	.dev_set_link_down = eth_dev_set_link_down,
 	.dev_configure = eth_dev_configure,
@@ -628,6 +888,10 @@ static const struct eth_dev_ops ops = {
 	.stats_reset = eth_stats_reset,
 	.mac_addr_remove = eth_mac_addr_remove,
 	.mac_addr_add = eth_mac_addr_add,
+#ifdef RTE_EXEC_ENV_LINUXAPP
+	.rx_queue_intr_enable = eth_rx_queue_intr_enable,
+	.rx_queue_intr_disable = eth_rx_queue_intr_disable,
+#endif
 };
 
 int
@@ -1165,6 +1429,7 @@ rte_pmd_ring_destroy(const char *name, int destroy_internals)
 		return -ENODEV;
 
 	eth_dev_stop(eth_dev);
+	eth_dev_close(eth_dev);
 
 	if (eth_dev->data) {
 		rte_free(eth_dev->data->rx_queues);
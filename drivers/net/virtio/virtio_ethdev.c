@@ -64,8 +64,6 @@
 #include "virtio_rxtx.h"
 
 
-static int eth_virtio_dev_init(struct rte_eth_dev *eth_dev);
-static int eth_virtio_dev_uninit(struct rte_eth_dev *eth_dev);
 static int  virtio_dev_configure(struct rte_eth_dev *dev);
 static int  virtio_dev_start(struct rte_eth_dev *dev);
 static void virtio_dev_stop(struct rte_eth_dev *dev);
@@ -133,11 +131,87 @@ static const struct rte_virtio_xstats_name_off rte_virtio_q_stat_strings[] = {
 	{"size_512_1023_packets",  offsetof(struct virtqueue, size_bins[5])},
 	{"size_1024_1517_packets", offsetof(struct virtqueue, size_bins[6])},
 	{"size_1518_max_packets",  offsetof(struct virtqueue, size_bins[7])},
+	{"scalar_path_packets",
+		offsetof(struct virtqueue, path_packets[VIRTIO_PATH_SCALAR])},
+	{"vec_path_packets",
+		offsetof(struct virtqueue, path_packets[VIRTIO_PATH_VEC])},
+	{"inorder_path_packets",
+		offsetof(struct virtqueue, path_packets[VIRTIO_PATH_INORDER])},
+	{"packed_path_packets",
+		offsetof(struct virtqueue, path_packets[VIRTIO_PATH_PACKED])},
 };
 
 #define VIRTIO_NB_Q_XSTATS (sizeof(rte_virtio_q_stat_strings) / \
 			    sizeof(rte_virtio_q_stat_strings[0]))
 
+/*
+ * Same as the split vring path of virtio_send_command(), on a packed vring:
+ * the descriptors are laid out from the available index on, the flags of
+ * the head being written last to make the whole chain available at once.
+ */
+static int
+virtio_send_command_packed(struct virtqueue *vq, struct virtio_pmd_ctrl *ctrl,
+		int *dlen, int pkt_num)
+{
+	struct vring_packed_desc *desc = vq->vq_ring_packed.desc;
+	struct virtio_pmd_ctrl result;
+	uint16_t head, head_flags, idx, nb_descs = 0;
+	int k, sum = 0;
+
+	head = vq->vq_avail_idx;
+	head_flags = VRING_DESC_F_NEXT | vq->vq_packed_avail_flags;
+	desc[head].addr = vq->virtio_net_hdr_mem;
+	desc[head].len = sizeof(struct virtio_net_ctrl_hdr);
+	desc[head].id = 0;
+	nb_descs++;
+	vq_packed_avail_next(vq);
+
+	for (k = 0; k < pkt_num; k++) {
+		idx = vq->vq_avail_idx;
+		desc[idx].addr = vq->virtio_net_hdr_mem
+			+ sizeof(struct virtio_net_ctrl_hdr)
+			+ sizeof(ctrl->status) + sizeof(uint8_t)*sum;
+		desc[idx].len = dlen[k];
+		desc[idx].id = 0;
+		desc[idx].flags = VRING_DESC_F_NEXT |
+			vq->vq_packed_avail_flags;
+		sum += dlen[k];
+		nb_descs++;
+		vq_packed_avail_next(vq);
+	}
+
+	idx = vq->vq_avail_idx;
+	desc[idx].addr = vq->virtio_net_hdr_mem
+			+ sizeof(struct virtio_net_ctrl_hdr);
+	desc[idx].len = sizeof(ctrl->status);
+	desc[idx].id = 0;
+	desc[idx].flags = VRING_DESC_F_WRITE | vq->vq_packed_avail_flags;
+	nb_descs++;
+	vq_packed_avail_next(vq);
+
+	virtio_wmb();
+	desc[head].flags = head_flags;
+	vq->vq_free_cnt -= nb_descs;
+
+	virtqueue_notify(vq);
+
+	/* The device writes the used descriptor in place of the head */
+	while (!vq_packed_desc_is_used(vq, vq->vq_used_cons_idx))
+		usleep(100);
+	virtio_rmb();
+
+	vq_packed_used_advance(vq, nb_descs);
+	vq->vq_free_cnt += nb_descs;
+
+	PMD_INIT_LOG(DEBUG, "vq->vq_free_cnt=%d\nvq->vq_avail_idx=%d",
+			vq->vq_free_cnt, vq->vq_avail_idx);
+
+	memcpy(&result, vq->virtio_net_hdr_mz->addr,
+			sizeof(struct virtio_pmd_ctrl));
+
+	return result.status;
+}
+
 static int
 virtio_send_command(struct virtqueue *vq, struct virtio_pmd_ctrl *ctrl,
 		int *dlen, int pkt_num)
@@ -167,6 +241,9 @@ virtio_send_command(struct virtqueue *vq, struct virtio_pmd_ctrl *ctrl,
 	memcpy(vq->virtio_net_hdr_mz->addr, ctrl,
 		sizeof(struct virtio_pmd_ctrl));
 
+	if (vq->vq_packed)
+		return virtio_send_command_packed(vq, ctrl, dlen, pkt_num);
+
 	/*
 	 * Format is enforced in qemu code:
 	 * One TX packet for header;
@@ -174,14 +251,14 @@ virtio_send_command(struct virtqueue *vq, struct virtio_pmd_ctrl *ctrl,
 	 * One RX packet for ACK.
 	 */
 	vq->vq_ring.desc[head].flags = VRING_DESC_F_NEXT;
-	vq->vq_ring.desc[head].addr = vq->virtio_net_hdr_mz->phys_addr;
+	vq->vq_ring.desc[head].addr = vq->virtio_net_hdr_mem;
 	vq->vq_ring.desc[head].len = sizeof(struct virtio_net_ctrl_hdr);
 	vq->vq_free_cnt--;
 	i = vq->vq_ring.desc[head].next;
 
 	for (k = 0; k < pkt_num; k++) {
 		vq->vq_ring.desc[i].flags = VRING_DESC_F_NEXT;
-		vq->vq_ring.desc[i].addr = vq->virtio_net_hdr_mz->phys_addr
+		vq->vq_ring.desc[i].addr = vq->virtio_net_hdr_mem
 			+ sizeof(struct virtio_net_ctrl_hdr)
 			+ sizeof(ctrl->status) + sizeof(uint8_t)*sum;
 		vq->vq_ring.desc[i].len = dlen[k];
@@ -191,7 +268,7 @@ virtio_send_command(struct virtqueue *vq, struct virtio_pmd_ctrl *ctrl,
 	}
 
 	vq->vq_ring.desc[i].flags = VRING_DESC_F_WRITE;
-	vq->vq_ring.desc[i].addr = vq->virtio_net_hdr_mz->phys_addr
+	vq->vq_ring.desc[i].addr = vq->virtio_net_hdr_mem
 			+ sizeof(struct virtio_net_ctrl_hdr);
 	vq->vq_ring.desc[i].len = sizeof(ctrl->status);
 	vq->vq_free_cnt--;
@@ -272,9 +349,7 @@ virtio_dev_queue_release(struct virtqueue *vq) {
 
 	if (vq) {
 		hw = vq->hw;
-		/* Select and deactivate the queue */
-		VIRTIO_WRITE_REG_2(hw, VIRTIO_PCI_QUEUE_SEL, vq->vq_queue_index);
-		VIRTIO_WRITE_REG_4(hw, VIRTIO_PCI_QUEUE_PFN, 0);
+		VTPCI_OPS(hw)->del_queue(hw, vq);
 
 		rte_free(vq->sw_ring);
 		rte_free(vq);
@@ -295,15 +370,13 @@ int virtio_dev_queue_setup(struct rte_eth_dev *dev,
 	struct virtio_hw *hw = dev->data->dev_private;
 	struct virtqueue *vq = NULL;
 
-	/* Write the virtqueue index to the Queue Select Field */
-	VIRTIO_WRITE_REG_2(hw, VIRTIO_PCI_QUEUE_SEL, vtpci_queue_idx);
 	PMD_INIT_LOG(DEBUG, "selecting queue: %u", vtpci_queue_idx);
 
 	/*
 	 * Read the virtqueue size from the Queue Size field
 	 * Always power of 2 and if 0 virtqueue does not exist
 	 */
-	vq_size = VIRTIO_READ_REG_2(hw, VIRTIO_PCI_QUEUE_NUM);
+	vq_size = VTPCI_OPS(hw)->get_queue_num(hw, vtpci_queue_idx);
 	PMD_INIT_LOG(DEBUG, "vq_size: %u nb_desc:%u", vq_size, nb_desc);
 	if (vq_size == 0) {
 		PMD_INIT_LOG(ERR, "%s: virtqueue does not exist", __func__);
@@ -351,6 +424,8 @@ int virtio_dev_queue_setup(struct rte_eth_dev *dev,
 	vq->queue_id = queue_idx;
 	vq->vq_queue_index = vtpci_queue_idx;
 	vq->vq_nentries = vq_size;
+	vq->vq_packed = vtpci_with_feature(hw, VIRTIO_F_RING_PACKED);
+	vq->vq_in_order = vtpci_with_feature(hw, VIRTIO_F_IN_ORDER);
 
 	if (nb_desc == 0 || nb_desc > vq_size)
 		nb_desc = vq_size;
@@ -359,7 +434,10 @@ int virtio_dev_queue_setup(struct rte_eth_dev *dev,
 	/*
 	 * Reserve a memzone for vring elements
 	 */
-	size = vring_size(vq_size, VIRTIO_PCI_VRING_ALIGN);
+	if (vq->vq_packed)
+		size = vring_packed_size(vq_size, VIRTIO_PCI_VRING_ALIGN);
+	else
+		size = vring_size(vq_size, VIRTIO_PCI_VRING_ALIGN);
 	vq->vq_ring_size = RTE_ALIGN_CEIL(size, VIRTIO_PCI_VRING_ALIGN);
 	PMD_INIT_LOG(DEBUG, "vring_size: %d, rounded_vring_size: %d", size, vq->vq_ring_size);
 
@@ -374,22 +452,21 @@ int virtio_dev_queue_setup(struct rte_eth_dev *dev,
 		}
 	}
 
+	memset(mz->addr, 0, sizeof(mz->len));
+	vq->mz = mz;
 	/*
-	 * Virtio PCI device VIRTIO_PCI_QUEUE_PF register is 32bit,
-	 * and only accepts 32 bit page frame number.
-	 * Check if the allocated physical memory exceeds 16TB.
+	 * virtio-user gives virtual addresses to the backend, which maps
+	 * the same hugepages in its own address space.
 	 */
-	if ((mz->phys_addr + vq->vq_ring_size - 1) >> (VIRTIO_PCI_QUEUE_ADDR_SHIFT + 32)) {
-		PMD_INIT_LOG(ERR, "vring address shouldn't be above 16TB!");
-		rte_free(vq);
-		return -ENOMEM;
+	if (hw->virtio_user_dev) {
+		vq->vq_ring_mem = (uintptr_t)mz->addr;
+		vq->offset = offsetof(struct rte_mbuf, buf_addr);
+	} else {
+		vq->vq_ring_mem = mz->phys_addr;
+		vq->offset = offsetof(struct rte_mbuf, buf_physaddr);
 	}
-
-	memset(mz->addr, 0, sizeof(mz->len));
-	vq->mz = mz;
-	vq->vq_ring_mem = mz->phys_addr;
 	vq->vq_ring_virt_mem = mz->addr;
-	PMD_INIT_LOG(DEBUG, "vq->vq_ring_mem:      0x%"PRIx64, (uint64_t)mz->phys_addr);
+	PMD_INIT_LOG(DEBUG, "vq->vq_ring_mem:      0x%"PRIx64, (uint64_t)vq->vq_ring_mem);
 	PMD_INIT_LOG(DEBUG, "vq->vq_ring_virt_mem: 0x%"PRIx64, (uint64_t)(uintptr_t)mz->addr);
 	vq->virtio_net_hdr_mz  = NULL;
 	vq->virtio_net_hdr_mem = 0;
@@ -412,7 +489,8 @@ int virtio_dev_queue_setup(struct rte_eth_dev *dev,
 				return -ENOMEM;
 			}
 		}
-		vq->virtio_net_hdr_mem =
+		vq->virtio_net_hdr_mem = hw->virtio_user_dev ?
+			(uintptr_t)vq->virtio_net_hdr_mz->addr :
 			vq->virtio_net_hdr_mz->phys_addr;
 		memset(vq->virtio_net_hdr_mz->addr, 0,
 			vq_size * hw->vtnet_hdr_size);
@@ -431,7 +509,8 @@ int virtio_dev_queue_setup(struct rte_eth_dev *dev,
 				return -ENOMEM;
 			}
 		}
-		vq->virtio_net_hdr_mem =
+		vq->virtio_net_hdr_mem = hw->virtio_user_dev ?
+			(uintptr_t)vq->virtio_net_hdr_mz->addr :
 			vq->virtio_net_hdr_mz->phys_addr;
 		memset(vq->virtio_net_hdr_mz->addr, 0, PAGE_SIZE);
 	}
@@ -440,8 +519,10 @@ int virtio_dev_queue_setup(struct rte_eth_dev *dev,
 	 * Set guest physical address of the virtqueue
 	 * in VIRTIO_PCI_QUEUE_PFN config register of device
 	 */
-	VIRTIO_WRITE_REG_4(hw, VIRTIO_PCI_QUEUE_PFN,
-			mz->phys_addr >> VIRTIO_PCI_QUEUE_ADDR_SHIFT);
+	if (VTPCI_OPS(hw)->setup_queue(hw, vq) < 0) {
+		rte_free(vq);
+		return -ENOMEM;
+	}
 	*pvq = vq;
 	return 0;
 }
@@ -486,12 +567,11 @@ static void
 virtio_dev_close(struct rte_eth_dev *dev)
 {
 	struct virtio_hw *hw = dev->data->dev_private;
-	struct rte_pci_device *pci_dev = dev->pci_dev;
 
 	PMD_INIT_LOG(DEBUG, "virtio_dev_close");
 
 	/* reset the NIC */
-	if (pci_dev->driver->drv_flags & RTE_PCI_DRV_INTR_LSC)
+	if (dev->data->dev_flags & RTE_ETH_DEV_INTR_LSC)
 		vtpci_irq_config(hw, VIRTIO_MSI_NO_VECTOR);
 	vtpci_reset(hw);
 	hw->started = 0;
@@ -774,6 +854,7 @@ virtio_dev_stats_reset(struct rte_eth_dev *dev)
 		txvq->multicast = 0;
 		txvq->broadcast = 0;
 		memset(txvq->size_bins, 0, sizeof(txvq->size_bins[0]) * 8);
+		memset(txvq->path_packets, 0, sizeof(txvq->path_packets));
 	}
 
 	for (i = 0; i < dev->data->nb_rx_queues; i++) {
@@ -787,6 +868,7 @@ virtio_dev_stats_reset(struct rte_eth_dev *dev)
 		rxvq->multicast = 0;
 		rxvq->broadcast = 0;
 		memset(rxvq->size_bins, 0, sizeof(rxvq->size_bins[0]) * 8);
+		memset(rxvq->path_packets, 0, sizeof(rxvq->path_packets));
 	}
 }
 
@@ -942,16 +1024,16 @@ virtio_vlan_filter_set(struct rte_eth_dev *dev, uint16_t vlan_id, int on)
 static void
 virtio_negotiate_features(struct virtio_hw *hw)
 {
-	uint32_t host_features;
+	uint64_t host_features;
 
 	/* Prepare guest_features: feature that driver wants to support */
 	hw->guest_features = VIRTIO_PMD_GUEST_FEATURES;
-	PMD_INIT_LOG(DEBUG, "guest_features before negotiate = %x",
+	PMD_INIT_LOG(DEBUG, "guest_features before negotiate = %" PRIx64,
 		hw->guest_features);
 
 	/* Read device(host) feature bits */
-	host_features = VIRTIO_READ_REG_4(hw, VIRTIO_PCI_HOST_FEATURES);
-	PMD_INIT_LOG(DEBUG, "host_features before negotiate = %x",
+	host_features = vtpci_get_features(hw);
+	PMD_INIT_LOG(DEBUG, "host_features before negotiate = %" PRIx64,
 		host_features);
 
 	/*
@@ -959,7 +1041,7 @@ virtio_negotiate_features(struct virtio_hw *hw)
 	 * guest feature bits.
 	 */
 	hw->guest_features = vtpci_negotiate_features(hw, host_features);
-	PMD_INIT_LOG(DEBUG, "features after negotiate = %x",
+	PMD_INIT_LOG(DEBUG, "features after negotiate = %" PRIx64,
 		hw->guest_features);
 }
 
@@ -1244,35 +1326,151 @@ virtio_interrupt_handler(__rte_unused struct rte_intr_handle *handle,
 
 }
 
+/*
+ * Set the RX and TX burst functions, from the features negotiated with
+ * the device and the vring layouts picked by virtio_update_rxtx_path():
+ *
+ * RX path                          | vring  | layout | conditions
+ * ---------------------------------+--------+--------+------------------
+ * virtio_recv_mergeable_pkts_packed| packed |        | MRG_RXBUF
+ * virtio_recv_pkts_packed          | packed |        |
+ * virtio_recv_mergeable_pkts_vec   | split  | simple | MRG_RXBUF
+ * virtio_recv_pkts_vec             | split  | simple |
+ * virtio_recv_mergeable_pkts       | split  |        | MRG_RXBUF
+ * virtio_recv_pkts                 | split  |        |
+ *
+ * TX path                          | vring  | layout | conditions
+ * ---------------------------------+--------+--------+------------------
+ * virtio_xmit_pkts_packed          | packed |        |
+ * virtio_xmit_pkts_simple          | split  | simple |
+ * virtio_xmit_pkts_inorder         | split  | inorder| IN_ORDER
+ * virtio_xmit_pkts                 | split  |        |
+ */
 static void
-rx_func_get(struct rte_eth_dev *eth_dev)
+virtio_set_rxtx_funcs(struct rte_eth_dev *eth_dev)
 {
 	struct virtio_hw *hw = eth_dev->data->dev_private;
-	if (vtpci_with_feature(hw, VIRTIO_NET_F_MRG_RXBUF))
-		eth_dev->rx_pkt_burst = &virtio_recv_mergeable_pkts;
+	int mrg_rxbuf = vtpci_with_feature(hw, VIRTIO_NET_F_MRG_RXBUF);
+
+	if (vtpci_with_feature(hw, VIRTIO_F_RING_PACKED)) {
+		if (mrg_rxbuf)
+			eth_dev->rx_pkt_burst =
+				&virtio_recv_mergeable_pkts_packed;
+		else
+			eth_dev->rx_pkt_burst = &virtio_recv_pkts_packed;
+		eth_dev->tx_pkt_burst = &virtio_xmit_pkts_packed;
+		return;
+	}
+
+	if (hw->use_simple_rx)
+		eth_dev->rx_pkt_burst = mrg_rxbuf ?
+			&virtio_recv_mergeable_pkts_vec : &virtio_recv_pkts_vec;
 	else
-		eth_dev->rx_pkt_burst = &virtio_recv_pkts;
+		eth_dev->rx_pkt_burst = mrg_rxbuf ?
+			&virtio_recv_mergeable_pkts : &virtio_recv_pkts;
+
+	if (hw->use_simple_tx)
+		eth_dev->tx_pkt_burst = &virtio_xmit_pkts_simple;
+	else if (hw->use_inorder_tx)
+		eth_dev->tx_pkt_burst = &virtio_xmit_pkts_inorder;
+	else
+		eth_dev->tx_pkt_burst = &virtio_xmit_pkts;
+}
+
+#define VIRTIO_SIMPLE_FLAGS ((uint32_t)ETH_TXQ_FLAGS_NOMULTSEGS | \
+	ETH_TXQ_FLAGS_NOOFFLOADS)
+
+/*
+ * Pick the vring layouts of a split vring device, before its queues are
+ * started. The simple RX layout, where each avail entry points to the
+ * descriptor of the same index, leaves VLAN stripping to the scalar
+ * paths, and with mergeable buffers it needs the largest frame to fit in
+ * RTE_VIRTIO_VPMD_RX_BURST buffers of every RX mempool. The simple TX
+ * layout takes single segment packets without offloads on all the TX
+ * queues; the in-order one takes any packet.
+ */
+static void
+virtio_update_rxtx_path(struct rte_eth_dev *dev)
+{
+	const struct rte_eth_rxmode *rxmode = &dev->data->dev_conf.rxmode;
+	struct virtio_hw *hw = dev->data->dev_private;
+	uint32_t txq_flags = VIRTIO_SIMPLE_FLAGS;
+	uint32_t max_len, buf_len;
+	uint16_t i;
+
+	hw->use_simple_rx = 0;
+	hw->use_simple_tx = 0;
+	hw->use_inorder_tx = 0;
+
+	if (vtpci_with_feature(hw, VIRTIO_F_RING_PACKED))
+		goto out;
+
+	for (i = 0; i < dev->data->nb_tx_queues; i++) {
+		struct virtqueue *txvq = dev->data->tx_queues[i];
+
+		if (txvq != NULL)
+			txq_flags &= txvq->txq_flags;
+	}
+
+	if (txq_flags == VIRTIO_SIMPLE_FLAGS &&
+	    !vtpci_with_feature(hw, VIRTIO_NET_F_MRG_RXBUF) &&
+	    !vtpci_with_feature(hw, VIRTIO_F_VERSION_1))
+		hw->use_simple_tx = 1;
+	else if (vtpci_with_feature(hw, VIRTIO_F_IN_ORDER))
+		hw->use_inorder_tx = 1;
+
+	if (hw->vlan_strip)
+		goto out;
+
+	hw->use_simple_rx = 1;
+	if (!vtpci_with_feature(hw, VIRTIO_NET_F_MRG_RXBUF))
+		goto out;
+
+	max_len = rxmode->jumbo_frame ? rxmode->max_rx_pkt_len : ETHER_MAX_LEN;
+	for (i = 0; i < dev->data->nb_rx_queues; i++) {
+		struct virtqueue *rxvq = dev->data->rx_queues[i];
+
+		if (rxvq == NULL)
+			continue;
+		buf_len = rte_pktmbuf_data_room_size(rxvq->mpool) -
+			RTE_PKTMBUF_HEADROOM + hw->vtnet_hdr_size;
+		if (max_len + hw->vtnet_hdr_size >
+		    buf_len * RTE_VIRTIO_VPMD_RX_BURST)
+			hw->use_simple_rx = 0;
+	}
+
+out:
+	PMD_INIT_LOG(INFO, "port %u: %s rx, %s tx path", dev->data->port_id,
+		     vtpci_with_feature(hw, VIRTIO_F_RING_PACKED) ? "packed" :
+		     hw->use_simple_rx ? "vector" : "scalar",
+		     vtpci_with_feature(hw, VIRTIO_F_RING_PACKED) ? "packed" :
+		     hw->use_simple_tx ? "simple" :
+		     hw->use_inorder_tx ? "in-order" : "scalar");
+	virtio_set_rxtx_funcs(dev);
 }
 
 /*
  * This function is based on probe() function in virtio_pci.c
  * It returns 0 on success.
  */
-static int
+int
 eth_virtio_dev_init(struct rte_eth_dev *eth_dev)
 {
 	struct virtio_hw *hw = eth_dev->data->dev_private;
 	struct virtio_net_config *config;
 	struct virtio_net_config local_config;
-	struct rte_pci_device *pci_dev;
+	struct rte_pci_device *pci_dev = eth_dev->pci_dev;
 
 	RTE_BUILD_BUG_ON(RTE_PKTMBUF_HEADROOM < sizeof(struct virtio_net_hdr));
 
 	eth_dev->dev_ops = &virtio_eth_dev_ops;
-	eth_dev->tx_pkt_burst = &virtio_xmit_pkts;
+
+	/* virtio-user devices have set their ops before calling us */
+	if (pci_dev != NULL)
+		VTPCI_OPS(hw) = &legacy_ops;
 
 	if (rte_eal_process_type() == RTE_PROC_SECONDARY) {
-		rx_func_get(eth_dev);
+		virtio_set_rxtx_funcs(eth_dev);
 		return 0;
 	}
 
@@ -1285,13 +1483,18 @@ eth_virtio_dev_init(struct rte_eth_dev *eth_dev)
 		return -ENOMEM;
 	}
 
-	pci_dev = eth_dev->pci_dev;
+	hw->port_id = eth_dev->data->port_id;
 
-	if (virtio_resource_init(pci_dev) < 0)
-		return -1;
+	if (pci_dev != NULL) {
+		if (virtio_resource_init(pci_dev) < 0)
+			return -1;
+
+		hw->use_msix = virtio_has_msix(&pci_dev->addr);
+		hw->io_base =
+			(uint32_t)(uintptr_t)pci_dev->mem_resource[0].addr;
 
-	hw->use_msix = virtio_has_msix(&pci_dev->addr);
-	hw->io_base = (uint32_t)(uintptr_t)pci_dev->mem_resource[0].addr;
+		rte_eth_copy_pci_info(eth_dev, pci_dev);
+	}
 
 	/* Reset the device although not necessary at startup */
 	vtpci_reset(hw);
@@ -1305,14 +1508,13 @@ eth_virtio_dev_init(struct rte_eth_dev *eth_dev)
 
 	/* If host does not support status then disable LSC */
 	if (!vtpci_with_feature(hw, VIRTIO_NET_F_STATUS))
-		pci_dev->driver->drv_flags &= ~RTE_PCI_DRV_INTR_LSC;
+		eth_dev->data->dev_flags &= ~RTE_ETH_DEV_INTR_LSC;
 
-	rte_eth_copy_pci_info(eth_dev, pci_dev);
-
-	rx_func_get(eth_dev);
+	virtio_set_rxtx_funcs(eth_dev);
 
 	/* Setting up rx_header size for the device */
-	if (vtpci_with_feature(hw, VIRTIO_NET_F_MRG_RXBUF))
+	if (vtpci_with_feature(hw, VIRTIO_NET_F_MRG_RXBUF) ||
+	    vtpci_with_feature(hw, VIRTIO_F_VERSION_1))
 		hw->vtnet_hdr_size = sizeof(struct virtio_net_hdr_mrg_rxbuf);
 	else
 		hw->vtnet_hdr_size = sizeof(struct virtio_net_hdr);
@@ -1383,12 +1585,13 @@ eth_virtio_dev_init(struct rte_eth_dev *eth_dev)
 
 	PMD_INIT_LOG(DEBUG, "hw->max_rx_queues=%d   hw->max_tx_queues=%d",
 			hw->max_rx_queues, hw->max_tx_queues);
-	PMD_INIT_LOG(DEBUG, "port %d vendorID=0x%x deviceID=0x%x",
+	if (pci_dev != NULL)
+		PMD_INIT_LOG(DEBUG, "port %d vendorID=0x%x deviceID=0x%x",
 			eth_dev->data->port_id, pci_dev->id.vendor_id,
 			pci_dev->id.device_id);
 
 	/* Setup interrupt callback  */
-	if (pci_dev->driver->drv_flags & RTE_PCI_DRV_INTR_LSC)
+	if (eth_dev->data->dev_flags & RTE_ETH_DEV_INTR_LSC)
 		rte_intr_callback_register(&pci_dev->intr_handle,
 				   virtio_interrupt_handler, eth_dev);
 
@@ -1397,7 +1600,7 @@ eth_virtio_dev_init(struct rte_eth_dev *eth_dev)
 	return 0;
 }
 
-static int
+int
 eth_virtio_dev_uninit(struct rte_eth_dev *eth_dev)
 {
 	struct rte_pci_device *pci_dev;
@@ -1424,7 +1627,7 @@ eth_virtio_dev_uninit(struct rte_eth_dev *eth_dev)
 	eth_dev->data->mac_addrs = NULL;
 
 	/* reset interrupt callback  */
-	if (pci_dev->driver->drv_flags & RTE_PCI_DRV_INTR_LSC)
+	if (eth_dev->data->dev_flags & RTE_ETH_DEV_INTR_LSC)
 		rte_intr_callback_unregister(&pci_dev->intr_handle,
 						virtio_interrupt_handler,
 						eth_dev);
@@ -1473,7 +1676,6 @@ virtio_dev_configure(struct rte_eth_dev *dev)
 {
 	const struct rte_eth_rxmode *rxmode = &dev->data->dev_conf.rxmode;
 	struct virtio_hw *hw = dev->data->dev_private;
-	struct rte_pci_device *pci_dev = dev->pci_dev;
 
 	PMD_INIT_LOG(DEBUG, "configure");
 
@@ -1491,7 +1693,7 @@ virtio_dev_configure(struct rte_eth_dev *dev)
 		return -ENOTSUP;
 	}
 
-	if (pci_dev->driver->drv_flags & RTE_PCI_DRV_INTR_LSC)
+	if (dev->data->dev_flags & RTE_ETH_DEV_INTR_LSC)
 		if (vtpci_irq_config(hw, 0) == VIRTIO_MSI_NO_VECTOR) {
 			PMD_DRV_LOG(ERR, "failed to set config vector");
 			return -EBUSY;
@@ -1506,11 +1708,10 @@ virtio_dev_start(struct rte_eth_dev *dev)
 {
 	uint16_t nb_queues, i;
 	struct virtio_hw *hw = dev->data->dev_private;
-	struct rte_pci_device *pci_dev = dev->pci_dev;
 
 	/* check if lsc interrupt feature is enabled */
 	if (dev->data->dev_conf.intr_conf.lsc) {
-		if (!(pci_dev->driver->drv_flags & RTE_PCI_DRV_INTR_LSC)) {
+		if (!(dev->data->dev_flags & RTE_ETH_DEV_INTR_LSC)) {
 			PMD_DRV_LOG(ERR, "link status not supported by host");
 			return -ENOTSUP;
 		}
@@ -1529,6 +1730,7 @@ virtio_dev_start(struct rte_eth_dev *dev)
 		return 0;
 
 	/* Do final configuration before rx/tx engine starts */
+	virtio_update_rxtx_path(dev);
 	virtio_dev_rxtx_start(dev);
 	vtpci_reinit_complete(hw);
 
@@ -1615,7 +1817,8 @@ virtio_dev_stop(struct rte_eth_dev *dev)
 
 	PMD_INIT_LOG(DEBUG, "stop");
 
-	if (dev->data->dev_conf.intr_conf.lsc)
+	if (dev->data->dev_conf.intr_conf.lsc &&
+	    (dev->data->dev_flags & RTE_ETH_DEV_INTR_LSC))
 		rte_intr_disable(&dev->pci_dev->intr_handle);
 
 	memset(&link, 0, sizeof(link));
@@ -1661,7 +1864,7 @@ virtio_dev_info_get(struct rte_eth_dev *dev, struct rte_eth_dev_info *dev_info)
 {
 	struct virtio_hw *hw = dev->data->dev_private;
 
-	dev_info->driver_name = dev->driver->pci_drv.name;
+	dev_info->driver_name = dev->data->drv_name;
 	dev_info->max_rx_queues = (uint16_t)hw->max_rx_queues;
 	dev_info->max_tx_queues = (uint16_t)hw->max_tx_queues;
 	dev_info->min_rx_bufsize = VIRTIO_MIN_RX_BUFSIZE;
@@ -57,14 +57,24 @@
 
 /* Features desired/implemented by this driver. */
 #define VIRTIO_PMD_GUEST_FEATURES		\
-	(1u << VIRTIO_NET_F_MAC		  |	\
-	 1u << VIRTIO_NET_F_STATUS	  |	\
-	 1u << VIRTIO_NET_F_MQ		  |	\
-	 1u << VIRTIO_NET_F_CTRL_MAC_ADDR |	\
-	 1u << VIRTIO_NET_F_CTRL_VQ	  |	\
-	 1u << VIRTIO_NET_F_CTRL_RX	  |	\
-	 1u << VIRTIO_NET_F_CTRL_VLAN	  |	\
-	 1u << VIRTIO_NET_F_MRG_RXBUF)
+	(1ULL << VIRTIO_NET_F_MAC	    |	\
+	 1ULL << VIRTIO_NET_F_STATUS	    |	\
+	 1ULL << VIRTIO_NET_F_MQ	    |	\
+	 1ULL << VIRTIO_NET_F_CTRL_MAC_ADDR |	\
+	 1ULL << VIRTIO_NET_F_CTRL_VQ	    |	\
+	 1ULL << VIRTIO_NET_F_CTRL_RX	    |	\
+	 1ULL << VIRTIO_NET_F_CTRL_VLAN	    |	\
+	 1ULL << VIRTIO_NET_F_MRG_RXBUF	    |	\
+	 1ULL << VIRTIO_F_VERSION_1	    |	\
+	 1ULL << VIRTIO_F_RING_PACKED	    |	\
+	 1ULL << VIRTIO_F_IN_ORDER)
+
+/*
+ * Device init/uninit, shared by the PCI and virtio-user drivers
+ */
+int eth_virtio_dev_init(struct rte_eth_dev *eth_dev);
+
+int eth_virtio_dev_uninit(struct rte_eth_dev *eth_dev);
 
 /*
  * CQ function prototype
@@ -108,9 +118,24 @@ uint16_t virtio_recv_mergeable_pkts(void *rx_queue, struct rte_mbuf **rx_pkts,
 uint16_t virtio_xmit_pkts(void *tx_queue, struct rte_mbuf **tx_pkts,
 		uint16_t nb_pkts);
 
+uint16_t virtio_recv_pkts_packed(void *rx_queue, struct rte_mbuf **rx_pkts,
+		uint16_t nb_pkts);
+
+uint16_t virtio_recv_mergeable_pkts_packed(void *rx_queue,
+		struct rte_mbuf **rx_pkts, uint16_t nb_pkts);
+
+uint16_t virtio_xmit_pkts_packed(void *tx_queue, struct rte_mbuf **tx_pkts,
+		uint16_t nb_pkts);
+
 uint16_t virtio_recv_pkts_vec(void *rx_queue, struct rte_mbuf **rx_pkts,
 		uint16_t nb_pkts);
 
+uint16_t virtio_recv_mergeable_pkts_vec(void *rx_queue,
+		struct rte_mbuf **rx_pkts, uint16_t nb_pkts);
+
+uint16_t virtio_xmit_pkts_inorder(void *tx_queue, struct rte_mbuf **tx_pkts,
+		uint16_t nb_pkts);
+
 uint16_t virtio_xmit_pkts_simple(void *tx_queue, struct rte_mbuf **tx_pkts,
 		uint16_t nb_pkts);
 
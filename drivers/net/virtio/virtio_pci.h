@@ -155,6 +155,15 @@ struct virtqueue;
  * at the end of the used ring. Guest should ignore the used->flags field. */
 #define VIRTIO_RING_F_EVENT_IDX		29
 
+/* Virtio 1.0 compliant device: the header always has num_buffers. */
+#define VIRTIO_F_VERSION_1		32
+
+/* The rings use the packed layout of virtio 1.1. */
+#define VIRTIO_F_RING_PACKED		34
+
+/* The device uses the buffers in the order they were made available. */
+#define VIRTIO_F_IN_ORDER		35
+
 #define VIRTIO_NET_S_LINK_UP	1	/* Link is up */
 #define VIRTIO_NET_S_ANNOUNCE	2	/* Announcement is needed */
 
@@ -163,19 +172,68 @@ struct virtqueue;
  */
 #define VIRTIO_MAX_VIRTQUEUES 8
 
+struct virtio_hw;
+
+/*
+ * Operations used to access a virtio device. The legacy PCI device is
+ * driven through its I/O port registers, other transports (such as
+ * virtio-user) provide their own implementation.
+ */
+struct virtio_pci_ops {
+	void (*read_dev_cfg)(struct virtio_hw *hw, uint64_t offset,
+			     void *dst, int len);
+	void (*write_dev_cfg)(struct virtio_hw *hw, uint64_t offset,
+			      void *src, int len);
+	void (*reset)(struct virtio_hw *hw);
+
+	uint8_t (*get_status)(struct virtio_hw *hw);
+	void    (*set_status)(struct virtio_hw *hw, uint8_t status);
+
+	uint64_t (*get_features)(struct virtio_hw *hw);
+	void     (*set_features)(struct virtio_hw *hw, uint64_t features);
+
+	uint8_t (*get_isr)(struct virtio_hw *hw);
+
+	uint16_t (*set_config_irq)(struct virtio_hw *hw, uint16_t vec);
+
+	uint16_t (*get_queue_num)(struct virtio_hw *hw, uint16_t queue_id);
+	int (*setup_queue)(struct virtio_hw *hw, struct virtqueue *vq);
+	void (*del_queue)(struct virtio_hw *hw, struct virtqueue *vq);
+	void (*notify_queue)(struct virtio_hw *hw, struct virtqueue *vq);
+};
+
 struct virtio_hw {
 	struct virtqueue *cvq;
 	uint32_t    io_base;
-	uint32_t    guest_features;
+	uint64_t    guest_features;
 	uint32_t    max_tx_queues;
 	uint32_t    max_rx_queues;
 	uint16_t    vtnet_hdr_size;
 	uint8_t	    vlan_strip;
 	uint8_t	    use_msix;
 	uint8_t     started;
+	uint8_t     use_simple_rx;  /**< fixed RX vring layout */
+	uint8_t     use_simple_tx;  /**< fixed TX vring layout */
+	uint8_t     use_inorder_tx; /**< sequential TX descriptors */
+	uint8_t     port_id;
 	uint8_t     mac_addr[ETHER_ADDR_LEN];
+	void        *virtio_user_dev; /**< virtio-user device, NULL for PCI */
+};
+
+/*
+ * The ops pointer is process local, while struct virtio_hw lives in the
+ * shared device private data: keep it in a per-port array instead.
+ */
+struct virtio_hw_internal {
+	const struct virtio_pci_ops *vtpci_ops;
 };
 
+#define VTPCI_OPS(hw)	(virtio_hw_internal[(hw)->port_id].vtpci_ops)
+
+extern struct virtio_hw_internal virtio_hw_internal[RTE_MAX_ETHPORTS];
+
+extern const struct virtio_pci_ops legacy_ops;
+
 /*
  * This structure is just a reference to read
  * net device specific config space; it just a chodu structure
@@ -247,7 +305,7 @@ outl_p(unsigned int data, unsigned int port)
 static inline int
 vtpci_with_feature(struct virtio_hw *hw, uint32_t bit)
 {
-	return (hw->guest_features & (1u << bit)) != 0;
+	return (hw->guest_features & (1ULL << bit)) != 0;
 }
 
 /*
@@ -259,7 +317,7 @@ void vtpci_reinit_complete(struct virtio_hw *);
 
 void vtpci_set_status(struct virtio_hw *, uint8_t);
 
-uint32_t vtpci_negotiate_features(struct virtio_hw *, uint32_t);
+uint64_t vtpci_negotiate_features(struct virtio_hw *, uint64_t);
 
 void vtpci_write_dev_config(struct virtio_hw *, uint64_t, void *, int);
 
@@ -269,4 +327,6 @@ uint8_t vtpci_isr(struct virtio_hw *);
 
 uint16_t vtpci_irq_config(struct virtio_hw *, uint16_t);
 
+uint64_t vtpci_get_features(struct virtio_hw *);
+
 #endif /* _VIRTIO_PCI_H_ */
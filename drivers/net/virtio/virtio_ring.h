@@ -148,6 +148,68 @@ vring_init(struct vring *vr, unsigned int num, uint8_t *p,
 		RTE_ALIGN_CEIL((uintptr_t)(&vr->avail->ring[num]), align);
 }
 
+/*
+ * Packed ring (VIRTIO_F_RING_PACKED): a single descriptor ring is shared by
+ * the driver, making descriptors available, and the device, writing them
+ * back as used in place. The AVAIL and USED flags of a descriptor are
+ * compared with the wrap counter of the side reading it, which flips each
+ * time its index wraps around the ring.
+ */
+#define VRING_PACKED_DESC_F_AVAIL	(1 << 7)
+#define VRING_PACKED_DESC_F_USED	(1 << 15)
+#define VRING_PACKED_DESC_F_AVAIL_USED	(VRING_PACKED_DESC_F_AVAIL | \
+					 VRING_PACKED_DESC_F_USED)
+
+/* Values of the event suppression flags. */
+#define RING_EVENT_FLAGS_ENABLE		0x0
+#define RING_EVENT_FLAGS_DISABLE	0x1
+#define RING_EVENT_FLAGS_DESC		0x2
+
+/* Packed ring descriptors: 16 bytes, four per cache line. */
+struct vring_packed_desc {
+	uint64_t addr;  /* Buffer address. */
+	uint32_t len;   /* Buffer length. */
+	uint16_t id;    /* Buffer ID. */
+	uint16_t flags; /* The flags as indicated above. */
+};
+
+/* Event suppression area, one written by the driver, one by the device. */
+struct vring_packed_desc_event {
+	uint16_t desc_event_off_wrap;
+	uint16_t desc_event_flags;
+};
+
+struct vring_packed {
+	unsigned int num;
+	struct vring_packed_desc *desc;
+	struct vring_packed_desc_event *driver;
+	struct vring_packed_desc_event *device;
+};
+
+static inline size_t
+vring_packed_size(unsigned int num, unsigned long align)
+{
+	size_t size;
+
+	size = num * sizeof(struct vring_packed_desc);
+	size += sizeof(struct vring_packed_desc_event);
+	size = RTE_ALIGN_CEIL(size, align);
+	size += sizeof(struct vring_packed_desc_event);
+	return size;
+}
+
+static inline void
+vring_packed_init(struct vring_packed *vr, unsigned int num, uint8_t *p,
+	unsigned long align)
+{
+	vr->num = num;
+	vr->desc = (struct vring_packed_desc *)p;
+	vr->driver = (struct vring_packed_desc_event *)(p +
+		num * sizeof(struct vring_packed_desc));
+	vr->device = (struct vring_packed_desc_event *)
+		RTE_ALIGN_CEIL((uintptr_t)(vr->driver + 1), align);
+}
+
 /*
  * The following is used with VIRTIO_RING_F_EVENT_IDX.
  * Assuming a given event_idx value from the other size, if we have
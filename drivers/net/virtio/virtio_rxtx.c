@@ -64,10 +64,7 @@
 #endif
 
 
-#define VIRTIO_SIMPLE_FLAGS ((uint32_t)ETH_TXQ_FLAGS_NOMULTSEGS | \
-	ETH_TXQ_FLAGS_NOOFFLOADS)
-
-static int use_simple_rxtx;
+#define VIRTIO_MBUF_BURST_SZ 64
 
 static void
 vq_ring_free_chain(struct virtqueue *vq, uint16_t desc_idx)
@@ -165,6 +162,211 @@ virtio_xmit_cleanup(struct virtqueue *vq, uint16_t num)
 	}
 }
 
+#define PACKED_DESC_PER_CACHELINE \
+	(RTE_CACHE_LINE_SIZE / sizeof(struct vring_packed_desc))
+
+/*
+ * Same as virtqueue_dequeue_burst_rx() on a packed vring: the used
+ * descriptors are read in place, up to the first one not used yet.
+ *
+ * Receive buffers are a single descriptor, and the device writes one used
+ * descriptor per buffer: with VIRTIO_F_IN_ORDER, the buffer id is simply
+ * the ring index of the buffer.
+ */
+static uint16_t
+virtqueue_dequeue_burst_rx_packed(struct virtqueue *vq,
+				  struct rte_mbuf **rx_pkts,
+				  uint32_t *len, uint16_t num)
+{
+	struct vring_packed_desc *desc = vq->vq_ring_packed.desc;
+	struct vq_desc_extra *dxp;
+	struct rte_mbuf *cookie;
+	uint16_t used_idx, id;
+	uint16_t i;
+
+	for (i = 0; i < num; i++) {
+		used_idx = vq->vq_used_cons_idx;
+		if (!vq_packed_desc_is_used(vq, used_idx))
+			break;
+		virtio_rmb();
+
+		id = desc[used_idx].id;
+		len[i] = desc[used_idx].len;
+		dxp = &vq->vq_descx[id];
+		cookie = (struct rte_mbuf *)dxp->cookie;
+
+		if (unlikely(cookie == NULL)) {
+			PMD_DRV_LOG(ERR, "vring descriptor with no mbuf cookie at %u\n",
+				used_idx);
+			break;
+		}
+
+		rte_prefetch0(cookie);
+		rte_packet_prefetch(rte_pktmbuf_mtod(cookie, void *));
+		rx_pkts[i] = cookie;
+		dxp->cookie = NULL;
+
+		vq_packed_used_advance(vq, dxp->ndescs);
+		vq->vq_free_cnt = (uint16_t)(vq->vq_free_cnt + dxp->ndescs);
+		dxp->ndescs = 0;
+		if (!vq->vq_in_order) {
+			dxp->next = vq->vq_desc_head_idx;
+			vq->vq_desc_head_idx = id;
+		}
+	}
+
+	return i;
+}
+
+/*
+ * Cleanup from completed transmits on a packed vring, about num buffers.
+ *
+ * With VIRTIO_F_IN_ORDER, the device may write a single used descriptor for
+ * a batch of buffers, with the id of the last one: all the buffers up to
+ * it, the buffer id being its ring index, have then been used.
+ */
+static void
+virtio_xmit_cleanup_packed(struct virtqueue *vq, int num)
+{
+	struct vring_packed_desc *desc = vq->vq_ring_packed.desc;
+	struct vq_desc_extra *dxp;
+	uint16_t id, curr_id;
+
+	while (num > 0 && vq_packed_desc_is_used(vq, vq->vq_used_cons_idx)) {
+		virtio_rmb();
+		id = desc[vq->vq_used_cons_idx].id;
+
+		do {
+			curr_id = vq->vq_in_order ? vq->vq_used_cons_idx : id;
+			dxp = &vq->vq_descx[curr_id];
+			if (unlikely(dxp->ndescs == 0)) {
+				PMD_DRV_LOG(ERR, "used buffer id %u not in use\n",
+					curr_id);
+				return;
+			}
+
+			vq_packed_used_advance(vq, dxp->ndescs);
+			vq->vq_free_cnt =
+				(uint16_t)(vq->vq_free_cnt + dxp->ndescs);
+			dxp->ndescs = 0;
+			if (!vq->vq_in_order) {
+				dxp->next = vq->vq_desc_head_idx;
+				vq->vq_desc_head_idx = curr_id;
+			}
+
+			if (dxp->cookie != NULL) {
+				rte_pktmbuf_free(dxp->cookie);
+				dxp->cookie = NULL;
+			}
+			num--;
+		} while (curr_id != id);
+	}
+}
+
+/* Get an id for a new buffer starting at the available index. */
+static inline uint16_t
+vq_packed_get_buffer_id(struct virtqueue *vq)
+{
+	uint16_t id;
+
+	if (vq->vq_in_order)
+		return vq->vq_avail_idx;
+
+	id = vq->vq_desc_head_idx;
+	vq->vq_desc_head_idx = vq->vq_descx[id].next;
+	return id;
+}
+
+/*
+ * Make num receive buffers available on a packed vring. All the
+ * descriptors are filled before a single barrier, and their flags only
+ * then written: the device sees the descriptors sharing a cache line
+ * become available together.
+ */
+static inline int
+virtqueue_enqueue_recv_refill_packed(struct virtqueue *vq,
+				     struct rte_mbuf **cookies, uint16_t num)
+{
+	struct vring_packed_desc *desc = vq->vq_ring_packed.desc;
+	struct virtio_hw *hw = vq->hw;
+	struct vq_desc_extra *dxp;
+	uint16_t flags[VIRTIO_MBUF_BURST_SZ];
+	uint16_t head_idx, idx, id, i;
+
+	if (unlikely(vq->vq_free_cnt < num))
+		return -ENOSPC;
+
+	head_idx = vq->vq_avail_idx;
+	for (i = 0; i < num; i++) {
+		idx = vq->vq_avail_idx;
+		id = vq_packed_get_buffer_id(vq);
+		dxp = &vq->vq_descx[id];
+		dxp->cookie = (void *)cookies[i];
+		dxp->ndescs = 1;
+
+		desc[idx].addr = VIRTIO_MBUF_ADDR(cookies[i], vq) +
+			RTE_PKTMBUF_HEADROOM - hw->vtnet_hdr_size;
+		desc[idx].len = cookies[i]->buf_len - RTE_PKTMBUF_HEADROOM +
+			hw->vtnet_hdr_size;
+		desc[idx].id = id;
+		flags[i] = VRING_DESC_F_WRITE | vq->vq_packed_avail_flags;
+		vq_packed_avail_next(vq);
+	}
+	vq->vq_free_cnt = (uint16_t)(vq->vq_free_cnt - num);
+
+	virtio_wmb();
+	idx = head_idx;
+	for (i = 0; i < num; i++) {
+		desc[idx].flags = flags[i];
+		if (++idx == vq->vq_nentries)
+			idx = 0;
+	}
+
+	return 0;
+}
+
+/*
+ * Lay out a packet on a packed vring, from the available index on. The
+ * flags of the descriptors following the head are written at once, those
+ * of the head are returned for the caller to make the packet available.
+ */
+static inline void
+virtqueue_enqueue_xmit_packed(struct virtqueue *txvq, struct rte_mbuf *cookie,
+			      uint16_t *head_idx, uint16_t *head_flags)
+{
+	struct vring_packed_desc *desc = txvq->vq_ring_packed.desc;
+	struct vq_desc_extra *dxp;
+	uint16_t seg_num = cookie->nb_segs;
+	uint16_t needed = 1 + seg_num;
+	uint16_t head, idx, id;
+	size_t head_size = txvq->hw->vtnet_hdr_size;
+
+	head = txvq->vq_avail_idx;
+	id = vq_packed_get_buffer_id(txvq);
+	dxp = &txvq->vq_descx[id];
+	dxp->cookie = (void *)cookie;
+	dxp->ndescs = needed;
+
+	desc[head].addr = txvq->virtio_net_hdr_mem + head * head_size;
+	desc[head].len = head_size;
+	desc[head].id = id;
+	*head_idx = head;
+	*head_flags = VRING_DESC_F_NEXT | txvq->vq_packed_avail_flags;
+	vq_packed_avail_next(txvq);
+
+	for (; ((seg_num > 0) && (cookie != NULL)); seg_num--) {
+		idx = txvq->vq_avail_idx;
+		desc[idx].addr = VIRTIO_MBUF_DATA_DMA_ADDR(cookie, txvq);
+		desc[idx].len = cookie->data_len;
+		desc[idx].id = id;
+		desc[idx].flags = txvq->vq_packed_avail_flags |
+			(seg_num > 1 ? VRING_DESC_F_NEXT : 0);
+		vq_packed_avail_next(txvq);
+		cookie = cookie->next;
+	}
+
+	txvq->vq_free_cnt = (uint16_t)(txvq->vq_free_cnt - needed);
+}
 
 static inline int
 virtqueue_enqueue_recv_refill(struct virtqueue *vq, struct rte_mbuf *cookie)
@@ -191,8 +393,8 @@ virtqueue_enqueue_recv_refill(struct virtqueue *vq, struct rte_mbuf *cookie)
 
 	start_dp = vq->vq_ring.desc;
 	start_dp[idx].addr =
-		(uint64_t)(cookie->buf_physaddr + RTE_PKTMBUF_HEADROOM
-		- hw->vtnet_hdr_size);
+		VIRTIO_MBUF_ADDR(cookie, vq) + RTE_PKTMBUF_HEADROOM
+		- hw->vtnet_hdr_size;
 	start_dp[idx].len =
 		cookie->buf_len - RTE_PKTMBUF_HEADROOM + hw->vtnet_hdr_size;
 	start_dp[idx].flags =  VRING_DESC_F_WRITE;
@@ -237,7 +439,7 @@ virtqueue_enqueue_xmit(struct virtqueue *txvq, struct rte_mbuf *cookie)
 
 	for (; ((seg_num > 0) && (cookie != NULL)); seg_num--) {
 		idx = start_dp[idx].next;
-		start_dp[idx].addr  = RTE_MBUF_DATA_DMA_ADDR(cookie);
+		start_dp[idx].addr  = VIRTIO_MBUF_DATA_DMA_ADDR(cookie, txvq);
 		start_dp[idx].len   = cookie->data_len;
 		start_dp[idx].flags = VRING_DESC_F_NEXT;
 		cookie = cookie->next;
@@ -265,6 +467,53 @@ rte_rxmbuf_alloc(struct rte_mempool *mp)
 	return m;
 }
 
+static void
+virtio_dev_vring_start_packed(struct virtqueue *vq, int queue_type)
+{
+	struct rte_mbuf *m;
+	int i, nbufs;
+
+	vring_packed_init(&vq->vq_ring_packed, vq->vq_nentries,
+			  vq->vq_ring_virt_mem, VIRTIO_PCI_VRING_ALIGN);
+	vq->vq_avail_idx = 0;
+	vq->vq_used_cons_idx = 0;
+	vq->vq_avail_wrap_counter = 1;
+	vq->vq_used_wrap_counter = 1;
+	vq->vq_packed_avail_flags = VRING_PACKED_DESC_F_AVAIL;
+	vq->vq_free_cnt = vq->vq_nentries;
+	memset(vq->vq_descx, 0, sizeof(struct vq_desc_extra) * vq->vq_nentries);
+
+	/* Chain all the buffer ids, only used out of order, with an END */
+	for (i = 0; i < vq->vq_nentries - 1; i++)
+		vq->vq_descx[i].next = (uint16_t)(i + 1);
+	vq->vq_descx[i].next = VQ_RING_DESC_CHAIN_END;
+	vq->vq_desc_head_idx = 0;
+
+	virtqueue_disable_intr(vq);
+
+	if (queue_type == VTNET_RQ) {
+		if (vq->mpool == NULL)
+			rte_exit(EXIT_FAILURE,
+			"Cannot allocate initial mbufs for rx virtqueue");
+
+		nbufs = 0;
+		while (!virtqueue_full(vq)) {
+			m = rte_rxmbuf_alloc(vq->mpool);
+			if (m == NULL)
+				break;
+			if (virtqueue_enqueue_recv_refill_packed(vq, &m, 1)) {
+				rte_pktmbuf_free(m);
+				break;
+			}
+			nbufs++;
+		}
+
+		PMD_INIT_LOG(DEBUG, "Allocated %d bufs", nbufs);
+	}
+
+	VTPCI_OPS(vq->hw)->setup_queue(vq->hw, vq);
+}
+
 static void
 virtio_dev_vring_start(struct virtqueue *vq, int queue_type)
 {
@@ -279,8 +528,13 @@ virtio_dev_vring_start(struct virtqueue *vq, int queue_type)
 	 * Reinitialise since virtio port might have been stopped and restarted
 	 */
 	memset(vq->vq_ring_virt_mem, 0, vq->vq_ring_size);
+	if (vq->vq_packed) {
+		virtio_dev_vring_start_packed(vq, queue_type);
+		return;
+	}
 	vring_init(vr, size, ring_mem, VIRTIO_PCI_VRING_ALIGN);
 	vq->vq_used_cons_idx = 0;
+	vq->vq_rx_discard = 0;
 	vq->vq_desc_head_idx = 0;
 	vq->vq_avail_idx = 0;
 	vq->vq_desc_tail_idx = (uint16_t)(vq->vq_nentries - 1);
@@ -307,7 +561,7 @@ virtio_dev_vring_start(struct virtqueue *vq, int queue_type)
 		nbufs = 0;
 		error = ENOSPC;
 
-		if (use_simple_rxtx)
+		if (vq->hw->use_simple_rx)
 			for (i = 0; i < vq->vq_nentries; i++) {
 				vq->vq_ring.avail->ring[i] = i;
 				vq->vq_ring.desc[i].flags = VRING_DESC_F_WRITE;
@@ -325,7 +579,7 @@ virtio_dev_vring_start(struct virtqueue *vq, int queue_type)
 			/******************************************
 			*         Enqueue allocated buffers        *
 			*******************************************/
-			if (use_simple_rxtx)
+			if (vq->hw->use_simple_rx)
 				error = virtqueue_enqueue_recv_refill_simple(vq, m);
 			else
 				error = virtqueue_enqueue_recv_refill(vq, m);
@@ -339,13 +593,12 @@ virtio_dev_vring_start(struct virtqueue *vq, int queue_type)
 		vq_update_avail_idx(vq);
 
 		PMD_INIT_LOG(DEBUG, "Allocated %d bufs", nbufs);
-
-		VIRTIO_WRITE_REG_2(vq->hw, VIRTIO_PCI_QUEUE_SEL,
-			vq->vq_queue_index);
-		VIRTIO_WRITE_REG_4(vq->hw, VIRTIO_PCI_QUEUE_PFN,
-			vq->mz->phys_addr >> VIRTIO_PCI_QUEUE_ADDR_SHIFT);
 	} else if (queue_type == VTNET_TQ) {
-		if (use_simple_rxtx) {
+		if (vq->hw->use_inorder_tx) {
+			/* Descriptors are taken in turn, wrapping around */
+			vr->desc[size - 1].next = 0;
+			vq->vq_desc_tail_idx = 0;
+		} else if (vq->hw->use_simple_tx) {
 			int mid_idx  = vq->vq_nentries >> 1;
 			for (i = 0; i < mid_idx; i++) {
 				vq->vq_ring.avail->ring[i] = i + mid_idx;
@@ -362,17 +615,9 @@ virtio_dev_vring_start(struct virtqueue *vq, int queue_type)
 			for (i = mid_idx; i < vq->vq_nentries; i++)
 				vq->vq_ring.avail->ring[i] = i;
 		}
-
-		VIRTIO_WRITE_REG_2(vq->hw, VIRTIO_PCI_QUEUE_SEL,
-			vq->vq_queue_index);
-		VIRTIO_WRITE_REG_4(vq->hw, VIRTIO_PCI_QUEUE_PFN,
-			vq->mz->phys_addr >> VIRTIO_PCI_QUEUE_ADDR_SHIFT);
-	} else {
-		VIRTIO_WRITE_REG_2(vq->hw, VIRTIO_PCI_QUEUE_SEL,
-			vq->vq_queue_index);
-		VIRTIO_WRITE_REG_4(vq->hw, VIRTIO_PCI_QUEUE_PFN,
-			vq->mz->phys_addr >> VIRTIO_PCI_QUEUE_ADDR_SHIFT);
 	}
+
+	VTPCI_OPS(vq->hw)->setup_queue(vq->hw, vq);
 }
 
 void
@@ -464,7 +709,6 @@ virtio_dev_tx_queue_setup(struct rte_eth_dev *dev,
 			const struct rte_eth_txconf *tx_conf)
 {
 	uint8_t vtpci_queue_idx = 2 * queue_idx + VTNET_SQ_TQ_QUEUE_IDX;
-	struct virtio_hw *hw = dev->data->dev_private;
 	struct virtqueue *vq;
 	uint16_t tx_free_thresh;
 	int ret;
@@ -477,15 +721,6 @@ virtio_dev_tx_queue_setup(struct rte_eth_dev *dev,
 		return -EINVAL;
 	}
 
-	/* Use simple rx/tx func if single segment and no offloads */
-	if ((tx_conf->txq_flags & VIRTIO_SIMPLE_FLAGS) == VIRTIO_SIMPLE_FLAGS &&
-	     !vtpci_with_feature(hw, VIRTIO_NET_F_MRG_RXBUF)) {
-		PMD_INIT_LOG(INFO, "Using simple rx/tx path");
-		dev->tx_pkt_burst = virtio_xmit_pkts_simple;
-		dev->rx_pkt_burst = virtio_recv_pkts_vec;
-		use_simple_rxtx = 1;
-	}
-
 	ret = virtio_dev_queue_setup(dev, VTNET_TQ, queue_idx, vtpci_queue_idx,
 			nb_desc, socket_id, &vq);
 	if (ret < 0) {
@@ -508,6 +743,8 @@ virtio_dev_tx_queue_setup(struct rte_eth_dev *dev,
 	}
 
 	vq->vq_free_thresh = tx_free_thresh;
+	/* The TX burst function is picked at start, on all the TX queues */
+	vq->txq_flags = tx_conf->txq_flags;
 
 	dev->data->tx_queues[queue_idx] = vq;
 	return 0;
@@ -527,7 +764,10 @@ virtio_discard_rxbuf(struct virtqueue *vq, struct rte_mbuf *m)
 	 * Requeue the discarded mbuf. This should always be
 	 * successful since it was just dequeued.
 	 */
-	error = virtqueue_enqueue_recv_refill(vq, m);
+	if (vq->vq_packed)
+		error = virtqueue_enqueue_recv_refill_packed(vq, &m, 1);
+	else
+		error = virtqueue_enqueue_recv_refill(vq, m);
 	if (unlikely(error)) {
 		RTE_LOG(ERR, PMD, "cannot requeue discarded mbuf");
 		rte_pktmbuf_free(m);
@@ -562,7 +802,6 @@ virtio_update_packet_stats(struct virtqueue *vq, struct rte_mbuf *mbuf)
 	vq->broadcast += is_broadcast_ether_addr(ea);
 }
 
-#define VIRTIO_MBUF_BURST_SZ 64
 #define DESC_PER_CACHELINE (RTE_CACHE_LINE_SIZE / sizeof(struct vring_desc))
 uint16_t
 virtio_recv_pkts(void *rx_queue, struct rte_mbuf **rx_pkts, uint16_t nb_pkts)
@@ -575,7 +814,7 @@ virtio_recv_pkts(void *rx_queue, struct rte_mbuf **rx_pkts, uint16_t nb_pkts)
 	struct rte_mbuf *rcv_pkts[VIRTIO_MBUF_BURST_SZ];
 	int error;
 	uint32_t i, nb_enqueued;
-	const uint32_t hdr_size = sizeof(struct virtio_net_hdr);
+	const uint32_t hdr_size = rxvq->hw->vtnet_hdr_size;
 
 	nb_used = VIRTQUEUE_NUSED(rxvq);
 
@@ -631,6 +870,7 @@ virtio_recv_pkts(void *rx_queue, struct rte_mbuf **rx_pkts, uint16_t nb_pkts)
 	}
 
 	rxvq->packets += nb_rx;
+	rxvq->path_packets[VIRTIO_PATH_SCALAR] += nb_rx;
 
 	/* Allocate new mbuf for the used descriptor */
 	error = ENOSPC;
@@ -797,6 +1037,7 @@ virtio_recv_mergeable_pkts(void *rx_queue,
 	}
 
 	rxvq->packets += nb_rx;
+	rxvq->path_packets[VIRTIO_PATH_SCALAR] += nb_rx;
 
 	/* Allocate new mbuf for the used descriptor */
 	error = ENOSPC;
@@ -891,6 +1132,144 @@ virtio_xmit_pkts(void *tx_queue, struct rte_mbuf **tx_pkts, uint16_t nb_pkts)
 	}
 
 	txvq->packets += nb_tx;
+	txvq->path_packets[VIRTIO_PATH_SCALAR] += nb_tx;
+
+	if (likely(nb_tx)) {
+		vq_update_avail_idx(txvq);
+
+		if (unlikely(virtqueue_kick_prepare(txvq))) {
+			virtqueue_notify(txvq);
+			PMD_TX_LOG(DEBUG, "Notified backend after xmit");
+		}
+	}
+
+	return nb_tx;
+}
+
+/*
+ * In-order TX on a split vring: with VIRTIO_F_IN_ORDER the device uses
+ * the buffers in the order they were made available, so the descriptors
+ * are taken in turn around the ring, already chained by their preset next
+ * fields, instead of from the free list. vq_desc_head_idx is the next
+ * descriptor to fill, vq_desc_tail_idx the head of the oldest buffer not
+ * reclaimed yet.
+ */
+static inline void
+virtqueue_enqueue_xmit_inorder(struct virtqueue *txvq, struct rte_mbuf *cookie)
+{
+	struct vring_desc *start_dp = txvq->vq_ring.desc;
+	struct vq_desc_extra *dxp;
+	uint16_t seg_num = cookie->nb_segs;
+	uint16_t needed = 1 + seg_num;
+	uint16_t mask = txvq->vq_nentries - 1;
+	uint16_t head_idx, idx;
+	size_t head_size = txvq->hw->vtnet_hdr_size;
+
+	head_idx = idx = txvq->vq_desc_head_idx;
+	dxp = &txvq->vq_descx[head_idx];
+	dxp->cookie = (void *)cookie;
+	dxp->ndescs = needed;
+
+	start_dp[idx].addr = txvq->virtio_net_hdr_mem + idx * head_size;
+	start_dp[idx].len = head_size;
+	start_dp[idx].flags = VRING_DESC_F_NEXT;
+
+	for (; ((seg_num > 0) && (cookie != NULL)); seg_num--) {
+		idx = (idx + 1) & mask;
+		start_dp[idx].addr  = VIRTIO_MBUF_DATA_DMA_ADDR(cookie, txvq);
+		start_dp[idx].len   = cookie->data_len;
+		start_dp[idx].flags = VRING_DESC_F_NEXT;
+		cookie = cookie->next;
+	}
+
+	start_dp[idx].flags &= ~VRING_DESC_F_NEXT;
+	txvq->vq_desc_head_idx = (idx + 1) & mask;
+	txvq->vq_free_cnt = (uint16_t)(txvq->vq_free_cnt - needed);
+	vq_update_avail_ring(txvq, head_idx);
+}
+
+/*
+ * Reclaim the buffers of num used elements. The device may use a single
+ * element for a batch of buffers, which then completes all the buffers
+ * made available before the one it names.
+ */
+static void
+virtio_xmit_cleanup_inorder(struct virtqueue *vq, uint16_t num)
+{
+	struct vq_desc_extra *dxp;
+	uint16_t mask = vq->vq_nentries - 1;
+	uint16_t used_idx, last, desc_idx, cur;
+
+	used_idx = (uint16_t)((vq->vq_used_cons_idx + num - 1) & mask);
+	last = (uint16_t)vq->vq_ring.used->ring[used_idx].id;
+	vq->vq_used_cons_idx += num;
+
+	desc_idx = vq->vq_desc_tail_idx;
+	do {
+		cur = desc_idx;
+		dxp = &vq->vq_descx[cur];
+		desc_idx = (uint16_t)((cur + dxp->ndescs) & mask);
+		vq->vq_free_cnt = (uint16_t)(vq->vq_free_cnt + dxp->ndescs);
+		dxp->ndescs = 0;
+		if (dxp->cookie != NULL) {
+			rte_pktmbuf_free(dxp->cookie);
+			dxp->cookie = NULL;
+		}
+	} while (cur != last && desc_idx != vq->vq_desc_head_idx);
+	vq->vq_desc_tail_idx = desc_idx;
+}
+
+uint16_t
+virtio_xmit_pkts_inorder(void *tx_queue, struct rte_mbuf **tx_pkts,
+			 uint16_t nb_pkts)
+{
+	struct virtqueue *txvq = tx_queue;
+	uint16_t nb_used, nb_tx;
+	int error;
+
+	if (unlikely(nb_pkts < 1))
+		return nb_pkts;
+
+	PMD_TX_LOG(DEBUG, "%d packets to xmit", nb_pkts);
+	nb_used = VIRTQUEUE_NUSED(txvq);
+
+	virtio_rmb();
+	if (likely(nb_used > txvq->vq_nentries - txvq->vq_free_thresh))
+		virtio_xmit_cleanup_inorder(txvq, nb_used);
+
+	for (nb_tx = 0; nb_tx < nb_pkts; nb_tx++) {
+		struct rte_mbuf *txm = tx_pkts[nb_tx];
+
+		/* Need one more descriptor for virtio header. */
+		if (unlikely(txm->nb_segs + 1 > txvq->vq_free_cnt)) {
+			nb_used = VIRTQUEUE_NUSED(txvq);
+			virtio_rmb();
+			if (nb_used)
+				virtio_xmit_cleanup_inorder(txvq, nb_used);
+			if (unlikely(txm->nb_segs + 1 > txvq->vq_free_cnt)) {
+				PMD_TX_LOG(ERR,
+					   "No free tx descriptors to transmit");
+				break;
+			}
+		}
+
+		/* Do VLAN tag insertion */
+		if (unlikely(txm->ol_flags & PKT_TX_VLAN_PKT)) {
+			error = rte_vlan_insert(&txm);
+			if (unlikely(error)) {
+				rte_pktmbuf_free(txm);
+				continue;
+			}
+		}
+
+		virtqueue_enqueue_xmit_inorder(txvq, txm);
+
+		txvq->bytes += txm->pkt_len;
+		virtio_update_packet_stats(txvq, txm);
+	}
+
+	txvq->packets += nb_tx;
+	txvq->path_packets[VIRTIO_PATH_INORDER] += nb_tx;
 
 	if (likely(nb_tx)) {
 		vq_update_avail_idx(txvq);
@@ -903,3 +1282,301 @@ virtio_xmit_pkts(void *tx_queue, struct rte_mbuf **tx_pkts, uint16_t nb_pkts)
 
 	return nb_tx;
 }
+
+/*
+ * Refill the free descriptors of a packed receive vring, in batches ending
+ * on a descriptor cache line boundary where possible, and notify the
+ * device if it asked for it.
+ */
+static void
+virtio_rx_refill_packed(struct virtqueue *rxvq)
+{
+	struct rte_mbuf *new_pkts[VIRTIO_MBUF_BURST_SZ];
+	uint16_t nb_enqueued = 0;
+	uint16_t n, i;
+
+	while (likely(!virtqueue_full(rxvq))) {
+		n = RTE_MIN(rxvq->vq_free_cnt, VIRTIO_MBUF_BURST_SZ);
+		if (likely(n > PACKED_DESC_PER_CACHELINE))
+			n -= (rxvq->vq_avail_idx + n) %
+				PACKED_DESC_PER_CACHELINE;
+
+		for (i = 0; i < n; i++) {
+			new_pkts[i] = rte_rxmbuf_alloc(rxvq->mpool);
+			if (unlikely(new_pkts[i] == NULL)) {
+				struct rte_eth_dev *dev
+					= &rte_eth_devices[rxvq->port_id];
+				dev->data->rx_mbuf_alloc_failed++;
+				break;
+			}
+		}
+		if (i == 0)
+			break;
+
+		virtqueue_enqueue_recv_refill_packed(rxvq, new_pkts, i);
+		nb_enqueued += i;
+		if (i < n)
+			break;
+	}
+
+	if (likely(nb_enqueued)) {
+		if (unlikely(virtqueue_kick_prepare_packed(rxvq))) {
+			virtqueue_notify(rxvq);
+			PMD_RX_LOG(DEBUG, "Notified");
+		}
+	}
+}
+
+uint16_t
+virtio_recv_pkts_packed(void *rx_queue, struct rte_mbuf **rx_pkts,
+			uint16_t nb_pkts)
+{
+	struct virtqueue *rxvq = rx_queue;
+	struct virtio_hw *hw = rxvq->hw;
+	struct rte_mbuf *rxm;
+	uint16_t num, nb_rx;
+	uint32_t len[VIRTIO_MBUF_BURST_SZ];
+	struct rte_mbuf *rcv_pkts[VIRTIO_MBUF_BURST_SZ];
+	uint32_t i;
+	const uint32_t hdr_size = hw->vtnet_hdr_size;
+
+	num = RTE_MIN(nb_pkts, VIRTIO_MBUF_BURST_SZ);
+	if (likely(num > PACKED_DESC_PER_CACHELINE))
+		num -= (rxvq->vq_used_cons_idx + num) %
+			PACKED_DESC_PER_CACHELINE;
+
+	num = virtqueue_dequeue_burst_rx_packed(rxvq, rcv_pkts, len, num);
+	PMD_RX_LOG(DEBUG, "dequeue:%d", num);
+	if (num == 0)
+		return 0;
+
+	nb_rx = 0;
+	for (i = 0; i < num ; i++) {
+		rxm = rcv_pkts[i];
+
+		PMD_RX_LOG(DEBUG, "packet len:%d", len[i]);
+
+		if (unlikely(len[i] < hdr_size + ETHER_HDR_LEN)) {
+			PMD_RX_LOG(ERR, "Packet drop");
+			virtio_discard_rxbuf(rxvq, rxm);
+			rxvq->errors++;
+			continue;
+		}
+
+		rxm->port = rxvq->port_id;
+		rxm->data_off = RTE_PKTMBUF_HEADROOM;
+		rxm->ol_flags = 0;
+		rxm->vlan_tci = 0;
+
+		rxm->nb_segs = 1;
+		rxm->next = NULL;
+		rxm->pkt_len = (uint32_t)(len[i] - hdr_size);
+		rxm->data_len = (uint16_t)(len[i] - hdr_size);
+
+		if (hw->vlan_strip)
+			rte_vlan_strip(rxm);
+
+		VIRTIO_DUMP_PACKET(rxm, rxm->data_len);
+
+		rx_pkts[nb_rx++] = rxm;
+
+		rxvq->bytes += rxm->pkt_len;
+		virtio_update_packet_stats(rxvq, rxm);
+	}
+
+	rxvq->packets += nb_rx;
+	rxvq->path_packets[VIRTIO_PATH_PACKED] += nb_rx;
+
+	virtio_rx_refill_packed(rxvq);
+
+	return nb_rx;
+}
+
+uint16_t
+virtio_recv_mergeable_pkts_packed(void *rx_queue,
+			struct rte_mbuf **rx_pkts,
+			uint16_t nb_pkts)
+{
+	struct virtqueue *rxvq = rx_queue;
+	struct virtio_hw *hw = rxvq->hw;
+	struct rte_mbuf *rxm, *prev;
+	uint16_t num, nb_rx;
+	uint32_t len[VIRTIO_MBUF_BURST_SZ];
+	struct rte_mbuf *rcv_pkts[VIRTIO_MBUF_BURST_SZ];
+	uint32_t seg_num;
+	uint32_t seg_res;
+	uint16_t extra_idx;
+	const uint32_t hdr_size = sizeof(struct virtio_net_hdr_mrg_rxbuf);
+
+	nb_rx = 0;
+	while (nb_rx < nb_pkts) {
+		struct virtio_net_hdr_mrg_rxbuf *header;
+
+		num = virtqueue_dequeue_burst_rx_packed(rxvq, rcv_pkts, len, 1);
+		if (num != 1)
+			break;
+
+		PMD_RX_LOG(DEBUG, "packet len:%d\n", len[0]);
+
+		rxm = rcv_pkts[0];
+
+		if (unlikely(len[0] < hdr_size + ETHER_HDR_LEN)) {
+			PMD_RX_LOG(ERR, "Packet drop\n");
+			virtio_discard_rxbuf(rxvq, rxm);
+			rxvq->errors++;
+			continue;
+		}
+
+		header = (struct virtio_net_hdr_mrg_rxbuf *)((char *)rxm->buf_addr +
+			RTE_PKTMBUF_HEADROOM - hdr_size);
+		seg_num = header->num_buffers;
+
+		if (seg_num == 0)
+			seg_num = 1;
+
+		rxm->data_off = RTE_PKTMBUF_HEADROOM;
+		rxm->nb_segs = seg_num;
+		rxm->next = NULL;
+		rxm->ol_flags = 0;
+		rxm->vlan_tci = 0;
+		rxm->pkt_len = (uint32_t)(len[0] - hdr_size);
+		rxm->data_len = (uint16_t)(len[0] - hdr_size);
+
+		rxm->port = rxvq->port_id;
+		prev = rxm;
+
+		/*
+		 * The device makes the buffers of a packet used together:
+		 * get the extra segments of the current packet.
+		 */
+		seg_res = seg_num - 1;
+		while (seg_res != 0) {
+			uint16_t rcv_cnt = RTE_MIN(seg_res, RTE_DIM(rcv_pkts));
+
+			num = virtqueue_dequeue_burst_rx_packed(rxvq,
+				rcv_pkts, len, rcv_cnt);
+
+			for (extra_idx = 0; extra_idx < num; extra_idx++) {
+				struct rte_mbuf *seg = rcv_pkts[extra_idx];
+
+				seg->data_off = RTE_PKTMBUF_HEADROOM - hdr_size;
+				seg->next = NULL;
+				seg->pkt_len = (uint32_t)(len[extra_idx]);
+				seg->data_len = (uint16_t)(len[extra_idx]);
+
+				prev->next = seg;
+				prev = seg;
+				rxm->pkt_len += seg->pkt_len;
+			}
+			seg_res -= num;
+			if (num < rcv_cnt)
+				break;
+		}
+
+		if (unlikely(seg_res != 0)) {
+			PMD_RX_LOG(ERR, "No enough segments for packet.\n");
+			rte_pktmbuf_free(rxm);
+			rxvq->errors++;
+			continue;
+		}
+
+		if (hw->vlan_strip)
+			rte_vlan_strip(rxm);
+
+		VIRTIO_DUMP_PACKET(rxm, rxm->data_len);
+
+		rx_pkts[nb_rx++] = rxm;
+
+		rxvq->bytes += rxm->pkt_len;
+		virtio_update_packet_stats(rxvq, rxm);
+	}
+
+	rxvq->packets += nb_rx;
+	rxvq->path_packets[VIRTIO_PATH_PACKED] += nb_rx;
+
+	virtio_rx_refill_packed(rxvq);
+
+	return nb_rx;
+}
+
+/*
+ * Same as virtio_xmit_pkts() on a packed vring. The flags of the head
+ * descriptors are written after a single barrier per batch of packets,
+ * which the device thus sees become available together.
+ */
+uint16_t
+virtio_xmit_pkts_packed(void *tx_queue, struct rte_mbuf **tx_pkts,
+			uint16_t nb_pkts)
+{
+	struct virtqueue *txvq = tx_queue;
+	struct vring_packed_desc *desc = txvq->vq_ring_packed.desc;
+	uint16_t head_idx[VIRTIO_MBUF_BURST_SZ];
+	uint16_t head_flags[VIRTIO_MBUF_BURST_SZ];
+	uint16_t nb_tx, nb_heads = 0, i;
+	int error;
+
+	if (unlikely(nb_pkts < 1))
+		return nb_pkts;
+
+	PMD_TX_LOG(DEBUG, "%d packets to xmit", nb_pkts);
+
+	if (likely(txvq->vq_free_cnt < txvq->vq_free_thresh))
+		virtio_xmit_cleanup_packed(txvq, txvq->vq_nentries);
+
+	for (nb_tx = 0; nb_tx < nb_pkts; nb_tx++) {
+		struct rte_mbuf *txm = tx_pkts[nb_tx];
+		/* Need one more descriptor for virtio header. */
+		int need = txm->nb_segs - txvq->vq_free_cnt + 1;
+
+		/* Positive value indicates it need free vring descriptors */
+		if (unlikely(need > 0)) {
+			virtio_xmit_cleanup_packed(txvq, need);
+			need = txm->nb_segs - txvq->vq_free_cnt + 1;
+			if (unlikely(need > 0)) {
+				PMD_TX_LOG(ERR,
+					   "No free tx descriptors to transmit");
+				break;
+			}
+		}
+
+		/* Do VLAN tag insertion */
+		if (unlikely(txm->ol_flags & PKT_TX_VLAN_PKT)) {
+			error = rte_vlan_insert(&txm);
+			if (unlikely(error)) {
+				rte_pktmbuf_free(txm);
+				continue;
+			}
+		}
+
+		if (unlikely(nb_heads == VIRTIO_MBUF_BURST_SZ)) {
+			virtio_wmb();
+			for (i = 0; i < nb_heads; i++)
+				desc[head_idx[i]].flags = head_flags[i];
+			nb_heads = 0;
+		}
+
+		/* Enqueue Packet buffers */
+		virtqueue_enqueue_xmit_packed(txvq, txm, &head_idx[nb_heads],
+					      &head_flags[nb_heads]);
+		nb_heads++;
+
+		txvq->bytes += txm->pkt_len;
+		virtio_update_packet_stats(txvq, txm);
+	}
+
+	virtio_wmb();
+	for (i = 0; i < nb_heads; i++)
+		desc[head_idx[i]].flags = head_flags[i];
+
+	txvq->packets += nb_tx;
+	txvq->path_packets[VIRTIO_PATH_PACKED] += nb_tx;
+
+	if (likely(nb_tx)) {
+		if (unlikely(virtqueue_kick_prepare_packed(txvq))) {
+			virtqueue_notify(txvq);
+			PMD_TX_LOG(DEBUG, "Notified backend after xmit");
+		}
+	}
+
+	return nb_tx;
+}
@@ -33,6 +33,12 @@
 
 #define RTE_PMD_VIRTIO_RX_MAX_BURST 64
 
+/*
+ * Used elements handled per call of the vector RX paths, which also caps
+ * the buffers of a packet on the mergeable one.
+ */
+#define RTE_VIRTIO_VPMD_RX_BURST 32
+
 int virtio_rxq_vec_setup(struct virtqueue *rxq);
 
 int virtqueue_enqueue_recv_refill_simple(struct virtqueue *vq,
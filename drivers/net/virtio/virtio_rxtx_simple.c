@@ -58,7 +58,6 @@
 #include "virtqueue.h"
 #include "virtio_rxtx.h"
 
-#define RTE_VIRTIO_VPMD_RX_BURST 32
 #define RTE_VIRTIO_DESC_PER_LOOP 8
 #define RTE_VIRTIO_VPMD_RX_REARM_THRESH RTE_VIRTIO_VPMD_RX_BURST
 
@@ -78,12 +77,13 @@ virtqueue_enqueue_recv_refill_simple(struct virtqueue *vq,
 	dxp = &vq->vq_descx[desc_idx];
 	dxp->cookie = (void *)cookie;
 	vq->sw_ring[desc_idx] = cookie;
+	*(uint64_t *)(uintptr_t)&cookie->rearm_data = vq->mbuf_initializer;
 
 	start_dp = vq->vq_ring.desc;
-	start_dp[desc_idx].addr = (uint64_t)((uintptr_t)cookie->buf_physaddr +
-		RTE_PKTMBUF_HEADROOM - sizeof(struct virtio_net_hdr));
+	start_dp[desc_idx].addr = VIRTIO_MBUF_ADDR(cookie, vq) +
+		RTE_PKTMBUF_HEADROOM - vq->hw->vtnet_hdr_size;
 	start_dp[desc_idx].len = cookie->buf_len -
-		RTE_PKTMBUF_HEADROOM + sizeof(struct virtio_net_hdr);
+		RTE_PKTMBUF_HEADROOM + vq->hw->vtnet_hdr_size;
 
 	vq->vq_free_cnt--;
 	vq->vq_avail_idx++;
@@ -98,6 +98,7 @@ virtio_rxq_rearm_vec(struct virtqueue *rxvq)
 	uint16_t desc_idx;
 	struct rte_mbuf **sw_ring;
 	struct vring_desc *start_dp;
+	uint16_t hdr_size = rxvq->hw->vtnet_hdr_size;
 	int ret;
 
 	desc_idx = rxvq->vq_avail_idx & (rxvq->vq_nentries - 1);
@@ -118,11 +119,10 @@ virtio_rxq_rearm_vec(struct virtqueue *rxvq)
 		p = (uintptr_t)&sw_ring[i]->rearm_data;
 		*(uint64_t *)p = rxvq->mbuf_initializer;
 
-		start_dp[i].addr =
-			(uint64_t)((uintptr_t)sw_ring[i]->buf_physaddr +
-			RTE_PKTMBUF_HEADROOM - sizeof(struct virtio_net_hdr));
+		start_dp[i].addr = VIRTIO_MBUF_ADDR(sw_ring[i], rxvq) +
+			RTE_PKTMBUF_HEADROOM - hdr_size;
 		start_dp[i].len = sw_ring[i]->buf_len -
-			RTE_PKTMBUF_HEADROOM + sizeof(struct virtio_net_hdr);
+			RTE_PKTMBUF_HEADROOM + hdr_size;
 	}
 
 	rxvq->vq_avail_idx += RTE_VIRTIO_VPMD_RX_REARM_THRESH;
@@ -130,27 +130,23 @@ virtio_rxq_rearm_vec(struct virtqueue *rxvq)
 	vq_update_avail_idx(rxvq);
 }
 
-/* virtio vPMD receive routine, only accept(nb_pkts >= RTE_VIRTIO_DESC_PER_LOOP)
- *
- * This routine is for non-mergeable RX, one desc for each guest buffer.
- * This routine is based on the RX ring layout optimization. Each entry in the
- * avail ring points to the desc with the same index in the desc ring and this
- * will never be changed in the driver.
- *
- * - nb_pkts < RTE_VIRTIO_DESC_PER_LOOP, just return no packet
+/*
+ * Set the packet and data lengths of the mbufs of nb_used used elements,
+ * from position desc_idx of the used ring on, and store the mbufs in
+ * rx_pkts. Elements are processed RTE_VIRTIO_DESC_PER_LOOP at a time, so
+ * rx_pkts must have room for RTE_VIRTIO_DESC_PER_LOOP - 1 more entries.
+ * Stops at the end of the ring and returns the number of elements done.
  */
-uint16_t
-virtio_recv_pkts_vec(void *rx_queue, struct rte_mbuf **rx_pkts,
-	uint16_t nb_pkts)
+static inline uint16_t
+virtio_rx_vec_fill(struct virtqueue *rxvq, struct rte_mbuf **rx_pkts,
+	uint16_t desc_idx, uint16_t nb_used, __m128i len_adjust)
 {
-	struct virtqueue *rxvq = rx_queue;
-	uint16_t nb_used;
-	uint16_t desc_idx;
 	struct vring_used_elem *rused;
 	struct rte_mbuf **sw_ring;
 	struct rte_mbuf **sw_ring_end;
 	uint16_t nb_pkts_received;
-	__m128i shuf_msk1, shuf_msk2, len_adjust;
+	uint16_t nb_total = nb_used;
+	__m128i shuf_msk1, shuf_msk2;
 
 	shuf_msk1 = _mm_set_epi8(
 		0xFF, 0xFF, 0xFF, 0xFF,
@@ -169,45 +165,14 @@ virtio_recv_pkts_vec(void *rx_queue, struct rte_mbuf **rx_pkts,
 		0xFF, 0xFF, 0xFF, 0xFF	/* packet type */
 	);
 
-	/* Subtract the header length.
-	*  In which case do we need the header length in used->len ?
-	*/
-	len_adjust = _mm_set_epi16(
-		0, 0,
-		0,
-		(uint16_t) -sizeof(struct virtio_net_hdr),
-		0, (uint16_t) -sizeof(struct virtio_net_hdr),
-		0, 0);
-
-	if (unlikely(nb_pkts < RTE_VIRTIO_DESC_PER_LOOP))
-		return 0;
-
-	nb_used = *(volatile uint16_t *)&rxvq->vq_ring.used->idx -
-		rxvq->vq_used_cons_idx;
-
-	rte_compiler_barrier();
-
-	if (unlikely(nb_used == 0))
-		return 0;
-
-	nb_pkts = RTE_ALIGN_FLOOR(nb_pkts, RTE_VIRTIO_DESC_PER_LOOP);
-	nb_used = RTE_MIN(nb_used, nb_pkts);
-
-	desc_idx = (uint16_t)(rxvq->vq_used_cons_idx & (rxvq->vq_nentries - 1));
 	rused = &rxvq->vq_ring.used->ring[desc_idx];
 	sw_ring  = &rxvq->sw_ring[desc_idx];
 	sw_ring_end = &rxvq->sw_ring[rxvq->vq_nentries];
 
 	_mm_prefetch((const void *)rused, _MM_HINT_T0);
 
-	if (rxvq->vq_free_cnt >= RTE_VIRTIO_VPMD_RX_REARM_THRESH) {
-		virtio_rxq_rearm_vec(rxvq);
-		if (unlikely(virtqueue_kick_prepare(rxvq)))
-			virtqueue_notify(rxvq);
-	}
-
 	for (nb_pkts_received = 0;
-		nb_pkts_received < nb_used;) {
+		nb_pkts_received < nb_total;) {
 		__m128i desc[RTE_VIRTIO_DESC_PER_LOOP / 2];
 		__m128i mbp[RTE_VIRTIO_DESC_PER_LOOP / 2];
 		__m128i pkt_mb[RTE_VIRTIO_DESC_PER_LOOP];
@@ -286,12 +251,190 @@ virtio_recv_pkts_vec(void *rx_queue, struct rte_mbuf **rx_pkts,
 		}
 	}
 
+	return nb_pkts_received;
+}
+
+/* Subtract the header length from the pkt len and data len fields */
+static inline __m128i
+virtio_rx_vec_len_adjust(uint16_t hdr_size)
+{
+	return _mm_set_epi16(
+		0, 0,
+		0,
+		(uint16_t)-hdr_size,
+		0, (uint16_t)-hdr_size,
+		0, 0);
+}
+
+/* virtio vPMD receive routine, only accept(nb_pkts >= RTE_VIRTIO_DESC_PER_LOOP)
+ *
+ * This routine is for non-mergeable RX, one desc for each guest buffer.
+ * This routine is based on the RX ring layout optimization. Each entry in the
+ * avail ring points to the desc with the same index in the desc ring and this
+ * will never be changed in the driver.
+ *
+ * - nb_pkts < RTE_VIRTIO_DESC_PER_LOOP, just return no packet
+ */
+uint16_t
+virtio_recv_pkts_vec(void *rx_queue, struct rte_mbuf **rx_pkts,
+	uint16_t nb_pkts)
+{
+	struct virtqueue *rxvq = rx_queue;
+	uint16_t nb_used;
+	uint16_t desc_idx;
+	uint16_t nb_pkts_received;
+
+	if (unlikely(nb_pkts < RTE_VIRTIO_DESC_PER_LOOP))
+		return 0;
+
+	nb_used = *(volatile uint16_t *)&rxvq->vq_ring.used->idx -
+		rxvq->vq_used_cons_idx;
+
+	rte_compiler_barrier();
+
+	if (unlikely(nb_used == 0))
+		return 0;
+
+	nb_pkts = RTE_ALIGN_FLOOR(nb_pkts, RTE_VIRTIO_DESC_PER_LOOP);
+	nb_used = RTE_MIN(nb_used, nb_pkts);
+
+	desc_idx = (uint16_t)(rxvq->vq_used_cons_idx & (rxvq->vq_nentries - 1));
+
+	if (rxvq->vq_free_cnt >= RTE_VIRTIO_VPMD_RX_REARM_THRESH) {
+		virtio_rxq_rearm_vec(rxvq);
+		if (unlikely(virtqueue_kick_prepare(rxvq)))
+			virtqueue_notify(rxvq);
+	}
+
+	nb_pkts_received = virtio_rx_vec_fill(rxvq, rx_pkts, desc_idx, nb_used,
+		virtio_rx_vec_len_adjust(rxvq->hw->vtnet_hdr_size));
+
 	rxvq->vq_used_cons_idx += nb_pkts_received;
 	rxvq->vq_free_cnt += nb_pkts_received;
 	rxvq->packets += nb_pkts_received;
+	rxvq->path_packets[VIRTIO_PATH_VEC] += nb_pkts_received;
 	return nb_pkts_received;
 }
 
+/*
+ * virtio vPMD receive routine for mergeable buffers
+ *
+ * Same RX ring layout as virtio_recv_pkts_vec(). The lengths of up to
+ * RTE_VIRTIO_VPMD_RX_BURST used buffers are set with SSE, then the
+ * buffers of a packet spanning several of them, per num_buffers in its
+ * header, are chained to the first one. A packet whose buffers are not
+ * all used yet is left for the next call, so that no packet is kept
+ * across calls: the device must not use more than
+ * RTE_VIRTIO_VPMD_RX_BURST buffers for a packet, which the path
+ * selection checks against the mbuf size and max_rx_pkt_len. A packet
+ * with a bad num_buffers is dropped with all its buffers, the ones not
+ * used yet being dropped by the next calls.
+ */
+uint16_t
+virtio_recv_mergeable_pkts_vec(void *rx_queue, struct rte_mbuf **rx_pkts,
+	uint16_t nb_pkts)
+{
+	struct virtqueue *rxvq = rx_queue;
+	struct rte_mbuf *bufs[RTE_VIRTIO_VPMD_RX_BURST +
+		2 * RTE_VIRTIO_DESC_PER_LOOP];
+	struct virtio_net_hdr_mrg_rxbuf *hdr;
+	struct rte_mbuf *head, *prev, *seg;
+	uint16_t hdr_size = rxvq->hw->vtnet_hdr_size;
+	uint16_t nb_used, nb_bufs, nb_rx, desc_idx, i, j, n, seg_num;
+	uint64_t bytes = 0;
+	__m128i len_adjust;
+
+	nb_used = *(volatile uint16_t *)&rxvq->vq_ring.used->idx -
+		rxvq->vq_used_cons_idx;
+
+	rte_compiler_barrier();
+
+	if (unlikely(nb_used == 0))
+		return 0;
+
+	nb_used = RTE_MIN(nb_used, RTE_VIRTIO_VPMD_RX_BURST);
+
+	if (rxvq->vq_free_cnt >= RTE_VIRTIO_VPMD_RX_REARM_THRESH) {
+		virtio_rxq_rearm_vec(rxvq);
+		if (unlikely(virtqueue_kick_prepare(rxvq)))
+			virtqueue_notify(rxvq);
+	}
+
+	len_adjust = virtio_rx_vec_len_adjust(hdr_size);
+	desc_idx = (uint16_t)(rxvq->vq_used_cons_idx & (rxvq->vq_nentries - 1));
+	nb_bufs = virtio_rx_vec_fill(rxvq, bufs, desc_idx, nb_used,
+		len_adjust);
+	/* Carry on from the start of the ring */
+	if (nb_bufs < nb_used)
+		nb_bufs += virtio_rx_vec_fill(rxvq, &bufs[nb_bufs], 0,
+			nb_used - nb_bufs, len_adjust);
+
+	/* Rest of a packet dropped by a previous call */
+	i = 0;
+	if (unlikely(rxvq->vq_rx_discard != 0)) {
+		i = RTE_MIN(rxvq->vq_rx_discard, nb_bufs);
+		for (j = 0; j < i; j++)
+			rte_pktmbuf_free(bufs[j]);
+		rxvq->vq_rx_discard -= i;
+	}
+
+	nb_rx = 0;
+	while (i < nb_bufs && nb_rx < nb_pkts) {
+		head = bufs[i];
+		hdr = (struct virtio_net_hdr_mrg_rxbuf *)
+			(rte_pktmbuf_mtod(head, char *) - hdr_size);
+		seg_num = hdr->num_buffers;
+
+		if (likely(seg_num == 1)) {
+			rx_pkts[nb_rx++] = head;
+			bytes += head->pkt_len;
+			i++;
+			continue;
+		}
+
+		if (unlikely(seg_num == 0 ||
+			     seg_num > RTE_VIRTIO_VPMD_RX_BURST)) {
+			PMD_RX_LOG(ERR, "Bad num_buffers %u", seg_num);
+			rxvq->errors++;
+			/* the following buffers have no header to parse */
+			if (seg_num == 0)
+				seg_num = 1;
+			n = RTE_MIN(seg_num, (uint16_t)(nb_bufs - i));
+			for (j = 0; j < n; j++)
+				rte_pktmbuf_free(bufs[i + j]);
+			rxvq->vq_rx_discard = seg_num - n;
+			i += n;
+			continue;
+		}
+
+		if (i + seg_num > nb_bufs)
+			break;
+
+		prev = head;
+		for (j = 1; j < seg_num; j++) {
+			seg = bufs[i + j];
+			/* no header in the following buffers */
+			seg->data_off = RTE_PKTMBUF_HEADROOM - hdr_size;
+			seg->data_len = (uint16_t)(seg->data_len + hdr_size);
+			head->pkt_len += seg->data_len;
+			prev->next = seg;
+			prev = seg;
+		}
+		head->nb_segs = seg_num;
+
+		rx_pkts[nb_rx++] = head;
+		bytes += head->pkt_len;
+		i += seg_num;
+	}
+
+	rxvq->vq_used_cons_idx += i;
+	rxvq->vq_free_cnt += i;
+	rxvq->packets += nb_rx;
+	rxvq->bytes += bytes;
+	rxvq->path_packets[VIRTIO_PATH_VEC] += nb_rx;
+	return nb_rx;
+}
+
 #define VIRTIO_TX_FREE_THRESH 32
 #define VIRTIO_TX_MAX_FREE_BUF_SZ 32
 #define VIRTIO_TX_FREE_NR 32
@@ -366,7 +509,7 @@ virtio_xmit_pkts_simple(void *tx_queue, struct rte_mbuf **tx_pkts,
 			txvq->vq_descx[desc_idx + i].cookie = tx_pkts[i];
 		for (i = 0; i < nb_tail; i++) {
 			start_dp[desc_idx].addr =
-				RTE_MBUF_DATA_DMA_ADDR(*tx_pkts);
+				VIRTIO_MBUF_DATA_DMA_ADDR(*tx_pkts, txvq);
 			start_dp[desc_idx].len = (*tx_pkts)->pkt_len;
 			tx_pkts++;
 			desc_idx++;
@@ -377,7 +520,8 @@ virtio_xmit_pkts_simple(void *tx_queue, struct rte_mbuf **tx_pkts,
 	for (i = 0; i < nb_commit; i++)
 		txvq->vq_descx[desc_idx + i].cookie = tx_pkts[i];
 	for (i = 0; i < nb_commit; i++) {
-		start_dp[desc_idx].addr = RTE_MBUF_DATA_DMA_ADDR(*tx_pkts);
+		start_dp[desc_idx].addr =
+			VIRTIO_MBUF_DATA_DMA_ADDR(*tx_pkts, txvq);
 		start_dp[desc_idx].len = (*tx_pkts)->pkt_len;
 		tx_pkts++;
 		desc_idx++;
@@ -389,6 +533,7 @@ virtio_xmit_pkts_simple(void *tx_queue, struct rte_mbuf **tx_pkts,
 	txvq->vq_avail_idx += nb_pkts;
 	txvq->vq_ring.avail->idx = txvq->vq_avail_idx;
 	txvq->packets += nb_pkts;
+	txvq->path_packets[VIRTIO_PATH_VEC] += nb_pkts;
 
 	if (likely(nb_pkts)) {
 		if (unlikely(virtqueue_kick_prepare(txvq)))
@@ -0,0 +1,461 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/vfs.h>
+#include <sys/un.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+
+#include <rte_common.h>
+#include <rte_log.h>
+
+#include "vhost.h"
+#include "../virtio_logs.h"
+
+#ifndef HUGETLBFS_MAGIC
+#define HUGETLBFS_MAGIC 0x958458f6
+#endif
+
+static int
+vhost_user_write(int fd, void *buf, int len, int *fds, int fd_num)
+{
+	int r;
+	struct msghdr msgh;
+	struct iovec iov;
+	size_t fd_size = fd_num * sizeof(int);
+	char control[CMSG_SPACE(VHOST_MEMORY_MAX_NREGIONS * sizeof(int))];
+	struct cmsghdr *cmsg;
+
+	memset(&msgh, 0, sizeof(msgh));
+	memset(control, 0, sizeof(control));
+
+	iov.iov_base = (uint8_t *)buf;
+	iov.iov_len = len;
+
+	msgh.msg_iov = &iov;
+	msgh.msg_iovlen = 1;
+
+	if (fd_num > 0) {
+		msgh.msg_control = control;
+		msgh.msg_controllen = CMSG_SPACE(fd_size);
+
+		cmsg = CMSG_FIRSTHDR(&msgh);
+		cmsg->cmsg_len = CMSG_LEN(fd_size);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		memcpy(CMSG_DATA(cmsg), fds, fd_size);
+	}
+
+	do {
+		r = sendmsg(fd, &msgh, 0);
+	} while (r < 0 && errno == EINTR);
+
+	return r;
+}
+
+static int
+vhost_user_read(int fd, struct vhost_user_msg *msg)
+{
+	uint32_t valid_flags = VHOST_USER_REPLY_MASK | VHOST_USER_VERSION;
+	int ret, sz_hdr = VHOST_USER_HDR_SIZE, sz_payload;
+
+	ret = recv(fd, (void *)msg, sz_hdr, 0);
+	if (ret < sz_hdr) {
+		RTE_LOG(ERR, PMD, "virtio-user: failed to recv msg hdr: %d "
+			"instead of %d\n", ret, sz_hdr);
+		return -1;
+	}
+
+	/* validate msg flags */
+	if (msg->flags != valid_flags) {
+		RTE_LOG(ERR, PMD, "virtio-user: failed to recv msg: "
+			"flags %x instead of %x\n", msg->flags, valid_flags);
+		return -1;
+	}
+
+	sz_payload = msg->size;
+	if (sz_payload > (int)VHOST_USER_PAYLOAD_SIZE) {
+		RTE_LOG(ERR, PMD, "virtio-user: invalid msg payload size %d\n",
+			sz_payload);
+		return -1;
+	}
+
+	if (sz_payload) {
+		ret = recv(fd, (void *)((char *)msg + sz_hdr), sz_payload, 0);
+		if (ret < sz_payload) {
+			RTE_LOG(ERR, PMD, "virtio-user: failed to recv msg "
+				"payload: %d instead of %d\n", ret, sz_payload);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+struct hugepage_file_info {
+	uint64_t addr;            /**< virtual addr */
+	size_t   size;            /**< the file size */
+	uint64_t offset;          /**< offset of the mapping in the file */
+	char     path[PATH_MAX];  /**< path to backing file */
+};
+
+/*
+ * Find the hugetlbfs files mapped by this process, and the address range
+ * each one of them is mapped at. Adjacent mappings of the same file are
+ * merged, so that a whole segment mapped from a single file (see
+ * CONFIG_RTE_EAL_SINGLE_FILE_SEGMENTS) fits in one region.
+ */
+static int
+get_hugepage_file_info(struct hugepage_file_info huges[], int max)
+{
+	int idx = 0;
+	FILE *f;
+	char buf[BUFSIZ], *tmp, *tail, *name;
+	uint64_t v_start, v_end, offset;
+	struct statfs fs;
+	struct hugepage_file_info *last;
+
+	f = fopen("/proc/self/maps", "r");
+	if (!f) {
+		RTE_LOG(ERR, PMD, "virtio-user: cannot open /proc/self/maps\n");
+		return -1;
+	}
+
+	while (fgets(buf, sizeof(buf), f) != NULL) {
+		/* start-end perms offset dev inode path */
+		if (sscanf(buf, "%" PRIx64 "-%" PRIx64 " %*s %" PRIx64,
+				&v_start, &v_end, &offset) < 3) {
+			RTE_LOG(ERR, PMD, "virtio-user: cannot parse "
+				"/proc/self/maps\n");
+			goto error;
+		}
+
+		tmp = strchr(buf, '/');
+		if (tmp == NULL)
+			continue; /* anonymous mapping */
+
+		tail = strrchr(tmp, '\n');
+		if (tail)
+			*tail = '\0';
+
+		/* Deleted files, such as with --huge-unlink, cannot be sent */
+		if (strstr(tmp, " (deleted)") != NULL)
+			continue;
+
+		if (statfs(tmp, &fs) < 0 || fs.f_type != HUGETLBFS_MAGIC)
+			continue;
+
+		/* Only keep the hugepage files of the EAL: <prefix>map_<id> */
+		name = strrchr(tmp, '/');
+		if (strstr(name, "map_") == NULL)
+			continue;
+
+		if (idx > 0) {
+			last = &huges[idx - 1];
+			if (strcmp(last->path, tmp) == 0 &&
+					last->addr + last->size == v_start &&
+					last->offset + last->size == offset) {
+				last->size += v_end - v_start;
+				continue;
+			}
+		}
+
+		if (idx >= max) {
+			RTE_LOG(ERR, PMD, "virtio-user: too many hugepage "
+				"files, at most %d can be shared: use larger "
+				"hugepages or single file segments\n", max);
+			goto error;
+		}
+
+		huges[idx].addr = v_start;
+		huges[idx].size = v_end - v_start;
+		huges[idx].offset = offset;
+		snprintf(huges[idx].path, PATH_MAX, "%s", tmp);
+		idx++;
+	}
+
+	fclose(f);
+	return idx;
+
+error:
+	fclose(f);
+	return -1;
+}
+
+static int
+prepare_vhost_memory_user(struct vhost_user_msg *msg, int fds[])
+{
+	int i, j, num;
+	struct hugepage_file_info huges[VHOST_MEMORY_MAX_NREGIONS];
+	struct vhost_memory_region mr;
+
+	num = get_hugepage_file_info(huges, VHOST_MEMORY_MAX_NREGIONS);
+	if (num < 0)
+		return -1;
+	if (num == 0) {
+		RTE_LOG(ERR, PMD, "virtio-user: no hugepage file found, "
+			"hugepages are required to share memory\n");
+		return -1;
+	}
+
+	for (i = 0; i < num; ++i) {
+		/* The backend sees our virtual addresses as guest physical */
+		mr.guest_phys_addr = huges[i].addr;
+		mr.userspace_addr = huges[i].addr;
+		mr.memory_size = huges[i].size;
+		mr.mmap_offset = huges[i].offset;
+		/* the message is packed: no pointer to its regions */
+		memcpy(&msg->payload.memory.regions[i], &mr, sizeof(mr));
+		fds[i] = open(huges[i].path, O_RDWR);
+		if (fds[i] < 0) {
+			RTE_LOG(ERR, PMD, "virtio-user: cannot open %s: %s\n",
+				huges[i].path, strerror(errno));
+			for (j = 0; j < i; j++)
+				close(fds[j]);
+			return -1;
+		}
+	}
+
+	msg->payload.memory.nregions = num;
+	msg->payload.memory.padding = 0;
+
+	return num;
+}
+
+static const char * const vhost_msg_strings[] = {
+	[VHOST_USER_GET_FEATURES] = "VHOST_USER_GET_FEATURES",
+	[VHOST_USER_SET_FEATURES] = "VHOST_USER_SET_FEATURES",
+	[VHOST_USER_SET_OWNER] = "VHOST_USER_SET_OWNER",
+	[VHOST_USER_RESET_OWNER] = "VHOST_USER_RESET_OWNER",
+	[VHOST_USER_SET_MEM_TABLE] = "VHOST_USER_SET_MEM_TABLE",
+	[VHOST_USER_SET_VRING_NUM] = "VHOST_USER_SET_VRING_NUM",
+	[VHOST_USER_SET_VRING_ADDR] = "VHOST_USER_SET_VRING_ADDR",
+	[VHOST_USER_SET_VRING_BASE] = "VHOST_USER_SET_VRING_BASE",
+	[VHOST_USER_GET_VRING_BASE] = "VHOST_USER_GET_VRING_BASE",
+	[VHOST_USER_SET_VRING_KICK] = "VHOST_USER_SET_VRING_KICK",
+	[VHOST_USER_SET_VRING_CALL] = "VHOST_USER_SET_VRING_CALL",
+	[VHOST_USER_SET_VRING_ENABLE] = "VHOST_USER_SET_VRING_ENABLE",
+};
+
+static const char *
+vhost_msg_string(enum vhost_user_request req)
+{
+	if ((unsigned int)req < RTE_DIM(vhost_msg_strings) &&
+			vhost_msg_strings[req] != NULL)
+		return vhost_msg_strings[req];
+	return "unknown";
+}
+
+/*
+ * Send a vhost-user request, and wait for its reply when there is one.
+ * arg points to the payload of the request: a uint64_t for the features,
+ * a struct vhost_vring_state, struct vhost_vring_addr or
+ * struct vhost_vring_file for the vring requests, nothing for
+ * SET_OWNER/RESET_OWNER and SET_MEM_TABLE, which shares all the hugepages.
+ */
+int
+vhost_user_sock(int vhostfd, enum vhost_user_request req, void *arg)
+{
+	struct vhost_user_msg msg;
+	struct vhost_vring_file *file = NULL;
+	int need_reply = 0;
+	int fds[VHOST_MEMORY_MAX_NREGIONS];
+	int fd_num = 0;
+	int i, len;
+
+	PMD_DRV_LOG(DEBUG, "sent message %s = %d\n",
+		vhost_msg_string(req), req);
+
+	memset(&msg, 0, sizeof(msg));
+	msg.request = req;
+	msg.flags = VHOST_USER_VERSION;
+	msg.size = 0;
+
+	switch (req) {
+	case VHOST_USER_GET_FEATURES:
+		need_reply = 1;
+		break;
+
+	case VHOST_USER_SET_FEATURES:
+	case VHOST_USER_SET_LOG_BASE:
+		msg.payload.u64 = *((uint64_t *)arg);
+		msg.size = sizeof(msg.payload.u64);
+		break;
+
+	case VHOST_USER_SET_OWNER:
+	case VHOST_USER_RESET_OWNER:
+		break;
+
+	case VHOST_USER_SET_MEM_TABLE:
+		fd_num = prepare_vhost_memory_user(&msg, fds);
+		if (fd_num < 0)
+			return -1;
+		msg.size = sizeof(msg.payload.memory.nregions);
+		msg.size += sizeof(msg.payload.memory.padding);
+		msg.size += fd_num * sizeof(struct vhost_memory_region);
+		break;
+
+	case VHOST_USER_SET_LOG_FD:
+		fds[fd_num++] = *((int *)arg);
+		break;
+
+	case VHOST_USER_SET_VRING_NUM:
+	case VHOST_USER_SET_VRING_BASE:
+	case VHOST_USER_SET_VRING_ENABLE:
+		memcpy(&msg.payload.state, arg, sizeof(msg.payload.state));
+		msg.size = sizeof(msg.payload.state);
+		break;
+
+	case VHOST_USER_GET_VRING_BASE:
+		memcpy(&msg.payload.state, arg, sizeof(msg.payload.state));
+		msg.size = sizeof(msg.payload.state);
+		need_reply = 1;
+		break;
+
+	case VHOST_USER_SET_VRING_ADDR:
+		memcpy(&msg.payload.addr, arg, sizeof(msg.payload.addr));
+		msg.size = sizeof(msg.payload.addr);
+		break;
+
+	case VHOST_USER_SET_VRING_KICK:
+	case VHOST_USER_SET_VRING_CALL:
+	case VHOST_USER_SET_VRING_ERR:
+		file = arg;
+		msg.payload.u64 = file->index & VHOST_USER_VRING_IDX_MASK;
+		msg.size = sizeof(msg.payload.u64);
+		if (file->fd >= 0)
+			fds[fd_num++] = file->fd;
+		else
+			msg.payload.u64 |= VHOST_USER_VRING_NOFD_MASK;
+		break;
+
+	default:
+		RTE_LOG(ERR, PMD, "virtio-user: unsupported request %d\n",
+			req);
+		return -1;
+	}
+
+	len = VHOST_USER_HDR_SIZE + msg.size;
+	if (vhost_user_write(vhostfd, &msg, len, fds, fd_num) < 0) {
+		RTE_LOG(ERR, PMD, "virtio-user: %s failed: %s\n",
+			vhost_msg_string(req), strerror(errno));
+		if (req == VHOST_USER_SET_MEM_TABLE)
+			for (i = 0; i < fd_num; ++i)
+				close(fds[i]);
+		return -1;
+	}
+
+	/* The backend keeps its own copy of the hugepage fds */
+	if (req == VHOST_USER_SET_MEM_TABLE)
+		for (i = 0; i < fd_num; ++i)
+			close(fds[i]);
+
+	if (need_reply) {
+		if (vhost_user_read(vhostfd, &msg) < 0)
+			return -1;
+
+		if (req != msg.request) {
+			RTE_LOG(ERR, PMD, "virtio-user: received unexpected "
+				"msg type %d\n", msg.request);
+			return -1;
+		}
+
+		switch (req) {
+		case VHOST_USER_GET_FEATURES:
+			if (msg.size != sizeof(msg.payload.u64)) {
+				RTE_LOG(ERR, PMD,
+					"virtio-user: received bad msg size\n");
+				return -1;
+			}
+			*((uint64_t *)arg) = msg.payload.u64;
+			break;
+		case VHOST_USER_GET_VRING_BASE:
+			if (msg.size != sizeof(msg.payload.state)) {
+				RTE_LOG(ERR, PMD,
+					"virtio-user: received bad msg size\n");
+				return -1;
+			}
+			memcpy(arg, &msg.payload.state,
+			       sizeof(struct vhost_vring_state));
+			break;
+		default:
+			break;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Connect to the vhost-user socket at path, where a vhost-user slave
+ * (such as a vswitch using librte_vhost) listens.
+ * Returns the socket fd, or -1 on error.
+ */
+int
+vhost_user_setup(const char *path)
+{
+	int fd;
+	int flag;
+	struct sockaddr_un un;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		RTE_LOG(ERR, PMD, "virtio-user: socket() error, %s\n",
+			strerror(errno));
+		return -1;
+	}
+
+	flag = fcntl(fd, F_GETFD);
+	if (flag < 0 || fcntl(fd, F_SETFD, flag | FD_CLOEXEC) < 0)
+		RTE_LOG(WARNING, PMD, "virtio-user: fcntl failed, %s\n",
+			strerror(errno));
+
+	memset(&un, 0, sizeof(un));
+	un.sun_family = AF_UNIX;
+	snprintf(un.sun_path, sizeof(un.sun_path), "%s", path);
+	if (connect(fd, (struct sockaddr *)&un, sizeof(un)) < 0) {
+		RTE_LOG(ERR, PMD, "virtio-user: connect to %s failed, %s\n",
+			path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
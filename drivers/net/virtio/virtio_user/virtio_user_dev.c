@@ -0,0 +1,484 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <rte_atomic.h>
+#include <rte_ether.h>
+#include <rte_log.h>
+
+#include "vhost.h"
+#include "virtio_user_dev.h"
+#include "../virtqueue.h"
+
+/* Features emulated by virtio-user itself, never sent to the backend */
+#define VIRTIO_USER_EMULATED_FEATURES		\
+	(1ULL << VIRTIO_NET_F_MAC		|	\
+	 1ULL << VIRTIO_NET_F_STATUS		|	\
+	 1ULL << VIRTIO_NET_F_CTRL_VQ		|	\
+	 1ULL << VIRTIO_NET_F_CTRL_RX		|	\
+	 1ULL << VIRTIO_NET_F_CTRL_MAC_ADDR)
+
+/* Backend features which cannot be offered to the driver */
+#define VIRTIO_USER_UNSUPPORTED_FEATURES	\
+	(1ULL << VIRTIO_NET_F_CTRL_VLAN		|	\
+	 1ULL << VIRTIO_NET_F_CTRL_RX_EXTRA	|	\
+	 1ULL << VIRTIO_NET_F_GUEST_ANNOUNCE	|	\
+	 1ULL << VHOST_USER_F_PROTOCOL_FEATURES)
+
+static void
+virtio_user_close_vring_fds(struct virtio_user_dev *dev, uint32_t i)
+{
+	if (dev->callfds[i] >= 0) {
+		close(dev->callfds[i]);
+		dev->callfds[i] = -1;
+	}
+	if (dev->kickfds[i] >= 0) {
+		close(dev->kickfds[i]);
+		dev->kickfds[i] = -1;
+	}
+}
+
+static int
+virtio_user_set_vring_call(struct virtio_user_dev *dev, uint32_t queue_sel)
+{
+	struct vhost_vring_file file;
+	int callfd;
+
+	/*
+	 * The backend may write to the call eventfd, but the driver polls
+	 * the rings and never reads it: the counter only ever grows.
+	 */
+	callfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (callfd < 0) {
+		RTE_LOG(ERR, PMD, "virtio-user: callfd error, %s\n",
+			strerror(errno));
+		return -1;
+	}
+	dev->callfds[queue_sel] = callfd;
+
+	file.index = queue_sel;
+	file.fd = callfd;
+	return vhost_user_sock(dev->vhostfd, VHOST_USER_SET_VRING_CALL, &file);
+}
+
+static int
+virtio_user_kick_queue(struct virtio_user_dev *dev, uint32_t queue_sel)
+{
+	struct vring *vring = &dev->vrings[queue_sel];
+	struct vring_packed *packed_vring = &dev->packed_vrings[queue_sel];
+	int packed = !!(dev->features & (1ULL << VIRTIO_F_RING_PACKED));
+	struct vhost_vring_state state;
+	struct vhost_vring_file file;
+	struct vhost_vring_addr addr = {
+		.index = queue_sel,
+		.log_guest_addr = 0,
+		.flags = 0, /* disable log */
+	};
+	int kickfd;
+
+	/*
+	 * The driver and device areas of a packed vring are given in place
+	 * of the avail and used rings.
+	 */
+	if (packed) {
+		addr.desc_user_addr = (uint64_t)(uintptr_t)packed_vring->desc;
+		addr.avail_user_addr =
+			(uint64_t)(uintptr_t)packed_vring->driver;
+		addr.used_user_addr =
+			(uint64_t)(uintptr_t)packed_vring->device;
+	} else {
+		addr.desc_user_addr = (uint64_t)(uintptr_t)vring->desc;
+		addr.avail_user_addr = (uint64_t)(uintptr_t)vring->avail;
+		addr.used_user_addr = (uint64_t)(uintptr_t)vring->used;
+	}
+
+	state.index = queue_sel;
+	state.num = vring->num;
+	if (vhost_user_sock(dev->vhostfd, VHOST_USER_SET_VRING_NUM,
+			&state) < 0)
+		return -1;
+
+	/* no reservation; the wrap counter of a packed vring starts at 1 */
+	state.num = packed ? (1 << 15) : 0;
+	if (vhost_user_sock(dev->vhostfd, VHOST_USER_SET_VRING_BASE,
+			&state) < 0)
+		return -1;
+
+	if (vhost_user_sock(dev->vhostfd, VHOST_USER_SET_VRING_ADDR,
+			&addr) < 0)
+		return -1;
+
+	/*
+	 * Kick is the last per-vring message: the backend starts using the
+	 * device once all its vrings got one.
+	 */
+	kickfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (kickfd < 0) {
+		RTE_LOG(ERR, PMD, "virtio-user: kickfd error, %s\n",
+			strerror(errno));
+		return -1;
+	}
+	dev->kickfds[queue_sel] = kickfd;
+
+	file.index = queue_sel;
+	file.fd = kickfd;
+	return vhost_user_sock(dev->vhostfd, VHOST_USER_SET_VRING_KICK, &file);
+}
+
+/*
+ * Hand the device over to the backend, when the driver sets DRIVER_OK:
+ * all the RX/TX vrings it has set up, and the hugepages they point to.
+ * The control vring is not given to the backend, virtio-user handles it.
+ */
+int
+virtio_user_start_device(struct virtio_user_dev *dev)
+{
+	uint64_t features;
+	uint32_t i, nr_vq = dev->max_queue_pairs * 2;
+
+	if (dev->started)
+		return 0;
+
+	/*
+	 * SET_VRING_CALL is the first per-vring message, the backend
+	 * allocates the queue pairs on it: send it before the features,
+	 * which are applied to the existing queue pairs only.
+	 */
+	for (i = 0; i < nr_vq; i++) {
+		if (dev->vrings[i].num == 0)
+			continue;
+		if (virtio_user_set_vring_call(dev, i) < 0)
+			goto error;
+	}
+
+	features = dev->features & dev->backend_features &
+		~VIRTIO_USER_EMULATED_FEATURES;
+	if (vhost_user_sock(dev->vhostfd, VHOST_USER_SET_FEATURES,
+			&features) < 0)
+		goto error;
+	PMD_DRV_LOG(INFO, "virtio-user: set features 0x%" PRIx64 "\n",
+		    features);
+
+	if (vhost_user_sock(dev->vhostfd, VHOST_USER_SET_MEM_TABLE,
+			NULL) < 0)
+		goto error;
+
+	for (i = 0; i < nr_vq; i++) {
+		if (dev->vrings[i].num == 0)
+			continue;
+		if (virtio_user_kick_queue(dev, i) < 0)
+			goto error;
+	}
+
+	dev->started = 1;
+	return 0;
+
+error:
+	RTE_LOG(ERR, PMD, "virtio-user: cannot start device on %s\n",
+		dev->path);
+	for (i = 0; i < nr_vq; i++)
+		virtio_user_close_vring_fds(dev, i);
+	return -1;
+}
+
+/*
+ * Take the device back from the backend, on driver reset.
+ */
+int
+virtio_user_stop_device(struct virtio_user_dev *dev)
+{
+	struct vhost_vring_state state;
+	uint32_t i, nr_vq = dev->max_queue_pairs * 2;
+
+	for (i = 0; i < nr_vq; i++) {
+		if (dev->started && dev->vrings[i].num != 0) {
+			state.index = i;
+			vhost_user_sock(dev->vhostfd,
+					VHOST_USER_GET_VRING_BASE, &state);
+		}
+		virtio_user_close_vring_fds(dev, i);
+	}
+
+	memset(dev->vrings, 0, sizeof(dev->vrings));
+	dev->cq_used_idx = 0;
+	dev->cq_used_wrap_counter = 1;
+	dev->queue_pairs = 1;
+	dev->started = 0;
+	return 0;
+}
+
+int
+virtio_user_dev_init(struct virtio_user_dev *dev, const char *path,
+		     uint32_t queues, uint32_t queue_size,
+		     const struct ether_addr *mac, int packed_vq,
+		     int in_order)
+{
+	uint32_t i;
+
+	snprintf(dev->path, PATH_MAX, "%s", path);
+	dev->max_queue_pairs = queues;
+	dev->queue_pairs = 1; /* mq disabled by default */
+	dev->queue_size = queue_size;
+	dev->status = 0;
+	dev->started = 0;
+	dev->cq_used_wrap_counter = 1;
+	for (i = 0; i < VIRTIO_USER_MAX_VIRTQUEUES; i++) {
+		dev->callfds[i] = -1;
+		dev->kickfds[i] = -1;
+	}
+
+	if (mac != NULL)
+		memcpy(dev->mac_addr, mac, ETHER_ADDR_LEN);
+	else
+		eth_random_addr(dev->mac_addr);
+
+	dev->vhostfd = vhost_user_setup(dev->path);
+	if (dev->vhostfd < 0)
+		return -1;
+
+	if (vhost_user_sock(dev->vhostfd, VHOST_USER_SET_OWNER, NULL) < 0)
+		goto error;
+
+	if (vhost_user_sock(dev->vhostfd, VHOST_USER_GET_FEATURES,
+			&dev->backend_features) < 0)
+		goto error;
+
+	dev->device_features = (dev->backend_features |
+		VIRTIO_USER_EMULATED_FEATURES) &
+		~VIRTIO_USER_UNSUPPORTED_FEATURES;
+
+	/*
+	 * Virtio 1.0 and the packed ring are only offered on request, the
+	 * split vrings keeping the legacy header, as on a PCI device.
+	 */
+	if (!packed_vq)
+		dev->device_features &= ~(1ULL << VIRTIO_F_VERSION_1 |
+					  1ULL << VIRTIO_F_RING_PACKED);
+	if (!in_order)
+		dev->device_features &= ~(1ULL << VIRTIO_F_IN_ORDER);
+
+	if (dev->max_queue_pairs > 1) {
+		if (!(dev->backend_features & (1ULL << VIRTIO_NET_F_MQ))) {
+			RTE_LOG(ERR, PMD, "virtio-user: the backend of %s "
+				"does not support multiple queues\n", path);
+			goto error;
+		}
+	} else {
+		dev->device_features &= ~(1ULL << VIRTIO_NET_F_MQ);
+	}
+
+	return 0;
+
+error:
+	close(dev->vhostfd);
+	dev->vhostfd = -1;
+	return -1;
+}
+
+void
+virtio_user_dev_uninit(struct virtio_user_dev *dev)
+{
+	virtio_user_stop_device(dev);
+
+	if (dev->vhostfd >= 0) {
+		close(dev->vhostfd);
+		dev->vhostfd = -1;
+	}
+}
+
+static uint8_t
+virtio_user_handle_mq(struct virtio_user_dev *dev, uint16_t q_pairs)
+{
+	struct vhost_vring_state state;
+	uint32_t i;
+	int ret = 0;
+
+	if (q_pairs < 1 || q_pairs > dev->max_queue_pairs) {
+		RTE_LOG(ERR, PMD, "virtio-user: %u queue pairs requested, "
+			"%u supported\n", q_pairs, dev->max_queue_pairs);
+		return VIRTIO_NET_ERR;
+	}
+
+	/* The backend only knows about the vrings it was given */
+	for (i = 0; i < dev->max_queue_pairs * 2; i++) {
+		if (dev->vrings[i].num == 0)
+			continue;
+		state.index = i;
+		state.num = (i / 2) < q_pairs;
+		ret |= vhost_user_sock(dev->vhostfd,
+				       VHOST_USER_SET_VRING_ENABLE, &state);
+	}
+
+	if (ret < 0)
+		return VIRTIO_NET_ERR;
+
+	dev->queue_pairs = q_pairs;
+	return VIRTIO_NET_OK;
+}
+
+static virtio_net_ctrl_ack
+virtio_user_handle_ctrl_msg(struct virtio_user_dev *dev,
+			    struct virtio_net_ctrl_hdr *hdr, void *data)
+{
+	if (hdr->class == VIRTIO_NET_CTRL_MQ &&
+	    hdr->cmd == VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET)
+		return virtio_user_handle_mq(dev, *(uint16_t *)data);
+
+	if (hdr->class == VIRTIO_NET_CTRL_MAC &&
+	    hdr->cmd == VIRTIO_NET_CTRL_MAC_ADDR_SET) {
+		memcpy(dev->mac_addr, data, ETHER_ADDR_LEN);
+		return VIRTIO_NET_OK;
+	}
+
+	/* The backend does not filter, it delivers every packet */
+	if (hdr->class == VIRTIO_NET_CTRL_RX ||
+	    hdr->class == VIRTIO_NET_CTRL_MAC)
+		return VIRTIO_NET_OK;
+
+	return VIRTIO_NET_ERR;
+}
+
+static void
+virtio_user_handle_ctrl_msg_split(struct virtio_user_dev *dev,
+				  struct vring *vring, uint16_t idx_hdr)
+{
+	struct virtio_net_ctrl_hdr *hdr;
+	uint16_t i, idx_data, idx_status;
+
+	/* A control message is at least three descriptors: header, data
+	 * and status, the status being the only device writable one.
+	 */
+	hdr = (void *)(uintptr_t)vring->desc[idx_hdr].addr;
+	idx_data = vring->desc[idx_hdr].next;
+
+	i = idx_data;
+	while (vring->desc[i].flags & VRING_DESC_F_NEXT)
+		i = vring->desc[i].next;
+	idx_status = i;
+
+	/* Update status */
+	*(virtio_net_ctrl_ack *)(uintptr_t)vring->desc[idx_status].addr =
+		virtio_user_handle_ctrl_msg(dev, hdr,
+			(void *)(uintptr_t)vring->desc[idx_data].addr);
+}
+
+/*
+ * Same as the split vring path of virtio_user_handle_cq(), on a packed
+ * vring: the message descriptors follow each other from the used index.
+ */
+static void
+virtio_user_handle_cq_packed(struct virtio_user_dev *dev, uint16_t queue_idx)
+{
+	struct vring_packed *vring = &dev->packed_vrings[queue_idx];
+	struct vring_packed_desc *desc;
+	struct virtio_net_ctrl_hdr *hdr;
+	virtio_net_ctrl_ack *status;
+	uint16_t flags, idx_data, idx_status, n_descs;
+	int wrap = dev->cq_used_wrap_counter;
+
+	for (;;) {
+		desc = &vring->desc[dev->cq_used_idx];
+		flags = *(volatile uint16_t *)&desc->flags;
+		if (!!(flags & VRING_PACKED_DESC_F_AVAIL) != wrap ||
+		    !!(flags & VRING_PACKED_DESC_F_USED) == wrap)
+			break;
+		rte_smp_rmb();
+
+		hdr = (void *)(uintptr_t)desc->addr;
+		idx_data = (dev->cq_used_idx + 1) & (vring->num - 1);
+		n_descs = 2;
+		idx_status = idx_data;
+		while (vring->desc[idx_status].flags & VRING_DESC_F_NEXT) {
+			idx_status = (idx_status + 1) & (vring->num - 1);
+			n_descs++;
+		}
+
+		status = (void *)(uintptr_t)vring->desc[idx_status].addr;
+		*status = virtio_user_handle_ctrl_msg(dev, hdr,
+			(void *)(uintptr_t)vring->desc[idx_data].addr);
+
+		/* Write the used descriptor in place of the head */
+		desc->id = vring->desc[idx_status].id;
+		desc->len = sizeof(virtio_net_ctrl_ack);
+		rte_smp_wmb();
+		desc->flags = wrap ? VRING_PACKED_DESC_F_AVAIL_USED : 0;
+
+		dev->cq_used_idx += n_descs;
+		if (dev->cq_used_idx >= vring->num) {
+			dev->cq_used_idx -= vring->num;
+			wrap ^= 1;
+		}
+	}
+	dev->cq_used_wrap_counter = wrap;
+}
+
+/*
+ * Process the control messages the driver has made available, as a
+ * device would: called synchronously when the control vring is notified.
+ */
+void
+virtio_user_handle_cq(struct virtio_user_dev *dev, uint16_t queue_idx)
+{
+	struct vring *vring = &dev->vrings[queue_idx];
+	struct vring_used_elem *uep;
+	uint16_t avail_idx, desc_idx;
+
+	if (dev->features & (1ULL << VIRTIO_F_RING_PACKED)) {
+		virtio_user_handle_cq_packed(dev, queue_idx);
+		return;
+	}
+
+	while (dev->cq_used_idx != vring->avail->idx) {
+		rte_smp_rmb();
+		avail_idx = dev->cq_used_idx & (vring->num - 1);
+		desc_idx = vring->avail->ring[avail_idx];
+
+		virtio_user_handle_ctrl_msg_split(dev, vring, desc_idx);
+
+		/* Update used ring, only the status was written */
+		uep = &vring->used->ring[avail_idx];
+		uep->id = desc_idx;
+		uep->len = sizeof(virtio_net_ctrl_ack);
+
+		dev->cq_used_idx++;
+		rte_smp_wmb();
+		vring->used->idx = dev->cq_used_idx;
+	}
+}
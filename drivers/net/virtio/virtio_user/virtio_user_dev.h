@@ -0,0 +1,77 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _VIRTIO_USER_DEV_H
+#define _VIRTIO_USER_DEV_H
+
+#include <limits.h>
+#include "../virtio_pci.h"
+#include "../virtio_ring.h"
+
+#define VIRTIO_USER_MAX_QUEUE_PAIRS 8
+/* RX and TX virtqueues of each pair, and the control virtqueue */
+#define VIRTIO_USER_MAX_VIRTQUEUES (VIRTIO_USER_MAX_QUEUE_PAIRS * 2 + 1)
+
+struct virtio_user_dev {
+	int		vhostfd;       /**< vhost-user socket */
+	int		callfds[VIRTIO_USER_MAX_VIRTQUEUES];
+	int		kickfds[VIRTIO_USER_MAX_VIRTQUEUES];
+	uint32_t	max_queue_pairs;
+	uint32_t	queue_pairs;   /**< queue pairs enabled by the driver */
+	uint32_t	queue_size;
+	uint64_t	features;      /**< features negotiated with the driver */
+	uint64_t	device_features; /**< features offered to the driver */
+	uint64_t	backend_features; /**< features of the vhost backend */
+	uint8_t		status;
+	uint8_t		started;
+	uint8_t		mac_addr[ETHER_ADDR_LEN];
+	char		path[PATH_MAX];
+	/* Both layouts start with num, zero for the vrings not set up */
+	union {
+		struct vring		vrings[VIRTIO_USER_MAX_VIRTQUEUES];
+		struct vring_packed	packed_vrings[VIRTIO_USER_MAX_VIRTQUEUES];
+	};
+	uint16_t	cq_used_idx;  /**< next used entry of the control vq */
+	uint8_t		cq_used_wrap_counter; /**< packed control vq */
+};
+
+int virtio_user_dev_init(struct virtio_user_dev *dev, const char *path,
+			 uint32_t queues, uint32_t queue_size,
+			 const struct ether_addr *mac, int packed_vq,
+			 int in_order);
+void virtio_user_dev_uninit(struct virtio_user_dev *dev);
+int virtio_user_start_device(struct virtio_user_dev *dev);
+int virtio_user_stop_device(struct virtio_user_dev *dev);
+void virtio_user_handle_cq(struct virtio_user_dev *dev, uint16_t queue_idx);
+
+#endif
@@ -0,0 +1,538 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <rte_malloc.h>
+#include <rte_kvargs.h>
+#include <rte_ethdev.h>
+#include <rte_dev.h>
+
+#include "virtio_ethdev.h"
+#include "virtio_logs.h"
+#include "virtio_pci.h"
+#include "virtqueue.h"
+#include "virtio_user/virtio_user_dev.h"
+
+#define virtio_user_get_dev(hw) \
+	((struct virtio_user_dev *)(hw)->virtio_user_dev)
+
+static void
+virtio_user_read_dev_config(struct virtio_hw *hw, uint64_t offset,
+			    void *dst, int length)
+{
+	struct virtio_user_dev *dev = virtio_user_get_dev(hw);
+
+	if (offset == offsetof(struct virtio_net_config, mac) &&
+	    length == ETHER_ADDR_LEN) {
+		memcpy(dst, dev->mac_addr, ETHER_ADDR_LEN);
+		return;
+	}
+
+	/* The link is up as long as the backend is connected */
+	if (offset == offsetof(struct virtio_net_config, status))
+		*(uint16_t *)dst = (dev->vhostfd >= 0 &&
+			!(dev->status & VIRTIO_CONFIG_STATUS_FAILED)) ?
+			VIRTIO_NET_S_LINK_UP : 0;
+
+	if (offset == offsetof(struct virtio_net_config, max_virtqueue_pairs))
+		*(uint16_t *)dst = dev->max_queue_pairs;
+}
+
+static void
+virtio_user_write_dev_config(struct virtio_hw *hw, uint64_t offset,
+			     void *src, int length)
+{
+	struct virtio_user_dev *dev = virtio_user_get_dev(hw);
+
+	if (offset == offsetof(struct virtio_net_config, mac) &&
+	    length == ETHER_ADDR_LEN)
+		memcpy(dev->mac_addr, src, ETHER_ADDR_LEN);
+	else
+		PMD_DRV_LOG(ERR, "not supported offset=%" PRIu64 ", len=%d\n",
+			    offset, length);
+}
+
+static void
+virtio_user_reset(struct virtio_hw *hw)
+{
+	struct virtio_user_dev *dev = virtio_user_get_dev(hw);
+
+	virtio_user_stop_device(dev);
+	dev->status = VIRTIO_CONFIG_STATUS_RESET;
+}
+
+static void
+virtio_user_set_status(struct virtio_hw *hw, uint8_t status)
+{
+	struct virtio_user_dev *dev = virtio_user_get_dev(hw);
+
+	if ((status & VIRTIO_CONFIG_STATUS_DRIVER_OK) &&
+	    !(dev->status & VIRTIO_CONFIG_STATUS_DRIVER_OK)) {
+		if (virtio_user_start_device(dev) < 0)
+			status |= VIRTIO_CONFIG_STATUS_FAILED;
+	} else if (status == VIRTIO_CONFIG_STATUS_RESET) {
+		virtio_user_stop_device(dev);
+	}
+	dev->status = status;
+}
+
+static uint8_t
+virtio_user_get_status(struct virtio_hw *hw)
+{
+	struct virtio_user_dev *dev = virtio_user_get_dev(hw);
+
+	return dev->status;
+}
+
+static uint64_t
+virtio_user_get_features(struct virtio_hw *hw)
+{
+	struct virtio_user_dev *dev = virtio_user_get_dev(hw);
+
+	return dev->device_features;
+}
+
+static void
+virtio_user_set_features(struct virtio_hw *hw, uint64_t features)
+{
+	struct virtio_user_dev *dev = virtio_user_get_dev(hw);
+
+	dev->features = features & dev->device_features;
+}
+
+static uint8_t
+virtio_user_get_isr(struct virtio_hw *hw __rte_unused)
+{
+	/* There are no interrupts, the link status never changes */
+	return 0;
+}
+
+static uint16_t
+virtio_user_set_config_irq(struct virtio_hw *hw __rte_unused,
+			   uint16_t vec __rte_unused)
+{
+	return VIRTIO_MSI_NO_VECTOR;
+}
+
+static uint16_t
+virtio_user_get_queue_num(struct virtio_hw *hw,
+			  uint16_t queue_id __rte_unused)
+{
+	struct virtio_user_dev *dev = virtio_user_get_dev(hw);
+
+	return dev->queue_size;
+}
+
+static int
+virtio_user_setup_queue(struct virtio_hw *hw, struct virtqueue *vq)
+{
+	struct virtio_user_dev *dev = virtio_user_get_dev(hw);
+	uint16_t queue_idx = vq->vq_queue_index;
+
+	if (queue_idx >= VIRTIO_USER_MAX_VIRTQUEUES)
+		return -EINVAL;
+
+	/* The vring is given to the backend when the device is started */
+	if (vtpci_with_feature(hw, VIRTIO_F_RING_PACKED))
+		vring_packed_init(&dev->packed_vrings[queue_idx],
+				  vq->vq_nentries, vq->vq_ring_virt_mem,
+				  VIRTIO_PCI_VRING_ALIGN);
+	else
+		vring_init(&dev->vrings[queue_idx], vq->vq_nentries,
+			   vq->vq_ring_virt_mem, VIRTIO_PCI_VRING_ALIGN);
+	return 0;
+}
+
+static void
+virtio_user_del_queue(struct virtio_hw *hw, struct virtqueue *vq)
+{
+	struct virtio_user_dev *dev = virtio_user_get_dev(hw);
+	uint16_t queue_idx = vq->vq_queue_index;
+
+	/* The backend has already been stopped by the device reset */
+	if (queue_idx < VIRTIO_USER_MAX_VIRTQUEUES)
+		memset(&dev->packed_vrings[queue_idx], 0,
+		       sizeof(struct vring_packed));
+}
+
+static void
+virtio_user_notify_queue(struct virtio_hw *hw, struct virtqueue *vq)
+{
+	struct virtio_user_dev *dev = virtio_user_get_dev(hw);
+	uint64_t buf = 1;
+
+	if (hw->cvq && vq == hw->cvq) {
+		virtio_user_handle_cq(dev, vq->vq_queue_index);
+		return;
+	}
+
+	if (dev->kickfds[vq->vq_queue_index] < 0)
+		return;
+
+	if (write(dev->kickfds[vq->vq_queue_index], &buf, sizeof(buf)) < 0)
+		PMD_DRV_LOG(ERR, "failed to kick backend: %s\n",
+			    strerror(errno));
+}
+
+static const struct virtio_pci_ops virtio_user_ops = {
+	.read_dev_cfg	= virtio_user_read_dev_config,
+	.write_dev_cfg	= virtio_user_write_dev_config,
+	.reset		= virtio_user_reset,
+	.get_status	= virtio_user_get_status,
+	.set_status	= virtio_user_set_status,
+	.get_features	= virtio_user_get_features,
+	.set_features	= virtio_user_set_features,
+	.get_isr	= virtio_user_get_isr,
+	.set_config_irq	= virtio_user_set_config_irq,
+	.get_queue_num	= virtio_user_get_queue_num,
+	.setup_queue	= virtio_user_setup_queue,
+	.del_queue	= virtio_user_del_queue,
+	.notify_queue	= virtio_user_notify_queue,
+};
+
+static const char *drivername = "Virtio-user PMD";
+
+#define VIRTIO_USER_ARG_PATH		"path"
+#define VIRTIO_USER_ARG_MAC		"mac"
+#define VIRTIO_USER_ARG_QUEUES_NUM	"queues"
+#define VIRTIO_USER_ARG_QUEUE_SIZE	"queue_size"
+#define VIRTIO_USER_ARG_PACKED_VQ	"packed_vq"
+#define VIRTIO_USER_ARG_IN_ORDER	"in_order"
+
+static const char *valid_args[] = {
+	VIRTIO_USER_ARG_PATH,
+	VIRTIO_USER_ARG_MAC,
+	VIRTIO_USER_ARG_QUEUES_NUM,
+	VIRTIO_USER_ARG_QUEUE_SIZE,
+	VIRTIO_USER_ARG_PACKED_VQ,
+	VIRTIO_USER_ARG_IN_ORDER,
+	NULL
+};
+
+#define VIRTIO_USER_DEF_QUEUE_SIZE	256
+
+static int
+get_string_arg(const char *key __rte_unused,
+	       const char *value, void *extra_args)
+{
+	if (value == NULL || extra_args == NULL)
+		return -EINVAL;
+
+	*(char **)extra_args = strdup(value);
+	if (*(char **)extra_args == NULL)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static int
+get_integer_arg(const char *key __rte_unused,
+		const char *value, void *extra_args)
+{
+	char *end;
+
+	if (value == NULL || extra_args == NULL)
+		return -EINVAL;
+
+	*(uint64_t *)extra_args = strtoull(value, &end, 0);
+	if (*value == '\0' || *end != '\0')
+		return -EINVAL;
+
+	return 0;
+}
+
+static int
+get_mac_arg(const char *key __rte_unused,
+	    const char *value, void *extra_args)
+{
+	struct ether_addr *mac = extra_args;
+	unsigned int bytes[ETHER_ADDR_LEN];
+	char end;
+	int i;
+
+	if (value == NULL || extra_args == NULL)
+		return -EINVAL;
+
+	if (sscanf(value, "%x:%x:%x:%x:%x:%x%c", &bytes[0], &bytes[1],
+			&bytes[2], &bytes[3], &bytes[4], &bytes[5],
+			&end) != ETHER_ADDR_LEN)
+		return -EINVAL;
+
+	for (i = 0; i < ETHER_ADDR_LEN; i++) {
+		if (bytes[i] > UINT8_MAX)
+			return -EINVAL;
+		mac->addr_bytes[i] = (uint8_t)bytes[i];
+	}
+
+	return 0;
+}
+
+static struct rte_eth_dev *
+virtio_user_eth_dev_alloc(const char *name)
+{
+	struct rte_eth_dev *eth_dev;
+	struct rte_eth_dev_data *data;
+	struct virtio_hw *hw;
+	struct virtio_user_dev *dev;
+
+	eth_dev = rte_eth_dev_allocate(name, RTE_ETH_DEV_VIRTUAL);
+	if (!eth_dev) {
+		RTE_LOG(ERR, PMD, "cannot alloc rte_eth_dev\n");
+		return NULL;
+	}
+
+	data = eth_dev->data;
+
+	hw = rte_zmalloc(NULL, sizeof(*hw), 0);
+	if (!hw) {
+		RTE_LOG(ERR, PMD, "malloc virtio_hw failed\n");
+		rte_eth_dev_release_port(eth_dev);
+		return NULL;
+	}
+
+	dev = rte_zmalloc(NULL, sizeof(*dev), 0);
+	if (!dev) {
+		RTE_LOG(ERR, PMD, "malloc virtio_user_dev failed\n");
+		rte_eth_dev_release_port(eth_dev);
+		rte_free(hw);
+		return NULL;
+	}
+
+	hw->port_id = data->port_id;
+	hw->use_msix = 0;
+	hw->virtio_user_dev = dev;
+	VTPCI_OPS(hw) = &virtio_user_ops;
+
+	data->dev_private = hw;
+	data->numa_node = SOCKET_ID_ANY;
+	data->kdrv = RTE_KDRV_NONE;
+	data->dev_flags = RTE_ETH_DEV_DETACHABLE;
+	data->drv_name = drivername;
+
+	TAILQ_INIT(&eth_dev->link_intr_cbs);
+
+	eth_dev->pci_dev = NULL;
+	eth_dev->driver = NULL;
+	return eth_dev;
+}
+
+static void
+virtio_user_eth_dev_free(struct rte_eth_dev *eth_dev)
+{
+	struct virtio_hw *hw = eth_dev->data->dev_private;
+
+	rte_free(hw->virtio_user_dev);
+	rte_free(hw);
+	rte_eth_dev_release_port(eth_dev);
+}
+
+/*
+ * Dev initialization routine. Invoked once for each virtio-user vdev at
+ * EAL init time, see rte_eal_dev_init().
+ * Returns 0 on success.
+ */
+static int
+virtio_user_pmd_devinit(const char *name, const char *params)
+{
+	struct rte_kvargs *kvlist = NULL;
+	struct rte_eth_dev *eth_dev;
+	struct virtio_hw *hw;
+	struct ether_addr mac, *mac_arg = NULL;
+	uint64_t queues = 1;
+	uint64_t queue_size = VIRTIO_USER_DEF_QUEUE_SIZE;
+	uint64_t packed_vq = 0;
+	uint64_t in_order = 0;
+	char *path = NULL;
+	int ret = -1;
+
+	if (rte_eal_process_type() != RTE_PROC_PRIMARY) {
+		RTE_LOG(ERR, PMD, "virtio-user is only supported in the "
+			"primary process\n");
+		return -1;
+	}
+
+	if (params == NULL || params[0] == '\0') {
+		RTE_LOG(ERR, PMD, "arg %s is mandatory for virtio-user\n",
+			VIRTIO_USER_ARG_PATH);
+		return -1;
+	}
+
+	kvlist = rte_kvargs_parse(params, valid_args);
+	if (!kvlist) {
+		RTE_LOG(ERR, PMD, "error when parsing param\n");
+		return -1;
+	}
+
+	if (rte_kvargs_count(kvlist, VIRTIO_USER_ARG_PATH) == 1) {
+		if (rte_kvargs_process(kvlist, VIRTIO_USER_ARG_PATH,
+				&get_string_arg, &path) < 0) {
+			RTE_LOG(ERR, PMD, "error to parse %s\n",
+				VIRTIO_USER_ARG_PATH);
+			goto end;
+		}
+	} else {
+		RTE_LOG(ERR, PMD, "arg %s is mandatory for virtio-user\n",
+			VIRTIO_USER_ARG_PATH);
+		goto end;
+	}
+
+	if (rte_kvargs_count(kvlist, VIRTIO_USER_ARG_MAC) == 1) {
+		if (rte_kvargs_process(kvlist, VIRTIO_USER_ARG_MAC,
+				&get_mac_arg, &mac) < 0) {
+			RTE_LOG(ERR, PMD, "error to parse %s\n",
+				VIRTIO_USER_ARG_MAC);
+			goto end;
+		}
+		mac_arg = &mac;
+	}
+
+	if (rte_kvargs_count(kvlist, VIRTIO_USER_ARG_QUEUE_SIZE) == 1) {
+		if (rte_kvargs_process(kvlist, VIRTIO_USER_ARG_QUEUE_SIZE,
+				&get_integer_arg, &queue_size) < 0 ||
+				queue_size == 0 || queue_size > 32768 ||
+				!rte_is_power_of_2(queue_size)) {
+			RTE_LOG(ERR, PMD, "error to parse %s, a power of 2 "
+				"up to 32768 is expected\n",
+				VIRTIO_USER_ARG_QUEUE_SIZE);
+			goto end;
+		}
+	}
+
+	if (rte_kvargs_count(kvlist, VIRTIO_USER_ARG_QUEUES_NUM) == 1) {
+		if (rte_kvargs_process(kvlist, VIRTIO_USER_ARG_QUEUES_NUM,
+				&get_integer_arg, &queues) < 0 ||
+				queues == 0 ||
+				queues > VIRTIO_USER_MAX_QUEUE_PAIRS) {
+			RTE_LOG(ERR, PMD, "error to parse %s, 1 to %d queue "
+				"pairs are supported\n",
+				VIRTIO_USER_ARG_QUEUES_NUM,
+				VIRTIO_USER_MAX_QUEUE_PAIRS);
+			goto end;
+		}
+	}
+
+	if (rte_kvargs_count(kvlist, VIRTIO_USER_ARG_PACKED_VQ) == 1) {
+		if (rte_kvargs_process(kvlist, VIRTIO_USER_ARG_PACKED_VQ,
+				&get_integer_arg, &packed_vq) < 0 ||
+				packed_vq > 1) {
+			RTE_LOG(ERR, PMD, "error to parse %s, 0 or 1 is "
+				"expected\n", VIRTIO_USER_ARG_PACKED_VQ);
+			goto end;
+		}
+	}
+
+	if (rte_kvargs_count(kvlist, VIRTIO_USER_ARG_IN_ORDER) == 1) {
+		if (rte_kvargs_process(kvlist, VIRTIO_USER_ARG_IN_ORDER,
+				&get_integer_arg, &in_order) < 0 ||
+				in_order > 1) {
+			RTE_LOG(ERR, PMD, "error to parse %s, 0 or 1 is "
+				"expected\n", VIRTIO_USER_ARG_IN_ORDER);
+			goto end;
+		}
+	}
+
+	eth_dev = virtio_user_eth_dev_alloc(name);
+	if (!eth_dev) {
+		RTE_LOG(ERR, PMD, "virtio-user fails to alloc device\n");
+		goto end;
+	}
+
+	hw = eth_dev->data->dev_private;
+	if (virtio_user_dev_init(hw->virtio_user_dev, path, queues,
+			queue_size, mac_arg, packed_vq, in_order) < 0) {
+		virtio_user_eth_dev_free(eth_dev);
+		goto end;
+	}
+
+	/* previously called by rte_eal_pci_probe() for physical dev */
+	if (eth_virtio_dev_init(eth_dev) < 0) {
+		RTE_LOG(ERR, PMD, "eth_virtio_dev_init fails\n");
+		virtio_user_dev_uninit(hw->virtio_user_dev);
+		virtio_user_eth_dev_free(eth_dev);
+		goto end;
+	}
+
+	RTE_LOG(INFO, PMD, "virtio-user %s on %s: %u queue pair(s) of "
+		"%u descriptors, %s rings%s\n", name, path,
+		(unsigned int)queues, (unsigned int)queue_size,
+		vtpci_with_feature(hw, VIRTIO_F_RING_PACKED) ?
+		"packed" : "split",
+		vtpci_with_feature(hw, VIRTIO_F_IN_ORDER) ? ", in order" : "");
+	ret = 0;
+
+end:
+	if (kvlist)
+		rte_kvargs_free(kvlist);
+	free(path);
+	return ret;
+}
+
+static int
+virtio_user_pmd_devuninit(const char *name)
+{
+	struct rte_eth_dev *eth_dev;
+	struct virtio_hw *hw;
+
+	if (!name)
+		return -EINVAL;
+
+	RTE_LOG(INFO, PMD, "Un-Initializing %s\n", name);
+	eth_dev = rte_eth_dev_allocated(name);
+	if (!eth_dev)
+		return -ENODEV;
+
+	hw = eth_dev->data->dev_private;
+
+	/* make sure the device is stopped, queues freed */
+	eth_virtio_dev_uninit(eth_dev);
+	virtio_user_dev_uninit(hw->virtio_user_dev);
+
+	virtio_user_eth_dev_free(eth_dev);
+
+	return 0;
+}
+
+static struct rte_driver virtio_user_driver = {
+	.name   = "eth_virtio_user",
+	.type   = PMD_VDEV,
+	.init   = virtio_user_pmd_devinit,
+	.uninit = virtio_user_pmd_devuninit,
+};
+
+PMD_REGISTER_DRIVER(virtio_user_driver);
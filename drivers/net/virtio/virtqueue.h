@@ -37,6 +37,7 @@
 #include <stdint.h>
 
 #include <rte_atomic.h>
+#include <rte_branch_prediction.h>
 #include <rte_memory.h>
 #include <rte_memzone.h>
 #include <rte_mempool.h>
@@ -66,14 +67,34 @@ struct rte_mbuf;
 
 #define VIRTQUEUE_MAX_NAME_SZ 32
 
-#define RTE_MBUF_DATA_DMA_ADDR(mb) \
-	(uint64_t) ((mb)->buf_physaddr + (mb)->data_off)
+/*
+ * The PCI device is given the physical address of the mbufs, while
+ * virtio-user gives the virtual address to the vhost-user backend.
+ * vq->offset selects the mbuf field to use.
+ */
+#define VIRTIO_MBUF_ADDR(mb, vq) \
+	(*(uint64_t *)((uintptr_t)(mb) + (vq)->offset))
+
+#define VIRTIO_MBUF_DATA_DMA_ADDR(mb, vq) \
+	(uint64_t) (VIRTIO_MBUF_ADDR(mb, vq) + (mb)->data_off)
 
 #define VTNET_SQ_RQ_QUEUE_IDX 0
 #define VTNET_SQ_TQ_QUEUE_IDX 1
 #define VTNET_SQ_CQ_QUEUE_IDX 2
 
 enum { VTNET_RQ = 0, VTNET_TQ = 1, VTNET_CQ = 2 };
+
+/**
+ * RX/TX burst path families, see virtio_set_rxtx_funcs(). Each queue
+ * counts the packets it handled on each of them.
+ */
+enum virtio_path {
+	VIRTIO_PATH_SCALAR = 0, /**< free list split vring, any features */
+	VIRTIO_PATH_VEC,        /**< fixed layout split vring, SSE RX */
+	VIRTIO_PATH_INORDER,    /**< sequential split vring descriptors */
+	VIRTIO_PATH_PACKED,     /**< packed vring */
+	VIRTIO_PATH_MAX
+};
 /**
  * The maximum virtqueue size is 2^15. Use that value as the end of
  * descriptor chain terminator since it will never be a valid index
@@ -167,9 +188,11 @@ struct virtqueue {
 
 	void        *vq_ring_virt_mem;    /**< linear address of vring*/
 	unsigned int vq_ring_size;
-	phys_addr_t vq_ring_mem;          /**< physical address of vring */
+	phys_addr_t vq_ring_mem;          /**< physical address of vring,
+					   * or virtual address for virtio-user */
 
 	struct vring vq_ring;    /**< vring keeping desc, used and avail */
+	struct vring_packed vq_ring_packed; /**< used instead of vq_ring if packed */
 	uint16_t    vq_free_cnt; /**< num of desc available */
 	uint16_t    vq_nentries; /**< vring desc numbers */
 	uint16_t    vq_free_thresh; /**< free threshold */
@@ -186,8 +209,22 @@ struct virtqueue {
 	 */
 	uint16_t vq_used_cons_idx;
 	uint16_t vq_avail_idx;
+	/**
+	 * Packed vring: wrap counters of vq_avail_idx and vq_used_cons_idx,
+	 * which are then ring positions, and the AVAIL/USED flags making a
+	 * descriptor available in the current lap of vq_avail_idx.
+	 */
+	uint8_t  vq_avail_wrap_counter;
+	uint8_t  vq_used_wrap_counter;
+	uint16_t vq_packed_avail_flags;
+	uint8_t  vq_packed;   /**< VIRTIO_F_RING_PACKED negotiated */
+	uint8_t  vq_in_order; /**< VIRTIO_F_IN_ORDER negotiated */
 	uint64_t mbuf_initializer; /**< value to init mbufs. */
 	phys_addr_t virtio_net_hdr_mem; /**< hdr for each xmit packet */
+	uint16_t offset; /**< offset of the mbuf address given to the device */
+	uint32_t txq_flags; /**< ETH_TXQ_FLAGS_* given at TX queue setup */
+	/** vector mergeable RX: used buffers left of a dropped packet */
+	uint16_t vq_rx_discard;
 
 	struct rte_mbuf **sw_ring; /**< RX software ring. */
 	/* dummy mbuf, for wraparound when processing RX ring. */
@@ -201,10 +238,12 @@ struct virtqueue {
 	uint64_t	broadcast;
 	/* Size bins in array as RFC 2819, undersized [0], 64 [1], etc */
 	uint64_t	size_bins[8];
+	uint64_t	path_packets[VIRTIO_PATH_MAX];
 
 	struct vq_desc_extra {
 		void              *cookie;
 		uint16_t          ndescs;
+		uint16_t          next; /**< free buffer ids, packed vring */
 	} vq_descx[0];
 };
 
@@ -294,6 +333,52 @@ virtqueue_kick_prepare(struct virtqueue *vq)
 	return !(vq->vq_ring.used->flags & VRING_USED_F_NO_NOTIFY);
 }
 
+/* Move vq_avail_idx to the next descriptor of a packed vring. */
+static inline void
+vq_packed_avail_next(struct virtqueue *vq)
+{
+	if (unlikely(++vq->vq_avail_idx == vq->vq_nentries)) {
+		vq->vq_avail_idx = 0;
+		vq->vq_avail_wrap_counter ^= 1;
+		vq->vq_packed_avail_flags ^= VRING_PACKED_DESC_F_AVAIL_USED;
+	}
+}
+
+/* Move vq_used_cons_idx past the num descriptors of a used buffer. */
+static inline void
+vq_packed_used_advance(struct virtqueue *vq, uint16_t num)
+{
+	vq->vq_used_cons_idx += num;
+	if (vq->vq_used_cons_idx >= vq->vq_nentries) {
+		vq->vq_used_cons_idx -= vq->vq_nentries;
+		vq->vq_used_wrap_counter ^= 1;
+	}
+}
+
+/*
+ * A packed vring descriptor has been used by the device when both its
+ * AVAIL and USED flags match the used wrap counter. The caller issues the
+ * read barrier before reading the rest of the descriptor.
+ */
+static inline int
+vq_packed_desc_is_used(struct virtqueue *vq, uint16_t idx)
+{
+	uint16_t flags, wrap = vq->vq_used_wrap_counter;
+
+	flags = *(volatile uint16_t *)&vq->vq_ring_packed.desc[idx].flags;
+	return !!(flags & VRING_PACKED_DESC_F_AVAIL) == wrap &&
+		!!(flags & VRING_PACKED_DESC_F_USED) == wrap;
+}
+
+static inline int
+virtqueue_kick_prepare_packed(struct virtqueue *vq)
+{
+	/* Order the descriptor flags stores with the event flags load */
+	virtio_mb();
+	return *(volatile uint16_t *)&vq->vq_ring_packed.device->desc_event_flags !=
+		RING_EVENT_FLAGS_DISABLE;
+}
+
 static inline void
 virtqueue_notify(struct virtqueue *vq)
 {
@@ -302,12 +387,21 @@ virtqueue_notify(struct virtqueue *vq)
 	 * For virtio on IA, the notificaiton is through io port operation
 	 * which is a serialization instruction itself.
 	 */
-	VIRTIO_WRITE_REG_2(vq->hw, VIRTIO_PCI_QUEUE_NOTIFY, vq->vq_queue_index);
+	VTPCI_OPS(vq->hw)->notify_queue(vq->hw, vq);
 }
 
 #ifdef RTE_LIBRTE_VIRTIO_DEBUG_DUMP
 #define VIRTQUEUE_DUMP(vq) do { \
 	uint16_t used_idx, nused; \
+	if ((vq)->vq_packed) { \
+		PMD_INIT_LOG(DEBUG, \
+		  "VQ: - size=%d; free=%d; avail_idx=%d; avail_wrap=%d;" \
+		  " used_cons_idx=%d; used_wrap=%d", \
+		  (vq)->vq_nentries, (vq)->vq_free_cnt, \
+		  (vq)->vq_avail_idx, (vq)->vq_avail_wrap_counter, \
+		  (vq)->vq_used_cons_idx, (vq)->vq_used_wrap_counter); \
+		break; \
+	} \
 	used_idx = (vq)->vq_ring.used->idx; \
 	nused = (uint16_t)(used_idx - (vq)->vq_used_cons_idx); \
 	PMD_INIT_LOG(DEBUG, \
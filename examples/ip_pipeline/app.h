@@ -224,12 +224,28 @@ struct app_pipeline_params {
 	uint32_t n_args;
 };
 
+struct app_pipeline_load {
+	/* Cycles spent in the pipeline runs that processed packets */
+	uint64_t n_cycles;
+
+	/* Packets read from the pipeline input ports */
+	uint64_t n_pkts;
+} __rte_cache_aligned;
+
 struct app_pipeline_data {
 	void *be;
 	void *fe;
 	struct pipeline_type *ptype;
 	uint64_t timer_period;
 	uint32_t enabled;
+
+	/* Updated by the thread currently running the pipeline */
+	struct app_pipeline_load load;
+
+	/* Load over the last sample period, computed by the master */
+	struct app_pipeline_load load_prev;
+	uint64_t n_cycles_period;
+	uint64_t n_pkts_period;
 };
 
 struct app_thread_pipeline_data {
@@ -239,6 +255,7 @@ struct app_thread_pipeline_data {
 	pipeline_be_op_timer f_timer;
 	uint64_t timer_period;
 	uint64_t deadline;
+	struct app_pipeline_load *load;
 };
 
 #ifndef APP_MAX_THREAD_PIPELINES
@@ -359,6 +376,26 @@ struct app_eal_params {
 	int xen_dom0;
 };
 
+#ifndef APP_MAX_REBALANCE_CORES
+#define APP_MAX_REBALANCE_CORES                  16
+#endif
+
+struct app_rebalance_params {
+	uint32_t parsed;
+
+	/* Period of the automatic rebalancing (ms); 0 = disabled */
+	uint32_t period;
+
+	/* Thread busy percentage that triggers a pipeline move */
+	uint32_t threshold;
+
+	/* Spare cores, initially running no pipelines */
+	uint32_t socket_id[APP_MAX_REBALANCE_CORES];
+	uint32_t core_id[APP_MAX_REBALANCE_CORES];
+	uint32_t hyper_th_id[APP_MAX_REBALANCE_CORES];
+	uint32_t n_cores;
+};
+
 #ifndef APP_APPNAME_SIZE
 #define APP_APPNAME_SIZE                         256
 #endif
@@ -434,6 +471,7 @@ struct app_params {
 	uint32_t log_level;
 
 	struct app_eal_params eal_params;
+	struct app_rebalance_params rebalance_params;
 	struct app_mempool_params mempool_params[APP_MAX_MEMPOOLS];
 	struct app_link_params link_params[APP_MAX_LINKS];
 	struct app_pktq_hwq_in_params hwq_in_params[APP_MAX_HWQ_IN];
@@ -467,6 +505,7 @@ struct app_params {
 	struct pipeline_type pipeline_type[APP_MAX_PIPELINE_TYPES];
 	struct app_pipeline_data pipeline_data[APP_MAX_PIPELINES];
 	struct app_thread_data thread_data[APP_MAX_THREADS];
+	uint64_t load_sample_tsc;
 	cmdline_parse_ctx_t cmds[APP_MAX_CMDS + 1];
 
 	int eal_argc;
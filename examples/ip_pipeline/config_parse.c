@@ -59,6 +59,11 @@ static struct app_params app_params_default = {
 	.eal_params = {
 		.channels = 4,
 	},
+
+	.rebalance_params = {
+		.period = 0,
+		.threshold = 90,
+	},
 };
 
 static const struct app_mempool_params mempool_params_default = {
@@ -923,6 +928,131 @@ parse_eal(struct app_params *app,
 	free(entries);
 }
 
+static int
+parse_rebalance_cores(struct app_params *app,
+	struct app_rebalance_params *p,
+	const char *value)
+{
+	const char *next = value;
+	char *end;
+	char name[APP_PARAM_NAME_SIZE];
+	size_t name_len;
+
+	while (*next != '\0') {
+		uint32_t socket_id, core_id, hyper_th_id;
+		ssize_t idx;
+		int status;
+
+		end = strchr(next, ' ');
+		if (!end)
+			name_len = strlen(next);
+		else
+			name_len = end - next;
+
+		if (name_len == 0 || name_len == sizeof(name))
+			return -EINVAL;
+
+		strncpy(name, next, name_len);
+		name[name_len] = '\0';
+		next += name_len;
+		if (*next != '\0')
+			next++;
+
+		if (p->n_cores >= APP_MAX_REBALANCE_CORES)
+			return -ENOMEM;
+
+		status = parse_pipeline_core(&socket_id,
+			&core_id,
+			&hyper_th_id,
+			name);
+		if (status != 0)
+			return status;
+
+		p->socket_id[p->n_cores] = socket_id;
+		p->core_id[p->n_cores] = core_id;
+		p->hyper_th_id[p->n_cores] = hyper_th_id;
+		p->n_cores++;
+
+		/* Thread message queues of the spare core */
+		snprintf(name, sizeof(name),
+			"MSGQ-REQ-CORE-s%" PRIu32 "c%" PRIu32 "%s",
+			socket_id,
+			core_id,
+			(hyper_th_id) ? "h" : "");
+		idx = APP_PARAM_ADD(app->msgq_params, name);
+		PARSER_IMPLICIT_PARAM_ADD_CHECK(idx, name);
+		app->msgq_params[idx].cpu_socket_id = socket_id;
+
+		snprintf(name, sizeof(name),
+			"MSGQ-RSP-CORE-s%" PRIu32 "c%" PRIu32 "%s",
+			socket_id,
+			core_id,
+			(hyper_th_id) ? "h" : "");
+		idx = APP_PARAM_ADD(app->msgq_params, name);
+		PARSER_IMPLICIT_PARAM_ADD_CHECK(idx, name);
+		app->msgq_params[idx].cpu_socket_id = socket_id;
+	}
+
+	return 0;
+}
+
+static void
+parse_rebalance(struct app_params *app,
+	const char *section_name,
+	struct rte_cfgfile *cfg)
+{
+	struct app_rebalance_params *p = &app->rebalance_params;
+	struct rte_cfgfile_entry *entries;
+	int n_entries, i;
+
+	n_entries = rte_cfgfile_section_num_entries(cfg, section_name);
+	PARSE_ERROR_SECTION_NO_ENTRIES((n_entries > 0), section_name);
+
+	entries = malloc(n_entries * sizeof(struct rte_cfgfile_entry));
+	PARSE_ERROR_MALLOC(entries != NULL);
+
+	rte_cfgfile_section_entries(cfg, section_name, entries, n_entries);
+
+	p->parsed = 1;
+
+	for (i = 0; i < n_entries; i++) {
+		struct rte_cfgfile_entry *entry = &entries[i];
+
+		/* period */
+		if (strcmp(entry->name, "period") == 0) {
+			int status = parser_read_uint32(&p->period,
+				entry->value);
+
+			PARSE_ERROR((status == 0), section_name, entry->name);
+			continue;
+		}
+
+		/* threshold */
+		if (strcmp(entry->name, "threshold") == 0) {
+			int status = parser_read_uint32(&p->threshold,
+				entry->value);
+
+			PARSE_ERROR((status == 0) && (p->threshold <= 100),
+				section_name, entry->name);
+			continue;
+		}
+
+		/* core */
+		if (strcmp(entry->name, "core") == 0) {
+			int status = parse_rebalance_cores(app, p,
+				entry->value);
+
+			PARSE_ERROR((status == 0), section_name, entry->name);
+			continue;
+		}
+
+		/* unrecognized */
+		PARSE_ERROR_INVALID(0, section_name, entry->name);
+	}
+
+	free(entries);
+}
+
 static int
 parse_pipeline_pktq_in(struct app_params *app,
 	struct app_pipeline_params *p,
@@ -1868,6 +1998,7 @@ struct config_section {
 
 static const struct config_section cfg_file_scheme[] = {
 	{"EAL", 0, parse_eal},
+	{"REBALANCE", 0, parse_rebalance},
 	{"PIPELINE", 1, parse_pipeline},
 	{"MEMPOOL", 1, parse_mempool},
 	{"LINK", 1, parse_link},
@@ -2100,6 +2231,32 @@ save_eal_params(struct app_params *app, FILE *f)
 	fputc('\n', f);
 }
 
+static void
+save_rebalance_params(struct app_params *app, FILE *f)
+{
+	struct app_rebalance_params *p = &app->rebalance_params;
+	uint32_t i;
+
+	if (p->parsed == 0)
+		return;
+
+	fprintf(f, "[REBALANCE]\n");
+	fprintf(f, "%s = %" PRIu32 "\n", "period", p->period);
+	fprintf(f, "%s = %" PRIu32 "\n", "threshold", p->threshold);
+
+	if (p->n_cores) {
+		fprintf(f, "core =");
+		for (i = 0; i < p->n_cores; i++)
+			fprintf(f, " s%" PRIu32 "c%" PRIu32 "%s",
+				p->socket_id[i],
+				p->core_id[i],
+				(p->hyper_th_id[i]) ? "h" : "");
+		fputc('\n', f);
+	}
+
+	fputc('\n', f);
+}
+
 static void
 save_mempool_params(struct app_params *app, FILE *f)
 {
@@ -2446,6 +2603,7 @@ app_config_save(struct app_params *app, const char *file_name)
 		"Failed to save configuration to file \"%s\"", file_name);
 
 	save_eal_params(app, file);
+	save_rebalance_params(app, file);
 	save_pipeline_params(app, file);
 	save_mempool_params(app, file);
 	save_links_params(app, file);
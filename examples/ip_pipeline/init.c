@@ -89,6 +89,21 @@ app_init_core_mask(struct app_params *app)
 		mask |= 1LLU << lcore_id;
 	}
 
+	for (i = 0; i < app->rebalance_params.n_cores; i++) {
+		struct app_rebalance_params *p = &app->rebalance_params;
+		int lcore_id;
+
+		lcore_id = cpu_core_map_get_lcore_id(app->core_map,
+			p->socket_id[i],
+			p->core_id[i],
+			p->hyper_th_id[i]);
+
+		if (lcore_id < 0)
+			rte_panic("Cannot create CPU core mask\n");
+
+		mask |= 1LLU << lcore_id;
+	}
+
 	app->core_mask = mask;
 	APP_LOG(app, HIGH, "CPU core mask = 0x%016" PRIx64, app->core_mask);
 }
@@ -1348,11 +1363,56 @@ app_init_pipelines(struct app_params *app)
 	}
 }
 
+static struct app_thread_data *
+app_init_thread(struct app_params *app,
+	uint32_t socket_id,
+	uint32_t core_id,
+	uint32_t hyper_th_id,
+	uint64_t time)
+{
+	struct app_thread_data *t;
+	int lcore_id;
+
+	lcore_id = cpu_core_map_get_lcore_id(app->core_map,
+		socket_id,
+		core_id,
+		hyper_th_id);
+
+	if (lcore_id < 0)
+		rte_panic("Invalid core s%" PRIu32 "c%" PRIu32 "%s\n",
+			socket_id,
+			core_id,
+			(hyper_th_id) ? "h" : "");
+
+	t = &app->thread_data[lcore_id];
+
+	t->timer_period = (rte_get_tsc_hz() * APP_THREAD_TIMER_PERIOD) / 1000;
+	t->thread_req_deadline = time + t->timer_period;
+
+	t->msgq_in = app_thread_msgq_in_get(app,
+			socket_id,
+			core_id,
+			hyper_th_id);
+	if (t->msgq_in == NULL)
+		rte_panic("Init error: Cannot find MSGQ_IN for thread %" PRId32,
+			lcore_id);
+
+	t->msgq_out = app_thread_msgq_out_get(app,
+			socket_id,
+			core_id,
+			hyper_th_id);
+	if (t->msgq_out == NULL)
+		rte_panic("Init error: Cannot find MSGQ_OUT for thread %" PRId32,
+			lcore_id);
+
+	return t;
+}
+
 static void
 app_init_threads(struct app_params *app)
 {
 	uint64_t time = rte_get_tsc_cycles();
-	uint32_t p_id;
+	uint32_t p_id, i;
 
 	for (p_id = 0; p_id < app->n_pipelines; p_id++) {
 		struct app_pipeline_params *params =
@@ -1361,39 +1421,12 @@ app_init_threads(struct app_params *app)
 		struct pipeline_type *ptype;
 		struct app_thread_data *t;
 		struct app_thread_pipeline_data *p;
-		int lcore_id;
 
-		lcore_id = cpu_core_map_get_lcore_id(app->core_map,
+		t = app_init_thread(app,
 			params->socket_id,
 			params->core_id,
-			params->hyper_th_id);
-
-		if (lcore_id < 0)
-			rte_panic("Invalid core s%" PRIu32 "c%" PRIu32 "%s\n",
-				params->socket_id,
-				params->core_id,
-				(params->hyper_th_id) ? "h" : "");
-
-		t = &app->thread_data[lcore_id];
-
-		t->timer_period = (rte_get_tsc_hz() * APP_THREAD_TIMER_PERIOD) / 1000;
-		t->thread_req_deadline = time + t->timer_period;
-
-		t->msgq_in = app_thread_msgq_in_get(app,
-				params->socket_id,
-				params->core_id,
-				params->hyper_th_id);
-		if (t->msgq_in == NULL)
-			rte_panic("Init error: Cannot find MSGQ_IN for thread %" PRId32,
-				lcore_id);
-
-		t->msgq_out = app_thread_msgq_out_get(app,
-				params->socket_id,
-				params->core_id,
-				params->hyper_th_id);
-		if (t->msgq_out == NULL)
-			rte_panic("Init error: Cannot find MSGQ_OUT for thread %" PRId32,
-				lcore_id);
+			params->hyper_th_id,
+			time);
 
 		ptype = app_pipeline_type_find(app, params->type);
 		if (ptype == NULL)
@@ -1410,6 +1443,7 @@ app_init_threads(struct app_params *app)
 		p->f_timer = ptype->be_ops->f_timer;
 		p->timer_period = data->timer_period;
 		p->deadline = time + data->timer_period;
+		p->load = &data->load;
 
 		data->enabled = 1;
 
@@ -1418,6 +1452,16 @@ app_init_threads(struct app_params *app)
 		else
 			t->n_custom++;
 	}
+
+	/* Spare threads for run-time pipeline rebalancing */
+	for (i = 0; i < app->rebalance_params.n_cores; i++)
+		app_init_thread(app,
+			app->rebalance_params.socket_id[i],
+			app->rebalance_params.core_id[i],
+			app->rebalance_params.hyper_th_id[i],
+			time);
+
+	app->load_sample_tsc = time;
 }
 
 int app_init(struct app_params *app)
@@ -523,12 +523,18 @@ cmd_stats_port_in_parsed(
 	printf("Pipeline %" PRIu32 " - stats for input port %" PRIu32 ":\n"
 		"\tPkts in: %" PRIu64 "\n"
 		"\tPkts dropped by AH: %" PRIu64 "\n"
-		"\tPkts dropped by other: %" PRIu64 "\n",
+		"\tPkts dropped by other: %" PRIu64 "\n"
+		"\tCycles in RX: %" PRIu64 "\n"
+		"\tCycles in AH: %" PRIu64 "\n"
+		"\tCycles in dispatch: %" PRIu64 "\n",
 		params->pipeline_id,
 		params->port_in_id,
 		stats.stats.n_pkts_in,
 		stats.n_pkts_dropped_by_ah,
-		stats.stats.n_pkts_drop);
+		stats.stats.n_pkts_drop,
+		stats.n_cycles_rx,
+		stats.n_cycles_ah,
+		stats.n_cycles_dispatch);
 }
 
 cmdline_parse_token_string_t cmd_stats_port_in_p_string =
@@ -609,12 +615,14 @@ cmd_stats_port_out_parsed(
 	printf("Pipeline %" PRIu32 " - stats for output port %" PRIu32 ":\n"
 		"\tPkts in: %" PRIu64 "\n"
 		"\tPkts dropped by AH: %" PRIu64 "\n"
-		"\tPkts dropped by other: %" PRIu64 "\n",
+		"\tPkts dropped by other: %" PRIu64 "\n"
+		"\tCycles in flush: %" PRIu64 "\n",
 		params->pipeline_id,
 		params->port_out_id,
 		stats.stats.n_pkts_in,
 		stats.n_pkts_dropped_by_ah,
-		stats.stats.n_pkts_drop);
+		stats.stats.n_pkts_drop,
+		stats.n_cycles_flush);
 }
 
 cmdline_parse_token_string_t cmd_stats_port_out_p_string =
@@ -693,18 +701,24 @@ cmd_stats_table_parsed(
 	printf("Pipeline %" PRIu32 " - stats for table %" PRIu32 ":\n"
 		"\tPkts in: %" PRIu64 "\n"
 		"\tPkts in with lookup miss: %" PRIu64 "\n"
+		"\tPkts in with cache hit: %" PRIu64 "\n"
 		"\tPkts in with lookup hit dropped by AH: %" PRIu64 "\n"
 		"\tPkts in with lookup hit dropped by others: %" PRIu64 "\n"
 		"\tPkts in with lookup miss dropped by AH: %" PRIu64 "\n"
-		"\tPkts in with lookup miss dropped by others: %" PRIu64 "\n",
+		"\tPkts in with lookup miss dropped by others: %" PRIu64 "\n"
+		"\tCycles in lookup: %" PRIu64 "\n"
+		"\tCycles in AH: %" PRIu64 "\n",
 		params->pipeline_id,
 		params->table_id,
 		stats.stats.n_pkts_in,
 		stats.stats.n_pkts_lookup_miss,
+		stats.stats.n_pkts_cache_hit,
 		stats.n_pkts_dropped_by_lkp_hit_ah,
 		stats.n_pkts_dropped_lkp_hit,
 		stats.n_pkts_dropped_by_lkp_miss_ah,
-		stats.n_pkts_dropped_lkp_miss);
+		stats.n_pkts_dropped_lkp_miss,
+		stats.n_cycles_lookup,
+		stats.n_cycles_ah);
 }
 
 cmdline_parse_token_string_t cmd_stats_table_p_string =
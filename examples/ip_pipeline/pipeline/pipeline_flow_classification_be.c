@@ -36,6 +36,7 @@
 #include <rte_common.h>
 #include <rte_malloc.h>
 #include <rte_table_hash.h>
+#include <rte_table_emc.h>
 #include <rte_byteorder.h>
 #include <pipeline.h>
 
@@ -56,6 +57,9 @@ struct pipeline_flow_classification {
 	uint8_t *key_mask;
 	uint32_t flow_id_offset;
 
+	uint32_t emc_size;
+	uint32_t emc_insert_inv_prob;
+
 } __rte_cache_aligned;
 
 static void *
@@ -217,6 +221,8 @@ pipeline_fc_parse_args(struct pipeline_flow_classification *p,
 	uint32_t hash_offset_present = 0;
 	uint32_t key_mask_present = 0;
 	uint32_t flow_id_offset_present = 0;
+	uint32_t emc_size_present = 0;
+	uint32_t emc_insert_inv_prob_present = 0;
 
 	uint32_t i;
 	char *key_mask_str = NULL;
@@ -225,6 +231,8 @@ pipeline_fc_parse_args(struct pipeline_flow_classification *p,
 
 	/* default values */
 	p->flow_id = 0;
+	p->emc_size = 0;
+	p->emc_insert_inv_prob = 32;
 
 	for (i = 0; i < params->n_args; i++) {
 		char *arg_name = params->args_name[i];
@@ -307,6 +315,35 @@ pipeline_fc_parse_args(struct pipeline_flow_classification *p,
 			continue;
 		}
 
+		/* emc_size */
+		if (strcmp(arg_name, "emc_size") == 0) {
+			if (emc_size_present)
+				goto error_parse;
+			emc_size_present = 1;
+
+			p->emc_size = atoi(arg_value);
+			if ((p->emc_size != 0) &&
+				((p->emc_size < 2) ||
+				(!rte_is_power_of_2(p->emc_size))))
+				goto error_parse;
+
+			continue;
+		}
+
+		/* emc_insert_inv_prob */
+		if (strcmp(arg_name, "emc_insert_inv_prob") == 0) {
+			if (emc_insert_inv_prob_present)
+				goto error_parse;
+			emc_insert_inv_prob_present = 1;
+
+			p->emc_insert_inv_prob = atoi(arg_value);
+			if ((p->emc_insert_inv_prob == 0) ||
+				(!rte_is_power_of_2(p->emc_insert_inv_prob)))
+				goto error_parse;
+
+			continue;
+		}
+
 		/* Unknown argument */
 		goto error_parse;
 	}
@@ -317,6 +354,10 @@ pipeline_fc_parse_args(struct pipeline_flow_classification *p,
 		(key_size_present == 0))
 		goto error_parse;
 
+	/* The EMC reads the key signature pre-computed at hash_offset */
+	if ((p->emc_size != 0) && (p->hash_offset == 0))
+		goto error_parse;
+
 	if (key_mask_present) {
 		p->key_mask = rte_malloc(NULL, p->key_size, 0);
 		if (p->key_mask == NULL)
@@ -468,6 +509,20 @@ static void *pipeline_fc_init(struct pipeline_params *params,
 			.key_offset = p_fc->key_offset,
 		};
 
+		struct rte_table_emc_params table_emc_params = {
+			.ops = NULL, /* set below */
+			.arg_create = NULL, /* set below */
+			.key_size = p_fc->key_size,
+			.key_offset = p_fc->key_offset,
+			.key_mask = NULL, /* set below */
+			.signature_offset = p_fc->hash_offset,
+			.f_hash = NULL, /* set below */
+			.seed = 0,
+			.n_entries = p_fc->emc_size,
+			.n_ways = 2,
+			.insert_inv_prob = p_fc->emc_insert_inv_prob,
+		};
+
 		struct rte_pipeline_table_params table_params = {
 			.ops = NULL, /* set below */
 			.arg_create = NULL, /* set below */
@@ -508,6 +563,20 @@ static void *pipeline_fc_init(struct pipeline_params *params,
 			table_params.arg_create = &table_hash_params;
 		}
 
+		/* Exact match cache in front of the hash table */
+		if (p_fc->emc_size) {
+			table_emc_params.ops = table_params.ops;
+			table_emc_params.arg_create = table_params.arg_create;
+			table_emc_params.f_hash =
+				hash_func[(p_fc->key_size / 8) - 1];
+
+			if ((p_fc->key_size == 8) || (p_fc->key_size == 16))
+				table_emc_params.key_mask = p_fc->key_mask;
+
+			table_params.ops = &rte_table_emc_ops;
+			table_params.arg_create = &table_emc_params;
+		}
+
 		status = rte_pipeline_table_create(p->p,
 			&table_params,
 			&p->table_id[0]);
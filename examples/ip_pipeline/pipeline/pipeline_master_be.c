@@ -35,6 +35,7 @@
 #include <unistd.h>
 
 #include <rte_common.h>
+#include <rte_cycles.h>
 #include <rte_malloc.h>
 
 #include <cmdline_parse.h>
@@ -43,12 +44,14 @@
 #include <cmdline.h>
 
 #include "app.h"
+#include "thread_fe.h"
 #include "pipeline_master_be.h"
 
 struct pipeline_master {
 	struct app_params *app;
 	struct cmdline *cl;
 	int script_file_done;
+	uint64_t rebalance_deadline;
 } __rte_cache_aligned;
 
 static void*
@@ -136,8 +139,25 @@ pipeline_run(void *pipeline)
 }
 
 static int
-pipeline_timer(__rte_unused void *pipeline)
+pipeline_timer(void *pipeline)
 {
+	struct pipeline_master *p = (struct pipeline_master *) pipeline;
+	struct app_params *app = p->app;
+	uint32_t period = app->rebalance_params.period;
+	uint64_t time;
+
+	/* Automatic rebalancing of the pipelines across threads */
+	if (period == 0)
+		return 0;
+
+	time = rte_get_tsc_cycles();
+	if (time < p->rebalance_deadline)
+		return 0;
+
+	p->rebalance_deadline = time + (rte_get_tsc_hz() * period) / 1000;
+	if (app_thread_rebalance(app) < 0)
+		APP_LOG(app, HIGH, "Pipeline rebalancing failed");
+
 	return 0;
 }
 
@@ -31,6 +31,11 @@
  *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
 #include <cmdline_parse.h>
 #include <cmdline_parse_num.h>
 #include <cmdline_parse_string.h>
@@ -41,6 +46,8 @@
 #include "pipeline_common_fe.h"
 #include "pipeline_routing.h"
 
+#define BUF_SIZE                                           1024
+
 struct app_pipeline_routing_route {
 	struct pipeline_routing_route_key key;
 	struct pipeline_routing_route_data data;
@@ -465,6 +472,241 @@ app_pipeline_routing_delete_route(struct app_params *app,
 	return 0;
 }
 
+int
+app_pipeline_routing_add_bulk(struct app_params *app,
+	uint32_t pipeline_id,
+	struct pipeline_routing_route_key *keys,
+	struct pipeline_routing_route_data *data,
+	uint32_t n_keys)
+{
+	struct pipeline_routing *p;
+
+	struct pipeline_routing_route_add_bulk_msg_req *req;
+	struct pipeline_routing_route_add_bulk_msg_rsp *rsp;
+
+	struct app_pipeline_routing_route **entries;
+	int *new_entries, *keys_found;
+	void **entries_ptr;
+
+	uint32_t i, n_added;
+	int status = -1;
+
+	/* Check input arguments */
+	if ((app == NULL) ||
+		(keys == NULL) ||
+		(data == NULL) ||
+		(n_keys == 0))
+		return -1;
+
+	p = app_pipeline_data_fe(app, pipeline_id, &pipeline_routing);
+	if (p == NULL)
+		return -1;
+
+	for (i = 0; i < n_keys; i++) {
+		uint32_t depth, netmask;
+
+		if (keys[i].type != PIPELINE_ROUTING_ROUTE_IPV4)
+			return -1;
+
+		/* key */
+		depth = keys[i].key.ipv4.depth;
+		if ((depth == 0) || (depth > 32))
+			return -1;
+
+		netmask = (~0U) << (32 - depth);
+		keys[i].key.ipv4.ip &= netmask;
+
+		/* data */
+		if (data[i].port_id >= p->n_ports_out)
+			return -1;
+	}
+
+	entries = rte_zmalloc(NULL, n_keys * sizeof(*entries),
+		RTE_CACHE_LINE_SIZE);
+	new_entries = rte_zmalloc(NULL, n_keys * sizeof(*new_entries),
+		RTE_CACHE_LINE_SIZE);
+	keys_found = rte_zmalloc(NULL, n_keys * sizeof(*keys_found),
+		RTE_CACHE_LINE_SIZE);
+	entries_ptr = rte_zmalloc(NULL, n_keys * sizeof(*entries_ptr),
+		RTE_CACHE_LINE_SIZE);
+	if ((entries == NULL) ||
+		(new_entries == NULL) ||
+		(keys_found == NULL) ||
+		(entries_ptr == NULL))
+		goto free;
+
+	/* Find existing rules or allocate new rules */
+	for (i = 0; i < n_keys; i++) {
+		entries[i] = app_pipeline_routing_find_route(p, &keys[i]);
+		new_entries[i] = (entries[i] == NULL);
+		if (entries[i] == NULL) {
+			entries[i] = rte_malloc(NULL, sizeof(*entries[i]),
+				RTE_CACHE_LINE_SIZE);
+
+			if (entries[i] == NULL)
+				goto free_entries;
+		}
+	}
+
+	/* Allocate and write request */
+	req = app_msg_alloc(app);
+	if (req == NULL)
+		goto free_entries;
+
+	req->type = PIPELINE_MSG_REQ_CUSTOM;
+	req->subtype = PIPELINE_ROUTING_MSG_REQ_ROUTE_ADD_BULK;
+	req->keys = keys;
+	req->data = data;
+	req->n_keys = n_keys;
+	req->keys_found = keys_found;
+	req->entries_ptr = entries_ptr;
+
+	rsp = app_msg_send_recv(app, pipeline_id, req, MSG_TIMEOUT_DEFAULT);
+	if (rsp == NULL)
+		goto free_entries;
+
+	/*
+	 * Write and commit the entries the back-end reports as added, which are
+	 * only some of them when it fails. A key given twice gets one entry.
+	 */
+	n_added = 0;
+	for (i = 0; i < n_keys; i++) {
+		struct app_pipeline_routing_route *entry;
+
+		if (entries_ptr[i] == NULL)
+			continue;
+
+		entry = app_pipeline_routing_find_route(p, &keys[i]);
+		if (entry == NULL) {
+			entry = entries[i];
+			TAILQ_INSERT_TAIL(&p->routes, entry, node);
+			p->n_routes++;
+			new_entries[i] = 0;
+		}
+
+		memcpy(&entry->key, &keys[i], sizeof(keys[i]));
+		memcpy(&entry->data, &data[i], sizeof(data[i]));
+		entry->entry_ptr = entries_ptr[i];
+		n_added++;
+	}
+
+	printf("%" PRIu32 " routes added\n", n_added);
+
+	if (rsp->status == 0)
+		status = 0;
+
+	/* Message buffer free */
+	app_msg_free(app, rsp);
+
+free_entries:
+	for (i = 0; i < n_keys; i++)
+		if (new_entries[i])
+			rte_free(entries[i]);
+
+free:
+	rte_free(entries_ptr);
+	rte_free(keys_found);
+	rte_free(new_entries);
+	rte_free(entries);
+
+	return status;
+}
+
+int
+app_pipeline_routing_delete_bulk(struct app_params *app,
+	uint32_t pipeline_id,
+	struct pipeline_routing_route_key *keys,
+	uint32_t n_keys)
+{
+	struct pipeline_routing *p;
+
+	struct pipeline_routing_route_delete_bulk_msg_req *req;
+	struct pipeline_routing_route_delete_bulk_msg_rsp *rsp;
+
+	int *keys_found;
+	uint32_t i, n_deleted;
+	int status;
+
+	/* Check input arguments */
+	if ((app == NULL) ||
+		(keys == NULL) ||
+		(n_keys == 0))
+		return -1;
+
+	p = app_pipeline_data_fe(app, pipeline_id, &pipeline_routing);
+	if (p == NULL)
+		return -1;
+
+	for (i = 0; i < n_keys; i++) {
+		uint32_t depth, netmask;
+
+		if (keys[i].type != PIPELINE_ROUTING_ROUTE_IPV4)
+			return -1;
+
+		depth = keys[i].key.ipv4.depth;
+		if ((depth == 0) || (depth > 32))
+			return -1;
+
+		netmask = (~0U) << (32 - depth);
+		keys[i].key.ipv4.ip &= netmask;
+	}
+
+	keys_found = rte_zmalloc(NULL, n_keys * sizeof(*keys_found),
+		RTE_CACHE_LINE_SIZE);
+	if (keys_found == NULL)
+		return -1;
+
+	/* Allocate and write request */
+	req = app_msg_alloc(app);
+	if (req == NULL) {
+		rte_free(keys_found);
+		return -1;
+	}
+
+	req->type = PIPELINE_MSG_REQ_CUSTOM;
+	req->subtype = PIPELINE_ROUTING_MSG_REQ_ROUTE_DEL_BULK;
+	req->keys = keys;
+	req->n_keys = n_keys;
+	req->keys_found = keys_found;
+
+	rsp = app_msg_send_recv(app, pipeline_id, req, MSG_TIMEOUT_DEFAULT);
+	if (rsp == NULL) {
+		rte_free(keys_found);
+		return -1;
+	}
+
+	/*
+	 * Remove the routes the back-end reports as deleted, which are only
+	 * some of them when it fails.
+	 */
+	n_deleted = 0;
+	for (i = 0; i < n_keys; i++) {
+		struct app_pipeline_routing_route *entry;
+
+		if (keys_found[i] == 0)
+			continue;
+
+		entry = app_pipeline_routing_find_route(p, &keys[i]);
+		if (entry == NULL)
+			continue;
+
+		TAILQ_REMOVE(&p->routes, entry, node);
+		p->n_routes--;
+		rte_free(entry);
+		n_deleted++;
+	}
+
+	printf("%" PRIu32 " routes deleted\n", n_deleted);
+
+	status = (rsp->status == 0) ? 0 : -1;
+
+	/* Free response */
+	app_msg_free(app, rsp);
+	rte_free(keys_found);
+
+	return status;
+}
+
 int
 app_pipeline_routing_add_default_route(struct app_params *app,
 	uint32_t pipeline_id,
@@ -1674,6 +1916,327 @@ static cmdline_parse_inst_t cmd_route_del = {
 	},
 };
 
+/*
+ * route add bulk / route del bulk
+ *
+ * Routes file format (one route per line, empty lines and lines starting
+ * with '#' are ignored):
+ *    <ip> <depth> <port> <nh_macaddr | nh_ip> [qinq <svlan> <cvlan>]
+ *    <ip> <depth> <port> <nh_macaddr | nh_ip> [mpls <label0>[:<label1>...]]
+ * When deleting, only the <ip> and <depth> fields are read.
+ */
+
+static int
+parse_ipv4(const char *string, uint32_t *ip)
+{
+	uint32_t a, b, c, d;
+	char extra;
+
+	if ((sscanf(string, "%" SCNu32 ".%" SCNu32 ".%" SCNu32 ".%" SCNu32 "%c",
+		&a, &b, &c, &d, &extra) != 4) ||
+		(a > 255) || (b > 255) || (c > 255) || (d > 255))
+		return -1;
+
+	*ip = (a << 24) | (b << 16) | (c << 8) | d;
+	return 0;
+}
+
+static int
+parse_macaddr(const char *string, struct ether_addr *macaddr)
+{
+	uint32_t a[ETHER_ADDR_LEN], i;
+	char extra;
+
+	if (sscanf(string, "%" SCNx32 ":%" SCNx32 ":%" SCNx32 ":%" SCNx32
+		":%" SCNx32 ":%" SCNx32 "%c",
+		&a[0], &a[1], &a[2], &a[3], &a[4], &a[5], &extra) !=
+		ETHER_ADDR_LEN)
+		return -1;
+
+	for (i = 0; i < ETHER_ADDR_LEN; i++) {
+		if (a[i] > 0xFF)
+			return -1;
+
+		macaddr->addr_bytes[i] = (uint8_t) a[i];
+	}
+
+	return 0;
+}
+
+static int
+parse_route_line(char *line,
+	struct pipeline_routing_route_key *key,
+	struct pipeline_routing_route_data *data)
+{
+	char *str;
+
+	memset(key, 0, sizeof(*key));
+	key->type = PIPELINE_ROUTING_ROUTE_IPV4;
+
+	str = strtok(line, " \t\r\n");
+	if ((str == NULL) || parse_ipv4(str, &key->key.ipv4.ip))
+		return -1;
+
+	str = strtok(NULL, " \t\r\n");
+	if (str == NULL)
+		return -1;
+	key->key.ipv4.depth = atoi(str);
+
+	if (data == NULL)
+		return 0;
+
+	memset(data, 0, sizeof(*data));
+
+	str = strtok(NULL, " \t\r\n");
+	if (str == NULL)
+		return -1;
+	data->port_id = atoi(str);
+
+	str = strtok(NULL, " \t\r\n");
+	if (str == NULL)
+		return -1;
+	if (strchr(str, ':') != NULL) {
+		if (parse_macaddr(str, &data->ethernet.macaddr))
+			return -1;
+	} else {
+		if (parse_ipv4(str, &data->ethernet.ip))
+			return -1;
+		data->flags |= PIPELINE_ROUTING_ROUTE_ARP;
+	}
+
+	str = strtok(NULL, " \t\r\n");
+	if (str == NULL)
+		return 0;
+
+	if (strcmp(str, "qinq") == 0) {
+		char *svlan = strtok(NULL, " \t\r\n");
+		char *cvlan = strtok(NULL, " \t\r\n");
+
+		if ((svlan == NULL) || (cvlan == NULL))
+			return -1;
+
+		data->flags |= PIPELINE_ROUTING_ROUTE_QINQ;
+		data->l2.qinq.svlan = atoi(svlan);
+		data->l2.qinq.cvlan = atoi(cvlan);
+		return 0;
+	}
+
+	if (strcmp(str, "mpls") == 0) {
+		str = strtok(NULL, " \t\r\n");
+		if (str == NULL)
+			return -1;
+
+		data->flags |= PIPELINE_ROUTING_ROUTE_MPLS;
+		data->l2.mpls.n_labels = RTE_DIM(data->l2.mpls.labels);
+		return parse_labels(str, data->l2.mpls.labels,
+			&data->l2.mpls.n_labels);
+	}
+
+	return -1;
+}
+
+static int
+app_pipeline_routing_bulk_parse_file(const char *filename,
+	struct pipeline_routing_route_key **keys,
+	struct pipeline_routing_route_data **data,
+	uint32_t *n_keys)
+{
+	char file_buf[BUF_SIZE];
+	uint32_t n_lines, n, line_id;
+	FILE *f;
+
+	*keys = NULL;
+	if (data)
+		*data = NULL;
+	*n_keys = 0;
+
+	f = fopen(filename, "r");
+	if (f == NULL)
+		return -1;
+
+	n_lines = 0;
+	while (fgets(file_buf, BUF_SIZE, f) != NULL)
+		n_lines++;
+	rewind(f);
+
+	if (n_lines == 0)
+		goto error;
+
+	*keys = rte_malloc(NULL, n_lines * sizeof(**keys),
+		RTE_CACHE_LINE_SIZE);
+	if (*keys == NULL)
+		goto error;
+
+	if (data) {
+		*data = rte_malloc(NULL, n_lines * sizeof(**data),
+			RTE_CACHE_LINE_SIZE);
+		if (*data == NULL)
+			goto error;
+	}
+
+	for (n = 0, line_id = 1; fgets(file_buf, BUF_SIZE, f) != NULL;
+		line_id++) {
+		char *line = file_buf + strspn(file_buf, " \t");
+
+		if ((line[0] == '#') || (line[0] == '\n') ||
+			(line[0] == '\r') || (line[0] == '\0'))
+			continue;
+
+		if (parse_route_line(line, &(*keys)[n],
+			(data) ? &(*data)[n] : NULL)) {
+			printf("%s: line %" PRIu32 ": invalid route\n",
+				filename, line_id);
+			goto error;
+		}
+
+		n++;
+	}
+
+	if (n == 0)
+		goto error;
+
+	fclose(f);
+	*n_keys = n;
+	return 0;
+
+error:
+	fclose(f);
+	rte_free(*keys);
+	*keys = NULL;
+	if (data) {
+		rte_free(*data);
+		*data = NULL;
+	}
+	return -1;
+}
+
+struct cmd_route_bulk_result {
+	cmdline_fixed_string_t p_string;
+	uint32_t p;
+	cmdline_fixed_string_t route_string;
+	cmdline_fixed_string_t op_string;
+	cmdline_fixed_string_t bulk_string;
+	cmdline_fixed_string_t file_path;
+};
+
+static void
+cmd_route_add_bulk_parsed(
+	void *parsed_result,
+	__rte_unused struct cmdline *cl,
+	void *data)
+{
+	struct cmd_route_bulk_result *params = parsed_result;
+	struct app_params *app = data;
+	struct pipeline_routing_route_key *keys;
+	struct pipeline_routing_route_data *route_data;
+	uint32_t n_keys;
+	int status;
+
+	status = app_pipeline_routing_bulk_parse_file(params->file_path,
+		&keys, &route_data, &n_keys);
+	if (status != 0) {
+		printf("Command failed\n");
+		return;
+	}
+
+	status = app_pipeline_routing_add_bulk(app,
+		params->p,
+		keys,
+		route_data,
+		n_keys);
+	if (status != 0)
+		printf("Command failed\n");
+
+	rte_free(route_data);
+	rte_free(keys);
+}
+
+static void
+cmd_route_del_bulk_parsed(
+	void *parsed_result,
+	__rte_unused struct cmdline *cl,
+	void *data)
+{
+	struct cmd_route_bulk_result *params = parsed_result;
+	struct app_params *app = data;
+	struct pipeline_routing_route_key *keys;
+	uint32_t n_keys;
+	int status;
+
+	status = app_pipeline_routing_bulk_parse_file(params->file_path,
+		&keys, NULL, &n_keys);
+	if (status != 0) {
+		printf("Command failed\n");
+		return;
+	}
+
+	status = app_pipeline_routing_delete_bulk(app,
+		params->p,
+		keys,
+		n_keys);
+	if (status != 0)
+		printf("Command failed\n");
+
+	rte_free(keys);
+}
+
+static cmdline_parse_token_string_t cmd_route_bulk_p_string =
+	TOKEN_STRING_INITIALIZER(struct cmd_route_bulk_result, p_string,
+	"p");
+
+static cmdline_parse_token_num_t cmd_route_bulk_p =
+	TOKEN_NUM_INITIALIZER(struct cmd_route_bulk_result, p, UINT32);
+
+static cmdline_parse_token_string_t cmd_route_bulk_route_string =
+	TOKEN_STRING_INITIALIZER(struct cmd_route_bulk_result, route_string,
+	"route");
+
+static cmdline_parse_token_string_t cmd_route_bulk_add_string =
+	TOKEN_STRING_INITIALIZER(struct cmd_route_bulk_result, op_string,
+	"add");
+
+static cmdline_parse_token_string_t cmd_route_bulk_del_string =
+	TOKEN_STRING_INITIALIZER(struct cmd_route_bulk_result, op_string,
+	"del");
+
+static cmdline_parse_token_string_t cmd_route_bulk_bulk_string =
+	TOKEN_STRING_INITIALIZER(struct cmd_route_bulk_result, bulk_string,
+	"bulk");
+
+static cmdline_parse_token_string_t cmd_route_bulk_file_path =
+	TOKEN_STRING_INITIALIZER(struct cmd_route_bulk_result, file_path,
+	NULL);
+
+static cmdline_parse_inst_t cmd_route_add_bulk = {
+	.f = cmd_route_add_bulk_parsed,
+	.data = NULL,
+	.help_str = "Route add bulk (routes loaded from file)",
+	.tokens = {
+		(void *)&cmd_route_bulk_p_string,
+		(void *)&cmd_route_bulk_p,
+		(void *)&cmd_route_bulk_route_string,
+		(void *)&cmd_route_bulk_add_string,
+		(void *)&cmd_route_bulk_bulk_string,
+		(void *)&cmd_route_bulk_file_path,
+		NULL,
+	},
+};
+
+static cmdline_parse_inst_t cmd_route_del_bulk = {
+	.f = cmd_route_del_bulk_parsed,
+	.data = NULL,
+	.help_str = "Route delete bulk (routes loaded from file)",
+	.tokens = {
+		(void *)&cmd_route_bulk_p_string,
+		(void *)&cmd_route_bulk_p,
+		(void *)&cmd_route_bulk_route_string,
+		(void *)&cmd_route_bulk_del_string,
+		(void *)&cmd_route_bulk_bulk_string,
+		(void *)&cmd_route_bulk_file_path,
+		NULL,
+	},
+};
+
 /*
  * route add default
  */
@@ -2215,6 +2778,8 @@ static cmdline_parse_ctx_t pipeline_cmds[] = {
 	(cmdline_parse_inst_t *)&cmd_route_add5,
 	(cmdline_parse_inst_t *)&cmd_route_add6,
 	(cmdline_parse_inst_t *)&cmd_route_del,
+	(cmdline_parse_inst_t *)&cmd_route_add_bulk,
+	(cmdline_parse_inst_t *)&cmd_route_del_bulk,
 	(cmdline_parse_inst_t *)&cmd_route_add_default,
 	(cmdline_parse_inst_t *)&cmd_route_del_default,
 	(cmdline_parse_inst_t *)&cmd_route_ls,
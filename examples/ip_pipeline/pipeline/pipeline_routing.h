@@ -52,6 +52,19 @@ app_pipeline_routing_delete_route(struct app_params *app,
 	uint32_t pipeline_id,
 	struct pipeline_routing_route_key *key);
 
+int
+app_pipeline_routing_add_bulk(struct app_params *app,
+	uint32_t pipeline_id,
+	struct pipeline_routing_route_key *keys,
+	struct pipeline_routing_route_data *data,
+	uint32_t n_keys);
+
+int
+app_pipeline_routing_delete_bulk(struct app_params *app,
+	uint32_t pipeline_id,
+	struct pipeline_routing_route_key *keys,
+	uint32_t n_keys);
+
 int
 app_pipeline_routing_add_default_route(struct app_params *app,
 	uint32_t pipeline_id,
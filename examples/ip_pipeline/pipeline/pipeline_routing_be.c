@@ -111,6 +111,14 @@ static void *
 pipeline_routing_msg_req_route_del_default_handler(struct pipeline *p,
 	void *msg);
 
+static void *
+pipeline_routing_msg_req_route_add_bulk_handler(struct pipeline *p,
+	void *msg);
+
+static void *
+pipeline_routing_msg_req_route_del_bulk_handler(struct pipeline *p,
+	void *msg);
+
 static void *
 pipeline_routing_msg_req_arp_add_handler(struct pipeline *p,
 	void *msg);
@@ -136,6 +144,10 @@ static pipeline_msg_req_handler custom_handlers[] = {
 		pipeline_routing_msg_req_route_add_default_handler,
 	[PIPELINE_ROUTING_MSG_REQ_ROUTE_DEL_DEFAULT] =
 		pipeline_routing_msg_req_route_del_default_handler,
+	[PIPELINE_ROUTING_MSG_REQ_ROUTE_ADD_BULK] =
+		pipeline_routing_msg_req_route_add_bulk_handler,
+	[PIPELINE_ROUTING_MSG_REQ_ROUTE_DEL_BULK] =
+		pipeline_routing_msg_req_route_del_bulk_handler,
 	[PIPELINE_ROUTING_MSG_REQ_ARP_ADD] =
 		pipeline_routing_msg_req_arp_add_handler,
 	[PIPELINE_ROUTING_MSG_REQ_ARP_DEL] =
@@ -1391,26 +1403,21 @@ pipeline_routing_msg_req_custom_handler(struct pipeline *p,
 	return f_handle(p, req);
 }
 
-void *
-pipeline_routing_msg_req_route_add_handler(struct pipeline *p, void *msg)
+static int
+pipeline_routing_route_entry_build(struct pipeline *p,
+	struct pipeline_routing_route_data *data,
+	struct routing_table_entry *entry)
 {
 	struct pipeline_routing *p_rt = (struct pipeline_routing *) p;
-	struct pipeline_routing_route_add_msg_req *req = msg;
-	struct pipeline_routing_route_add_msg_rsp *rsp = msg;
-
-	struct rte_table_lpm_key key = {
-		.ip = req->key.key.ipv4.ip,
-		.depth = req->key.key.ipv4.depth,
-	};
 
 	struct routing_table_entry entry_arp0 = {
 		.head = {
 			.action = RTE_PIPELINE_ACTION_PORT,
-			{.port_id = p->port_out_id[req->data.port_id]},
+			{.port_id = p->port_out_id[data->port_id]},
 		},
 
-		.flags = req->data.flags,
-		.port_id = req->data.port_id,
+		.flags = data->flags,
+		.port_id = data->port_id,
 		.ip = 0,
 		.data_offset = 0,
 		.ether_l2_length = 0,
@@ -1424,34 +1431,28 @@ pipeline_routing_msg_req_route_add_handler(struct pipeline *p, void *msg)
 			{.table_id = p->table_id[1]},
 		},
 
-		.flags = req->data.flags,
-		.port_id = req->data.port_id,
-		.ip = rte_bswap32(req->data.ethernet.ip),
+		.flags = data->flags,
+		.port_id = data->port_id,
+		.ip = rte_bswap32(data->ethernet.ip),
 		.data_offset = 0,
 		.ether_l2_length = 0,
 		.slab = {0},
 		.slab_offset = {0},
 	};
 
-	struct rte_pipeline_table_entry *entry = (p_rt->params.n_arp_entries) ?
-		(struct rte_pipeline_table_entry *) &entry_arp1 :
-		(struct rte_pipeline_table_entry *) &entry_arp0;
-
-	if ((req->key.type != PIPELINE_ROUTING_ROUTE_IPV4) ||
-		((p_rt->params.n_arp_entries == 0) &&
-			(req->data.flags & PIPELINE_ROUTING_ROUTE_ARP)) ||
+	if (((p_rt->params.n_arp_entries == 0) &&
+			(data->flags & PIPELINE_ROUTING_ROUTE_ARP)) ||
 		(p_rt->params.n_arp_entries &&
-			((req->data.flags & PIPELINE_ROUTING_ROUTE_ARP) == 0)) ||
+			((data->flags & PIPELINE_ROUTING_ROUTE_ARP) == 0)) ||
 		((p_rt->params.encap != PIPELINE_ROUTING_ENCAP_ETHERNET_QINQ) &&
-			(req->data.flags & PIPELINE_ROUTING_ROUTE_QINQ)) ||
+			(data->flags & PIPELINE_ROUTING_ROUTE_QINQ)) ||
 		((p_rt->params.encap == PIPELINE_ROUTING_ENCAP_ETHERNET_QINQ) &&
-			((req->data.flags & PIPELINE_ROUTING_ROUTE_QINQ) == 0)) ||
+			((data->flags & PIPELINE_ROUTING_ROUTE_QINQ) == 0)) ||
 		((p_rt->params.encap != PIPELINE_ROUTING_ENCAP_ETHERNET_MPLS) &&
-			(req->data.flags & PIPELINE_ROUTING_ROUTE_MPLS)) ||
+			(data->flags & PIPELINE_ROUTING_ROUTE_MPLS)) ||
 		((p_rt->params.encap == PIPELINE_ROUTING_ENCAP_ETHERNET_MPLS) &&
-			((req->data.flags & PIPELINE_ROUTING_ROUTE_MPLS) == 0))) {
-		rsp->status = -1;
-		return rsp;
+			((data->flags & PIPELINE_ROUTING_ROUTE_MPLS) == 0))) {
+		return -1;
 	}
 
 	/* Ether - ARP off */
@@ -1461,7 +1462,7 @@ pipeline_routing_msg_req_route_add_handler(struct pipeline *p, void *msg)
 		uint64_t macaddr_dst;
 		uint64_t ethertype = ETHER_TYPE_IPv4;
 
-		macaddr_dst = *((uint64_t *)&(req->data.ethernet.macaddr));
+		macaddr_dst = *((uint64_t *)&(data->ethernet.macaddr));
 		macaddr_dst = rte_bswap64(macaddr_dst << 16);
 
 		entry_arp0.slab[0] =
@@ -1499,10 +1500,10 @@ pipeline_routing_msg_req_route_add_handler(struct pipeline *p, void *msg)
 		uint64_t ethertype_ipv4 = ETHER_TYPE_IPv4;
 		uint64_t ethertype_vlan = 0x8100;
 		uint64_t ethertype_qinq = 0x9100;
-		uint64_t svlan = req->data.l2.qinq.svlan;
-		uint64_t cvlan = req->data.l2.qinq.cvlan;
+		uint64_t svlan = data->l2.qinq.svlan;
+		uint64_t cvlan = data->l2.qinq.cvlan;
 
-		macaddr_dst = *((uint64_t *)&(req->data.ethernet.macaddr));
+		macaddr_dst = *((uint64_t *)&(data->ethernet.macaddr));
 		macaddr_dst = rte_bswap64(macaddr_dst << 16);
 
 		entry_arp0.slab[0] = rte_bswap64((svlan << 48) |
@@ -1530,8 +1531,8 @@ pipeline_routing_msg_req_route_add_handler(struct pipeline *p, void *msg)
 		uint64_t ethertype_ipv4 = ETHER_TYPE_IPv4;
 		uint64_t ethertype_vlan = 0x8100;
 		uint64_t ethertype_qinq = 0x9100;
-		uint64_t svlan = req->data.l2.qinq.svlan;
-		uint64_t cvlan = req->data.l2.qinq.cvlan;
+		uint64_t svlan = data->l2.qinq.svlan;
+		uint64_t cvlan = data->l2.qinq.cvlan;
 
 		entry_arp1.slab[0] = rte_bswap64((svlan << 48) |
 			(ethertype_vlan << 32) |
@@ -1555,13 +1556,13 @@ pipeline_routing_msg_req_route_add_handler(struct pipeline *p, void *msg)
 		uint64_t macaddr_dst;
 		uint64_t ethertype_mpls = 0x8847;
 
-		uint64_t label0 = req->data.l2.mpls.labels[0];
-		uint64_t label1 = req->data.l2.mpls.labels[1];
-		uint64_t label2 = req->data.l2.mpls.labels[2];
-		uint64_t label3 = req->data.l2.mpls.labels[3];
-		uint32_t n_labels = req->data.l2.mpls.n_labels;
+		uint64_t label0 = data->l2.mpls.labels[0];
+		uint64_t label1 = data->l2.mpls.labels[1];
+		uint64_t label2 = data->l2.mpls.labels[2];
+		uint64_t label3 = data->l2.mpls.labels[3];
+		uint32_t n_labels = data->l2.mpls.n_labels;
 
-		macaddr_dst = *((uint64_t *)&(req->data.ethernet.macaddr));
+		macaddr_dst = *((uint64_t *)&(data->ethernet.macaddr));
 		macaddr_dst = rte_bswap64(macaddr_dst << 16);
 
 		switch (n_labels) {
@@ -1616,8 +1617,7 @@ pipeline_routing_msg_req_route_add_handler(struct pipeline *p, void *msg)
 			break;
 
 		default:
-			rsp->status = -1;
-			return rsp;
+			return -1;
 		}
 
 		entry_arp0.slab[2] = rte_bswap64((macaddr_src << 16) |
@@ -1640,11 +1640,11 @@ pipeline_routing_msg_req_route_add_handler(struct pipeline *p, void *msg)
 		uint64_t macaddr_src = MAC_SRC_DEFAULT;
 		uint64_t ethertype_mpls = 0x8847;
 
-		uint64_t label0 = req->data.l2.mpls.labels[0];
-		uint64_t label1 = req->data.l2.mpls.labels[1];
-		uint64_t label2 = req->data.l2.mpls.labels[2];
-		uint64_t label3 = req->data.l2.mpls.labels[3];
-		uint32_t n_labels = req->data.l2.mpls.n_labels;
+		uint64_t label0 = data->l2.mpls.labels[0];
+		uint64_t label1 = data->l2.mpls.labels[1];
+		uint64_t label2 = data->l2.mpls.labels[2];
+		uint64_t label3 = data->l2.mpls.labels[3];
+		uint32_t n_labels = data->l2.mpls.n_labels;
 
 		switch (n_labels) {
 		case 1:
@@ -1698,8 +1698,7 @@ pipeline_routing_msg_req_route_add_handler(struct pipeline *p, void *msg)
 			break;
 
 		default:
-			rsp->status = -1;
-			return rsp;
+			return -1;
 		}
 
 		entry_arp1.slab[2] = rte_bswap64((macaddr_src << 16) |
@@ -1712,10 +1711,37 @@ pipeline_routing_msg_req_route_add_handler(struct pipeline *p, void *msg)
 		entry_arp1.ether_l2_length = n_labels * 4 + 14;
 	}
 
+	if (p_rt->params.n_arp_entries)
+		memcpy(entry, &entry_arp1, sizeof(*entry));
+	else
+		memcpy(entry, &entry_arp0, sizeof(*entry));
+
+	return 0;
+}
+
+void *
+pipeline_routing_msg_req_route_add_handler(struct pipeline *p, void *msg)
+{
+	struct pipeline_routing_route_add_msg_req *req = msg;
+	struct pipeline_routing_route_add_msg_rsp *rsp = msg;
+
+	struct rte_table_lpm_key key = {
+		.ip = req->key.key.ipv4.ip,
+		.depth = req->key.key.ipv4.depth,
+	};
+
+	struct routing_table_entry entry;
+
+	if ((req->key.type != PIPELINE_ROUTING_ROUTE_IPV4) ||
+		pipeline_routing_route_entry_build(p, &req->data, &entry)) {
+		rsp->status = -1;
+		return rsp;
+	}
+
 	rsp->status = rte_pipeline_table_entry_add(p->p,
 		p->table_id[0],
 		&key,
-		entry,
+		(struct rte_pipeline_table_entry *) &entry,
 		&rsp->key_found,
 		(struct rte_pipeline_table_entry **) &rsp->entry_ptr);
 
@@ -1786,6 +1812,108 @@ pipeline_routing_msg_req_route_del_default_handler(struct pipeline *p,
 	return rsp;
 }
 
+void *
+pipeline_routing_msg_req_route_add_bulk_handler(struct pipeline *p, void *msg)
+{
+	struct pipeline_routing_route_add_bulk_msg_req *req = msg;
+	struct pipeline_routing_route_add_bulk_msg_rsp *rsp = msg;
+
+	struct rte_table_lpm_key *keys;
+	struct routing_table_entry *entries;
+	void **keys_ptr;
+	struct rte_pipeline_table_entry **entries_ptr;
+	uint32_t i, n_keys = req->n_keys;
+
+	keys = rte_malloc(NULL, n_keys * sizeof(*keys), RTE_CACHE_LINE_SIZE);
+	entries = rte_malloc(NULL, n_keys * sizeof(*entries),
+		RTE_CACHE_LINE_SIZE);
+	keys_ptr = rte_malloc(NULL, n_keys * sizeof(*keys_ptr),
+		RTE_CACHE_LINE_SIZE);
+	entries_ptr = rte_malloc(NULL, n_keys * sizeof(*entries_ptr),
+		RTE_CACHE_LINE_SIZE);
+	if ((keys == NULL) ||
+		(entries == NULL) ||
+		(keys_ptr == NULL) ||
+		(entries_ptr == NULL)) {
+		rsp->status = -1;
+		goto free;
+	}
+
+	for (i = 0; i < n_keys; i++) {
+		if ((req->keys[i].type != PIPELINE_ROUTING_ROUTE_IPV4) ||
+			pipeline_routing_route_entry_build(p, &req->data[i],
+				&entries[i])) {
+			rsp->status = -1;
+			goto free;
+		}
+
+		keys[i].ip = req->keys[i].key.ipv4.ip;
+		keys[i].depth = req->keys[i].key.ipv4.depth;
+
+		keys_ptr[i] = &keys[i];
+		entries_ptr[i] = (struct rte_pipeline_table_entry *) &entries[i];
+	}
+
+	rsp->status = rte_pipeline_table_entry_add_bulk(p->p,
+		p->table_id[0],
+		keys_ptr,
+		entries_ptr,
+		n_keys,
+		req->keys_found,
+		(struct rte_pipeline_table_entry **) req->entries_ptr);
+
+free:
+	rte_free(entries_ptr);
+	rte_free(keys_ptr);
+	rte_free(entries);
+	rte_free(keys);
+
+	return rsp;
+}
+
+void *
+pipeline_routing_msg_req_route_del_bulk_handler(struct pipeline *p, void *msg)
+{
+	struct pipeline_routing_route_delete_bulk_msg_req *req = msg;
+	struct pipeline_routing_route_delete_bulk_msg_rsp *rsp = msg;
+
+	struct rte_table_lpm_key *keys;
+	void **keys_ptr;
+	uint32_t i, n_keys = req->n_keys;
+
+	keys = rte_malloc(NULL, n_keys * sizeof(*keys), RTE_CACHE_LINE_SIZE);
+	keys_ptr = rte_malloc(NULL, n_keys * sizeof(*keys_ptr),
+		RTE_CACHE_LINE_SIZE);
+	if ((keys == NULL) || (keys_ptr == NULL)) {
+		rsp->status = -1;
+		goto free;
+	}
+
+	for (i = 0; i < n_keys; i++) {
+		if (req->keys[i].type != PIPELINE_ROUTING_ROUTE_IPV4) {
+			rsp->status = -1;
+			goto free;
+		}
+
+		keys[i].ip = req->keys[i].key.ipv4.ip;
+		keys[i].depth = req->keys[i].key.ipv4.depth;
+		keys_ptr[i] = &keys[i];
+	}
+
+	rsp->status = rte_pipeline_table_entry_delete_bulk(p->p,
+		p->table_id[0],
+		keys_ptr,
+		n_keys,
+		req->keys_found,
+		NULL);
+
+free:
+	rte_free(keys_ptr);
+	rte_free(keys);
+
+	return rsp;
+}
+
 void *
 pipeline_routing_msg_req_arp_add_handler(struct pipeline *p, void *msg)
 {
@@ -156,6 +156,8 @@ enum pipeline_routing_msg_req_type {
 	PIPELINE_ROUTING_MSG_REQ_ROUTE_DEL,
 	PIPELINE_ROUTING_MSG_REQ_ROUTE_ADD_DEFAULT,
 	PIPELINE_ROUTING_MSG_REQ_ROUTE_DEL_DEFAULT,
+	PIPELINE_ROUTING_MSG_REQ_ROUTE_ADD_BULK,
+	PIPELINE_ROUTING_MSG_REQ_ROUTE_DEL_BULK,
 	PIPELINE_ROUTING_MSG_REQ_ARP_ADD,
 	PIPELINE_ROUTING_MSG_REQ_ARP_DEL,
 	PIPELINE_ROUTING_MSG_REQ_ARP_ADD_DEFAULT,
@@ -199,6 +201,46 @@ struct pipeline_routing_route_delete_msg_rsp {
 	int key_found;
 };
 
+/*
+ * MSG ROUTE ADD BULK
+ */
+struct pipeline_routing_route_add_bulk_msg_req {
+	enum pipeline_msg_req_type type;
+	enum pipeline_routing_msg_req_type subtype;
+
+	/* key */
+	struct pipeline_routing_route_key *keys;
+
+	/* data */
+	struct pipeline_routing_route_data *data;
+
+	uint32_t n_keys;
+	int *keys_found;
+	void **entries_ptr;
+};
+
+struct pipeline_routing_route_add_bulk_msg_rsp {
+	int status;
+};
+
+/*
+ * MSG ROUTE DELETE BULK
+ */
+struct pipeline_routing_route_delete_bulk_msg_req {
+	enum pipeline_msg_req_type type;
+	enum pipeline_routing_msg_req_type subtype;
+
+	/* key */
+	struct pipeline_routing_route_key *keys;
+
+	uint32_t n_keys;
+	int *keys_found;
+};
+
+struct pipeline_routing_route_delete_bulk_msg_rsp {
+	int status;
+};
+
 /*
  * MSG ROUTE ADD DEFAULT
  */
@@ -86,6 +86,7 @@ thread_pipeline_enable(struct app_thread_data *t,
 	p->f_timer = req->f_timer;
 	p->timer_period = req->timer_period;
 	p->deadline = 0;
+	p->load = req->load;
 
 	if (req->f_run == NULL)
 		t->n_regular++;
@@ -105,9 +106,18 @@ thread_pipeline_disable(struct app_thread_data *t,
 
 	/* search regular pipelines of current thread */
 	for (i = 0; i < n_regular; i++) {
+		struct pipeline *p = t->regular[i].be;
+
 		if (t->regular[i].pipeline_id != req->pipeline_id)
 			continue;
 
+		/*
+		 * Push out the packets buffered by the output ports, so the
+		 * pipeline can be enabled on a different thread straight away
+		 * without losing any packet.
+		 */
+		rte_pipeline_flush(p->p);
+
 		if (i < n_regular - 1)
 			memcpy(&t->regular[i],
 			  &t->regular[i+1],
@@ -183,12 +193,23 @@ app_thread(void *arg)
 		uint32_t n_regular = RTE_MIN(t->n_regular, RTE_DIM(t->regular));
 		uint32_t n_custom = RTE_MIN(t->n_custom, RTE_DIM(t->custom));
 
+		uint64_t tsc = rte_rdtsc();
+
 		/* Run regular pipelines */
 		for (j = 0; j < n_regular; j++) {
 			struct app_thread_pipeline_data *data = &t->regular[j];
 			struct pipeline *p = data->be;
+			uint64_t tsc_prev = tsc;
+			int n_pkts;
 
-			rte_pipeline_run(p->p);
+			n_pkts = rte_pipeline_run(p->p);
+			tsc = rte_rdtsc();
+
+			/* Only the runs that found work are accounted as load */
+			if (n_pkts > 0) {
+				data->load->n_cycles += tsc - tsc_prev;
+				data->load->n_pkts += n_pkts;
+			}
 		}
 
 		/* Run custom pipelines */
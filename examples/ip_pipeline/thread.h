@@ -62,6 +62,7 @@ struct thread_pipeline_enable_msg_req {
 	pipeline_be_op_run f_run;
 	pipeline_be_op_timer f_timer;
 	uint64_t timer_period;
+	struct app_pipeline_load *load;
 };
 
 struct thread_pipeline_enable_msg_rsp {
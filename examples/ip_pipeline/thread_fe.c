@@ -98,6 +98,7 @@ app_pipeline_enable(struct app_params *app,
 	req->f_run = p_type->be_ops->f_run;
 	req->f_timer = p_type->be_ops->f_timer;
 	req->timer_period = p->timer_period;
+	req->load = &p->load;
 
 	rsp = thread_msg_send_recv(app,
 		socket_id, core_id, hyper_th_id, req, MSG_TIMEOUT_DEFAULT);
@@ -111,6 +112,12 @@ app_pipeline_enable(struct app_params *app,
 		return -1;
 
 	p->enabled = 1;
+
+	/* Record the thread now running the pipeline */
+	p_params->socket_id = socket_id;
+	p_params->core_id = core_id;
+	p_params->hyper_th_id = hyper_th_id;
+
 	return 0;
 }
 
@@ -170,6 +177,294 @@ app_pipeline_disable(struct app_params *app,
 	return 0;
 }
 
+int
+app_pipeline_move(struct app_params *app,
+		uint32_t socket_id,
+		uint32_t core_id,
+		uint32_t hyper_th_id,
+		uint32_t pipeline_id)
+{
+	struct app_pipeline_params *p_params;
+	struct pipeline_type *p_type;
+	uint32_t src_socket_id, src_core_id, src_hyper_th_id;
+	int status;
+
+	if (app == NULL)
+		return -1;
+
+	if (app_pipeline_data(app, pipeline_id) == NULL)
+		return -1;
+
+	p_params = &app->pipeline_params[pipeline_id];
+	p_type = app_pipeline_type_find(app, p_params->type);
+
+	/* Custom pipelines (e.g. the master) stay on their thread */
+	if ((p_type == NULL) ||
+		(p_type->be_ops->f_run != NULL) ||
+		(app->pipeline_data[pipeline_id].enabled == 0))
+		return -1;
+
+	src_socket_id = p_params->socket_id;
+	src_core_id = p_params->core_id;
+	src_hyper_th_id = p_params->hyper_th_id;
+
+	if ((src_socket_id == socket_id) &&
+		(src_core_id == core_id) &&
+		(src_hyper_th_id == hyper_th_id))
+		return 0;
+
+	/*
+	 * The source thread replies to the disable request only once the
+	 * pipeline is no longer part of its run list and its output ports
+	 * have been flushed, so the pipeline is never run by two threads at
+	 * the same time. Packets waiting in the input queues stay there until
+	 * the destination thread picks them up.
+	 */
+	status = app_pipeline_disable(app,
+		src_socket_id,
+		src_core_id,
+		src_hyper_th_id,
+		pipeline_id);
+	if (status != 0)
+		return -1;
+
+	status = app_pipeline_enable(app,
+		socket_id,
+		core_id,
+		hyper_th_id,
+		pipeline_id);
+	if (status != 0) {
+		/* Roll back to the source thread */
+		app_pipeline_enable(app,
+			src_socket_id,
+			src_core_id,
+			src_hyper_th_id,
+			pipeline_id);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Thread load
+ */
+
+struct app_thread_load {
+	uint32_t valid;
+	uint32_t eligible;
+	uint32_t socket_id;
+	uint32_t core_id;
+	uint32_t hyper_th_id;
+	uint32_t n_pipelines;
+	uint64_t n_cycles;
+};
+
+static uint64_t
+app_thread_load_update(struct app_params *app)
+{
+	uint64_t time = rte_rdtsc();
+	uint64_t period = time - app->load_sample_tsc;
+	uint32_t i;
+
+	for (i = 0; i < app->n_pipelines; i++) {
+		struct app_pipeline_data *p = &app->pipeline_data[i];
+		struct app_pipeline_load load = p->load;
+
+		p->n_cycles_period = load.n_cycles - p->load_prev.n_cycles;
+		p->n_pkts_period = load.n_pkts - p->load_prev.n_pkts;
+		p->load_prev = load;
+	}
+
+	app->load_sample_tsc = time;
+	return period;
+}
+
+static void
+app_thread_load_get(struct app_params *app,
+	struct app_thread_load *threads)
+{
+	struct app_rebalance_params *rb = &app->rebalance_params;
+	uint32_t i;
+
+	memset(threads, 0, RTE_MAX_LCORE * sizeof(*threads));
+
+	for (i = 0; i < rb->n_cores; i++) {
+		int lcore_id = cpu_core_map_get_lcore_id(app->core_map,
+			rb->socket_id[i],
+			rb->core_id[i],
+			rb->hyper_th_id[i]);
+
+		if (lcore_id < 0)
+			continue;
+
+		threads[lcore_id].valid = 1;
+		threads[lcore_id].socket_id = rb->socket_id[i];
+		threads[lcore_id].core_id = rb->core_id[i];
+		threads[lcore_id].hyper_th_id = rb->hyper_th_id[i];
+	}
+
+	for (i = 0; i < app->n_pipelines; i++) {
+		struct app_pipeline_params *p_params = &app->pipeline_params[i];
+		struct app_pipeline_data *p = &app->pipeline_data[i];
+		struct app_thread_load *t;
+		int lcore_id;
+
+		if (p->enabled == 0)
+			continue;
+
+		lcore_id = cpu_core_map_get_lcore_id(app->core_map,
+			p_params->socket_id,
+			p_params->core_id,
+			p_params->hyper_th_id);
+		if (lcore_id < 0)
+			continue;
+
+		t = &threads[lcore_id];
+		t->valid = 1;
+		t->socket_id = p_params->socket_id;
+		t->core_id = p_params->core_id;
+		t->hyper_th_id = p_params->hyper_th_id;
+		t->n_pipelines++;
+		t->n_cycles += p->n_cycles_period;
+	}
+
+	/* Threads running custom pipelines (e.g. the master) are left alone */
+	for (i = 0; i < RTE_MAX_LCORE; i++)
+		threads[i].eligible = threads[i].valid &&
+			(app->thread_data[i].n_custom == 0);
+}
+
+int
+app_thread_rebalance(struct app_params *app)
+{
+	struct app_thread_load threads[RTE_MAX_LCORE];
+	struct app_thread_load *src = NULL, *dst = NULL;
+	uint64_t period, best_max = UINT64_MAX;
+	uint32_t i, pipeline_id = 0;
+	int found = 0, status;
+
+	if (app == NULL)
+		return -1;
+
+	period = app_thread_load_update(app);
+	if (period == 0)
+		return 0;
+
+	app_thread_load_get(app, threads);
+
+	/* Most and least loaded threads */
+	for (i = 0; i < RTE_MAX_LCORE; i++) {
+		struct app_thread_load *t = &threads[i];
+
+		if (t->eligible == 0)
+			continue;
+
+		if ((src == NULL) || (t->n_cycles > src->n_cycles))
+			src = t;
+		if ((dst == NULL) || (t->n_cycles < dst->n_cycles))
+			dst = t;
+	}
+
+	if ((src == NULL) ||
+		(src == dst) ||
+		(src->n_pipelines < 2) ||
+		(src->n_cycles * 100 <
+			(uint64_t) app->rebalance_params.threshold * period))
+		return 0;
+
+	/* Pick the pipeline that best evens out the two threads */
+	for (i = 0; i < app->n_pipelines; i++) {
+		struct app_pipeline_params *p_params = &app->pipeline_params[i];
+		struct app_pipeline_data *p = &app->pipeline_data[i];
+		uint64_t n_cycles = p->n_cycles_period;
+		uint64_t src_load, dst_load, max_load;
+
+		if ((p->enabled == 0) ||
+			(p_params->socket_id != src->socket_id) ||
+			(p_params->core_id != src->core_id) ||
+			(p_params->hyper_th_id != src->hyper_th_id) ||
+			(n_cycles == 0) ||
+			(dst->n_cycles + n_cycles >= src->n_cycles))
+			continue;
+
+		src_load = src->n_cycles - n_cycles;
+		dst_load = dst->n_cycles + n_cycles;
+		max_load = RTE_MAX(src_load, dst_load);
+
+		if (max_load < best_max) {
+			best_max = max_load;
+			pipeline_id = i;
+			found = 1;
+		}
+	}
+
+	if (found == 0)
+		return 0;
+
+	APP_LOG(app, HIGH, "Moving pipeline %" PRIu32 " from thread "
+		"s%" PRIu32 "c%" PRIu32 "%s to thread s%" PRIu32 "c%" PRIu32 "%s",
+		pipeline_id,
+		src->socket_id, src->core_id, (src->hyper_th_id) ? "h" : "",
+		dst->socket_id, dst->core_id, (dst->hyper_th_id) ? "h" : "");
+
+	status = app_pipeline_move(app,
+		dst->socket_id,
+		dst->core_id,
+		dst->hyper_th_id,
+		pipeline_id);
+
+	return (status == 0) ? 1 : -1;
+}
+
+static void
+app_thread_load_print(struct app_params *app)
+{
+	struct app_thread_load threads[RTE_MAX_LCORE];
+	uint64_t period;
+	uint32_t i, j;
+
+	period = app_thread_load_update(app);
+	if (period == 0)
+		return;
+
+	app_thread_load_get(app, threads);
+
+	for (i = 0; i < RTE_MAX_LCORE; i++) {
+		struct app_thread_load *t = &threads[i];
+
+		if (t->valid == 0)
+			continue;
+
+		printf("Thread s%" PRIu32 "c%" PRIu32 "%s (lcore %" PRIu32
+			"): busy = %" PRIu64 "%%\n",
+			t->socket_id, t->core_id, (t->hyper_th_id) ? "h" : "",
+			i,
+			(t->n_cycles * 100) / period);
+
+		for (j = 0; j < app->n_pipelines; j++) {
+			struct app_pipeline_params *p_params =
+				&app->pipeline_params[j];
+			struct app_pipeline_data *p = &app->pipeline_data[j];
+
+			if ((p->enabled == 0) ||
+				(p_params->socket_id != t->socket_id) ||
+				(p_params->core_id != t->core_id) ||
+				(p_params->hyper_th_id != t->hyper_th_id))
+				continue;
+
+			printf("\t%s: busy = %" PRIu64 "%%, pkts = %" PRIu64
+				", cycles/pkt = %" PRIu64 "\n",
+				p_params->name,
+				(p->n_cycles_period * 100) / period,
+				p->n_pkts_period,
+				(p->n_pkts_period) ?
+					p->n_cycles_period / p->n_pkts_period :
+					0);
+		}
+	}
+}
+
 /*
  * pipeline enable
  */
@@ -318,9 +613,169 @@ cmdline_parse_inst_t cmd_pipeline_disable = {
 	},
 };
 
+/*
+ * pipeline move
+ */
+
+struct cmd_pipeline_move_result {
+	cmdline_fixed_string_t t_string;
+	cmdline_fixed_string_t t_id_string;
+	cmdline_fixed_string_t pipeline_string;
+	uint32_t pipeline_id;
+	cmdline_fixed_string_t move_string;
+};
+
+static void
+cmd_pipeline_move_parsed(
+	void *parsed_result,
+	__rte_unused struct cmdline *cl,
+	 void *data)
+{
+	struct cmd_pipeline_move_result *params = parsed_result;
+	struct app_params *app = data;
+	int status;
+	uint32_t core_id, socket_id, hyper_th_id;
+
+	if (parse_pipeline_core(&socket_id,
+			&core_id,
+			&hyper_th_id,
+			params->t_id_string) != 0) {
+		printf("Command failed\n");
+		return;
+	}
+
+	status = app_pipeline_move(app,
+			socket_id,
+			core_id,
+			hyper_th_id,
+			params->pipeline_id);
+
+	if (status != 0)
+		printf("Command failed\n");
+}
+
+cmdline_parse_token_string_t cmd_pipeline_move_t_string =
+	TOKEN_STRING_INITIALIZER(struct cmd_pipeline_move_result, t_string, "t");
+
+cmdline_parse_token_string_t cmd_pipeline_move_t_id_string =
+	TOKEN_STRING_INITIALIZER(struct cmd_pipeline_move_result, t_id_string,
+		NULL);
+
+cmdline_parse_token_string_t cmd_pipeline_move_pipeline_string =
+	TOKEN_STRING_INITIALIZER(struct cmd_pipeline_move_result,
+		pipeline_string, "pipeline");
+
+cmdline_parse_token_num_t cmd_pipeline_move_pipeline_id =
+	TOKEN_NUM_INITIALIZER(struct cmd_pipeline_move_result, pipeline_id,
+		UINT32);
+
+cmdline_parse_token_string_t cmd_pipeline_move_move_string =
+	TOKEN_STRING_INITIALIZER(struct cmd_pipeline_move_result, move_string,
+		"move");
+
+cmdline_parse_inst_t cmd_pipeline_move = {
+	.f = cmd_pipeline_move_parsed,
+	.data = NULL,
+	.help_str = "Move pipeline to specified core",
+	.tokens = {
+		(void *)&cmd_pipeline_move_t_string,
+		(void *)&cmd_pipeline_move_t_id_string,
+		(void *)&cmd_pipeline_move_pipeline_string,
+		(void *)&cmd_pipeline_move_pipeline_id,
+		(void *)&cmd_pipeline_move_move_string,
+		NULL,
+	},
+};
+
+/*
+ * thread load
+ */
+
+struct cmd_thread_load_result {
+	cmdline_fixed_string_t t_string;
+	cmdline_fixed_string_t load_string;
+};
+
+static void
+cmd_thread_load_parsed(
+	__rte_unused void *parsed_result,
+	__rte_unused struct cmdline *cl,
+	 void *data)
+{
+	struct app_params *app = data;
+
+	app_thread_load_print(app);
+}
+
+cmdline_parse_token_string_t cmd_thread_load_t_string =
+	TOKEN_STRING_INITIALIZER(struct cmd_thread_load_result, t_string, "t");
+
+cmdline_parse_token_string_t cmd_thread_load_load_string =
+	TOKEN_STRING_INITIALIZER(struct cmd_thread_load_result, load_string,
+		"load");
+
+cmdline_parse_inst_t cmd_thread_load = {
+	.f = cmd_thread_load_parsed,
+	.data = NULL,
+	.help_str = "Display thread and pipeline load since last sample",
+	.tokens = {
+		(void *)&cmd_thread_load_t_string,
+		(void *)&cmd_thread_load_load_string,
+		NULL,
+	},
+};
+
+/*
+ * thread rebalance
+ */
+
+struct cmd_thread_rebalance_result {
+	cmdline_fixed_string_t t_string;
+	cmdline_fixed_string_t rebalance_string;
+};
+
+static void
+cmd_thread_rebalance_parsed(
+	__rte_unused void *parsed_result,
+	__rte_unused struct cmdline *cl,
+	 void *data)
+{
+	struct app_params *app = data;
+	int status;
+
+	status = app_thread_rebalance(app);
+
+	if (status < 0)
+		printf("Command failed\n");
+	else if (status == 0)
+		printf("No pipeline moved\n");
+}
+
+cmdline_parse_token_string_t cmd_thread_rebalance_t_string =
+	TOKEN_STRING_INITIALIZER(struct cmd_thread_rebalance_result, t_string,
+		"t");
+
+cmdline_parse_token_string_t cmd_thread_rebalance_rebalance_string =
+	TOKEN_STRING_INITIALIZER(struct cmd_thread_rebalance_result,
+		rebalance_string, "rebalance");
+
+cmdline_parse_inst_t cmd_thread_rebalance = {
+	.f = cmd_thread_rebalance_parsed,
+	.data = NULL,
+	.help_str = "Move one pipeline from the busiest to the idlest thread",
+	.tokens = {
+		(void *)&cmd_thread_rebalance_t_string,
+		(void *)&cmd_thread_rebalance_rebalance_string,
+		NULL,
+	},
+};
+
 static cmdline_parse_ctx_t thread_cmds[] = {
 	(cmdline_parse_inst_t *) &cmd_pipeline_enable,
 	(cmdline_parse_inst_t *) &cmd_pipeline_disable,
+	(cmdline_parse_inst_t *) &cmd_pipeline_move,
+	(cmdline_parse_inst_t *) &cmd_thread_load,
+	(cmdline_parse_inst_t *) &cmd_thread_rebalance,
 	NULL,
 };
 
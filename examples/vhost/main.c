@@ -68,6 +68,10 @@
 							(num_switching_cores*RTE_TEST_TX_DESC_DEFAULT) +\
 							(num_switching_cores*MBUF_CACHE_SIZE))
 
+/* In benchmark mode, no NIC ring needs buffers. */
+#define NUM_MBUFS_BENCH (num_switching_cores *				\
+			(2 * MAX_PKT_BURST + 2 * MBUF_CACHE_SIZE))
+
 #define MBUF_CACHE_SIZE	128
 #define MBUF_DATA_SIZE	RTE_MBUF_DEFAULT_BUF_SIZE
 
@@ -204,6 +208,12 @@ static uint32_t burst_rx_delay_time = BURST_RX_WAIT_US;
 /* Specify the number of retries on RX. */
 static uint32_t burst_rx_retry_num = BURST_RX_RETRIES;
 
+/*
+ * Microbenchmark mode, disabled on default: no NIC is used, the guests are
+ * given packets of this length and the packets they send are dropped.
+ */
+static uint32_t bench_pkt_len;
+
 /* Character device basename. Can be set by user. */
 static char dev_basename[MAX_BASENAME_SZ] = "vhost-net";
 
@@ -320,6 +330,9 @@ struct device_statistics {
 	uint64_t tx;
 	rte_atomic64_t rx_atomic;
 	uint64_t rx;
+	/* Cycles spent in the enqueue and dequeue calls, in benchmark mode. */
+	uint64_t rx_cycles;
+	uint64_t tx_cycles;
 } __rte_cache_aligned;
 struct device_statistics dev_statistics[MAX_DEVICES];
 
@@ -578,7 +591,9 @@ us_vhost_usage(const char *prgname)
 	"		--rx-desc-num [0-N]: the number of descriptors on rx, "
 			"used only when zero copy is enabled.\n"
 	"		--tx-desc-num [0-N]: the number of descriptors on tx, "
-			"used only when zero copy is enabled.\n",
+			"used only when zero copy is enabled.\n"
+	"		--bench-pkt-len [0-N]: 0: disable(default), N: benchmark "
+			"the vhost library without NIC, with N bytes packets\n",
 	       prgname);
 }
 
@@ -604,6 +619,7 @@ us_vhost_parse_args(int argc, char **argv)
 		{"zero-copy", required_argument, NULL, 0},
 		{"rx-desc-num", required_argument, NULL, 0},
 		{"tx-desc-num", required_argument, NULL, 0},
+		{"bench-pkt-len", required_argument, NULL, 0},
 		{NULL, 0, 0, 0},
 	};
 
@@ -780,6 +796,26 @@ us_vhost_parse_args(int argc, char **argv)
 				}
 			}
 
+			/* Enable/disable the microbenchmark mode. */
+			if (!strncmp(long_option[option_index].name,
+				"bench-pkt-len", MAX_LONG_OPT_SZ)) {
+				ret = parse_num_opt(optarg,
+					MBUF_DATA_SIZE - RTE_PKTMBUF_HEADROOM);
+				if ((ret == -1) || ((ret != 0) &&
+					(ret < ETHER_MIN_LEN - ETHER_CRC_LEN))) {
+					RTE_LOG(INFO, VHOST_CONFIG,
+						"Invalid argument for "
+						"bench-pkt-len [0|%u-%u]\n",
+						ETHER_MIN_LEN - ETHER_CRC_LEN,
+						MBUF_DATA_SIZE -
+						RTE_PKTMBUF_HEADROOM);
+					us_vhost_usage(prgname);
+					return -1;
+				} else {
+					bench_pkt_len = ret;
+				}
+			}
+
 			break;
 
 			/* Invalid option - print options. */
@@ -794,6 +830,18 @@ us_vhost_parse_args(int argc, char **argv)
 			ports[num_ports++] = (uint8_t)i;
 	}
 
+	if (bench_pkt_len) {
+		if (zero_copy == 1) {
+			RTE_LOG(INFO, VHOST_PORT,
+				"Benchmark mode doesn't support zero copy.\n");
+			return -1;
+		}
+		/* No NIC is used. */
+		enabled_port_mask = 0;
+		num_ports = 0;
+		return 0;
+	}
+
 	if ((num_ports ==  0) || (num_ports > MAX_SUP_PORTS)) {
 		RTE_LOG(INFO, VHOST_PORT, "Current enabled port number is %u,"
 			"but only %u port can be enabled\n",num_ports, MAX_SUP_PORTS);
@@ -1205,6 +1253,72 @@ virtio_tx_route(struct vhost_dev *vdev, struct rte_mbuf *m, uint16_t vlan_tag)
 	tx_q->len = len;
 	return;
 }
+/*
+ * Allocate the burst of broadcast packets given to the guests in benchmark
+ * mode. The enqueue copies them, so they are given again on each call.
+ */
+static int
+bench_alloc_pkts(struct rte_mempool *mbuf_pool, struct rte_mbuf **pkts)
+{
+	struct ether_hdr *eth_hdr;
+	unsigned i;
+
+	for (i = 0; i < MAX_PKT_BURST; i++) {
+		pkts[i] = rte_pktmbuf_alloc(mbuf_pool);
+		if (pkts[i] == NULL) {
+			while (i)
+				rte_pktmbuf_free(pkts[--i]);
+			return -1;
+		}
+		memset(rte_pktmbuf_mtod(pkts[i], void *), 0, bench_pkt_len);
+		eth_hdr = rte_pktmbuf_mtod(pkts[i], struct ether_hdr *);
+		memset(&eth_hdr->d_addr, 0xff, sizeof(eth_hdr->d_addr));
+		eth_hdr->ether_type = rte_cpu_to_be_16(ETHER_TYPE_IPv4);
+		pkts[i]->data_len = bench_pkt_len;
+		pkts[i]->pkt_len = bench_pkt_len;
+	}
+
+	return 0;
+}
+
+/*
+ * Benchmark mode: give a burst of packets to the guest and drop the packets
+ * it sends. Only the calls which move packets are accounted in the stats, so
+ * that polling an idle guest doesn't change the cycles per packet.
+ */
+static inline void __attribute__((always_inline))
+bench_device(struct virtio_net *dev, struct rte_mempool *mbuf_pool,
+	struct rte_mbuf **bench_pkts)
+{
+	struct rte_mbuf *pkts_burst[MAX_PKT_BURST];
+	struct device_statistics *stats = &dev_statistics[dev->device_fh];
+	uint64_t start, end;
+	uint16_t rx_count, tx_count;
+
+	start = rte_rdtsc();
+	rx_count = rte_vhost_enqueue_burst(dev, VIRTIO_RXQ, bench_pkts,
+		MAX_PKT_BURST);
+	end = rte_rdtsc();
+	if (enable_stats && rx_count) {
+		stats->rx_cycles += end - start;
+		rte_atomic64_add(&stats->rx_total_atomic, rx_count);
+		rte_atomic64_add(&stats->rx_atomic, rx_count);
+	}
+
+	start = end;
+	tx_count = rte_vhost_dequeue_burst(dev, VIRTIO_TXQ, mbuf_pool,
+		pkts_burst, MAX_PKT_BURST);
+	end = rte_rdtsc();
+	if (enable_stats && tx_count) {
+		stats->tx_cycles += end - start;
+		stats->tx_total += tx_count;
+		stats->tx += tx_count;
+	}
+
+	while (tx_count)
+		rte_pktmbuf_free(pkts_burst[--tx_count]);
+}
+
 /*
  * This function is called by each data core. It handles all RX/TX registered with the
  * core. For TX the specific lcore linked list is used. For RX, MAC addresses are compared
@@ -1217,6 +1331,7 @@ switch_worker(__attribute__((unused)) void *arg)
 	struct virtio_net *dev = NULL;
 	struct vhost_dev *vdev = NULL;
 	struct rte_mbuf *pkts_burst[MAX_PKT_BURST];
+	struct rte_mbuf *bench_pkts[MAX_PKT_BURST];
 	struct virtio_net_data_ll *dev_ll;
 	struct mbuf_table *tx_q;
 	volatile struct lcore_ll_info *lcore_ll;
@@ -1233,6 +1348,9 @@ switch_worker(__attribute__((unused)) void *arg)
 	lcore_ll = lcore_info[lcore_id].lcore_ll;
 	prev_tsc = 0;
 
+	if (bench_pkt_len && bench_alloc_pkts(mbuf_pool, bench_pkts) != 0)
+		rte_exit(EXIT_FAILURE, "Cannot allocate benchmark packets\n");
+
 	tx_q = &lcore_tx_queue[lcore_id];
 	for (i = 0; i < num_cores; i ++) {
 		if (lcore_ids[i] == lcore_id) {
@@ -1293,6 +1411,11 @@ switch_worker(__attribute__((unused)) void *arg)
 				vdev->ready = DEVICE_SAFE_REMOVE;
 				continue;
 			}
+			if (bench_pkt_len) {
+				bench_device(dev, mbuf_pool, bench_pkts);
+				dev_ll = dev_ll->next;
+				continue;
+			}
 			if (likely(vdev->ready == DEVICE_RX)) {
 				/*Handle guest RX*/
 				rx_count = rte_eth_rx_burst(ports[0],
@@ -2599,8 +2722,13 @@ new_device (struct virtio_net *dev)
 	uint32_t device_num_min = num_devices;
 	struct vhost_dev *vdev;
 	uint32_t regionidx;
+	int node;
 
-	vdev = rte_zmalloc("vhost device", sizeof(*vdev), RTE_CACHE_LINE_SIZE);
+	/* NUMA node of the guest memory of the RX vring, -1 if unknown. */
+	node = rte_vhost_get_numa_node(dev, VIRTIO_RXQ);
+
+	vdev = rte_zmalloc_socket("vhost device", sizeof(*vdev),
+				  RTE_CACHE_LINE_SIZE, node);
 	if (vdev == NULL) {
 		RTE_LOG(INFO, VHOST_DATA, "(%"PRIu64") Couldn't allocate memory for vhost dev\n",
 			dev->device_fh);
@@ -2739,13 +2867,26 @@ new_device (struct virtio_net *dev)
 	vdev->ready = DEVICE_MAC_LEARNING;
 	vdev->remove = 0;
 
-	/* Find a suitable lcore to add the device. */
+	/*
+	 * Find a suitable lcore to add the device, on the NUMA node of the
+	 * guest memory if there is one.
+	 */
 	RTE_LCORE_FOREACH_SLAVE(lcore) {
+		if (node >= 0 && rte_lcore_to_socket_id(lcore) != (unsigned)node)
+			continue;
 		if (lcore_info[lcore].lcore_ll->device_num < device_num_min) {
 			device_num_min = lcore_info[lcore].lcore_ll->device_num;
 			core_add = lcore;
 		}
 	}
+	if (core_add == 0) {
+		RTE_LCORE_FOREACH_SLAVE(lcore) {
+			if (lcore_info[lcore].lcore_ll->device_num < device_num_min) {
+				device_num_min = lcore_info[lcore].lcore_ll->device_num;
+				core_add = lcore;
+			}
+		}
+	}
 	/* Add device to lcore ll */
 	ll_dev = get_data_ll_free_entry(&lcore_info[core_add].lcore_ll->ll_root_free);
 	if (ll_dev == NULL) {
@@ -2839,6 +2980,12 @@ print_stats(void)
 					rx_dropped,
 					rx);
 
+			if (bench_pkt_len)
+				printf("\nRX cycles/packet: 	%"PRIu64""
+					"\nTX cycles/packet: 	%"PRIu64"",
+					rx ? dev_statistics[device_fh].rx_cycles / rx : 0,
+					tx ? dev_statistics[device_fh].tx_cycles / tx : 0);
+
 			dev_ll = dev_ll->next;
 		}
 		printf("\n======================================================\n");
@@ -2939,6 +3086,12 @@ main(int argc, char *argv[])
 	 */
 	valid_num_ports = check_ports_num(nb_ports);
 
+	if (bench_pkt_len) {
+		/* No NIC: allow as many devices as the linked lists do. */
+		num_devices = MAX_DEVICES;
+		valid_num_ports = 1;
+	}
+
 	if ((valid_num_ports ==  0) || (valid_num_ports > MAX_SUP_PORTS)) {
 		RTE_LOG(INFO, VHOST_PORT, "Current enabled port number is %u,"
 			"but only %u port can be enabled\n",num_ports, MAX_SUP_PORTS);
@@ -2948,6 +3101,7 @@ main(int argc, char *argv[])
 	if (zero_copy == 0) {
 		/* Create the mbuf pool. */
 		mbuf_pool = rte_pktmbuf_pool_create("MBUF_POOL",
+			bench_pkt_len ? NUM_MBUFS_BENCH :
 			NUM_MBUFS_PER_PORT * valid_num_ports, MBUF_CACHE_SIZE,
 			0, MBUF_DATA_SIZE, rte_socket_id());
 		if (mbuf_pool == NULL)
@@ -3081,6 +3235,11 @@ main(int argc, char *argv[])
 	if (mergeable == 0)
 		rte_vhost_feature_disable(1ULL << VIRTIO_NET_F_MRG_RXBUF);
 
+	/* The zero copy path works on the split virtqueue rings. */
+	if (zero_copy)
+		rte_vhost_feature_disable((1ULL << VIRTIO_F_RING_PACKED) |
+			(1ULL << VIRTIO_F_IN_ORDER));
+
 	/* Register vhost(cuse or user) driver to handle vhost messages. */
 	ret = rte_vhost_driver_register((char *)&dev_basename);
 	if (ret != 0)
@@ -585,6 +585,9 @@ rte_eal_init(int argc, char **argv)
 	if (rte_eal_dev_init() < 0)
 		rte_panic("Cannot init pmd devices\n");
 
+	if (internal_config.log_async && rte_log_set_async(1) < 0)
+		rte_panic("Cannot init asynchronous logging\n");
+
 	RTE_LCORE_FOREACH_SLAVE(i) {
 
 		/*
@@ -79,6 +79,8 @@ void __rte_panic(const char *funcname, const char *format, ...)
 
 	/* disable history */
 	rte_log_set_history(0);
+	/* abort() skips the atexit() flush of the queued messages */
+	rte_log_set_async(0);
 
 	rte_log(RTE_LOG_CRIT, RTE_LOGTYPE_EAL, "PANIC in %s():\n", funcname);
 	va_start(ap, format);
@@ -112,6 +114,7 @@ rte_exit(int exit_code, const char *format, ...)
 #ifndef RTE_EAL_ALWAYS_PANIC_ON_ERROR
 	exit(exit_code);
 #else
+	rte_log_set_async(0);
 	rte_dump_stack();
 	rte_dump_registers();
 	abort();
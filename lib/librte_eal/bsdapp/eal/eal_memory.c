@@ -36,6 +36,7 @@
 #include <sys/sysctl.h>
 #include <inttypes.h>
 #include <fcntl.h>
+#include <errno.h>
 
 #include <rte_eal.h>
 #include <rte_eal_memconfig.h>
@@ -192,3 +193,29 @@ error:
 		close(fd_hugepage);
 	return -1;
 }
+
+/* contigmem is reserved at boot time, there is nothing to hot-plug */
+struct rte_memseg *
+rte_eal_memseg_hotplug_add(int socket_id __rte_unused,
+		size_t len __rte_unused, uint64_t hugepage_sz __rte_unused)
+{
+	return NULL;
+}
+
+int
+rte_eal_memseg_hotplug_del(const struct rte_memseg *ms __rte_unused)
+{
+	return -ENOTSUP;
+}
+
+int
+rte_eal_memseg_is_hotplug(const struct rte_memseg *ms __rte_unused)
+{
+	return 0;
+}
+
+int
+rte_eal_memseg_hotplug_sync(void)
+{
+	return 0;
+}
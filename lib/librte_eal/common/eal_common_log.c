@@ -40,6 +40,7 @@
 #include <unistd.h>
 #include <inttypes.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/queue.h>
 
 #include <rte_log.h>
@@ -57,6 +58,7 @@
 #include <rte_branch_prediction.h>
 #include <rte_ring.h>
 #include <rte_mempool.h>
+#include <rte_malloc.h>
 
 #include "eal_private.h"
 
@@ -92,14 +94,66 @@ static FILE *default_log_stream;
 static int history_enabled = 1;
 
 /**
- * This global structure stores some informations about the message
- * that is currently beeing processed by one lcore
+ * This per-thread structure stores some informations about the message
+ * that is currently beeing processed by one lcore, or by the log thread
  */
 struct log_cur_msg {
 	uint32_t loglevel; /**< log level - see rte_log.h */
 	uint32_t logtype;  /**< log type  - see rte_log.h */
-} __rte_cache_aligned;
-static struct log_cur_msg log_cur_msg[RTE_MAX_LCORE]; /**< per core log */
+};
+static RTE_DEFINE_PER_LCORE(struct log_cur_msg, log_cur_msg);
+
+#if RTE_LOG_ASYNC_RING_SIZE == 0 || \
+	(RTE_LOG_ASYNC_RING_SIZE & (RTE_LOG_ASYNC_RING_SIZE - 1)) != 0
+#error "RTE_LOG_ASYNC_RING_SIZE must be a power of 2"
+#endif
+
+#define LOG_ASYNC_RING_MASK (RTE_LOG_ASYNC_RING_SIZE - 1)
+/* sleep time of the log thread when all the queues are empty */
+#define LOG_ASYNC_IDLE_US 1000
+
+/**
+ * A message queued for the log thread.
+ */
+struct log_async_msg {
+	uint32_t level;
+	uint32_t logtype;
+	uint32_t len;
+	char buf[RTE_LOG_ASYNC_MSG_SIZE];
+};
+
+/**
+ * Single producer (the lcore) single consumer (the log thread) queue of
+ * formatted messages.
+ */
+struct log_async_ring {
+	volatile uint32_t head; /**< next slot written by the lcore */
+	uint64_t queued;        /**< messages queued */
+	uint64_t dropped;       /**< messages dropped on full queue */
+	volatile uint32_t tail __rte_cache_aligned; /**< next slot to write */
+	struct log_async_msg msgs[RTE_LOG_ASYNC_RING_SIZE] __rte_cache_aligned;
+};
+
+/* never freed, an lcore may still be queueing when logging gets synchronous */
+static struct log_async_ring *log_async_rings[RTE_MAX_LCORE];
+static volatile int log_async_enabled;
+static volatile int log_async_running;
+static pthread_t log_async_thread;
+
+/**
+ * Rate limit of a log type at a log level: at most burst messages per
+ * period, counted over fixed time windows.
+ */
+struct log_rate_limit {
+	uint64_t period;         /**< in timer cycles, 0 if not limited */
+	uint32_t burst;          /**< messages per period */
+	rte_atomic32_t count;    /**< messages in the current window */
+	volatile uint64_t start; /**< start of the current window */
+};
+
+static struct log_rate_limit log_rate_limits[32][RTE_LOG_DEBUG];
+static unsigned log_rate_limit_count; /**< number of limits set */
+static rte_atomic64_t log_rate_limited;
 
 
 /* default logs */
@@ -205,21 +259,18 @@ rte_get_log_type(void)
 /* get the current loglevel for the message beeing processed */
 int rte_log_cur_msg_loglevel(void)
 {
-	unsigned lcore_id;
-	lcore_id = rte_lcore_id();
-	if (lcore_id >= RTE_MAX_LCORE)
+	/* nothing logged yet by this thread */
+	if (RTE_PER_LCORE(log_cur_msg).loglevel == 0)
 		return rte_get_log_level();
-	return log_cur_msg[lcore_id].loglevel;
+	return RTE_PER_LCORE(log_cur_msg).loglevel;
 }
 
 /* get the current logtype for the message beeing processed */
 int rte_log_cur_msg_logtype(void)
 {
-	unsigned lcore_id;
-	lcore_id = rte_lcore_id();
-	if (lcore_id >= RTE_MAX_LCORE)
+	if (RTE_PER_LCORE(log_cur_msg).loglevel == 0)
 		return rte_get_log_type();
-	return log_cur_msg[lcore_id].logtype;
+	return RTE_PER_LCORE(log_cur_msg).logtype;
 }
 
 /* Dump log history to file */
@@ -264,6 +315,235 @@ rte_log_dump_history(FILE *out)
 	rte_spinlock_unlock(&log_dump_lock);
 }
 
+/* return true if the message must be dropped by rate limiting */
+static int
+log_rate_limit_check(uint32_t level, uint32_t logtype)
+{
+	struct log_rate_limit *rl;
+	uint64_t now, start;
+
+	if (likely(log_rate_limit_count == 0) || logtype == 0 ||
+			level - 1 >= RTE_LOG_DEBUG)
+		return 0;
+
+	rl = &log_rate_limits[__builtin_ctz(logtype)][level - 1];
+	if (rl->period == 0)
+		return 0;
+
+	/* only one thread starts the new window */
+	now = rte_get_timer_cycles();
+	start = rl->start;
+	if (now - start >= rl->period &&
+			rte_atomic64_cmpset(&rl->start, start, now))
+		rte_atomic32_set(&rl->count, 0);
+
+	if ((uint32_t)rte_atomic32_add_return(&rl->count, 1) <= rl->burst)
+		return 0;
+
+	rte_atomic64_inc(&log_rate_limited);
+	return 1;
+}
+
+/* queue a message for the log thread, dropping it if the queue is full */
+static int
+log_async_enqueue(struct log_async_ring *r, uint32_t level, uint32_t logtype,
+		const char *format, va_list ap)
+{
+	struct log_async_msg *msg;
+	uint32_t head = r->head;
+	int ret;
+
+	if (head - r->tail >= RTE_LOG_ASYNC_RING_SIZE) {
+		r->dropped++;
+		return 0;
+	}
+
+	msg = &r->msgs[head & LOG_ASYNC_RING_MASK];
+	ret = vsnprintf(msg->buf, sizeof(msg->buf), format, ap);
+	if (ret < 0)
+		return ret;
+	if ((unsigned)ret >= sizeof(msg->buf)) {
+		/* keep the end of line of the truncated message */
+		ret = sizeof(msg->buf) - 1;
+		msg->buf[ret - 1] = '\n';
+	}
+	msg->len = ret;
+	msg->level = level;
+	msg->logtype = logtype;
+
+	/* make the message visible before the log thread can write it */
+	rte_wmb();
+	r->head = head + 1;
+	r->queued++;
+
+	return ret;
+}
+
+/* write the queued messages, return their number */
+static unsigned
+log_async_drain(void)
+{
+	struct log_async_ring *r;
+	struct log_async_msg *msg;
+	FILE *f = rte_logs.file;
+	unsigned lcore_id, n = 0;
+	uint32_t tail;
+
+	for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+		r = log_async_rings[lcore_id];
+		if (r == NULL)
+			continue;
+
+		for (tail = r->tail; tail != r->head; tail++) {
+			rte_rmb();
+			msg = &r->msgs[tail & LOG_ASYNC_RING_MASK];
+			RTE_PER_LCORE(log_cur_msg).loglevel = msg->level;
+			RTE_PER_LCORE(log_cur_msg).logtype = msg->logtype;
+			fwrite(msg->buf, msg->len, 1, f);
+			/* done reading the slot before giving it back */
+			rte_mb();
+			r->tail = tail + 1;
+			n++;
+		}
+	}
+	if (n != 0)
+		fflush(f);
+
+	return n;
+}
+
+static void *
+log_async_thread_main(__rte_unused void *arg)
+{
+	while (log_async_running) {
+		if (log_async_drain() == 0)
+			usleep(LOG_ASYNC_IDLE_US);
+	}
+	log_async_drain();
+
+	return NULL;
+}
+
+/* stop the log thread, once all the messages are written */
+static void
+log_async_stop(void)
+{
+	if (!log_async_enabled)
+		return;
+
+	log_async_enabled = 0;
+	rte_mb();
+	log_async_running = 0;
+	pthread_join(log_async_thread, NULL);
+	/* messages queued while disabling */
+	log_async_drain();
+}
+
+int
+rte_log_set_async(int enable)
+{
+	static int atexit_done;
+	unsigned lcore_id;
+	int ret;
+
+	if (!enable) {
+		log_async_stop();
+		return 0;
+	}
+	if (log_async_enabled)
+		return 0;
+
+	RTE_LCORE_FOREACH(lcore_id) {
+		if (log_async_rings[lcore_id] != NULL)
+			continue;
+		log_async_rings[lcore_id] = rte_zmalloc_socket("log_async",
+			sizeof(struct log_async_ring), RTE_CACHE_LINE_SIZE,
+			rte_lcore_to_socket_id(lcore_id));
+		if (log_async_rings[lcore_id] == NULL) {
+			RTE_LOG(ERR, EAL, "%s(): cannot allocate log queue of "
+				"lcore %u\n", __func__, lcore_id);
+			return -ENOMEM;
+		}
+	}
+
+	log_async_running = 1;
+	ret = pthread_create(&log_async_thread, NULL,
+			log_async_thread_main, NULL);
+	if (ret != 0) {
+		log_async_running = 0;
+		RTE_LOG(ERR, EAL, "%s(): cannot create log thread\n",
+			__func__);
+		return -ret;
+	}
+#ifdef rte_thread_setname
+	if (rte_thread_setname(log_async_thread, "eal-log-thread") != 0)
+		RTE_LOG(ERR, EAL, "%s(): cannot set log thread name\n",
+			__func__);
+#endif
+
+	/* do not lose the pending messages on exit() */
+	if (!atexit_done && atexit(log_async_stop) == 0)
+		atexit_done = 1;
+
+	rte_wmb();
+	log_async_enabled = 1;
+
+	return 0;
+}
+
+int
+rte_log_set_rate_limit(uint32_t logtype, uint32_t level,
+		unsigned burst, unsigned period_ms)
+{
+	struct log_rate_limit *rl;
+	unsigned type;
+
+	if (logtype == 0 || level < RTE_LOG_EMERG || level > RTE_LOG_DEBUG ||
+			(burst != 0 && period_ms == 0))
+		return -EINVAL;
+
+	for (type = 0; type < RTE_DIM(log_rate_limits); type++) {
+		if ((logtype & (1U << type)) == 0)
+			continue;
+
+		rl = &log_rate_limits[type][level - 1];
+		if (rl->period != 0)
+			log_rate_limit_count--;
+		rl->period = 0;
+		rte_wmb();
+		if (burst == 0)
+			continue;
+
+		rl->burst = burst;
+		rte_atomic32_set(&rl->count, 0);
+		rl->start = rte_get_timer_cycles();
+		rte_wmb();
+		rl->period = rte_get_timer_hz() * period_ms / 1000;
+		if (rl->period == 0)
+			rl->period = 1;
+		log_rate_limit_count++;
+	}
+
+	return 0;
+}
+
+void
+rte_log_get_stats(struct rte_log_stats *stats)
+{
+	const struct log_async_ring *r;
+	unsigned lcore_id;
+
+	memset(stats, 0, sizeof(*stats));
+	for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+		r = log_async_rings[lcore_id];
+		if (r == NULL)
+			continue;
+		stats->queued += r->queued;
+		stats->dropped += r->dropped;
+	}
+	stats->rate_limited = rte_atomic64_read(&log_rate_limited);
+}
+
 /*
  * Generates a log message The message will be sent in the stream
  * defined by the previous call to rte_openlog_stream().
@@ -278,12 +558,19 @@ rte_vlog(uint32_t level, uint32_t logtype, const char *format, va_list ap)
 	if ((level > rte_logs.level) || !(logtype & rte_logs.type))
 		return 0;
 
-	/* save loglevel and logtype in a global per-lcore variable */
+	if (log_rate_limit_check(level, logtype))
+		return 0;
+
 	lcore_id = rte_lcore_id();
-	if (lcore_id < RTE_MAX_LCORE) {
-		log_cur_msg[lcore_id].loglevel = level;
-		log_cur_msg[lcore_id].logtype = logtype;
-	}
+	if (log_async_enabled && level > RTE_LOG_CRIT &&
+			lcore_id < RTE_MAX_LCORE &&
+			log_async_rings[lcore_id] != NULL)
+		return log_async_enqueue(log_async_rings[lcore_id],
+				level, logtype, format, ap);
+
+	/* save loglevel and logtype in a per-thread variable */
+	RTE_PER_LCORE(log_cur_msg).loglevel = level;
+	RTE_PER_LCORE(log_cur_msg).logtype = logtype;
 
 	ret = vfprintf(f, format, ap);
 	fflush(f);
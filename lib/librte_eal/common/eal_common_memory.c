@@ -36,6 +36,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <inttypes.h>
+#include <errno.h>
 #include <sys/queue.h>
 
 #include <rte_memory.h>
@@ -43,6 +44,7 @@
 #include <rte_eal.h>
 #include <rte_eal_memconfig.h>
 #include <rte_log.h>
+#include <rte_spinlock.h>
 
 #include "eal_private.h"
 #include "eal_internal_cfg.h"
@@ -93,6 +95,9 @@ rte_dump_physmem_layout(FILE *f)
 	for (i = 0; i < RTE_MAX_MEMSEG; i++) {
 		if (mcfg->memseg[i].addr == NULL)
 			break;
+		/* hot-plugged segment released since */
+		if (mcfg->memseg[i].len == 0)
+			continue;
 
 		fprintf(f, "Segment %u: phys:0x%"PRIx64", len:%zu, "
 		       "virt:%p, socket_id:%"PRId32", "
@@ -120,6 +125,82 @@ unsigned rte_memory_get_nrank(void)
 	return rte_eal_get_configuration()->mem_config->nrank;
 }
 
+struct mem_event_callback {
+	TAILQ_ENTRY(mem_event_callback) next;
+	rte_mem_event_callback_t cb;
+	void *arg;
+};
+
+static TAILQ_HEAD(, mem_event_callback) mem_event_callback_list =
+	TAILQ_HEAD_INITIALIZER(mem_event_callback_list);
+
+static rte_spinlock_t mem_event_lock = RTE_SPINLOCK_INITIALIZER;
+
+int
+rte_mem_event_callback_register(rte_mem_event_callback_t cb, void *arg)
+{
+	struct mem_event_callback *entry;
+
+	if (cb == NULL)
+		return -EINVAL;
+
+	rte_spinlock_lock(&mem_event_lock);
+	TAILQ_FOREACH(entry, &mem_event_callback_list, next) {
+		if (entry->cb == cb && entry->arg == arg) {
+			rte_spinlock_unlock(&mem_event_lock);
+			return -EEXIST;
+		}
+	}
+	/* not from the heap, which may be what the callback watches */
+	entry = malloc(sizeof(*entry));
+	if (entry == NULL) {
+		rte_spinlock_unlock(&mem_event_lock);
+		return -ENOMEM;
+	}
+	entry->cb = cb;
+	entry->arg = arg;
+	TAILQ_INSERT_TAIL(&mem_event_callback_list, entry, next);
+	rte_spinlock_unlock(&mem_event_lock);
+
+	return 0;
+}
+
+int
+rte_mem_event_callback_unregister(rte_mem_event_callback_t cb, void *arg)
+{
+	struct mem_event_callback *entry;
+
+	rte_spinlock_lock(&mem_event_lock);
+	TAILQ_FOREACH(entry, &mem_event_callback_list, next) {
+		if (entry->cb == cb && entry->arg == arg) {
+			TAILQ_REMOVE(&mem_event_callback_list, entry, next);
+			rte_spinlock_unlock(&mem_event_lock);
+			free(entry);
+			return 0;
+		}
+	}
+	rte_spinlock_unlock(&mem_event_lock);
+
+	return -ENOENT;
+}
+
+void
+eal_mem_event_notify(enum rte_mem_event event, const struct rte_memseg *ms)
+{
+	struct mem_event_callback *entry;
+
+	rte_spinlock_lock(&mem_event_lock);
+	TAILQ_FOREACH(entry, &mem_event_callback_list, next)
+		entry->cb(event, ms, entry->arg);
+	rte_spinlock_unlock(&mem_event_lock);
+}
+
+int
+rte_mem_sync(void)
+{
+	return rte_eal_memseg_hotplug_sync();
+}
+
 static int
 rte_eal_memdevice_init(void)
 {
@@ -364,6 +364,10 @@ rte_memzone_lookup(const char *name)
 
 	rte_rwlock_read_unlock(&mcfg->mlock);
 
+	/* the memzone may be in a memseg the primary process just added */
+	if (memzone != NULL && rte_mem_sync() < 0)
+		return NULL;
+
 	return memzone;
 }
 
@@ -80,8 +80,10 @@ eal_long_options[] = {
 	{OPT_HUGE_DIR,          1, NULL, OPT_HUGE_DIR_NUM         },
 	{OPT_HUGE_UNLINK,       0, NULL, OPT_HUGE_UNLINK_NUM      },
 	{OPT_LCORES,            1, NULL, OPT_LCORES_NUM           },
+	{OPT_LOG_ASYNC,         0, NULL, OPT_LOG_ASYNC_NUM        },
 	{OPT_LOG_LEVEL,         1, NULL, OPT_LOG_LEVEL_NUM        },
 	{OPT_MASTER_LCORE,      1, NULL, OPT_MASTER_LCORE_NUM     },
+	{OPT_MEM_HOTPLUG,       0, NULL, OPT_MEM_HOTPLUG_NUM      },
 	{OPT_NO_HPET,           0, NULL, OPT_NO_HPET_NUM          },
 	{OPT_NO_HUGE,           0, NULL, OPT_NO_HUGE_NUM          },
 	{OPT_NO_PCI,            0, NULL, OPT_NO_PCI_NUM           },
@@ -140,8 +142,10 @@ eal_reset_internal_config(struct internal_config *internal_cfg)
 	internal_cfg->syslog_facility = LOG_DAEMON;
 	/* default value from build option */
 	internal_cfg->log_level = RTE_LOG_LEVEL;
+	internal_cfg->log_async = 0;
 
 	internal_cfg->xen_dom0_support = 0;
+	internal_cfg->mem_hotplug = 0;
 
 	/* if set to NONE, interrupt mode is determined automatically */
 	internal_cfg->vfio_intr_mode = RTE_INTR_MODE_NONE;
@@ -889,6 +893,10 @@ eal_parse_common_option(int opt, const char *optarg,
 		conf->log_level = log;
 		break;
 	}
+	case OPT_LOG_ASYNC_NUM:
+		conf->log_async = 1;
+		break;
+
 	case OPT_LCORES_NUM:
 		if (eal_parse_lcores(optarg) < 0) {
 			RTE_LOG(ERR, EAL, "invalid parameter for --"
@@ -1011,6 +1019,7 @@ eal_common_usage(void)
 	       "  --"OPT_PROC_TYPE"         Type of this process (primary|secondary|auto)\n"
 	       "  --"OPT_SYSLOG"            Set syslog facility\n"
 	       "  --"OPT_LOG_LEVEL"         Set default log level\n"
+	       "  --"OPT_LOG_ASYNC"         Write logs of lcores from a dedicated thread\n"
 	       "  -v                  Display version information on startup\n"
 	       "  -h, --help          This help\n"
 	       "\nEAL options for DEBUG use only:\n"
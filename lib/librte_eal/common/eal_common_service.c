@@ -0,0 +1,442 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#include <rte_common.h>
+#include <rte_cycles.h>
+#include <rte_atomic.h>
+#include <rte_spinlock.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_log.h>
+#include <rte_memory.h>
+#include <rte_service.h>
+
+#if RTE_SERVICE_MAX > 64
+#error "RTE_SERVICE_MAX must not exceed 64, the size of a service mask"
+#endif
+
+struct rte_service {
+	struct rte_service_spec spec;
+	uint32_t in_use;
+	volatile uint32_t runstate;
+	rte_atomic32_t execute_lock;
+	rte_atomic32_t nb_lcores;      /* number of lcores mapped */
+} __rte_cache_aligned;
+
+struct service_lcore {
+	volatile uint64_t service_mask; /* services mapped to this lcore */
+	volatile uint32_t runstate;
+	uint32_t is_service_lcore;
+	volatile uint32_t current;      /* service being run + 1, or 0 */
+	uint64_t calls[RTE_SERVICE_MAX];
+	uint64_t cycles[RTE_SERVICE_MAX];
+} __rte_cache_aligned;
+
+static struct rte_service services[RTE_SERVICE_MAX];
+static struct service_lcore service_lcores[RTE_MAX_LCORE];
+
+/* serializes the control path, the data path is lockless */
+static rte_spinlock_t service_lock = RTE_SPINLOCK_INITIALIZER;
+
+static inline struct rte_service *
+service_get(uint32_t id)
+{
+	if (id >= RTE_SERVICE_MAX || !services[id].in_use)
+		return NULL;
+	return &services[id];
+}
+
+static inline int
+service_lcore_valid(uint32_t lcore_id)
+{
+	return lcore_id < RTE_MAX_LCORE &&
+		service_lcores[lcore_id].is_service_lcore;
+}
+
+/* run a service once on the calling lcore */
+static inline int
+service_run(uint32_t id, struct service_lcore *sl, int need_lock)
+{
+	struct rte_service *s = &services[id];
+	uint64_t start;
+
+	/* published before reading the runstate, see rte_service_unregister() */
+	sl->current = id + 1;
+	rte_mb();
+	if (s->runstate == 0) {
+		sl->current = 0;
+		return -ENOEXEC;
+	}
+	if (need_lock && !rte_atomic32_test_and_set(&s->execute_lock)) {
+		sl->current = 0;
+		return -EBUSY;
+	}
+
+	start = rte_rdtsc();
+	s->spec.callback(s->spec.callback_userdata);
+	sl->cycles[id] += rte_rdtsc() - start;
+	sl->calls[id]++;
+
+	if (need_lock)
+		rte_atomic32_clear(&s->execute_lock);
+	sl->current = 0;
+	return 0;
+}
+
+/*
+ * A non MT safe service is always locked: it can be run by an application
+ * lcore at any time, besides its service lcores.
+ */
+static inline int
+service_need_lock(uint32_t id)
+{
+	return !(services[id].spec.capabilities & RTE_SERVICE_CAP_MT_SAFE);
+}
+
+static int
+service_runner(__attribute__((unused)) void *arg)
+{
+	struct service_lcore *sl = &service_lcores[rte_lcore_id()];
+	uint64_t mask;
+	uint32_t id;
+
+	while (sl->runstate) {
+		mask = sl->service_mask;
+		while (mask != 0) {
+			id = __builtin_ctzll(mask);
+			mask &= mask - 1;
+			service_run(id, sl, service_need_lock(id));
+		}
+	}
+	return 0;
+}
+
+int
+rte_service_register(const struct rte_service_spec *spec,
+		uint32_t *service_id)
+{
+	uint32_t i, free_id = RTE_SERVICE_MAX;
+	int ret = 0;
+
+	if (spec == NULL || spec->callback == NULL ||
+			strnlen(spec->name, RTE_SERVICE_NAME_MAX) == 0 ||
+			strnlen(spec->name, RTE_SERVICE_NAME_MAX) ==
+				RTE_SERVICE_NAME_MAX)
+		return -EINVAL;
+
+	rte_spinlock_lock(&service_lock);
+	for (i = 0; i < RTE_SERVICE_MAX; i++) {
+		if (!services[i].in_use) {
+			if (free_id == RTE_SERVICE_MAX)
+				free_id = i;
+		} else if (strcmp(services[i].spec.name, spec->name) == 0) {
+			ret = -EEXIST;
+			goto out;
+		}
+	}
+	if (free_id == RTE_SERVICE_MAX) {
+		ret = -ENOSPC;
+		goto out;
+	}
+
+	for (i = 0; i < RTE_MAX_LCORE; i++) {
+		service_lcores[i].calls[free_id] = 0;
+		service_lcores[i].cycles[free_id] = 0;
+	}
+	memset(&services[free_id], 0, sizeof(services[free_id]));
+	services[free_id].spec = *spec;
+	rte_atomic32_init(&services[free_id].execute_lock);
+	rte_atomic32_init(&services[free_id].nb_lcores);
+	services[free_id].in_use = 1;
+	if (service_id != NULL)
+		*service_id = free_id;
+out:
+	rte_spinlock_unlock(&service_lock);
+	return ret;
+}
+
+int
+rte_service_unregister(uint32_t service_id)
+{
+	struct rte_service *s;
+	uint64_t bit = 1ULL << service_id;
+	unsigned lcore_id;
+	int ret = 0;
+
+	rte_spinlock_lock(&service_lock);
+	s = service_get(service_id);
+	if (s == NULL) {
+		ret = -EINVAL;
+		goto out;
+	}
+	if (s->runstate) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++)
+		service_lcores[lcore_id].service_mask &= ~bit;
+	rte_mb();
+	/* wait for the lcores which may have read the old runstate */
+	for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++)
+		while (service_lcores[lcore_id].current == service_id + 1)
+			rte_pause();
+
+	s->in_use = 0;
+out:
+	rte_spinlock_unlock(&service_lock);
+	return ret;
+}
+
+int
+rte_service_get_by_name(const char *name, uint32_t *service_id)
+{
+	uint32_t i;
+
+	if (name == NULL || service_id == NULL)
+		return -EINVAL;
+
+	for (i = 0; i < RTE_SERVICE_MAX; i++) {
+		if (services[i].in_use &&
+				strcmp(services[i].spec.name, name) == 0) {
+			*service_id = i;
+			return 0;
+		}
+	}
+	return -ENOENT;
+}
+
+const char *
+rte_service_get_name(uint32_t service_id)
+{
+	struct rte_service *s = service_get(service_id);
+
+	return s != NULL ? s->spec.name : NULL;
+}
+
+int
+rte_service_runstate_set(uint32_t service_id, uint32_t runstate)
+{
+	struct rte_service *s = service_get(service_id);
+
+	if (s == NULL)
+		return -EINVAL;
+
+	s->runstate = !!runstate;
+	return 0;
+}
+
+int
+rte_service_map_lcore_set(uint32_t service_id, uint32_t lcore_id,
+		uint32_t enable)
+{
+	struct service_lcore *sl;
+	struct rte_service *s;
+	uint64_t bit = 1ULL << service_id;
+	int ret = 0;
+
+	rte_spinlock_lock(&service_lock);
+	s = service_get(service_id);
+	if (s == NULL || !service_lcore_valid(lcore_id)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	sl = &service_lcores[lcore_id];
+	if (enable && !(sl->service_mask & bit)) {
+		sl->service_mask |= bit;
+		rte_atomic32_inc(&s->nb_lcores);
+	} else if (!enable && (sl->service_mask & bit)) {
+		sl->service_mask &= ~bit;
+		rte_atomic32_dec(&s->nb_lcores);
+	}
+out:
+	rte_spinlock_unlock(&service_lock);
+	return ret;
+}
+
+int
+rte_service_lcore_add(uint32_t lcore_id)
+{
+	struct service_lcore *sl;
+	int ret = 0;
+
+	if (lcore_id >= RTE_MAX_LCORE || !rte_lcore_is_enabled(lcore_id) ||
+			lcore_id == rte_get_master_lcore())
+		return -EINVAL;
+
+	rte_spinlock_lock(&service_lock);
+	sl = &service_lcores[lcore_id];
+	if (sl->is_service_lcore) {
+		ret = -EALREADY;
+	} else {
+		sl->service_mask = 0;
+		sl->runstate = 0;
+		sl->is_service_lcore = 1;
+	}
+	rte_spinlock_unlock(&service_lock);
+	return ret;
+}
+
+int
+rte_service_lcore_del(uint32_t lcore_id)
+{
+	struct service_lcore *sl;
+	uint64_t mask;
+	uint32_t id;
+	int ret = 0;
+
+	rte_spinlock_lock(&service_lock);
+	if (!service_lcore_valid(lcore_id)) {
+		ret = -EINVAL;
+		goto out;
+	}
+	sl = &service_lcores[lcore_id];
+	if (sl->runstate) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	for (mask = sl->service_mask; mask != 0; mask &= mask - 1) {
+		id = __builtin_ctzll(mask);
+		rte_atomic32_dec(&services[id].nb_lcores);
+	}
+	sl->service_mask = 0;
+	sl->is_service_lcore = 0;
+out:
+	rte_spinlock_unlock(&service_lock);
+	return ret;
+}
+
+int
+rte_service_lcore_start(uint32_t lcore_id)
+{
+	struct service_lcore *sl;
+	int ret;
+
+	if (!service_lcore_valid(lcore_id))
+		return -EINVAL;
+	sl = &service_lcores[lcore_id];
+	if (sl->runstate || rte_eal_get_lcore_state(lcore_id) != WAIT)
+		return -EBUSY;
+
+	sl->runstate = 1;
+	rte_mb();
+	ret = rte_eal_remote_launch(service_runner, NULL, lcore_id);
+	if (ret < 0)
+		sl->runstate = 0;
+	return ret;
+}
+
+int
+rte_service_lcore_stop(uint32_t lcore_id)
+{
+	struct service_lcore *sl;
+
+	if (!service_lcore_valid(lcore_id))
+		return -EINVAL;
+	sl = &service_lcores[lcore_id];
+	if (!sl->runstate)
+		return -EALREADY;
+
+	sl->runstate = 0;
+	rte_eal_wait_lcore(lcore_id);
+	return 0;
+}
+
+int
+rte_service_run_iter_on_app_lcore(uint32_t service_id)
+{
+	struct rte_service *s = service_get(service_id);
+	unsigned lcore_id = rte_lcore_id();
+
+	if (s == NULL || lcore_id >= RTE_MAX_LCORE)
+		return -EINVAL;
+
+	return service_run(service_id, &service_lcores[lcore_id],
+			service_need_lock(service_id));
+}
+
+int
+rte_service_get_stats(uint32_t service_id, struct rte_service_stats *stats)
+{
+	unsigned lcore_id;
+
+	if (service_get(service_id) == NULL || stats == NULL)
+		return -EINVAL;
+
+	memset(stats, 0, sizeof(*stats));
+	for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+		stats->calls += service_lcores[lcore_id].calls[service_id];
+		stats->cycles += service_lcores[lcore_id].cycles[service_id];
+	}
+	return 0;
+}
+
+void
+rte_service_dump(FILE *f)
+{
+	struct rte_service_stats stats;
+	struct service_lcore *sl;
+	unsigned lcore_id;
+	uint32_t id;
+
+	fprintf(f, "Services:\n");
+	for (id = 0; id < RTE_SERVICE_MAX; id++) {
+		if (rte_service_get_stats(id, &stats) < 0)
+			continue;
+		fprintf(f, "  %u: %s, %s, %d lcores, calls=%"PRIu64
+			", cycles=%"PRIu64", cycles/call=%"PRIu64"\n",
+			id, services[id].spec.name,
+			services[id].runstate ? "started" : "stopped",
+			rte_atomic32_read(&services[id].nb_lcores),
+			stats.calls, stats.cycles,
+			stats.calls ? stats.cycles / stats.calls : 0);
+	}
+
+	fprintf(f, "Service lcores:\n");
+	for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+		sl = &service_lcores[lcore_id];
+		if (!sl->is_service_lcore)
+			continue;
+		fprintf(f, "  %u: %s, service mask=0x%"PRIx64"\n", lcore_id,
+			sl->runstate ? "running" : "stopped",
+			sl->service_mask);
+	}
+}
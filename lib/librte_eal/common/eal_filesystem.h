@@ -97,6 +97,19 @@ eal_get_hugefile_path(char *buffer, size_t buflen, const char *hugedir, int f_id
 	return buffer;
 }
 
+/** String format for files backing memory hot-plugged at run-time. */
+#define HOTPLUG_HUGEFILE_FMT "%s/%smap_hp_%d"
+
+static inline const char *
+eal_get_hugefile_hotplug_path(char *buffer, size_t buflen, const char *hugedir,
+		int ms_id)
+{
+	snprintf(buffer, buflen, HOTPLUG_HUGEFILE_FMT, hugedir,
+			internal_config.hugefile_prefix, ms_id);
+	buffer[buflen - 1] = '\0';
+	return buffer;
+}
+
 #ifdef RTE_EAL_SINGLE_FILE_SEGMENTS
 static inline const char *
 eal_get_hugefile_temp_path(char *buffer, size_t buflen, const char *hugedir, int f_id)
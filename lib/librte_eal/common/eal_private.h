@@ -35,6 +35,7 @@
 #define _EAL_PRIVATE_H_
 
 #include <stdio.h>
+#include <rte_memory.h>
 #include <rte_pci.h>
 
 /**
@@ -353,4 +354,53 @@ int rte_eal_hugepage_init(void);
  */
 int rte_eal_hugepage_attach(void);
 
+/**
+ * Map a new physically contiguous memory segment of at least len bytes
+ * on the given socket, backed by pages of size hugepage_sz (any size if
+ * 0). Only available in the primary process with --mem-hotplug.
+ *
+ * This function is private to the EAL.
+ *
+ * @return
+ *   The new memory segment, or NULL if no memory could be added.
+ */
+struct rte_memseg *rte_eal_memseg_hotplug_add(int socket_id, size_t len,
+		uint64_t hugepage_sz);
+
+/**
+ * Release a memory segment added with rte_eal_memseg_hotplug_add(), from
+ * the primary or a secondary process. Nothing may use its memory anymore.
+ *
+ * This function is private to the EAL.
+ *
+ * @return
+ *   0 on success, negative on error.
+ */
+int rte_eal_memseg_hotplug_del(const struct rte_memseg *ms);
+
+/**
+ * Tell if a memory segment was added with rte_eal_memseg_hotplug_add().
+ *
+ * This function is private to the EAL.
+ */
+int rte_eal_memseg_is_hotplug(const struct rte_memseg *ms);
+
+/**
+ * Replay the memory segment changes done by the other processes.
+ *
+ * This function is private to the EAL.
+ *
+ * @return
+ *   0 on success, negative on error.
+ */
+int rte_eal_memseg_hotplug_sync(void);
+
+/**
+ * Call the registered memory event callbacks.
+ *
+ * This function is private to the EAL.
+ */
+void eal_mem_event_notify(enum rte_mem_event event,
+		const struct rte_memseg *ms);
+
 #endif /* _EAL_PRIVATE_H_ */
@@ -44,6 +44,17 @@
 extern "C" {
 #endif
 
+/** Maximum length of the path of a hot-plugged memseg backing file. */
+#define RTE_MEMSEG_HOTPLUG_PATH_LEN 256
+
+/**
+ * Per-memseg information about memory hot-plugged at run-time.
+ */
+struct rte_memseg_hotplug {
+	uint32_t gen;  /**< Generation it was added at, 0 if not hot-plugged. */
+	char filepath[RTE_MEMSEG_HOTPLUG_PATH_LEN]; /**< Backing file. */
+} __attribute__((__packed__));
+
 /**
  * the structure for the memory configuration for the RTE.
  * Used by the rte_config structure. It is separated out, as for multi-process
@@ -66,6 +77,7 @@ struct rte_mem_config {
 	rte_rwlock_t mlock;   /**< only used by memzone LIB for thread-safe. */
 	rte_rwlock_t qlock;   /**< used for tailq operation for thread safe. */
 	rte_rwlock_t mplock;  /**< only used by mempool LIB for thread-safe. */
+	rte_rwlock_t memseg_lock; /**< Protects run-time memseg changes. */
 
 	uint32_t memzone_cnt; /**< Number of allocated memzones */
 
@@ -82,6 +94,19 @@ struct rte_mem_config {
 	 * exact same address the primary process maps it.
 	 */
 	uint64_t mem_cfg_addr;
+
+	/* memory hotplug: memseg[] changes at run-time are done holding
+	 * memseg_lock for writing and bump memseg_gen, so that the other
+	 * processes can notice them cheaply and replay them.
+	 */
+	volatile uint32_t memseg_gen;    /**< Incremented on each change. */
+	struct rte_memseg_hotplug memseg_hotplug[RTE_MAX_MEMSEG];
+
+	/* allocation statistics by rte_malloc() type string */
+	rte_spinlock_t malloc_type_lock; /**< Serializes new types. */
+	volatile uint32_t malloc_type_count; /**< Number of types. */
+	uint32_t malloc_type_hash[RTE_MALLOC_MAX_TYPES]; /**< Name hashes. */
+	struct malloc_type malloc_types[RTE_MALLOC_MAX_TYPES];
 } __attribute__((__packed__));
 
 
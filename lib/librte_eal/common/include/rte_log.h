@@ -79,6 +79,9 @@ extern struct rte_logs rte_logs;
 #define RTE_LOGTYPE_PIPELINE 0x00008000 /**< Log related to pipeline. */
 #define RTE_LOGTYPE_MBUF    0x00010000 /**< Log related to mbuf. */
 #define RTE_LOGTYPE_CRYPTODEV 0x00020000 /**< Log related to cryptodev. */
+#define RTE_LOGTYPE_METRICS 0x00040000 /**< Log related to metrics. */
+#define RTE_LOGTYPE_PDUMP   0x00080000 /**< Log related to pdump. */
+#define RTE_LOGTYPE_LATENCY 0x00100000 /**< Log related to latency stats. */
 
 /* these log types can be used in an application */
 #define RTE_LOGTYPE_USER1   0x01000000 /**< User-defined log type 1. */
@@ -211,6 +214,70 @@ void rte_log_dump_history(FILE *f);
  */
 int rte_log_add_in_history(const char *buf, size_t size);
 
+/**
+ * Enable or disable the asynchronous logging (disabled by default, see
+ * also the --log-async EAL option).
+ *
+ * When enabled, the messages logged by the EAL lcores are formatted into
+ * a per-lcore lock-free queue, which a dedicated thread empties into the
+ * log stream, so that logging never blocks the lcores on I/O. Messages
+ * longer than RTE_LOG_ASYNC_MSG_SIZE are truncated, and messages logged
+ * while the queue of an lcore is full are dropped and counted in
+ * rte_log_get_stats(). Messages of level RTE_LOG_CRIT and below, and the
+ * ones logged by non-EAL threads, are still written synchronously.
+ *
+ * When disabled, the pending messages are written before returning. This
+ * is also done on exit(), rte_exit() and rte_panic(). This function must
+ * not be called concurrently with itself.
+ *
+ * @param enable
+ *   true to enable, or 0 to disable asynchronous logging.
+ * @return
+ *   - 0: Success.
+ *   - (-ENOMEM) if the queues cannot be allocated.
+ *   - Other negative errno value if the log thread cannot be created.
+ */
+int rte_log_set_async(int enable);
+
+/**
+ * Limit the rate of the messages of some log types at a given level.
+ *
+ * At most burst messages of each of these log types and of this level
+ * are logged per period, the next ones are dropped and counted in
+ * rte_log_get_stats().
+ *
+ * @param logtype
+ *   Bitfield of the log types to limit, for example, RTE_LOGTYPE_PMD.
+ * @param level
+ *   Log level. A value between RTE_LOG_EMERG (1) and RTE_LOG_DEBUG (8).
+ * @param burst
+ *   Maximum number of messages per period, or 0 to remove the limit.
+ * @param period_ms
+ *   Period in milliseconds.
+ * @return
+ *   - 0: Success.
+ *   - (-EINVAL) on invalid parameters.
+ */
+int rte_log_set_rate_limit(uint32_t logtype, uint32_t level,
+		unsigned burst, unsigned period_ms);
+
+/**
+ * Log statistics.
+ */
+struct rte_log_stats {
+	uint64_t queued;       /**< Messages queued for asynchronous logging. */
+	uint64_t dropped;      /**< Messages dropped on full queues. */
+	uint64_t rate_limited; /**< Messages dropped by rate limiting. */
+};
+
+/**
+ * Get the log statistics.
+ *
+ * @param stats
+ *   A pointer to a structure filled with the statistics.
+ */
+void rte_log_get_stats(struct rte_log_stats *stats);
+
 /**
  * Generates a log message.
  *
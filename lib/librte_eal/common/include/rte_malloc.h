@@ -42,7 +42,9 @@
 
 #include <stdio.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <rte_memory.h>
+#include <rte_malloc_heap.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -60,6 +62,37 @@ struct rte_malloc_socket_stats {
 	size_t heap_allocsz_bytes; /**< Total allocated bytes on heap */
 };
 
+/** Number of buckets of the free block size histogram of a heap. */
+#define RTE_MALLOC_FREE_HIST_SIZE 24
+
+/**
+ *  Structure to hold the fragmentation statistics of a heap.
+ */
+struct rte_malloc_socket_frag_stats {
+	size_t heap_freesz_bytes;  /**< Total free bytes on heap */
+	size_t greatest_free_size; /**< Size in bytes of largest free block */
+	unsigned free_count;       /**< Number of free elements on heap */
+	/**
+	 * Number of free blocks by size: bucket i counts the blocks of
+	 * [RTE_CACHE_LINE_SIZE << i, RTE_CACHE_LINE_SIZE << (i + 1)) bytes,
+	 * the last bucket also counts all the bigger blocks.
+	 */
+	unsigned free_hist[RTE_MALLOC_FREE_HIST_SIZE];
+	/** Free bytes in the blocks of each bucket of free_hist. */
+	size_t free_hist_bytes[RTE_MALLOC_FREE_HIST_SIZE];
+};
+
+/**
+ *  Structure to hold the allocation statistics of a type string.
+ */
+struct rte_malloc_type_stats {
+	/** Type string given to rte_malloc() and co, "" for NULL. */
+	char name[RTE_MALLOC_TYPE_NAMESIZE];
+	uint64_t alloc_count;      /**< Number of allocations */
+	uint64_t free_count;       /**< Number of frees */
+	uint64_t alloc_bytes;      /**< Bytes currently allocated */
+};
+
 /**
  * This function allocates memory from the huge-page area of memory. The memory
  * is not cleared. In NUMA systems, the memory allocated resides on the same
@@ -256,6 +289,22 @@ rte_calloc_socket(const char *type, size_t num, size_t size, unsigned align, int
 void
 rte_free(void *ptr);
 
+/**
+ * Give back to their heap the memory blocks kept in the cache of the
+ * calling lcore.
+ *
+ * When CONFIG_RTE_MALLOC_LCORE_CACHE is enabled, small allocations
+ * (up to CONFIG_RTE_MALLOC_LCORE_CACHE_MAX_OBJ_SIZE bytes, with an alignment
+ * of at most a cache line) done by an lcore on its own socket are served
+ * from a per-lcore cache, and freeing them on the same lcore puts them back
+ * in this cache. Cached blocks are counted as allocated in the heap
+ * statistics, and are only returned to the heap by this function or when
+ * the cache overflows. Does nothing when the cache is disabled or when
+ * called from a non-EAL thread.
+ */
+void
+rte_malloc_lcore_cache_flush(void);
+
 /**
  * If malloc debug is enabled, check a memory block for header
  * and trailer markers to indicate that all is well with the block.
@@ -291,11 +340,50 @@ int
 rte_malloc_get_socket_stats(int socket,
 		struct rte_malloc_socket_stats *socket_stats);
 
+/**
+ * Get the fragmentation statistics of the specified heap: a histogram of
+ * its free block sizes and its largest free block.
+ *
+ * @param socket
+ *   The socket of the heap.
+ * @param stats
+ *   A structure which provides memory to store statistics
+ * @return
+ *   0 on success, -1 if the socket is invalid.
+ */
+int
+rte_malloc_get_socket_frag_stats(int socket,
+		struct rte_malloc_socket_frag_stats *stats);
+
+/**
+ * Get the allocation statistics by type string, the type argument of
+ * rte_malloc() and the other allocation functions. The first
+ * RTE_MALLOC_MAX_TYPES different strings are accounted, compared on their
+ * first RTE_MALLOC_TYPE_NAMESIZE - 1 characters. Blocks moved by
+ * rte_realloc() keep their type. Memzones are not accounted.
+ *
+ * The statistics are shared by all the processes, so a secondary process
+ * can monitor the allocations of the primary. They are only collected by
+ * the processes built with CONFIG_RTE_MALLOC_TYPE_STATS, as they cost a
+ * lookup and shared atomic updates on every allocation and free.
+ *
+ * @param stats
+ *   An array which provides memory to store the statistics.
+ * @param n
+ *   The size of the stats array.
+ * @return
+ *   The number of types accounted, which may be higher than n; only the
+ *   first n ones are stored in stats.
+ */
+int
+rte_malloc_get_type_stats(struct rte_malloc_type_stats *stats, unsigned n);
+
 /**
  * Dump statistics.
  *
- * Dump for the specified type to the console. If the type argument is
- * NULL, all memory types will be dumped.
+ * Dump the statistics of all the heaps, followed by the allocation
+ * statistics of the specified type. If the type argument is NULL, all
+ * memory types will be dumped.
  *
  * @param f
  *   A pointer to a file for output
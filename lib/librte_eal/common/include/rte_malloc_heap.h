@@ -37,6 +37,7 @@
 #include <stddef.h>
 #include <sys/queue.h>
 #include <rte_spinlock.h>
+#include <rte_atomic.h>
 #include <rte_memory.h>
 
 /* Number of free lists per heap, grouped by size. */
@@ -52,4 +53,20 @@ struct malloc_heap {
 	size_t total_size;
 } __rte_cache_aligned;
 
+/* Number of rte_malloc() type strings whose allocations are accounted. */
+#define RTE_MALLOC_MAX_TYPES 64
+
+/* Size of the accounted part of a type string, including the '\0'. */
+#define RTE_MALLOC_TYPE_NAMESIZE 32
+
+/**
+ * Structure to hold the allocation counters of a type string
+ */
+struct malloc_type {
+	char name[RTE_MALLOC_TYPE_NAMESIZE];
+	rte_atomic64_t alloc_count;
+	rte_atomic64_t free_count;
+	rte_atomic64_t alloc_bytes;
+} __rte_cache_aligned;
+
 #endif /* _RTE_MALLOC_HEAP_H_ */
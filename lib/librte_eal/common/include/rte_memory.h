@@ -181,6 +181,73 @@ unsigned rte_memory_get_nchannel(void);
  */
 unsigned rte_memory_get_nrank(void);
 
+/**
+ * Memory segment events, see rte_mem_event_callback_register().
+ */
+enum rte_mem_event {
+	RTE_MEM_EVENT_ADD, /**< A memory segment was mapped. */
+	RTE_MEM_EVENT_DEL, /**< A memory segment is about to be unmapped. */
+};
+
+/**
+ * Function called when a memory segment is hot-plugged or released.
+ *
+ * @param event
+ *   The event type.
+ * @param ms
+ *   The memory segment. On RTE_MEM_EVENT_DEL, its memory is still mapped
+ *   when the callback runs.
+ * @param arg
+ *   The opaque pointer given at registration.
+ */
+typedef void (*rte_mem_event_callback_t)(enum rte_mem_event event,
+		const struct rte_memseg *ms, void *arg);
+
+/**
+ * Register a function called each time the EAL adds or removes a memory
+ * segment at run-time (see the --mem-hotplug EAL option), e.g. to keep
+ * DMA mappings up to date. For the changes done by other processes, the
+ * callbacks run when the process catches up with them, see rte_mem_sync().
+ *
+ * The callbacks may be called with a heap lock held: they must not
+ * allocate or free memory from the DPDK heaps, nor register or unregister
+ * callbacks.
+ *
+ * @param cb
+ *   The callback function.
+ * @param arg
+ *   Opaque pointer passed to the callback.
+ * @return
+ *   0 on success, -EINVAL if cb is NULL, -EEXIST if already registered,
+ *   -ENOMEM on allocation failure.
+ */
+int rte_mem_event_callback_register(rte_mem_event_callback_t cb, void *arg);
+
+/**
+ * Unregister a callback registered with rte_mem_event_callback_register().
+ *
+ * @param cb
+ *   The callback function.
+ * @param arg
+ *   Opaque pointer given at registration.
+ * @return
+ *   0 on success, -ENOENT if the callback is not registered.
+ */
+int rte_mem_event_callback_unregister(rte_mem_event_callback_t cb, void *arg);
+
+/**
+ * Map the memory segments hot-plugged by the primary process and unmap
+ * the ones released by the other processes since the last call. This is
+ * done implicitly on allocation and memzone lookup, so it is only needed
+ * before touching memory received from another process, or in the primary
+ * process to run the RTE_MEM_EVENT_DEL callbacks of the memory segments
+ * freed by the secondary processes.
+ *
+ * @return
+ *   0 on success, negative on error.
+ */
+int rte_mem_sync(void);
+
 #ifdef RTE_LIBRTE_XEN_DOM0
 
 /**< Internal use only - should DOM0 memory mapping be used */
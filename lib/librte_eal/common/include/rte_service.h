@@ -0,0 +1,282 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _RTE_SERVICE_H_
+#define _RTE_SERVICE_H_
+
+/**
+ * @file
+ *
+ * RTE Service Cores
+ *
+ * Background work, such as timer management or statistics collection, can
+ * be registered as services. A service is a callback called repeatedly,
+ * in a run-to-completion loop, by the service lcores it is mapped to. A
+ * service lcore can run many services, and a service can be mapped to
+ * many service lcores, at most one of them running it at a time unless it
+ * is multi-thread safe. The lcores doing the data-plane processing are
+ * then freed from this housekeeping.
+ *
+ * The number of calls and the cycles spent in each service are counted
+ * per lcore.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifndef RTE_SERVICE_MAX
+/** Maximum number of services. */
+#define RTE_SERVICE_MAX 64
+#endif
+
+/** Maximum length of a service name, including the '\0'. */
+#define RTE_SERVICE_NAME_MAX 32
+
+/**
+ * The service callback can be called concurrently by several lcores.
+ * Otherwise, the service is run by only one lcore at a time, taking a lock
+ * on each call.
+ */
+#define RTE_SERVICE_CAP_MT_SAFE (1 << 0)
+
+/**
+ * Service callback, called repeatedly by the service lcores.
+ *
+ * @param args
+ *   The callback_userdata of the service specification.
+ * @return
+ *   0 if some work was done, a negative value otherwise (informative only).
+ */
+typedef int32_t (*rte_service_func)(void *args);
+
+/**
+ * Specification of a service.
+ */
+struct rte_service_spec {
+	char name[RTE_SERVICE_NAME_MAX]; /**< Unique name of the service. */
+	rte_service_func callback;       /**< Work function of the service. */
+	void *callback_userdata;         /**< Argument of the callback. */
+	uint32_t capabilities;           /**< RTE_SERVICE_CAP_* flags. */
+	int socket_id;                   /**< NUMA socket of the service. */
+};
+
+/**
+ * Statistics of a service, summed over all lcores.
+ */
+struct rte_service_stats {
+	uint64_t calls;  /**< Number of calls of the callback. */
+	uint64_t cycles; /**< TSC cycles spent in the callback. */
+};
+
+/**
+ * Register a new service. It is stopped and mapped to no lcore.
+ *
+ * @param spec
+ *   The specification of the service, copied.
+ * @param service_id
+ *   If not NULL, set to the identifier of the service.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if the specification is invalid.
+ *   - (-EEXIST) if a service with the same name already exists.
+ *   - (-ENOSPC) if RTE_SERVICE_MAX services are already registered.
+ */
+int rte_service_register(const struct rte_service_spec *spec,
+		uint32_t *service_id);
+
+/**
+ * Unregister a stopped service, unmapping it from all lcores. Waits until
+ * no lcore is still running it.
+ *
+ * @param service_id
+ *   The identifier of the service.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if the service does not exist.
+ *   - (-EBUSY) if the service is not stopped.
+ */
+int rte_service_unregister(uint32_t service_id);
+
+/**
+ * Find a service by name.
+ *
+ * @param name
+ *   The name of the service.
+ * @param service_id
+ *   Set to the identifier of the service.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if the arguments are invalid.
+ *   - (-ENOENT) if no service has this name.
+ */
+int rte_service_get_by_name(const char *name, uint32_t *service_id);
+
+/**
+ * Get the name of a service.
+ *
+ * @param service_id
+ *   The identifier of the service.
+ * @return
+ *   The name of the service, or NULL if it does not exist.
+ */
+const char *rte_service_get_name(uint32_t service_id);
+
+/**
+ * Start or stop a service. A stopped service is not run by the lcores it
+ * is mapped to.
+ *
+ * @param service_id
+ *   The identifier of the service.
+ * @param runstate
+ *   1 to start the service, 0 to stop it.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if the service does not exist.
+ */
+int rte_service_runstate_set(uint32_t service_id, uint32_t runstate);
+
+/**
+ * Map a service to a service lcore, or unmap it.
+ *
+ * @param service_id
+ *   The identifier of the service.
+ * @param lcore_id
+ *   The identifier of a service lcore.
+ * @param enable
+ *   1 to map the service to the lcore, 0 to unmap it.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if the service does not exist or the lcore is not a
+ *     service lcore.
+ */
+int rte_service_map_lcore_set(uint32_t service_id, uint32_t lcore_id,
+		uint32_t enable);
+
+/**
+ * Make an enabled slave lcore a service lcore.
+ *
+ * @param lcore_id
+ *   The identifier of the lcore.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if the lcore is not an enabled slave lcore.
+ *   - (-EALREADY) if the lcore is already a service lcore.
+ */
+int rte_service_lcore_add(uint32_t lcore_id);
+
+/**
+ * Make a stopped service lcore a normal lcore again, unmapping all its
+ * services.
+ *
+ * @param lcore_id
+ *   The identifier of the service lcore.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if the lcore is not a service lcore.
+ *   - (-EBUSY) if the lcore is running.
+ */
+int rte_service_lcore_del(uint32_t lcore_id);
+
+/**
+ * Launch the service loop on a service lcore, which must be waiting for
+ * work (see rte_eal_remote_launch()).
+ *
+ * @param lcore_id
+ *   The identifier of the service lcore.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if the lcore is not a service lcore.
+ *   - (-EBUSY) if the lcore is already running.
+ */
+int rte_service_lcore_start(uint32_t lcore_id);
+
+/**
+ * Stop the service loop of a service lcore, and wait for it to return.
+ *
+ * @param lcore_id
+ *   The identifier of the service lcore.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if the lcore is not a service lcore.
+ *   - (-EALREADY) if the lcore is not running.
+ */
+int rte_service_lcore_stop(uint32_t lcore_id);
+
+/**
+ * Run a started service once on the calling lcore, which does not need to
+ * be a service lcore. Can be used by an application without service
+ * lcores, or to run a service from its own main loop.
+ *
+ * @param service_id
+ *   The identifier of the service.
+ * @return
+ *   - 0 if the service was run.
+ *   - (-EINVAL) if the service does not exist or the calling thread is
+ *     not an lcore.
+ *   - (-ENOEXEC) if the service is stopped.
+ *   - (-EBUSY) if the service is not MT safe and is being run by another
+ *     lcore.
+ */
+int rte_service_run_iter_on_app_lcore(uint32_t service_id);
+
+/**
+ * Get the statistics of a service.
+ *
+ * @param service_id
+ *   The identifier of the service.
+ * @param stats
+ *   Filled with the statistics of the service.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if the service does not exist.
+ */
+int rte_service_get_stats(uint32_t service_id,
+		struct rte_service_stats *stats);
+
+/**
+ * Dump the services, their statistics and the service lcores.
+ *
+ * @param f
+ *   A pointer to a file for output.
+ */
+void rte_service_dump(FILE *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTE_SERVICE_H_ */
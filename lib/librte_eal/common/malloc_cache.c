@@ -0,0 +1,206 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <rte_memory.h>
+#include <rte_eal.h>
+#include <rte_eal_memconfig.h>
+#include <rte_lcore.h>
+#include <rte_common.h>
+#include <rte_branch_prediction.h>
+#include <rte_debug.h>
+
+#include "malloc_elem.h"
+#include "malloc_heap.h"
+#include "malloc_cache.h"
+
+/*
+ * Per-lcore cache of small blocks, in front of the heap of the lcore
+ * socket. Blocks are sorted in power of 2 size classes, from one cache
+ * line to RTE_MALLOC_LCORE_CACHE_MAX_OBJ_SIZE. An empty class is refilled
+ * with half of its capacity in one heap lock, a full class gives back half
+ * of its blocks the same way.
+ *
+ * Cached blocks stay allocated from the heap point of view (they are
+ * counted as such in the heap statistics), with the ELEM_CACHED state.
+ */
+
+#define MALLOC_CACHE_MAX_CLASSES 16
+
+#define MALLOC_CACHE_BULK (RTE_MALLOC_LCORE_CACHE_SIZE / 2)
+
+#if RTE_MALLOC_LCORE_CACHE_SIZE < 2
+#error "RTE_MALLOC_LCORE_CACHE_SIZE must be at least 2"
+#endif
+
+#if RTE_MALLOC_LCORE_CACHE_MAX_OBJ_SIZE > \
+	(RTE_CACHE_LINE_SIZE << (MALLOC_CACHE_MAX_CLASSES - 1))
+#error "RTE_MALLOC_LCORE_CACHE_MAX_OBJ_SIZE is too big"
+#endif
+
+struct malloc_cache_class {
+	unsigned len;
+	struct malloc_elem *elems[RTE_MALLOC_LCORE_CACHE_SIZE];
+};
+
+struct malloc_lcore_cache {
+	struct malloc_cache_class classes[MALLOC_CACHE_MAX_CLASSES];
+} __rte_cache_aligned;
+
+static struct malloc_lcore_cache lcore_caches[RTE_MAX_LCORE];
+
+/* return the size class of a block, or -1 if it is too big */
+static inline int
+malloc_cache_class(size_t size)
+{
+	size_t class_size = RTE_CACHE_LINE_SIZE;
+	int cls = 0;
+
+	if (size > RTE_MALLOC_LCORE_CACHE_MAX_OBJ_SIZE)
+		return -1;
+	while (class_size < size) {
+		class_size <<= 1;
+		cls++;
+	}
+	return cls;
+}
+
+/* return the heap served by the cache of the calling lcore, or NULL */
+static inline struct malloc_heap *
+malloc_cache_heap(void)
+{
+	struct rte_mem_config *mcfg = rte_eal_get_configuration()->mem_config;
+	unsigned socket = rte_socket_id();
+
+	if (rte_lcore_id() >= RTE_MAX_LCORE || socket >= RTE_MAX_NUMA_NODES)
+		return NULL;
+	return &mcfg->malloc_heaps[socket];
+}
+
+/* give back to the heap the n coldest blocks of a class */
+static void
+malloc_cache_drain(struct malloc_cache_class *c, unsigned n)
+{
+	unsigned i;
+
+	for (i = 0; i < n; i++)
+		c->elems[i]->state = ELEM_BUSY;
+	if (malloc_elem_free_bulk(c->elems, n) < 0)
+		rte_panic("Fatal error: Invalid memory in lcore cache\n");
+
+	c->len -= n;
+	memmove(c->elems, &c->elems[n], c->len * sizeof(c->elems[0]));
+}
+
+void *
+malloc_cache_alloc(int socket, size_t size, unsigned align)
+{
+	struct malloc_heap *heap = malloc_cache_heap();
+	struct malloc_cache_class *c;
+	struct malloc_elem *elem;
+	unsigned i, n;
+	int cls;
+
+	if (heap == NULL || socket != (int)rte_socket_id() ||
+			align > RTE_CACHE_LINE_SIZE)
+		return NULL;
+	cls = malloc_cache_class(size);
+	if (cls < 0)
+		return NULL;
+
+	c = &lcore_caches[rte_lcore_id()].classes[cls];
+	if (unlikely(c->len == 0)) {
+		n = malloc_heap_alloc_bulk(heap, RTE_CACHE_LINE_SIZE << cls,
+				RTE_CACHE_LINE_SIZE, (void **)c->elems,
+				MALLOC_CACHE_BULK);
+		/* the heap returns data pointers */
+		for (i = 0; i < n; i++) {
+			c->elems[i] = malloc_elem_from_data(c->elems[i]);
+			c->elems[i]->state = ELEM_CACHED;
+		}
+		c->len = n;
+		if (n == 0)
+			return NULL;
+	}
+
+	elem = c->elems[--c->len];
+	elem->state = ELEM_BUSY;
+	/* data follows the padding, if the heap had to add some */
+	return RTE_PTR_ADD(&elem[1], elem->pad);
+}
+
+int
+malloc_cache_free(struct malloc_elem *elem)
+{
+	struct malloc_heap *heap = malloc_cache_heap();
+	struct malloc_cache_class *c;
+	size_t size;
+	int cls;
+
+	if (heap == NULL || elem == NULL || elem->heap != heap ||
+			elem->state != ELEM_BUSY || elem->pad != 0)
+		return -1;
+
+	/* only blocks of exactly a class size, as allocated by the cache */
+	size = elem->size - MALLOC_ELEM_OVERHEAD;
+	cls = malloc_cache_class(size);
+	if (cls < 0 || (size_t)(RTE_CACHE_LINE_SIZE << cls) != size)
+		return -1;
+
+	c = &lcore_caches[rte_lcore_id()].classes[cls];
+	if (unlikely(c->len == RTE_MALLOC_LCORE_CACHE_SIZE))
+		malloc_cache_drain(c, MALLOC_CACHE_BULK);
+
+	elem->state = ELEM_CACHED;
+	c->elems[c->len++] = elem;
+	return 0;
+}
+
+void
+malloc_cache_flush(void)
+{
+	struct malloc_lcore_cache *cache;
+	unsigned cls;
+
+	if (malloc_cache_heap() == NULL)
+		return;
+
+	cache = &lcore_caches[rte_lcore_id()];
+	for (cls = 0; cls < MALLOC_CACHE_MAX_CLASSES; cls++)
+		if (cache->classes[cls].len != 0)
+			malloc_cache_drain(&cache->classes[cls],
+					cache->classes[cls].len);
+}
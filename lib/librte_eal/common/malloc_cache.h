@@ -0,0 +1,96 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MALLOC_CACHE_H_
+#define MALLOC_CACHE_H_
+
+#include <stddef.h>
+
+#include "malloc_elem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef RTE_MALLOC_LCORE_CACHE
+
+/*
+ * Allocate a block of size bytes from the cache of the calling lcore, if
+ * the request can be served by it: EAL thread, local socket, small size and
+ * alignment. Returns NULL otherwise, or if the heap is exhausted.
+ */
+void *
+malloc_cache_alloc(int socket, size_t size, unsigned align);
+
+/*
+ * Put an element in the cache of the calling lcore instead of giving it
+ * back to its heap. Returns 0 on success, -1 if the element must be freed
+ * to its heap.
+ */
+int
+malloc_cache_free(struct malloc_elem *elem);
+
+/*
+ * Give all the elements in the cache of the calling lcore back to their
+ * heap.
+ */
+void
+malloc_cache_flush(void);
+
+#else
+
+static inline void *
+malloc_cache_alloc(int socket __rte_unused, size_t size __rte_unused,
+		unsigned align __rte_unused)
+{
+	return NULL;
+}
+
+static inline int
+malloc_cache_free(struct malloc_elem *elem __rte_unused)
+{
+	return -1;
+}
+
+static inline void
+malloc_cache_flush(void)
+{
+}
+
+#endif /* RTE_MALLOC_LCORE_CACHE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MALLOC_CACHE_H_ */
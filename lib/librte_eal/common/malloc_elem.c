@@ -62,6 +62,7 @@ malloc_elem_init(struct malloc_elem *elem,
 	elem->prev = NULL;
 	memset(&elem->free_list, 0, sizeof(elem->free_list));
 	elem->state = ELEM_FREE;
+	elem->type = 0;
 	elem->size = size;
 	elem->pad = 0;
 	set_header(elem);
@@ -190,8 +191,8 @@ malloc_elem_free_list_insert(struct malloc_elem *elem)
 /*
  * Remove the specified element from its heap's free list.
  */
-static void
-elem_free_list_remove(struct malloc_elem *elem)
+void
+malloc_elem_free_list_remove(struct malloc_elem *elem)
 {
 	LIST_REMOVE(elem, free_list);
 }
@@ -211,7 +212,7 @@ malloc_elem_alloc(struct malloc_elem *elem, size_t size, unsigned align,
 	const size_t trailer_size = elem->size - old_elem_size - size -
 		MALLOC_ELEM_OVERHEAD;
 
-	elem_free_list_remove(elem);
+	malloc_elem_free_list_remove(elem);
 
 	if (trailer_size > MALLOC_ELEM_OVERHEAD + MIN_DATA_SIZE) {
 		/* split it, too much free space after elem */
@@ -266,19 +267,16 @@ join_elem(struct malloc_elem *elem1, struct malloc_elem *elem2)
 /*
  * free a malloc_elem block by adding it to the free list. If the
  * blocks either immediately before or immediately after newly freed block
- * are also free, the blocks are merged together.
+ * are also free, the blocks are merged together. Called with the heap lock
+ * held.
  */
-int
-malloc_elem_free(struct malloc_elem *elem)
+static void
+elem_free(struct malloc_elem *elem)
 {
-	if (!malloc_elem_cookies_ok(elem) || elem->state != ELEM_BUSY)
-		return -1;
-
-	rte_spinlock_lock(&(elem->heap->lock));
 	struct malloc_elem *next = RTE_PTR_ADD(elem, elem->size);
 	if (next->state == ELEM_FREE){
 		/* remove from free list, join to this one */
-		elem_free_list_remove(next);
+		malloc_elem_free_list_remove(next);
 		join_elem(elem, next);
 	}
 
@@ -286,9 +284,10 @@ malloc_elem_free(struct malloc_elem *elem)
 	 * need to re-insert in free list, as that element's size is changing
 	 */
 	if (elem->prev != NULL && elem->prev->state == ELEM_FREE) {
-		elem_free_list_remove(elem->prev);
+		malloc_elem_free_list_remove(elem->prev);
 		join_elem(elem->prev, elem);
 		malloc_elem_free_list_insert(elem->prev);
+		elem = elem->prev;
 	}
 	/* otherwise add ourselves to the free list */
 	else {
@@ -297,7 +296,51 @@ malloc_elem_free(struct malloc_elem *elem)
 	}
 	/* decrease heap's count of allocated elements */
 	elem->heap->alloc_count--;
-	rte_spinlock_unlock(&(elem->heap->lock));
+	/* hot-plugged memory is released as soon as it is unused */
+	malloc_heap_release_memseg(elem->heap, elem);
+}
+
+int
+malloc_elem_free(struct malloc_elem *elem)
+{
+	struct malloc_heap *heap;
+
+	if (!malloc_elem_cookies_ok(elem) || elem->state != ELEM_BUSY)
+		return -1;
+
+	/* elem is unmapped if its hot-plugged memseg gets released */
+	heap = elem->heap;
+	rte_spinlock_lock(&heap->lock);
+	elem_free(elem);
+	rte_spinlock_unlock(&heap->lock);
+
+	return 0;
+}
+
+/*
+ * free n blocks of the same heap, taking its lock only once.
+ */
+int
+malloc_elem_free_bulk(struct malloc_elem **elems, unsigned n)
+{
+	struct malloc_heap *heap;
+	unsigned i;
+
+	if (n == 0)
+		return 0;
+
+	for (i = 0; i < n; i++) {
+		if (!malloc_elem_cookies_ok(elems[i]) ||
+				elems[i]->state != ELEM_BUSY ||
+				elems[i]->heap != elems[0]->heap)
+			return -1;
+	}
+
+	heap = elems[0]->heap;
+	rte_spinlock_lock(&heap->lock);
+	for (i = 0; i < n; i++)
+		elem_free(elems[i]);
+	rte_spinlock_unlock(&heap->lock);
 
 	return 0;
 }
@@ -325,7 +368,7 @@ malloc_elem_resize(struct malloc_elem *elem, size_t size)
 	/* we now know the element fits, so remove from free list,
 	 * join the two
 	 */
-	elem_free_list_remove(next);
+	malloc_elem_free_list_remove(next);
 	join_elem(elem, next);
 
 	if (elem->size - new_size >= MIN_DATA_SIZE + MALLOC_ELEM_OVERHEAD){
@@ -42,7 +42,8 @@ struct malloc_heap;
 enum elem_state {
 	ELEM_FREE = 0,
 	ELEM_BUSY,
-	ELEM_PAD  /* element is a padding-only header */
+	ELEM_PAD,  /* element is a padding-only header */
+	ELEM_CACHED /* element is allocated and kept in an lcore cache */
 };
 
 struct malloc_elem {
@@ -50,7 +51,8 @@ struct malloc_elem {
 	struct malloc_elem *volatile prev;      /* points to prev elem in memseg */
 	LIST_ENTRY(malloc_elem) free_list;      /* list of free elements in heap */
 	const struct rte_memseg *ms;
-	volatile enum elem_state state;
+	volatile uint16_t state;                /* enum elem_state */
+	uint16_t type;                          /* type stats index + 1, or 0 */
 	uint32_t pad;
 	size_t size;
 #ifdef RTE_LIBRTE_MALLOC_DEBUG
@@ -170,6 +172,13 @@ malloc_elem_alloc(struct malloc_elem *elem, size_t size,
 int
 malloc_elem_free(struct malloc_elem *elem);
 
+/*
+ * free n malloc_elem blocks belonging to the same heap, taking its lock
+ * only once.
+ */
+int
+malloc_elem_free_bulk(struct malloc_elem **elems, unsigned n);
+
 /*
  * attempt to resize a malloc_elem by expanding into any free space
  * immediately after it in memory.
@@ -189,4 +198,10 @@ malloc_elem_free_list_index(size_t size);
 void
 malloc_elem_free_list_insert(struct malloc_elem *elem);
 
+/*
+ * Remove element from its heap's free list.
+ */
+void
+malloc_elem_free_list_remove(struct malloc_elem *elem);
+
 #endif /* MALLOC_ELEM_H_ */
@@ -34,6 +34,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <stdarg.h>
 #include <errno.h>
 #include <sys/queue.h>
@@ -50,6 +51,8 @@
 #include <rte_memcpy.h>
 #include <rte_atomic.h>
 
+#include "eal_private.h"
+#include "eal_internal_cfg.h"
 #include "malloc_elem.h"
 #include "malloc_heap.h"
 
@@ -145,11 +148,83 @@ find_suitable_element(struct malloc_heap *heap, size_t size,
 	return NULL;
 }
 
+/*
+ * Page size required by the memzone flags, 0 if any size will do.
+ */
+static uint64_t
+flags_to_hugepage_sz(unsigned flags)
+{
+	if (flags & RTE_MEMZONE_SIZE_HINT_ONLY)
+		return 0;
+	if (flags & RTE_MEMZONE_256KB)
+		return RTE_PGSIZE_256K;
+	if (flags & RTE_MEMZONE_2MB)
+		return RTE_PGSIZE_2M;
+	if (flags & RTE_MEMZONE_16MB)
+		return RTE_PGSIZE_16M;
+	if (flags & RTE_MEMZONE_256MB)
+		return RTE_PGSIZE_256M;
+	if (flags & RTE_MEMZONE_512MB)
+		return RTE_PGSIZE_512M;
+	if (flags & RTE_MEMZONE_1GB)
+		return RTE_PGSIZE_1G;
+	if (flags & RTE_MEMZONE_4GB)
+		return RTE_PGSIZE_4G;
+	if (flags & RTE_MEMZONE_16GB)
+		return RTE_PGSIZE_16G;
+	return 0;
+}
+
+/*
+ * Ask the EAL for a new memseg big enough for the request and add it to
+ * the heap. Called with the heap lock held.
+ */
+static struct malloc_elem *
+malloc_heap_grow(struct malloc_heap *heap, size_t size, unsigned flags,
+		size_t align, size_t bound)
+{
+	struct rte_mem_config *mcfg = rte_eal_get_configuration()->mem_config;
+	struct rte_memseg *ms;
+	size_t len;
+
+	/* data, its header and trailer, worst case padding, end element */
+	len = size + align + MALLOC_ELEM_OVERHEAD * 2 + RTE_CACHE_LINE_SIZE;
+	ms = rte_eal_memseg_hotplug_add(heap - mcfg->malloc_heaps, len,
+			flags_to_hugepage_sz(flags));
+	if (ms == NULL)
+		return NULL;
+
+	malloc_heap_add_memseg(heap, ms);
+	return find_suitable_element(heap, size, flags, align, bound);
+}
+
+/*
+ * Allocate one element from the heap, growing it if needed and possible.
+ * Called with the heap lock held.
+ */
+static struct malloc_elem *
+heap_alloc_elem(struct malloc_heap *heap, size_t size, unsigned flags,
+		size_t align, size_t bound)
+{
+	struct malloc_elem *elem;
+
+	elem = find_suitable_element(heap, size, flags, align, bound);
+	if (elem == NULL && internal_config.mem_hotplug &&
+			rte_eal_process_type() == RTE_PROC_PRIMARY)
+		elem = malloc_heap_grow(heap, size, flags, align, bound);
+	if (elem != NULL) {
+		elem = malloc_elem_alloc(elem, size, align, bound);
+		/* increase heap's count of allocated elements */
+		heap->alloc_count++;
+	}
+	return elem;
+}
+
 /*
  * Main function to allocate a block of memory from the heap.
  * It locks the free list, scans it, and adds a new memseg if the
- * scan fails. Once the new memseg is added, it re-scans and should return
- * the new element after releasing the lock.
+ * scan fails and memory hotplug is enabled. Once the new memseg is added,
+ * it re-scans and should return the new element after releasing the lock.
  */
 void *
 malloc_heap_alloc(struct malloc_heap *heap,
@@ -163,17 +238,75 @@ malloc_heap_alloc(struct malloc_heap *heap,
 
 	rte_spinlock_lock(&heap->lock);
 
-	elem = find_suitable_element(heap, size, flags, align, bound);
-	if (elem != NULL) {
-		elem = malloc_elem_alloc(elem, size, align, bound);
-		/* increase heap's count of allocated elements */
-		heap->alloc_count++;
+	/* free elements may be in memsegs the primary process just added */
+	if (rte_eal_process_type() == RTE_PROC_SECONDARY &&
+			rte_eal_memseg_hotplug_sync() < 0) {
+		rte_spinlock_unlock(&heap->lock);
+		return NULL;
 	}
+
+	elem = heap_alloc_elem(heap, size, flags, align, bound);
 	rte_spinlock_unlock(&heap->lock);
 
 	return elem == NULL ? NULL : (void *)(&elem[1]);
 }
 
+/*
+ * Allocate up to n blocks of the same size and alignment, taking the heap
+ * lock only once. Returns the number of blocks allocated, stored in objs.
+ */
+unsigned
+malloc_heap_alloc_bulk(struct malloc_heap *heap, size_t size, size_t align,
+		void **objs, unsigned n)
+{
+	struct malloc_elem *elem;
+	unsigned i = 0;
+
+	size = RTE_CACHE_LINE_ROUNDUP(size);
+	align = RTE_CACHE_LINE_ROUNDUP(align);
+
+	rte_spinlock_lock(&heap->lock);
+
+	if (rte_eal_process_type() == RTE_PROC_SECONDARY &&
+			rte_eal_memseg_hotplug_sync() < 0) {
+		rte_spinlock_unlock(&heap->lock);
+		return 0;
+	}
+
+	for (i = 0; i < n; i++) {
+		elem = heap_alloc_elem(heap, size, 0, align, 0);
+		if (elem == NULL)
+			break;
+		objs[i] = &elem[1];
+	}
+	rte_spinlock_unlock(&heap->lock);
+
+	return i;
+}
+
+/*
+ * Give a hot-plugged memseg back to the EAL once the heap does not use it
+ * anymore, i.e. it is made of a single free element. Called with the heap
+ * lock held, on the element that was just freed, by the primary or a
+ * secondary process (which may not have been given --mem-hotplug).
+ */
+void
+malloc_heap_release_memseg(struct malloc_heap *heap, struct malloc_elem *elem)
+{
+	struct malloc_elem *next = RTE_PTR_ADD(elem, elem->size);
+
+	if (rte_eal_process_type() == RTE_PROC_PRIMARY &&
+			!internal_config.mem_hotplug)
+		return;
+	if (elem->state != ELEM_FREE || elem->prev != NULL ||
+			next->size != 0 || !rte_eal_memseg_is_hotplug(elem->ms))
+		return;
+
+	malloc_elem_free_list_remove(elem);
+	heap->total_size -= elem->size;
+	rte_eal_memseg_hotplug_del(elem->ms);
+}
+
 /*
  * Function to retrieve data for heap on given socket
  */
@@ -184,6 +317,11 @@ malloc_heap_get_stats(const struct malloc_heap *heap,
 	size_t idx;
 	struct malloc_elem *elem;
 
+	/* free elements may be in memsegs the primary process just added */
+	if (rte_eal_process_type() == RTE_PROC_SECONDARY &&
+			rte_eal_memseg_hotplug_sync() < 0)
+		return -1;
+
 	/* Initialise variables for heap */
 	socket_stats->free_count = 0;
 	socket_stats->heap_freesz_bytes = 0;
@@ -208,6 +346,48 @@ malloc_heap_get_stats(const struct malloc_heap *heap,
 	return 0;
 }
 
+/*
+ * Function to retrieve the free block size histogram of a heap
+ */
+int
+malloc_heap_get_frag_stats(struct malloc_heap *heap,
+		struct rte_malloc_socket_frag_stats *stats)
+{
+	size_t idx, size;
+	unsigned bucket;
+	struct malloc_elem *elem;
+
+	memset(stats, 0, sizeof(*stats));
+
+	/* free elements may be in memsegs the primary process just added */
+	if (rte_eal_process_type() == RTE_PROC_SECONDARY &&
+			rte_eal_memseg_hotplug_sync() < 0)
+		return -1;
+
+	rte_spinlock_lock(&heap->lock);
+	for (idx = 0; idx < RTE_HEAP_NUM_FREELISTS; idx++) {
+		for (elem = LIST_FIRST(&heap->free_head[idx]);
+				!!elem; elem = LIST_NEXT(elem, free_list)) {
+			stats->free_count++;
+			stats->heap_freesz_bytes += elem->size;
+			if (elem->size > stats->greatest_free_size)
+				stats->greatest_free_size = elem->size;
+
+			bucket = 0;
+			for (size = elem->size / RTE_CACHE_LINE_SIZE;
+					size > 1 && bucket <
+					RTE_MALLOC_FREE_HIST_SIZE - 1;
+					size >>= 1)
+				bucket++;
+			stats->free_hist[bucket]++;
+			stats->free_hist_bytes[bucket] += elem->size;
+		}
+	}
+	rte_spinlock_unlock(&heap->lock);
+
+	return 0;
+}
+
 int
 rte_eal_malloc_heap_init(void)
 {
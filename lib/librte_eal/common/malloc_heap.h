@@ -41,6 +41,8 @@
 extern "C" {
 #endif
 
+struct malloc_elem;
+
 static inline unsigned
 malloc_get_numa_socket(void)
 {
@@ -56,10 +58,21 @@ void *
 malloc_heap_alloc(struct malloc_heap *heap,	const char *type, size_t size,
 		unsigned flags, size_t align, size_t bound);
 
+unsigned
+malloc_heap_alloc_bulk(struct malloc_heap *heap, size_t size, size_t align,
+		void **objs, unsigned n);
+
+void
+malloc_heap_release_memseg(struct malloc_heap *heap, struct malloc_elem *elem);
+
 int
 malloc_heap_get_stats(const struct malloc_heap *heap,
 		struct rte_malloc_socket_stats *socket_stats);
 
+int
+malloc_heap_get_frag_stats(struct malloc_heap *heap,
+		struct rte_malloc_socket_frag_stats *stats);
+
 int
 rte_eal_malloc_heap_init(void);
 
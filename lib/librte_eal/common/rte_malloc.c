@@ -35,6 +35,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
 #include <sys/queue.h>
 
 #include <rte_memcpy.h>
@@ -52,21 +53,182 @@
 #include <rte_malloc.h>
 #include "malloc_elem.h"
 #include "malloc_heap.h"
+#include "malloc_cache.h"
 
 
+/* data size of an element, as accounted in the type statistics */
+static inline size_t
+malloc_elem_data_size(const struct malloc_elem *elem)
+{
+	return elem->size - elem->pad - MALLOC_ELEM_OVERHEAD;
+}
+
+#ifdef RTE_MALLOC_TYPE_STATS
+
+/* FNV-1a hash of the accounted part of a type string */
+static uint32_t
+malloc_type_hash(const char *type)
+{
+	uint32_t hash = 2166136261U;
+	unsigned i;
+
+	for (i = 0; i < RTE_MALLOC_TYPE_NAMESIZE - 1 && type[i] != '\0'; i++)
+		hash = (hash ^ (uint8_t)type[i]) * 16777619U;
+	return hash;
+}
+
+/*
+ * Return the index + 1 of a type string in the type statistics, adding it
+ * if needed, or 0 if the table is full.
+ */
+static unsigned
+malloc_type_get(const char *type)
+{
+	struct rte_mem_config *mcfg = rte_eal_get_configuration()->mem_config;
+	struct malloc_type *t;
+	uint32_t hash, count;
+	unsigned i = 0;
+
+	if (type == NULL)
+		type = "";
+	hash = malloc_type_hash(type);
+
+	/* entries are never removed, look up without lock first */
+	count = mcfg->malloc_type_count;
+	for (; i < count; i++) {
+		if (mcfg->malloc_type_hash[i] == hash &&
+				strncmp(mcfg->malloc_types[i].name, type,
+					RTE_MALLOC_TYPE_NAMESIZE - 1) == 0)
+			return i + 1;
+	}
+
+	rte_spinlock_lock(&mcfg->malloc_type_lock);
+	for (; i < mcfg->malloc_type_count; i++) {
+		if (mcfg->malloc_type_hash[i] == hash &&
+				strncmp(mcfg->malloc_types[i].name, type,
+					RTE_MALLOC_TYPE_NAMESIZE - 1) == 0)
+			break;
+	}
+	if (i == RTE_MALLOC_MAX_TYPES) {
+		rte_spinlock_unlock(&mcfg->malloc_type_lock);
+		return 0;
+	}
+	if (i == mcfg->malloc_type_count) {
+		t = &mcfg->malloc_types[i];
+		snprintf(t->name, sizeof(t->name), "%s", type);
+		rte_atomic64_init(&t->alloc_count);
+		rte_atomic64_init(&t->free_count);
+		rte_atomic64_init(&t->alloc_bytes);
+		mcfg->malloc_type_hash[i] = hash;
+		/* make the entry valid before publishing it */
+		rte_wmb();
+		mcfg->malloc_type_count = i + 1;
+	}
+	rte_spinlock_unlock(&mcfg->malloc_type_lock);
+
+	return i + 1;
+}
+
+/* account the allocation of a block in the statistics of a type */
+static void
+malloc_type_alloc(void *ptr, unsigned type)
+{
+	struct rte_mem_config *mcfg = rte_eal_get_configuration()->mem_config;
+	struct malloc_elem *elem = malloc_elem_from_data(ptr);
+	struct malloc_type *t;
+
+	if (type == 0 || elem == NULL)
+		return;
+
+	t = &mcfg->malloc_types[type - 1];
+	rte_atomic64_inc(&t->alloc_count);
+	rte_atomic64_add(&t->alloc_bytes, malloc_elem_data_size(elem));
+	elem->type = type;
+}
+
+/* account the free of a block in the statistics of its type */
+static void
+malloc_type_free(struct malloc_elem *elem)
+{
+	struct rte_mem_config *mcfg = rte_eal_get_configuration()->mem_config;
+	struct malloc_type *t;
+
+	if (elem == NULL || elem->type == 0 || elem->state != ELEM_BUSY)
+		return;
+
+	t = &mcfg->malloc_types[elem->type - 1];
+	rte_atomic64_inc(&t->free_count);
+	rte_atomic64_sub(&t->alloc_bytes, malloc_elem_data_size(elem));
+	elem->type = 0;
+}
+
+/* account the in-place resize of a block in the statistics of its type */
+static void
+malloc_type_resize(struct malloc_elem *elem, size_t old_data_size)
+{
+	struct rte_mem_config *mcfg = rte_eal_get_configuration()->mem_config;
+
+	if (elem->type == 0)
+		return;
+
+	rte_atomic64_add(&mcfg->malloc_types[elem->type - 1].alloc_bytes,
+			(int64_t)malloc_elem_data_size(elem) -
+			(int64_t)old_data_size);
+}
+
+#else /* RTE_MALLOC_TYPE_STATS */
+
+/* the type statistics cost a hash and shared atomics per allocation */
+static inline unsigned
+malloc_type_get(const char *type __rte_unused)
+{
+	return 0;
+}
+
+static inline void
+malloc_type_alloc(void *ptr __rte_unused, unsigned type __rte_unused)
+{
+}
+
+static inline void
+malloc_type_free(struct malloc_elem *elem __rte_unused)
+{
+}
+
+static inline void
+malloc_type_resize(struct malloc_elem *elem __rte_unused,
+		size_t old_data_size __rte_unused)
+{
+}
+
+#endif /* RTE_MALLOC_TYPE_STATS */
+
 /* Free the memory space back to heap */
 void rte_free(void *addr)
 {
+	struct malloc_elem *elem;
+
 	if (addr == NULL) return;
-	if (malloc_elem_free(malloc_elem_from_data(addr)) < 0)
+	elem = malloc_elem_from_data(addr);
+	malloc_type_free(elem);
+	if (malloc_cache_free(elem) == 0)
+		return;
+	if (malloc_elem_free(elem) < 0)
 		rte_panic("Fatal error: Invalid memory\n");
 }
 
+/* Give the blocks cached by the calling lcore back to the heap */
+void
+rte_malloc_lcore_cache_flush(void)
+{
+	malloc_cache_flush();
+}
+
 /*
- * Allocate memory on specified heap.
+ * Allocate memory on specified heap, without accounting it.
  */
-void *
-rte_malloc_socket(const char *type, size_t size, unsigned align, int socket_arg)
+static void *
+malloc_socket(const char *type, size_t size, unsigned align, int socket_arg)
 {
 	struct rte_mem_config *mcfg = rte_eal_get_configuration()->mem_config;
 	int socket, i;
@@ -88,6 +250,10 @@ rte_malloc_socket(const char *type, size_t size, unsigned align, int socket_arg)
 	if (socket >= RTE_MAX_NUMA_NODES)
 		return NULL;
 
+	ret = malloc_cache_alloc(socket, size, align);
+	if (ret != NULL)
+		return ret;
+
 	ret = malloc_heap_alloc(&mcfg->malloc_heaps[socket], type,
 				size, 0, align == 0 ? 1 : align, 0);
 	if (ret != NULL || socket_arg != SOCKET_ID_ANY)
@@ -108,6 +274,19 @@ rte_malloc_socket(const char *type, size_t size, unsigned align, int socket_arg)
 	return NULL;
 }
 
+/*
+ * Allocate memory on specified heap.
+ */
+void *
+rte_malloc_socket(const char *type, size_t size, unsigned align, int socket_arg)
+{
+	void *ret = malloc_socket(type, size, align, socket_arg);
+
+	if (ret != NULL)
+		malloc_type_alloc(ret, malloc_type_get(type));
+	return ret;
+}
+
 /*
  * Allocate memory on default heap.
  */
@@ -172,15 +351,21 @@ rte_realloc(void *ptr, size_t size, unsigned align)
 
 	size = RTE_CACHE_LINE_ROUNDUP(size), align = RTE_CACHE_LINE_ROUNDUP(align);
 	/* check alignment matches first, and if ok, see if we can resize block */
-	if (RTE_PTR_ALIGN(ptr,align) == ptr &&
-			malloc_elem_resize(elem, size) == 0)
-		return ptr;
+	if (RTE_PTR_ALIGN(ptr,align) == ptr) {
+		const size_t old_data_size = malloc_elem_data_size(elem);
+
+		if (malloc_elem_resize(elem, size) == 0) {
+			malloc_type_resize(elem, old_data_size);
+			return ptr;
+		}
+	}
 
 	/* either alignment is off, or we have no room to expand,
 	 * so move data. */
-	void *new_ptr = rte_malloc(NULL, size, align);
+	void *new_ptr = malloc_socket(NULL, size, align, SOCKET_ID_ANY);
 	if (new_ptr == NULL)
 		return NULL;
+	malloc_type_alloc(new_ptr, elem->type);
 	const unsigned old_size = elem->size - MALLOC_ELEM_OVERHEAD;
 	rte_memcpy(new_ptr, ptr, old_size < size ? old_size : size);
 	rte_free(ptr);
@@ -214,11 +399,50 @@ rte_malloc_get_socket_stats(int socket,
 	return malloc_heap_get_stats(&mcfg->malloc_heaps[socket], socket_stats);
 }
 
+/*
+ * Function to retrieve the fragmentation data of the heap on given socket
+ */
+int
+rte_malloc_get_socket_frag_stats(int socket,
+		struct rte_malloc_socket_frag_stats *stats)
+{
+	struct rte_mem_config *mcfg = rte_eal_get_configuration()->mem_config;
+
+	if (socket >= RTE_MAX_NUMA_NODES || socket < 0 || stats == NULL)
+		return -1;
+
+	return malloc_heap_get_frag_stats(&mcfg->malloc_heaps[socket], stats);
+}
+
+/*
+ * Function to retrieve the allocation data of all the types
+ */
+int
+rte_malloc_get_type_stats(struct rte_malloc_type_stats *stats, unsigned n)
+{
+	struct rte_mem_config *mcfg = rte_eal_get_configuration()->mem_config;
+	struct malloc_type *t;
+	unsigned i, count;
+
+	/* the statistics of other processes may be enabled */
+	count = mcfg->malloc_type_count;
+	rte_rmb();
+	for (i = 0; i < count && i < n; i++) {
+		t = &mcfg->malloc_types[i];
+		snprintf(stats[i].name, sizeof(stats[i].name), "%s", t->name);
+		stats[i].alloc_count = rte_atomic64_read(&t->alloc_count);
+		stats[i].free_count = rte_atomic64_read(&t->free_count);
+		stats[i].alloc_bytes = rte_atomic64_read(&t->alloc_bytes);
+	}
+
+	return count;
+}
+
 /*
  * Print stats on memory type. If type is NULL, info on all types is printed
  */
 void
-rte_malloc_dump_stats(FILE *f, __rte_unused const char *type)
+rte_malloc_dump_stats(FILE *f, const char *type)
 {
 	unsigned int socket;
 	struct rte_malloc_socket_stats sock_stats;
@@ -236,7 +460,25 @@ rte_malloc_dump_stats(FILE *f, __rte_unused const char *type)
 		fprintf(f, "\tAlloc_count:%u,\n",sock_stats.alloc_count);
 		fprintf(f, "\tFree_count:%u,\n", sock_stats.free_count);
 	}
-	return;
+
+	/* Print the allocations of the given type, or of all types */
+	struct rte_malloc_type_stats type_stats[RTE_MALLOC_MAX_TYPES];
+	int i, n;
+
+	n = rte_malloc_get_type_stats(type_stats, RTE_DIM(type_stats));
+	for (i = 0; i < n; i++) {
+		if (type != NULL && strncmp(type, type_stats[i].name,
+				RTE_MALLOC_TYPE_NAMESIZE - 1) != 0)
+			continue;
+
+		fprintf(f, "Type:%s\n", type_stats[i].name);
+		fprintf(f, "\tAlloc_count:%"PRIu64",\n",
+				type_stats[i].alloc_count);
+		fprintf(f, "\tFree_count:%"PRIu64",\n",
+				type_stats[i].free_count);
+		fprintf(f, "\tAlloc_size:%"PRIu64",\n",
+				type_stats[i].alloc_bytes);
+	}
 }
 
 /*
@@ -90,7 +90,8 @@
 static rte_usage_hook_t	rte_application_usage_hook = NULL;
 
 /* early configuration structure, when memory config is not mmapped */
-static struct rte_mem_config early_mem_config;
+/* aligned, as the mem config locks are reached at their offsets in it */
+static struct rte_mem_config early_mem_config __rte_cache_aligned;
 
 /* define fd variable here, because file needs to be kept open for the
  * duration of the program, as we hold a write lock on it in the primary proc */
@@ -342,6 +343,8 @@ eal_usage(const char *prgname)
 	       "  --"OPT_CREATE_UIO_DEV"    Create /dev/uioX (usually done by hotplug)\n"
 	       "  --"OPT_VFIO_INTR"         Interrupt mode for VFIO (legacy|msi|msix)\n"
 	       "  --"OPT_XEN_DOM0"          Support running on Xen dom0 without hugetlbfs\n"
+	       "  --"OPT_MEM_HOTPLUG"       Map and release hugepages at run-time, as the\n"
+	       "                      heap needs them (-m/--socket-mem give the initial amount)\n"
 	       "\n");
 	/* Allow the application to print its usage message too if hook is set */
 	if ( rte_application_usage_hook ) {
@@ -482,6 +485,29 @@ eal_get_hugepage_mem_size(void)
 	return (size < SIZE_MAX) ? (size_t)(size) : SIZE_MAX;
 }
 
+/* size of the smallest hugepage available, used as initial amount of
+ * memory when the rest is hot-plugged on demand */
+static inline size_t
+eal_get_hugepage_min_size(void)
+{
+	uint64_t size = 0;
+	unsigned i, j;
+
+	for (i = 0; i < internal_config.num_hugepage_sizes; i++) {
+		struct hugepage_info *hpi = &internal_config.hugepage_info[i];
+		if (hpi->hugedir == NULL)
+			continue;
+		for (j = 0; j < RTE_MAX_NUMA_NODES; j++) {
+			if (hpi->num_pages[j] == 0)
+				continue;
+			if (size == 0 || hpi->hugepage_sz < size)
+				size = hpi->hugepage_sz;
+		}
+	}
+
+	return (size_t)size;
+}
+
 /* Parse the arguments for --log-level only */
 static void
 eal_log_level_parse(int argc, char **argv)
@@ -579,6 +605,10 @@ eal_parse_args(int argc, char **argv)
 			internal_config.hugepage_dir = optarg;
 			break;
 
+		case OPT_MEM_HOTPLUG_NUM:
+			internal_config.mem_hotplug = 1;
+			break;
+
 		case OPT_FILE_PREFIX_NUM:
 			internal_config.hugefile_prefix = optarg;
 			break;
@@ -657,6 +687,19 @@ eal_parse_args(int argc, char **argv)
 		goto out;
 	}
 
+	/* hot-plugged memory is backed by named hugetlbfs files */
+	if (internal_config.mem_hotplug &&
+			(internal_config.no_hugetlbfs ||
+			 internal_config.hugepage_unlink ||
+			 internal_config.xen_dom0_support)) {
+		RTE_LOG(ERR, EAL, "Option --"OPT_MEM_HOTPLUG" cannot be specified "
+			"together with --"OPT_NO_HUGE", --"OPT_HUGE_UNLINK" or "
+			"--"OPT_XEN_DOM0"\n");
+		eal_usage(prgname);
+		ret = -1;
+		goto out;
+	}
+
 	if (optind >= 0)
 		argv[optind-1] = prgname;
 	ret = optind-1;
@@ -763,6 +806,8 @@ rte_eal_init(int argc, char **argv)
 	if (internal_config.memory == 0 && internal_config.force_sockets == 0) {
 		if (internal_config.no_hugetlbfs)
 			internal_config.memory = MEMSIZE_IF_NO_HUGE_PAGE;
+		else if (internal_config.mem_hotplug)
+			internal_config.memory = eal_get_hugepage_min_size();
 		else
 			internal_config.memory = eal_get_hugepage_mem_size();
 	}
@@ -837,6 +882,9 @@ rte_eal_init(int argc, char **argv)
 	if (rte_eal_intr_init() < 0)
 		rte_panic("Cannot init interrupt-handling thread\n");
 
+	if (internal_config.log_async && rte_log_set_async(1) < 0)
+		rte_panic("Cannot init asynchronous logging\n");
+
 	RTE_LCORE_FOREACH_SLAVE(i) {
 
 		/*
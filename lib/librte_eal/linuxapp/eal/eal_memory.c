@@ -80,6 +80,10 @@
 #include <errno.h>
 #include <sys/ioctl.h>
 #include <sys/time.h>
+#include <sys/syscall.h>
+#include <pthread.h>
+#include <signal.h>
+#include <setjmp.h>
 
 #include <rte_log.h>
 #include <rte_memory.h>
@@ -90,6 +94,7 @@
 #include <rte_per_lcore.h>
 #include <rte_lcore.h>
 #include <rte_common.h>
+#include <rte_spinlock.h>
 #include <rte_string_fns.h>
 
 #include "eal_private.h"
@@ -151,43 +156,25 @@ rte_mem_lock_page(const void *virt)
 }
 
 /*
- * Get physical address of any mapped virtual address in the current process.
+ * Get physical address of a mapped virtual address, using an already
+ * opened /proc/self/pagemap file descriptor.
  */
-phys_addr_t
-rte_mem_virt2phy(const void *virtaddr)
+static phys_addr_t
+mem_virt2phy_fd(int fd, const void *virtaddr)
 {
-	int fd;
 	uint64_t page, physaddr;
 	unsigned long virt_pfn;
 	int page_size;
 	off_t offset;
 
-	/* Cannot parse /proc/self/pagemap, no need to log errors everywhere */
-	if (!proc_pagemap_readable)
-		return RTE_BAD_PHYS_ADDR;
-
 	/* standard page size */
 	page_size = getpagesize();
 
-	fd = open("/proc/self/pagemap", O_RDONLY);
-	if (fd < 0) {
-		RTE_LOG(ERR, EAL, "%s(): cannot open /proc/self/pagemap: %s\n",
-			__func__, strerror(errno));
-		return RTE_BAD_PHYS_ADDR;
-	}
-
 	virt_pfn = (unsigned long)virtaddr / page_size;
 	offset = sizeof(uint64_t) * virt_pfn;
-	if (lseek(fd, offset, SEEK_SET) == (off_t) -1) {
-		RTE_LOG(ERR, EAL, "%s(): seek error in /proc/self/pagemap: %s\n",
-				__func__, strerror(errno));
-		close(fd);
-		return RTE_BAD_PHYS_ADDR;
-	}
-	if (read(fd, &page, sizeof(uint64_t)) < 0) {
+	if (pread(fd, &page, sizeof(uint64_t), offset) < 0) {
 		RTE_LOG(ERR, EAL, "%s(): cannot read /proc/self/pagemap: %s\n",
 				__func__, strerror(errno));
-		close(fd);
 		return RTE_BAD_PHYS_ADDR;
 	}
 
@@ -197,29 +184,223 @@ rte_mem_virt2phy(const void *virtaddr)
 	 */
 	physaddr = ((page & 0x7fffffffffffffULL) * page_size)
 		+ ((unsigned long)virtaddr % page_size);
+	return physaddr;
+}
+
+/*
+ * Get physical address of any mapped virtual address in the current process.
+ */
+phys_addr_t
+rte_mem_virt2phy(const void *virtaddr)
+{
+	int fd;
+	phys_addr_t physaddr;
+
+	/* Cannot parse /proc/self/pagemap, no need to log errors everywhere */
+	if (!proc_pagemap_readable)
+		return RTE_BAD_PHYS_ADDR;
+
+	fd = open("/proc/self/pagemap", O_RDONLY);
+	if (fd < 0) {
+		RTE_LOG(ERR, EAL, "%s(): cannot open /proc/self/pagemap: %s\n",
+			__func__, strerror(errno));
+		return RTE_BAD_PHYS_ADDR;
+	}
+
+	physaddr = mem_virt2phy_fd(fd, virtaddr);
 	close(fd);
 	return physaddr;
 }
 
 /*
- * For each hugepage in hugepg_tbl, fill the physaddr value. We find
- * it by browsing the /proc/self/pagemap special file.
+ * Hugepage table processing is split in chunks of consecutive pages,
+ * each chunk being handled by a separate thread. The init work (page
+ * faults and zeroing on first mapping, pagemap lookups) is dominated by
+ * the kernel, so it scales with the number of CPUs available.
+ *
+ * Each thread runs on the CPUs of an enabled lcore, the lcores of the
+ * different sockets being used in turn: a page being allocated on the
+ * socket of the thread faulting it in, the pages are spread across the
+ * sockets of the enabled lcores, as the memory is requested when no
+ * amount per socket is given.
+ */
+#define HUGEPAGE_INIT_PAGES_PER_THREAD_MIN 64
+
+typedef int (*hugepage_range_fn)(struct hugepage_file *hugepg_tbl,
+		struct hugepage_info *hpi, unsigned first, unsigned last);
+
+struct hugepage_range_ctx {
+	pthread_t thread_id;
+	unsigned lcore_id;
+	hugepage_range_fn f;
+	struct hugepage_file *hugepg_tbl;
+	struct hugepage_info *hpi;
+	unsigned first;
+	unsigned last;
+	int ret;
+};
+
+static void *
+hugepage_range_thread(void *arg)
+{
+	struct hugepage_range_ctx *ctx = arg;
+
+	ctx->ret = ctx->f(ctx->hugepg_tbl, ctx->hpi, ctx->first, ctx->last);
+	return NULL;
+}
+
+/*
+ * Fill lcores with the enabled lcores, taking one of each socket in turn.
+ * Returns the number of lcores.
+ */
+static unsigned
+hugepage_range_lcores(unsigned *lcores)
+{
+	unsigned next[RTE_MAX_NUMA_NODES] = { 0 };
+	unsigned lcore_id, socket_id, n = 0, added;
+
+	do {
+		added = 0;
+		for (socket_id = 0; socket_id < RTE_MAX_NUMA_NODES;
+				socket_id++) {
+			for (lcore_id = next[socket_id];
+					lcore_id < RTE_MAX_LCORE; lcore_id++)
+				if (rte_lcore_is_enabled(lcore_id) &&
+						lcore_config[lcore_id].socket_id ==
+						socket_id)
+					break;
+			if (lcore_id == RTE_MAX_LCORE) {
+				next[socket_id] = RTE_MAX_LCORE;
+				continue;
+			}
+			next[socket_id] = lcore_id + 1;
+			lcores[n++] = lcore_id;
+			added = 1;
+		}
+	} while (added);
+
+	return n;
+}
+
+/*
+ * Run f on all the pages of hugepg_tbl, using up to one thread per
+ * enabled lcore. The calling thread handles the first chunk.
  */
 static int
-find_physaddrs(struct hugepage_file *hugepg_tbl, struct hugepage_info *hpi)
+hugepage_range_run(hugepage_range_fn f, struct hugepage_file *hugepg_tbl,
+		struct hugepage_info *hpi)
+{
+	struct hugepage_range_ctx ctx[RTE_MAX_LCORE];
+	unsigned lcores[RTE_MAX_LCORE];
+	unsigned n_pages = hpi->num_pages[0];
+	unsigned n_threads, chunk, i;
+	rte_cpuset_t cpuset;
+	pthread_attr_t attr;
+	int cpuset_saved, ret = 0;
+
+	n_threads = hugepage_range_lcores(lcores);
+	n_threads = RTE_MIN(n_threads,
+			n_pages / HUGEPAGE_INIT_PAGES_PER_THREAD_MIN);
+	if (n_threads == 0)
+		n_threads = 1;
+
+	chunk = (n_pages + n_threads - 1) / n_threads;
+
+	for (i = 0; i < n_threads; i++) {
+		ctx[i].lcore_id = lcores[i];
+		ctx[i].f = f;
+		ctx[i].hugepg_tbl = hugepg_tbl;
+		ctx[i].hpi = hpi;
+		ctx[i].first = i * chunk;
+		ctx[i].last = RTE_MIN((i + 1) * chunk, n_pages);
+		ctx[i].ret = 0;
+		if (i == 0)
+			continue;
+
+		/* if no thread can be created, run the chunk from here */
+		if (pthread_attr_init(&attr) != 0) {
+			ctx[i].thread_id = pthread_self();
+			ctx[i].ret = f(hugepg_tbl, hpi, ctx[i].first,
+					ctx[i].last);
+			continue;
+		}
+		pthread_attr_setaffinity_np(&attr, sizeof(rte_cpuset_t),
+				&lcore_config[ctx[i].lcore_id].cpuset);
+		if (pthread_create(&ctx[i].thread_id, &attr,
+				hugepage_range_thread, &ctx[i]) != 0) {
+			ctx[i].thread_id = pthread_self();
+			ctx[i].ret = f(hugepg_tbl, hpi, ctx[i].first,
+					ctx[i].last);
+		}
+		pthread_attr_destroy(&attr);
+	}
+
+	/* the calling thread gets its affinity back afterwards */
+	cpuset_saved = pthread_getaffinity_np(pthread_self(),
+			sizeof(rte_cpuset_t), &cpuset) == 0;
+	if (cpuset_saved)
+		pthread_setaffinity_np(pthread_self(), sizeof(rte_cpuset_t),
+				&lcore_config[ctx[0].lcore_id].cpuset);
+	ctx[0].ret = f(hugepg_tbl, hpi, ctx[0].first, ctx[0].last);
+	if (cpuset_saved)
+		pthread_setaffinity_np(pthread_self(), sizeof(rte_cpuset_t),
+				&cpuset);
+
+	for (i = 0; i < n_threads; i++) {
+		if (i > 0 && !pthread_equal(ctx[i].thread_id, pthread_self()))
+			pthread_join(ctx[i].thread_id, NULL);
+		if (ctx[i].ret < 0)
+			ret = -1;
+	}
+
+	return ret;
+}
+
+/*
+ * Fill the physaddr value of hugepages [first, last) of hugepg_tbl.
+ */
+static int
+find_physaddrs_range(struct hugepage_file *hugepg_tbl,
+		__rte_unused struct hugepage_info *hpi,
+		unsigned first, unsigned last)
 {
 	unsigned i;
 	phys_addr_t addr;
+	int fd;
 
-	for (i = 0; i < hpi->num_pages[0]; i++) {
-		addr = rte_mem_virt2phy(hugepg_tbl[i].orig_va);
-		if (addr == RTE_BAD_PHYS_ADDR)
+	if (!proc_pagemap_readable)
+		return -1;
+
+	fd = open("/proc/self/pagemap", O_RDONLY);
+	if (fd < 0) {
+		RTE_LOG(ERR, EAL, "%s(): cannot open /proc/self/pagemap: %s\n",
+			__func__, strerror(errno));
+		return -1;
+	}
+
+	for (i = first; i < last; i++) {
+		addr = mem_virt2phy_fd(fd, hugepg_tbl[i].orig_va);
+		if (addr == RTE_BAD_PHYS_ADDR) {
+			close(fd);
 			return -1;
+		}
 		hugepg_tbl[i].physaddr = addr;
 	}
+
+	close(fd);
 	return 0;
 }
 
+/*
+ * For each hugepage in hugepg_tbl, fill the physaddr value. We find
+ * it by browsing the /proc/self/pagemap special file.
+ */
+static int
+find_physaddrs(struct hugepage_file *hugepg_tbl, struct hugepage_info *hpi)
+{
+	return hugepage_range_run(find_physaddrs_range, hugepg_tbl, hpi);
+}
+
 /*
  * Check whether address-space layout randomization is enabled in
  * the kernel. This is important for multi-process as it can prevent
@@ -309,23 +490,106 @@ get_virtual_area(size_t *size, size_t hugepage_sz)
 	return addr;
 }
 
+/*
+ * Open (or create) a hugepage file, mmap() size bytes of it at addr (a
+ * hint, may be NULL) and set a shared flock on it. Returns the virtual
+ * address of the mapping or NULL on error.
+ */
+static void *
+map_hugepage_file(const char *filepath, void *addr, size_t size)
+{
+	int fd;
+	void *virtaddr;
+
+	/* try to create hugepage file */
+	fd = open(filepath, O_CREAT | O_RDWR, 0755);
+	if (fd < 0) {
+		RTE_LOG(ERR, EAL, "%s(): open failed: %s\n", __func__,
+				strerror(errno));
+		return NULL;
+	}
+
+	virtaddr = mmap(addr, size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, fd, 0);
+	if (virtaddr == MAP_FAILED) {
+		RTE_LOG(ERR, EAL, "%s(): mmap failed: %s\n", __func__,
+				strerror(errno));
+		close(fd);
+		return NULL;
+	}
+
+	/* set shared flock on the file. */
+	if (flock(fd, LOCK_SH | LOCK_NB) == -1) {
+		RTE_LOG(ERR, EAL, "%s(): Locking file failed:%s \n",
+			__func__, strerror(errno));
+		munmap(virtaddr, size);
+		close(fd);
+		return NULL;
+	}
+
+	close(fd);
+	return virtaddr;
+}
+
+/*
+ * First mapping of hugepages [first, last) of hugepage table. The pages
+ * are zeroed, which also faults them in.
+ */
+static int
+map_orig_hugepages_range(struct hugepage_file *hugepg_tbl,
+		struct hugepage_info *hpi, unsigned first, unsigned last)
+{
+	unsigned i;
+	void *virtaddr;
+
+	for (i = first; i < last; i++) {
+		uint64_t hugepage_sz = hpi->hugepage_sz;
+
+		hugepg_tbl[i].file_id = i;
+		hugepg_tbl[i].size = hugepage_sz;
+#ifdef RTE_EAL_SINGLE_FILE_SEGMENTS
+		eal_get_hugefile_temp_path(hugepg_tbl[i].filepath,
+				sizeof(hugepg_tbl[i].filepath), hpi->hugedir,
+				hugepg_tbl[i].file_id);
+#else
+		eal_get_hugefile_path(hugepg_tbl[i].filepath,
+				sizeof(hugepg_tbl[i].filepath), hpi->hugedir,
+				hugepg_tbl[i].file_id);
+#endif
+		hugepg_tbl[i].filepath[sizeof(hugepg_tbl[i].filepath) - 1] = '\0';
+
+		virtaddr = map_hugepage_file(hugepg_tbl[i].filepath, NULL,
+				hugepage_sz);
+		if (virtaddr == NULL)
+			return -1;
+
+		hugepg_tbl[i].orig_va = virtaddr;
+		memset(virtaddr, 0, hugepage_sz);
+	}
+	return 0;
+}
+
 /*
  * Mmap all hugepages of hugepage table: it first open a file in
  * hugetlbfs, then mmap() hugepage_sz data in it. If orig is set, the
  * virtual address is stored in hugepg_tbl[i].orig_va, else it is stored
  * in hugepg_tbl[i].final_va. The second mapping (when orig is 0) tries to
- * map continguous physical blocks in contiguous virtual blocks.
+ * map continguous physical blocks in contiguous virtual blocks. The first
+ * mapping is done in parallel, see hugepage_range_run().
  */
 static int
 map_all_hugepages(struct hugepage_file *hugepg_tbl,
 		struct hugepage_info *hpi, int orig)
 {
-	int fd;
 	unsigned i;
 	void *virtaddr;
 	void *vma_addr = NULL;
 	size_t vma_len = 0;
 
+	if (orig)
+		return hugepage_range_run(map_orig_hugepages_range,
+				hugepg_tbl, hpi);
+
 #ifdef RTE_EAL_SINGLE_FILE_SEGMENTS
 	RTE_SET_USED(vma_len);
 #endif
@@ -333,25 +597,11 @@ map_all_hugepages(struct hugepage_file *hugepg_tbl,
 	for (i = 0; i < hpi->num_pages[0]; i++) {
 		uint64_t hugepage_sz = hpi->hugepage_sz;
 
-		if (orig) {
-			hugepg_tbl[i].file_id = i;
-			hugepg_tbl[i].size = hugepage_sz;
-#ifdef RTE_EAL_SINGLE_FILE_SEGMENTS
-			eal_get_hugefile_temp_path(hugepg_tbl[i].filepath,
-					sizeof(hugepg_tbl[i].filepath), hpi->hugedir,
-					hugepg_tbl[i].file_id);
-#else
-			eal_get_hugefile_path(hugepg_tbl[i].filepath,
-					sizeof(hugepg_tbl[i].filepath), hpi->hugedir,
-					hugepg_tbl[i].file_id);
-#endif
-			hugepg_tbl[i].filepath[sizeof(hugepg_tbl[i].filepath) - 1] = '\0';
-		}
 #ifndef RTE_ARCH_64
 		/* for 32-bit systems, don't remap 1G and 16G pages, just reuse
 		 * original map address as final map address.
 		 */
-		else if ((hugepage_sz == RTE_PGSIZE_1G)
+		if ((hugepage_sz == RTE_PGSIZE_1G)
 			|| (hugepage_sz == RTE_PGSIZE_16G)) {
 			hugepg_tbl[i].final_va = hugepg_tbl[i].orig_va;
 			hugepg_tbl[i].orig_va = NULL;
@@ -360,7 +610,7 @@ map_all_hugepages(struct hugepage_file *hugepg_tbl,
 #endif
 
 #ifndef RTE_EAL_SINGLE_FILE_SEGMENTS
-		else if (vma_len == 0) {
+		if (vma_len == 0) {
 			unsigned j, num_pages;
 
 			/* reserve a virtual area for next contiguous
@@ -391,40 +641,12 @@ map_all_hugepages(struct hugepage_file *hugepg_tbl,
 		}
 #endif
 
-		/* try to create hugepage file */
-		fd = open(hugepg_tbl[i].filepath, O_CREAT | O_RDWR, 0755);
-		if (fd < 0) {
-			RTE_LOG(ERR, EAL, "%s(): open failed: %s\n", __func__,
-					strerror(errno));
-			return -1;
-		}
-
-		virtaddr = mmap(vma_addr, hugepage_sz, PROT_READ | PROT_WRITE,
-				MAP_SHARED, fd, 0);
-		if (virtaddr == MAP_FAILED) {
-			RTE_LOG(ERR, EAL, "%s(): mmap failed: %s\n", __func__,
-					strerror(errno));
-			close(fd);
-			return -1;
-		}
-
-		if (orig) {
-			hugepg_tbl[i].orig_va = virtaddr;
-			memset(virtaddr, 0, hugepage_sz);
-		}
-		else {
-			hugepg_tbl[i].final_va = virtaddr;
-		}
-
-		/* set shared flock on the file. */
-		if (flock(fd, LOCK_SH | LOCK_NB) == -1) {
-			RTE_LOG(ERR, EAL, "%s(): Locking file failed:%s \n",
-				__func__, strerror(errno));
-			close(fd);
+		virtaddr = map_hugepage_file(hugepg_tbl[i].filepath, vma_addr,
+				hugepage_sz);
+		if (virtaddr == NULL)
 			return -1;
-		}
 
-		close(fd);
+		hugepg_tbl[i].final_va = virtaddr;
 
 		vma_addr = (char *)vma_addr + hugepage_sz;
 		vma_len -= hugepage_sz;
@@ -619,9 +841,36 @@ unmap_all_hugepages_orig(struct hugepage_file *hugepg_tbl, struct hugepage_info
 }
 #endif /* RTE_EAL_SINGLE_FILE_SEGMENTS */
 
+static int
+cmp_hugepage_va(const void *a, const void *b)
+{
+	const struct hugepage_file *hp_a = *(const struct hugepage_file * const *)a;
+	const struct hugepage_file *hp_b = *(const struct hugepage_file * const *)b;
+
+	if (hp_a->orig_va < hp_b->orig_va)
+		return -1;
+	if (hp_a->orig_va > hp_b->orig_va)
+		return 1;
+	return 0;
+}
+
+static int
+cmp_va_hugepage(const void *key, const void *elem)
+{
+	const void *va = key;
+	const struct hugepage_file *hp = *(const struct hugepage_file * const *)elem;
+
+	if (va < hp->orig_va)
+		return -1;
+	if (va > hp->orig_va)
+		return 1;
+	return 0;
+}
+
 /*
  * Parse /proc/self/numa_maps to get the NUMA socket ID for each huge
- * page.
+ * page. Pages are looked up by virtual address in an index sorted by
+ * orig_va, so that the cost is O(n log n) in the number of pages.
  */
 static int
 find_numasocket(struct hugepage_file *hugepg_tbl, struct hugepage_info *hpi)
@@ -632,6 +881,7 @@ find_numasocket(struct hugepage_file *hugepg_tbl, struct hugepage_info *hpi)
 	uint64_t virt_addr;
 	char buf[BUFSIZ];
 	char hugedir_str[PATH_MAX];
+	struct hugepage_file **index, **hp;
 	FILE *f;
 
 	f = fopen("/proc/self/numa_maps", "r");
@@ -641,6 +891,16 @@ find_numasocket(struct hugepage_file *hugepg_tbl, struct hugepage_info *hpi)
 		return 0;
 	}
 
+	index = malloc(hpi->num_pages[0] * sizeof(index[0]));
+	if (index == NULL) {
+		RTE_LOG(ERR, EAL, "%s(): cannot allocate page index\n", __func__);
+		fclose(f);
+		return -1;
+	}
+	for (i = 0; i < hpi->num_pages[0]; i++)
+		index[i] = &hugepg_tbl[i];
+	qsort(index, hpi->num_pages[0], sizeof(index[0]), cmp_hugepage_va);
+
 	snprintf(hugedir_str, sizeof(hugedir_str),
 			"%s/%s", hpi->hugedir, internal_config.hugefile_prefix);
 
@@ -681,73 +941,56 @@ find_numasocket(struct hugepage_file *hugepg_tbl, struct hugepage_info *hpi)
 		}
 
 		/* if we find this page in our mappings, set socket_id */
-		for (i = 0; i < hpi->num_pages[0]; i++) {
-			void *va = (void *)(unsigned long)virt_addr;
-			if (hugepg_tbl[i].orig_va == va) {
-				hugepg_tbl[i].socket_id = socket_id;
-				hp_count++;
-			}
+		hp = bsearch((void *)(unsigned long)virt_addr, index,
+				hpi->num_pages[0], sizeof(index[0]),
+				cmp_va_hugepage);
+		if (hp != NULL) {
+			(*hp)->socket_id = socket_id;
+			hp_count++;
 		}
 	}
 
 	if (hp_count < hpi->num_pages[0])
 		goto error;
 
+	free(index);
 	fclose(f);
 	return 0;
 
 error:
+	free(index);
 	fclose(f);
 	return -1;
 }
 
+static int
+cmp_physaddr(const void *a, const void *b)
+{
+#ifndef RTE_ARCH_PPC_64
+	const struct hugepage_file *p1 = (const struct hugepage_file *)a;
+	const struct hugepage_file *p2 = (const struct hugepage_file *)b;
+#else
+	/* PowerPC needs memory sorted in reverse order from x86 */
+	const struct hugepage_file *p1 = (const struct hugepage_file *)b;
+	const struct hugepage_file *p2 = (const struct hugepage_file *)a;
+#endif
+	if (p1->physaddr < p2->physaddr)
+		return -1;
+	else if (p1->physaddr > p2->physaddr)
+		return 1;
+	else
+		return 0;
+}
+
 /*
  * Sort the hugepg_tbl by physical address (lower addresses first on x86,
- * higher address first on powerpc). We use a slow algorithm, but we won't
- * have millions of pages, and this is only done at init time.
+ * higher address first on powerpc).
  */
 static int
 sort_by_physaddr(struct hugepage_file *hugepg_tbl, struct hugepage_info *hpi)
 {
-	unsigned i, j;
-	int compare_idx;
-	uint64_t compare_addr;
-	struct hugepage_file tmp;
-
-	for (i = 0; i < hpi->num_pages[0]; i++) {
-		compare_addr = 0;
-		compare_idx = -1;
-
-		/*
-		 * browse all entries starting at 'i', and find the
-		 * entry with the smallest addr
-		 */
-		for (j=i; j< hpi->num_pages[0]; j++) {
-
-			if (compare_addr == 0 ||
-#ifdef RTE_ARCH_PPC_64
-				hugepg_tbl[j].physaddr > compare_addr) {
-#else
-				hugepg_tbl[j].physaddr < compare_addr) {
-#endif
-				compare_addr = hugepg_tbl[j].physaddr;
-				compare_idx = j;
-			}
-		}
-
-		/* should not happen */
-		if (compare_idx == -1) {
-			RTE_LOG(ERR, EAL, "%s(): error in physaddr sorting\n", __func__);
-			return -1;
-		}
-
-		/* swap the 2 entries in the table */
-		memcpy(&tmp, &hugepg_tbl[compare_idx],
-			sizeof(struct hugepage_file));
-		memcpy(&hugepg_tbl[compare_idx], &hugepg_tbl[i],
-			sizeof(struct hugepage_file));
-		memcpy(&hugepg_tbl[i], &tmp, sizeof(struct hugepage_file));
-	}
+	qsort(hugepg_tbl, hpi->num_pages[0], sizeof(struct hugepage_file),
+		cmp_physaddr);
 	return 0;
 }
 
@@ -1480,6 +1723,10 @@ rte_eal_hugepage_attach(void)
 	for (s = 0; s < RTE_MAX_MEMSEG; ++s) {
 		void *base_addr;
 
+		/* hot-plugged segments are mapped by the sync below */
+		if (mcfg->memseg_hotplug[s].gen != 0)
+			continue;
+
 		/*
 		 * the first memory segment with len==0 is the one that
 		 * follows the last valid segment.
@@ -1530,10 +1777,16 @@ rte_eal_hugepage_attach(void)
 	RTE_LOG(DEBUG, EAL, "Analysing %u files\n", num_hp);
 
 	s = 0;
-	while (s < RTE_MAX_MEMSEG && mcfg->memseg[s].len > 0){
+	while (s < RTE_MAX_MEMSEG && (mcfg->memseg[s].len > 0 ||
+			mcfg->memseg_hotplug[s].gen != 0)) {
 		void *addr, *base_addr;
 		uintptr_t offset = 0;
 		size_t mapping_size;
+
+		if (mcfg->memseg_hotplug[s].gen != 0) {
+			s++;
+			continue;
+		}
 #ifdef RTE_LIBRTE_IVSHMEM
 		/*
 		 * if segment has ioremap address set, it's an IVSHMEM segment and
@@ -1588,7 +1841,9 @@ rte_eal_hugepage_attach(void)
 	munmap((void *)(uintptr_t)hp, size);
 	close(fd_zero);
 	close(fd_hugepage);
-	return 0;
+
+	/* map the segments hot-plugged by the primary so far */
+	return rte_eal_memseg_hotplug_sync();
 
 error:
 	if (fd_zero >= 0)
@@ -1597,3 +1852,488 @@ error:
 		close(fd_hugepage);
 	return -1;
 }
+
+/*
+ * Run-time memory hotplug.
+ *
+ * With --mem-hotplug, the primary process maps a new memseg when the heap
+ * runs out of memory, and the process freeing its last element (primary
+ * or secondary) unmaps it. Each such memseg is backed by a single
+ * hugetlbfs file, so that all processes can map it at the same address.
+ * Changes are done with memseg_lock held for writing and bump memseg_gen;
+ * a process compares it with the generation it has seen to know it is up
+ * to date, and catches up before changing memseg[] itself.
+ */
+
+#define HUGE_MPOL_BIND 2 /* from numaif.h, not required at build time */
+
+/* state of the hot-plugged memsegs as mapped in this process */
+static struct {
+	uint32_t gen;  /* generation of the mapping, 0 if not mapped */
+	void *addr;
+	size_t len;
+} memseg_hotplug_local[RTE_MAX_MEMSEG];
+
+static uint32_t memseg_hotplug_local_gen;
+
+/*
+ * Serializes the updates of the state above by the threads of the process
+ * catching up with the other processes, which only hold memseg_lock for
+ * reading. Recursive, as the mem-event callbacks run with it held.
+ */
+static rte_spinlock_recursive_t memseg_hotplug_local_lock =
+	RTE_SPINLOCK_RECURSIVE_INITIALIZER;
+
+/*
+ * SIGBUS handling while faulting in new hugepages. The jump buffer is per
+ * thread, so that a SIGBUS raised in another thread while the handler is
+ * installed is passed on instead of jumping into the wrong stack.
+ */
+static RTE_DEFINE_PER_LCORE(sigjmp_buf, huge_jmpenv);
+static RTE_DEFINE_PER_LCORE(int, huge_jmpenv_set);
+static struct sigaction huge_sigbus_old_action;
+static rte_spinlock_t huge_sigbus_lock = RTE_SPINLOCK_INITIALIZER;
+
+static void
+huge_sigbus_handler(int signo, siginfo_t *info, void *ctx)
+{
+	const struct sigaction *old = &huge_sigbus_old_action;
+
+	if (RTE_PER_LCORE(huge_jmpenv_set))
+		siglongjmp(RTE_PER_LCORE(huge_jmpenv), 1);
+
+	if (old->sa_flags & SA_SIGINFO)
+		old->sa_sigaction(signo, info, ctx);
+	else if (old->sa_handler != SIG_DFL && old->sa_handler != SIG_IGN)
+		old->sa_handler(signo);
+	else
+		/* the faulting access is retried with the previous action */
+		sigaction(signo, old, NULL);
+}
+
+/* memseg_lock is not reached with &mcfg->memseg_lock, as mcfg is packed */
+static inline rte_rwlock_t *
+memseg_lock(const struct rte_mem_config *mcfg)
+{
+	RTE_BUILD_BUG_ON(offsetof(struct rte_mem_config, memseg_lock) %
+			sizeof(rte_rwlock_t) != 0);
+	return (rte_rwlock_t *)RTE_PTR_ADD(mcfg,
+			offsetof(struct rte_mem_config, memseg_lock));
+}
+
+static uint32_t
+memseg_hotplug_next_gen(struct rte_mem_config *mcfg)
+{
+	uint32_t gen = mcfg->memseg_gen + 1;
+
+	/* 0 means "not hot-plugged" in memseg_hotplug[] */
+	if (gen == 0)
+		gen = 1;
+	return gen;
+}
+
+/* Bind [addr, addr + len) to the NUMA node socket_id */
+static int
+huge_bind_socket(void *addr, size_t len, int socket_id)
+{
+#ifdef SYS_mbind
+	const unsigned bits = sizeof(unsigned long) * CHAR_BIT;
+	unsigned long nodemask[RTE_MAX_NUMA_NODES / bits + 1];
+
+	memset(nodemask, 0, sizeof(nodemask));
+	nodemask[socket_id / bits] = 1UL << (socket_id % bits);
+	if (syscall(SYS_mbind, addr, len, HUGE_MPOL_BIND, nodemask,
+			sizeof(nodemask) * CHAR_BIT, 0) == 0)
+		return 0;
+	/* kernel without NUMA support, there is only one node */
+	if (errno == ENOSYS && socket_id == 0)
+		return 0;
+	RTE_LOG(DEBUG, EAL, "%s(): mbind failed: %s\n", __func__,
+			strerror(errno));
+	return -1;
+#else
+	RTE_SET_USED(addr);
+	RTE_SET_USED(len);
+	return socket_id == 0 ? 0 : -1;
+#endif
+}
+
+/*
+ * Fault in the pages of a new mapping. The kernel sends SIGBUS instead
+ * of failing the mmap() when there are not enough free hugepages.
+ */
+static int
+huge_touch_pages(void *addr, size_t len, size_t hugepage_sz)
+{
+	struct sigaction action;
+	size_t offset;
+	int ret;
+
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = huge_sigbus_handler;
+	action.sa_flags = SA_SIGINFO;
+	sigemptyset(&action.sa_mask);
+
+	rte_spinlock_lock(&huge_sigbus_lock);
+	if (sigaction(SIGBUS, &action, &huge_sigbus_old_action) < 0) {
+		rte_spinlock_unlock(&huge_sigbus_lock);
+		return -1;
+	}
+
+	if (sigsetjmp(RTE_PER_LCORE(huge_jmpenv), 1) == 0) {
+		RTE_PER_LCORE(huge_jmpenv_set) = 1;
+		for (offset = 0; offset < len; offset += hugepage_sz)
+			*(volatile uint8_t *)RTE_PTR_ADD(addr, offset) = 0;
+		ret = 0;
+	} else
+		ret = -1;
+	RTE_PER_LCORE(huge_jmpenv_set) = 0;
+
+	sigaction(SIGBUS, &huge_sigbus_old_action, NULL);
+	rte_spinlock_unlock(&huge_sigbus_lock);
+	return ret;
+}
+
+/* Return the physical address of a mapping, or RTE_BAD_PHYS_ADDR if it is
+ * not physically contiguous */
+static phys_addr_t
+huge_contig_physaddr(void *addr, size_t len, size_t hugepage_sz)
+{
+	phys_addr_t first, cur;
+	size_t offset;
+	int fd;
+
+	fd = open("/proc/self/pagemap", O_RDONLY);
+	if (fd < 0) {
+		RTE_LOG(ERR, EAL, "%s(): cannot open /proc/self/pagemap: %s\n",
+				__func__, strerror(errno));
+		return RTE_BAD_PHYS_ADDR;
+	}
+
+	first = mem_virt2phy_fd(fd, addr);
+	for (offset = hugepage_sz; first != RTE_BAD_PHYS_ADDR &&
+			offset < len; offset += hugepage_sz) {
+		cur = mem_virt2phy_fd(fd, RTE_PTR_ADD(addr, offset));
+		if (cur != first + offset)
+			first = RTE_BAD_PHYS_ADDR;
+	}
+
+	close(fd);
+	return first;
+}
+
+/* Find a free memseg slot: a released hot-plugged one, or the first
+ * unused one */
+static int
+memseg_hotplug_slot(const struct rte_mem_config *mcfg)
+{
+	int i;
+
+	for (i = 0; i < RTE_MAX_MEMSEG; i++) {
+		if (mcfg->memseg_hotplug[i].gen != 0 &&
+				mcfg->memseg[i].len == 0)
+			return i;
+		if (mcfg->memseg[i].addr == NULL)
+			return i;
+	}
+	return -1;
+}
+
+/* Map len bytes of hugepages of hpi on socket_id into memseg slot ms_id */
+static int
+memseg_hotplug_map(struct rte_mem_config *mcfg, int ms_id,
+		struct hugepage_info *hpi, int socket_id, size_t len)
+{
+	struct rte_memseg *ms = &mcfg->memseg[ms_id];
+	struct rte_memseg_hotplug *hp = &mcfg->memseg_hotplug[ms_id];
+	char filepath[RTE_MEMSEG_HOTPLUG_PATH_LEN];
+	size_t map_len, vma_len;
+	phys_addr_t physaddr;
+	void *addr;
+	int fd;
+
+	map_len = RTE_ALIGN_CEIL(len, hpi->hugepage_sz);
+	eal_get_hugefile_hotplug_path(filepath, sizeof(filepath),
+			hpi->hugedir, ms_id);
+
+	/* same hint as for the memory mapped at init, so that secondary
+	 * processes are likely to have the area free too */
+	vma_len = map_len;
+	addr = get_virtual_area(&vma_len, hpi->hugepage_sz);
+	if (addr == NULL || vma_len != map_len)
+		return -1;
+
+	fd = open(filepath, O_CREAT | O_RDWR, 0755);
+	if (fd < 0) {
+		RTE_LOG(ERR, EAL, "%s(): open %s failed: %s\n", __func__,
+				filepath, strerror(errno));
+		return -1;
+	}
+	addr = mmap(addr, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) {
+		RTE_LOG(DEBUG, EAL, "%s(): mmap failed: %s\n", __func__,
+				strerror(errno));
+		goto err_close;
+	}
+
+	if (huge_bind_socket(addr, map_len, socket_id) < 0 ||
+			huge_touch_pages(addr, map_len, hpi->hugepage_sz) < 0) {
+		RTE_LOG(DEBUG, EAL, "Not enough %"PRIu64"kB hugepages "
+				"on socket %d\n", hpi->hugepage_sz >> 10,
+				socket_id);
+		goto err_unmap;
+	}
+
+	physaddr = huge_contig_physaddr(addr, map_len, hpi->hugepage_sz);
+	if (physaddr == RTE_BAD_PHYS_ADDR) {
+		RTE_LOG(DEBUG, EAL, "%zu bytes of %"PRIu64"kB hugepages "
+				"are not physically contiguous\n", map_len,
+				hpi->hugepage_sz >> 10);
+		goto err_unmap;
+	}
+
+	/* like at init, tell other primary processes the file is in use */
+	if (flock(fd, LOCK_SH | LOCK_NB) == -1) {
+		RTE_LOG(ERR, EAL, "%s(): Locking file failed: %s\n",
+				__func__, strerror(errno));
+		goto err_unmap;
+	}
+	close(fd);
+
+	ms->phys_addr = physaddr;
+	ms->addr = addr;
+	ms->hugepage_sz = hpi->hugepage_sz;
+	ms->socket_id = socket_id;
+	ms->nchannel = mcfg->nchannel;
+	ms->nrank = mcfg->nrank;
+#ifdef RTE_LIBRTE_IVSHMEM
+	ms->ioremap_addr = 0;
+#endif
+	snprintf(hp->filepath, sizeof(hp->filepath), "%s", filepath);
+	hp->gen = memseg_hotplug_next_gen(mcfg);
+	/* a non-zero len makes the memseg visible */
+	rte_wmb();
+	ms->len = map_len;
+	mcfg->memseg_gen = hp->gen;
+
+	memseg_hotplug_local[ms_id].gen = hp->gen;
+	memseg_hotplug_local[ms_id].addr = addr;
+	memseg_hotplug_local[ms_id].len = map_len;
+	memseg_hotplug_local_gen = hp->gen;
+	return 0;
+
+err_unmap:
+	munmap(addr, map_len);
+err_close:
+	close(fd);
+	unlink(filepath);
+	return -1;
+}
+
+/*
+ * Replay the memseg changes done by the other processes since the last
+ * call. Called with memseg_lock held and memseg_hotplug_local_lock taken.
+ */
+static int
+memseg_hotplug_catch_up(const struct rte_mem_config *mcfg)
+{
+	const struct rte_memseg *ms;
+	const struct rte_memseg_hotplug *hp;
+	void *addr;
+	int fd, ret = 0;
+	unsigned i;
+
+	if (mcfg->memseg_gen == memseg_hotplug_local_gen)
+		return 0;
+
+	for (i = 0; i < RTE_MAX_MEMSEG; i++) {
+		ms = &mcfg->memseg[i];
+		hp = &mcfg->memseg_hotplug[i];
+
+		if (hp->gen == 0 && ms->addr == NULL)
+			break;
+		/* a released memseg keeps its gen, but has no length */
+		if (hp->gen == 0 || (ms->len != 0 &&
+				memseg_hotplug_local[i].gen == hp->gen))
+			continue;
+
+		/* released, or released then reused: drop the old mapping */
+		if (memseg_hotplug_local[i].gen != 0) {
+			memseg_hotplug_local[i].gen = 0;
+			eal_mem_event_notify(RTE_MEM_EVENT_DEL, ms);
+			munmap(memseg_hotplug_local[i].addr,
+					memseg_hotplug_local[i].len);
+		}
+		if (ms->len == 0)
+			continue;
+
+		/* reserve the range at the address of the memseg, then map
+		 * the file over the reservation with MAP_FIXED, which does
+		 * not clobber anything else this process mapped there */
+		addr = mmap(ms->addr, ms->len, PROT_NONE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (addr != ms->addr) {
+			RTE_LOG(ERR, EAL, "Could not reserve %zu bytes at %p\n",
+					ms->len, ms->addr);
+			if (addr != MAP_FAILED)
+				munmap(addr, ms->len);
+			ret = -1;
+			continue;
+		}
+		fd = open(hp->filepath, O_RDWR);
+		if (fd < 0) {
+			RTE_LOG(ERR, EAL, "Could not open %s\n", hp->filepath);
+			munmap(ms->addr, ms->len);
+			ret = -1;
+			continue;
+		}
+		addr = mmap(ms->addr, ms->len, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_FIXED, fd, 0);
+		close(fd);
+		if (addr == MAP_FAILED) {
+			RTE_LOG(ERR, EAL, "Could not mmap %s at %p\n",
+					hp->filepath, ms->addr);
+			munmap(ms->addr, ms->len);
+			ret = -1;
+			continue;
+		}
+		memseg_hotplug_local[i].gen = hp->gen;
+		memseg_hotplug_local[i].addr = addr;
+		memseg_hotplug_local[i].len = ms->len;
+		eal_mem_event_notify(RTE_MEM_EVENT_ADD, ms);
+	}
+
+	/* on error, retry on next call */
+	if (ret == 0)
+		memseg_hotplug_local_gen = mcfg->memseg_gen;
+
+	return ret;
+}
+
+struct rte_memseg *
+rte_eal_memseg_hotplug_add(int socket_id, size_t len, uint64_t hugepage_sz)
+{
+	struct rte_mem_config *mcfg = rte_eal_get_configuration()->mem_config;
+	struct hugepage_info *hpi;
+	struct rte_memseg *ms = NULL;
+	int ms_id;
+	unsigned i;
+
+	if (!internal_config.mem_hotplug ||
+			internal_config.process_type != RTE_PROC_PRIMARY ||
+			socket_id < 0 || socket_id >= RTE_MAX_NUMA_NODES ||
+			len == 0)
+		return NULL;
+
+	rte_rwlock_write_lock(memseg_lock(mcfg));
+	rte_spinlock_recursive_lock(&memseg_hotplug_local_lock);
+
+	/* unmap the memsegs the secondary processes released */
+	if (memseg_hotplug_catch_up(mcfg) < 0)
+		goto out;
+
+	ms_id = memseg_hotplug_slot(mcfg);
+	if (ms_id < 0) {
+		RTE_LOG(ERR, EAL, "Cannot add memory, increase "
+				"CONFIG_RTE_MAX_MEMSEG\n");
+		goto out;
+	}
+
+	/* hugepage_info[] is sorted from the biggest size: start with the
+	 * smallest pages, which waste less memory */
+	for (i = internal_config.num_hugepage_sizes; i-- > 0; ) {
+		hpi = &internal_config.hugepage_info[i];
+		if (hpi->hugedir == NULL)
+			continue;
+		if (hugepage_sz != 0 && hpi->hugepage_sz != hugepage_sz)
+			continue;
+		if (memseg_hotplug_map(mcfg, ms_id, hpi, socket_id, len) == 0) {
+			ms = &mcfg->memseg[ms_id];
+			break;
+		}
+	}
+
+out:
+	rte_spinlock_recursive_unlock(&memseg_hotplug_local_lock);
+	rte_rwlock_write_unlock(memseg_lock(mcfg));
+
+	if (ms == NULL) {
+		RTE_LOG(DEBUG, EAL, "Cannot hot-plug %zu bytes on socket %d\n",
+				len, socket_id);
+		return NULL;
+	}
+
+	RTE_LOG(DEBUG, EAL, "Hot-plugged memseg %d: %zu bytes at %p on "
+			"socket %d\n", ms_id, ms->len, ms->addr, socket_id);
+	eal_mem_event_notify(RTE_MEM_EVENT_ADD, ms);
+	return ms;
+}
+
+int
+rte_eal_memseg_is_hotplug(const struct rte_memseg *ms)
+{
+	const struct rte_mem_config *mcfg =
+		rte_eal_get_configuration()->mem_config;
+
+	if (ms < mcfg->memseg || ms >= &mcfg->memseg[RTE_MAX_MEMSEG])
+		return 0;
+	return mcfg->memseg_hotplug[ms - mcfg->memseg].gen != 0;
+}
+
+int
+rte_eal_memseg_hotplug_del(const struct rte_memseg *ms)
+{
+	struct rte_mem_config *mcfg = rte_eal_get_configuration()->mem_config;
+	struct rte_memseg_hotplug *hp;
+	int ms_id;
+
+	if (!rte_eal_memseg_is_hotplug(ms) || ms->len == 0)
+		return -EINVAL;
+
+	ms_id = ms - mcfg->memseg;
+	hp = &mcfg->memseg_hotplug[ms_id];
+
+	/* users (e.g. DMA mappings) must let go while it is still mapped */
+	eal_mem_event_notify(RTE_MEM_EVENT_DEL, ms);
+
+	rte_rwlock_write_lock(memseg_lock(mcfg));
+	rte_spinlock_recursive_lock(&memseg_hotplug_local_lock);
+
+	/* the generation bumped below must not hide older changes */
+	memseg_hotplug_catch_up(mcfg);
+
+	RTE_LOG(DEBUG, EAL, "Releasing memseg %d: %zu bytes at %p\n",
+			ms_id, ms->len, ms->addr);
+	munmap(ms->addr, ms->len);
+	unlink(hp->filepath);
+	/* keep addr and gen: the slot is still known as a hot-plug one */
+	mcfg->memseg[ms_id].len = 0;
+	hp->filepath[0] = '\0';
+	mcfg->memseg_gen = memseg_hotplug_next_gen(mcfg);
+
+	memseg_hotplug_local[ms_id].gen = 0;
+	memseg_hotplug_local_gen = mcfg->memseg_gen;
+	rte_spinlock_recursive_unlock(&memseg_hotplug_local_lock);
+	rte_rwlock_write_unlock(memseg_lock(mcfg));
+
+	return 0;
+}
+
+int
+rte_eal_memseg_hotplug_sync(void)
+{
+	const struct rte_mem_config *mcfg =
+		rte_eal_get_configuration()->mem_config;
+	int ret;
+
+	if (mcfg->memseg_gen == memseg_hotplug_local_gen)
+		return 0;
+
+	rte_rwlock_read_lock(memseg_lock(mcfg));
+	rte_spinlock_recursive_lock(&memseg_hotplug_local_lock);
+	ret = memseg_hotplug_catch_up(mcfg);
+	rte_spinlock_recursive_unlock(&memseg_hotplug_local_lock);
+	rte_rwlock_read_unlock(memseg_lock(mcfg));
+
+	return ret;
+}
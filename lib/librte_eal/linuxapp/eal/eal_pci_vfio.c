@@ -208,6 +208,59 @@ pci_vfio_set_bus_master(int dev_fd)
 	return 0;
 }
 
+/* map or unmap one memseg for DMA. use 1:1 PA to IOVA mapping */
+static int
+pci_vfio_dma_map_memseg(int vfio_container_fd, const struct rte_memseg *ms,
+		int map)
+{
+	int ret;
+
+	if (map) {
+		struct vfio_iommu_type1_dma_map dma_map;
+
+		memset(&dma_map, 0, sizeof(dma_map));
+		dma_map.argsz = sizeof(struct vfio_iommu_type1_dma_map);
+		dma_map.vaddr = ms->addr_64;
+		dma_map.size = ms->len;
+		dma_map.iova = ms->phys_addr;
+		dma_map.flags = VFIO_DMA_MAP_FLAG_READ | VFIO_DMA_MAP_FLAG_WRITE;
+
+		ret = ioctl(vfio_container_fd, VFIO_IOMMU_MAP_DMA, &dma_map);
+		/* already mapped by the memory event callback */
+		if (ret && errno == EEXIST)
+			ret = 0;
+	} else {
+		struct vfio_iommu_type1_dma_unmap dma_unmap;
+
+		memset(&dma_unmap, 0, sizeof(dma_unmap));
+		dma_unmap.argsz = sizeof(struct vfio_iommu_type1_dma_unmap);
+		dma_unmap.size = ms->len;
+		dma_unmap.iova = ms->phys_addr;
+
+		ret = ioctl(vfio_container_fd, VFIO_IOMMU_UNMAP_DMA, &dma_unmap);
+	}
+
+	if (ret) {
+		RTE_LOG(ERR, EAL, "  cannot %s DMA remapping, "
+				"error %i (%s)\n", map ? "set up" : "remove",
+				errno, strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+/* keep DMA mappings in sync with memory hot-plugged at run-time */
+static void
+pci_vfio_mem_event(enum rte_mem_event event, const struct rte_memseg *ms,
+		void *arg)
+{
+	int vfio_container_fd = (int)(intptr_t)arg;
+
+	pci_vfio_dma_map_memseg(vfio_container_fd, ms,
+			event == RTE_MEM_EVENT_ADD);
+}
+
 /* set up DMA mappings */
 static int
 pci_vfio_setup_dma_maps(int vfio_container_fd)
@@ -223,27 +276,24 @@ pci_vfio_setup_dma_maps(int vfio_container_fd)
 		return -1;
 	}
 
-	/* map all DPDK segments for DMA. use 1:1 PA to IOVA mapping */
-	for (i = 0; i < RTE_MAX_MEMSEG; i++) {
-		struct vfio_iommu_type1_dma_map dma_map;
+	/* registered first so that no memseg added meanwhile is missed */
+	ret = rte_mem_event_callback_register(pci_vfio_mem_event,
+			(void *)(intptr_t)vfio_container_fd);
+	if (ret < 0 && ret != -EEXIST) {
+		RTE_LOG(ERR, EAL, "  cannot register memory event callback\n");
+		return -1;
+	}
 
+	/* map all DPDK segments for DMA */
+	for (i = 0; i < RTE_MAX_MEMSEG; i++) {
 		if (ms[i].addr == NULL)
 			break;
+		/* hot-plugged segment released since */
+		if (ms[i].len == 0)
+			continue;
 
-		memset(&dma_map, 0, sizeof(dma_map));
-		dma_map.argsz = sizeof(struct vfio_iommu_type1_dma_map);
-		dma_map.vaddr = ms[i].addr_64;
-		dma_map.size = ms[i].len;
-		dma_map.iova = ms[i].phys_addr;
-		dma_map.flags = VFIO_DMA_MAP_FLAG_READ | VFIO_DMA_MAP_FLAG_WRITE;
-
-		ret = ioctl(vfio_container_fd, VFIO_IOMMU_MAP_DMA, &dma_map);
-
-		if (ret) {
-			RTE_LOG(ERR, EAL, "  cannot set up DMA remapping, "
-					"error %i (%s)\n", errno, strerror(errno));
+		if (pci_vfio_dma_map_memseg(vfio_container_fd, &ms[i], 1) < 0)
 			return -1;
-		}
 	}
 
 	return 0;
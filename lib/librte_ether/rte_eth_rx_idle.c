@@ -0,0 +1,169 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <rte_common.h>
+#include <rte_interrupts.h>
+#include <rte_log.h>
+
+#include "rte_ethdev.h"
+#include "rte_eth_rx_idle.h"
+
+void
+rte_eth_rx_idle_init(struct rte_eth_rx_idle *idle,
+		uint32_t sleep_threshold, int timeout_ms)
+{
+	memset(idle, 0, sizeof(*idle));
+	idle->sleep_threshold = sleep_threshold;
+	idle->timeout_ms = timeout_ms;
+}
+
+#ifdef RTE_EXEC_ENV_LINUXAPP
+
+int
+rte_eth_rx_idle_add_queue(struct rte_eth_rx_idle *idle,
+		uint8_t port_id, uint16_t queue_id)
+{
+	int ret;
+
+	if (idle->nb_queues == RTE_ETH_RX_IDLE_MAX_QUEUES)
+		return -ENOSPC;
+
+	ret = rte_eth_dev_rx_intr_ctl_q(port_id, queue_id,
+			RTE_EPOLL_PER_THREAD, RTE_INTR_EVENT_ADD,
+			(void *)(uintptr_t)idle->nb_queues);
+	if (ret < 0) {
+		RTE_LOG(ERR, PMD, "Cannot register RX interrupt of port %u "
+			"queue %u\n", port_id, queue_id);
+		return ret;
+	}
+
+	idle->queues[idle->nb_queues].port_id = port_id;
+	idle->queues[idle->nb_queues].queue_id = queue_id;
+	idle->nb_queues++;
+
+	return 0;
+}
+
+void
+rte_eth_rx_idle_release(struct rte_eth_rx_idle *idle)
+{
+	uint32_t i;
+
+	for (i = 0; i < idle->nb_queues; i++)
+		rte_eth_dev_rx_intr_ctl_q(idle->queues[i].port_id,
+			idle->queues[i].queue_id, RTE_EPOLL_PER_THREAD,
+			RTE_INTR_EVENT_DEL, NULL);
+	idle->nb_queues = 0;
+}
+
+/* arm the interrupts of all the queues and wait for one of them */
+static int
+eth_rx_idle_sleep(struct rte_eth_rx_idle *idle)
+{
+	struct rte_epoll_event events[RTE_ETH_RX_IDLE_MAX_QUEUES];
+	uint32_t i;
+	int n, ret = 0;
+
+	if (idle->nb_queues == 0)
+		return 0;
+
+	for (i = 0; i < idle->nb_queues; i++) {
+		if (rte_eth_dev_rx_intr_enable(idle->queues[i].port_id,
+				idle->queues[i].queue_id) < 0)
+			break;
+	}
+
+	/* sleeping with a queue not armed could miss its packets */
+	if (i == idle->nb_queues) {
+		n = rte_epoll_wait(RTE_EPOLL_PER_THREAD, events,
+				idle->nb_queues, idle->timeout_ms);
+		idle->nb_sleeps++;
+		if (n > 0)
+			idle->nb_wakeups++;
+		ret = 1;
+	}
+
+	while (i-- > 0)
+		rte_eth_dev_rx_intr_disable(idle->queues[i].port_id,
+				idle->queues[i].queue_id);
+
+	return ret;
+}
+
+#else /* RTE_EXEC_ENV_LINUXAPP */
+
+int
+rte_eth_rx_idle_add_queue(struct rte_eth_rx_idle *idle __rte_unused,
+		uint8_t port_id __rte_unused, uint16_t queue_id __rte_unused)
+{
+	return -ENOTSUP;
+}
+
+void
+rte_eth_rx_idle_release(struct rte_eth_rx_idle *idle)
+{
+	idle->nb_queues = 0;
+}
+
+static int
+eth_rx_idle_sleep(struct rte_eth_rx_idle *idle __rte_unused)
+{
+	return 0;
+}
+
+#endif /* RTE_EXEC_ENV_LINUXAPP */
+
+int
+rte_eth_rx_idle(struct rte_eth_rx_idle *idle, uint32_t nb_rx)
+{
+	uint32_t n;
+
+	if (nb_rx != 0) {
+		idle->empty_polls = 0;
+		return 0;
+	}
+
+	if (++idle->empty_polls < idle->sleep_threshold) {
+		n = RTE_MIN(idle->empty_polls,
+				(uint32_t)RTE_ETH_RX_IDLE_MAX_PAUSE);
+		while (n-- > 0)
+			rte_pause();
+		return 0;
+	}
+
+	idle->empty_polls = 0;
+	return eth_rx_idle_sleep(idle);
+}
@@ -0,0 +1,144 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _RTE_ETH_RX_IDLE_H_
+#define _RTE_ETH_RX_IDLE_H_
+
+/**
+ * @file
+ *
+ * Adaptive polling of RX queues
+ *
+ * An lcore polling RX queues reports the number of packets received by
+ * each polling round. After a number of empty rounds, it backs off
+ * further and further, then arms the RX interrupts of all its queues and
+ * sleeps until a packet is received or a timeout expires. The RX queues
+ * must be configured with intr_conf.rxq set.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/** Maximum number of RX queues polled by an lcore. */
+#define RTE_ETH_RX_IDLE_MAX_QUEUES 32
+
+/** Maximum number of pauses between two empty polling rounds. */
+#define RTE_ETH_RX_IDLE_MAX_PAUSE 64
+
+/**
+ * An RX queue polled by an lcore.
+ */
+struct rte_eth_rx_idle_queue {
+	uint8_t port_id;   /**< Port of the queue. */
+	uint16_t queue_id; /**< Index of the queue. */
+};
+
+/**
+ * Adaptive polling state of an lcore.
+ */
+struct rte_eth_rx_idle {
+	uint32_t nb_queues;       /**< Number of RX queues polled. */
+	uint32_t empty_polls;     /**< Consecutive empty polling rounds. */
+	uint32_t sleep_threshold; /**< Empty rounds before sleeping. */
+	int timeout_ms;           /**< Maximum sleep duration, -1 if none. */
+	uint64_t nb_sleeps;       /**< Number of sleeps. */
+	uint64_t nb_wakeups;      /**< Number of sleeps ended by a packet. */
+	/** RX queues polled. */
+	struct rte_eth_rx_idle_queue queues[RTE_ETH_RX_IDLE_MAX_QUEUES];
+};
+
+/**
+ * Initialize the adaptive polling state of an lcore.
+ *
+ * @param idle
+ *   The adaptive polling state.
+ * @param sleep_threshold
+ *   Number of consecutive empty polling rounds before sleeping.
+ * @param timeout_ms
+ *   Maximum sleep duration in milliseconds, or -1 to sleep until a packet
+ *   is received.
+ */
+void rte_eth_rx_idle_init(struct rte_eth_rx_idle *idle,
+		uint32_t sleep_threshold, int timeout_ms);
+
+/**
+ * Add an RX queue polled by the calling lcore, registering its interrupt
+ * in the epoll instance of the calling thread.
+ *
+ * @param idle
+ *   The adaptive polling state.
+ * @param port_id
+ *   The port identifier of the Ethernet device.
+ * @param queue_id
+ *   The index of the receive queue.
+ * @return
+ *   - 0 on success.
+ *   - (-ENOSPC) if RTE_ETH_RX_IDLE_MAX_QUEUES queues are already polled.
+ *   - (-ENOTSUP) if interrupts are not supported by the environment.
+ *   - Other negative value if the queue interrupt cannot be registered.
+ */
+int rte_eth_rx_idle_add_queue(struct rte_eth_rx_idle *idle,
+		uint8_t port_id, uint16_t queue_id);
+
+/**
+ * Unregister the interrupts of all the RX queues of the calling lcore.
+ *
+ * @param idle
+ *   The adaptive polling state.
+ */
+void rte_eth_rx_idle_release(struct rte_eth_rx_idle *idle);
+
+/**
+ * Report a polling round of all the queues of the calling lcore, and
+ * back off or sleep if it received nothing for a while.
+ *
+ * If an RX interrupt of a queue cannot be enabled, the lcore does not
+ * sleep, but keeps backing off.
+ *
+ * @param idle
+ *   The adaptive polling state.
+ * @param nb_rx
+ *   Number of packets received by the polling round.
+ * @return
+ *   1 if the lcore slept, 0 otherwise.
+ */
+int rte_eth_rx_idle(struct rte_eth_rx_idle *idle, uint32_t nb_rx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTE_ETH_RX_IDLE_H_ */
@@ -217,6 +217,7 @@ rte_eth_dev_allocate(const char *name, enum rte_eth_dev_type type)
 	eth_dev->data->port_id = port_id;
 	eth_dev->attached = DEV_ATTACHED;
 	eth_dev->dev_type = type;
+	eth_dev->intr_handle = NULL;
 	nb_ports++;
 	return eth_dev;
 }
@@ -2580,6 +2581,17 @@ _rte_eth_dev_callback_process(struct rte_eth_dev *dev,
 	rte_spinlock_unlock(&rte_eth_dev_cb_lock);
 }
 
+/* interrupt handle of the RX queues of a device */
+static struct rte_intr_handle *
+eth_dev_intr_handle(struct rte_eth_dev *dev)
+{
+	if (dev->intr_handle != NULL)
+		return dev->intr_handle;
+	if (dev->pci_dev != NULL)
+		return &dev->pci_dev->intr_handle;
+	return NULL;
+}
+
 int
 rte_eth_dev_rx_intr_ctl(uint8_t port_id, int epfd, int op, void *data)
 {
@@ -2595,8 +2607,8 @@ rte_eth_dev_rx_intr_ctl(uint8_t port_id, int epfd, int op, void *data)
 	}
 
 	dev = &rte_eth_devices[port_id];
-	intr_handle = &dev->pci_dev->intr_handle;
-	if (!intr_handle->intr_vec) {
+	intr_handle = eth_dev_intr_handle(dev);
+	if (intr_handle == NULL || !intr_handle->intr_vec) {
 		RTE_PMD_DEBUG_TRACE("RX Intr vector unset\n");
 		return -EPERM;
 	}
@@ -2658,8 +2670,8 @@ rte_eth_dev_rx_intr_ctl_q(uint8_t port_id, uint16_t queue_id,
 		return -EINVAL;
 	}
 
-	intr_handle = &dev->pci_dev->intr_handle;
-	if (!intr_handle->intr_vec) {
+	intr_handle = eth_dev_intr_handle(dev);
+	if (intr_handle == NULL || !intr_handle->intr_vec) {
 		RTE_PMD_DEBUG_TRACE("RX Intr vector unset\n");
 		return -EPERM;
 	}
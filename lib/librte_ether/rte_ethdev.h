@@ -1556,6 +1556,8 @@ struct rte_eth_dev {
 	struct rte_eth_rxtx_callback *pre_tx_burst_cbs[RTE_MAX_QUEUES_PER_PORT];
 	uint8_t attached; /**< Flag indicating the port is attached */
 	enum rte_eth_dev_type dev_type; /**< Flag indicating the device type */
+	/** RX interrupts of a device without PCI interrupts, if not NULL */
+	struct rte_intr_handle *intr_handle;
 };
 
 struct rte_eth_dev_sriov {
@@ -2672,6 +2674,7 @@ rte_eth_tx_burst(uint8_t port_id, uint16_t queue_id,
 enum rte_eth_event_type {
 	RTE_ETH_EVENT_UNKNOWN,  /**< unknown event type */
 	RTE_ETH_EVENT_INTR_LSC, /**< lsc interrupt event */
+	RTE_ETH_EVENT_QUEUE_STATE, /**< queue state event (enabled/disabled) */
 	RTE_ETH_EVENT_MAX       /**< max value of this enum */
 };
 
@@ -0,0 +1,490 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <rte_common.h>
+#include <rte_cycles.h>
+#include <rte_atomic.h>
+#include <rte_errno.h>
+#include <rte_log.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_ethdev.h>
+
+#include "rte_latencystats.h"
+
+/*
+ * The latencies are counted in a log-linear histogram of TSC cycles: the
+ * values below 8 have their own bucket, the others are split in 8 buckets
+ * per power of 2.
+ */
+#define LATENCY_SUB_BUCKETS 8
+#define LATENCY_BUCKETS ((64 - 2) * LATENCY_SUB_BUCKETS)
+
+struct latency_queue {
+	struct rte_eth_rxtx_callback *cb;
+	uint64_t bytes;        /* bytes received or sent on the queue */
+	uint32_t next;         /* packets to skip before the next stamp */
+	uint32_t samp_intvl;
+} __rte_cache_aligned;
+
+/*
+ * State of a port, allocated when the measurement is first enabled on it.
+ * It is never freed, as the lcores may still run a removed callback, but
+ * reset and reused when the measurement is enabled again.
+ */
+struct latency_port {
+	int enabled;
+	uint16_t nb_rxq;
+	uint16_t nb_txq;
+	/* RTE_MAX_QUEUES_PER_PORT each, for any later configuration */
+	struct latency_queue *rxq;
+	struct latency_queue *txq;
+	uint32_t ewma_weight;
+
+	/* updated by the TX callbacks */
+	rte_atomic64_t samples;
+	rte_atomic64_t sum;
+	volatile uint64_t min;
+	volatile uint64_t max;
+	rte_atomic64_t hist[LATENCY_BUCKETS];
+
+	/* updated by rte_latencystats_bitrate_calc() */
+	uint64_t last_tsc;
+	uint64_t last_rx_bytes;
+	uint64_t last_tx_bytes;
+	uint64_t rx_bps;
+	uint64_t tx_bps;
+	uint64_t rx_peak_bps;
+	uint64_t tx_peak_bps;
+};
+
+static struct latency_port *latency_ports[RTE_MAX_ETHPORTS];
+static pthread_mutex_t latency_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline unsigned
+latency_bucket(uint64_t cycles)
+{
+	unsigned exp;
+
+	if (cycles < LATENCY_SUB_BUCKETS)
+		return cycles;
+	exp = 63 - __builtin_clzll(cycles);
+	return (exp - 2) * LATENCY_SUB_BUCKETS +
+		((cycles >> (exp - 3)) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+/* highest number of cycles counted in a bucket */
+static uint64_t
+latency_bucket_max(unsigned bucket)
+{
+	unsigned exp, sub;
+
+	if (bucket < LATENCY_SUB_BUCKETS)
+		return bucket;
+	exp = bucket / LATENCY_SUB_BUCKETS + 2;
+	sub = bucket % LATENCY_SUB_BUCKETS;
+	return ((uint64_t)(LATENCY_SUB_BUCKETS + sub + 1) << (exp - 3)) - 1;
+}
+
+static inline uint64_t
+cycles_to_ns(uint64_t cycles)
+{
+	uint64_t hz = rte_get_tsc_hz();
+
+	return cycles / hz * NS_PER_S + (cycles % hz) * NS_PER_S / hz;
+}
+
+static uint16_t
+latency_rx(uint8_t port __rte_unused, uint16_t queue __rte_unused,
+	struct rte_mbuf **pkts, uint16_t nb_pkts,
+	uint16_t max_pkts __rte_unused, void *user_param)
+{
+	struct latency_queue *q = user_param;
+	uint64_t bytes = 0;
+	uint64_t now;
+	unsigned i;
+
+	/*
+	 * Only the first cache line of the packets is read, the second one
+	 * is written for the stamped packets alone. A packet received again
+	 * without being sent has its stale stamp dropped.
+	 */
+	for (i = 0; i < nb_pkts; i++) {
+		bytes += pkts[i]->pkt_len;
+		pkts[i]->ol_flags &= ~PKT_RX_TIMESTAMP;
+	}
+	q->bytes += bytes;
+
+	if (q->next >= nb_pkts) {
+		q->next -= nb_pkts;
+		return nb_pkts;
+	}
+	now = rte_rdtsc();
+	for (i = q->next; i < nb_pkts; i += q->samp_intvl) {
+		pkts[i]->udata64 = now;
+		pkts[i]->ol_flags |= PKT_RX_TIMESTAMP;
+	}
+	q->next = i - nb_pkts;
+	return nb_pkts;
+}
+
+static void
+latency_record(struct latency_port *lp, uint64_t cycles)
+{
+	uint64_t old;
+
+	rte_atomic64_inc(&lp->hist[latency_bucket(cycles)]);
+	rte_atomic64_add(&lp->sum, cycles);
+	rte_atomic64_inc(&lp->samples);
+	do {
+		old = lp->min;
+	} while (cycles < old &&
+		!rte_atomic64_cmpset(&lp->min, old, cycles));
+	do {
+		old = lp->max;
+	} while (cycles > old &&
+		!rte_atomic64_cmpset(&lp->max, old, cycles));
+}
+
+static uint16_t
+latency_tx(uint8_t port __rte_unused, uint16_t queue,
+	struct rte_mbuf **pkts, uint16_t nb_pkts, void *user_param)
+{
+	struct latency_port *lp = user_param;
+	uint64_t bytes = 0;
+	uint64_t now = 0;
+	unsigned i;
+
+	for (i = 0; i < nb_pkts; i++) {
+		bytes += pkts[i]->pkt_len;
+		if (!(pkts[i]->ol_flags & PKT_RX_TIMESTAMP))
+			continue;
+		if (now == 0)
+			now = rte_rdtsc();
+		latency_record(lp, now - pkts[i]->udata64);
+		pkts[i]->ol_flags &= ~PKT_RX_TIMESTAMP;
+	}
+	lp->txq[queue].bytes += bytes;
+	return nb_pkts;
+}
+
+static void
+latency_reset(struct latency_port *lp)
+{
+	unsigned i;
+
+	for (i = 0; i < LATENCY_BUCKETS; i++)
+		rte_atomic64_clear(&lp->hist[i]);
+	rte_atomic64_clear(&lp->samples);
+	rte_atomic64_clear(&lp->sum);
+	lp->min = UINT64_MAX;
+	lp->max = 0;
+	lp->rx_peak_bps = 0;
+	lp->tx_peak_bps = 0;
+}
+
+static struct latency_port *
+latency_port_alloc(int socket_id)
+{
+	struct latency_port *lp;
+
+	lp = rte_zmalloc_socket("latencystats", sizeof(*lp),
+			RTE_CACHE_LINE_SIZE, socket_id);
+	if (lp == NULL)
+		return NULL;
+	lp->rxq = rte_zmalloc_socket("latencystats",
+			RTE_MAX_QUEUES_PER_PORT * sizeof(*lp->rxq),
+			RTE_CACHE_LINE_SIZE, socket_id);
+	lp->txq = rte_zmalloc_socket("latencystats",
+			RTE_MAX_QUEUES_PER_PORT * sizeof(*lp->txq),
+			RTE_CACHE_LINE_SIZE, socket_id);
+	if (lp->rxq == NULL || lp->txq == NULL) {
+		/* not published yet */
+		rte_free(lp->rxq);
+		rte_free(lp->txq);
+		rte_free(lp);
+		return NULL;
+	}
+	return lp;
+}
+
+/* remove the installed callbacks of a port */
+static void
+latency_port_remove_callbacks(uint8_t port, struct latency_port *lp)
+{
+	uint16_t q;
+
+	for (q = 0; q < lp->nb_rxq; q++) {
+		if (lp->rxq[q].cb != NULL)
+			rte_eth_remove_rx_callback(port, q, lp->rxq[q].cb);
+		lp->rxq[q].cb = NULL;
+	}
+	for (q = 0; q < lp->nb_txq; q++) {
+		if (lp->txq[q].cb != NULL)
+			rte_eth_remove_tx_callback(port, q, lp->txq[q].cb);
+		lp->txq[q].cb = NULL;
+	}
+}
+
+int
+rte_latencystats_enable(uint8_t port, const struct rte_latencystats_conf *conf)
+{
+	static const struct rte_latencystats_conf default_conf = {
+		.samp_intvl = RTE_LATENCYSTATS_DEFAULT_SAMP_INTVL,
+		.ewma_weight = RTE_LATENCYSTATS_DEFAULT_EWMA_WEIGHT,
+	};
+	struct rte_eth_dev_data *dev_data;
+	struct latency_port *lp;
+	uint16_t q;
+	int ret;
+
+	if (conf == NULL)
+		conf = &default_conf;
+	if (!rte_eth_dev_is_valid_port(port) || conf->samp_intvl == 0 ||
+			conf->ewma_weight == 0 || conf->ewma_weight > 100)
+		return -EINVAL;
+	dev_data = rte_eth_devices[port].data;
+	if (dev_data->nb_rx_queues == 0 || dev_data->nb_tx_queues == 0)
+		return -EINVAL;
+
+	pthread_mutex_lock(&latency_lock);
+	lp = latency_ports[port];
+	if (lp != NULL && lp->enabled) {
+		ret = -EEXIST;
+		goto out;
+	}
+
+	if (lp == NULL) {
+		lp = latency_port_alloc(rte_eth_dev_socket_id(port));
+		if (lp == NULL) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		latency_ports[port] = lp;
+	}
+	lp->nb_rxq = dev_data->nb_rx_queues;
+	lp->nb_txq = dev_data->nb_tx_queues;
+	memset(lp->rxq, 0, lp->nb_rxq * sizeof(*lp->rxq));
+	memset(lp->txq, 0, lp->nb_txq * sizeof(*lp->txq));
+	lp->ewma_weight = conf->ewma_weight;
+	latency_reset(lp);
+	lp->last_tsc = rte_rdtsc();
+	lp->last_rx_bytes = 0;
+	lp->last_tx_bytes = 0;
+	lp->rx_bps = 0;
+	lp->tx_bps = 0;
+
+	for (q = 0; q < lp->nb_rxq; q++) {
+		lp->rxq[q].samp_intvl = conf->samp_intvl;
+		lp->rxq[q].cb = rte_eth_add_rx_callback(port, q,
+				latency_rx, &lp->rxq[q]);
+		if (lp->rxq[q].cb == NULL)
+			break;
+	}
+	if (q == lp->nb_rxq) {
+		for (q = 0; q < lp->nb_txq; q++) {
+			lp->txq[q].cb = rte_eth_add_tx_callback(port, q,
+					latency_tx, lp);
+			if (lp->txq[q].cb == NULL)
+				break;
+		}
+		if (q == lp->nb_txq) {
+			lp->enabled = 1;
+			ret = 0;
+			goto out;
+		}
+	}
+
+	ret = -rte_errno;
+	RTE_LOG(ERR, LATENCY, "Cannot add latency callbacks on port %u: %s\n",
+		port, strerror(rte_errno));
+	latency_port_remove_callbacks(port, lp);
+out:
+	pthread_mutex_unlock(&latency_lock);
+	return ret;
+}
+
+int
+rte_latencystats_disable(uint8_t port)
+{
+	struct latency_port *lp;
+
+	if (port >= RTE_MAX_ETHPORTS)
+		return -EINVAL;
+
+	pthread_mutex_lock(&latency_lock);
+	lp = latency_ports[port];
+	if (lp == NULL || !lp->enabled) {
+		pthread_mutex_unlock(&latency_lock);
+		return -ENOENT;
+	}
+	/*
+	 * The callbacks may still be running on the data-plane lcores: the
+	 * state of the port is kept for them, as the callback structures
+	 * themselves are never freed by ethdev.
+	 */
+	latency_port_remove_callbacks(port, lp);
+	lp->enabled = 0;
+	pthread_mutex_unlock(&latency_lock);
+	return 0;
+}
+
+static uint64_t
+latency_ewma(uint64_t avg, uint64_t rate, uint32_t weight)
+{
+	if (rate >= avg)
+		return avg + (rate - avg) * weight / 100;
+	return avg - (avg - rate) * weight / 100;
+}
+
+void
+rte_latencystats_bitrate_calc(void)
+{
+	struct latency_port *lp;
+	uint64_t now, kcycles, khz, rx_bytes, tx_bytes, rate;
+	unsigned port;
+	uint16_t q;
+
+	khz = rte_get_tsc_hz() / 1000;
+	pthread_mutex_lock(&latency_lock);
+	for (port = 0; port < RTE_MAX_ETHPORTS; port++) {
+		lp = latency_ports[port];
+		if (lp == NULL || !lp->enabled)
+			continue;
+
+		rx_bytes = 0;
+		for (q = 0; q < lp->nb_rxq; q++)
+			rx_bytes += lp->rxq[q].bytes;
+		tx_bytes = 0;
+		for (q = 0; q < lp->nb_txq; q++)
+			tx_bytes += lp->txq[q].bytes;
+		now = rte_rdtsc();
+		/* in thousands of cycles, not to overflow at high rates */
+		kcycles = (now - lp->last_tsc) / 1000;
+		if (kcycles == 0)
+			continue;
+
+		rate = (rx_bytes - lp->last_rx_bytes) * 8 * khz / kcycles;
+		lp->rx_bps = latency_ewma(lp->rx_bps, rate, lp->ewma_weight);
+		lp->rx_peak_bps = RTE_MAX(lp->rx_peak_bps, rate);
+		rate = (tx_bytes - lp->last_tx_bytes) * 8 * khz / kcycles;
+		lp->tx_bps = latency_ewma(lp->tx_bps, rate, lp->ewma_weight);
+		lp->tx_peak_bps = RTE_MAX(lp->tx_peak_bps, rate);
+
+		lp->last_tsc = now;
+		lp->last_rx_bytes = rx_bytes;
+		lp->last_tx_bytes = tx_bytes;
+	}
+	pthread_mutex_unlock(&latency_lock);
+}
+
+int
+rte_latencystats_get(uint8_t port, struct rte_latencystats *stats)
+{
+	static const struct {
+		unsigned permille;
+		size_t offset;
+	} percentiles[] = {
+		{ 500, offsetof(struct rte_latencystats, p50_ns) },
+		{ 900, offsetof(struct rte_latencystats, p90_ns) },
+		{ 990, offsetof(struct rte_latencystats, p99_ns) },
+		{ 999, offsetof(struct rte_latencystats, p999_ns) },
+	};
+	struct latency_port *lp;
+	uint64_t hist[LATENCY_BUCKETS];
+	uint64_t samples, count, rank, cycles;
+	unsigned b, p;
+
+	if (port >= RTE_MAX_ETHPORTS || stats == NULL)
+		return -EINVAL;
+
+	pthread_mutex_lock(&latency_lock);
+	lp = latency_ports[port];
+	if (lp == NULL || !lp->enabled) {
+		pthread_mutex_unlock(&latency_lock);
+		return -ENOENT;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	stats->rx_bps = lp->rx_bps;
+	stats->tx_bps = lp->tx_bps;
+	stats->rx_peak_bps = lp->rx_peak_bps;
+	stats->tx_peak_bps = lp->tx_peak_bps;
+
+	/* count the samples from the histogram, updated last */
+	samples = 0;
+	for (b = 0; b < LATENCY_BUCKETS; b++) {
+		hist[b] = rte_atomic64_read(&lp->hist[b]);
+		samples += hist[b];
+	}
+	if (samples != 0) {
+		stats->samples = samples;
+		stats->min_ns = cycles_to_ns(lp->min);
+		stats->max_ns = cycles_to_ns(lp->max);
+		stats->avg_ns = cycles_to_ns(rte_atomic64_read(&lp->sum) /
+			RTE_MAX(rte_atomic64_read(&lp->samples), 1));
+
+		count = 0;
+		b = 0;
+		for (p = 0; p < RTE_DIM(percentiles); p++) {
+			rank = (samples * percentiles[p].permille + 999) / 1000;
+			while (count + hist[b] < rank)
+				count += hist[b++];
+			cycles = RTE_MIN(latency_bucket_max(b), lp->max);
+			*(uint64_t *)((char *)stats + percentiles[p].offset) =
+				RTE_MAX(cycles_to_ns(cycles), stats->min_ns);
+		}
+	}
+	pthread_mutex_unlock(&latency_lock);
+	return 0;
+}
+
+int
+rte_latencystats_reset(uint8_t port)
+{
+	if (port >= RTE_MAX_ETHPORTS)
+		return -EINVAL;
+
+	pthread_mutex_lock(&latency_lock);
+	if (latency_ports[port] == NULL || !latency_ports[port]->enabled) {
+		pthread_mutex_unlock(&latency_lock);
+		return -ENOENT;
+	}
+	latency_reset(latency_ports[port]);
+	pthread_mutex_unlock(&latency_lock);
+	return 0;
+}
@@ -0,0 +1,168 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _RTE_LATENCYSTATS_H_
+#define _RTE_LATENCYSTATS_H_
+
+/**
+ * @file
+ * RTE Latency Statistics
+ *
+ * Measure the latency of the packets between their reception and their
+ * transmission, and the bit rates of the ports, without changing the
+ * application. RX and TX callbacks are installed on all the queues of a
+ * port: the RX callbacks stamp one packet out of samp_intvl received with
+ * the TSC, in the udata64 field of the mbuf, and flag it PKT_RX_TIMESTAMP;
+ * the TX callbacks add the age of the flagged packets to a latency
+ * histogram of the port. Both count the bytes of all the packets for the
+ * bit rates.
+ *
+ * The udata64 field of the sampled packets is overwritten, so the
+ * application must not use it on the measured ports.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/** Default sampling interval, in packets. */
+#define RTE_LATENCYSTATS_DEFAULT_SAMP_INTVL 64
+/** Default weight of the last period in the bit rates, in percent. */
+#define RTE_LATENCYSTATS_DEFAULT_EWMA_WEIGHT 20
+
+/**
+ * Latency measurement configuration.
+ */
+struct rte_latencystats_conf {
+	/** Stamp one packet out of samp_intvl received per queue. */
+	uint32_t samp_intvl;
+	/**
+	 * Weight of the last period in the exponentially weighted moving
+	 * average of the bit rates, in percent; 100 for no averaging.
+	 */
+	uint32_t ewma_weight;
+};
+
+/**
+ * Latency and bit rate statistics of a port.
+ *
+ * The percentiles are computed from a histogram with a resolution of
+ * 12.5%, they are the upper bound of their bucket.
+ */
+struct rte_latencystats {
+	uint64_t samples;     /**< Number of measured packets. */
+	uint64_t min_ns;      /**< Minimum latency. */
+	uint64_t avg_ns;      /**< Average latency. */
+	uint64_t max_ns;      /**< Maximum latency. */
+	uint64_t p50_ns;      /**< Median latency. */
+	uint64_t p90_ns;      /**< 90th percentile of the latency. */
+	uint64_t p99_ns;      /**< 99th percentile of the latency. */
+	uint64_t p999_ns;     /**< 99.9th percentile of the latency. */
+	uint64_t rx_bps;      /**< Average RX bit rate. */
+	uint64_t tx_bps;      /**< Average TX bit rate. */
+	uint64_t rx_peak_bps; /**< Peak RX bit rate. */
+	uint64_t tx_peak_bps; /**< Peak TX bit rate. */
+};
+
+/**
+ * Start measuring the latency and bit rates of a port, by installing RX and
+ * TX callbacks on all its queues. The port must be configured, and the
+ * measurement disabled before it is configured again.
+ *
+ * @param port
+ *   The port identifier.
+ * @param conf
+ *   The configuration, or NULL for the default one.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if the port or the configuration is invalid.
+ *   - (-EEXIST) if the measurement is already enabled on the port.
+ *   - (-ENOMEM) if the statistics cannot be allocated.
+ *   - (-ENOTSUP) if the ethdev RX/TX callbacks are not compiled in.
+ */
+int rte_latencystats_enable(uint8_t port,
+		const struct rte_latencystats_conf *conf);
+
+/**
+ * Stop measuring the latency and bit rates of a port. Its statistics are
+ * lost.
+ *
+ * @param port
+ *   The port identifier.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if the port is invalid.
+ *   - (-ENOENT) if the measurement is not enabled on the port.
+ */
+int rte_latencystats_disable(uint8_t port);
+
+/**
+ * Update the bit rates of all the measured ports from the bytes counted
+ * since the previous call. It should be called periodically, for example
+ * once per second, by a single thread.
+ */
+void rte_latencystats_bitrate_calc(void);
+
+/**
+ * Get the statistics of a port.
+ *
+ * @param port
+ *   The port identifier.
+ * @param stats
+ *   The structure filled with the statistics.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if an argument is invalid.
+ *   - (-ENOENT) if the measurement is not enabled on the port.
+ */
+int rte_latencystats_get(uint8_t port, struct rte_latencystats *stats);
+
+/**
+ * Reset the latency statistics and peak bit rates of a port.
+ *
+ * @param port
+ *   The port identifier.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if the port is invalid.
+ *   - (-ENOENT) if the measurement is not enabled on the port.
+ */
+int rte_latencystats_reset(uint8_t port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTE_LATENCYSTATS_H_ */
@@ -98,6 +98,7 @@ extern "C" {
 #define PKT_RX_FDIR_ID       (1ULL << 13) /**< FD id reported if FDIR match. */
 #define PKT_RX_FDIR_FLX      (1ULL << 14) /**< Flexible bytes reported if FDIR match. */
 #define PKT_RX_QINQ_PKT      (1ULL << 15)  /**< RX packet with double VLAN stripped. */
+#define PKT_RX_TIMESTAMP     (1ULL << 16) /**< RX TSC stamp in udata64. */
 /* add new RX flags here */
 
 /* add new TX flags here */
@@ -671,6 +671,22 @@ rte_mempool_count(const struct rte_mempool *mp)
 	return count;
 }
 
+/* return the number of entries in the cache of an lcore */
+unsigned
+rte_mempool_cache_count(const struct rte_mempool *mp, unsigned lcore_id)
+{
+#if RTE_MEMPOOL_CACHE_MAX_SIZE > 0
+	if (mp->cache_size == 0 || lcore_id >= RTE_MAX_LCORE)
+		return 0;
+
+	return mp->local_cache[lcore_id].len;
+#else
+	RTE_SET_USED(mp);
+	RTE_SET_USED(lcore_id);
+	return 0;
+#endif
+}
+
 /* dump the cache status */
 static unsigned
 rte_mempool_dump_cache(FILE *f, const struct rte_mempool *mp)
@@ -1189,6 +1189,24 @@ rte_mempool_get(struct rte_mempool *mp, void **obj_p)
  */
 unsigned rte_mempool_count(const struct rte_mempool *mp);
 
+/**
+ * Return the number of entries in the cache of an lcore.
+ *
+ * The cache is read without synchronization, so the value may be stale
+ * when the lcore is running; it can be called from any lcore or process,
+ * e.g. to monitor how full the caches are.
+ *
+ * @param mp
+ *   A pointer to the mempool structure.
+ * @param lcore_id
+ *   The lcore whose cache is read.
+ * @return
+ *   The number of entries in the cache of the lcore, 0 if the mempool
+ *   has no cache or lcore_id is invalid.
+ */
+unsigned rte_mempool_cache_count(const struct rte_mempool *mp,
+		unsigned lcore_id);
+
 /**
  * Return the number of free entries in the mempool ring.
  * i.e. how many entries can be freed back to the mempool.
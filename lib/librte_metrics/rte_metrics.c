@@ -0,0 +1,418 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include <rte_common.h>
+#include <rte_eal.h>
+#include <rte_log.h>
+#include <rte_memzone.h>
+#include <rte_lcore.h>
+#include <rte_spinlock.h>
+
+#include "rte_metrics.h"
+
+#define METRICS_MZ_NAME "RTE_METRICS"
+
+/* period of the server checks for a stop request */
+#define METRICS_SERVER_POLL_MS 100
+/* maximum time to wait for a client request */
+#define METRICS_SERVER_TIMEOUT_S 1
+#define METRICS_REQUEST_SIZE 16
+
+struct rte_metrics_data *rte_metrics_shared;
+
+static struct {
+	pthread_t thread;
+	int fd;
+	volatile int running;
+	struct sockaddr_un addr;
+} metrics_server = { .fd = -1 };
+
+int
+rte_metrics_init(int socket_id)
+{
+	const struct rte_memzone *mz;
+
+	if (rte_metrics_shared != NULL)
+		return 0;
+
+	if (rte_eal_process_type() == RTE_PROC_PRIMARY) {
+		mz = rte_memzone_lookup(METRICS_MZ_NAME);
+		if (mz == NULL) {
+			mz = rte_memzone_reserve(METRICS_MZ_NAME,
+				sizeof(struct rte_metrics_data), socket_id, 0);
+			if (mz == NULL) {
+				RTE_LOG(ERR, METRICS, "Cannot reserve metrics "
+					"memzone\n");
+				return -ENOMEM;
+			}
+			memset(mz->addr, 0, sizeof(struct rte_metrics_data));
+			rte_spinlock_init(&((struct rte_metrics_data *)
+				mz->addr)->lock);
+		}
+	} else {
+		mz = rte_memzone_lookup(METRICS_MZ_NAME);
+		if (mz == NULL)
+			return -ENOENT;
+	}
+
+	rte_metrics_shared = mz->addr;
+	return 0;
+}
+
+static int
+metrics_name_valid(const char *name)
+{
+	size_t i, len;
+
+	if (name == NULL)
+		return 0;
+	len = strnlen(name, RTE_METRICS_NAME_SIZE);
+	if (len == 0 || len == RTE_METRICS_NAME_SIZE)
+		return 0;
+	for (i = 0; i < len; i++)
+		if (!isprint((unsigned char)name[i]))
+			return 0;
+	return 1;
+}
+
+int
+rte_metrics_reg_names(const char * const *names, uint16_t count)
+{
+	struct rte_metrics_data *m = rte_metrics_shared;
+	uint16_t i, j, first;
+	unsigned lcore_id;
+	int ret;
+
+	if (m == NULL)
+		return -EIO;
+	if (names == NULL || count == 0)
+		return -EINVAL;
+	for (i = 0; i < count; i++)
+		if (!metrics_name_valid(names[i]))
+			return -EINVAL;
+
+	rte_spinlock_lock(&m->lock);
+	first = m->nb_metrics;
+	if (count > RTE_METRICS_MAX_METRICS - first) {
+		ret = -ENOSPC;
+		goto out;
+	}
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < first + i; j++) {
+			if (strcmp(m->names[j].name, names[i]) == 0) {
+				ret = -EEXIST;
+				goto out;
+			}
+		}
+		snprintf(m->names[first + i].name, RTE_METRICS_NAME_SIZE,
+			"%s", names[i]);
+	}
+	for (lcore_id = 0; lcore_id <= RTE_MAX_LCORE; lcore_id++)
+		for (i = 0; i < count; i++)
+			m->lcores[lcore_id].values[first + i] = 0;
+
+	/* the names are complete before the readers see them */
+	rte_wmb();
+	m->nb_metrics = first + count;
+	ret = first;
+out:
+	rte_spinlock_unlock(&m->lock);
+	return ret;
+}
+
+int
+rte_metrics_reg_name(const char *name)
+{
+	return rte_metrics_reg_names(&name, 1);
+}
+
+int
+rte_metrics_get_names(struct rte_metric_name *names, uint16_t capacity)
+{
+	struct rte_metrics_data *m = rte_metrics_shared;
+	uint16_t nb;
+
+	if (m == NULL)
+		return -EIO;
+
+	nb = m->nb_metrics;
+	rte_rmb();
+	if (names != NULL && nb <= capacity)
+		memcpy(names, m->names, nb * sizeof(names[0]));
+	return nb;
+}
+
+int
+rte_metrics_get_values(struct rte_metric_value *values, uint16_t capacity)
+{
+	struct rte_metrics_data *m = rte_metrics_shared;
+	unsigned lcore_id;
+	uint16_t i, nb;
+
+	if (m == NULL)
+		return -EIO;
+
+	nb = m->nb_metrics;
+	if (values == NULL || nb > capacity)
+		return nb;
+
+	for (i = 0; i < nb; i++) {
+		values[i].key = i;
+		values[i].value = 0;
+	}
+	for (lcore_id = 0; lcore_id <= RTE_MAX_LCORE; lcore_id++)
+		for (i = 0; i < nb; i++)
+			values[i].value += m->lcores[lcore_id].values[i];
+	return nb;
+}
+
+/*
+ * Append to the string of size bytes at buf, return the new length. On
+ * truncation, the string is cut at size - 1 bytes instead of overflowing.
+ */
+static size_t
+metrics_append(char *buf, size_t size, size_t off, const char *format, ...)
+{
+	va_list ap;
+	int ret;
+
+	if (off >= size - 1)
+		return off;
+	va_start(ap, format);
+	ret = vsnprintf(buf + off, size - off, format, ap);
+	va_end(ap);
+	if (ret < 0)
+		return off;
+	return RTE_MIN(off + ret, size - 1);
+}
+
+/* copy a metric name as the content of a JSON string */
+static void
+metrics_json_escape(char *dst, const char *name)
+{
+	size_t len = 0;
+	unsigned char c;
+	unsigned i;
+
+	for (i = 0; i < RTE_METRICS_NAME_SIZE && name[i] != '\0'; i++) {
+		c = name[i];
+		if (c == '"' || c == '\\') {
+			dst[len++] = '\\';
+			dst[len++] = c;
+		} else if (c < 0x20)
+			len += sprintf(dst + len, "\\u%04x", c);
+		else
+			dst[len++] = c;
+	}
+	dst[len] = '\0';
+}
+
+/* snapshot of all the metrics, allocated with malloc() */
+static char *
+metrics_snapshot(int json, size_t *len)
+{
+	struct rte_metric_name names[RTE_METRICS_MAX_METRICS];
+	struct rte_metric_value values[RTE_METRICS_MAX_METRICS];
+	struct rte_metrics_snapshot_hdr *hdr;
+	char name[RTE_METRICS_NAME_SIZE * 6 + 1];
+	uint64_t *bin_values;
+	size_t size, off = 0;
+	char *buf;
+	int i, nb;
+
+	nb = rte_metrics_get_names(names, RTE_METRICS_MAX_METRICS);
+	if (nb < 0)
+		return NULL;
+	/* metrics registered meanwhile are not part of the snapshot */
+	rte_metrics_get_values(values, RTE_METRICS_MAX_METRICS);
+
+	if (!json) {
+		size = sizeof(*hdr) + nb * (sizeof(names[0]) + sizeof(uint64_t));
+		buf = malloc(size);
+		if (buf == NULL)
+			return NULL;
+		hdr = (struct rte_metrics_snapshot_hdr *)buf;
+		hdr->magic = RTE_METRICS_SNAPSHOT_MAGIC;
+		hdr->version = RTE_METRICS_SNAPSHOT_VERSION;
+		hdr->nb_metrics = nb;
+		memcpy(&hdr[1], names, nb * sizeof(names[0]));
+		bin_values = RTE_PTR_ADD(&hdr[1], nb * sizeof(names[0]));
+		for (i = 0; i < nb; i++)
+			bin_values[i] = values[i].value;
+		*len = size;
+		return buf;
+	}
+
+	/* "name": value, with a 20 digits value and names escaped as \u00XX
+	 * in the worst case */
+	size = 16 + nb * (sizeof(name) + 28);
+	buf = malloc(size);
+	if (buf == NULL)
+		return NULL;
+	off = metrics_append(buf, size, off, "{\"metrics\":{");
+	for (i = 0; i < nb; i++) {
+		metrics_json_escape(name, names[i].name);
+		off = metrics_append(buf, size, off, "%s\"%s\":%"PRIu64,
+			i ? "," : "", name, values[i].value);
+	}
+	off = metrics_append(buf, size, off, "}}\n");
+	*len = off;
+	return buf;
+}
+
+static void
+metrics_serve(int fd)
+{
+	struct timeval tv = { .tv_sec = METRICS_SERVER_TIMEOUT_S };
+	char req[METRICS_REQUEST_SIZE];
+	char *buf;
+	size_t len, off;
+	ssize_t n;
+	int json;
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+	n = read(fd, req, sizeof(req) - 1);
+	if (n <= 0)
+		return;
+	req[n] = '\0';
+	if (strncmp(req, "json", 4) == 0)
+		json = 1;
+	else if (strncmp(req, "binary", 6) == 0)
+		json = 0;
+	else
+		return;
+
+	buf = metrics_snapshot(json, &len);
+	if (buf == NULL)
+		return;
+	for (off = 0; off < len; off += n) {
+		n = write(fd, buf + off, len - off);
+		if (n <= 0)
+			break;
+	}
+	free(buf);
+}
+
+static void *
+metrics_server_main(__attribute__((unused)) void *arg)
+{
+	struct pollfd pfd = { .fd = metrics_server.fd, .events = POLLIN };
+	int fd;
+
+	while (metrics_server.running) {
+		if (poll(&pfd, 1, METRICS_SERVER_POLL_MS) <= 0)
+			continue;
+		fd = accept(metrics_server.fd, NULL, NULL);
+		if (fd < 0)
+			continue;
+		metrics_serve(fd);
+		close(fd);
+	}
+	return NULL;
+}
+
+int
+rte_metrics_server_start(const char *path)
+{
+	struct sockaddr_un *addr = &metrics_server.addr;
+	int fd, ret;
+
+	if (rte_metrics_shared == NULL)
+		return -EIO;
+	if (metrics_server.running)
+		return -EALREADY;
+	if (path == NULL || strlen(path) >= sizeof(addr->sun_path))
+		return -EINVAL;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -errno;
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	snprintf(addr->sun_path, sizeof(addr->sun_path), "%s", path);
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)addr, sizeof(*addr)) < 0 ||
+			listen(fd, 8) < 0) {
+		ret = -errno;
+		RTE_LOG(ERR, METRICS, "Cannot listen on metrics socket %s\n",
+			path);
+		close(fd);
+		return ret;
+	}
+
+	metrics_server.fd = fd;
+	metrics_server.running = 1;
+	ret = pthread_create(&metrics_server.thread, NULL,
+			metrics_server_main, NULL);
+	if (ret != 0) {
+		RTE_LOG(ERR, METRICS, "Cannot create metrics server thread\n");
+		metrics_server.running = 0;
+		metrics_server.fd = -1;
+		close(fd);
+		unlink(path);
+		return -ret;
+	}
+#ifdef rte_thread_setname
+	rte_thread_setname(metrics_server.thread, "metrics-server");
+#endif
+	return 0;
+}
+
+void
+rte_metrics_server_stop(void)
+{
+	if (!metrics_server.running)
+		return;
+
+	metrics_server.running = 0;
+	pthread_join(metrics_server.thread, NULL);
+	close(metrics_server.fd);
+	metrics_server.fd = -1;
+	unlink(metrics_server.addr.sun_path);
+}
@@ -0,0 +1,262 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _RTE_METRICS_H_
+#define _RTE_METRICS_H_
+
+/**
+ * @file
+ * RTE Metrics
+ *
+ * Components register named counters in shared memory, updated on the
+ * data path by a plain per-lcore increment: each lcore has its own copy of
+ * every counter, summed when read. The metrics can be read by any process
+ * of the application, or served by a thread over a Unix socket, as JSON
+ * or in a binary form.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include <rte_common.h>
+#include <rte_memory.h>
+#include <rte_lcore.h>
+#include <rte_atomic.h>
+#include <rte_branch_prediction.h>
+#include <rte_spinlock.h>
+
+#ifndef RTE_METRICS_MAX_METRICS
+/** Maximum number of metrics. */
+#define RTE_METRICS_MAX_METRICS 256
+#endif
+
+/** Maximum length of a metric name, including the '\0'. */
+#define RTE_METRICS_NAME_SIZE 64
+
+/** Name of a metric. */
+struct rte_metric_name {
+	char name[RTE_METRICS_NAME_SIZE]; /**< Metric name. */
+};
+
+/** Value of a metric. */
+struct rte_metric_value {
+	uint16_t key;   /**< Key of the metric, index of its name. */
+	uint64_t value; /**< Value of the metric, summed over all lcores. */
+};
+
+/** Magic number of a binary snapshot, "RTEM". */
+#define RTE_METRICS_SNAPSHOT_MAGIC 0x4d455452
+
+/** Version of the binary snapshot format. */
+#define RTE_METRICS_SNAPSHOT_VERSION 1
+
+/**
+ * Header of a binary snapshot sent by the metrics server. It is followed
+ * by nb_metrics struct rte_metric_name, then nb_metrics uint64_t values,
+ * all in host byte order.
+ */
+struct rte_metrics_snapshot_hdr {
+	uint32_t magic;      /**< RTE_METRICS_SNAPSHOT_MAGIC. */
+	uint16_t version;    /**< RTE_METRICS_SNAPSHOT_VERSION. */
+	uint16_t nb_metrics; /**< Number of metrics. */
+};
+
+/**
+ * @internal
+ * Values of the metrics updated by an lcore.
+ */
+struct rte_metrics_lcore {
+	uint64_t values[RTE_METRICS_MAX_METRICS];
+} __rte_cache_aligned;
+
+/**
+ * @internal
+ * Metrics in shared memory. The last lcore slot is shared by the non-EAL
+ * threads, and updated atomically.
+ */
+struct rte_metrics_data {
+	rte_spinlock_t lock;      /**< Serializes the registrations. */
+	volatile uint16_t nb_metrics;
+	struct rte_metric_name names[RTE_METRICS_MAX_METRICS];
+	struct rte_metrics_lcore lcores[RTE_MAX_LCORE + 1];
+};
+
+/** @internal Metrics of the process, set by rte_metrics_init(). */
+extern struct rte_metrics_data *rte_metrics_shared;
+
+/**
+ * Initialize the metrics of the calling process. The primary process
+ * reserves them in a memzone, the secondary processes attach to it. Does
+ * nothing if already initialized.
+ *
+ * @param socket_id
+ *   NUMA socket of the memzone, or SOCKET_ID_ANY.
+ * @return
+ *   - 0 on success.
+ *   - (-ENOMEM) if the memzone cannot be reserved.
+ *   - (-ENOENT) if a secondary process finds no metrics.
+ */
+int rte_metrics_init(int socket_id);
+
+/**
+ * Register a metric, initialized to 0.
+ *
+ * @param name
+ *   Unique name of the metric, made of printable characters.
+ * @return
+ *   - The key of the metric on success.
+ *   - (-EINVAL) if the name is invalid.
+ *   - (-EEXIST) if a metric with the same name already exists.
+ *   - (-ENOSPC) if RTE_METRICS_MAX_METRICS metrics are registered.
+ *   - (-EIO) if the metrics are not initialized.
+ */
+int rte_metrics_reg_name(const char *name);
+
+/**
+ * Register a set of metrics with consecutive keys.
+ *
+ * @param names
+ *   Names of the metrics, see rte_metrics_reg_name().
+ * @param count
+ *   Number of names.
+ * @return
+ *   - The key of the first metric on success.
+ *   - A negative value on error, see rte_metrics_reg_name(). No metric is
+ *     registered then.
+ */
+int rte_metrics_reg_names(const char * const *names, uint16_t count);
+
+/**
+ * Add to a metric. On an lcore, this is a plain increment of its own copy
+ * of the metric.
+ *
+ * @param key
+ *   Key of the metric, returned by its registration.
+ * @param value
+ *   Value to add.
+ */
+static inline void
+rte_metrics_add(uint16_t key, uint64_t value)
+{
+	unsigned lcore_id = rte_lcore_id();
+
+	if (likely(lcore_id < RTE_MAX_LCORE))
+		rte_metrics_shared->lcores[lcore_id].values[key] += value;
+	else
+		rte_atomic64_add((rte_atomic64_t *)
+			&rte_metrics_shared->lcores[RTE_MAX_LCORE].values[key],
+			value);
+}
+
+/**
+ * Set the copy of a metric of the calling lcore. A metric which is not a
+ * counter, e.g. a queue depth, should be set by a single lcore only, as
+ * the copies of all lcores are summed when read.
+ *
+ * @param key
+ *   Key of the metric, returned by its registration.
+ * @param value
+ *   Value of the metric.
+ */
+static inline void
+rte_metrics_set(uint16_t key, uint64_t value)
+{
+	unsigned lcore_id = rte_lcore_id();
+
+	if (likely(lcore_id < RTE_MAX_LCORE))
+		rte_metrics_shared->lcores[lcore_id].values[key] = value;
+	else
+		rte_atomic64_set((rte_atomic64_t *)
+			&rte_metrics_shared->lcores[RTE_MAX_LCORE].values[key],
+			value);
+}
+
+/**
+ * Get the names of the metrics, indexed by key.
+ *
+ * @param names
+ *   Array filled with the names, may be NULL to get the number of metrics.
+ * @param capacity
+ *   Size of the names array.
+ * @return
+ *   - The number of metrics; if greater than capacity, the array is not
+ *     filled.
+ *   - (-EIO) if the metrics are not initialized.
+ */
+int rte_metrics_get_names(struct rte_metric_name *names, uint16_t capacity);
+
+/**
+ * Get the values of the metrics, summed over all lcores.
+ *
+ * @param values
+ *   Array filled with the values, may be NULL to get the number of
+ *   metrics.
+ * @param capacity
+ *   Size of the values array.
+ * @return
+ *   - The number of metrics; if greater than capacity, the array is not
+ *     filled.
+ *   - (-EIO) if the metrics are not initialized.
+ */
+int rte_metrics_get_values(struct rte_metric_value *values,
+		uint16_t capacity);
+
+/**
+ * Start a thread serving the metrics on a Unix stream socket. A client
+ * connects, sends "json\n" or "binary\n", and receives a snapshot of all
+ * the metrics before the connection is closed.
+ *
+ * @param path
+ *   Path of the socket, replaced if it exists.
+ * @return
+ *   - 0 on success.
+ *   - (-EALREADY) if the server is already started.
+ *   - (-EIO) if the metrics are not initialized.
+ *   - Other negative errno value if the socket or thread cannot be
+ *     created.
+ */
+int rte_metrics_server_start(const char *path);
+
+/**
+ * Stop the metrics server thread and remove its socket.
+ */
+void rte_metrics_server_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTE_METRICS_H_ */
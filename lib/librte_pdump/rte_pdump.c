@@ -0,0 +1,612 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include <rte_common.h>
+#include <rte_eal.h>
+#include <rte_log.h>
+#include <rte_errno.h>
+#include <rte_memory.h>
+#include <rte_memzone.h>
+#include <rte_malloc.h>
+#include <rte_memcpy.h>
+#include <rte_atomic.h>
+#include <rte_mbuf.h>
+#include <rte_ethdev.h>
+
+#include "rte_pdump.h"
+
+#define PDUMP_MZ_NAME "RTE_PDUMP"
+
+/* period of the server checks for a stop request */
+#define PDUMP_SERVER_POLL_MS 100
+/* maximum time to wait for a request or a response */
+#define PDUMP_TIMEOUT_S 5
+
+enum pdump_op {
+	PDUMP_OP_ENABLE = 1,
+	PDUMP_OP_DISABLE = 2,
+};
+
+struct pdump_request {
+	uint16_t op;
+	uint16_t queue;
+	uint32_t flags;
+	uint8_t port;
+	char ring_name[RTE_RING_NAMESIZE];
+	char mp_name[RTE_MEMPOOL_NAMESIZE];
+	struct rte_pdump_filter filter;
+};
+
+struct pdump_response {
+	int32_t err;
+};
+
+/* published by the primary process */
+struct pdump_shared {
+	char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+};
+
+/*
+ * capture of a port queue in one direction, enabled while cb is set.
+ * Allocated on the first request for the queue and never freed, as the
+ * lcores may still run a removed callback: it is reused on next enable.
+ * The callbacks count themselves in active before checking enabled, so
+ * that the disabler knows when none of them uses the ring any more.
+ */
+struct pdump_ctx {
+	rte_atomic32_t active;
+	volatile uint32_t enabled;
+	void *cb;
+	struct rte_ring *ring;
+	struct rte_mempool *mp;
+	uint32_t flags;
+	struct rte_pdump_filter filter;
+};
+
+static struct pdump_ctx *rx_ctx[RTE_MAX_ETHPORTS][RTE_MAX_QUEUES_PER_PORT];
+static struct pdump_ctx *tx_ctx[RTE_MAX_ETHPORTS][RTE_MAX_QUEUES_PER_PORT];
+/* serializes the requests */
+static pthread_mutex_t pdump_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct {
+	pthread_t thread;
+	int fd;
+	volatile int running;
+	struct sockaddr_un addr;
+} pdump_server = { .fd = -1 };
+
+/* copy the first snaplen bytes of a packet into a new mbuf */
+static struct rte_mbuf *
+pdump_pktmbuf_copy(struct rte_mbuf *m, struct rte_mempool *mp,
+		uint32_t snaplen)
+{
+	struct rte_mbuf *seg, *dup;
+	uint32_t len, off = 0;
+	char *data;
+
+	dup = rte_pktmbuf_alloc(mp);
+	if (unlikely(dup == NULL))
+		return NULL;
+
+	snaplen = RTE_MIN(snaplen, (uint32_t)rte_pktmbuf_tailroom(dup));
+	data = rte_pktmbuf_mtod(dup, char *);
+	for (seg = m; seg != NULL && off < snaplen; seg = seg->next) {
+		len = RTE_MIN((uint32_t)seg->data_len, snaplen - off);
+		rte_memcpy(data + off, rte_pktmbuf_mtod(seg, char *), len);
+		off += len;
+	}
+	dup->data_len = off;
+	dup->pkt_len = off;
+	dup->port = m->port;
+	dup->vlan_tci = m->vlan_tci;
+	dup->packet_type = m->packet_type;
+	return dup;
+}
+
+/* reference a packet, truncated to snaplen if it has one segment */
+static struct rte_mbuf *
+pdump_pktmbuf_ref(struct rte_mbuf *m, struct rte_mempool *mp,
+		uint32_t snaplen)
+{
+	struct rte_mbuf *dup;
+
+	dup = rte_pktmbuf_clone(m, mp);
+	if (unlikely(dup == NULL))
+		return NULL;
+	if (dup->nb_segs == 1 && snaplen < dup->pkt_len) {
+		dup->data_len = snaplen;
+		dup->pkt_len = snaplen;
+	}
+	return dup;
+}
+
+static void
+pdump_capture(struct rte_mbuf **pkts, uint16_t nb_pkts,
+		const struct pdump_ctx *ctx)
+{
+	const struct rte_pdump_filter *filter = &ctx->filter;
+	struct rte_mbuf *dups[nb_pkts];
+	struct rte_mbuf *m;
+	uint32_t snaplen;
+	unsigned i, nb_dups = 0, nb_enq;
+
+	for (i = 0; i < nb_pkts; i++) {
+		m = pkts[i];
+		snaplen = m->pkt_len;
+		if (filter->nb_insns != 0) {
+			snaplen = RTE_MIN(snaplen, rte_pdump_bpf_filter(
+				filter->insns, rte_pktmbuf_mtod(m, uint8_t *),
+				m->pkt_len, m->data_len));
+			if (snaplen == 0)
+				continue;
+		}
+		if (filter->snaplen != 0)
+			snaplen = RTE_MIN(snaplen, filter->snaplen);
+
+		if (ctx->flags & RTE_PDUMP_FLAG_REF)
+			dups[nb_dups] = pdump_pktmbuf_ref(m, ctx->mp, snaplen);
+		else
+			dups[nb_dups] = pdump_pktmbuf_copy(m, ctx->mp,
+					snaplen);
+		if (dups[nb_dups] != NULL)
+			nb_dups++;
+	}
+	if (nb_dups == 0)
+		return;
+
+	nb_enq = rte_ring_enqueue_burst(ctx->ring, (void **)dups, nb_dups);
+	for (i = nb_enq; i < nb_dups; i++)
+		rte_pktmbuf_free(dups[i]);
+}
+
+/* capture a burst unless the context is being disabled */
+static inline void
+pdump_enter_capture(struct rte_mbuf **pkts, uint16_t nb_pkts,
+		struct pdump_ctx *ctx)
+{
+	/* the atomic increment orders the read of enabled after it */
+	rte_atomic32_inc(&ctx->active);
+	if (likely(ctx->enabled))
+		pdump_capture(pkts, nb_pkts, ctx);
+	rte_atomic32_dec(&ctx->active);
+}
+
+static uint16_t
+pdump_rx(uint8_t port __rte_unused, uint16_t queue __rte_unused,
+	struct rte_mbuf **pkts, uint16_t nb_pkts,
+	uint16_t max_pkts __rte_unused, void *user_param)
+{
+	pdump_enter_capture(pkts, nb_pkts, user_param);
+	return nb_pkts;
+}
+
+static uint16_t
+pdump_tx(uint8_t port __rte_unused, uint16_t queue __rte_unused,
+	struct rte_mbuf **pkts, uint16_t nb_pkts, void *user_param)
+{
+	pdump_enter_capture(pkts, nb_pkts, user_param);
+	return nb_pkts;
+}
+
+/*
+ * Remove the callback of a queue, keeping its context, and wait for the
+ * lcores running it to leave: a callback entering after the store to
+ * enabled sees it cleared, one that entered before is seen in active.
+ * The ring of the requester can then be freed, and the context updated
+ * by a next request.
+ */
+static void
+pdump_remove_cb(uint8_t port, uint16_t queue, int dir, struct pdump_ctx *ctx)
+{
+	ctx->enabled = 0;
+	rte_mb();
+	if (dir)
+		rte_eth_remove_tx_callback(port, queue, ctx->cb);
+	else
+		rte_eth_remove_rx_callback(port, queue, ctx->cb);
+	ctx->cb = NULL;
+	while (rte_atomic32_read(&ctx->active) != 0)
+		rte_pause();
+}
+
+/* install or remove the callbacks of a request, in the primary process */
+static int
+pdump_handle_request(const struct pdump_request *req)
+{
+	struct {
+		uint16_t queue;
+		int dir;
+	} added[2 * RTE_MAX_QUEUES_PER_PORT];
+	struct rte_eth_dev_data *dev_data;
+	struct rte_ring *ring = NULL;
+	struct rte_mempool *mp = NULL;
+	struct pdump_ctx **ctxs;
+	struct pdump_ctx *ctx;
+	unsigned nb_removed = 0, nb_added = 0;
+	uint16_t first, last, q, nb_queues;
+	int dir, ret = 0;
+
+	if (!rte_eth_dev_is_valid_port(req->port) ||
+			!(req->flags & RTE_PDUMP_FLAG_RXTX))
+		return -EINVAL;
+	dev_data = rte_eth_devices[req->port].data;
+
+	if (req->op == PDUMP_OP_ENABLE) {
+		ring = rte_ring_lookup(req->ring_name);
+		mp = rte_mempool_lookup(req->mp_name);
+		if (ring == NULL || mp == NULL)
+			return -ENOENT;
+		/* enqueued by the lcores of all the queues */
+		if (ring->prod.sp_enqueue)
+			return -EINVAL;
+		if (req->filter.nb_insns != 0 &&
+				rte_pdump_bpf_validate(req->filter.insns,
+					req->filter.nb_insns) < 0)
+			return -EINVAL;
+	} else if (req->op != PDUMP_OP_DISABLE) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&pdump_lock);
+
+	/* check all the queues before changing any */
+	for (dir = 0; dir < 2; dir++) {
+		if (!(req->flags & (dir ? RTE_PDUMP_FLAG_TX : RTE_PDUMP_FLAG_RX)))
+			continue;
+		ctxs = dir ? tx_ctx[req->port] : rx_ctx[req->port];
+		nb_queues = dir ? dev_data->nb_tx_queues : dev_data->nb_rx_queues;
+		if (req->queue == RTE_PDUMP_ALL_QUEUES) {
+			first = 0;
+			last = nb_queues;
+		} else if (req->queue < nb_queues) {
+			first = req->queue;
+			last = req->queue + 1;
+		} else {
+			ret = -EINVAL;
+			goto out;
+		}
+		for (q = first; q < last; q++) {
+			if (req->op == PDUMP_OP_ENABLE && ctxs[q] != NULL &&
+					ctxs[q]->cb != NULL) {
+				ret = -EEXIST;
+				goto out;
+			}
+		}
+	}
+
+	for (dir = 0; dir < 2; dir++) {
+		if (!(req->flags & (dir ? RTE_PDUMP_FLAG_TX : RTE_PDUMP_FLAG_RX)))
+			continue;
+		ctxs = dir ? tx_ctx[req->port] : rx_ctx[req->port];
+		nb_queues = dir ? dev_data->nb_tx_queues : dev_data->nb_rx_queues;
+		first = req->queue == RTE_PDUMP_ALL_QUEUES ? 0 : req->queue;
+		last = req->queue == RTE_PDUMP_ALL_QUEUES ? nb_queues :
+			req->queue + 1;
+
+		for (q = first; q < last; q++) {
+			ctx = ctxs[q];
+			if (req->op == PDUMP_OP_DISABLE) {
+				if (ctx == NULL || ctx->cb == NULL)
+					continue;
+				pdump_remove_cb(req->port, q, dir, ctx);
+				nb_removed++;
+				continue;
+			}
+
+			if (ctx == NULL) {
+				ctx = rte_zmalloc_socket("pdump", sizeof(*ctx),
+						RTE_CACHE_LINE_SIZE,
+						rte_eth_dev_socket_id(req->port));
+				if (ctx == NULL) {
+					ret = -ENOMEM;
+					goto rollback;
+				}
+				ctxs[q] = ctx;
+			}
+			ctx->ring = ring;
+			ctx->mp = mp;
+			ctx->flags = req->flags;
+			ctx->filter = req->filter;
+			rte_wmb();
+			ctx->enabled = 1;
+			if (dir)
+				ctx->cb = rte_eth_add_tx_callback(req->port,
+					q, pdump_tx, ctx);
+			else
+				ctx->cb = rte_eth_add_rx_callback(req->port,
+					q, pdump_rx, ctx);
+			if (ctx->cb == NULL) {
+				ctx->enabled = 0;
+				RTE_LOG(ERR, PDUMP, "Cannot add %s callback "
+					"on port %u queue %u\n",
+					dir ? "TX" : "RX", req->port, q);
+				ret = -rte_errno;
+				goto rollback;
+			}
+			added[nb_added].queue = q;
+			added[nb_added].dir = dir;
+			nb_added++;
+		}
+	}
+
+	if (req->op == PDUMP_OP_DISABLE && nb_removed == 0)
+		ret = -ENOENT;
+	goto out;
+
+rollback:
+	/* the request is applied to all its queues or to none */
+	while (nb_added != 0) {
+		nb_added--;
+		q = added[nb_added].queue;
+		dir = added[nb_added].dir;
+		ctxs = dir ? tx_ctx[req->port] : rx_ctx[req->port];
+		pdump_remove_cb(req->port, q, dir, ctxs[q]);
+	}
+out:
+	pthread_mutex_unlock(&pdump_lock);
+	return ret;
+}
+
+static void
+pdump_serve(int fd)
+{
+	struct timeval tv = { .tv_sec = PDUMP_TIMEOUT_S };
+	struct pdump_request req;
+	struct pdump_response resp;
+	ssize_t n;
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	n = recv(fd, &req, sizeof(req), 0);
+	if (n != sizeof(req))
+		return;
+	req.ring_name[sizeof(req.ring_name) - 1] = '\0';
+	req.mp_name[sizeof(req.mp_name) - 1] = '\0';
+
+	resp.err = pdump_handle_request(&req);
+	if (send(fd, &resp, sizeof(resp), 0) != sizeof(resp))
+		RTE_LOG(ERR, PDUMP, "Cannot send capture response\n");
+}
+
+static void *
+pdump_server_main(__attribute__((unused)) void *arg)
+{
+	struct pollfd pfd = { .fd = pdump_server.fd, .events = POLLIN };
+	int fd;
+
+	while (pdump_server.running) {
+		if (poll(&pfd, 1, PDUMP_SERVER_POLL_MS) <= 0)
+			continue;
+		fd = accept(pdump_server.fd, NULL, NULL);
+		if (fd < 0)
+			continue;
+		pdump_serve(fd);
+		close(fd);
+	}
+	return NULL;
+}
+
+int
+rte_pdump_init(const char *path)
+{
+	struct sockaddr_un *addr = &pdump_server.addr;
+	const struct rte_memzone *mz;
+	struct pdump_shared *shared;
+	const char *dir = "/var/run";
+	int fd, ret;
+
+	if (rte_eal_process_type() != RTE_PROC_PRIMARY)
+		return -EPERM;
+	if (pdump_server.running)
+		return -EALREADY;
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (path == NULL) {
+		/* same runtime directory as the EAL configuration */
+		if (getuid() != 0 && getenv("HOME") != NULL)
+			dir = getenv("HOME");
+		ret = snprintf(addr->sun_path, sizeof(addr->sun_path),
+			"%s/.rte_pdump.%d", dir, (int)getpid());
+	} else {
+		ret = snprintf(addr->sun_path, sizeof(addr->sun_path), "%s",
+			path);
+	}
+	if (ret < 0 || ret >= (int)sizeof(addr->sun_path))
+		return -ENAMETOOLONG;
+
+	mz = rte_memzone_lookup(PDUMP_MZ_NAME);
+	if (mz == NULL)
+		mz = rte_memzone_reserve(PDUMP_MZ_NAME, sizeof(*shared),
+			SOCKET_ID_ANY, 0);
+	if (mz == NULL)
+		return -ENOMEM;
+	shared = mz->addr;
+
+	fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if (fd < 0)
+		return -errno;
+	unlink(addr->sun_path);
+	if (bind(fd, (struct sockaddr *)addr, sizeof(*addr)) < 0 ||
+			chmod(addr->sun_path, S_IRUSR | S_IWUSR) < 0 ||
+			listen(fd, 8) < 0) {
+		ret = -errno;
+		RTE_LOG(ERR, PDUMP, "Cannot listen on capture socket %s\n",
+			addr->sun_path);
+		close(fd);
+		return ret;
+	}
+
+	pdump_server.fd = fd;
+	pdump_server.running = 1;
+	ret = pthread_create(&pdump_server.thread, NULL, pdump_server_main,
+			NULL);
+	if (ret != 0) {
+		RTE_LOG(ERR, PDUMP, "Cannot create capture server thread\n");
+		pdump_server.running = 0;
+		pdump_server.fd = -1;
+		close(fd);
+		unlink(addr->sun_path);
+		return -ret;
+	}
+#ifdef rte_thread_setname
+	rte_thread_setname(pdump_server.thread, "pdump-server");
+#endif
+
+	snprintf(shared->path, sizeof(shared->path), "%s", addr->sun_path);
+	return 0;
+}
+
+int
+rte_pdump_uninit(void)
+{
+	const struct rte_memzone *mz;
+
+	if (!pdump_server.running)
+		return -EALREADY;
+
+	mz = rte_memzone_lookup(PDUMP_MZ_NAME);
+	if (mz != NULL)
+		((struct pdump_shared *)mz->addr)->path[0] = '\0';
+
+	pdump_server.running = 0;
+	pthread_join(pdump_server.thread, NULL);
+	close(pdump_server.fd);
+	pdump_server.fd = -1;
+	unlink(pdump_server.addr.sun_path);
+	return 0;
+}
+
+/* send a request to the primary process */
+static int
+pdump_send_request(const struct pdump_request *req)
+{
+	struct timeval tv = { .tv_sec = PDUMP_TIMEOUT_S };
+	const struct rte_memzone *mz;
+	const struct pdump_shared *shared;
+	struct pdump_response resp;
+	struct sockaddr_un addr;
+	int fd, ret;
+
+	mz = rte_memzone_lookup(PDUMP_MZ_NAME);
+	if (mz == NULL)
+		return -ENOTCONN;
+	shared = mz->addr;
+	if (shared->path[0] == '\0')
+		return -ENOTCONN;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", shared->path);
+
+	fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if (fd < 0)
+		return -errno;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+			send(fd, req, sizeof(*req), 0) != sizeof(*req)) {
+		ret = -errno;
+		RTE_LOG(ERR, PDUMP, "Cannot send capture request to %s\n",
+			addr.sun_path);
+		close(fd);
+		return ret;
+	}
+	if (recv(fd, &resp, sizeof(resp), 0) != sizeof(resp))
+		ret = -ETIMEDOUT;
+	else
+		ret = resp.err;
+	close(fd);
+	return ret;
+}
+
+static int
+pdump_request(const struct pdump_request *req)
+{
+	if (rte_eal_process_type() == RTE_PROC_PRIMARY)
+		return pdump_handle_request(req);
+	return pdump_send_request(req);
+}
+
+int
+rte_pdump_enable(uint8_t port, uint16_t queue, uint32_t flags,
+		struct rte_ring *ring, struct rte_mempool *mp,
+		const struct rte_pdump_filter *filter)
+{
+	struct pdump_request req;
+
+	if (ring == NULL || mp == NULL || !(flags & RTE_PDUMP_FLAG_RXTX))
+		return -EINVAL;
+	if (filter != NULL && filter->nb_insns != 0 &&
+			rte_pdump_bpf_validate(filter->insns,
+				filter->nb_insns) < 0)
+		return -EINVAL;
+
+	memset(&req, 0, sizeof(req));
+	req.op = PDUMP_OP_ENABLE;
+	req.port = port;
+	req.queue = queue;
+	req.flags = flags;
+	snprintf(req.ring_name, sizeof(req.ring_name), "%s", ring->name);
+	snprintf(req.mp_name, sizeof(req.mp_name), "%s", mp->name);
+	if (filter != NULL)
+		req.filter = *filter;
+	return pdump_request(&req);
+}
+
+int
+rte_pdump_disable(uint8_t port, uint16_t queue, uint32_t flags)
+{
+	struct pdump_request req;
+
+	if (!(flags & RTE_PDUMP_FLAG_RXTX))
+		return -EINVAL;
+
+	memset(&req, 0, sizeof(req));
+	req.op = PDUMP_OP_DISABLE;
+	req.port = port;
+	req.queue = queue;
+	req.flags = flags;
+	return pdump_request(&req);
+}
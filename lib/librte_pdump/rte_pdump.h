@@ -0,0 +1,214 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _RTE_PDUMP_H_
+#define _RTE_PDUMP_H_
+
+/**
+ * @file
+ * RTE Packet Capture
+ *
+ * A secondary process captures the traffic of the ports of the primary
+ * process. The primary process serves capture requests on a Unix socket,
+ * started by rte_pdump_init(). When a capture is enabled on a port queue,
+ * RX or TX callbacks are installed on it, copying the matching packets to
+ * mbufs of a mempool and enqueueing them into a ring, both created by the
+ * capturing process. Nothing is done on the queues without capture.
+ *
+ * The packets are selected by a classic BPF program, as compiled by
+ * libpcap, whose return value is the number of bytes to capture.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include <rte_mempool.h>
+#include <rte_ring.h>
+
+/** Capture the received packets. */
+#define RTE_PDUMP_FLAG_RX   (1 << 0)
+/** Capture the transmitted packets. */
+#define RTE_PDUMP_FLAG_TX   (1 << 1)
+/** Capture the received and transmitted packets. */
+#define RTE_PDUMP_FLAG_RXTX (RTE_PDUMP_FLAG_RX | RTE_PDUMP_FLAG_TX)
+/**
+ * Reference the packet data with indirect mbufs instead of copying it.
+ * Cheaper for big packets, but the captured data is the one at the time
+ * the capturing process reads it, after any change by the application.
+ */
+#define RTE_PDUMP_FLAG_REF  (1 << 2)
+
+/** All the queues of a port. */
+#define RTE_PDUMP_ALL_QUEUES UINT16_MAX
+
+/** Maximum number of instructions of a filter. */
+#define RTE_PDUMP_FILTER_MAX 128
+
+/**
+ * Classic BPF instruction, with the layout of struct bpf_insn of libpcap
+ * and struct sock_filter of Linux.
+ */
+struct rte_pdump_bpf_insn {
+	uint16_t code; /**< Opcode. */
+	uint8_t jt;    /**< Jump offset if true. */
+	uint8_t jf;    /**< Jump offset if false. */
+	uint32_t k;    /**< Generic field. */
+};
+
+/**
+ * Selection of the captured packets.
+ */
+struct rte_pdump_filter {
+	/** Maximum number of bytes captured per packet, 0 for no limit. */
+	uint32_t snaplen;
+	/** Number of BPF instructions, 0 to capture all packets. */
+	uint16_t nb_insns;
+	/** BPF program, returning the number of bytes to capture. */
+	struct rte_pdump_bpf_insn insns[RTE_PDUMP_FILTER_MAX];
+};
+
+/**
+ * Start serving the capture requests, in the primary process.
+ *
+ * @param path
+ *   Path of the server socket, or NULL for a default path in the runtime
+ *   directory. It is published to the secondary processes.
+ * @return
+ *   - 0 on success.
+ *   - (-EALREADY) if the server is already started.
+ *   - (-EPERM) if called from a secondary process.
+ *   - Other negative errno value if the server cannot be started.
+ */
+int rte_pdump_init(const char *path);
+
+/**
+ * Stop serving the capture requests. The captures in progress continue.
+ *
+ * @return
+ *   - 0 on success.
+ *   - (-EALREADY) if the server is not started.
+ */
+int rte_pdump_uninit(void);
+
+/**
+ * Enable the capture of a port queue, or of all its queues.
+ *
+ * Called from a secondary process, the request is sent to the primary
+ * process. The ring and mempool are looked up by name by the primary
+ * process, so they must be created in shared memory; the ring must allow
+ * multiple producers.
+ *
+ * @param port
+ *   The port identifier.
+ * @param queue
+ *   The queue index, or RTE_PDUMP_ALL_QUEUES.
+ * @param flags
+ *   RTE_PDUMP_FLAG_* flags, RX and/or TX must be set.
+ * @param ring
+ *   The ring receiving the captured packets.
+ * @param mp
+ *   The mempool of the captured packets.
+ * @param filter
+ *   The selection of the captured packets, or NULL to capture all the
+ *   packets entirely.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if an argument is invalid.
+ *   - (-EEXIST) if a capture is already enabled on a queue.
+ *   - (-ENOENT) if the ring or mempool is not found by the primary process.
+ *   - Other negative errno value if the primary process cannot be reached
+ *     or cannot install the callbacks.
+ */
+int rte_pdump_enable(uint8_t port, uint16_t queue, uint32_t flags,
+		struct rte_ring *ring, struct rte_mempool *mp,
+		const struct rte_pdump_filter *filter);
+
+/**
+ * Disable the capture of a port queue, or of all its queues. When it
+ * returns, no more packets are enqueued into the ring of the capture.
+ *
+ * @param port
+ *   The port identifier.
+ * @param queue
+ *   The queue index, or RTE_PDUMP_ALL_QUEUES.
+ * @param flags
+ *   RTE_PDUMP_FLAG_RX and/or RTE_PDUMP_FLAG_TX.
+ * @return
+ *   - 0 on success.
+ *   - (-EINVAL) if an argument is invalid.
+ *   - (-ENOENT) if no capture is enabled on the queues.
+ *   - Other negative errno value if the primary process cannot be reached.
+ */
+int rte_pdump_disable(uint8_t port, uint16_t queue, uint32_t flags);
+
+/**
+ * Check that a BPF program is safe to run: known instructions, forward
+ * jumps within the program, scratch memory accesses within bounds, no
+ * division by a constant 0, and a final return instruction.
+ *
+ * @param insns
+ *   The BPF program.
+ * @param nb_insns
+ *   The number of instructions, at most RTE_PDUMP_FILTER_MAX.
+ * @return
+ *   0 if the program is valid, (-EINVAL) otherwise.
+ */
+int rte_pdump_bpf_validate(const struct rte_pdump_bpf_insn *insns,
+		uint16_t nb_insns);
+
+/**
+ * Run a validated BPF program on a packet.
+ *
+ * @param insns
+ *   The BPF program.
+ * @param pkt
+ *   The packet data.
+ * @param wirelen
+ *   The length of the packet.
+ * @param buflen
+ *   The length of the contiguous packet data; loads beyond it reject the
+ *   packet.
+ * @return
+ *   The number of bytes to capture, 0 to reject the packet.
+ */
+uint32_t rte_pdump_bpf_filter(const struct rte_pdump_bpf_insn *insns,
+		const uint8_t *pkt, uint32_t wirelen, uint32_t buflen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTE_PDUMP_H_ */
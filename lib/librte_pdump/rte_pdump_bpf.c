@@ -0,0 +1,387 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <errno.h>
+
+#include <rte_common.h>
+#include <rte_byteorder.h>
+#include <rte_branch_prediction.h>
+
+#include "rte_pdump.h"
+
+/*
+ * Classic BPF, as defined by the BSD packet filter and generated by
+ * libpcap. Jumps are forward only, so a validated program terminates.
+ */
+
+/* instruction classes */
+#define BPF_LD    0x00
+#define BPF_LDX   0x01
+#define BPF_ST    0x02
+#define BPF_STX   0x03
+#define BPF_ALU   0x04
+#define BPF_JMP   0x05
+#define BPF_RET   0x06
+#define BPF_MISC  0x07
+#define BPF_CLASS(code) ((code) & 0x07)
+
+/* load sizes */
+#define BPF_W     0x00
+#define BPF_H     0x08
+#define BPF_B     0x10
+
+/* load modes */
+#define BPF_IMM   0x00
+#define BPF_ABS   0x20
+#define BPF_IND   0x40
+#define BPF_MEM   0x60
+#define BPF_LEN   0x80
+#define BPF_MSH   0xa0
+
+/* ALU and jump operations */
+#define BPF_ADD   0x00
+#define BPF_SUB   0x10
+#define BPF_MUL   0x20
+#define BPF_DIV   0x30
+#define BPF_OR    0x40
+#define BPF_AND   0x50
+#define BPF_LSH   0x60
+#define BPF_RSH   0x70
+#define BPF_NEG   0x80
+#define BPF_MOD   0x90
+#define BPF_XOR   0xa0
+#define BPF_JA    0x00
+#define BPF_JEQ   0x10
+#define BPF_JGT   0x20
+#define BPF_JGE   0x30
+#define BPF_JSET  0x40
+#define BPF_OP(code) ((code) & 0xf0)
+
+/* operand sources */
+#define BPF_K     0x00
+#define BPF_X     0x08
+#define BPF_A     0x10
+#define BPF_SRC(code) ((code) & 0x08)
+
+/* misc operations */
+#define BPF_TAX   0x00
+#define BPF_TXA   0x80
+
+/* number of scratch memory words */
+#define BPF_MEMWORDS 16
+
+int
+rte_pdump_bpf_validate(const struct rte_pdump_bpf_insn *insns,
+		uint16_t nb_insns)
+{
+	const struct rte_pdump_bpf_insn *p;
+	uint32_t remaining;
+	uint16_t i;
+
+	if (insns == NULL || nb_insns == 0 || nb_insns > RTE_PDUMP_FILTER_MAX)
+		return -EINVAL;
+
+	for (i = 0; i < nb_insns; i++) {
+		p = &insns[i];
+		/* instructions after this one */
+		remaining = nb_insns - i - 1;
+
+		switch (p->code) {
+		case BPF_LD | BPF_W | BPF_IMM:
+		case BPF_LD | BPF_W | BPF_ABS:
+		case BPF_LD | BPF_H | BPF_ABS:
+		case BPF_LD | BPF_B | BPF_ABS:
+		case BPF_LD | BPF_W | BPF_IND:
+		case BPF_LD | BPF_H | BPF_IND:
+		case BPF_LD | BPF_B | BPF_IND:
+		case BPF_LD | BPF_W | BPF_LEN:
+		case BPF_LDX | BPF_W | BPF_IMM:
+		case BPF_LDX | BPF_W | BPF_LEN:
+		case BPF_LDX | BPF_B | BPF_MSH:
+		case BPF_RET | BPF_K:
+		case BPF_RET | BPF_A:
+		case BPF_RET | BPF_X:
+		case BPF_MISC | BPF_TAX:
+		case BPF_MISC | BPF_TXA:
+		case BPF_ALU | BPF_NEG:
+			break;
+		case BPF_LD | BPF_W | BPF_MEM:
+		case BPF_LDX | BPF_W | BPF_MEM:
+		case BPF_ST:
+		case BPF_STX:
+			if (p->k >= BPF_MEMWORDS)
+				return -EINVAL;
+			break;
+		case BPF_JMP | BPF_JA:
+			if (p->k >= remaining)
+				return -EINVAL;
+			break;
+		default:
+			if (BPF_CLASS(p->code) == BPF_ALU) {
+				switch (p->code & ~BPF_X) {
+				case BPF_ALU | BPF_DIV:
+				case BPF_ALU | BPF_MOD:
+					if (BPF_SRC(p->code) == BPF_K &&
+							p->k == 0)
+						return -EINVAL;
+					break;
+				case BPF_ALU | BPF_ADD:
+				case BPF_ALU | BPF_SUB:
+				case BPF_ALU | BPF_MUL:
+				case BPF_ALU | BPF_OR:
+				case BPF_ALU | BPF_AND:
+				case BPF_ALU | BPF_XOR:
+				case BPF_ALU | BPF_LSH:
+				case BPF_ALU | BPF_RSH:
+					break;
+				default:
+					return -EINVAL;
+				}
+			} else if (BPF_CLASS(p->code) == BPF_JMP) {
+				switch (p->code & ~BPF_X) {
+				case BPF_JMP | BPF_JEQ:
+				case BPF_JMP | BPF_JGT:
+				case BPF_JMP | BPF_JGE:
+				case BPF_JMP | BPF_JSET:
+					if (p->jt >= remaining ||
+							p->jf >= remaining)
+						return -EINVAL;
+					break;
+				default:
+					return -EINVAL;
+				}
+			} else {
+				return -EINVAL;
+			}
+		}
+	}
+
+	if (BPF_CLASS(insns[nb_insns - 1].code) != BPF_RET)
+		return -EINVAL;
+	return 0;
+}
+
+/* check that size bytes at offset k + x are in the buffer */
+static inline int
+bpf_load_ok(uint32_t k, uint32_t x, uint32_t size, uint32_t buflen)
+{
+	return k <= buflen && x <= buflen - k && size <= buflen - k - x;
+}
+
+uint32_t
+rte_pdump_bpf_filter(const struct rte_pdump_bpf_insn *insns,
+		const uint8_t *pkt, uint32_t wirelen, uint32_t buflen)
+{
+	const struct rte_pdump_bpf_insn *p = insns;
+	uint32_t mem[BPF_MEMWORDS] = { 0 };
+	uint32_t A = 0, X = 0, k;
+
+	for (;; p++) {
+		k = p->k;
+		switch (p->code) {
+		case BPF_RET | BPF_K:
+			return k;
+		case BPF_RET | BPF_A:
+			return A;
+		case BPF_RET | BPF_X:
+			return X;
+
+		case BPF_LD | BPF_W | BPF_IND:
+		case BPF_LD | BPF_H | BPF_IND:
+		case BPF_LD | BPF_B | BPF_IND:
+			if (!bpf_load_ok(k, X, 1, buflen))
+				return 0;
+			k += X;
+			/* fall through */
+		case BPF_LD | BPF_W | BPF_ABS:
+		case BPF_LD | BPF_H | BPF_ABS:
+		case BPF_LD | BPF_B | BPF_ABS:
+			switch (p->code & 0x18) {
+			case BPF_W:
+				if (!bpf_load_ok(k, 0, 4, buflen))
+					return 0;
+				A = rte_be_to_cpu_32(
+					*(const unaligned_uint32_t *)&pkt[k]);
+				break;
+			case BPF_H:
+				if (!bpf_load_ok(k, 0, 2, buflen))
+					return 0;
+				A = rte_be_to_cpu_16(
+					*(const unaligned_uint16_t *)&pkt[k]);
+				break;
+			default:
+				if (!bpf_load_ok(k, 0, 1, buflen))
+					return 0;
+				A = pkt[k];
+			}
+			break;
+		case BPF_LD | BPF_W | BPF_LEN:
+			A = wirelen;
+			break;
+		case BPF_LDX | BPF_W | BPF_LEN:
+			X = wirelen;
+			break;
+		case BPF_LDX | BPF_B | BPF_MSH:
+			if (!bpf_load_ok(k, 0, 1, buflen))
+				return 0;
+			X = (pkt[k] & 0xf) << 2;
+			break;
+		case BPF_LD | BPF_W | BPF_IMM:
+			A = k;
+			break;
+		case BPF_LDX | BPF_W | BPF_IMM:
+			X = k;
+			break;
+		case BPF_LD | BPF_W | BPF_MEM:
+			A = mem[k];
+			break;
+		case BPF_LDX | BPF_W | BPF_MEM:
+			X = mem[k];
+			break;
+		case BPF_ST:
+			mem[k] = A;
+			break;
+		case BPF_STX:
+			mem[k] = X;
+			break;
+
+		case BPF_JMP | BPF_JA:
+			p += k;
+			break;
+		case BPF_JMP | BPF_JGT | BPF_K:
+			p += (A > k) ? p->jt : p->jf;
+			break;
+		case BPF_JMP | BPF_JGE | BPF_K:
+			p += (A >= k) ? p->jt : p->jf;
+			break;
+		case BPF_JMP | BPF_JEQ | BPF_K:
+			p += (A == k) ? p->jt : p->jf;
+			break;
+		case BPF_JMP | BPF_JSET | BPF_K:
+			p += (A & k) ? p->jt : p->jf;
+			break;
+		case BPF_JMP | BPF_JGT | BPF_X:
+			p += (A > X) ? p->jt : p->jf;
+			break;
+		case BPF_JMP | BPF_JGE | BPF_X:
+			p += (A >= X) ? p->jt : p->jf;
+			break;
+		case BPF_JMP | BPF_JEQ | BPF_X:
+			p += (A == X) ? p->jt : p->jf;
+			break;
+		case BPF_JMP | BPF_JSET | BPF_X:
+			p += (A & X) ? p->jt : p->jf;
+			break;
+
+		case BPF_ALU | BPF_ADD | BPF_X:
+			A += X;
+			break;
+		case BPF_ALU | BPF_SUB | BPF_X:
+			A -= X;
+			break;
+		case BPF_ALU | BPF_MUL | BPF_X:
+			A *= X;
+			break;
+		case BPF_ALU | BPF_DIV | BPF_X:
+			if (X == 0)
+				return 0;
+			A /= X;
+			break;
+		case BPF_ALU | BPF_MOD | BPF_X:
+			if (X == 0)
+				return 0;
+			A %= X;
+			break;
+		case BPF_ALU | BPF_AND | BPF_X:
+			A &= X;
+			break;
+		case BPF_ALU | BPF_OR | BPF_X:
+			A |= X;
+			break;
+		case BPF_ALU | BPF_XOR | BPF_X:
+			A ^= X;
+			break;
+		case BPF_ALU | BPF_LSH | BPF_X:
+			A = X < 32 ? A << X : 0;
+			break;
+		case BPF_ALU | BPF_RSH | BPF_X:
+			A = X < 32 ? A >> X : 0;
+			break;
+		case BPF_ALU | BPF_ADD | BPF_K:
+			A += k;
+			break;
+		case BPF_ALU | BPF_SUB | BPF_K:
+			A -= k;
+			break;
+		case BPF_ALU | BPF_MUL | BPF_K:
+			A *= k;
+			break;
+		case BPF_ALU | BPF_DIV | BPF_K:
+			A /= k;
+			break;
+		case BPF_ALU | BPF_MOD | BPF_K:
+			A %= k;
+			break;
+		case BPF_ALU | BPF_AND | BPF_K:
+			A &= k;
+			break;
+		case BPF_ALU | BPF_OR | BPF_K:
+			A |= k;
+			break;
+		case BPF_ALU | BPF_XOR | BPF_K:
+			A ^= k;
+			break;
+		case BPF_ALU | BPF_LSH | BPF_K:
+			A = k < 32 ? A << k : 0;
+			break;
+		case BPF_ALU | BPF_RSH | BPF_K:
+			A = k < 32 ? A >> k : 0;
+			break;
+		case BPF_ALU | BPF_NEG:
+			A = -A;
+			break;
+
+		case BPF_MISC | BPF_TAX:
+			X = A;
+			break;
+		case BPF_MISC | BPF_TXA:
+			A = X;
+			break;
+
+		default:
+			/* not validated */
+			return 0;
+		}
+	}
+}
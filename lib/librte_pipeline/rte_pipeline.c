@@ -43,6 +43,8 @@
 #include <rte_mbuf.h>
 #include <rte_malloc.h>
 #include <rte_string_fns.h>
+#include <rte_atomic.h>
+#include <rte_spinlock.h>
 
 #include "rte_pipeline.h"
 
@@ -59,6 +61,19 @@
 #define RTE_PIPELINE_STATS_ADD_M(counter, mask)
 #endif
 
+#ifdef RTE_PIPELINE_CYCLES_COLLECT
+#define RTE_PIPELINE_CYCLES_INIT(tsc) \
+	({ (tsc) = rte_rdtsc(); })
+
+#define RTE_PIPELINE_CYCLES_ADD(counter, tsc) \
+	({ uint64_t __tsc = rte_rdtsc(); \
+	(counter) += __tsc - (tsc); \
+	(tsc) = __tsc; })
+#else
+#define RTE_PIPELINE_CYCLES_INIT(tsc)
+#define RTE_PIPELINE_CYCLES_ADD(counter, tsc)
+#endif
+
 struct rte_port_in {
 	/* Input parameters */
 	struct rte_port_in_ops ops;
@@ -76,6 +91,11 @@ struct rte_port_in {
 	struct rte_port_in *next;
 
 	uint64_t n_pkts_dropped_by_ah;
+
+	/* Cycle accounting */
+	uint64_t n_cycles_rx;
+	uint64_t n_cycles_ah;
+	uint64_t n_cycles_dispatch;
 };
 
 struct rte_port_out {
@@ -89,6 +109,9 @@ struct rte_port_out {
 	void *h_port;
 
 	uint64_t n_pkts_dropped_by_ah;
+
+	/* Cycle accounting */
+	uint64_t n_cycles_flush;
 };
 
 struct rte_table {
@@ -106,11 +129,23 @@ struct rte_table {
 	/* Handle to the low-level table object */
 	void *h_table;
 
+	/* Shadow copy of the low-level table object and of the default entry,
+	only present when lock-free updates are enabled for this table. Updates
+	are applied to the shadow copy, which is then swapped with the active
+	one, and finally replayed on the former active copy once the data plane
+	is no longer using it. */
+	void *h_table_shadow;
+	struct rte_pipeline_table_entry *default_entry_shadow;
+
 	/* Stats for this table. */
 	uint64_t n_pkts_dropped_by_lkp_hit_ah;
 	uint64_t n_pkts_dropped_by_lkp_miss_ah;
 	uint64_t n_pkts_dropped_lkp_hit;
 	uint64_t n_pkts_dropped_lkp_miss;
+
+	/* Cycle accounting */
+	uint64_t n_cycles_lookup;
+	uint64_t n_cycles_ah;
 };
 
 #define RTE_PIPELINE_MAX_NAME_SZ                           124
@@ -140,6 +175,13 @@ struct rte_pipeline {
 	struct rte_pipeline_table_entry *entries[RTE_PORT_IN_BURST_SIZE_MAX];
 	uint64_t action_mask0[RTE_PIPELINE_ACTIONS];
 	uint64_t action_mask1[RTE_PIPELINE_ACTIONS];
+
+	/* Lock-free table updates: number of tables with shadow copy, lock
+	serializing the control threads and run sequence number (odd while the
+	data plane is inside rte_pipeline_run) */
+	uint32_t num_tables_shadow;
+	rte_spinlock_t shadow_lock;
+	rte_atomic32_t run_seq __rte_cache_aligned;
 } __rte_cache_aligned;
 
 static inline uint32_t
@@ -235,6 +277,9 @@ rte_pipeline_create(struct rte_pipeline_params *params)
 	p->num_tables = 0;
 	p->enabled_port_in_mask = 0;
 	p->port_in_first = NULL;
+	p->num_tables_shadow = 0;
+	rte_spinlock_init(&p->shadow_lock);
+	rte_atomic32_init(&p->run_seq);
 
 	return p;
 }
@@ -322,6 +367,18 @@ rte_table_check_params(struct rte_pipeline *p,
 		return -EINVAL;
 	}
 
+	/*
+	 * The lookups of an LRU table reorder the keys of its buckets, on the
+	 * active copy only, so an add evicting a key would not evict the same
+	 * one from the two copies of the table.
+	 */
+	if ((params->arg_create_shadow != NULL) &&
+		(params->ops->flags & RTE_TABLE_OPS_F_LRU)) {
+		RTE_LOG(ERR, PIPELINE,
+			"%s: LRU tables cannot have a shadow copy\n", __func__);
+		return -EINVAL;
+	}
+
 	/* De we have room for one more table? */
 	if (p->num_tables == RTE_PIPELINE_TABLE_MAX) {
 		RTE_LOG(ERR, PIPELINE,
@@ -339,8 +396,8 @@ rte_pipeline_table_create(struct rte_pipeline *p,
 		uint32_t *table_id)
 {
 	struct rte_table *table;
-	struct rte_pipeline_table_entry *default_entry;
-	void *h_table;
+	struct rte_pipeline_table_entry *default_entry, *default_entry_shadow;
+	void *h_table, *h_table_shadow;
 	uint32_t entry_size, id;
 	int status;
 
@@ -372,6 +429,31 @@ rte_pipeline_table_create(struct rte_pipeline *p,
 		return -EINVAL;
 	}
 
+	/* Create the shadow copy of the table (lock-free updates only) */
+	h_table_shadow = NULL;
+	default_entry_shadow = NULL;
+	if (params->arg_create_shadow != NULL) {
+		default_entry_shadow = (struct rte_pipeline_table_entry *)
+			rte_zmalloc_socket("PIPELINE", entry_size,
+			RTE_CACHE_LINE_SIZE, p->socket_id);
+		if (default_entry_shadow != NULL)
+			h_table_shadow = params->ops->f_create(
+				params->arg_create_shadow, p->socket_id,
+				entry_size);
+
+		if (h_table_shadow == NULL) {
+			if (params->ops->f_free != NULL)
+				params->ops->f_free(h_table);
+			rte_free(default_entry_shadow);
+			rte_free(default_entry);
+			RTE_LOG(ERR, PIPELINE,
+				"%s: Shadow table creation failed\n", __func__);
+			return -EINVAL;
+		}
+
+		default_entry_shadow->action = RTE_PIPELINE_ACTION_DROP;
+	}
+
 	/* Commit current table to the pipeline */
 	p->num_tables++;
 	*table_id = id;
@@ -389,19 +471,227 @@ rte_pipeline_table_create(struct rte_pipeline *p,
 
 	/* Initialize table internal data structure */
 	table->h_table = h_table;
+	table->h_table_shadow = h_table_shadow;
+	table->default_entry_shadow = default_entry_shadow;
 	table->table_next_id = 0;
 	table->table_next_id_valid = 0;
 
+	if (h_table_shadow != NULL)
+		p->num_tables_shadow++;
+
 	return 0;
 }
 
 void
 rte_pipeline_table_free(struct rte_table *table)
 {
-	if (table->ops.f_free != NULL)
+	if (table->ops.f_free != NULL) {
 		table->ops.f_free(table->h_table);
+		if (table->h_table_shadow != NULL)
+			table->ops.f_free(table->h_table_shadow);
+	}
 
 	rte_free(table->default_entry);
+	rte_free(table->default_entry_shadow);
+}
+
+/*
+ * Lock-free table update
+ *
+ * The control thread applies every update to the shadow copy of the table,
+ * publishes it as the active copy and waits for the data plane thread to
+ * reach a quiescent state (i.e. to be outside of rte_pipeline_run) before
+ * replaying the same update on the former active copy.
+ */
+static void
+rte_pipeline_table_swap(struct rte_pipeline *p, void **active, void **shadow)
+{
+	void *h = *active;
+	uint32_t seq;
+
+	*active = *shadow;
+	*shadow = h;
+	rte_mb();
+
+	/* When the data plane is in the middle of a run, it might still be
+	using the former active copy, so wait for the current run to end */
+	seq = (uint32_t) rte_atomic32_read(&p->run_seq);
+	if (seq & 1)
+		while ((uint32_t) rte_atomic32_read(&p->run_seq) == seq)
+			rte_pause();
+}
+
+static int
+rte_pipeline_table_default_entry_shadow_set(struct rte_pipeline *p,
+	struct rte_table *table,
+	struct rte_pipeline_table_entry *entry)
+{
+	rte_spinlock_lock(&p->shadow_lock);
+
+	memcpy(table->default_entry_shadow, entry, table->entry_size);
+	rte_pipeline_table_swap(p, (void **) &table->default_entry,
+		(void **) &table->default_entry_shadow);
+	memcpy(table->default_entry_shadow, entry, table->entry_size);
+
+	rte_spinlock_unlock(&p->shadow_lock);
+
+	return 0;
+}
+
+static int
+rte_pipeline_table_entry_shadow_add(struct rte_pipeline *p,
+	struct rte_table *table,
+	void *key,
+	struct rte_pipeline_table_entry *entry,
+	int *key_found,
+	struct rte_pipeline_table_entry **entry_ptr)
+{
+	void *entry_ptr_shadow;
+	int key_found_shadow, status;
+
+	rte_spinlock_lock(&p->shadow_lock);
+
+	status = (table->ops.f_add)(table->h_table_shadow, key, (void *) entry,
+		key_found, (void **) entry_ptr);
+	if (status != 0)
+		goto exit;
+
+	rte_pipeline_table_swap(p, &table->h_table, &table->h_table_shadow);
+
+	status = (table->ops.f_add)(table->h_table_shadow, key, (void *) entry,
+		&key_found_shadow, &entry_ptr_shadow);
+	if (status != 0)
+		RTE_LOG(ERR, PIPELINE,
+			"%s: Shadow table copies out of sync (%d)\n",
+			__func__, status);
+
+exit:
+	rte_spinlock_unlock(&p->shadow_lock);
+	return status;
+}
+
+static int
+rte_pipeline_table_entry_shadow_delete(struct rte_pipeline *p,
+	struct rte_table *table,
+	void *key,
+	int *key_found,
+	struct rte_pipeline_table_entry *entry)
+{
+	int key_found_shadow, status;
+
+	rte_spinlock_lock(&p->shadow_lock);
+
+	status = (table->ops.f_delete)(table->h_table_shadow, key, key_found,
+		entry);
+	if ((status != 0) || (*key_found == 0))
+		goto exit;
+
+	rte_pipeline_table_swap(p, &table->h_table, &table->h_table_shadow);
+
+	status = (table->ops.f_delete)(table->h_table_shadow, key,
+		&key_found_shadow, NULL);
+	if (status != 0)
+		RTE_LOG(ERR, PIPELINE,
+			"%s: Shadow table copies out of sync (%d)\n",
+			__func__, status);
+
+exit:
+	rte_spinlock_unlock(&p->shadow_lock);
+	return status;
+}
+
+static int
+rte_pipeline_table_entry_shadow_add_bulk(struct rte_pipeline *p,
+	struct rte_table *table,
+	void **keys,
+	struct rte_pipeline_table_entry **entries,
+	uint32_t n_keys,
+	int *key_found,
+	struct rte_pipeline_table_entry **entries_ptr)
+{
+	void **entries_ptr_shadow;
+	int *key_found_shadow;
+	int status, status_shadow;
+
+	if (entries_ptr == NULL) {
+		RTE_LOG(ERR, PIPELINE, "%s: entries_ptr parameter is NULL\n",
+			__func__);
+		return -EINVAL;
+	}
+
+	entries_ptr_shadow = rte_malloc_socket("PIPELINE",
+		n_keys * (sizeof(void *) + sizeof(int)), 0, p->socket_id);
+	if (entries_ptr_shadow == NULL) {
+		RTE_LOG(ERR, PIPELINE, "%s: Memory allocation failed\n",
+			__func__);
+		return -ENOMEM;
+	}
+	key_found_shadow = (int *) &entries_ptr_shadow[n_keys];
+
+	rte_spinlock_lock(&p->shadow_lock);
+
+	/*
+	 * A bulk add failing part way keeps the keys added before the failure,
+	 * so the copies are swapped and the bulk replayed even on failure: the
+	 * two copies being in the same state, the replay fails on the same key.
+	 */
+	status = (table->ops.f_add_bulk)(table->h_table_shadow, keys,
+		(void **) entries, n_keys, key_found, (void **) entries_ptr);
+
+	rte_pipeline_table_swap(p, &table->h_table, &table->h_table_shadow);
+
+	/* Same input as the first add (the ACL table checks entries_ptr) */
+	memcpy(entries_ptr_shadow, entries_ptr, n_keys * sizeof(void *));
+	status_shadow = (table->ops.f_add_bulk)(table->h_table_shadow, keys,
+		(void **) entries, n_keys, key_found_shadow,
+		entries_ptr_shadow);
+	if (status_shadow != status)
+		RTE_LOG(ERR, PIPELINE,
+			"%s: Shadow table copies out of sync (%d)\n",
+			__func__, status_shadow);
+
+	rte_spinlock_unlock(&p->shadow_lock);
+	rte_free(entries_ptr_shadow);
+	return status;
+}
+
+static int
+rte_pipeline_table_entry_shadow_delete_bulk(struct rte_pipeline *p,
+	struct rte_table *table,
+	void **keys,
+	uint32_t n_keys,
+	int *key_found,
+	struct rte_pipeline_table_entry **entries)
+{
+	int *key_found_shadow;
+	int status, status_shadow;
+
+	key_found_shadow = rte_malloc_socket("PIPELINE", n_keys * sizeof(int),
+		0, p->socket_id);
+	if (key_found_shadow == NULL) {
+		RTE_LOG(ERR, PIPELINE, "%s: Memory allocation failed\n",
+			__func__);
+		return -ENOMEM;
+	}
+
+	rte_spinlock_lock(&p->shadow_lock);
+
+	/* Swapped and replayed even on failure, as for the bulk add */
+	status = (table->ops.f_delete_bulk)(table->h_table_shadow, keys,
+		n_keys, key_found, (void **) entries);
+
+	rte_pipeline_table_swap(p, &table->h_table, &table->h_table_shadow);
+
+	status_shadow = (table->ops.f_delete_bulk)(table->h_table_shadow, keys,
+		n_keys, key_found_shadow, NULL);
+	if (status_shadow != status)
+		RTE_LOG(ERR, PIPELINE,
+			"%s: Shadow table copies out of sync (%d)\n",
+			__func__, status_shadow);
+
+	rte_spinlock_unlock(&p->shadow_lock);
+	rte_free(key_found_shadow);
+	return status;
 }
 
 int
@@ -448,7 +738,11 @@ rte_pipeline_table_default_entry_add(struct rte_pipeline *p,
 		table->table_next_id_valid = 1;
 	}
 
-	memcpy(table->default_entry, default_entry, table->entry_size);
+	if (table->default_entry_shadow != NULL)
+		rte_pipeline_table_default_entry_shadow_set(p, table,
+			default_entry);
+	else
+		memcpy(table->default_entry, default_entry, table->entry_size);
 
 	*default_entry_ptr = table->default_entry;
 	return 0;
@@ -481,8 +775,25 @@ rte_pipeline_table_default_entry_delete(struct rte_pipeline *p,
 		memcpy(entry, table->default_entry, table->entry_size);
 
 	/* Clear the lookup miss actions */
-	memset(table->default_entry, 0, table->entry_size);
-	table->default_entry->action = RTE_PIPELINE_ACTION_DROP;
+	if (table->default_entry_shadow != NULL) {
+		struct rte_pipeline_table_entry *drop_entry;
+
+		drop_entry = rte_zmalloc_socket("PIPELINE", table->entry_size,
+			0, p->socket_id);
+		if (drop_entry == NULL) {
+			RTE_LOG(ERR, PIPELINE,
+				"%s: Memory allocation failed\n", __func__);
+			return -ENOMEM;
+		}
+
+		drop_entry->action = RTE_PIPELINE_ACTION_DROP;
+		rte_pipeline_table_default_entry_shadow_set(p, table,
+			drop_entry);
+		rte_free(drop_entry);
+	} else {
+		memset(table->default_entry, 0, table->entry_size);
+		table->default_entry->action = RTE_PIPELINE_ACTION_DROP;
+	}
 
 	return 0;
 }
@@ -544,6 +855,10 @@ rte_pipeline_table_entry_add(struct rte_pipeline *p,
 		table->table_next_id_valid = 1;
 	}
 
+	if (table->h_table_shadow != NULL)
+		return rte_pipeline_table_entry_shadow_add(p, table, key, entry,
+			key_found, entry_ptr);
+
 	return (table->ops.f_add)(table->h_table, key, (void *) entry,
 		key_found, (void **) entry_ptr);
 }
@@ -584,6 +899,10 @@ rte_pipeline_table_entry_delete(struct rte_pipeline *p,
 		return -EINVAL;
 	}
 
+	if (table->h_table_shadow != NULL)
+		return rte_pipeline_table_entry_shadow_delete(p, table, key,
+			key_found, entry);
+
 	return (table->ops.f_delete)(table->h_table, key, key_found, entry);
 }
 
@@ -649,6 +968,10 @@ int rte_pipeline_table_entry_add_bulk(struct rte_pipeline *p,
 		}
 	}
 
+	if (table->h_table_shadow != NULL)
+		return rte_pipeline_table_entry_shadow_add_bulk(p, table, keys,
+			entries, n_keys, key_found, entries_ptr);
+
 	return (table->ops.f_add_bulk)(table->h_table, keys, (void **) entries,
 		n_keys, key_found, (void **) entries_ptr);
 }
@@ -689,6 +1012,10 @@ int rte_pipeline_table_entry_delete_bulk(struct rte_pipeline *p,
 		return -EINVAL;
 	}
 
+	if (table->h_table_shadow != NULL)
+		return rte_pipeline_table_entry_shadow_delete_bulk(p, table,
+			keys, n_keys, key_found, entries);
+
 	return (table->ops.f_delete_bulk)(table->h_table, keys, n_keys, key_found,
 			(void **) entries);
 }
@@ -1343,6 +1670,12 @@ int
 rte_pipeline_run(struct rte_pipeline *p)
 {
 	struct rte_port_in *port_in;
+	uint64_t tsc __rte_unused;
+	uint32_t n_pkts_total = 0;
+
+	/* Enter the critical section for lock-free table updates */
+	if (p->num_tables_shadow != 0)
+		rte_atomic32_inc(&p->run_seq);
 
 	for (port_in = p->port_in_first; port_in != NULL;
 		port_in = port_in->next) {
@@ -1350,11 +1683,15 @@ rte_pipeline_run(struct rte_pipeline *p)
 		uint32_t n_pkts, table_id;
 
 		/* Input port RX */
+		RTE_PIPELINE_CYCLES_INIT(tsc);
 		n_pkts = port_in->ops.f_rx(port_in->h_port, p->pkts,
 			port_in->burst_size);
+		RTE_PIPELINE_CYCLES_ADD(port_in->n_cycles_rx, tsc);
 		if (n_pkts == 0)
 			continue;
 
+		n_pkts_total += n_pkts;
+
 		pkts_mask = RTE_LEN2MASK(n_pkts, uint64_t);
 		p->action_mask0[RTE_PIPELINE_ACTION_DROP] = 0;
 		p->action_mask0[RTE_PIPELINE_ACTION_PORT] = 0;
@@ -1369,6 +1706,7 @@ rte_pipeline_run(struct rte_pipeline *p)
 			mask ^= pkts_mask;
 			p->action_mask0[RTE_PIPELINE_ACTION_DROP] |= mask;
 			RTE_PIPELINE_STATS_ADD_M(port_in->n_pkts_dropped_by_ah, mask);
+			RTE_PIPELINE_CYCLES_ADD(port_in->n_cycles_ah, tsc);
 		}
 
 		/* Table */
@@ -1381,6 +1719,7 @@ rte_pipeline_run(struct rte_pipeline *p)
 			table->ops.f_lookup(table->h_table, p->pkts, pkts_mask,
 					&lookup_hit_mask, (void **) p->entries);
 			lookup_miss_mask = pkts_mask & (~lookup_hit_mask);
+			RTE_PIPELINE_CYCLES_ADD(table->n_cycles_lookup, tsc);
 
 			/* Lookup miss */
 			if (lookup_miss_mask != 0) {
@@ -1398,16 +1737,20 @@ rte_pipeline_run(struct rte_pipeline *p)
 					p->action_mask0[RTE_PIPELINE_ACTION_DROP] |= mask;
 					RTE_PIPELINE_STATS_ADD_M(
 						table->n_pkts_dropped_by_lkp_miss_ah, mask);
+					RTE_PIPELINE_CYCLES_ADD(table->n_cycles_ah,
+						tsc);
 				}
 
 				/* Table reserved actions */
 				if ((default_entry->action ==
 					RTE_PIPELINE_ACTION_PORT) &&
-					(lookup_miss_mask != 0))
+					(lookup_miss_mask != 0)) {
 					rte_pipeline_action_handler_port_bulk(p,
 						lookup_miss_mask,
 						default_entry->port_id);
-				else {
+					RTE_PIPELINE_CYCLES_ADD(
+						port_in->n_cycles_dispatch, tsc);
+				} else {
 					uint32_t pos = default_entry->action;
 
 					p->action_mask0[pos] = lookup_miss_mask;
@@ -1431,6 +1774,8 @@ rte_pipeline_run(struct rte_pipeline *p)
 					p->action_mask0[RTE_PIPELINE_ACTION_DROP] |= mask;
 					RTE_PIPELINE_STATS_ADD_M(
 						table->n_pkts_dropped_by_lkp_hit_ah, mask);
+					RTE_PIPELINE_CYCLES_ADD(table->n_cycles_ah,
+						tsc);
 				}
 
 				/* Table reserved actions */
@@ -1450,6 +1795,7 @@ rte_pipeline_run(struct rte_pipeline *p)
 
 				RTE_PIPELINE_STATS_ADD_M(table->n_pkts_dropped_lkp_hit,
 						p->action_mask1[RTE_PIPELINE_ACTION_DROP]);
+				RTE_PIPELINE_CYCLES_ADD(table->n_cycles_lookup, tsc);
 			}
 
 			/* Prepare for next iteration */
@@ -1469,14 +1815,20 @@ rte_pipeline_run(struct rte_pipeline *p)
 		/* Table reserved action DROP */
 		rte_pipeline_action_handler_drop(p,
 				p->action_mask0[RTE_PIPELINE_ACTION_DROP]);
+		RTE_PIPELINE_CYCLES_ADD(port_in->n_cycles_dispatch, tsc);
 	}
 
-	return 0;
+	/* Quiescent state for lock-free table updates */
+	if (p->num_tables_shadow != 0)
+		rte_atomic32_inc(&p->run_seq);
+
+	return (int) n_pkts_total;
 }
 
 int
 rte_pipeline_flush(struct rte_pipeline *p)
 {
+	uint64_t tsc __rte_unused;
 	uint32_t port_id;
 
 	/* Check input arguments */
@@ -1486,11 +1838,14 @@ rte_pipeline_flush(struct rte_pipeline *p)
 		return -EINVAL;
 	}
 
+	RTE_PIPELINE_CYCLES_INIT(tsc);
 	for (port_id = 0; port_id < p->num_ports_out; port_id++) {
 		struct rte_port_out *port = &p->ports_out[port_id];
 
-		if (port->ops.f_flush != NULL)
+		if (port->ops.f_flush != NULL) {
 			port->ops.f_flush(port->h_port);
+			RTE_PIPELINE_CYCLES_ADD(port->n_cycles_flush, tsc);
+		}
 	}
 
 	return 0;
@@ -1549,11 +1904,19 @@ int rte_pipeline_port_in_stats_read(struct rte_pipeline *p, uint32_t port_id,
 	} else if (stats != NULL)
 		memset(&stats->stats, 0, sizeof(stats->stats));
 
-	if (stats != NULL)
+	if (stats != NULL) {
 		stats->n_pkts_dropped_by_ah = port->n_pkts_dropped_by_ah;
+		stats->n_cycles_rx = port->n_cycles_rx;
+		stats->n_cycles_ah = port->n_cycles_ah;
+		stats->n_cycles_dispatch = port->n_cycles_dispatch;
+	}
 
-	if (clear != 0)
+	if (clear != 0) {
 		port->n_pkts_dropped_by_ah = 0;
+		port->n_cycles_rx = 0;
+		port->n_cycles_ah = 0;
+		port->n_cycles_dispatch = 0;
+	}
 
 	return 0;
 }
@@ -1583,11 +1946,15 @@ int rte_pipeline_port_out_stats_read(struct rte_pipeline *p, uint32_t port_id,
 	} else if (stats != NULL)
 		memset(&stats->stats, 0, sizeof(stats->stats));
 
-	if (stats != NULL)
+	if (stats != NULL) {
 		stats->n_pkts_dropped_by_ah = port->n_pkts_dropped_by_ah;
+		stats->n_cycles_flush = port->n_cycles_flush;
+	}
 
-	if (clear != 0)
+	if (clear != 0) {
 		port->n_pkts_dropped_by_ah = 0;
+		port->n_cycles_flush = 0;
+	}
 
 	return 0;
 }
@@ -1615,6 +1982,22 @@ int rte_pipeline_table_stats_read(struct rte_pipeline *p, uint32_t table_id,
 		retval = table->ops.f_stats(table->h_table, &stats->stats, clear);
 		if (retval != 0)
 			return retval;
+
+		/* Lookups are spread across both copies of the table */
+		if (table->h_table_shadow != NULL) {
+			struct rte_table_stats shadow_stats;
+
+			retval = table->ops.f_stats(table->h_table_shadow,
+				&shadow_stats, clear);
+			if (retval != 0)
+				return retval;
+
+			stats->stats.n_pkts_in += shadow_stats.n_pkts_in;
+			stats->stats.n_pkts_lookup_miss +=
+				shadow_stats.n_pkts_lookup_miss;
+			stats->stats.n_pkts_cache_hit +=
+				shadow_stats.n_pkts_cache_hit;
+		}
 	} else if (stats != NULL)
 		memset(&stats->stats, 0, sizeof(stats->stats));
 
@@ -1625,6 +2008,8 @@ int rte_pipeline_table_stats_read(struct rte_pipeline *p, uint32_t table_id,
 			table->n_pkts_dropped_by_lkp_miss_ah;
 		stats->n_pkts_dropped_lkp_hit = table->n_pkts_dropped_lkp_hit;
 		stats->n_pkts_dropped_lkp_miss = table->n_pkts_dropped_lkp_miss;
+		stats->n_cycles_lookup = table->n_cycles_lookup;
+		stats->n_cycles_ah = table->n_cycles_ah;
 	}
 
 	if (clear != 0) {
@@ -1632,6 +2017,8 @@ int rte_pipeline_table_stats_read(struct rte_pipeline *p, uint32_t table_id,
 		table->n_pkts_dropped_by_lkp_miss_ah = 0;
 		table->n_pkts_dropped_lkp_hit = 0;
 		table->n_pkts_dropped_lkp_miss = 0;
+		table->n_cycles_lookup = 0;
+		table->n_cycles_ah = 0;
 	}
 
 	return 0;
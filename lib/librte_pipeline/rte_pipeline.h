@@ -81,6 +81,19 @@ extern "C" {
  * the same CPU core, but it is not allowed (for thread safety reasons) to have
  * multiple CPU cores running the same pipeline instance.
  *
+ * <B>Lock-free table updates.</B> By default, the table entries have to be
+ * added or deleted by the same CPU core that runs the pipeline. When a table
+ * is created with a shadow copy, its entries (including the default entry) can
+ * also be updated by a control thread running on a different CPU core while
+ * the pipeline is running. Each update is applied to the shadow copy first,
+ * which is then atomically swapped with the active copy, and finally replayed
+ * on the former active copy once the pipeline CPU core has completed its
+ * current run. A bulk update failing part way is swapped and replayed as
+ * well, so that the entries updated before the failure are in both copies.
+ * The table memory footprint doubles and the table entry pointers returned
+ * by the API must not be used to modify the entries in place, as such
+ * changes are not propagated to the shadow copy.
+ *
  ***/
 
 #include <stdint.h>
@@ -120,6 +133,18 @@ struct rte_pipeline_port_in_stats {
 	/** Number of packets dropped by action handler. */
 	uint64_t n_pkts_dropped_by_ah;
 
+	/** Number of CPU cycles spent in port RX (including empty polls).
+	Only collected when CONFIG_RTE_PIPELINE_CYCLES_COLLECT is enabled. */
+	uint64_t n_cycles_rx;
+
+	/** Number of CPU cycles spent in the input port action handler. */
+	uint64_t n_cycles_ah;
+
+	/** Number of CPU cycles spent running the reserved actions of the
+	packets read from this port, on table lookup hit and miss alike:
+	sending them to their output ports (including the output port action
+	handlers) or dropping them. */
+	uint64_t n_cycles_dispatch;
 };
 
 /** Pipeline port out stats. */
@@ -129,6 +154,11 @@ struct rte_pipeline_port_out_stats {
 
 	/** Number of packets dropped by action handler. */
 	uint64_t n_pkts_dropped_by_ah;
+
+	/** Number of CPU cycles spent in port flush. Only collected when
+	CONFIG_RTE_PIPELINE_CYCLES_COLLECT is enabled. The cycles spent sending
+	packets to the port are counted by the input ports. */
+	uint64_t n_cycles_flush;
 };
 
 /** Pipeline table stats. */
@@ -149,6 +179,16 @@ struct rte_pipeline_table_stats {
 	/** Number of packets dropped by pipeline in behalf of this table based on
 	 * on action specified in table entry. */
 	uint64_t n_pkts_dropped_lkp_miss;
+
+	/** Number of CPU cycles spent in table lookup and in sorting the
+	packets by reserved action, the actions themselves being counted by
+	the input ports. Only collected when CONFIG_RTE_PIPELINE_CYCLES_COLLECT
+	is enabled. */
+	uint64_t n_cycles_lookup;
+
+	/** Number of CPU cycles spent in lookup hit and lookup miss action
+	handlers. */
+	uint64_t n_cycles_ah;
 };
 
 /**
@@ -187,7 +227,7 @@ int rte_pipeline_check(struct rte_pipeline *p);
  * @param p
  *   Handle to pipeline instance
  * @return
- *   0 on success, error code otherwise
+ *   Number of packets read from the input ports during this run
  */
 int rte_pipeline_run(struct rte_pipeline *p);
 
@@ -343,6 +383,13 @@ struct rte_pipeline_table_params {
 	/** Memory size to be reserved per table entry for storing the user
 	actions and their meta-data */
 	uint32_t action_data_size;
+	/** Opaque param to be passed to the table create operation when
+	invoked for the shadow copy of the table. When not NULL, lock-free
+	updates are enabled for this table. It typically differs from
+	arg_create only in the name of the low-level table object. Not
+	supported by the tables with the RTE_TABLE_OPS_F_LRU flag, such as
+	the LRU hash tables, whose copies would evict different keys. */
+	void *arg_create_shadow;
 };
 
 /**
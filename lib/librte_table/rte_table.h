@@ -63,6 +63,7 @@ struct rte_mbuf;
 struct rte_table_stats {
 	uint64_t n_pkts_in;
 	uint64_t n_pkts_lookup_miss;
+	uint64_t n_pkts_cache_hit;  /**< Hits in the cache in front of table */
 };
 
 /**
@@ -282,6 +283,14 @@ typedef int (*rte_table_op_stats_read)(
 	struct rte_table_stats *stats,
 	int clear);
 
+/** Lookup table matches the whole key exactly: an entry add or delete only
+changes the lookup result of its own key */
+#define RTE_TABLE_OPS_F_EXACT_MATCH                        (1 << 0)
+
+/** Lookup table reorders its keys on lookup, so that an entry add may evict
+another key depending on the lookups done before */
+#define RTE_TABLE_OPS_F_LRU                                (1 << 1)
+
 /** Lookup table interface defining the lookup table operation */
 struct rte_table_ops {
 	rte_table_op_create f_create;                 /**< Create */
@@ -292,6 +301,7 @@ struct rte_table_ops {
 	rte_table_op_entry_delete_bulk f_delete_bulk; /**< Delete entry bulk */
 	rte_table_op_lookup f_lookup;                 /**< Lookup */
 	rte_table_op_stats_read f_stats;              /**< Stats */
+	uint32_t flags;                               /**< RTE_TABLE_OPS_F_* */
 };
 
 #ifdef __cplusplus
@@ -0,0 +1,116 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INCLUDE_RTE_TABLE_BULK_H__
+#define __INCLUDE_RTE_TABLE_BULK_H__
+
+/*
+ * Bulk add and delete of the tables whose low-level structure has no bulk
+ * update (e.g. LPM): one entry add or delete per key, stopping at the first
+ * failure. The keys before the failed one stay added or deleted, as reported
+ * by entries_ptr and key_found.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+
+#include <rte_log.h>
+
+#include "rte_table.h"
+
+static inline int
+rte_table_bulk_add(rte_table_op_entry_add f_add,
+	void *table,
+	void **keys,
+	void **entries,
+	uint32_t n_keys,
+	int *key_found,
+	void **entries_ptr)
+{
+	uint32_t i;
+
+	/* Check input parameters */
+	if ((table == NULL) ||
+		(keys == NULL) ||
+		(entries == NULL) ||
+		(n_keys == 0) ||
+		(key_found == NULL) ||
+		(entries_ptr == NULL)) {
+		RTE_LOG(ERR, TABLE, "%s: invalid parameters\n", __func__);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < n_keys; i++) {
+		int status;
+
+		status = f_add(table, keys[i], entries[i], &key_found[i],
+			&entries_ptr[i]);
+		if (status)
+			return status;
+	}
+
+	return 0;
+}
+
+static inline int
+rte_table_bulk_delete(rte_table_op_entry_delete f_delete,
+	void *table,
+	void **keys,
+	uint32_t n_keys,
+	int *key_found,
+	void **entries)
+{
+	uint32_t i;
+
+	/* Check input parameters */
+	if ((table == NULL) ||
+		(keys == NULL) ||
+		(n_keys == 0) ||
+		(key_found == NULL)) {
+		RTE_LOG(ERR, TABLE, "%s: invalid parameters\n", __func__);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < n_keys; i++) {
+		int status;
+
+		status = f_delete(table, keys[i], &key_found[i],
+			(entries) ? entries[i] : NULL);
+		if (status)
+			return status;
+	}
+
+	return 0;
+}
+
+#endif
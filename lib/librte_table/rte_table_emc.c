@@ -0,0 +1,626 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include <rte_common.h>
+#include <rte_mbuf.h>
+#include <rte_memory.h>
+#include <rte_malloc.h>
+#include <rte_log.h>
+#include <rte_prefetch.h>
+
+#include "rte_table_emc.h"
+
+#ifdef RTE_TABLE_STATS_COLLECT
+
+#define RTE_TABLE_EMC_STATS_PKTS_IN_ADD(table, val) \
+	table->stats.n_pkts_in += val
+#define RTE_TABLE_EMC_STATS_PKTS_LOOKUP_MISS(table, val) \
+	table->stats.n_pkts_lookup_miss += val
+#define RTE_TABLE_EMC_STATS_PKTS_CACHE_HIT(table, val) \
+	table->stats.n_pkts_cache_hit += val
+
+#else
+
+#define RTE_TABLE_EMC_STATS_PKTS_IN_ADD(table, val)
+#define RTE_TABLE_EMC_STATS_PKTS_LOOKUP_MISS(table, val)
+#define RTE_TABLE_EMC_STATS_PKTS_CACHE_HIT(table, val)
+
+#endif
+
+#define RTE_TABLE_EMC_KEY_SIZE_QW_MAX (RTE_TABLE_EMC_KEY_SIZE_MAX / 8)
+
+struct rte_table_emc_entry {
+	uint32_t signature;
+	uint32_t valid;
+	void *data;
+	uint64_t key[0];
+};
+
+struct rte_table_emc {
+	struct rte_table_stats stats;
+
+	/* Input parameters */
+	struct rte_table_ops ops;
+	uint32_t key_size;
+	uint32_t key_offset;
+	uint32_t signature_offset;
+	uint32_t n_entries;
+	uint32_t n_ways;
+	rte_table_hash_op_hash f_hash;
+	uint64_t seed;
+	uint64_t key_mask[RTE_TABLE_EMC_KEY_SIZE_QW_MAX];
+
+	/* Internal fields */
+	void *table;
+	uint32_t key_size_qw;
+	uint32_t entry_size;
+	uint32_t bucket_mask;
+	uint32_t insert_mask;
+	uint32_t rand_state;
+	uint32_t exact_match;
+	uint32_t lru;
+
+	/* Internal table */
+	uint8_t memory[0] __rte_cache_aligned;
+} __rte_cache_aligned;
+
+static int
+check_params_create(struct rte_table_emc_params *params, uint32_t lru)
+{
+	struct rte_table_ops *ops;
+
+	/* ops */
+	ops = params->ops;
+	if ((ops == NULL) ||
+		(ops->f_create == NULL) ||
+		(ops->f_free == NULL) ||
+		(ops->f_add == NULL) ||
+		(ops->f_delete == NULL) ||
+		(ops->f_lookup == NULL)) {
+		RTE_LOG(ERR, TABLE, "%s: ops parameter is invalid\n", __func__);
+		return -EINVAL;
+	}
+
+	/* The EMC ops have to carry the LRU flag of the lookup table */
+	if ((ops->flags & RTE_TABLE_OPS_F_LRU) && (lru == 0)) {
+		RTE_LOG(ERR, TABLE, "%s: LRU lookup table, use "
+			"rte_table_emc_lru_ops\n", __func__);
+		return -EINVAL;
+	}
+
+	/* key_size */
+	if ((params->key_size == 0) ||
+		(params->key_size % 8) ||
+		(params->key_size > RTE_TABLE_EMC_KEY_SIZE_MAX)) {
+		RTE_LOG(ERR, TABLE, "%s: key_size invalid value\n", __func__);
+		return -EINVAL;
+	}
+
+	/* n_ways */
+	if ((params->n_ways != 1) && (params->n_ways != 2)) {
+		RTE_LOG(ERR, TABLE, "%s: n_ways invalid value\n", __func__);
+		return -EINVAL;
+	}
+
+	/* n_entries */
+	if ((params->n_entries < params->n_ways) ||
+		(!rte_is_power_of_2(params->n_entries))) {
+		RTE_LOG(ERR, TABLE, "%s: n_entries invalid value\n", __func__);
+		return -EINVAL;
+	}
+
+	/* insert_inv_prob */
+	if ((params->insert_inv_prob == 0) ||
+		(!rte_is_power_of_2(params->insert_inv_prob))) {
+		RTE_LOG(ERR, TABLE, "%s: insert_inv_prob invalid value\n",
+			__func__);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void *
+rte_table_emc_create_common(void *params, int socket_id, uint32_t entry_size,
+	uint32_t lru)
+{
+	struct rte_table_emc_params *p =
+		(struct rte_table_emc_params *) params;
+	struct rte_table_emc *t;
+	uint32_t emc_entry_size, total_size, i;
+
+	/* Check input parameters */
+	if ((p == NULL) || (check_params_create(p, lru) != 0))
+		return NULL;
+
+	/* Memory allocation */
+	emc_entry_size = sizeof(struct rte_table_emc_entry) + p->key_size;
+	total_size = sizeof(struct rte_table_emc) +
+		p->n_entries * emc_entry_size;
+
+	t = rte_zmalloc_socket("TABLE", total_size, RTE_CACHE_LINE_SIZE,
+		socket_id);
+	if (t == NULL) {
+		RTE_LOG(ERR, TABLE,
+			"%s: Cannot allocate %u bytes for EMC table\n",
+			__func__, total_size);
+		return NULL;
+	}
+
+	/* Lookup table behind the EMC */
+	t->table = p->ops->f_create(p->arg_create, socket_id, entry_size);
+	if (t->table == NULL) {
+		RTE_LOG(ERR, TABLE, "%s: Cannot create the lookup table\n",
+			__func__);
+		rte_free(t);
+		return NULL;
+	}
+
+	/* Memory initialization */
+	memcpy(&t->ops, p->ops, sizeof(t->ops));
+	t->key_size = p->key_size;
+	t->key_offset = p->key_offset;
+	t->signature_offset = p->signature_offset;
+	t->n_entries = p->n_entries;
+	t->n_ways = p->n_ways;
+	t->f_hash = p->f_hash;
+	t->seed = p->seed;
+
+	t->key_size_qw = p->key_size / 8;
+	for (i = 0; i < t->key_size_qw; i++)
+		t->key_mask[i] = (p->key_mask != NULL) ?
+			((uint64_t *) p->key_mask)[i] : 0xFFFFFFFFFFFFFFFFLLU;
+
+	t->entry_size = emc_entry_size;
+	t->bucket_mask = (p->n_entries / p->n_ways) - 1;
+	t->insert_mask = p->insert_inv_prob - 1;
+	t->rand_state = (uint32_t) (uintptr_t) t;
+	t->exact_match = (p->ops->flags & RTE_TABLE_OPS_F_EXACT_MATCH) != 0;
+	t->lru = (p->ops->flags & RTE_TABLE_OPS_F_LRU) != 0;
+
+	RTE_LOG(INFO, TABLE, "%s: EMC with %u entries (%u-way) created "
+		"(%u bytes of memory)\n",
+		__func__, t->n_entries, t->n_ways, total_size);
+
+	return t;
+}
+
+static void *
+rte_table_emc_create(void *params, int socket_id, uint32_t entry_size)
+{
+	return rte_table_emc_create_common(params, socket_id, entry_size, 0);
+}
+
+static void *
+rte_table_emc_lru_create(void *params, int socket_id, uint32_t entry_size)
+{
+	return rte_table_emc_create_common(params, socket_id, entry_size, 1);
+}
+
+static int
+rte_table_emc_free(void *table)
+{
+	struct rte_table_emc *t = (struct rte_table_emc *) table;
+	int status;
+
+	/* Check input parameters */
+	if (t == NULL) {
+		RTE_LOG(ERR, TABLE, "%s: table parameter is NULL\n", __func__);
+		return -EINVAL;
+	}
+
+	/* Free previously allocated resources */
+	status = t->ops.f_free(t->table);
+	rte_free(t);
+
+	return status;
+}
+
+static inline void
+rte_table_emc_flush(struct rte_table_emc *t)
+{
+	memset(t->memory, 0, t->n_entries * t->entry_size);
+}
+
+static inline struct rte_table_emc_entry *
+rte_table_emc_bucket(struct rte_table_emc *t, uint32_t signature)
+{
+	uint32_t pos = (signature & t->bucket_mask) * t->n_ways;
+
+	return (struct rte_table_emc_entry *) &t->memory[pos * t->entry_size];
+}
+
+static inline struct rte_table_emc_entry *
+rte_table_emc_bucket_entry(struct rte_table_emc *t,
+	struct rte_table_emc_entry *bucket,
+	uint32_t way)
+{
+	return (struct rte_table_emc_entry *)
+		&((uint8_t *) bucket)[way * t->entry_size];
+}
+
+static inline void
+rte_table_emc_key_read(struct rte_table_emc *t,
+	struct rte_mbuf *pkt,
+	uint64_t *key)
+{
+	uint64_t *pkt_key = RTE_MBUF_METADATA_UINT64_PTR(pkt, t->key_offset);
+	uint32_t i;
+
+	for (i = 0; i < t->key_size_qw; i++)
+		key[i] = pkt_key[i] & t->key_mask[i];
+}
+
+static inline int
+rte_table_emc_key_equal(struct rte_table_emc *t, uint64_t *a, uint64_t *b)
+{
+	uint64_t xor = 0;
+	uint32_t i;
+
+	for (i = 0; i < t->key_size_qw; i++)
+		xor |= a[i] ^ b[i];
+
+	return xor == 0;
+}
+
+/*
+ * Invalidate the EMC entries of a key of the lookup table, or the whole EMC
+ * when the lookup table is not an exact match one: an entry add or delete
+ * changes the lookup result of its own key only. Without hash function, the
+ * signature of the key is not known and every EMC entry is checked.
+ */
+static void
+rte_table_emc_invalidate(struct rte_table_emc *t, void *key)
+{
+	uint64_t emc_key[RTE_TABLE_EMC_KEY_SIZE_QW_MAX];
+	struct rte_table_emc_entry *bucket;
+	uint32_t i, n;
+
+	if (t->exact_match == 0) {
+		rte_table_emc_flush(t);
+		return;
+	}
+
+	memcpy(emc_key, key, t->key_size);
+	for (i = 0; i < t->key_size_qw; i++)
+		emc_key[i] &= t->key_mask[i];
+
+	if (t->f_hash != NULL) {
+		bucket = rte_table_emc_bucket(t,
+			(uint32_t) t->f_hash(emc_key, t->key_size, t->seed));
+		n = t->n_ways;
+	} else {
+		bucket = (struct rte_table_emc_entry *) t->memory;
+		n = t->n_entries;
+	}
+
+	for (i = 0; i < n; i++) {
+		struct rte_table_emc_entry *e =
+			rte_table_emc_bucket_entry(t, bucket, i);
+
+		if (e->valid && rte_table_emc_key_equal(t, e->key, emc_key))
+			e->valid = 0;
+	}
+}
+
+static inline int
+rte_table_emc_insert_allowed(struct rte_table_emc *t)
+{
+	if (t->insert_mask == 0)
+		return 1;
+
+	t->rand_state = t->rand_state * 1103515245 + 12345;
+
+	return ((t->rand_state >> 16) & t->insert_mask) == 0;
+}
+
+static inline void
+rte_table_emc_insert(struct rte_table_emc *t,
+	uint32_t signature,
+	uint64_t *key,
+	void *data)
+{
+	struct rte_table_emc_entry *bucket, *e, *victim = NULL;
+	uint32_t way;
+
+	bucket = rte_table_emc_bucket(t, signature);
+
+	for (way = 0; way < t->n_ways; way++) {
+		e = rte_table_emc_bucket_entry(t, bucket, way);
+
+		/* Key already present (e.g. same flow twice in the burst) */
+		if (e->valid &&
+			(e->signature == signature) &&
+			rte_table_emc_key_equal(t, e->key, key)) {
+			e->data = data;
+			return;
+		}
+
+		if ((victim == NULL) && (e->valid == 0))
+			victim = e;
+	}
+
+	/* Bucket full: pick one of the entries in pseudo-random fashion */
+	if (victim == NULL)
+		victim = rte_table_emc_bucket_entry(t, bucket,
+			(t->rand_state >> 24) & (t->n_ways - 1));
+
+	victim->signature = signature;
+	victim->valid = 1;
+	victim->data = data;
+	memcpy(victim->key, key, t->key_size);
+}
+
+static int
+rte_table_emc_entry_add(
+	void *table,
+	void *key,
+	void *entry,
+	int *key_found,
+	void **entry_ptr)
+{
+	struct rte_table_emc *t = (struct rte_table_emc *) table;
+
+	/* Check input parameters */
+	if (t == NULL) {
+		RTE_LOG(ERR, TABLE, "%s: table parameter is NULL\n", __func__);
+		return -EINVAL;
+	}
+
+	if (t->lru)
+		rte_table_emc_flush(t);
+	else
+		rte_table_emc_invalidate(t, key);
+
+	return t->ops.f_add(t->table, key, entry, key_found, entry_ptr);
+}
+
+static int
+rte_table_emc_entry_delete(
+	void *table,
+	void *key,
+	int *key_found,
+	void *entry)
+{
+	struct rte_table_emc *t = (struct rte_table_emc *) table;
+
+	/* Check input parameters */
+	if (t == NULL) {
+		RTE_LOG(ERR, TABLE, "%s: table parameter is NULL\n", __func__);
+		return -EINVAL;
+	}
+
+	rte_table_emc_invalidate(t, key);
+
+	return t->ops.f_delete(t->table, key, key_found, entry);
+}
+
+static int
+rte_table_emc_entry_add_bulk(
+	void *table,
+	void **keys,
+	void **entries,
+	uint32_t n_keys,
+	int *key_found,
+	void **entries_ptr)
+{
+	struct rte_table_emc *t = (struct rte_table_emc *) table;
+	uint32_t i;
+
+	/* Check input parameters */
+	if (t == NULL) {
+		RTE_LOG(ERR, TABLE, "%s: table parameter is NULL\n", __func__);
+		return -EINVAL;
+	}
+	if (t->ops.f_add_bulk == NULL) {
+		RTE_LOG(ERR, TABLE,
+			"%s: lookup table does not support bulk add\n",
+			__func__);
+		return -EINVAL;
+	}
+
+	if (t->lru || (t->exact_match == 0))
+		rte_table_emc_flush(t);
+	else
+		for (i = 0; i < n_keys; i++)
+			rte_table_emc_invalidate(t, keys[i]);
+
+	return t->ops.f_add_bulk(t->table, keys, entries, n_keys, key_found,
+		entries_ptr);
+}
+
+static int
+rte_table_emc_entry_delete_bulk(
+	void *table,
+	void **keys,
+	uint32_t n_keys,
+	int *key_found,
+	void **entries)
+{
+	struct rte_table_emc *t = (struct rte_table_emc *) table;
+	uint32_t i;
+
+	/* Check input parameters */
+	if (t == NULL) {
+		RTE_LOG(ERR, TABLE, "%s: table parameter is NULL\n", __func__);
+		return -EINVAL;
+	}
+	if (t->ops.f_delete_bulk == NULL) {
+		RTE_LOG(ERR, TABLE,
+			"%s: lookup table does not support bulk delete\n",
+			__func__);
+		return -EINVAL;
+	}
+
+	if (t->exact_match == 0)
+		rte_table_emc_flush(t);
+	else
+		for (i = 0; i < n_keys; i++)
+			rte_table_emc_invalidate(t, keys[i]);
+
+	return t->ops.f_delete_bulk(t->table, keys, n_keys, key_found,
+		entries);
+}
+
+static int
+rte_table_emc_lookup(
+	void *table,
+	struct rte_mbuf **pkts,
+	uint64_t pkts_mask,
+	uint64_t *lookup_hit_mask,
+	void **entries)
+{
+	struct rte_table_emc *t = (struct rte_table_emc *) table;
+	void *table_entries[RTE_PORT_IN_BURST_SIZE_MAX];
+	uint32_t signatures[RTE_PORT_IN_BURST_SIZE_MAX];
+	uint64_t keys[RTE_PORT_IN_BURST_SIZE_MAX][RTE_TABLE_EMC_KEY_SIZE_QW_MAX];
+	uint64_t pkts_mask_hit = 0, pkts_mask_miss = 0, pkts_mask_table_hit;
+	uint64_t mask;
+	__rte_unused uint32_t n_pkts_in = __builtin_popcountll(pkts_mask);
+
+	RTE_TABLE_EMC_STATS_PKTS_IN_ADD(t, n_pkts_in);
+
+	/* Read the keys and signatures, prefetch the EMC buckets */
+	for (mask = pkts_mask; mask; ) {
+		uint32_t pkt_index = __builtin_ctzll(mask);
+		struct rte_mbuf *pkt = pkts[pkt_index];
+
+		mask &= ~(1LLU << pkt_index);
+
+		rte_table_emc_key_read(t, pkt, keys[pkt_index]);
+		signatures[pkt_index] = RTE_MBUF_METADATA_UINT32(pkt,
+			t->signature_offset);
+		rte_prefetch0(rte_table_emc_bucket(t, signatures[pkt_index]));
+	}
+
+	/* EMC lookup */
+	for (mask = pkts_mask; mask; ) {
+		uint32_t pkt_index = __builtin_ctzll(mask);
+		uint64_t pkt_mask = 1LLU << pkt_index;
+		uint32_t signature = signatures[pkt_index];
+		struct rte_table_emc_entry *bucket;
+		uint32_t way;
+
+		mask &= ~pkt_mask;
+
+		bucket = rte_table_emc_bucket(t, signature);
+
+		for (way = 0; way < t->n_ways; way++) {
+			struct rte_table_emc_entry *e =
+				rte_table_emc_bucket_entry(t, bucket, way);
+
+			if (e->valid &&
+				(e->signature == signature) &&
+				rte_table_emc_key_equal(t, e->key,
+					keys[pkt_index])) {
+				entries[pkt_index] = e->data;
+				pkts_mask_hit |= pkt_mask;
+				break;
+			}
+		}
+
+		if (way == t->n_ways)
+			pkts_mask_miss |= pkt_mask;
+	}
+
+	RTE_TABLE_EMC_STATS_PKTS_CACHE_HIT(t,
+		__builtin_popcountll(pkts_mask_hit));
+
+	if (pkts_mask_miss == 0) {
+		*lookup_hit_mask = pkts_mask_hit;
+		return 0;
+	}
+
+	/* Lookup table lookup for the EMC misses */
+	t->ops.f_lookup(t->table, pkts, pkts_mask_miss, &pkts_mask_table_hit,
+		table_entries);
+
+	for (mask = pkts_mask_table_hit; mask; ) {
+		uint32_t pkt_index = __builtin_ctzll(mask);
+
+		mask &= ~(1LLU << pkt_index);
+
+		entries[pkt_index] = table_entries[pkt_index];
+
+		if (rte_table_emc_insert_allowed(t))
+			rte_table_emc_insert(t, signatures[pkt_index],
+				keys[pkt_index], table_entries[pkt_index]);
+	}
+
+	*lookup_hit_mask = pkts_mask_hit | pkts_mask_table_hit;
+	RTE_TABLE_EMC_STATS_PKTS_LOOKUP_MISS(t,
+		__builtin_popcountll(pkts_mask_miss & (~pkts_mask_table_hit)));
+
+	return 0;
+}
+
+static int
+rte_table_emc_stats_read(void *table, struct rte_table_stats *stats, int clear)
+{
+	struct rte_table_emc *t = (struct rte_table_emc *) table;
+
+	if (stats != NULL)
+		memcpy(stats, &t->stats, sizeof(t->stats));
+
+	if (clear)
+		memset(&t->stats, 0, sizeof(t->stats));
+
+	return 0;
+}
+
+struct rte_table_ops rte_table_emc_ops = {
+	.f_create = rte_table_emc_create,
+	.f_free = rte_table_emc_free,
+	.f_add = rte_table_emc_entry_add,
+	.f_delete = rte_table_emc_entry_delete,
+	.f_add_bulk = rte_table_emc_entry_add_bulk,
+	.f_delete_bulk = rte_table_emc_entry_delete_bulk,
+	.f_lookup = rte_table_emc_lookup,
+	.f_stats = rte_table_emc_stats_read,
+	.flags = 0,
+};
+
+struct rte_table_ops rte_table_emc_lru_ops = {
+	.f_create = rte_table_emc_lru_create,
+	.f_free = rte_table_emc_free,
+	.f_add = rte_table_emc_entry_add,
+	.f_delete = rte_table_emc_entry_delete,
+	.f_add_bulk = rte_table_emc_entry_add_bulk,
+	.f_delete_bulk = rte_table_emc_entry_delete_bulk,
+	.f_lookup = rte_table_emc_lookup,
+	.f_stats = rte_table_emc_stats_read,
+	.flags = RTE_TABLE_OPS_F_LRU,
+};
@@ -0,0 +1,132 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INCLUDE_RTE_TABLE_EMC_H__
+#define __INCLUDE_RTE_TABLE_EMC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file
+ * RTE Table Exact Match Cache (EMC)
+ *
+ * Small exact match cache placed in front of a lookup table (typically one of
+ * the hash tables). The EMC is an array of cache entries organized as 1-way
+ * (direct mapped) or 2-way set associative buckets, indexed by the key
+ * signature. Each cache entry stores the key signature, the key and the
+ * pointer to the data of the matching entry of the lookup table behind it.
+ *
+ * On lookup, the packets that hit the EMC never reach the lookup table. The
+ * packets that miss the EMC are looked up in bulk in the lookup table and the
+ * hits are inserted into the EMC with a configurable probability, so that the
+ * EMC is populated mostly by the heavy hitter flows and the mice flows do not
+ * thrash it.
+ *
+ * The EMC operations (create, free, add, delete) are forwarded to the lookup
+ * table behind it. When it is one of the hash tables, whose keys are the EMC
+ * keys, an entry add or delete only invalidates the EMC entries of its key,
+ * except for an add to an LRU table, which may evict another key and
+ * invalidates the whole EMC. The whole EMC is invalidated on every entry add
+ * and delete for the other lookup tables.
+ *
+ * The table stats report the number of packets looked up, the number of
+ * packets missed by both the EMC and the lookup table and the number of
+ * packets hitting the EMC.
+ *
+ ***/
+
+#include <stdint.h>
+
+#include "rte_table.h"
+#include "rte_table_hash.h"
+
+/** Maximum key size (number of bytes) */
+#define RTE_TABLE_EMC_KEY_SIZE_MAX                         64
+
+/** EMC table parameters */
+struct rte_table_emc_params {
+	/** Operations of the lookup table placed behind the EMC */
+	struct rte_table_ops *ops;
+
+	/** Parameters for the creation of the lookup table behind the EMC */
+	void *arg_create;
+
+	/** Key size (number of bytes). Has to be a multiple of 8 and no bigger
+	than RTE_TABLE_EMC_KEY_SIZE_MAX. */
+	uint32_t key_size;
+
+	/** Byte offset within packet meta-data where the key is located */
+	uint32_t key_offset;
+
+	/** Key mask. When NULL, all the key bits are used. */
+	uint8_t *key_mask;
+
+	/** Byte offset within packet meta-data where the pre-computed 4-byte
+	key signature is located. */
+	uint32_t signature_offset;
+
+	/** Hash function that computed the key signatures of the packet
+	meta-data, used on entry add and delete to find the EMC entries of
+	the key. When NULL, every EMC entry is checked instead. */
+	rte_table_hash_op_hash f_hash;
+
+	/** Seed value for the hash function */
+	uint64_t seed;
+
+	/** Number of EMC entries. Has to be a power of two. */
+	uint32_t n_entries;
+
+	/** Number of EMC entries per bucket: 1 (direct mapped) or 2 */
+	uint32_t n_ways;
+
+	/** A lookup table hit that missed the EMC is inserted into the EMC with
+	probability 1 / insert_inv_prob. Has to be a power of two, 1 means
+	that every such hit is inserted. */
+	uint32_t insert_inv_prob;
+};
+
+/** EMC table operations, for the lookup tables without the
+RTE_TABLE_OPS_F_LRU flag */
+extern struct rte_table_ops rte_table_emc_ops;
+
+/** EMC table operations for the LRU lookup tables, carrying their
+RTE_TABLE_OPS_F_LRU flag (e.g. so that no shadow copy is created for them) */
+extern struct rte_table_ops rte_table_emc_lru_ops;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1145,6 +1145,7 @@ struct rte_table_ops rte_table_hash_ext_ops	 = {
 	.f_delete_bulk = NULL,
 	.f_lookup = rte_table_hash_ext_lookup,
 	.f_stats = rte_table_hash_ext_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH,
 };
 
 struct rte_table_ops rte_table_hash_ext_dosig_ops  = {
@@ -1156,4 +1157,5 @@ struct rte_table_ops rte_table_hash_ext_dosig_ops  = {
 	.f_delete_bulk = NULL,
 	.f_lookup = rte_table_hash_ext_lookup_dosig,
 	.f_stats = rte_table_hash_ext_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH,
 };
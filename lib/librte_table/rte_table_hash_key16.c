@@ -1483,6 +1483,7 @@ struct rte_table_ops rte_table_hash_key16_lru_ops = {
 	.f_delete_bulk = NULL,
 	.f_lookup = rte_table_hash_lookup_key16_lru,
 	.f_stats = rte_table_hash_key16_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH | RTE_TABLE_OPS_F_LRU,
 };
 
 struct rte_table_ops rte_table_hash_key16_lru_dosig_ops = {
@@ -1492,6 +1493,7 @@ struct rte_table_ops rte_table_hash_key16_lru_dosig_ops = {
 	.f_delete = rte_table_hash_entry_delete_key16_lru,
 	.f_lookup = rte_table_hash_lookup_key16_lru_dosig,
 	.f_stats = rte_table_hash_key16_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH | RTE_TABLE_OPS_F_LRU,
 };
 
 struct rte_table_ops rte_table_hash_key16_ext_ops = {
@@ -1503,6 +1505,7 @@ struct rte_table_ops rte_table_hash_key16_ext_ops = {
 	.f_delete_bulk = NULL,
 	.f_lookup = rte_table_hash_lookup_key16_ext,
 	.f_stats = rte_table_hash_key16_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH,
 };
 
 struct rte_table_ops rte_table_hash_key16_ext_dosig_ops = {
@@ -1512,4 +1515,5 @@ struct rte_table_ops rte_table_hash_key16_ext_dosig_ops = {
 	.f_delete = rte_table_hash_entry_delete_key16_ext,
 	.f_lookup = rte_table_hash_lookup_key16_ext_dosig,
 	.f_stats = rte_table_hash_key16_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH,
 };
@@ -1130,6 +1130,7 @@ struct rte_table_ops rte_table_hash_key32_lru_ops = {
 	.f_delete_bulk = NULL,
 	.f_lookup = rte_table_hash_lookup_key32_lru,
 	.f_stats = rte_table_hash_key32_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH | RTE_TABLE_OPS_F_LRU,
 };
 
 struct rte_table_ops rte_table_hash_key32_ext_ops = {
@@ -1141,4 +1142,5 @@ struct rte_table_ops rte_table_hash_key32_ext_ops = {
 	.f_delete_bulk = NULL,
 	.f_lookup = rte_table_hash_lookup_key32_ext,
 	.f_stats = rte_table_hash_key32_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH,
 };
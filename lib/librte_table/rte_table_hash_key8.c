@@ -1435,6 +1435,7 @@ struct rte_table_ops rte_table_hash_key8_lru_ops = {
 	.f_delete_bulk = NULL,
 	.f_lookup = rte_table_hash_lookup_key8_lru,
 	.f_stats = rte_table_hash_key8_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH | RTE_TABLE_OPS_F_LRU,
 };
 
 struct rte_table_ops rte_table_hash_key8_lru_dosig_ops = {
@@ -1446,6 +1447,7 @@ struct rte_table_ops rte_table_hash_key8_lru_dosig_ops = {
 	.f_delete_bulk = NULL,
 	.f_lookup = rte_table_hash_lookup_key8_lru_dosig,
 	.f_stats = rte_table_hash_key8_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH | RTE_TABLE_OPS_F_LRU,
 };
 
 struct rte_table_ops rte_table_hash_key8_ext_ops = {
@@ -1457,6 +1459,7 @@ struct rte_table_ops rte_table_hash_key8_ext_ops = {
 	.f_delete_bulk = NULL,
 	.f_lookup = rte_table_hash_lookup_key8_ext,
 	.f_stats = rte_table_hash_key8_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH,
 };
 
 struct rte_table_ops rte_table_hash_key8_ext_dosig_ops = {
@@ -1468,4 +1471,5 @@ struct rte_table_ops rte_table_hash_key8_ext_dosig_ops = {
 	.f_delete_bulk = NULL,
 	.f_lookup = rte_table_hash_lookup_key8_ext_dosig,
 	.f_stats = rte_table_hash_key8_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH,
 };
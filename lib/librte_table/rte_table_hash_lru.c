@@ -1088,6 +1088,7 @@ struct rte_table_ops rte_table_hash_lru_ops = {
 	.f_delete_bulk = NULL,
 	.f_lookup = rte_table_hash_lru_lookup,
 	.f_stats = rte_table_hash_lru_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH | RTE_TABLE_OPS_F_LRU,
 };
 
 struct rte_table_ops rte_table_hash_lru_dosig_ops = {
@@ -1099,4 +1100,5 @@ struct rte_table_ops rte_table_hash_lru_dosig_ops = {
 	.f_delete_bulk = NULL,
 	.f_lookup = rte_table_hash_lru_lookup_dosig,
 	.f_stats = rte_table_hash_lru_stats_read,
+	.flags = RTE_TABLE_OPS_F_EXACT_MATCH | RTE_TABLE_OPS_F_LRU,
 };
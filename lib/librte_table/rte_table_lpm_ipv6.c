@@ -43,6 +43,7 @@
 #include <rte_lpm6.h>
 
 #include "rte_table_lpm_ipv6.h"
+#include "rte_table_bulk.h"
 
 #define RTE_TABLE_LPM_MAX_NEXT_HOPS                        256
 
@@ -331,6 +332,31 @@ rte_table_lpm_ipv6_entry_delete(
 	return 0;
 }
 
+static int
+rte_table_lpm_ipv6_entry_add_bulk(
+	void *table,
+	void **keys,
+	void **entries,
+	uint32_t n_keys,
+	int *key_found,
+	void **entries_ptr)
+{
+	return rte_table_bulk_add(rte_table_lpm_ipv6_entry_add, table, keys, entries,
+		n_keys, key_found, entries_ptr);
+}
+
+static int
+rte_table_lpm_ipv6_entry_delete_bulk(
+	void *table,
+	void **keys,
+	uint32_t n_keys,
+	int *key_found,
+	void **entries)
+{
+	return rte_table_bulk_delete(rte_table_lpm_ipv6_entry_delete, table, keys,
+		n_keys, key_found, entries);
+}
+
 static int
 rte_table_lpm_ipv6_lookup(
 	void *table,
@@ -391,8 +417,8 @@ struct rte_table_ops rte_table_lpm_ipv6_ops = {
 	.f_free = rte_table_lpm_ipv6_free,
 	.f_add = rte_table_lpm_ipv6_entry_add,
 	.f_delete = rte_table_lpm_ipv6_entry_delete,
-	.f_add_bulk = NULL,
-	.f_delete_bulk = NULL,
+	.f_add_bulk = rte_table_lpm_ipv6_entry_add_bulk,
+	.f_delete_bulk = rte_table_lpm_ipv6_entry_delete_bulk,
 	.f_lookup = rte_table_lpm_ipv6_lookup,
 	.f_stats = rte_table_lpm_ipv6_stats_read,
 };
@@ -0,0 +1,207 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _RTE_VHOST_ASYNC_H_
+#define _RTE_VHOST_ASYNC_H_
+
+/**
+ * @file
+ * Interface to the asynchronous enqueue of vhost.
+ *
+ * The vhost core reserves the guest buffers of the packets and writes the
+ * virtio headers, but leaves the copy of the packet data to a copy engine,
+ * so that the copies can be done by another core, or a DMA engine, while the
+ * switching core goes on with its work. The used ring is updated, in order,
+ * as the copies are reported complete.
+ */
+
+#include <stdint.h>
+
+#include <rte_virtio_net.h>
+
+/**
+ * A copy of len bytes from src to dst.
+ */
+struct rte_vhost_async_copy {
+	void *dst;
+	const void *src;
+	uint32_t len;
+};
+
+/**
+ * The copies of a packet, submitted to a copy engine as a whole.
+ */
+struct rte_vhost_async_job {
+	struct rte_vhost_async_copy *copies;
+	uint16_t nb_copies;
+};
+
+/**
+ * Copy engine of a virtqueue. The jobs and their copies stay valid until
+ * the engine reports them complete.
+ */
+struct rte_vhost_async_ops {
+	/**
+	 * Submit nb_jobs jobs to the channel chan of the engine. Returns the
+	 * number of jobs accepted, the first ones of the array.
+	 */
+	uint16_t (*submit)(void *chan, struct rte_vhost_async_job **jobs,
+		uint16_t nb_jobs);
+	/**
+	 * Returns the number of jobs, at most max_jobs, completed since the
+	 * previous call. The jobs of a channel complete in submission order.
+	 */
+	uint16_t (*poll)(void *chan, uint16_t max_jobs);
+};
+
+/**
+ * Register a copy engine for the asynchronous enqueue to a virtqueue.
+ * Typically called from the new_device() callback. Only split virtqueues
+ * are supported.
+ * @param dev
+ *  virtio-net device
+ * @param queue_id
+ *  virtio queue index in mq case, an RX virtqueue
+ * @param ops
+ *  copy engine operations
+ * @param chan
+ *  channel of the engine, passed to ops, used by this virtqueue only
+ * @return
+ *  0 on success, -1 on failure
+ */
+int rte_vhost_async_register(struct virtio_net *dev, uint16_t queue_id,
+	const struct rte_vhost_async_ops *ops, void *chan);
+
+/**
+ * Unregister the copy engine of a virtqueue. Fails while packets are in
+ * flight: rte_vhost_poll_enqueue_completed() must be called until all of
+ * them are completed. Typically called from the destroy_device() callback.
+ * @param dev
+ *  virtio-net device
+ * @param queue_id
+ *  virtio queue index in mq case
+ * @return
+ *  0 on success, -1 on failure
+ */
+int rte_vhost_async_unregister(struct virtio_net *dev, uint16_t queue_id);
+
+/**
+ * Reserve guest buffers for the packets and submit the copies of their
+ * data to the copy engine of the virtqueue. The mbufs belong to vhost until
+ * given back by rte_vhost_poll_enqueue_completed(): they must be neither
+ * modified nor freed meanwhile. Short packets are copied by the calling
+ * core. The guest pages written are logged, during a live migration, as
+ * the packets complete.
+ *
+ * Unlike rte_vhost_enqueue_burst(), a virtqueue must be used by a single
+ * core, and not with rte_vhost_enqueue_burst() while an engine is
+ * registered.
+ * @param dev
+ *  virtio-net device
+ * @param queue_id
+ *  virtio queue index in mq case
+ * @param pkts
+ *  array to contain packets to be enqueued
+ * @param count
+ *  packets num to be enqueued
+ * @return
+ *  num of packets submitted
+ */
+uint16_t rte_vhost_submit_enqueue_burst(struct virtio_net *dev,
+	uint16_t queue_id, struct rte_mbuf **pkts, uint16_t count);
+
+/**
+ * Give the completed packets to the guest, in submission order, and back to
+ * the application, which frees them.
+ * @param dev
+ *  virtio-net device
+ * @param queue_id
+ *  virtio queue index in mq case
+ * @param pkts
+ *  array to contain the completed packets
+ * @param count
+ *  size of pkts
+ * @return
+ *  num of packets completed
+ */
+uint16_t rte_vhost_poll_enqueue_completed(struct virtio_net *dev,
+	uint16_t queue_id, struct rte_mbuf **pkts, uint16_t count);
+
+/**
+ * Software copy engine: the copies are done with rte_memcpy() by a helper
+ * lcore, running rte_vhost_async_sw_run(). Each channel is a ring of jobs
+ * from one virtqueue to the helper.
+ */
+struct rte_vhost_async_sw;
+
+/** Copy engine operations of the software engine. */
+extern const struct rte_vhost_async_ops rte_vhost_async_sw_ops;
+
+/**
+ * Create a software copy engine.
+ * @param name
+ *  name of the engine, used to name its rings
+ * @param nb_channels
+ *  number of channels, one per virtqueue
+ * @param socket_id
+ *  NUMA node of the engine memory, or SOCKET_ID_ANY
+ * @return
+ *  the engine, or NULL on failure
+ */
+struct rte_vhost_async_sw *rte_vhost_async_sw_create(const char *name,
+	uint16_t nb_channels, int socket_id);
+
+/**
+ * Channel idx of a software copy engine, to pass to
+ * rte_vhost_async_register() with rte_vhost_async_sw_ops.
+ */
+void *rte_vhost_async_sw_channel(struct rte_vhost_async_sw *sw, uint16_t idx);
+
+/**
+ * Do the copies of the jobs submitted to a software copy engine, until
+ * rte_vhost_async_sw_stop() is called. Meant to be launched on the helper
+ * lcore with rte_eal_remote_launch(), the engine being the argument.
+ */
+int rte_vhost_async_sw_run(void *sw);
+
+/**
+ * Make rte_vhost_async_sw_run() return.
+ */
+void rte_vhost_async_sw_stop(struct rte_vhost_async_sw *sw);
+
+/**
+ * Free a software copy engine, once its helper lcore is stopped.
+ */
+void rte_vhost_async_sw_free(struct rte_vhost_async_sw *sw);
+
+#endif /* _RTE_VHOST_ASYNC_H_ */
@@ -46,10 +46,13 @@
 #include <sys/socket.h>
 #include <linux/if.h>
 
+#include <rte_atomic.h>
 #include <rte_memory.h>
 #include <rte_mempool.h>
+#include <rte_spinlock.h>
 
 struct rte_mbuf;
+struct vhost_async;
 
 #define VHOST_MEMORY_MAX_NREGIONS 8
 
@@ -65,6 +68,38 @@ enum {VIRTIO_RXQ, VIRTIO_TXQ, VIRTIO_QNUM};
 
 #define BUF_VECTOR_MAX 256
 
+/*
+ * Define the virtio 1.1 packed virtqueue layout for older kernels.
+ */
+#ifndef VIRTIO_F_RING_PACKED
+ #define VIRTIO_F_RING_PACKED 34
+
+struct vring_packed_desc {
+	uint64_t addr;
+	uint32_t len;
+	uint16_t id;
+	uint16_t flags;
+};
+
+struct vring_packed_desc_event {
+	uint16_t off_wrap;
+	uint16_t flags;
+};
+#endif
+
+#ifndef VIRTIO_F_IN_ORDER
+ #define VIRTIO_F_IN_ORDER 35
+#endif
+
+/* Packed descriptor flags, the values match the wrap counter when set */
+#define VRING_DESC_F_AVAIL	(1 << 7)
+#define VRING_DESC_F_USED	(1 << 15)
+
+/* Driver and device event suppression flags of a packed virtqueue */
+#define VRING_EVENT_F_ENABLE	0x0
+#define VRING_EVENT_F_DISABLE	0x1
+#define VRING_EVENT_F_DESC	0x2
+
 /**
  * Structure contains buffer address, length and descriptor index
  * from vring to do scatter RX.
@@ -75,6 +110,38 @@ struct buf_vector {
 	uint32_t desc_idx;
 };
 
+/**
+ * Mbuf pointing to the buffers of a guest descriptor chain, given back to
+ * the guest once freed by the application.
+ */
+struct zcopy_mbuf {
+	struct rte_mbuf *mbuf;
+	uint32_t desc_idx;
+};
+
+/**
+ * Host physical address of a guest physical memory range, for the zero copy
+ * mbufs to be usable by the NICs.
+ */
+struct guest_page {
+	uint64_t guest_phys_addr;
+	uint64_t host_phys_addr;
+	uint64_t size;
+};
+
+/**
+ * Dirty page log shared with QEMU for a live migration. It is replaced as a
+ * whole when QEMU resizes it, so that the data path sees a consistent base
+ * and size.
+ */
+struct vhost_log {
+	uint64_t base;		/**< Log, one bit per guest page. */
+	uint64_t size;		/**< Size of the log, in bytes. */
+	uint64_t addr;		/**< Mapping of the log, 0 if not mapped by vhost. */
+	uint64_t mmap_size;	/**< Size of the mapping. */
+	struct vhost_log *next;	/**< Replaced log, unmapped once unused. */
+};
+
 /**
  * Structure contains variables relevant to RX/TX virtqueues.
  */
@@ -90,7 +157,22 @@ struct vhost_virtqueue {
 	int			callfd;			/**< Used to notify the guest (trigger interrupt). */
 	int			kickfd;			/**< Currently unused as polling mode is enabled. */
 	int			enabled;
-	uint64_t		reserved[16];		/**< Reserve some spaces for future extension. */
+	struct zcopy_mbuf	*zmbufs;		/**< Ring of the zero copy mbufs not yet given back, in dequeue order. */
+	uint16_t		nr_zmbufs;		/**< Number of zero copy mbufs not yet given back. */
+	uint16_t		last_zcopy_used_idx;	/**< Next used ring entry in zero copy mode. */
+	uint32_t		last_region_idx;	/**< Guest memory region of the last address translation. */
+	struct vring_packed_desc	*desc_packed;	/**< Packed virtqueue descriptor ring. */
+	struct vring_packed_desc_event	*driver_event;	/**< Packed virtqueue driver event suppression area. */
+	struct vring_packed_desc_event	*device_event;	/**< Packed virtqueue device event suppression area. */
+	uint16_t		used_wrap_counter;	/**< Wrap counter of last_used_idx in a packed virtqueue. */
+	uint16_t		zmbuf_first;		/**< Oldest zero copy mbuf in the zmbufs ring. */
+	rte_spinlock_t		packed_lock;		/**< Serializes the enqueues to a packed virtqueue. */
+	int			numa_node;		/**< NUMA node of the vring memory, -1 if unknown. */
+	uint64_t		log_guest_addr;		/**< Guest physical address of the used ring, or device area, for the dirty log. */
+	uint64_t		log_desc_addr;		/**< Guest physical address of the packed descriptor ring. */
+	struct vhost_async	*async;			/**< Asynchronous enqueue state, NULL if no copy engine is registered. */
+	rte_atomic64_t		tso_dropped;		/**< TSO packets dropped, the guest not receiving TSO for their IP version. */
+	uint64_t		reserved[5];		/**< Reserve some spaces for future extension. */
 	struct buf_vector	buf_vec[BUF_VECTOR_MAX];	/**< for scatter RX. */
 } __rte_cache_aligned;
 
@@ -129,7 +211,12 @@ struct virtio_net {
 	char			ifname[IF_NAME_SZ];	/**< Name of the tap device or socket path. */
 	uint32_t		virt_qp_nb;	/**< number of queue pair we have allocated */
 	void			*priv;		/**< private context */
-	uint64_t		reserved[64];	/**< Reserve some spaces for future extension. */
+	uint32_t		dequeue_zero_copy;	/**< Dequeued packets are not copied. */
+	uint32_t		nr_guest_pages;	/**< Number of entries of guest_pages. */
+	struct guest_page	*guest_pages;	/**< Guest to host physical address table. */
+	int			numa_node;	/**< NUMA node of the first vring memory, -1 if unknown. */
+	struct vhost_log	*log;		/**< Dirty page log, NULL if none. */
+	uint64_t		reserved[60];	/**< Reserve some spaces for future extension. */
 	struct vhost_virtqueue	*virtqueue[VHOST_MAX_QUEUE_PAIRS * 2];	/**< Contains all virtqueue information. */
 } __rte_cache_aligned;
 
@@ -168,6 +255,7 @@ struct virtio_net_device_ops {
 	void (*destroy_device)(volatile struct virtio_net *);	/**< Remove device. */
 
 	int (*vring_state_changed)(struct virtio_net *dev, uint16_t queue_id, int enable);	/**< triggered when a vring is enabled or disabled */
+	int (*vring_numa_changed)(struct virtio_net *dev, uint16_t queue_id, int numa_node);	/**< triggered when the vring of a running device is on another NUMA node than the device */
 };
 
 static inline uint16_t __attribute__((always_inline))
@@ -178,6 +266,25 @@ rte_vring_available_entries(struct virtio_net *dev, uint16_t queue_id)
 	if (!vq->enabled)
 		return 0;
 
+	if (dev->features & (1ULL << VIRTIO_F_RING_PACKED)) {
+		uint16_t idx = vq->last_used_idx;
+		uint16_t wrap = vq->used_wrap_counter;
+		uint16_t flags, n;
+
+		/* Count the descriptors made available from last_used_idx */
+		for (n = 0; n < vq->size; n++) {
+			flags = *(volatile uint16_t *)&vq->desc_packed[idx].flags;
+			if (!!(flags & VRING_DESC_F_AVAIL) != wrap ||
+			    !!(flags & VRING_DESC_F_USED) == wrap)
+				break;
+			if (++idx == vq->size) {
+				idx = 0;
+				wrap ^= 1;
+			}
+		}
+		return n;
+	}
+
 	return *(volatile uint16_t *)&vq->avail->idx - vq->last_used_idx_res;
 }
 
@@ -218,9 +325,27 @@ uint64_t rte_vhost_feature_get(void);
 
 int rte_vhost_enable_guest_notification(struct virtio_net *dev, uint16_t queue_id, int enable);
 
+/*
+ * Returns the NUMA node of the guest memory of a vring, -1 if unknown. Its
+ * vhost structures are allocated there when CONFIG_RTE_LIBRTE_VHOST_NUMA is
+ * enabled, so the queue is best polled from a core of that node.
+ */
+int rte_vhost_get_numa_node(struct virtio_net *dev, uint16_t queue_id);
+
 /* Register vhost driver. dev_name could be different for multiple instance support. */
 int rte_vhost_driver_register(const char *dev_name);
 
+/*
+ * Dequeued packets point to the guest buffers instead of being copied. The
+ * buffers are given back to the guest when the application frees the mbufs,
+ * which must not be cloned, in the order of their dequeue. Short packets
+ * are still copied. Only meaningful to vhost user.
+ */
+#define RTE_VHOST_USER_DEQUEUE_ZERO_COPY	(1ULL << 0)
+
+/* Register vhost driver with RTE_VHOST_USER_* flags. */
+int rte_vhost_driver_register_flags(const char *dev_name, uint64_t flags);
+
 /* Unregister vhost driver. This is only meaningful to vhost user. */
 int rte_vhost_driver_unregister(const char *dev_name);
 
@@ -233,7 +358,9 @@ int rte_vhost_driver_session_start(void);
  * This function adds buffers to the virtio devices RX virtqueue. Buffers can
  * be received from the physical port or from another virtual device. A packet
  * count is returned to indicate the number of packets that were succesfully
- * added to the RX queue.
+ * added to the RX queue. TSO packets are dropped, and counted in the
+ * tso_dropped counter of the virtqueue, when the guest does not receive
+ * TSO for their IP version: they are counted in the returned number.
  * @param dev
  *  virtio-net device
  * @param queue_id
@@ -268,4 +395,34 @@ uint16_t rte_vhost_enqueue_burst(struct virtio_net *dev, uint16_t queue_id,
 uint16_t rte_vhost_dequeue_burst(struct virtio_net *dev, uint16_t queue_id,
 	struct rte_mempool *mbuf_pool, struct rte_mbuf **pkts, uint16_t count);
 
+/**
+ * Prepare a packet dequeued from a guest for transmission on a port which
+ * may lack the checksum and TCP segmentation offloads requested by the
+ * guest. The checksums the port cannot compute are computed in software. A
+ * TSO packet is segmented in software if the port does not support TSO;
+ * it is then freed and replaced by its segments.
+ *
+ * The guest only requests these offloads once the application enables the
+ * VIRTIO_NET_F_CSUM, VIRTIO_NET_F_HOST_TSO4 and VIRTIO_NET_F_HOST_TSO6
+ * features with rte_vhost_feature_enable(); they are disabled by default.
+ * @param pkt
+ *  packet to prepare, with its TX offload flags and header lengths set by
+ *  rte_vhost_dequeue_burst()
+ * @param tx_offload_capa
+ *  DEV_TX_OFFLOAD_* capabilities of the port, as in rte_eth_dev_info
+ * @param mp
+ *  mempool where the segments are allocated, with room for the headers and
+ *  one MSS of payload in a single mbuf
+ * @param pkts_out
+ *  array to contain the packets to transmit
+ * @param nb_pkts_out
+ *  size of pkts_out
+ * @return
+ *  num of packets stored in pkts_out, or a negative errno value (pkt is
+ *  then left unchanged, except for its checksums)
+ */
+int rte_vhost_offload_fallback(struct rte_mbuf *pkt, uint32_t tx_offload_capa,
+	struct rte_mempool *mp, struct rte_mbuf **pkts_out,
+	uint16_t nb_pkts_out);
+
 #endif /* _VIRTIO_NET_H_ */
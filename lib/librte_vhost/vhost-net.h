@@ -33,12 +33,16 @@
 
 #ifndef _VHOST_NET_CDEV_H_
 #define _VHOST_NET_CDEV_H_
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <linux/vhost.h>
 
+#include <rte_atomic.h>
+#include <rte_branch_prediction.h>
+#include <rte_common.h>
 #include <rte_log.h>
 
 #include "rte_virtio_net.h"
@@ -76,6 +80,150 @@ extern struct vhost_net_device_ops const *ops;
 #define PRINT_PACKET(device, addr, size, header) do {} while (0)
 #endif
 
+/* Offloads the guest may request on the packets it transmits. */
+#define VHOST_HOST_OFFLOAD_FEATURES ((1ULL << VIRTIO_NET_F_CSUM) | \
+				(1ULL << VIRTIO_NET_F_HOST_TSO4) | \
+				(1ULL << VIRTIO_NET_F_HOST_TSO6))
+
+/*
+ * Wait for the application to free the zero copy mbufs of a device, however
+ * long it takes, and give their buffers back to the guest.
+ */
+void vhost_zcopy_drain(struct virtio_net *dev);
+
+/*
+ * Wait for the copy engines of a stopped device to complete the packets in
+ * flight, which are given to the guest and freed. Returns the number of
+ * packets still in flight.
+ */
+uint32_t vhost_async_drain(struct virtio_net *dev);
+
+/*
+ * Free the asynchronous enqueue state of a virtqueue, unless packets are
+ * still in flight in its copy engine: it is then left allocated.
+ */
+void vhost_async_free(struct virtio_net *dev, struct vhost_virtqueue *vq);
+
+/*
+ * Dirty page logging, for live migration: while the guest negotiates
+ * VHOST_F_LOG_ALL, a bit is set in the log shared with QEMU for each guest
+ * page written. The pages written by a burst are gathered on the stack in
+ * a vhost_log_cache, and OR'ed into the log once at the end of the burst,
+ * so the enqueues of several cores to a virtqueue need no synchronization.
+ */
+#define VHOST_LOG_PAGE		4096
+#define VHOST_LOG_CACHE_NR	32
+
+struct vhost_log_cache {
+	uint32_t nr;
+	struct {
+		uint32_t offset;	/* Index of the 64-bit log word. */
+		uint64_t val;		/* Bits to set in the word. */
+	} entries[VHOST_LOG_CACHE_NR];
+};
+
+/*
+ * Set the bits gathered in cache in the log. The log may be replaced by a
+ * larger one meanwhile: its base and size are read once, from the same
+ * log.
+ */
+static inline void
+vhost_log_cache_sync(struct virtio_net *dev, struct vhost_log_cache *cache)
+{
+	const struct vhost_log *log =
+		*(struct vhost_log * const volatile *)&dev->log;
+	uint64_t *log_base;
+	uint64_t nr_words;
+	uint32_t i;
+
+	if (likely(cache->nr == 0))
+		return;
+
+	if (log != NULL) {
+		log_base = (uint64_t *)(uintptr_t)log->base;
+		/* The log is a whole number of 64-bit words. */
+		nr_words = log->size / sizeof(uint64_t);
+		/* The pages are only marked dirty once written. */
+		rte_smp_wmb();
+		for (i = 0; i < cache->nr; i++)
+			if (likely(cache->entries[i].offset < nr_words))
+				__sync_fetch_and_or(
+					&log_base[cache->entries[i].offset],
+					cache->entries[i].val);
+	}
+	cache->nr = 0;
+}
+
+static inline void
+vhost_log_cache_page(struct virtio_net *dev, struct vhost_log_cache *cache,
+	uint64_t page)
+{
+	uint32_t offset = page / 64;
+	uint64_t val = 1ULL << (page % 64);
+	uint32_t i;
+
+	/* Beyond any log, checked against the log size when synced. */
+	if (unlikely(page / 64 > UINT32_MAX))
+		return;
+
+	for (i = 0; i < cache->nr; i++) {
+		if (cache->entries[i].offset == offset) {
+			cache->entries[i].val |= val;
+			return;
+		}
+	}
+
+	if (unlikely(cache->nr == VHOST_LOG_CACHE_NR))
+		vhost_log_cache_sync(dev, cache);
+	cache->entries[cache->nr].offset = offset;
+	cache->entries[cache->nr].val = val;
+	cache->nr++;
+}
+
+/* Log len bytes written at guest physical address addr. */
+static inline void __attribute__((always_inline))
+vhost_log_write(struct virtio_net *dev, struct vhost_log_cache *cache,
+	uint64_t addr, uint64_t len)
+{
+	uint64_t page;
+
+	if (likely(!(dev->features & (1ULL << VHOST_F_LOG_ALL))) || len == 0)
+		return;
+
+	for (page = addr / VHOST_LOG_PAGE; page * VHOST_LOG_PAGE < addr + len;
+			page++)
+		vhost_log_cache_page(dev, cache, page);
+}
+
+/* Log len bytes written at offset of the used ring, or device area. */
+static inline void __attribute__((always_inline))
+vhost_log_used_vring(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	struct vhost_log_cache *cache, uint64_t offset, uint64_t len)
+{
+	vhost_log_write(dev, cache, vq->log_guest_addr + offset, len);
+}
+
+/* Log n used ring entries from used_idx, and the used ring index. */
+static inline void __attribute__((always_inline))
+vhost_log_used_entries(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	struct vhost_log_cache *cache, uint16_t used_idx, uint16_t n)
+{
+	uint16_t from = used_idx & (vq->size - 1);
+	uint16_t first = RTE_MIN(n, (uint16_t)(vq->size - from));
+
+	if (likely(!(dev->features & (1ULL << VHOST_F_LOG_ALL))))
+		return;
+
+	vhost_log_used_vring(dev, vq, cache, offsetof(struct vring_used, ring) +
+		from * sizeof(struct vring_used_elem),
+		first * sizeof(struct vring_used_elem));
+	if (first != n)
+		vhost_log_used_vring(dev, vq, cache,
+			offsetof(struct vring_used, ring),
+			(n - first) * sizeof(struct vring_used_elem));
+	vhost_log_used_vring(dev, vq, cache, offsetof(struct vring_used, idx),
+		sizeof(uint16_t));
+}
 
 /*
  * Structure used to identify device context.
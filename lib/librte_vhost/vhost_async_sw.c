@@ -0,0 +1,188 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <rte_common.h>
+#include <rte_malloc.h>
+#include <rte_memcpy.h>
+#include <rte_ring.h>
+#include <rte_vhost_async.h>
+
+#include "vhost-net.h"
+
+/* Jobs in flight in a channel. */
+#define VHOST_ASYNC_SW_RING_SIZE 1024
+/* Jobs dequeued at once by the helper lcore. */
+#define VHOST_ASYNC_SW_BURST 32
+
+struct vhost_async_sw_chan {
+	struct rte_ring *ring;		/* Jobs for the helper lcore. */
+	/* Jobs completed by the helper, written by the helper only. */
+	volatile uint64_t nr_completed __rte_cache_aligned;
+	/* Jobs reported complete, written by the vhost core only. */
+	uint64_t nr_polled __rte_cache_aligned;
+} __rte_cache_aligned;
+
+struct rte_vhost_async_sw {
+	volatile int stop;
+	uint16_t nb_channels;
+	struct vhost_async_sw_chan chans[0];
+};
+
+static uint16_t
+vhost_async_sw_submit(void *chan, struct rte_vhost_async_job **jobs,
+	uint16_t nb_jobs)
+{
+	struct vhost_async_sw_chan *c = chan;
+
+	return rte_ring_sp_enqueue_burst(c->ring, (void * const *)jobs,
+		nb_jobs);
+}
+
+static uint16_t
+vhost_async_sw_poll(void *chan, uint16_t max_jobs)
+{
+	struct vhost_async_sw_chan *c = chan;
+	uint64_t nr_done = c->nr_completed - c->nr_polled;
+
+	/* The counter is read before the copies are used. */
+	rte_smp_rmb();
+	if (nr_done > max_jobs)
+		nr_done = max_jobs;
+	c->nr_polled += nr_done;
+
+	return nr_done;
+}
+
+const struct rte_vhost_async_ops rte_vhost_async_sw_ops = {
+	.submit = vhost_async_sw_submit,
+	.poll = vhost_async_sw_poll,
+};
+
+struct rte_vhost_async_sw *
+rte_vhost_async_sw_create(const char *name, uint16_t nb_channels,
+	int socket_id)
+{
+	struct rte_vhost_async_sw *sw;
+	char ring_name[RTE_RING_NAMESIZE];
+	uint16_t i;
+
+	sw = rte_zmalloc_socket(name, sizeof(*sw) +
+		nb_channels * sizeof(sw->chans[0]), RTE_CACHE_LINE_SIZE,
+		socket_id);
+	if (sw == NULL) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"failed to allocate copy engine %s\n", name);
+		return NULL;
+	}
+	sw->nb_channels = nb_channels;
+
+	for (i = 0; i < nb_channels; i++) {
+		snprintf(ring_name, sizeof(ring_name), "%s_%u", name, i);
+		sw->chans[i].ring = rte_ring_create(ring_name,
+			VHOST_ASYNC_SW_RING_SIZE, socket_id,
+			RING_F_SP_ENQ | RING_F_SC_DEQ);
+		if (sw->chans[i].ring == NULL) {
+			RTE_LOG(ERR, VHOST_CONFIG,
+				"failed to create ring %s\n", ring_name);
+			rte_vhost_async_sw_free(sw);
+			return NULL;
+		}
+	}
+
+	return sw;
+}
+
+void *
+rte_vhost_async_sw_channel(struct rte_vhost_async_sw *sw, uint16_t idx)
+{
+	if (idx >= sw->nb_channels)
+		return NULL;
+
+	return &sw->chans[idx];
+}
+
+int
+rte_vhost_async_sw_run(void *arg)
+{
+	struct rte_vhost_async_sw *sw = arg;
+	struct rte_vhost_async_job *jobs[VHOST_ASYNC_SW_BURST];
+	struct rte_vhost_async_copy *copies;
+	struct vhost_async_sw_chan *c;
+	unsigned int nb_jobs, i, j;
+	uint16_t idx;
+
+	while (!sw->stop) {
+		for (idx = 0; idx < sw->nb_channels; idx++) {
+			c = &sw->chans[idx];
+			nb_jobs = rte_ring_sc_dequeue_burst(c->ring,
+				(void **)jobs, VHOST_ASYNC_SW_BURST);
+			if (nb_jobs == 0)
+				continue;
+
+			for (i = 0; i < nb_jobs; i++) {
+				copies = jobs[i]->copies;
+				for (j = 0; j < jobs[i]->nb_copies; j++)
+					rte_memcpy(copies[j].dst,
+						copies[j].src, copies[j].len);
+			}
+
+			/* The copies are done before they are reported. */
+			rte_smp_wmb();
+			c->nr_completed += nb_jobs;
+		}
+	}
+
+	return 0;
+}
+
+void
+rte_vhost_async_sw_stop(struct rte_vhost_async_sw *sw)
+{
+	sw->stop = 1;
+}
+
+void
+rte_vhost_async_sw_free(struct rte_vhost_async_sw *sw)
+{
+	uint16_t i;
+
+	if (sw == NULL)
+		return;
+
+	for (i = 0; i < sw->nb_channels; i++)
+		rte_ring_free(sw->chans[i].ring);
+	rte_free(sw);
+}
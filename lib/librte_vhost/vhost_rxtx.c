@@ -33,11 +33,20 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
 #include <linux/virtio_net.h>
 
 #include <rte_mbuf.h>
+#include <rte_malloc.h>
 #include <rte_memcpy.h>
+#include <rte_ethdev.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+#include <rte_udp.h>
 #include <rte_virtio_net.h>
+#include <rte_vhost_async.h>
 
 #include "vhost-net.h"
 
@@ -49,6 +58,404 @@ is_valid_virt_queue_idx(uint32_t idx, int is_tx, uint32_t qp_nb)
 	return (is_tx ^ (idx & 1)) == 0 && idx < qp_nb * VIRTIO_QNUM;
 }
 
+/*
+ * Same as gpa_to_vva(), but the region of the previous translation on the
+ * virtqueue is tried first: the buffers of a burst are nearly always in the
+ * same guest memory region. The cached index is checked against the current
+ * memory table, so it needs no reset when the table changes.
+ */
+static inline uint64_t __attribute__((always_inline))
+vq_gpa_to_vva(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	uint64_t guest_pa)
+{
+	struct virtio_memory *mem = dev->mem;
+	struct virtio_memory_regions *region;
+	uint32_t regionidx = vq->last_region_idx;
+
+	if (likely(regionidx < mem->nregions)) {
+		region = &mem->regions[regionidx];
+		if (likely(guest_pa >= region->guest_phys_address &&
+				guest_pa <= region->guest_phys_address_end))
+			return region->address_offset + guest_pa;
+	}
+
+	for (regionidx = 0; regionidx < mem->nregions; regionidx++) {
+		region = &mem->regions[regionidx];
+		if (guest_pa >= region->guest_phys_address &&
+				guest_pa <= region->guest_phys_address_end) {
+			vq->last_region_idx = regionidx;
+			return region->address_offset + guest_pa;
+		}
+	}
+
+	return 0;
+}
+
+/* mbuf TX flags which need work before a packet is given to the guest. */
+#define VHOST_TX_OFFLOAD_FLAGS (PKT_TX_IP_CKSUM | PKT_TX_L4_MASK | \
+				PKT_TX_TCP_SEG)
+
+/* TCP flags cleared in all but the last or the first segment. */
+#define VHOST_TCP_FIN_FLAG 0x01
+#define VHOST_TCP_PSH_FLAG 0x08
+#define VHOST_TCP_CWR_FLAG 0x80
+
+/*
+ * Copy len bytes at offset off of a (possibly segmented) mbuf to buf.
+ * The caller checks that the data is within the packet.
+ */
+static void
+vhost_mbuf_read(const struct rte_mbuf *m, uint32_t off, void *buf,
+	uint32_t len)
+{
+	uint8_t *dst = buf;
+	uint32_t cpy_len;
+
+	if (len == 0)
+		return;
+
+	while (off >= rte_pktmbuf_data_len(m)) {
+		off -= rte_pktmbuf_data_len(m);
+		m = m->next;
+	}
+
+	while (len != 0) {
+		cpy_len = RTE_MIN(len, (uint32_t)rte_pktmbuf_data_len(m) - off);
+		rte_memcpy(dst, rte_pktmbuf_mtod_offset(m, const void *, off),
+			cpy_len);
+		dst += cpy_len;
+		len -= cpy_len;
+		off = 0;
+		m = m->next;
+	}
+}
+
+/*
+ * Raw (not complemented) checksum of len bytes at offset off of a
+ * (possibly segmented) mbuf. The sum of a chunk starting at an odd offset
+ * from off is byte swapped before being added.
+ */
+static uint16_t
+vhost_mbuf_raw_cksum(const struct rte_mbuf *m, uint32_t off, uint32_t len,
+	uint32_t sum)
+{
+	uint32_t done = 0, seg_len;
+	uint16_t tmp;
+
+	while (off >= rte_pktmbuf_data_len(m)) {
+		off -= rte_pktmbuf_data_len(m);
+		m = m->next;
+	}
+
+	while (done < len) {
+		seg_len = RTE_MIN(len - done,
+			(uint32_t)rte_pktmbuf_data_len(m) - off);
+		tmp = __rte_raw_cksum_reduce(__rte_raw_cksum(
+			rte_pktmbuf_mtod_offset(m, const void *, off),
+			seg_len, 0));
+		if (done & 1)
+			tmp = rte_bswap16(tmp);
+		sum += tmp;
+		done += seg_len;
+		off = 0;
+		m = m->next;
+	}
+
+	return __rte_raw_cksum_reduce(sum);
+}
+
+/*
+ * Raw sum of the IPv4 or IPv6 pseudo header of an L4 packet of l4_len
+ * bytes.
+ */
+static uint32_t
+vhost_phdr_sum(const void *l3_hdr, uint64_t ol_flags, uint32_t l4_len)
+{
+	uint32_t sum;
+
+	if (ol_flags & PKT_TX_IPV4) {
+		const struct ipv4_hdr *ip = l3_hdr;
+
+		sum = __rte_raw_cksum(&ip->src_addr, 2 * sizeof(uint32_t), 0);
+		sum += rte_cpu_to_be_16((uint16_t)ip->next_proto_id);
+		sum += rte_cpu_to_be_16((uint16_t)l4_len);
+	} else {
+		const struct ipv6_hdr *ip = l3_hdr;
+
+		sum = __rte_raw_cksum(ip->src_addr, 2 * 16, 0);
+		sum += rte_cpu_to_be_16((uint16_t)ip->proto);
+		sum += rte_cpu_to_be_16((uint16_t)(l4_len >> 16));
+		sum += rte_cpu_to_be_16((uint16_t)l4_len);
+	}
+
+	return sum;
+}
+
+/* Length of the L4 header and payload, from the L3 header. */
+static uint32_t
+vhost_l4_len(const void *l3_hdr, uint64_t ol_flags, uint32_t l3_len)
+{
+	if (ol_flags & PKT_TX_IPV4) {
+		const struct ipv4_hdr *ip = l3_hdr;
+
+		return rte_be_to_cpu_16(ip->total_length) - l3_len;
+	} else {
+		const struct ipv6_hdr *ip = l3_hdr;
+
+		return rte_be_to_cpu_16(ip->payload_len) + sizeof(*ip) -
+			l3_len;
+	}
+}
+
+/*
+ * Compute in software the checksums requested by flags (PKT_TX_IP_CKSUM
+ * and/or one of PKT_TX_TCP_CKSUM or PKT_TX_UDP_CKSUM), using the l2_len and
+ * l3_len of the mbuf. The L2 and L3 headers must be in the first segment.
+ */
+static int
+vhost_sw_cksum(struct rte_mbuf *m, uint64_t flags)
+{
+	uint32_t hdr_len = m->l2_len + m->l3_len;
+	uint32_t l4_len, cksum_off;
+	uint16_t cksum;
+	void *l3_hdr;
+	uint16_t *l4_cksum;
+
+	if (unlikely(hdr_len > rte_pktmbuf_data_len(m)))
+		return -EINVAL;
+
+	l3_hdr = rte_pktmbuf_mtod_offset(m, void *, m->l2_len);
+
+	if ((flags & PKT_TX_IP_CKSUM) && (m->ol_flags & PKT_TX_IPV4)) {
+		struct ipv4_hdr *ip = l3_hdr;
+
+		ip->hdr_checksum = 0;
+		cksum = rte_raw_cksum(ip, m->l3_len);
+		ip->hdr_checksum = (cksum == 0xffff) ? cksum : ~cksum;
+	}
+
+	switch (flags & PKT_TX_L4_MASK) {
+	case PKT_TX_TCP_CKSUM:
+		cksum_off = offsetof(struct tcp_hdr, cksum);
+		break;
+	case PKT_TX_UDP_CKSUM:
+		cksum_off = offsetof(struct udp_hdr, dgram_cksum);
+		break;
+	default:
+		return 0;
+	}
+
+	l4_len = vhost_l4_len(l3_hdr, m->ol_flags, m->l3_len);
+	if (unlikely(hdr_len + cksum_off + sizeof(uint16_t) >
+			rte_pktmbuf_data_len(m) ||
+			hdr_len + l4_len > rte_pktmbuf_pkt_len(m)))
+		return -EINVAL;
+
+	l4_cksum = rte_pktmbuf_mtod_offset(m, uint16_t *, hdr_len + cksum_off);
+	*l4_cksum = 0;
+	cksum = ~vhost_mbuf_raw_cksum(m, hdr_len, l4_len,
+		vhost_phdr_sum(l3_hdr, m->ol_flags, l4_len));
+	if (cksum == 0 && (flags & PKT_TX_L4_MASK) == PKT_TX_UDP_CKSUM)
+		cksum = 0xffff;
+	*l4_cksum = cksum;
+
+	return 0;
+}
+
+/*
+ * A TSO packet for a guest which did not negotiate TSO for its IP version,
+ * dropped by the enqueue.
+ */
+static inline int __attribute__((always_inline))
+vhost_tso_unsupported(struct virtio_net *dev, const struct rte_mbuf *m)
+{
+	if (likely(!(m->ol_flags & PKT_TX_TCP_SEG)))
+		return 0;
+	return !(dev->features & ((m->ol_flags & PKT_TX_IPV4) ?
+		(1ULL << VIRTIO_NET_F_GUEST_TSO4) :
+		(1ULL << VIRTIO_NET_F_GUEST_TSO6)));
+}
+
+/*
+ * Fill the virtio-net header of a packet given to the guest from the TX
+ * offload flags of its mbuf. The checksums the guest did not negotiate, and
+ * the IPv4 header checksum, which virtio cannot offload, are done in
+ * software. TSO packets come here only when the guest negotiated TSO.
+ */
+static inline void __attribute__((always_inline))
+virtio_enqueue_offload(struct virtio_net *dev, struct rte_mbuf *m,
+	struct virtio_net_hdr *hdr)
+{
+	uint64_t sw_flags = m->ol_flags & PKT_TX_IP_CKSUM;
+	uint64_t l4_flags = m->ol_flags & PKT_TX_L4_MASK;
+
+	if (m->ol_flags & PKT_TX_TCP_SEG) {
+		uint32_t hdr_len = m->l2_len + m->l3_len;
+		struct tcp_hdr *tcp_hdr;
+		void *l3_hdr;
+
+		if (unlikely(hdr_len + sizeof(struct tcp_hdr) >
+				rte_pktmbuf_data_len(m)))
+			return;
+		/* Put back the length in the TSO pseudo header checksum. */
+		l3_hdr = rte_pktmbuf_mtod_offset(m, void *, m->l2_len);
+		tcp_hdr = rte_pktmbuf_mtod_offset(m, struct tcp_hdr *, hdr_len);
+		tcp_hdr->cksum = __rte_raw_cksum_reduce(vhost_phdr_sum(l3_hdr,
+			m->ol_flags, vhost_l4_len(l3_hdr, m->ol_flags,
+				m->l3_len)));
+
+		l4_flags = PKT_TX_TCP_CKSUM;
+		hdr->gso_type = (m->ol_flags & PKT_TX_IPV4) ?
+			VIRTIO_NET_HDR_GSO_TCPV4 : VIRTIO_NET_HDR_GSO_TCPV6;
+		hdr->gso_size = m->tso_segsz;
+		hdr->hdr_len = m->l2_len + m->l3_len + m->l4_len;
+	}
+
+	if (l4_flags == PKT_TX_TCP_CKSUM || l4_flags == PKT_TX_UDP_CKSUM) {
+		if (dev->features & (1ULL << VIRTIO_NET_F_GUEST_CSUM)) {
+			/*
+			 * The pseudo header checksum is already in the L4
+			 * header, as with the NICs.
+			 */
+			hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+			hdr->csum_start = m->l2_len + m->l3_len;
+			hdr->csum_offset = (l4_flags == PKT_TX_TCP_CKSUM) ?
+				offsetof(struct tcp_hdr, cksum) :
+				offsetof(struct udp_hdr, dgram_cksum);
+		} else {
+			sw_flags |= l4_flags;
+		}
+	}
+
+	if (sw_flags != 0 && unlikely(vhost_sw_cksum(m, sw_flags) < 0))
+		LOG_DEBUG(VHOST_DATA, "(%"PRIu64") invalid offload request\n",
+			dev->device_fh);
+}
+
+/*
+ * Complete in software a checksum requested by the guest which cannot be
+ * left to a NIC: as virtio specifies, the data from start to the end of
+ * the packet, including the pseudo header sum the guest stored at
+ * start + offset, is summed there.
+ */
+static void
+vhost_sw_cksum_partial(struct rte_mbuf *m, uint32_t start, uint32_t offset)
+{
+	uint16_t *l4_cksum;
+	uint16_t cksum;
+
+	if (unlikely(start + offset + sizeof(uint16_t) >
+			rte_pktmbuf_data_len(m)))
+		return;
+
+	cksum = ~vhost_mbuf_raw_cksum(m, start,
+		rte_pktmbuf_pkt_len(m) - start, 0);
+	l4_cksum = rte_pktmbuf_mtod_offset(m, uint16_t *, start + offset);
+	*l4_cksum = (cksum == 0) ? 0xffff : cksum;
+}
+
+/*
+ * Set the RX offload flags and header lengths of a packet sent by the
+ * guest from its virtio-net header, for the packet to be transmitted by a
+ * NIC or given back to a guest. A TCP segmentation request is turned into
+ * a TSO request with the pseudo header checksum DPDK expects. A checksum
+ * request the offload flags cannot express is completed in software.
+ */
+static inline void __attribute__((always_inline))
+vhost_dequeue_offload(struct virtio_net_hdr *hdr, struct rte_mbuf *m)
+{
+	struct ether_hdr *eth_hdr;
+	struct tcp_hdr *tcp_hdr;
+	void *l3_hdr;
+	uint16_t ethertype;
+	uint64_t l4_flag = 0;
+	uint32_t l2_len, data_len = rte_pktmbuf_data_len(m);
+
+	if (likely(hdr->flags == 0 &&
+			hdr->gso_type == VIRTIO_NET_HDR_GSO_NONE))
+		return;
+
+	if (unlikely(data_len < sizeof(struct ether_hdr)))
+		goto sw_cksum;
+	eth_hdr = rte_pktmbuf_mtod(m, struct ether_hdr *);
+	l2_len = sizeof(struct ether_hdr);
+	ethertype = rte_be_to_cpu_16(eth_hdr->ether_type);
+	if (ethertype == ETHER_TYPE_VLAN) {
+		struct vlan_hdr *vlan_hdr = (struct vlan_hdr *)(eth_hdr + 1);
+
+		if (unlikely(data_len < l2_len + sizeof(struct vlan_hdr)))
+			goto sw_cksum;
+		l2_len += sizeof(struct vlan_hdr);
+		ethertype = rte_be_to_cpu_16(vlan_hdr->eth_proto);
+	}
+
+	l3_hdr = rte_pktmbuf_mtod_offset(m, void *, l2_len);
+	if (ethertype == ETHER_TYPE_IPv4) {
+		if (unlikely(data_len < l2_len + sizeof(struct ipv4_hdr)))
+			goto sw_cksum;
+		m->l3_len = (((struct ipv4_hdr *)l3_hdr)->version_ihl & 0x0f) *
+			4;
+		m->ol_flags |= PKT_TX_IPV4;
+	} else if (ethertype == ETHER_TYPE_IPv6) {
+		m->l3_len = sizeof(struct ipv6_hdr);
+		m->ol_flags |= PKT_TX_IPV6;
+	} else {
+		goto sw_cksum;
+	}
+	m->l2_len = l2_len;
+
+	/*
+	 * The L4 checksum offload flags only cover a TCP or UDP header
+	 * right after the L3 one, e.g. not after IPv6 extension headers.
+	 */
+	if ((hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) &&
+			hdr->csum_start == l2_len + m->l3_len) {
+		switch (hdr->csum_offset) {
+		case offsetof(struct tcp_hdr, cksum):
+			l4_flag = PKT_TX_TCP_CKSUM;
+			break;
+		case offsetof(struct udp_hdr, dgram_cksum):
+			l4_flag = PKT_TX_UDP_CKSUM;
+			break;
+		default:
+			break;
+		}
+	}
+
+	switch (hdr->gso_type & ~VIRTIO_NET_HDR_GSO_ECN) {
+	case VIRTIO_NET_HDR_GSO_TCPV4:
+	case VIRTIO_NET_HDR_GSO_TCPV6:
+		if (unlikely(data_len < hdr->csum_start +
+				sizeof(struct tcp_hdr) ||
+				hdr->csum_start != l2_len + m->l3_len))
+			break;
+		tcp_hdr = rte_pktmbuf_mtod_offset(m, struct tcp_hdr *,
+			hdr->csum_start);
+		m->l4_len = (tcp_hdr->data_off & 0xf0) >> 2;
+		m->tso_segsz = hdr->gso_size;
+		m->ol_flags |= PKT_TX_TCP_SEG;
+		if (m->ol_flags & PKT_TX_IPV4) {
+			((struct ipv4_hdr *)l3_hdr)->hdr_checksum = 0;
+			m->ol_flags |= PKT_TX_IP_CKSUM;
+		}
+		/* The guest includes the length, TSO expects it excluded. */
+		tcp_hdr->cksum = __rte_raw_cksum_reduce(
+			vhost_phdr_sum(l3_hdr, m->ol_flags, 0));
+		return;
+	default:
+		break;
+	}
+
+	if (l4_flag != 0) {
+		m->ol_flags |= l4_flag;
+		return;
+	}
+
+sw_cksum:
+	if (hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM)
+		vhost_sw_cksum_partial(m, hdr->csum_start, hdr->csum_offset);
+}
+
 /**
  * This function adds buffers to the virtio devices RX virtqueue. Buffers can
  * be received from the physical port or from another virtio device. A packet
@@ -67,8 +474,10 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 	struct virtio_net_hdr_mrg_rxbuf virtio_hdr = {{0, 0, 0, 0, 0, 0}, 0};
 	uint64_t buff_addr = 0;
 	uint64_t buff_hdr_addr = 0;
+	uint64_t buff_hdr_gpa;
 	uint32_t head[MAX_PKT_BURST];
 	uint32_t head_idx, packet_success = 0;
+	struct vhost_log_cache log_cache;
 	uint16_t avail_idx, res_cur_idx;
 	uint16_t res_base_idx, res_end_idx;
 	uint16_t free_entries;
@@ -113,6 +522,7 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 	res_cur_idx = res_base_idx;
 	LOG_DEBUG(VHOST_DATA, "(%"PRIu64") Current Index %d| End Index %d\n",
 			dev->device_fh, res_cur_idx, res_end_idx);
+	log_cache.nr = 0;
 
 	/* Prefetch available ring to retrieve indexes. */
 	rte_prefetch0(&vq->avail->ring[res_cur_idx & (vq->size - 1)]);
@@ -124,6 +534,7 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 
 	/*Prefetch descriptor index. */
 	rte_prefetch0(&vq->desc[head[packet_success]]);
+	rte_prefetch0(&vq->used->ring[res_cur_idx & (vq->size - 1)]);
 
 	while (res_cur_idx != res_end_idx) {
 		uint32_t offset = 0, vb_offset = 0;
@@ -135,13 +546,18 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 
 		buff = pkts[packet_success];
 
+		memset(&virtio_hdr.hdr, 0, sizeof(virtio_hdr.hdr));
+		if (unlikely(buff->ol_flags & VHOST_TX_OFFLOAD_FLAGS))
+			virtio_enqueue_offload(dev, buff, &virtio_hdr.hdr);
+
 		/* Convert from gpa to vva (guest physical addr -> vhost virtual addr) */
-		buff_addr = gpa_to_vva(dev, desc->addr);
+		buff_addr = vq_gpa_to_vva(dev, vq, desc->addr);
 		/* Prefetch buffer address. */
 		rte_prefetch0((void *)(uintptr_t)buff_addr);
 
 		/* Copy virtio_hdr to packet and increment buffer address */
 		buff_hdr_addr = buff_addr;
+		buff_hdr_gpa = desc->addr;
 
 		/*
 		 * If the descriptors are chained the header and data are
@@ -151,7 +567,7 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 			(desc->len == vq->vhost_hlen)) {
 			desc = &vq->desc[desc->next];
 			/* Buffer address translation. */
-			buff_addr = gpa_to_vva(dev, desc->addr);
+			buff_addr = vq_gpa_to_vva(dev, vq, desc->addr);
 		} else {
 			vb_offset += vq->vhost_hlen;
 			hdr = 1;
@@ -166,6 +582,8 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 			rte_memcpy((void *)(uintptr_t)(buff_addr + vb_offset),
 				rte_pktmbuf_mtod_offset(buff, const void *, offset),
 				len_to_cpy);
+			vhost_log_write(dev, &log_cache, desc->addr + vb_offset,
+				len_to_cpy);
 			PRINT_PACKET(dev, (uintptr_t)(buff_addr + vb_offset),
 				len_to_cpy, 0);
 
@@ -188,7 +606,7 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 			if (vb_offset == desc->len) {
 				if (desc->flags & VRING_DESC_F_NEXT) {
 					desc = &vq->desc[desc->next];
-					buff_addr = gpa_to_vva(dev, desc->addr);
+					buff_addr = vq_gpa_to_vva(dev, vq, desc->addr);
 					vb_offset = 0;
 				} else {
 					/* Room in vring buffer is not enough */
@@ -219,12 +637,15 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 
 		rte_memcpy((void *)(uintptr_t)buff_hdr_addr,
 			(const void *)&virtio_hdr, vq->vhost_hlen);
+		vhost_log_write(dev, &log_cache, buff_hdr_gpa, vq->vhost_hlen);
 
 		PRINT_PACKET(dev, (uintptr_t)buff_hdr_addr, vq->vhost_hlen, 1);
 
 		if (res_cur_idx < res_end_idx) {
-			/* Prefetch descriptor index. */
+			/* Prefetch descriptor index and next packet data. */
 			rte_prefetch0(&vq->desc[head[packet_success]]);
+			rte_prefetch0(rte_pktmbuf_mtod(pkts[packet_success],
+				void *));
 		}
 	}
 
@@ -237,6 +658,9 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 	*(volatile uint16_t *)&vq->used->idx += count;
 	vq->last_used_idx = res_end_idx;
 
+	vhost_log_used_entries(dev, vq, &log_cache, res_base_idx, count);
+	vhost_log_cache_sync(dev, &log_cache);
+
 	/* flush used->idx update before we read avail->flags. */
 	rte_mb();
 
@@ -249,9 +673,9 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 static inline uint32_t __attribute__((always_inline))
 copy_from_mbuf_to_vring(struct virtio_net *dev, uint32_t queue_id,
 			uint16_t res_base_idx, uint16_t res_end_idx,
-			struct rte_mbuf *pkt)
+			uint32_t vec_idx, struct rte_mbuf *pkt,
+			struct vhost_log_cache *log_cache)
 {
-	uint32_t vec_idx = 0;
 	uint32_t entry_success = 0;
 	struct vhost_virtqueue *vq;
 	/* The virtio_hdr is initialised to 0. */
@@ -279,19 +703,23 @@ copy_from_mbuf_to_vring(struct virtio_net *dev, uint32_t queue_id,
 	 */
 	vq = dev->virtqueue[queue_id];
 
-	vb_addr = gpa_to_vva(dev, vq->buf_vec[vec_idx].buf_addr);
+	vb_addr = vq_gpa_to_vva(dev, vq, vq->buf_vec[vec_idx].buf_addr);
 	vb_hdr_addr = vb_addr;
 
 	/* Prefetch buffer address. */
 	rte_prefetch0((void *)(uintptr_t)vb_addr);
 
 	virtio_hdr.num_buffers = res_end_idx - res_base_idx;
+	if (unlikely(pkt->ol_flags & VHOST_TX_OFFLOAD_FLAGS))
+		virtio_enqueue_offload(dev, pkt, &virtio_hdr.hdr);
 
 	LOG_DEBUG(VHOST_DATA, "(%"PRIu64") RX: Num merge buffers %d\n",
 		dev->device_fh, virtio_hdr.num_buffers);
 
 	rte_memcpy((void *)(uintptr_t)vb_hdr_addr,
 		(const void *)&virtio_hdr, vq->vhost_hlen);
+	vhost_log_write(dev, log_cache, vq->buf_vec[vec_idx].buf_addr,
+		vq->vhost_hlen);
 
 	PRINT_PACKET(dev, (uintptr_t)vb_hdr_addr, vq->vhost_hlen, 1);
 
@@ -319,7 +747,7 @@ copy_from_mbuf_to_vring(struct virtio_net *dev, uint32_t queue_id,
 		}
 
 		vec_idx++;
-		vb_addr = gpa_to_vva(dev, vq->buf_vec[vec_idx].buf_addr);
+		vb_addr = vq_gpa_to_vva(dev, vq, vq->buf_vec[vec_idx].buf_addr);
 
 		/* Prefetch buffer address. */
 		rte_prefetch0((void *)(uintptr_t)vb_addr);
@@ -334,6 +762,8 @@ copy_from_mbuf_to_vring(struct virtio_net *dev, uint32_t queue_id,
 		rte_memcpy((void *)(uintptr_t)(vb_addr + vb_offset),
 			rte_pktmbuf_mtod_offset(pkt, const void *, seg_offset),
 			cpy_len);
+		vhost_log_write(dev, log_cache,
+			vq->buf_vec[vec_idx].buf_addr + vb_offset, cpy_len);
 
 		PRINT_PACKET(dev,
 			(uintptr_t)(vb_addr + vb_offset),
@@ -364,7 +794,7 @@ copy_from_mbuf_to_vring(struct virtio_net *dev, uint32_t queue_id,
 			}
 
 			vec_idx++;
-			vb_addr = gpa_to_vva(dev,
+			vb_addr = vq_gpa_to_vva(dev, vq,
 				vq->buf_vec[vec_idx].buf_addr);
 			vb_offset = 0;
 			vb_avail = vq->buf_vec[vec_idx].buf_len;
@@ -407,7 +837,7 @@ copy_from_mbuf_to_vring(struct virtio_net *dev, uint32_t queue_id,
 
 					/* Get next buffer from buf_vec. */
 					vec_idx++;
-					vb_addr = gpa_to_vva(dev,
+					vb_addr = vq_gpa_to_vva(dev, vq,
 						vq->buf_vec[vec_idx].buf_addr);
 					vb_avail =
 						vq->buf_vec[vec_idx].buf_len;
@@ -435,7 +865,12 @@ copy_from_mbuf_to_vring(struct virtio_net *dev, uint32_t queue_id,
 	return entry_success;
 }
 
-static inline void __attribute__((always_inline))
+/*
+ * Append the buffers of the descriptor chain of avail ring entry id to
+ * buf_vec. Returns -1, leaving secure_len and vec_idx unchanged, if
+ * buf_vec has no room for the whole chain.
+ */
+static inline int __attribute__((always_inline))
 update_secure_len(struct vhost_virtqueue *vq, uint32_t id,
 	uint32_t *secure_len, uint32_t *vec_idx)
 {
@@ -446,6 +881,9 @@ update_secure_len(struct vhost_virtqueue *vq, uint32_t id,
 	uint32_t vec_id = *vec_idx;
 
 	do {
+		if (unlikely(vec_id >= BUF_VECTOR_MAX))
+			return -1;
+
 		next_desc = 0;
 		len += vq->desc[idx].len;
 		vq->buf_vec[vec_id].buf_addr = vq->desc[idx].addr;
@@ -461,10 +899,15 @@ update_secure_len(struct vhost_virtqueue *vq, uint32_t id,
 
 	*secure_len = len;
 	*vec_idx = vec_id;
+	return 0;
 }
 
 /*
  * This function works for mergeable RX.
+ *
+ * The avail ring entries of the whole burst are reserved at once, their
+ * buffers being laid out one packet after the other in buf_vec. The used
+ * ring index is then updated, and the guest notified, once per burst.
  */
 static inline uint32_t __attribute__((always_inline))
 virtio_dev_merge_rx(struct virtio_net *dev, uint16_t queue_id,
@@ -472,9 +915,13 @@ virtio_dev_merge_rx(struct virtio_net *dev, uint16_t queue_id,
 {
 	struct vhost_virtqueue *vq;
 	uint32_t pkt_idx = 0, entry_success = 0;
+	uint16_t pkt_base_idx[MAX_PKT_BURST + 1];
+	uint32_t pkt_vec_idx[MAX_PKT_BURST];
+	uint32_t vec_idx;
 	uint16_t avail_idx;
 	uint16_t res_base_idx, res_cur_idx;
 	uint8_t success = 0;
+	struct vhost_log_cache log_cache;
 
 	LOG_DEBUG(VHOST_DATA, "(%"PRIu64") virtio_dev_merge_rx()\n",
 		dev->device_fh);
@@ -494,90 +941,315 @@ virtio_dev_merge_rx(struct virtio_net *dev, uint16_t queue_id,
 	if (count == 0)
 		return 0;
 
-	for (pkt_idx = 0; pkt_idx < count; pkt_idx++) {
-		uint32_t pkt_len = pkts[pkt_idx]->pkt_len + vq->vhost_hlen;
+	/* Prefetch available ring to retrieve indexes. */
+	rte_prefetch0(&vq->avail->ring[vq->last_used_idx_res & (vq->size - 1)]);
 
-		do {
-			/*
-			 * As many data cores may want access to available
-			 * buffers, they need to be reserved.
-			 */
-			uint32_t secure_len = 0;
-			uint32_t vec_idx = 0;
+	/*
+	 * As many data cores may want access to available buffers,
+	 * they need to be reserved.
+	 */
+	do {
+		res_base_idx = vq->last_used_idx_res;
+		res_cur_idx = res_base_idx;
+		avail_idx = *((volatile uint16_t *)&vq->avail->idx);
+		vec_idx = 0;
 
-			res_base_idx = vq->last_used_idx_res;
-			res_cur_idx = res_base_idx;
+		for (pkt_idx = 0; pkt_idx < count; pkt_idx++) {
+			uint32_t pkt_len = pkts[pkt_idx]->pkt_len +
+				vq->vhost_hlen;
+			uint32_t secure_len = 0;
+			uint16_t cur_idx = res_cur_idx;
+			uint32_t cur_vec_idx = vec_idx;
 
 			do {
-				avail_idx = *((volatile uint16_t *)&vq->avail->idx);
-				if (unlikely(res_cur_idx == avail_idx))
-					goto merge_rx_exit;
-
-				update_secure_len(vq, res_cur_idx,
-						  &secure_len, &vec_idx);
-				res_cur_idx++;
+				if (unlikely(cur_idx == avail_idx) ||
+						update_secure_len(vq, cur_idx,
+						&secure_len, &cur_vec_idx) < 0)
+					break;
+				cur_idx++;
 			} while (pkt_len > secure_len);
 
-			/* vq->last_used_idx_res is atomically updated. */
-			success = rte_atomic16_cmpset(&vq->last_used_idx_res,
-							res_base_idx,
-							res_cur_idx);
-		} while (success == 0);
+			/* Not enough room left for this packet. */
+			if (pkt_len > secure_len)
+				break;
 
-		entry_success = copy_from_mbuf_to_vring(dev, queue_id,
-			res_base_idx, res_cur_idx, pkts[pkt_idx]);
+			pkt_base_idx[pkt_idx] = res_cur_idx;
+			pkt_vec_idx[pkt_idx] = vec_idx;
+			res_cur_idx = cur_idx;
+			vec_idx = cur_vec_idx;
+		}
 
-		rte_compiler_barrier();
+		if (pkt_idx == 0)
+			return 0;
 
-		/*
-		 * Wait until it's our turn to add our buffer
-		 * to the used ring.
-		 */
-		while (unlikely(vq->last_used_idx != res_base_idx))
-			rte_pause();
+		/* vq->last_used_idx_res is atomically updated. */
+		success = rte_atomic16_cmpset(&vq->last_used_idx_res,
+						res_base_idx, res_cur_idx);
+	} while (unlikely(success == 0));
+	pkt_base_idx[pkt_idx] = res_cur_idx;
+	count = pkt_idx;
+	log_cache.nr = 0;
 
-		*(volatile uint16_t *)&vq->used->idx += entry_success;
-		vq->last_used_idx = res_cur_idx;
+	for (pkt_idx = 0; pkt_idx < count; pkt_idx++) {
+		if (pkt_idx + 1 < count)
+			rte_prefetch0(rte_pktmbuf_mtod(pkts[pkt_idx + 1],
+				void *));
+
+		entry_success += copy_from_mbuf_to_vring(dev, queue_id,
+			pkt_base_idx[pkt_idx], pkt_base_idx[pkt_idx + 1],
+			pkt_vec_idx[pkt_idx], pkts[pkt_idx], &log_cache);
 	}
 
-merge_rx_exit:
-	if (likely(pkt_idx)) {
-		/* flush used->idx update before we read avail->flags. */
-		rte_mb();
+	rte_compiler_barrier();
 
-		/* Kick the guest if necessary. */
-		if (!(vq->avail->flags & VRING_AVAIL_F_NO_INTERRUPT))
-			eventfd_write(vq->callfd, (eventfd_t)1);
-	}
+	/*
+	 * Wait until it's our turn to add our buffers
+	 * to the used ring.
+	 */
+	while (unlikely(vq->last_used_idx != res_base_idx))
+		rte_pause();
 
-	return pkt_idx;
+	*(volatile uint16_t *)&vq->used->idx += entry_success;
+	vq->last_used_idx = res_cur_idx;
+
+	vhost_log_used_entries(dev, vq, &log_cache, res_base_idx,
+		entry_success);
+	vhost_log_cache_sync(dev, &log_cache);
+
+	/* flush used->idx update before we read avail->flags. */
+	rte_mb();
+
+	/* Kick the guest if necessary. */
+	if (!(vq->avail->flags & VRING_AVAIL_F_NO_INTERRUPT))
+		eventfd_write(vq->callfd, (eventfd_t)1);
+
+	return count;
 }
 
-uint16_t
-rte_vhost_enqueue_burst(struct virtio_net *dev, uint16_t queue_id,
-	struct rte_mbuf **pkts, uint16_t count)
+/*
+ * A descriptor chain of a packed virtqueue given back to the guest: the
+ * used descriptor is written at the position of the head of the chain.
+ */
+struct vhost_packed_used {
+	uint16_t id;		/**< Buffer id, the one of the last descriptor. */
+	uint16_t count;		/**< Number of descriptors of the chain. */
+	uint32_t len;		/**< Bytes written to the chain. */
+	uint16_t idx;		/**< Ring position of the head of the chain. */
+	uint16_t wrap;		/**< Wrap counter at that position. */
+};
+
+static inline int __attribute__((always_inline))
+desc_is_avail(struct vring_packed_desc *desc, uint16_t wrap)
 {
-	if (unlikely(dev->features & (1 << VIRTIO_NET_F_MRG_RXBUF)))
-		return virtio_dev_merge_rx(dev, queue_id, pkts, count);
-	else
-		return virtio_dev_rx(dev, queue_id, pkts, count);
+	uint16_t flags = *(volatile uint16_t *)&desc->flags;
+
+	return !!(flags & VRING_DESC_F_AVAIL) == wrap &&
+		!!(flags & VRING_DESC_F_USED) != wrap;
 }
 
-uint16_t
-rte_vhost_dequeue_burst(struct virtio_net *dev, uint16_t queue_id,
-	struct rte_mempool *mbuf_pool, struct rte_mbuf **pkts, uint16_t count)
+/*
+ * Append to buf_vec the buffers of the descriptor chain available at ring
+ * position *idx of a packed virtqueue, and record the chain in used for
+ * it to be given back. The desc_idx of the buf_vec entries is the index
+ * of the chain in the used array. Returns -1, leaving *idx, *wrap and
+ * *vec_idx unchanged, if no chain is available or buf_vec has no room
+ * for the whole chain.
+ */
+static inline int __attribute__((always_inline))
+fill_vec_packed(struct vhost_virtqueue *vq, uint16_t *idx, uint16_t *wrap,
+	uint32_t *vec_idx, uint32_t *len, struct vhost_packed_used *used,
+	uint32_t used_idx)
 {
-	struct rte_mbuf *m, *prev;
-	struct vhost_virtqueue *vq;
-	struct vring_desc *desc;
-	uint64_t vb_addr = 0;
-	uint32_t head[MAX_PKT_BURST];
-	uint32_t used_idx;
+	struct vring_packed_desc *desc = &vq->desc_packed[*idx];
+	uint16_t cur_idx = *idx, cur_wrap = *wrap;
+	uint32_t vec_id = *vec_idx;
+	uint16_t count = 0;
+	uint32_t chain_len = 0;
+
+	if (!desc_is_avail(desc, cur_wrap))
+		return -1;
+	/* The chain is read once its head is seen available. */
+	rte_smp_rmb();
+
+	do {
+		desc = &vq->desc_packed[cur_idx];
+		if (unlikely(vec_id >= BUF_VECTOR_MAX || count == vq->size))
+			return -1;
+
+		vq->buf_vec[vec_id].buf_addr = desc->addr;
+		vq->buf_vec[vec_id].buf_len = desc->len;
+		vq->buf_vec[vec_id].desc_idx = used_idx;
+		chain_len += desc->len;
+		vec_id++;
+		count++;
+
+		if (++cur_idx == vq->size) {
+			cur_idx = 0;
+			cur_wrap ^= 1;
+		}
+	} while (desc->flags & VRING_DESC_F_NEXT);
+
+	used[used_idx].id = desc->id;
+	used[used_idx].count = count;
+	used[used_idx].len = 0;
+	used[used_idx].idx = *idx;
+	used[used_idx].wrap = *wrap;
+
+	*idx = cur_idx;
+	*wrap = cur_wrap;
+	*vec_idx = vec_id;
+	*len += chain_len;
+	return 0;
+}
+
+/*
+ * Copy the virtio-net header and a packet to the buffers vec_idx to
+ * vec_end - 1 of buf_vec, adding the bytes written in each chain to its
+ * used entry. Returns -1 if the buffers are too short.
+ */
+static inline int __attribute__((always_inline))
+copy_mbuf_to_vec_packed(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	struct rte_mbuf *m, const struct virtio_net_hdr_mrg_rxbuf *virtio_hdr,
+	uint32_t vec_idx, uint32_t vec_end, struct vhost_packed_used *used,
+	struct vhost_log_cache *log_cache)
+{
+	const uint8_t *hdr = (const uint8_t *)virtio_hdr;
+	uint32_t hdr_left = vq->vhost_hlen;
+	uint32_t seg_avail = rte_pktmbuf_data_len(m), seg_offset = 0;
+	uint32_t vb_avail = 0, vb_offset = 0, cpy_len;
+	uint64_t vb_addr = 0, vb_gpa = 0;
+	struct vhost_packed_used *chain = NULL;
+
+	while (hdr_left != 0 || m != NULL) {
+		if (hdr_left == 0 && seg_avail == 0) {
+			m = m->next;
+			if (m != NULL) {
+				seg_avail = rte_pktmbuf_data_len(m);
+				seg_offset = 0;
+			}
+			continue;
+		}
+
+		if (vb_avail == 0) {
+			if (unlikely(vec_idx == vec_end))
+				return -1;
+			vb_gpa = vq->buf_vec[vec_idx].buf_addr;
+			vb_addr = vq_gpa_to_vva(dev, vq, vb_gpa);
+			rte_prefetch0((void *)(uintptr_t)vb_addr);
+			vb_avail = vq->buf_vec[vec_idx].buf_len;
+			vb_offset = 0;
+			chain = &used[vq->buf_vec[vec_idx].desc_idx];
+			vec_idx++;
+			continue;
+		}
+
+		if (hdr_left != 0) {
+			cpy_len = RTE_MIN(hdr_left, vb_avail);
+			rte_memcpy((void *)(uintptr_t)(vb_addr + vb_offset),
+				hdr, cpy_len);
+			PRINT_PACKET(dev, (uintptr_t)(vb_addr + vb_offset),
+				cpy_len, 1);
+			hdr += cpy_len;
+			hdr_left -= cpy_len;
+		} else {
+			cpy_len = RTE_MIN(seg_avail, vb_avail);
+			rte_memcpy((void *)(uintptr_t)(vb_addr + vb_offset),
+				rte_pktmbuf_mtod_offset(m, const void *,
+					seg_offset),
+				cpy_len);
+			PRINT_PACKET(dev, (uintptr_t)(vb_addr + vb_offset),
+				cpy_len, 0);
+			seg_offset += cpy_len;
+			seg_avail -= cpy_len;
+		}
+		vhost_log_write(dev, log_cache, vb_gpa + vb_offset, cpy_len);
+		vb_offset += cpy_len;
+		vb_avail -= cpy_len;
+		chain->len += cpy_len;
+	}
+
+	return 0;
+}
+
+/*
+ * Give back nr_used chains to the guest. The ids and lengths of all the
+ * used descriptors are written first, then their flags, the flags of the
+ * first one last: the guest, which reads the used descriptors in order,
+ * sees the whole batch at once and the descriptors sharing a cache line
+ * are written together.
+ */
+static inline void __attribute__((always_inline))
+flush_used_packed(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	struct vhost_packed_used *used, uint32_t nr_used,
+	struct vhost_log_cache *log_cache)
+{
+	struct vring_packed_desc *desc;
 	uint32_t i;
-	uint16_t free_entries, entry_success = 0;
-	uint16_t avail_idx;
 
-	if (unlikely(!is_valid_virt_queue_idx(queue_id, 1, dev->virt_qp_nb))) {
+	if (nr_used == 0)
+		return;
+
+	for (i = 0; i < nr_used; i++) {
+		desc = &vq->desc_packed[used[i].idx];
+		desc->id = used[i].id;
+		desc->len = used[i].len;
+	}
+
+	rte_smp_wmb();
+
+	for (i = 1; i < nr_used; i++)
+		vq->desc_packed[used[i].idx].flags = used[i].wrap ?
+			VRING_DESC_F_AVAIL | VRING_DESC_F_USED : 0;
+
+	rte_smp_wmb();
+
+	vq->desc_packed[used[0].idx].flags = used[0].wrap ?
+		VRING_DESC_F_AVAIL | VRING_DESC_F_USED : 0;
+
+	for (i = 0; i < nr_used; i++)
+		vhost_log_write(dev, log_cache, vq->log_desc_addr +
+			used[i].idx * sizeof(struct vring_packed_desc),
+			sizeof(struct vring_packed_desc));
+	vhost_log_cache_sync(dev, log_cache);
+}
+
+/* Kick the guest, unless it disabled the notifications. */
+static inline void __attribute__((always_inline))
+vhost_kick_packed(struct vhost_virtqueue *vq)
+{
+	/* flush the used descriptors before we read the driver event flags */
+	rte_mb();
+
+	if (vq->driver_event->flags != VRING_EVENT_F_DISABLE &&
+			vq->callfd >= 0)
+		eventfd_write(vq->callfd, (eventfd_t)1);
+}
+
+/*
+ * This function adds buffers to the RX virtqueue of a guest which
+ * negotiated the packed virtqueue layout, with or without mergeable RX
+ * buffers. The descriptors are used in the order they were made available,
+ * so the used descriptors are written in place of the available ones and
+ * last_used_idx is both the next available and next used position.
+ * Concurrent enqueues are serialized by a lock instead of the index
+ * reservation of the split virtqueue.
+ */
+static inline uint32_t __attribute__((always_inline))
+virtio_dev_rx_packed(struct virtio_net *dev, uint16_t queue_id,
+	struct rte_mbuf **pkts, uint32_t count)
+{
+	struct vhost_virtqueue *vq;
+	struct vhost_packed_used used[BUF_VECTOR_MAX];
+	struct virtio_net_hdr_mrg_rxbuf virtio_hdr;
+	uint32_t pkt_idx, nr_used = 0, vec_idx, pkt_len, secure_len;
+	uint32_t pkt_used;
+	uint16_t idx, wrap;
+	int mergeable;
+	struct vhost_log_cache log_cache;
+
+	LOG_DEBUG(VHOST_DATA, "(%"PRIu64") virtio_dev_rx_packed()\n",
+		dev->device_fh);
+	if (unlikely(!is_valid_virt_queue_idx(queue_id, 0, dev->virt_qp_nb))) {
 		RTE_LOG(ERR, VHOST_DATA,
 			"%s (%"PRIu64"): virtqueue idx:%d invalid.\n",
 			__func__, dev->device_fh, queue_id);
@@ -588,15 +1260,1086 @@ rte_vhost_dequeue_burst(struct virtio_net *dev, uint16_t queue_id,
 	if (unlikely(vq->enabled == 0))
 		return 0;
 
-	avail_idx =  *((volatile uint16_t *)&vq->avail->idx);
+	count = RTE_MIN((uint32_t)MAX_PKT_BURST, count);
+	if (count == 0)
+		return 0;
 
-	/* If there are no available buffers then return. */
-	if (vq->last_used_idx == avail_idx)
+	mergeable = !!(dev->features & (1 << VIRTIO_NET_F_MRG_RXBUF));
+
+	rte_spinlock_lock(&vq->packed_lock);
+
+	log_cache.nr = 0;
+	idx = vq->last_used_idx;
+	wrap = vq->used_wrap_counter;
+	rte_prefetch0(&vq->desc_packed[idx]);
+
+	for (pkt_idx = 0; pkt_idx < count; pkt_idx++) {
+		pkt_len = pkts[pkt_idx]->pkt_len + vq->vhost_hlen;
+		pkt_used = nr_used;
+		secure_len = 0;
+		vec_idx = 0;
+
+		/*
+		 * A single chain without mergeable RX buffers, a packet too
+		 * long for it being dropped as with the split virtqueue.
+		 */
+		do {
+			if (nr_used == BUF_VECTOR_MAX ||
+					fill_vec_packed(vq, &idx, &wrap,
+					&vec_idx, &secure_len, used,
+					nr_used) < 0)
+				break;
+			nr_used++;
+		} while (mergeable && pkt_len > secure_len);
+
+		if (nr_used == pkt_used)
+			break;
+		if (mergeable && pkt_len > secure_len) {
+			/* Not enough room left for this packet. */
+			idx = used[pkt_used].idx;
+			wrap = used[pkt_used].wrap;
+			nr_used = pkt_used;
+			break;
+		}
+
+		if (pkt_idx + 1 < count)
+			rte_prefetch0(rte_pktmbuf_mtod(pkts[pkt_idx + 1],
+				void *));
+
+		memset(&virtio_hdr, 0, sizeof(virtio_hdr));
+		virtio_hdr.num_buffers = nr_used - pkt_used;
+		if (unlikely(pkts[pkt_idx]->ol_flags & VHOST_TX_OFFLOAD_FLAGS))
+			virtio_enqueue_offload(dev, pkts[pkt_idx],
+				&virtio_hdr.hdr);
+
+		/* The common case of a packet fitting in a single buffer */
+		if (vec_idx == 1 && pkts[pkt_idx]->nb_segs == 1 &&
+				vq->buf_vec[0].buf_len >= pkt_len) {
+			uint64_t vb_addr = vq_gpa_to_vva(dev, vq,
+				vq->buf_vec[0].buf_addr);
+
+			rte_memcpy((void *)(uintptr_t)vb_addr, &virtio_hdr,
+				vq->vhost_hlen);
+			rte_memcpy((void *)(uintptr_t)(vb_addr +
+					vq->vhost_hlen),
+				rte_pktmbuf_mtod(pkts[pkt_idx], const void *),
+				pkt_len - vq->vhost_hlen);
+			PRINT_PACKET(dev, (uintptr_t)vb_addr, pkt_len, 0);
+			vhost_log_write(dev, &log_cache,
+				vq->buf_vec[0].buf_addr, pkt_len);
+			used[pkt_used].len = pkt_len;
+		} else if (unlikely(copy_mbuf_to_vec_packed(dev, vq,
+				pkts[pkt_idx], &virtio_hdr, 0, vec_idx,
+				used, &log_cache) < 0)) {
+			/* Drop the packet if it is uncompleted */
+			used[pkt_used].len = vq->vhost_hlen;
+		}
+	}
+
+	flush_used_packed(dev, vq, used, nr_used, &log_cache);
+	vq->last_used_idx = idx;
+	vq->last_used_idx_res = idx;
+	vq->used_wrap_counter = wrap;
+
+	rte_spinlock_unlock(&vq->packed_lock);
+
+	if (nr_used != 0)
+		vhost_kick_packed(vq);
+
+	return pkt_idx;
+}
+
+static inline uint16_t __attribute__((always_inline))
+virtio_dev_enqueue(struct virtio_net *dev, uint16_t queue_id,
+	struct rte_mbuf **pkts, uint16_t count)
+{
+	if (dev->features & (1ULL << VIRTIO_F_RING_PACKED))
+		return virtio_dev_rx_packed(dev, queue_id, pkts, count);
+	else if (unlikely(dev->features & (1 << VIRTIO_NET_F_MRG_RXBUF)))
+		return virtio_dev_merge_rx(dev, queue_id, pkts, count);
+	else
+		return virtio_dev_rx(dev, queue_id, pkts, count);
+}
+
+/*
+ * The TSO packets are dropped, without taking guest buffers, when the
+ * guest did not negotiate TSO for their IP version: they would exceed its
+ * MTU. They are reported enqueued, for the caller to free them, and counted
+ * in the tso_dropped counter of the virtqueue.
+ */
+uint16_t
+rte_vhost_enqueue_burst(struct virtio_net *dev, uint16_t queue_id,
+	struct rte_mbuf **pkts, uint16_t count)
+{
+	struct vhost_virtqueue *vq;
+	uint16_t i, first = 0, nb_enq;
+
+	for (i = 0; i < count; i++) {
+		if (likely(!vhost_tso_unsupported(dev, pkts[i])))
+			continue;
+
+		if (i != first) {
+			nb_enq = virtio_dev_enqueue(dev, queue_id,
+				pkts + first, i - first);
+			if (nb_enq != i - first)
+				return first + nb_enq;
+		}
+		if (unlikely(!is_valid_virt_queue_idx(queue_id, 0,
+				dev->virt_qp_nb)))
+			return first;
+		vq = dev->virtqueue[queue_id];
+		if (unlikely(vq->enabled == 0))
+			return first;
+		rte_atomic64_inc(&vq->tso_dropped);
+		first = i + 1;
+	}
+
+	if (first == count)
+		return count;
+	return first + virtio_dev_enqueue(dev, queue_id, pkts + first,
+		count - first);
+}
+
+/* Packets shorter than this are copied at submission, not by the engine. */
+#define VHOST_ASYNC_COPY_THRESHOLD 256
+/* Room for the copies in flight, per descriptor of the virtqueue. */
+#define VHOST_ASYNC_COPIES_PER_DESC 4
+/* Longest wait for the engine to complete the packets of a stopped device. */
+#define VHOST_ASYNC_DRAIN_TIMEOUT_MS 1000
+
+/* A guest buffer written for a packet, logged once the packet completes. */
+struct vhost_async_range {
+	uint64_t addr;
+	uint32_t len;
+};
+
+/* A packet in flight in the asynchronous enqueue. */
+struct vhost_async_pkt {
+	struct rte_mbuf *mbuf;
+	struct rte_vhost_async_job job;	/* No copies if done by vhost. */
+	uint32_t copy_end;		/* copy_head after its copies. */
+	uint32_t range_start;		/* First of its guest buffers. */
+	uint16_t nr_ranges;		/* Guest buffers of the packet. */
+	uint16_t nr_used;		/* Used ring entries of the packet. */
+};
+
+struct vhost_async {
+	const struct rte_vhost_async_ops *ops;
+	void *chan;
+	/* Packets in flight, in submission order, from pkt_tail to pkt_head. */
+	struct vhost_async_pkt *pkts;
+	uint16_t pkt_head;
+	uint16_t pkt_tail;
+	/* Jobs completed by the engine, whose packets are not yet completed. */
+	uint16_t nr_done;
+	/* Copies of the jobs in flight, from copy_tail to copy_head. */
+	struct rte_vhost_async_copy *copies;
+	uint32_t nr_copies;
+	uint32_t copy_head;
+	uint32_t copy_tail;
+	/*
+	 * Guest buffers of the packets in flight, from range_tail to
+	 * range_head, recorded at submission: the descriptors are guest
+	 * memory, which the guest may change until completion.
+	 */
+	struct vhost_async_range *ranges;
+	uint32_t nr_ranges;
+	uint32_t range_head;
+	uint32_t range_tail;
+};
+
+/*
+ * Start of n contiguous entries, from head, of a ring of size entries and
+ * used from tail. Returns -1 if the ring has no room for them.
+ */
+static inline int __attribute__((always_inline))
+vhost_async_reserve(uint32_t head, uint32_t tail, uint32_t size, uint32_t n,
+	uint32_t *start)
+{
+	if ((head & (size - 1)) + n > size)
+		head += size - (head & (size - 1));
+	if (head + n - tail > size)
+		return -1;
+	*start = head;
+	return 0;
+}
+
+int
+rte_vhost_async_register(struct virtio_net *dev, uint16_t queue_id,
+	const struct rte_vhost_async_ops *ops, void *chan)
+{
+	struct vhost_virtqueue *vq;
+	struct vhost_async *async;
+	uint32_t nr_copies, nr_ranges;
+
+	if (!is_valid_virt_queue_idx(queue_id, 0, dev->virt_qp_nb) ||
+			ops == NULL || ops->submit == NULL ||
+			ops->poll == NULL) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%"PRIu64") invalid copy engine for virtqueue %u\n",
+			dev->device_fh, queue_id);
+		return -1;
+	}
+
+	if (dev->features & (1ULL << VIRTIO_F_RING_PACKED)) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%"PRIu64") no asynchronous enqueue to packed "
+			"virtqueues\n", dev->device_fh);
+		return -1;
+	}
+
+	vq = dev->virtqueue[queue_id];
+	if (vq->async != NULL || !rte_is_power_of_2(vq->size)) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%"PRIu64") cannot register a copy engine for "
+			"virtqueue %u\n", dev->device_fh, queue_id);
+		return -1;
+	}
+
+	nr_copies = vq->size * VHOST_ASYNC_COPIES_PER_DESC;
+	/* Room for two packets with the longest descriptor chains at least. */
+	nr_ranges = RTE_MAX(nr_copies, 2U * BUF_VECTOR_MAX);
+	async = rte_zmalloc_socket(NULL, sizeof(*async) +
+		vq->size * sizeof(*async->pkts) +
+		nr_copies * sizeof(*async->copies) +
+		nr_ranges * sizeof(*async->ranges), RTE_CACHE_LINE_SIZE,
+		vq->numa_node >= 0 ? vq->numa_node : SOCKET_ID_ANY);
+	if (async == NULL) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%"PRIu64") failed to allocate the asynchronous "
+			"enqueue of virtqueue %u\n", dev->device_fh, queue_id);
+		return -1;
+	}
+
+	async->ops = ops;
+	async->chan = chan;
+	async->pkts = (struct vhost_async_pkt *)(async + 1);
+	async->copies = (struct rte_vhost_async_copy *)
+		(async->pkts + vq->size);
+	async->nr_copies = nr_copies;
+	async->ranges = (struct vhost_async_range *)
+		(async->copies + nr_copies);
+	async->nr_ranges = nr_ranges;
+	vq->async = async;
+
+	return 0;
+}
+
+int
+rte_vhost_async_unregister(struct virtio_net *dev, uint16_t queue_id)
+{
+	struct vhost_virtqueue *vq;
+
+	if (!is_valid_virt_queue_idx(queue_id, 0, dev->virt_qp_nb))
+		return -1;
+
+	vq = dev->virtqueue[queue_id];
+	if (vq->async == NULL)
+		return 0;
+
+	if (vq->async->pkt_head != vq->async->pkt_tail) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%"PRIu64") packets in flight in virtqueue %u\n",
+			dev->device_fh, queue_id);
+		return -1;
+	}
+
+	rte_free(vq->async);
+	vq->async = NULL;
+
+	return 0;
+}
+
+/*
+ * Write the header of a packet to its guest buffers, the nr_chains
+ * descriptor chains at the start of buf_vec, and their used ring entries
+ * from used_idx. The packet data is copied right away if copies is NULL,
+ * else the copies are stored in copies. The guest buffers written are
+ * stored in ranges, their number in nr_ranges. Returns the number of
+ * copies.
+ */
+static inline uint16_t __attribute__((always_inline))
+vhost_async_fill(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	struct rte_mbuf *m, uint16_t used_idx, uint16_t nr_chains,
+	struct rte_vhost_async_copy *copies,
+	struct vhost_async_range *ranges, uint16_t *nr_ranges)
+{
+	struct virtio_net_hdr_mrg_rxbuf virtio_hdr = {
+		{0, 0, 0, 0, 0, 0}, 0};
+	struct vring_used_elem *elem;
+	uint32_t vec_idx = 0, head_vec_idx = 0;
+	uint32_t vb_offset, vb_avail, chain_len;
+	uint32_t seg_offset = 0, seg_avail, cpy_len;
+	uint64_t vb_addr;
+	uint16_t nr_copies = 0;
+
+	virtio_hdr.num_buffers = nr_chains;
+	if (unlikely(m->ol_flags & VHOST_TX_OFFLOAD_FLAGS))
+		virtio_enqueue_offload(dev, m, &virtio_hdr.hdr);
+
+	vb_addr = vq_gpa_to_vva(dev, vq, vq->buf_vec[0].buf_addr);
+	rte_memcpy((void *)(uintptr_t)vb_addr, (const void *)&virtio_hdr,
+		vq->vhost_hlen);
+
+	vb_offset = vq->vhost_hlen;
+	vb_avail = vq->buf_vec[0].buf_len - vq->vhost_hlen;
+	chain_len = vq->vhost_hlen;
+	seg_avail = rte_pktmbuf_data_len(m);
+
+	for (;;) {
+		if (seg_avail == 0) {
+			m = m->next;
+			if (m == NULL)
+				break;
+			seg_offset = 0;
+			seg_avail = rte_pktmbuf_data_len(m);
+			continue;
+		}
+
+		if (vb_avail == 0) {
+			/* The reservation left room for the whole packet. */
+			if (!(vq->desc[vq->buf_vec[vec_idx].desc_idx].flags &
+					VRING_DESC_F_NEXT)) {
+				elem = &vq->used->ring[used_idx++ &
+					(vq->size - 1)];
+				elem->id = vq->buf_vec[head_vec_idx].desc_idx;
+				elem->len = chain_len;
+				chain_len = 0;
+				head_vec_idx = vec_idx + 1;
+			}
+			ranges[vec_idx].addr = vq->buf_vec[vec_idx].buf_addr;
+			ranges[vec_idx].len = vb_offset;
+			vec_idx++;
+			vb_addr = vq_gpa_to_vva(dev, vq,
+				vq->buf_vec[vec_idx].buf_addr);
+			vb_offset = 0;
+			vb_avail = vq->buf_vec[vec_idx].buf_len;
+			continue;
+		}
+
+		cpy_len = RTE_MIN(vb_avail, seg_avail);
+		if (copies == NULL) {
+			rte_memcpy((void *)(uintptr_t)(vb_addr + vb_offset),
+				rte_pktmbuf_mtod_offset(m, const void *,
+					seg_offset), cpy_len);
+		} else {
+			copies[nr_copies].dst =
+				(void *)(uintptr_t)(vb_addr + vb_offset);
+			copies[nr_copies].src = rte_pktmbuf_mtod_offset(m,
+				const void *, seg_offset);
+			copies[nr_copies].len = cpy_len;
+			nr_copies++;
+		}
+
+		vb_offset += cpy_len;
+		vb_avail -= cpy_len;
+		seg_offset += cpy_len;
+		seg_avail -= cpy_len;
+		chain_len += cpy_len;
+	}
+
+	elem = &vq->used->ring[used_idx & (vq->size - 1)];
+	elem->id = vq->buf_vec[head_vec_idx].desc_idx;
+	elem->len = chain_len;
+
+	ranges[vec_idx].addr = vq->buf_vec[vec_idx].buf_addr;
+	ranges[vec_idx].len = vb_offset;
+	*nr_ranges = vec_idx + 1;
+
+	return nr_copies;
+}
+
+/*
+ * The buffers of the packets are reserved, and their used ring entries
+ * written, at submission. Only the used ring index is left for completion,
+ * which follows the submission order.
+ */
+uint16_t
+rte_vhost_submit_enqueue_burst(struct virtio_net *dev, uint16_t queue_id,
+	struct rte_mbuf **pkts, uint16_t count)
+{
+	struct rte_vhost_async_job *jobs[MAX_PKT_BURST];
+	struct vhost_virtqueue *vq;
+	struct vhost_async *async;
+	struct vhost_async_pkt *pkt;
+	struct rte_vhost_async_copy *copies;
+	struct vhost_async_range *ranges;
+	struct vring_used_elem *elem;
+	uint32_t pkt_idx, pkt_len, secure_len, vec_idx;
+	uint32_t copy_head, nr_copies, range_start, i;
+	uint64_t vb_addr;
+	uint16_t avail_idx, res_idx, cur_idx, nr_ranges;
+	uint16_t nb_jobs = 0, nb_submitted;
+	uint32_t mergeable;
+	int drop;
+
+	if (unlikely(!is_valid_virt_queue_idx(queue_id, 0, dev->virt_qp_nb))) {
+		RTE_LOG(ERR, VHOST_DATA,
+			"%s (%"PRIu64"): virtqueue idx:%d invalid.\n",
+			__func__, dev->device_fh, queue_id);
+		return 0;
+	}
+
+	vq = dev->virtqueue[queue_id];
+	async = vq->async;
+	if (unlikely(vq->enabled == 0 || async == NULL))
+		return 0;
+
+	count = RTE_MIN((uint16_t)MAX_PKT_BURST, count);
+	mergeable = dev->features & (1 << VIRTIO_NET_F_MRG_RXBUF);
+	avail_idx = *((volatile uint16_t *)&vq->avail->idx);
+	res_idx = vq->last_used_idx_res;
+
+	for (pkt_idx = 0; pkt_idx < count; pkt_idx++) {
+		pkt_len = pkts[pkt_idx]->pkt_len + vq->vhost_hlen;
+		secure_len = 0;
+		vec_idx = 0;
+		cur_idx = res_idx;
+		/* A single buffer is taken for a dropped TSO packet. */
+		drop = vhost_tso_unsupported(dev, pkts[pkt_idx]);
+
+		do {
+			if (unlikely(cur_idx == avail_idx) ||
+					update_secure_len(vq, cur_idx,
+					&secure_len, &vec_idx) < 0)
+				break;
+			cur_idx++;
+		} while (mergeable && !drop && pkt_len > secure_len);
+
+		if (cur_idx == res_idx ||
+				(mergeable && !drop && pkt_len > secure_len))
+			break;
+
+		if (vhost_async_reserve(async->range_head, async->range_tail,
+				async->nr_ranges, vec_idx, &range_start) < 0)
+			break;
+		ranges = &async->ranges[range_start &
+			(async->nr_ranges - 1)];
+
+		pkt = &async->pkts[async->pkt_head & (vq->size - 1)];
+		nr_copies = 0;
+
+		if (unlikely(drop || pkt_len > secure_len)) {
+			/*
+			 * Dropped, as too long by rte_vhost_enqueue_burst(),
+			 * with a zeroed header for the guest to see an empty
+			 * packet. The mbuf is still completed in order.
+			 */
+			if (drop)
+				rte_atomic64_inc(&vq->tso_dropped);
+			ranges[0].addr = vq->buf_vec[0].buf_addr;
+			ranges[0].len = RTE_MIN(vq->vhost_hlen,
+				vq->buf_vec[0].buf_len);
+			vb_addr = vq_gpa_to_vva(dev, vq, ranges[0].addr);
+			if (vb_addr != 0)
+				memset((void *)(uintptr_t)vb_addr, 0,
+					ranges[0].len);
+			nr_ranges = 1;
+			elem = &vq->used->ring[res_idx & (vq->size - 1)];
+			elem->id = vq->buf_vec[0].desc_idx;
+			elem->len = vq->vhost_hlen;
+		} else if (pkts[pkt_idx]->pkt_len <
+				VHOST_ASYNC_COPY_THRESHOLD ||
+				pkts[pkt_idx]->nb_segs + vec_idx >
+				async->nr_copies / 2) {
+			vhost_async_fill(dev, vq, pkts[pkt_idx], res_idx,
+				cur_idx - res_idx, NULL, ranges, &nr_ranges);
+		} else {
+			/* The copies of a job are contiguous. */
+			if (vhost_async_reserve(async->copy_head,
+					async->copy_tail, async->nr_copies,
+					pkts[pkt_idx]->nb_segs + vec_idx,
+					&copy_head) < 0)
+				break;
+
+			copies = &async->copies[copy_head &
+				(async->nr_copies - 1)];
+			nr_copies = vhost_async_fill(dev, vq, pkts[pkt_idx],
+				res_idx, cur_idx - res_idx, copies, ranges,
+				&nr_ranges);
+			if (nr_copies != 0) {
+				async->copy_head = copy_head + nr_copies;
+				pkt->job.copies = copies;
+				jobs[nb_jobs++] = &pkt->job;
+			}
+		}
+
+		pkt->mbuf = pkts[pkt_idx];
+		pkt->job.nb_copies = nr_copies;
+		pkt->nr_used = cur_idx - res_idx;
+		pkt->copy_end = async->copy_head;
+		pkt->range_start = range_start;
+		pkt->nr_ranges = nr_ranges;
+		async->range_head = range_start + nr_ranges;
+		async->pkt_head++;
+		res_idx = cur_idx;
+	}
+
+	vq->last_used_idx_res = res_idx;
+
+	if (nb_jobs != 0) {
+		nb_submitted = async->ops->submit(async->chan, jobs, nb_jobs);
+
+		/* The jobs the engine has no room for are done here. */
+		for (; nb_submitted < nb_jobs; nb_submitted++) {
+			copies = jobs[nb_submitted]->copies;
+			for (i = 0; i < jobs[nb_submitted]->nb_copies; i++)
+				rte_memcpy(copies[i].dst, copies[i].src,
+					copies[i].len);
+			jobs[nb_submitted]->nb_copies = 0;
+		}
+	}
+
+	return pkt_idx;
+}
+
+/* Log the guest buffers of a packet, as recorded at submission. */
+static void
+vhost_async_log(struct virtio_net *dev, const struct vhost_async *async,
+	const struct vhost_async_pkt *pkt, struct vhost_log_cache *log_cache)
+{
+	const struct vhost_async_range *range;
+	uint16_t i;
+
+	for (i = 0; i < pkt->nr_ranges; i++) {
+		range = &async->ranges[(pkt->range_start + i) &
+			(async->nr_ranges - 1)];
+		vhost_log_write(dev, log_cache, range->addr, range->len);
+	}
+}
+
+static uint16_t
+vhost_async_complete(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	struct rte_mbuf **pkts, uint16_t count)
+{
+	struct vhost_async *async = vq->async;
+	struct vhost_async_pkt *pkt;
+	struct vhost_log_cache log_cache;
+	uint16_t nb_pkts = 0, nr_used = 0;
+	int log = !!(dev->features & (1ULL << VHOST_F_LOG_ALL));
+
+	if (async->pkt_head == async->pkt_tail)
+		return 0;
+
+	async->nr_done += async->ops->poll(async->chan, vq->size);
+	log_cache.nr = 0;
+
+	while (nb_pkts < count && async->pkt_tail != async->pkt_head) {
+		pkt = &async->pkts[async->pkt_tail & (vq->size - 1)];
+		if (pkt->job.nb_copies != 0) {
+			if (async->nr_done == 0)
+				break;
+			async->nr_done--;
+		}
+
+		if (unlikely(log))
+			vhost_async_log(dev, async, pkt, &log_cache);
+		pkts[nb_pkts++] = pkt->mbuf;
+		nr_used += pkt->nr_used;
+		async->copy_tail = pkt->copy_end;
+		async->range_tail = pkt->range_start + pkt->nr_ranges;
+		async->pkt_tail++;
+	}
+
+	if (nb_pkts == 0)
+		return 0;
+
+	/* The guest sees the copies of the engine with the used ring index. */
+	rte_smp_wmb();
+	*(volatile uint16_t *)&vq->used->idx += nr_used;
+
+	if (unlikely(log)) {
+		vhost_log_used_entries(dev, vq, &log_cache, vq->last_used_idx,
+			nr_used);
+		vhost_log_cache_sync(dev, &log_cache);
+	}
+	vq->last_used_idx += nr_used;
+
+	/* flush used->idx update before we read avail->flags. */
+	rte_mb();
+
+	/* Kick the guest if necessary. */
+	if (!(vq->avail->flags & VRING_AVAIL_F_NO_INTERRUPT))
+		eventfd_write(vq->callfd, (eventfd_t)1);
+
+	return nb_pkts;
+}
+
+uint16_t
+rte_vhost_poll_enqueue_completed(struct virtio_net *dev, uint16_t queue_id,
+	struct rte_mbuf **pkts, uint16_t count)
+{
+	struct vhost_virtqueue *vq;
+
+	if (unlikely(!is_valid_virt_queue_idx(queue_id, 0, dev->virt_qp_nb))) {
+		RTE_LOG(ERR, VHOST_DATA,
+			"%s (%"PRIu64"): virtqueue idx:%d invalid.\n",
+			__func__, dev->device_fh, queue_id);
+		return 0;
+	}
+
+	vq = dev->virtqueue[queue_id];
+	if (unlikely(vq->async == NULL))
 		return 0;
 
+	return vhost_async_complete(dev, vq, pkts, count);
+}
+
+uint32_t
+vhost_async_drain(struct virtio_net *dev)
+{
+	struct rte_mbuf *pkts[MAX_PKT_BURST];
+	struct vhost_virtqueue *vq;
+	struct vhost_async *async;
+	uint32_t i, nr_left = 0;
+	uint16_t nb_pkts, j;
+	unsigned int ms;
+
+	for (i = 0; i < dev->virt_qp_nb; i++) {
+		vq = dev->virtqueue[i * VIRTIO_QNUM + VIRTIO_RXQ];
+		async = vq->async;
+		if (async == NULL)
+			continue;
+
+		for (ms = 0; async->pkt_tail != async->pkt_head; ms++) {
+			do {
+				nb_pkts = vhost_async_complete(dev, vq, pkts,
+					MAX_PKT_BURST);
+				for (j = 0; j < nb_pkts; j++)
+					rte_pktmbuf_free(pkts[j]);
+			} while (nb_pkts != 0);
+
+			if (async->pkt_tail == async->pkt_head ||
+					ms == VHOST_ASYNC_DRAIN_TIMEOUT_MS)
+				break;
+			usleep(1000);
+		}
+
+		nr_left += (uint16_t)(async->pkt_head - async->pkt_tail);
+	}
+
+	return nr_left;
+}
+
+void
+vhost_async_free(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	struct vhost_async *async = vq->async;
+
+	if (async == NULL)
+		return;
+	vq->async = NULL;
+
+	/* The engine may still write to the copies of the packets. */
+	if (async->pkt_head != async->pkt_tail) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%"PRIu64") %u packets still in flight, asynchronous "
+			"enqueue state not freed\n", dev->device_fh,
+			(uint16_t)(async->pkt_head - async->pkt_tail));
+		return;
+	}
+	rte_free(async);
+}
+
+/* Period of the warnings while waiting for the zero copy mbufs. */
+#define VHOST_ZCOPY_DRAIN_WARN_MS 1000
+/* Packets shorter than this are copied, which is cheaper, in zero copy. */
+#define VHOST_ZCOPY_COPY_THRESHOLD 512
+
+/*
+ * Host physical address of a guest buffer, or 0 if the buffer is not
+ * physically contiguous in the host.
+ */
+static inline uint64_t __attribute__((always_inline))
+gpa_to_hpa(struct virtio_net *dev, uint64_t guest_pa, uint64_t size)
+{
+	struct guest_page *page;
+	uint32_t low = 0, high = dev->nr_guest_pages, mid;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+		page = &dev->guest_pages[mid];
+		if (guest_pa < page->guest_phys_addr)
+			high = mid;
+		else if (guest_pa >= page->guest_phys_addr + page->size)
+			low = mid + 1;
+		else if (guest_pa + size > page->guest_phys_addr + page->size)
+			return 0;
+		else
+			return guest_pa - page->guest_phys_addr +
+				page->host_phys_addr;
+	}
+
+	return 0;
+}
+
+/* Give the segments of a zero copy mbuf back to their mempool. */
+static void
+vhost_zcopy_free_mbuf(struct rte_mbuf *m)
+{
+	struct rte_mbuf *next;
+
+	while (m != NULL) {
+		next = m->next;
+		rte_pktmbuf_detach(m);
+		rte_mbuf_refcnt_set(m, 1);
+		rte_pktmbuf_free_seg(m);
+		m = next;
+	}
+}
+
+/*
+ * The zero copy mbufs hold an extra reference, so that the application
+ * freeing them leaves their segments with a reference count of 1.
+ */
+static inline int __attribute__((always_inline))
+vhost_zcopy_mbuf_consumed(struct rte_mbuf *m)
+{
+	for (; m != NULL; m = m->next)
+		if (rte_mbuf_refcnt_read(m) != 1)
+			return 0;
+	return 1;
+}
+
+/*
+ * Put in the used ring, from entry used_idx, the descriptors of the zero
+ * copy mbufs freed by the application, oldest first, up to the first one
+ * still in use: the NICs free the mbufs in order, so the scan is not
+ * repeated over the mbufs in flight. Returns the number of entries.
+ */
+static uint16_t
+vhost_zcopy_reclaim(struct vhost_virtqueue *vq, uint16_t used_idx)
+{
+	struct zcopy_mbuf *zmbuf;
+	uint16_t nr_used = 0;
+
+	while (vq->nr_zmbufs != 0) {
+		zmbuf = &vq->zmbufs[vq->zmbuf_first & (vq->size - 1)];
+		if (!vhost_zcopy_mbuf_consumed(zmbuf->mbuf))
+			break;
+
+		vq->used->ring[used_idx & (vq->size - 1)].id =
+			zmbuf->desc_idx;
+		vq->used->ring[used_idx & (vq->size - 1)].len = 0;
+		used_idx++;
+		nr_used++;
+
+		vhost_zcopy_free_mbuf(zmbuf->mbuf);
+		vq->zmbuf_first++;
+		vq->nr_zmbufs--;
+	}
+
+	return nr_used;
+}
+
+/*
+ * The zero copy mbufs point to guest buffers the guest reuses once the
+ * rings are stopped, or to memory about to be unmapped: they cannot be
+ * forgotten, nor their buffers given back before they are freed.
+ */
+void
+vhost_zcopy_drain(struct virtio_net *dev)
+{
+	struct vhost_virtqueue *vq;
+	uint32_t i;
+	uint16_t nr_used;
+	unsigned int ms;
+	struct vhost_log_cache log_cache;
+
+	for (i = 0; i < dev->virt_qp_nb; i++) {
+		vq = dev->virtqueue[i * VIRTIO_QNUM + VIRTIO_TXQ];
+
+		for (ms = 1; vq->nr_zmbufs != 0; ms++) {
+			nr_used = vhost_zcopy_reclaim(vq,
+				vq->last_zcopy_used_idx);
+			if (nr_used != 0) {
+				rte_compiler_barrier();
+				vq->used->idx += nr_used;
+				log_cache.nr = 0;
+				vhost_log_used_entries(dev, vq, &log_cache,
+					vq->last_zcopy_used_idx, nr_used);
+				vhost_log_cache_sync(dev, &log_cache);
+				vq->last_zcopy_used_idx += nr_used;
+				if (vq->callfd >= 0 && !(vq->avail->flags &
+						VRING_AVAIL_F_NO_INTERRUPT))
+					eventfd_write(vq->callfd, (eventfd_t)1);
+			}
+			if (vq->nr_zmbufs == 0)
+				break;
+			if (ms % VHOST_ZCOPY_DRAIN_WARN_MS == 0)
+				RTE_LOG(WARNING, VHOST_CONFIG,
+					"(%"PRIu64") waiting for the "
+					"application to free %u zero copy "
+					"mbufs of vring %u\n", dev->device_fh,
+					vq->nr_zmbufs,
+					i * VIRTIO_QNUM + VIRTIO_TXQ);
+			usleep(1000);
+		}
+	}
+}
+
+/*
+ * Make an mbuf chain pointing to the guest buffers of a descriptor chain,
+ * from offset vb_offset of desc. Returns NULL if a buffer cannot be used by
+ * a NIC or is too long for an mbuf, or on allocation failure, which is
+ * reported in alloc_err.
+ */
+static struct rte_mbuf *
+vhost_zcopy_desc_to_mbuf(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	struct vring_desc *desc, uint32_t vb_offset,
+	struct rte_mempool *mbuf_pool, uint8_t *alloc_err)
+{
+	struct rte_mbuf *m = NULL, *cur, *prev = NULL;
+	uint64_t hpa;
+	uint16_t seg_num = 0;
+
+	while (1) {
+		hpa = gpa_to_hpa(dev, desc->addr, desc->len);
+		if (unlikely(hpa == 0 || desc->len > UINT16_MAX ||
+				vb_offset > desc->len))
+			goto fail;
+
+		cur = rte_pktmbuf_alloc(mbuf_pool);
+		if (unlikely(cur == NULL)) {
+			*alloc_err = 1;
+			goto fail;
+		}
+		cur->buf_addr = (void *)(uintptr_t)vq_gpa_to_vva(dev, vq, desc->addr);
+		cur->buf_physaddr = hpa;
+		cur->buf_len = desc->len;
+		cur->data_off = vb_offset;
+		cur->data_len = desc->len - vb_offset;
+
+		if (m == NULL)
+			m = cur;
+		else
+			prev->next = cur;
+		prev = cur;
+		m->pkt_len += cur->data_len;
+		seg_num++;
+
+		if (!(desc->flags & VRING_DESC_F_NEXT))
+			break;
+		desc = &vq->desc[desc->next];
+		vb_offset = 0;
+	}
+
+	m->nb_segs = seg_num;
+	for (cur = m; cur != NULL; cur = cur->next)
+		rte_mbuf_refcnt_set(cur, 2);
+
+	return m;
+
+fail:
+	vhost_zcopy_free_mbuf(m);
+	return NULL;
+}
+
+/*
+ * Copy to an mbuf chain of mbuf_pool the packet of the descriptor chain
+ * at ring position *idx of a packed virtqueue, skipping its virtio-net
+ * header, and record the chain in used. *idx and *wrap are moved past
+ * the chain. Returns NULL on allocation failure.
+ */
+static inline struct rte_mbuf * __attribute__((always_inline))
+copy_desc_to_mbuf_packed(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	uint16_t *idx, uint16_t *wrap, struct rte_mempool *mbuf_pool,
+	int offload, struct vhost_packed_used *used)
+{
+	struct vring_packed_desc *desc;
+	struct virtio_net_hdr *hdr = NULL;
+	struct rte_mbuf *m, *cur;
+	uint64_t vb_addr;
+	uint32_t vb_avail, vb_offset, seg_avail, seg_offset = 0, cpy_len;
+	uint32_t hdr_left = vq->vhost_hlen;
+	uint16_t cur_idx = *idx, cur_wrap = *wrap, count = 0, seg_num = 1;
+
+	m = rte_pktmbuf_alloc(mbuf_pool);
+	if (unlikely(m == NULL))
+		return NULL;
+	cur = m;
+	seg_avail = m->buf_len - RTE_PKTMBUF_HEADROOM;
+
+	do {
+		desc = &vq->desc_packed[cur_idx];
+		vb_addr = vq_gpa_to_vva(dev, vq, desc->addr);
+		rte_prefetch0((void *)(uintptr_t)vb_addr);
+		vb_avail = desc->len;
+		vb_offset = 0;
+
+		/* Discard the virtio header */
+		if (hdr_left != 0) {
+			if (offload && count == 0 && vb_avail >= hdr_left)
+				hdr = (struct virtio_net_hdr *)(uintptr_t)
+					vb_addr;
+			vb_offset = RTE_MIN(hdr_left, vb_avail);
+			vb_avail -= vb_offset;
+			hdr_left -= vb_offset;
+		}
+
+		PRINT_PACKET(dev, (uintptr_t)(vb_addr + vb_offset),
+			vb_avail, 0);
+
+		while (vb_avail != 0) {
+			if (seg_avail == 0) {
+				cur->data_len = seg_offset;
+				m->pkt_len += seg_offset;
+				cur->next = rte_pktmbuf_alloc(mbuf_pool);
+				if (unlikely(cur->next == NULL)) {
+					rte_pktmbuf_free(m);
+					return NULL;
+				}
+				cur = cur->next;
+				seg_num++;
+				seg_offset = 0;
+				seg_avail = cur->buf_len - RTE_PKTMBUF_HEADROOM;
+			}
+
+			cpy_len = RTE_MIN(vb_avail, seg_avail);
+			rte_memcpy(rte_pktmbuf_mtod_offset(cur, void *,
+					seg_offset),
+				(void *)(uintptr_t)(vb_addr + vb_offset),
+				cpy_len);
+			seg_offset += cpy_len;
+			seg_avail -= cpy_len;
+			vb_offset += cpy_len;
+			vb_avail -= cpy_len;
+		}
+
+		count++;
+		if (++cur_idx == vq->size) {
+			cur_idx = 0;
+			cur_wrap ^= 1;
+		}
+	} while ((desc->flags & VRING_DESC_F_NEXT) && count < vq->size);
+
+	cur->data_len = seg_offset;
+	m->pkt_len += seg_offset;
+	m->nb_segs = seg_num;
+	if (hdr != NULL)
+		vhost_dequeue_offload(hdr, m);
+
+	used->id = desc->id;
+	used->count = count;
+	used->len = 0;
+	used->idx = *idx;
+	used->wrap = *wrap;
+
+	*idx = cur_idx;
+	*wrap = cur_wrap;
+	return m;
+}
+
+/*
+ * rte_vhost_dequeue_burst() for a packed virtqueue. A guest which
+ * negotiated VIRTIO_F_IN_ORDER gets the whole burst back with a single
+ * used descriptor, the one of the last chain.
+ */
+static uint16_t
+virtio_dev_tx_packed(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	struct rte_mempool *mbuf_pool, struct rte_mbuf **pkts, uint16_t count)
+{
+	struct vhost_packed_used used[MAX_PKT_BURST];
+	uint16_t idx = vq->last_used_idx, wrap = vq->used_wrap_counter;
+	uint16_t i;
+	int offload;
+	struct vhost_log_cache log_cache;
+
+	count = RTE_MIN(count, MAX_PKT_BURST);
+	offload = (dev->features & VHOST_HOST_OFFLOAD_FEATURES) != 0;
+
+	for (i = 0; i < count; i++) {
+		if (!desc_is_avail(&vq->desc_packed[idx], wrap))
+			break;
+		/* The chain is read once its head is seen available. */
+		rte_smp_rmb();
+
+		pkts[i] = copy_desc_to_mbuf_packed(dev, vq, &idx, &wrap,
+			mbuf_pool, offload, &used[i]);
+		if (unlikely(pkts[i] == NULL)) {
+			RTE_LOG(ERR, VHOST_DATA,
+				"Failed to allocate memory for mbuf.\n");
+			break;
+		}
+	}
+
+	if (i == 0)
+		return 0;
+
+	log_cache.nr = 0;
+	if (dev->features & (1ULL << VIRTIO_F_IN_ORDER)) {
+		used[0].id = used[i - 1].id;
+		flush_used_packed(dev, vq, used, 1, &log_cache);
+	} else {
+		flush_used_packed(dev, vq, used, i, &log_cache);
+	}
+	vq->last_used_idx = idx;
+	vq->used_wrap_counter = wrap;
+
+	vhost_kick_packed(vq);
+
+	return i;
+}
+
+uint16_t
+rte_vhost_dequeue_burst(struct virtio_net *dev, uint16_t queue_id,
+	struct rte_mempool *mbuf_pool, struct rte_mbuf **pkts, uint16_t count)
+{
+	struct rte_mbuf *m, *prev;
+	struct vhost_virtqueue *vq;
+	struct zcopy_mbuf *zmbuf;
+	struct vring_desc *desc;
+	uint64_t vb_addr = 0;
+	uint32_t head[MAX_PKT_BURST];
+	uint32_t used_idx;
+	uint32_t i;
+	uint16_t free_entries, entry_success = 0;
+	uint16_t avail_idx;
+	uint16_t used_base, nr_used = 0;
+	int offload, zcopy;
+	struct vhost_log_cache log_cache;
+
+	if (unlikely(!is_valid_virt_queue_idx(queue_id, 1, dev->virt_qp_nb))) {
+		RTE_LOG(ERR, VHOST_DATA,
+			"%s (%"PRIu64"): virtqueue idx:%d invalid.\n",
+			__func__, dev->device_fh, queue_id);
+		return 0;
+	}
+
+	vq = dev->virtqueue[queue_id];
+	if (unlikely(vq->enabled == 0))
+		return 0;
+
+	if (dev->features & (1ULL << VIRTIO_F_RING_PACKED))
+		return virtio_dev_tx_packed(dev, vq, mbuf_pool, pkts, count);
+
+	/*
+	 * In zero copy mode, the descriptors are put in the used ring once
+	 * the application frees their mbufs.
+	 */
+	zcopy = dev->dequeue_zero_copy && vq->zmbufs != NULL;
+	if (zcopy) {
+		used_base = vq->last_zcopy_used_idx;
+		if (vq->nr_zmbufs != 0)
+			nr_used = vhost_zcopy_reclaim(vq, used_base);
+	} else {
+		used_base = vq->last_used_idx;
+	}
+
+	avail_idx =  *((volatile uint16_t *)&vq->avail->idx);
+
+	/* If there are no available buffers then return. */
+	if (vq->last_used_idx == avail_idx) {
+		if (likely(nr_used == 0))
+			return 0;
+		goto out;
+	}
+
 	LOG_DEBUG(VHOST_DATA, "%s (%"PRIu64")\n", __func__,
 		dev->device_fh);
 
+	offload = (dev->features & VHOST_HOST_OFFLOAD_FEATURES) != 0;
+
 	/* Prefetch available ring to retrieve head indexes. */
 	rte_prefetch0(&vq->avail->ring[vq->last_used_idx & (vq->size - 1)]);
 
@@ -623,12 +2366,16 @@ rte_vhost_dequeue_burst(struct virtio_net *dev, uint16_t queue_id,
 		uint32_t cpy_len;
 		uint32_t seg_num = 0;
 		struct rte_mbuf *cur;
+		struct virtio_net_hdr *hdr = NULL;
 		uint8_t alloc_err = 0;
 
 		desc = &vq->desc[head[entry_success]];
 
 		/* Discard first buffer as it is the virtio header */
 		if (desc->flags & VRING_DESC_F_NEXT) {
+			if (offload)
+				hdr = (struct virtio_net_hdr *)(uintptr_t)
+					vq_gpa_to_vva(dev, vq, desc->addr);
 			desc = &vq->desc[desc->next];
 			vb_offset = 0;
 			vb_avail = desc->len;
@@ -638,11 +2385,38 @@ rte_vhost_dequeue_burst(struct virtio_net *dev, uint16_t queue_id,
 		}
 
 		/* Buffer address translation. */
-		vb_addr = gpa_to_vva(dev, desc->addr);
+		vb_addr = vq_gpa_to_vva(dev, vq, desc->addr);
+		if (offload && vb_offset != 0)
+			hdr = (struct virtio_net_hdr *)(uintptr_t)vb_addr;
+
+		if (zcopy && vb_avail >= VHOST_ZCOPY_COPY_THRESHOLD) {
+			m = vhost_zcopy_desc_to_mbuf(dev, vq, desc, vb_offset,
+				mbuf_pool, &alloc_err);
+			if (unlikely(alloc_err == 1)) {
+				RTE_LOG(ERR, VHOST_DATA,
+					"Failed to allocate memory for mbuf.\n");
+				break;
+			}
+			if (m != NULL) {
+				zmbuf = &vq->zmbufs[(vq->zmbuf_first +
+					vq->nr_zmbufs) & (vq->size - 1)];
+				zmbuf->mbuf = m;
+				zmbuf->desc_idx = head[entry_success];
+				vq->nr_zmbufs++;
+				if (offload)
+					vhost_dequeue_offload(hdr, m);
+
+				pkts[entry_success] = m;
+				vq->last_used_idx++;
+				entry_success++;
+				continue;
+			}
+			/* Copied, and given back to the guest at once. */
+		}
 		/* Prefetch buffer address. */
 		rte_prefetch0((void *)(uintptr_t)vb_addr);
 
-		used_idx = vq->last_used_idx & (vq->size - 1);
+		used_idx = (used_base + nr_used) & (vq->size - 1);
 
 		if (entry_success < (free_entries - 1)) {
 			/* Prefetch descriptor index. */
@@ -742,7 +2516,7 @@ rte_vhost_dequeue_burst(struct virtio_net *dev, uint16_t queue_id,
 					desc = &vq->desc[desc->next];
 
 					/* Buffer address translation. */
-					vb_addr = gpa_to_vva(dev, desc->addr);
+					vb_addr = vq_gpa_to_vva(dev, vq, desc->addr);
 					/* Prefetch buffer address. */
 					rte_prefetch0((void *)(uintptr_t)vb_addr);
 					vb_offset = 0;
@@ -765,16 +2539,180 @@ rte_vhost_dequeue_burst(struct virtio_net *dev, uint16_t queue_id,
 			break;
 
 		m->nb_segs = seg_num;
+		if (offload)
+			vhost_dequeue_offload(hdr, m);
 
 		pkts[entry_success] = m;
 		vq->last_used_idx++;
 		entry_success++;
+		nr_used++;
 	}
 
+out:
+	if (unlikely(nr_used == 0))
+		return entry_success;
+
+	/* One used ring index update and guest kick for the whole burst. */
 	rte_compiler_barrier();
-	vq->used->idx += entry_success;
+	vq->used->idx += nr_used;
+	log_cache.nr = 0;
+	vhost_log_used_entries(dev, vq, &log_cache, used_base, nr_used);
+	vhost_log_cache_sync(dev, &log_cache);
+	if (zcopy)
+		vq->last_zcopy_used_idx += nr_used;
 	/* Kick guest if required. */
 	if (!(vq->avail->flags & VRING_AVAIL_F_NO_INTERRUPT))
 		eventfd_write(vq->callfd, (eventfd_t)1);
 	return entry_success;
 }
+
+/*
+ * Segment a TSO packet in software into single segment mbufs of mp, with
+ * their checksums offloaded when the NIC supports it.
+ */
+static int
+vhost_sw_tso(struct rte_mbuf *pkt, uint32_t tx_offload_capa,
+	struct rte_mempool *mp, struct rte_mbuf **pkts_out,
+	uint16_t nb_pkts_out)
+{
+	uint32_t hdr_len = pkt->l2_len + pkt->l3_len + pkt->l4_len;
+	uint32_t mss = pkt->tso_segsz;
+	uint32_t payload_len, len, nb_segs, i;
+	uint32_t seq;
+	uint16_t ip_id = 0;
+	uint64_t hw_flags = 0, sw_flags = 0;
+	const struct tcp_hdr *tcp_hdr;
+	struct rte_mbuf *m;
+	char *data;
+
+	if (unlikely(mss == 0 || pkt->l4_len < sizeof(struct tcp_hdr) ||
+			hdr_len > rte_pktmbuf_data_len(pkt) ||
+			hdr_len + mss > (uint32_t)rte_pktmbuf_data_room_size(mp) -
+				RTE_PKTMBUF_HEADROOM))
+		return -EINVAL;
+
+	payload_len = rte_pktmbuf_pkt_len(pkt) - hdr_len;
+	nb_segs = (payload_len == 0) ? 1 : (payload_len + mss - 1) / mss;
+	if (unlikely(nb_segs > nb_pkts_out))
+		return -ENOSPC;
+
+	tcp_hdr = rte_pktmbuf_mtod_offset(pkt, const struct tcp_hdr *,
+		pkt->l2_len + pkt->l3_len);
+	seq = rte_be_to_cpu_32(tcp_hdr->sent_seq);
+	if (pkt->ol_flags & PKT_TX_IPV4) {
+		ip_id = rte_be_to_cpu_16(rte_pktmbuf_mtod_offset(pkt,
+			const struct ipv4_hdr *, pkt->l2_len)->packet_id);
+		if (tx_offload_capa & DEV_TX_OFFLOAD_IPV4_CKSUM)
+			hw_flags |= PKT_TX_IP_CKSUM;
+		else
+			sw_flags |= PKT_TX_IP_CKSUM;
+	}
+	if (tx_offload_capa & DEV_TX_OFFLOAD_TCP_CKSUM)
+		hw_flags |= PKT_TX_TCP_CKSUM;
+	else
+		sw_flags |= PKT_TX_TCP_CKSUM;
+
+	for (i = 0; i < nb_segs; i++) {
+		struct tcp_hdr *seg_tcp_hdr;
+		void *l3_hdr;
+
+		m = rte_pktmbuf_alloc(mp);
+		if (unlikely(m == NULL)) {
+			while (i > 0)
+				rte_pktmbuf_free(pkts_out[--i]);
+			return -ENOMEM;
+		}
+
+		len = RTE_MIN(mss, payload_len - i * mss);
+		data = rte_pktmbuf_append(m, hdr_len + len);
+		rte_memcpy(data, rte_pktmbuf_mtod(pkt, void *), hdr_len);
+		vhost_mbuf_read(pkt, hdr_len + i * mss, data + hdr_len, len);
+
+		m->port = pkt->port;
+		m->vlan_tci = pkt->vlan_tci;
+		m->vlan_tci_outer = pkt->vlan_tci_outer;
+		m->tx_offload = pkt->tx_offload;
+		m->tso_segsz = 0;
+		m->ol_flags = (pkt->ol_flags & ~VHOST_TX_OFFLOAD_FLAGS) |
+			hw_flags;
+
+		l3_hdr = data + m->l2_len;
+		if (m->ol_flags & PKT_TX_IPV4) {
+			struct ipv4_hdr *ip = l3_hdr;
+
+			ip->total_length = rte_cpu_to_be_16(m->l3_len +
+				m->l4_len + len);
+			ip->packet_id = rte_cpu_to_be_16(ip_id + i);
+			ip->hdr_checksum = 0;
+		} else {
+			struct ipv6_hdr *ip = l3_hdr;
+
+			ip->payload_len = rte_cpu_to_be_16(m->l3_len -
+				sizeof(*ip) + m->l4_len + len);
+		}
+
+		seg_tcp_hdr = (struct tcp_hdr *)(data + m->l2_len + m->l3_len);
+		seg_tcp_hdr->sent_seq = rte_cpu_to_be_32(seq + i * mss);
+		if (i != nb_segs - 1)
+			seg_tcp_hdr->tcp_flags &=
+				~(VHOST_TCP_FIN_FLAG | VHOST_TCP_PSH_FLAG);
+		if (i != 0)
+			seg_tcp_hdr->tcp_flags &= ~VHOST_TCP_CWR_FLAG;
+		seg_tcp_hdr->cksum = __rte_raw_cksum_reduce(
+			vhost_phdr_sum(l3_hdr, m->ol_flags, m->l4_len + len));
+
+		if (sw_flags != 0)
+			vhost_sw_cksum(m, sw_flags);
+
+		pkts_out[i] = m;
+	}
+
+	rte_pktmbuf_free(pkt);
+	return nb_segs;
+}
+
+int
+rte_vhost_offload_fallback(struct rte_mbuf *pkt, uint32_t tx_offload_capa,
+	struct rte_mempool *mp, struct rte_mbuf **pkts_out,
+	uint16_t nb_pkts_out)
+{
+	uint64_t sw_flags = 0;
+	int ret;
+
+	if (unlikely(nb_pkts_out == 0))
+		return -ENOSPC;
+
+	if (pkt->ol_flags & PKT_TX_TCP_SEG) {
+		if (!(tx_offload_capa & DEV_TX_OFFLOAD_TCP_TSO))
+			return vhost_sw_tso(pkt, tx_offload_capa, mp,
+				pkts_out, nb_pkts_out);
+	} else {
+		switch (pkt->ol_flags & PKT_TX_L4_MASK) {
+		case PKT_TX_TCP_CKSUM:
+			if (!(tx_offload_capa & DEV_TX_OFFLOAD_TCP_CKSUM))
+				sw_flags |= PKT_TX_TCP_CKSUM;
+			break;
+		case PKT_TX_UDP_CKSUM:
+			if (!(tx_offload_capa & DEV_TX_OFFLOAD_UDP_CKSUM))
+				sw_flags |= PKT_TX_UDP_CKSUM;
+			break;
+		default:
+			break;
+		}
+		if ((pkt->ol_flags & PKT_TX_IP_CKSUM) &&
+				!(tx_offload_capa & DEV_TX_OFFLOAD_IPV4_CKSUM))
+			sw_flags |= PKT_TX_IP_CKSUM;
+	}
+
+	if (sw_flags != 0) {
+		ret = vhost_sw_cksum(pkt, sw_flags);
+		if (ret < 0)
+			return ret;
+		pkt->ol_flags &= ~(sw_flags & PKT_TX_IP_CKSUM);
+		if (sw_flags & PKT_TX_L4_MASK)
+			pkt->ol_flags &= ~PKT_TX_L4_MASK;
+	}
+
+	pkts_out[0] = pkt;
+	return 1;
+}
@@ -49,6 +49,7 @@
 #include "fd_man.h"
 #include "vhost-net-user.h"
 #include "vhost-net.h"
+#include "virtio-net.h"
 #include "virtio-net-user.h"
 
 #define MAX_VIRTIO_BACKLOG 128
@@ -193,6 +194,8 @@ read_vhost_message(int sockfd, struct VhostUserMsg *msg)
 {
 	int ret;
 
+	/* -1 for the fds the message does not carry */
+	memset(msg->fds, -1, sizeof(msg->fds));
 	ret = read_fd_message(sockfd, (char *)msg, VHOST_USER_HDR_SIZE,
 		msg->fds, VHOST_MEMORY_MAX_NREGIONS);
 	if (ret <= 0)
@@ -313,6 +316,9 @@ vserver_new_vq_conn(int fd, void *dat, __rte_unused int *remove)
 	ops->set_ifname(vdev_ctx, vserver->path,
 		size);
 
+	if (vserver->flags & RTE_VHOST_USER_DEQUEUE_ZERO_COPY)
+		get_device(vdev_ctx)->dequeue_zero_copy = 1;
+
 	RTE_LOG(INFO, VHOST_CONFIG, "new device, handle is %d\n", fh);
 
 	ctx->vserver = vserver;
@@ -388,7 +394,11 @@ vserver_message_handler(int connfd, void *dat, int *remove)
 		break;
 
 	case VHOST_USER_SET_LOG_BASE:
-		RTE_LOG(INFO, VHOST_CONFIG, "not implemented.\n");
+		user_set_log_base(ctx, &msg);
+		/* QEMU waits for a reply once the log is mapped. */
+		msg.payload.u64 = 0;
+		msg.size = sizeof(msg.payload.u64);
+		send_vhost_message(connfd, &msg);
 		break;
 
 	case VHOST_USER_SET_LOG_FD:
@@ -445,7 +455,7 @@ vserver_message_handler(int connfd, void *dat, int *remove)
  * Creates and initialise the vhost server.
  */
 int
-rte_vhost_driver_register(const char *path)
+rte_vhost_driver_register_flags(const char *path, uint64_t flags)
 {
 	struct vhost_server *vserver;
 
@@ -474,6 +484,7 @@ rte_vhost_driver_register(const char *path)
 	}
 
 	vserver->path = strdup(path);
+	vserver->flags = flags;
 
 	fdset_add(&g_vhost_server.fdset, vserver->listenfd,
 		vserver_new_vq_conn, NULL, vserver);
@@ -484,6 +495,11 @@ rte_vhost_driver_register(const char *path)
 	return 0;
 }
 
+int
+rte_vhost_driver_register(const char *path)
+{
+	return rte_vhost_driver_register_flags(path, 0);
+}
 
 /**
  * Unregister the specified vhost server
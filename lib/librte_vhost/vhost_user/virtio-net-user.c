@@ -69,15 +69,71 @@ get_blk_size(int fd)
 	return (uint64_t)stat.st_blksize;
 }
 
+/* Unmap and free a list of logs. */
+static void
+free_log_list(struct vhost_log *log)
+{
+	struct vhost_log *next;
+
+	for (; log != NULL; log = next) {
+		next = log->next;
+		if (log->addr != 0)
+			munmap((void *)(uintptr_t)log->addr, log->mmap_size);
+		free(log);
+	}
+}
+
+/*
+ * Unmap the logs replaced by QEMU, once the data path cannot use them
+ * anymore: the device is stopped.
+ */
+static void
+free_old_logs(struct virtio_net *dev)
+{
+	if (dev->log == NULL)
+		return;
+
+	free_log_list(dev->log->next);
+	dev->log->next = NULL;
+}
+
+static void
+free_log(struct virtio_net *dev)
+{
+	struct vhost_log *log = dev->log;
+
+	dev->log = NULL;
+	free_log_list(log);
+}
+
 static void
 free_mem_region(struct virtio_net *dev)
 {
 	struct orig_region_map *region;
 	unsigned int idx;
+	uint32_t nr_left;
 
 	if (!dev || !dev->mem)
 		return;
 
+	free(dev->guest_pages);
+	dev->guest_pages = NULL;
+	dev->nr_guest_pages = 0;
+
+	/*
+	 * The copies the engines did not complete in time still point to
+	 * the guest memory: keep it mapped.
+	 */
+	if (dev->dequeue_zero_copy)
+		vhost_zcopy_drain(dev);
+	nr_left = vhost_async_drain(dev);
+	if (nr_left != 0) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%"PRIu64") asynchronous copies still in flight, "
+			"guest memory not unmapped\n", dev->device_fh);
+		return;
+	}
+
 	region = orig_region(dev->mem, dev->mem->nregions);
 	for (idx = 0; idx < dev->mem->nregions; idx++) {
 		if (region[idx].mapped_address) {
@@ -88,6 +144,79 @@ free_mem_region(struct virtio_net *dev)
 	}
 }
 
+static int
+add_guest_page(struct virtio_net *dev, uint64_t guest_phys_addr,
+	uint64_t host_phys_addr, uint64_t size)
+{
+	struct guest_page *page, *pages;
+
+	if (dev->nr_guest_pages != 0) {
+		page = &dev->guest_pages[dev->nr_guest_pages - 1];
+		if (page->guest_phys_addr + page->size == guest_phys_addr &&
+				page->host_phys_addr + page->size ==
+					host_phys_addr) {
+			page->size += size;
+			return 0;
+		}
+	}
+
+	pages = realloc(dev->guest_pages,
+		(dev->nr_guest_pages + 1) * sizeof(*pages));
+	if (pages == NULL)
+		return -1;
+	dev->guest_pages = pages;
+
+	page = &dev->guest_pages[dev->nr_guest_pages++];
+	page->guest_phys_addr = guest_phys_addr;
+	page->host_phys_addr = host_phys_addr;
+	page->size = size;
+	return 0;
+}
+
+static int
+guest_page_cmp(const void *a, const void *b)
+{
+	const struct guest_page *pa = a, *pb = b;
+
+	if (pa->guest_phys_addr < pb->guest_phys_addr)
+		return -1;
+	return pa->guest_phys_addr > pb->guest_phys_addr;
+}
+
+/*
+ * Record the host physical address of each page of a region, merging the
+ * physically contiguous ones, for the NICs to use the zero copy mbufs.
+ */
+static int
+add_guest_pages(struct virtio_net *dev, struct virtio_memory_regions *reg,
+	uint64_t page_size)
+{
+	uint64_t guest_phys_addr = reg->guest_phys_address;
+	uint64_t host_user_addr = guest_phys_addr + reg->address_offset;
+	uint64_t remaining = reg->memory_size;
+	uint64_t size;
+	phys_addr_t host_phys_addr;
+
+	while (remaining != 0) {
+		size = RTE_MIN(remaining,
+			page_size - (host_user_addr & (page_size - 1)));
+		/* Fault the page in, for it to be in the page map. */
+		*(volatile char *)(uintptr_t)host_user_addr;
+		host_phys_addr = rte_mem_virt2phy(
+			(void *)(uintptr_t)host_user_addr);
+		if (host_phys_addr == RTE_BAD_PHYS_ADDR ||
+				add_guest_page(dev, guest_phys_addr,
+					host_phys_addr, size) < 0)
+			return -1;
+
+		guest_phys_addr += size;
+		host_user_addr += size;
+		remaining -= size;
+	}
+
+	return 0;
+}
+
 int
 user_set_mem_table(struct vhost_device_ctx ctx, struct VhostUserMsg *pmsg)
 {
@@ -107,6 +236,7 @@ user_set_mem_table(struct vhost_device_ctx ctx, struct VhostUserMsg *pmsg)
 	/* Remove from the data plane. */
 	if (dev->flags & VIRTIO_DEV_RUNNING)
 		notify_ops->destroy_device(dev);
+	free_old_logs(dev);
 
 	if (dev->mem) {
 		free_mem_region(dev);
@@ -190,6 +320,18 @@ user_set_mem_table(struct vhost_device_ctx ctx, struct VhostUserMsg *pmsg)
 				pregion->address_offset;
 		}
 
+		if (dev->dequeue_zero_copy &&
+				add_guest_pages(dev, pregion, alignment) < 0) {
+			RTE_LOG(ERR, VHOST_CONFIG,
+				"(%"PRIu64") Failed to get the host physical "
+				"addresses, zero copy is disabled\n",
+				dev->device_fh);
+			dev->dequeue_zero_copy = 0;
+			free(dev->guest_pages);
+			dev->guest_pages = NULL;
+			dev->nr_guest_pages = 0;
+		}
+
 		LOG_DEBUG(VHOST_CONFIG,
 			"REGION: %u GPA: %p QEMU VA: %p SIZE (%"PRIu64")\n",
 			idx,
@@ -198,6 +340,10 @@ user_set_mem_table(struct vhost_device_ctx ctx, struct VhostUserMsg *pmsg)
 			 pregion->memory_size);
 	}
 
+	if (dev->nr_guest_pages != 0)
+		qsort(dev->guest_pages, dev->nr_guest_pages,
+			sizeof(*dev->guest_pages), guest_page_cmp);
+
 	return 0;
 
 err_mmap:
@@ -277,8 +423,14 @@ user_set_vring_kick(struct vhost_device_ctx ctx, struct VhostUserMsg *pmsg)
 	ops->set_vring_kick(ctx, &file);
 
 	if (virtio_is_ready(dev) &&
-		!(dev->flags & VIRTIO_DEV_RUNNING))
-			notify_ops->new_device(dev);
+		!(dev->flags & VIRTIO_DEV_RUNNING)) {
+		uint32_t i;
+
+		if (notify_ops->new_device(dev) < 0)
+			return;
+		for (i = 0; i < dev->virt_qp_nb * VIRTIO_QNUM; i++)
+			vhost_notify_numa(dev, i);
+	}
 }
 
 /*
@@ -295,6 +447,15 @@ user_get_vring_base(struct vhost_device_ctx ctx,
 	/* We have to stop the queue (virtio) if it is running. */
 	if (dev->flags & VIRTIO_DEV_RUNNING)
 		notify_ops->destroy_device(dev);
+	free_old_logs(dev);
+
+	/*
+	 * The guest gets back the buffers of the zero copy mbufs, and of the
+	 * packets in flight in the copy engines.
+	 */
+	if (dev->dequeue_zero_copy)
+		vhost_zcopy_drain(dev);
+	vhost_async_drain(dev);
 
 	/* Here we are safe to get the last used index */
 	ops->get_vring_base(ctx, state->index, state);
@@ -335,6 +496,77 @@ user_set_vring_enable(struct vhost_device_ctx ctx,
 
 	dev->virtqueue[state->index]->enabled = enable;
 
+	if (enable)
+		vhost_notify_numa(dev, state->index);
+
+	return 0;
+}
+
+/*
+ * QEMU shares the dirty page log of a migration, and gives a larger one
+ * when the guest memory grows, while the device runs. The new log is
+ * published at once, the data path reading the log base and size from
+ * the same log. The old one is unmapped once the device is stopped.
+ */
+int
+user_set_log_base(struct vhost_device_ctx ctx, struct VhostUserMsg *pmsg)
+{
+	struct virtio_net *dev;
+	struct vhost_log *log;
+	int fd = pmsg->fds[0];
+	uint64_t size, off;
+	void *addr;
+
+	dev = get_device(ctx);
+	if (dev == NULL) {
+		close(fd);
+		return -1;
+	}
+
+	if (fd < 0) {
+		RTE_LOG(ERR, VHOST_CONFIG, "invalid log fd: %d\n", fd);
+		return -1;
+	}
+
+	if (pmsg->size != sizeof(VhostUserLog)) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"invalid log base msg size: %"PRIu32" != %d\n",
+			pmsg->size, (int)sizeof(VhostUserLog));
+		close(fd);
+		return -1;
+	}
+
+	size = pmsg->payload.log.mmap_size;
+	off = pmsg->payload.log.mmap_offset;
+	RTE_LOG(INFO, VHOST_CONFIG,
+		"log mmap size: %"PRIu64", offset: %"PRIu64"\n", size, off);
+
+	/* Mapped from 0, the offset may not be page aligned. */
+	addr = mmap(0, size + off, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		RTE_LOG(ERR, VHOST_CONFIG, "mmap log base failed!\n");
+		return -1;
+	}
+
+	log = malloc(sizeof(*log));
+	if (log == NULL) {
+		RTE_LOG(ERR, VHOST_CONFIG, "failed to allocate the log\n");
+		munmap(addr, size + off);
+		return -1;
+	}
+	log->addr = (uint64_t)(uintptr_t)addr;
+	log->mmap_size = size + off;
+	log->base = log->addr + off;
+	log->size = size;
+	log->next = dev->log;
+
+	rte_smp_wmb();
+	dev->log = log;
+
+	if (!(dev->flags & VIRTIO_DEV_RUNNING))
+		free_old_logs(dev);
+
 	return 0;
 }
 
@@ -351,6 +583,9 @@ user_destroy_device(struct vhost_device_ctx ctx)
 		free(dev->mem);
 		dev->mem = NULL;
 	}
+
+	if (dev)
+		free_log(dev);
 }
 
 void
@@ -72,13 +72,33 @@ static struct virtio_net_config_ll *ll_root;
 
 /* Features supported by this lib. */
 #define VHOST_SUPPORTED_FEATURES ((1ULL << VIRTIO_NET_F_MRG_RXBUF) | \
+				(1ULL << VIRTIO_NET_F_CSUM)    | \
+				(1ULL << VIRTIO_NET_F_GUEST_CSUM) | \
+				(1ULL << VIRTIO_NET_F_HOST_TSO4) | \
+				(1ULL << VIRTIO_NET_F_HOST_TSO6) | \
+				(1ULL << VIRTIO_NET_F_GUEST_TSO4) | \
+				(1ULL << VIRTIO_NET_F_GUEST_TSO6) | \
 				(1ULL << VIRTIO_NET_F_CTRL_VQ) | \
 				(1ULL << VIRTIO_NET_F_CTRL_RX) | \
 				(VHOST_SUPPORTS_MQ)            | \
 				(1ULL << VIRTIO_F_VERSION_1)   | \
+				(1ULL << VIRTIO_F_RING_PACKED) | \
+				(1ULL << VIRTIO_F_IN_ORDER)    | \
 				(1ULL << VHOST_F_LOG_ALL)      | \
 				(1ULL << VHOST_USER_F_PROTOCOL_FEATURES))
-static uint64_t VHOST_FEATURES = VHOST_SUPPORTED_FEATURES;
+
+/*
+ * The offloads of the packets sent by the guest are left to the
+ * application, which must enable them with rte_vhost_feature_enable() only
+ * when it sends the packets to a port supporting them, or prepares them
+ * with rte_vhost_offload_fallback().
+ */
+static uint64_t VHOST_FEATURES = VHOST_SUPPORTED_FEATURES &
+	~VHOST_HOST_OFFLOAD_FEATURES;
+
+/* Features the dequeue zero copy does not support. */
+#define VHOST_ZCOPY_UNSUPPORTED_FEATURES ((1ULL << VIRTIO_F_RING_PACKED) | \
+				(1ULL << VIRTIO_F_IN_ORDER))
 
 
 /*
@@ -107,6 +127,27 @@ qva_to_vva(struct virtio_net *dev, uint64_t qemu_va)
 	return vhost_va;
 }
 
+/*
+ * Converts QEMU virtual address to guest physical address, for the dirty
+ * log of the rings.
+ */
+static uint64_t
+qva_to_gpa(struct virtio_net *dev, uint64_t qemu_va)
+{
+	struct virtio_memory_regions *region;
+	uint32_t regionidx;
+
+	for (regionidx = 0; regionidx < dev->mem->nregions; regionidx++) {
+		region = &dev->mem->regions[regionidx];
+		if ((qemu_va >= region->userspace_address) &&
+			(qemu_va <= region->userspace_address +
+			region->memory_size))
+			return qemu_va + region->guest_phys_address -
+				region->userspace_address;
+	}
+	return 0;
+}
+
 
 /*
  * Retrieves an entry from the devices configuration linked list.
@@ -219,11 +260,17 @@ cleanup_device(struct virtio_net *dev, int destroy)
 static void
 free_device(struct virtio_net_config_ll *ll_dev)
 {
+	struct vhost_virtqueue *vq;
 	uint32_t i;
 
-	for (i = 0; i < ll_dev->dev.virt_qp_nb; i++)
-		rte_free(ll_dev->dev.virtqueue[i * VIRTIO_QNUM]);
+	for (i = 0; i < ll_dev->dev.virt_qp_nb * VIRTIO_QNUM; i++) {
+		vq = ll_dev->dev.virtqueue[i];
+		rte_free(vq->zmbufs);
+		vhost_async_free(&ll_dev->dev, vq);
+		rte_free(vq);
+	}
 
+	free(ll_dev->dev.guest_pages);
 	rte_free(ll_dev);
 }
 
@@ -263,6 +310,8 @@ init_vring_queue(struct vhost_virtqueue *vq, int qp_idx)
 
 	vq->kickfd = -1;
 	vq->callfd = -1;
+	vq->numa_node = -1;
+	rte_spinlock_init(&vq->packed_lock);
 
 	/* Backends are set to -1 indicating an inactive device. */
 	vq->backend = -1;
@@ -282,10 +331,13 @@ init_vring_queue_pair(struct virtio_net *dev, uint32_t qp_idx)
 }
 
 static void
-reset_vring_queue(struct vhost_virtqueue *vq, int qp_idx)
+reset_vring_queue(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	int qp_idx)
 {
 	int callfd;
 
+	rte_free(vq->zmbufs);
+	vhost_async_free(dev, vq);
 	callfd = vq->callfd;
 	init_vring_queue(vq, qp_idx);
 	vq->callfd = callfd;
@@ -296,27 +348,33 @@ reset_vring_queue_pair(struct virtio_net *dev, uint32_t qp_idx)
 {
 	uint32_t base_idx = qp_idx * VIRTIO_QNUM;
 
-	reset_vring_queue(dev->virtqueue[base_idx + VIRTIO_RXQ], qp_idx);
-	reset_vring_queue(dev->virtqueue[base_idx + VIRTIO_TXQ], qp_idx);
+	reset_vring_queue(dev, dev->virtqueue[base_idx + VIRTIO_RXQ], qp_idx);
+	reset_vring_queue(dev, dev->virtqueue[base_idx + VIRTIO_TXQ], qp_idx);
 }
 
 static int
 alloc_vring_queue_pair(struct virtio_net *dev, uint32_t qp_idx)
 {
-	struct vhost_virtqueue *virtqueue = NULL;
+	struct vhost_virtqueue *rxq, *txq;
 	uint32_t virt_rx_q_idx = qp_idx * VIRTIO_QNUM + VIRTIO_RXQ;
 	uint32_t virt_tx_q_idx = qp_idx * VIRTIO_QNUM + VIRTIO_TXQ;
 
-	virtqueue = rte_malloc(NULL,
-			       sizeof(struct vhost_virtqueue) * VIRTIO_QNUM, 0);
-	if (virtqueue == NULL) {
+	/*
+	 * Each virtqueue is a separate allocation, so that numa_realloc()
+	 * can move it to the node of its own vring.
+	 */
+	rxq = rte_malloc(NULL, sizeof(struct vhost_virtqueue), 0);
+	txq = rte_malloc(NULL, sizeof(struct vhost_virtqueue), 0);
+	if (rxq == NULL || txq == NULL) {
 		RTE_LOG(ERR, VHOST_CONFIG,
 			"Failed to allocate memory for virt qp:%d.\n", qp_idx);
+		rte_free(rxq);
+		rte_free(txq);
 		return -1;
 	}
 
-	dev->virtqueue[virt_rx_q_idx] = virtqueue;
-	dev->virtqueue[virt_tx_q_idx] = virtqueue + VIRTIO_TXQ;
+	dev->virtqueue[virt_rx_q_idx] = rxq;
+	dev->virtqueue[virt_tx_q_idx] = txq;
 
 	init_vring_queue_pair(dev, qp_idx);
 
@@ -363,6 +421,7 @@ new_device(struct vhost_device_ctx ctx)
 	}
 
 	new_ll_dev->next = NULL;
+	new_ll_dev->dev.numa_node = -1;
 
 	/* Add entry to device configuration linked list. */
 	add_config_ll_entry(new_ll_dev);
@@ -473,6 +532,8 @@ get_features(struct vhost_device_ctx ctx, uint64_t *pu)
 
 	/* Send our supported features. */
 	*pu = VHOST_FEATURES;
+	if (dev->dequeue_zero_copy)
+		*pu &= ~VHOST_ZCOPY_UNSUPPORTED_FEATURES;
 	return 0;
 }
 
@@ -492,6 +553,8 @@ set_features(struct vhost_device_ctx ctx, uint64_t *pu)
 		return -1;
 	if (*pu & ~VHOST_FEATURES)
 		return -1;
+	if (dev->dequeue_zero_copy && (*pu & VHOST_ZCOPY_UNSUPPORTED_FEATURES))
+		return -1;
 
 	dev->features = *pu;
 	if (dev->features &
@@ -524,90 +587,120 @@ static int
 set_vring_num(struct vhost_device_ctx ctx, struct vhost_vring_state *state)
 {
 	struct virtio_net *dev;
+	struct vhost_virtqueue *vq;
 
 	dev = get_device(ctx);
 	if (dev == NULL)
 		return -1;
 
 	/* State->index refers to the queue index. The txq is 1, rxq is 0. */
-	dev->virtqueue[state->index]->size = state->num;
+	vq = dev->virtqueue[state->index];
+	vq->size = state->num;
+
+	/* The zero copy mbufs of the previous rings were drained. */
+	if (dev->dequeue_zero_copy && (state->index & 1) == VIRTIO_TXQ) {
+		rte_free(vq->zmbufs);
+		vq->nr_zmbufs = 0;
+		vq->zmbuf_first = 0;
+		vq->zmbufs = rte_zmalloc(NULL,
+			vq->size * sizeof(struct zcopy_mbuf), 0);
+		/* The dequeue copies the packets of a vring without zmbufs. */
+		if (vq->zmbufs == NULL)
+			RTE_LOG(ERR, VHOST_CONFIG,
+				"(%"PRIu64") Failed to allocate memory for "
+				"zero copy of vring %u, zero copy disabled "
+				"on it.\n", dev->device_fh, state->index);
+	}
 
 	return 0;
 }
 
 /*
- * Reallocate virtio_dev and vhost_virtqueue data structure to make them on the
- * same numa node as the memory of vring descriptor.
+ * Reallocate a vhost_virtqueue, with its zero copy mbufs, on the numa node of
+ * the memory of its vring descriptors, and the virtio_dev on the node of its
+ * first vring. The structures of a running device are in use by the data
+ * cores and are left where they are.
  */
 #ifdef RTE_LIBRTE_VHOST_NUMA
 static struct virtio_net*
 numa_realloc(struct virtio_net *dev, int index)
 {
 	int oldnode, newnode;
-	struct virtio_net_config_ll *old_ll_dev, *new_ll_dev = NULL;
-	struct vhost_virtqueue *old_vq, *new_vq = NULL;
-	int ret;
-	int realloc_dev = 0, realloc_vq = 0;
+	struct virtio_net_config_ll *old_ll_dev, *new_ll_dev;
+	struct vhost_virtqueue *old_vq, *vq;
+	struct zcopy_mbuf *zmbufs;
 
-	old_ll_dev = (struct virtio_net_config_ll *)dev;
-	old_vq = dev->virtqueue[index];
-
-	ret  = get_mempolicy(&newnode, NULL, 0, old_vq->desc,
-			MPOL_F_NODE | MPOL_F_ADDR);
-	ret = ret | get_mempolicy(&oldnode, NULL, 0, old_ll_dev,
-			MPOL_F_NODE | MPOL_F_ADDR);
-	if (ret) {
+	vq = dev->virtqueue[index];
+	if (get_mempolicy(&newnode, NULL, 0, vq->desc,
+			MPOL_F_NODE | MPOL_F_ADDR)) {
 		RTE_LOG(ERR, VHOST_CONFIG,
-			"Unable to get vring desc or dev numa information.\n");
+			"Unable to get vring desc numa information.\n");
 		return dev;
 	}
-	if (oldnode != newnode)
-		realloc_dev = 1;
+	vq->numa_node = newnode;
+	if (index == 0)
+		dev->numa_node = newnode;
+
+	if (dev->flags & VIRTIO_DEV_RUNNING)
+		return dev;
 
-	ret = get_mempolicy(&oldnode, NULL, 0, old_vq,
-			MPOL_F_NODE | MPOL_F_ADDR);
-	if (ret) {
+	if (get_mempolicy(&oldnode, NULL, 0, vq,
+			MPOL_F_NODE | MPOL_F_ADDR)) {
 		RTE_LOG(ERR, VHOST_CONFIG,
 			"Unable to get vq numa information.\n");
 		return dev;
 	}
-	if (oldnode != newnode)
-		realloc_vq = 1;
+	if (oldnode != newnode) {
+		old_vq = vq;
+		vq = rte_malloc_socket(NULL, sizeof(*vq), 0, newnode);
+		if (vq == NULL)
+			return dev;
+		memcpy(vq, old_vq, sizeof(*vq));
+		if (old_vq->zmbufs) {
+			zmbufs = rte_zmalloc_socket(NULL,
+				vq->size * sizeof(struct zcopy_mbuf), 0,
+				newnode);
+			if (zmbufs) {
+				memcpy(zmbufs, old_vq->zmbufs,
+				       vq->size * sizeof(*zmbufs));
+				rte_free(old_vq->zmbufs);
+				vq->zmbufs = zmbufs;
+			}
+		}
+		dev->virtqueue[index] = vq;
+		rte_free(old_vq);
+	}
 
-	if (realloc_dev == 0 && realloc_vq == 0)
+	/* The device follows its first vring. */
+	if (index != 0)
 		return dev;
 
-	if (realloc_dev)
-		new_ll_dev = rte_malloc_socket(NULL,
-			sizeof(struct virtio_net_config_ll), 0, newnode);
-	if (realloc_vq)
-		new_vq = rte_malloc_socket(NULL,
-			sizeof(struct vhost_virtqueue), 0, newnode);
-	if (!new_ll_dev && !new_vq)
+	old_ll_dev = (struct virtio_net_config_ll *)dev;
+	if (get_mempolicy(&oldnode, NULL, 0, old_ll_dev,
+			MPOL_F_NODE | MPOL_F_ADDR)) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"Unable to get dev numa information.\n");
+		return dev;
+	}
+	if (oldnode == newnode)
 		return dev;
 
-	if (realloc_vq)
-		memcpy(new_vq, old_vq, sizeof(*new_vq));
-	if (realloc_dev)
-		memcpy(new_ll_dev, old_ll_dev, sizeof(*new_ll_dev));
-	(new_ll_dev ? new_ll_dev : old_ll_dev)->dev.virtqueue[index] =
-		new_vq ? new_vq : old_vq;
-	if (realloc_vq)
-		rte_free(old_vq);
-	if (realloc_dev) {
-		if (ll_root == old_ll_dev)
-			ll_root = new_ll_dev;
-		else {
-			struct virtio_net_config_ll *prev = ll_root;
-			while (prev->next != old_ll_dev)
-				prev = prev->next;
-			prev->next = new_ll_dev;
-			new_ll_dev->next = old_ll_dev->next;
-		}
-		rte_free(old_ll_dev);
+	new_ll_dev = rte_malloc_socket(NULL,
+		sizeof(struct virtio_net_config_ll), 0, newnode);
+	if (new_ll_dev == NULL)
+		return dev;
+	memcpy(new_ll_dev, old_ll_dev, sizeof(*new_ll_dev));
+	if (ll_root == old_ll_dev)
+		ll_root = new_ll_dev;
+	else {
+		struct virtio_net_config_ll *prev = ll_root;
+		while (prev->next != old_ll_dev)
+			prev = prev->next;
+		prev->next = new_ll_dev;
 	}
+	rte_free(old_ll_dev);
 
-	return realloc_dev ? &new_ll_dev->dev : dev;
+	return &new_ll_dev->dev;
 }
 #else
 static struct virtio_net*
@@ -666,6 +759,24 @@ set_vring_addr(struct vhost_device_ctx ctx, struct vhost_vring_addr *addr)
 		return -1;
 	}
 
+	/*
+	 * The avail and used addresses of a packed virtqueue are the ones of
+	 * its driver and device event suppression areas.
+	 */
+	if (dev->features & (1ULL << VIRTIO_F_RING_PACKED)) {
+		vq->desc_packed = (struct vring_packed_desc *)vq->desc;
+		vq->driver_event =
+			(struct vring_packed_desc_event *)vq->avail;
+		vq->device_event =
+			(struct vring_packed_desc_event *)vq->used;
+		/* The used descriptors are written in the descriptor ring. */
+		vq->log_desc_addr = qva_to_gpa(dev, addr->desc_user_addr);
+	}
+
+	/* Guest physical address of the used ring, for the dirty log. */
+	vq->log_guest_addr = (addr->flags & (1 << VHOST_VRING_F_LOG)) ?
+		addr->log_guest_addr : 0;
+
 	LOG_DEBUG(VHOST_CONFIG, "(%"PRIu64") mapped address desc: %p\n",
 			dev->device_fh, vq->desc);
 	LOG_DEBUG(VHOST_CONFIG, "(%"PRIu64") mapped address avail: %p\n",
@@ -684,14 +795,25 @@ static int
 set_vring_base(struct vhost_device_ctx ctx, struct vhost_vring_state *state)
 {
 	struct virtio_net *dev;
+	struct vhost_virtqueue *vq;
 
 	dev = get_device(ctx);
 	if (dev == NULL)
 		return -1;
 
-	/* State->index refers to the queue index. The txq is 1, rxq is 0. */
-	dev->virtqueue[state->index]->last_used_idx = state->num;
-	dev->virtqueue[state->index]->last_used_idx_res = state->num;
+	/*
+	 * State->index refers to the queue index. The txq is 1, rxq is 0.
+	 * The wrap counter of a packed virtqueue is in bit 15.
+	 */
+	vq = dev->virtqueue[state->index];
+	if (dev->features & (1ULL << VIRTIO_F_RING_PACKED)) {
+		vq->last_used_idx = state->num & 0x7fff;
+		vq->used_wrap_counter = !!(state->num & (1 << 15));
+	} else {
+		vq->last_used_idx = state->num;
+	}
+	vq->last_used_idx_res = vq->last_used_idx;
+	vq->last_zcopy_used_idx = vq->last_used_idx;
 
 	return 0;
 }
@@ -713,6 +835,9 @@ get_vring_base(struct vhost_device_ctx ctx, uint32_t index,
 	state->index = index;
 	/* State->index refers to the queue index. The txq is 1, rxq is 0. */
 	state->num = dev->virtqueue[state->index]->last_used_idx;
+	if (dev->features & (1ULL << VIRTIO_F_RING_PACKED))
+		state->num |= dev->virtqueue[state->index]->used_wrap_counter
+			<< 15;
 
 	return 0;
 }
@@ -809,7 +934,10 @@ set_backend(struct vhost_device_ctx ctx, struct vhost_vring_file *file)
 	if (!(dev->flags & VIRTIO_DEV_RUNNING)) {
 		if (((int)dev->virtqueue[VIRTIO_TXQ]->backend != VIRTIO_DEV_STOPPED) &&
 			((int)dev->virtqueue[VIRTIO_RXQ]->backend != VIRTIO_DEV_STOPPED)) {
-			return notify_ops->new_device(dev);
+			if (notify_ops->new_device(dev) < 0)
+				return -1;
+			vhost_notify_numa(dev, VIRTIO_RXQ);
+			vhost_notify_numa(dev, VIRTIO_TXQ);
 		}
 	/* Otherwise we remove it. */
 	} else
@@ -854,16 +982,56 @@ get_virtio_net_callbacks(void)
 	return &vhost_device_ops;
 }
 
+/*
+ * Tell the application that a vring of a running device is not on the NUMA
+ * node of the device, so that it can poll the queue from a core of that node.
+ */
+void
+vhost_notify_numa(struct virtio_net *dev, uint32_t index)
+{
+	int node = dev->virtqueue[index]->numa_node;
+
+	if (notify_ops->vring_numa_changed == NULL ||
+	    !(dev->flags & VIRTIO_DEV_RUNNING) ||
+	    node < 0 || node == dev->numa_node)
+		return;
+
+	notify_ops->vring_numa_changed(dev, index, node);
+}
+
+int rte_vhost_get_numa_node(struct virtio_net *dev, uint16_t queue_id)
+{
+	if (dev == NULL || queue_id >= dev->virt_qp_nb * VIRTIO_QNUM)
+		return -1;
+
+	return dev->virtqueue[queue_id]->numa_node;
+}
+
 int rte_vhost_enable_guest_notification(struct virtio_net *dev,
 	uint16_t queue_id, int enable)
 {
+	struct vhost_virtqueue *vq = dev->virtqueue[queue_id];
+	struct vhost_log_cache log_cache;
+
 	if (enable) {
 		RTE_LOG(ERR, VHOST_CONFIG,
 			"guest notification isn't supported.\n");
 		return -1;
 	}
 
-	dev->virtqueue[queue_id]->used->flags = VRING_USED_F_NO_NOTIFY;
+	log_cache.nr = 0;
+	if (dev->features & (1ULL << VIRTIO_F_RING_PACKED)) {
+		vq->device_event->flags = VRING_EVENT_F_DISABLE;
+		vhost_log_used_vring(dev, vq, &log_cache,
+			offsetof(struct vring_packed_desc_event, flags),
+			sizeof(vq->device_event->flags));
+	} else {
+		vq->used->flags = VRING_USED_F_NO_NOTIFY;
+		vhost_log_used_vring(dev, vq, &log_cache,
+			offsetof(struct vring_used, flags),
+			sizeof(vq->used->flags));
+	}
+	vhost_log_cache_sync(dev, &log_cache);
 	return 0;
 }
 
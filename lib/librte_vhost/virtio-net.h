@@ -39,5 +39,6 @@
 
 struct virtio_net_device_ops const *notify_ops;
 struct virtio_net *get_device(struct vhost_device_ctx ctx);
+void vhost_notify_numa(struct virtio_net *dev, uint32_t index);
 
 #endif